@@ -45,6 +45,7 @@
 #include "Utils/StringUtils.h"
 #include "Utils/Scripting/ScriptBindings.h"
 #include "Utils/Timing/Profiler.h"
+#include "Utils/Image/HDRImageDecoder.h"
 
 #if FALCOR_HAS_CUDA
 #include "Utils/CudaUtils.h"
@@ -647,6 +648,10 @@ Device::Device(const Desc& desc) : mDesc(desc)
     mpProfiler = std::make_unique<Profiler>(ref<Device>(this));
     mpProfiler->breakStrongReferenceToDevice();
 
+    HDRImageDecoder::Options hdrImageDecoderOptions;
+    hdrImageDecoderOptions.threadCount = mDesc.hdrImageDecoderThreadCount;
+    mpHDRImageDecoder = std::make_unique<HDRImageDecoder>(hdrImageDecoderOptions);
+
     mpDefaultSampler = createSampler(Sampler::Desc());
     mpDefaultSampler->breakStrongReferenceToDevice();
 
@@ -680,6 +685,7 @@ Device::~Device()
     mpRenderContext->submit(true);
 
     mpProfiler.reset();
+    mpHDRImageDecoder.reset();
 
     // Release all the bound resources. Need to do that before deleting the RenderContext
     mGfxCommandQueue.setNull();
@@ -64,6 +64,7 @@ class PipelineCreationAPIDispatcher;
 class ProgramManager;
 class Profiler;
 class AftermathContext;
+class HDRImageDecoder;
 
 namespace cuda_utils
 {
@@ -147,6 +148,9 @@ public:
         /// The full path to the root directory for the shader cache. An empty string will disable the cache.
         std::string shaderCachePath = (getRuntimeDirectory() / ".shadercache").string();
 
+        /// Number of threads used to decode EXR and HDR images (see HDRImageDecoder). 0 uses the hardware concurrency.
+        uint32_t hdrImageDecoderThreadCount = 0;
+
 #if FALCOR_HAS_D3D12
         /// GUID list for experimental features
         std::vector<GUID> experimentalFeatures;
@@ -487,6 +491,9 @@ public:
 
     Profiler* getProfiler() const { return mpProfiler.get(); }
 
+    /// Get the decoder used to load EXR and HDR images for this device.
+    const HDRImageDecoder* getHDRImageDecoder() const { return mpHDRImageDecoder.get(); }
+
     /**
      * Get the default render-context.
      * The default render-context is managed completely by the device. The user should just queue commands into it, the device will take
@@ -697,6 +704,7 @@ private:
 
     std::unique_ptr<ProgramManager> mpProgramManager;
     std::unique_ptr<Profiler> mpProfiler;
+    std::unique_ptr<HDRImageDecoder> mpHDRImageDecoder;
 
 #if FALCOR_HAS_CUDA
     /// CUDA device sharing the same adapter as the graphics device.
@@ -282,7 +282,7 @@ ref<Texture> Texture::createMippedFromFiles(
         }
         else
         {
-            pBitmap = Bitmap::createFromFile(path, kTopDown, importFlags);
+            pBitmap = Bitmap::createFromFile(path, kTopDown, importFlags, pDevice->getHDRImageDecoder());
         }
         if (!pBitmap)
         {
@@ -390,7 +390,7 @@ ref<Texture> Texture::createFromFile(
     }
     else
     {
-        Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(path, kTopDown, importFlags);
+        Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(path, kTopDown, importFlags, pDevice->getHDRImageDecoder());
         if (pBitmap)
         {
             ResourceFormat texFormat = pBitmap->getFormat();
@@ -30,6 +30,7 @@
 #include "Macros.h"
 #include "Enum.h"
 #include <filesystem>
+#include <functional>
 #include <regex>
 #include <string>
 #include <vector>
@@ -88,6 +89,9 @@ FALCOR_ENUM_REGISTER(SearchPathPriority);
 class FALCOR_API AssetResolver
 {
 public:
+    /// Callback called with each successfully resolved path.
+    using ResolveCallback = std::function<void(const std::filesystem::path&)>;
+
     /// Default constructor.
     AssetResolver();
 
@@ -137,6 +141,14 @@ public:
         AssetCategory category = AssetCategory::Any
     );
 
+    /**
+     * Set a callback that is called with each path resolved by resolvePath() and resolvePathPattern().
+     * This is used to track the files an asset depends on. The callback is copied along with the resolver
+     * and may be called concurrently from multiple threads.
+     * @param callback Callback, or an empty function to remove the callback.
+     */
+    void setResolveCallback(ResolveCallback callback);
+
     /// Return the global default asset resolver.
     static AssetResolver& getDefaultResolver();
 
@@ -158,5 +170,6 @@ private:
     };
 
     std::vector<SearchContext> mSearchContexts;
+    ResolveCallback mResolveCallback;
 };
 } // namespace Falcor
@@ -43,6 +43,7 @@ namespace Falcor
     {
         mLeafUpdater = ComputePass::create(mpDevice, kShaderFile, "updateLeafNodes");
         mInternalUpdater = ComputePass::create(mpDevice, kShaderFile, "updateInternalNodes");
+        mWideUpdater = ComputePass::create(mpDevice, kShaderFile, "updateWideNodes");
     }
 
     // TODO: Only update the ones that moved.
@@ -86,6 +87,20 @@ namespace Falcor
             }
         }
 
+        // Update the wide nodes by copying the attributes of the binary nodes they were collapsed from.
+        if (mNodeWidth > 2)
+        {
+            auto var = mWideUpdater->getRootVar()["CB"];
+            bindShaderData(var["gLightBVH"]);
+            var["gWideChildNodeIndices"] = mpWideChildNodeIndicesBuffer;
+
+            const uint32_t slotCount = (uint32_t)mWideNodes.size() * PackedWideNodeGroup::kChildCount;
+            var["gNodeCount"] = slotCount;
+
+            mWideUpdater->execute(pRenderContext, slotCount, 1, 1);
+        }
+
+        mBVHStats.refitSAOHCost = 0.f; // The cost is only tracked by the CPU refit.
         mIsCpuDataValid = false;
     }
 
@@ -106,6 +121,20 @@ namespace Falcor
             "  Triangle count:      " + std::to_string(stats.triangleCount) + "\n";
         widget.text(statsStr);
 
+        if (stats.buildSAOHCost > 0.f && stats.refitSAOHCost > 0.f)
+        {
+            widget.text("  SAOH cost growth:    " + std::to_string(stats.refitSAOHCost / stats.buildSAOHCost) + "\n");
+        }
+
+        if (stats.wideNodeCount > 0)
+        {
+            const std::string wideStatsStr =
+                "  Node width:          " + std::to_string(mNodeWidth) + "\n" +
+                "  Wide tree height:    " + std::to_string(stats.wideTreeHeight) + "\n" +
+                "  Wide node count:     " + std::to_string(stats.wideNodeCount) + "\n";
+            widget.text(wideStatsStr);
+        }
+
         if (auto nodeGroup = widget.group("Node count per level"))
         {
             std::string countStr;
@@ -133,6 +162,10 @@ namespace Falcor
     {
         // Reset all CPU data.
         mNodes.clear();
+        mWideNodes.clear();
+        mWideChildNodeIndices.clear();
+        mTriangleIndices.clear();
+        mNodeWidth = 2;
         mNodeIndices.clear();
         mPerDepthRefitEntryInfo.clear();
         mMaxTriangleCountPerLeaf = 0;
@@ -214,6 +247,33 @@ namespace Falcor
         traverseBVH(evalInternal, evalLeaf);
 
         mBVHStats.byteSize = (uint32_t)(mNodes.size() * sizeof(mNodes[0]));
+
+        // Compute the wide BVH stats.
+        mBVHStats.wideNodeCount = 0;
+        mBVHStats.wideTreeHeight = 0;
+        if (mNodeWidth > 2)
+        {
+            const uint32_t groupCount = mNodeWidth / PackedWideNodeGroup::kChildCount;
+            mBVHStats.wideNodeCount = (uint32_t)(mWideNodes.size() / groupCount);
+            mBVHStats.byteSize += (uint32_t)(mWideNodes.size() * sizeof(mWideNodes[0]));
+
+            std::stack<NodeLocation> stack({ NodeLocation{ 0, 0 } });
+            while (!stack.empty())
+            {
+                const NodeLocation location = stack.top();
+                stack.pop();
+
+                for (uint32_t slot = 0; slot < mNodeWidth; ++slot)
+                {
+                    const PackedWideNodeGroup& group = mWideNodes[location.nodeIndex + slot / PackedWideNodeGroup::kChildCount];
+                    const uint32_t lane = slot % PackedWideNodeGroup::kChildCount;
+                    if (!group.isValid(lane)) continue;
+
+                    if (group.isLeaf(lane)) mBVHStats.wideTreeHeight = std::max(mBVHStats.wideTreeHeight, location.depth + 1);
+                    else stack.push(NodeLocation{ group.getChildNodeIndex(lane), location.depth + 1 });
+                }
+            }
+        }
     }
 
     void LightBVH::updateNodeIndices()
@@ -269,7 +329,7 @@ namespace Falcor
         mpNodeIndicesBuffer->setBlob(mNodeIndices.data(), 0, mNodeIndices.size() * sizeof(uint32_t));
     }
 
-    void LightBVH::uploadCPUBuffers(const std::vector<uint32_t>& triangleIndices, const std::vector<uint64_t>& triangleBitmasks)
+    void LightBVH::uploadCPUBuffers(const std::vector<uint64_t>& triangleBitmasks)
     {
         // Reallocate buffers if size requirements have changed.
         auto var = mLeafUpdater->getRootVar()["CB"]["gLightBVH"];
@@ -278,9 +338,9 @@ namespace Falcor
             mpBVHNodesBuffer = mpDevice->createStructuredBuffer(var["nodes"], (uint32_t)mNodes.size(), ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess, MemoryType::DeviceLocal, nullptr, false);
             mpBVHNodesBuffer->setName("LightBVH::mpBVHNodesBuffer");
         }
-        if (!mpTriangleIndicesBuffer || mpTriangleIndicesBuffer->getElementCount() < triangleIndices.size())
+        if (!mpTriangleIndicesBuffer || mpTriangleIndicesBuffer->getElementCount() < mTriangleIndices.size())
         {
-            mpTriangleIndicesBuffer = mpDevice->createStructuredBuffer(var["triangleIndices"], (uint32_t)triangleIndices.size(), ResourceBindFlags::ShaderResource, MemoryType::DeviceLocal, nullptr, false);
+            mpTriangleIndicesBuffer = mpDevice->createStructuredBuffer(var["triangleIndices"], (uint32_t)mTriangleIndices.size(), ResourceBindFlags::ShaderResource, MemoryType::DeviceLocal, nullptr, false);
             mpTriangleIndicesBuffer->setName("LightBVH::mpTriangleIndicesBuffer");
         }
         if (!mpTriangleBitmasksBuffer || mpTriangleBitmasksBuffer->getElementCount() < triangleBitmasks.size())
@@ -288,17 +348,48 @@ namespace Falcor
             mpTriangleBitmasksBuffer = mpDevice->createStructuredBuffer(var["triangleBitmasks"], (uint32_t)triangleBitmasks.size(), ResourceBindFlags::ShaderResource, MemoryType::DeviceLocal, nullptr, false);
             mpTriangleBitmasksBuffer->setName("LightBVH::mpTriangleBitmasksBuffer");
         }
+        if (mNodeWidth > 2)
+        {
+            FALCOR_ASSERT(mWideChildNodeIndices.size() == mWideNodes.size() * PackedWideNodeGroup::kChildCount);
+            if (!mpWideNodesBuffer || mpWideNodesBuffer->getElementCount() < mWideNodes.size())
+            {
+                mpWideNodesBuffer = mpDevice->createStructuredBuffer(var["wideNodes"], (uint32_t)mWideNodes.size(), ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess, MemoryType::DeviceLocal, nullptr, false);
+                mpWideNodesBuffer->setName("LightBVH::mpWideNodesBuffer");
+            }
+            if (!mpWideChildNodeIndicesBuffer || mpWideChildNodeIndicesBuffer->getElementCount() < mWideChildNodeIndices.size())
+            {
+                mpWideChildNodeIndicesBuffer = mpDevice->createStructuredBuffer(sizeof(uint32_t), (uint32_t)mWideChildNodeIndices.size(), ResourceBindFlags::ShaderResource, MemoryType::DeviceLocal, nullptr, false);
+                mpWideChildNodeIndicesBuffer->setName("LightBVH::mpWideChildNodeIndicesBuffer");
+            }
+        }
 
         // Update our GPU side buffers.
+        FALCOR_ASSERT(mpTriangleIndicesBuffer->getSize() >= mTriangleIndices.size() * sizeof(mTriangleIndices[0]));
+        mpTriangleIndicesBuffer->setBlob(mTriangleIndices.data(), 0, mTriangleIndices.size() * sizeof(mTriangleIndices[0]));
+
+        FALCOR_ASSERT(mpTriangleBitmasksBuffer->getSize() >= triangleBitmasks.size() * sizeof(triangleBitmasks[0]));
+        mpTriangleBitmasksBuffer->setBlob(triangleBitmasks.data(), 0, triangleBitmasks.size() * sizeof(triangleBitmasks[0]));
+
+        if (mNodeWidth > 2)
+        {
+            mpWideChildNodeIndicesBuffer->setBlob(mWideChildNodeIndices.data(), 0, mWideChildNodeIndices.size() * sizeof(mWideChildNodeIndices[0]));
+        }
+
+        uploadNodes();
+    }
+
+    void LightBVH::uploadNodes()
+    {
         FALCOR_ASSERT(mpBVHNodesBuffer->getElementCount() >= mNodes.size());
         FALCOR_ASSERT(mpBVHNodesBuffer->getStructSize() == sizeof(mNodes[0]));
         mpBVHNodesBuffer->setBlob(mNodes.data(), 0, mNodes.size() * sizeof(mNodes[0]));
 
-        FALCOR_ASSERT(mpTriangleIndicesBuffer->getSize() >= triangleIndices.size() * sizeof(triangleIndices[0]));
-        mpTriangleIndicesBuffer->setBlob(triangleIndices.data(), 0, triangleIndices.size() * sizeof(triangleIndices[0]));
-
-        FALCOR_ASSERT(mpTriangleBitmasksBuffer->getSize() >= triangleBitmasks.size() * sizeof(triangleBitmasks[0]));
-        mpTriangleBitmasksBuffer->setBlob(triangleBitmasks.data(), 0, triangleBitmasks.size() * sizeof(triangleBitmasks[0]));
+        if (mNodeWidth > 2)
+        {
+            FALCOR_ASSERT(mpWideNodesBuffer->getElementCount() >= mWideNodes.size());
+            FALCOR_ASSERT(mpWideNodesBuffer->getStructSize() == sizeof(mWideNodes[0]));
+            mpWideNodesBuffer->setBlob(mWideNodes.data(), 0, mWideNodes.size() * sizeof(mWideNodes[0]));
+        }
 
         mIsCpuDataValid = true;
     }
@@ -311,6 +402,10 @@ namespace Falcor
         // after the data is updated on the GPU and map the staging buffer here instead.
         FALCOR_ASSERT(mNodes.size() > 0 && mNodes.size() <= mpBVHNodesBuffer->getElementCount());
         mpBVHNodesBuffer->getBlob(mNodes.data(), 0, mNodes.size() * sizeof(PackedNode));;
+        if (!mWideNodes.empty())
+        {
+            mpWideNodesBuffer->getBlob(mWideNodes.data(), 0, mWideNodes.size() * sizeof(PackedWideNodeGroup));
+        }
         mIsCpuDataValid = true;
     }
 
@@ -322,6 +417,7 @@ namespace Falcor
             var["nodes"] = mpBVHNodesBuffer;
             var["triangleIndices"] = mpTriangleIndicesBuffer;
             var["triangleBitmasks"] = mpTriangleBitmasksBuffer;
+            var["wideNodes"] = mNodeWidth > 2 ? mpWideNodesBuffer : ref<Buffer>();
         }
     }
 }
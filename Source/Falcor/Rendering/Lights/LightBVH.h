@@ -45,6 +45,8 @@ namespace Falcor
 
         This is binary BVH over all emissive triangles as described by Moreau and Clarberg,
         "Importance Sampling of Many Lights on the GPU", Ray Tracing Gems, Ch. 18, 2019.
+        The binary BVH can optionally be collapsed into a 4- or 8-wide BVH, which is then
+        used for sampling. The binary nodes are kept for refitting and CPU traversal.
 
         Before being used, the BVH needs to have been built using LightBVHBuilder::build().
         The data can be both used on the CPU (using traverseBVH() or on the GPU by:
@@ -102,12 +104,20 @@ namespace Falcor
             uint32_t internalNodeCount = 0;                  ///< Number of internal nodes inside the BVH.
             uint32_t leafNodeCount = 0;                      ///< Number of leaf nodes inside the BVH.
             uint32_t triangleCount = 0;                      ///< Number of triangles inside the BVH.
+            uint32_t wideNodeCount = 0;                      ///< Number of wide nodes, or zero if the BVH is binary.
+            uint32_t wideTreeHeight = 0;                     ///< Number of edges on the longest path between the root node and a leaf of the wide BVH.
+            float buildSAOHCost = 0.f;                       ///< SAOH cost of the BVH after the last rebuild. See LightBVHBuilder::computeSAOHCost().
+            float refitSAOHCost = 0.f;                       ///< SAOH cost of the BVH after the last CPU refit, or zero if it has not been refitted on the CPU.
         };
 
         /** Returns stats.
         */
         const BVHStats& getStats() const { return mBVHStats; }
 
+        /** Returns the number of children per node of the BVH used for sampling (2, 4 or 8).
+        */
+        uint32_t getNodeWidth() const { return mNodeWidth; }
+
         /** Is the BVH valid.
             \return true if the BVH is ready for use.
         */
@@ -128,7 +138,8 @@ namespace Falcor
         void updateNodeIndices();
         void renderStats(Gui::Widgets& widget, const BVHStats& stats) const;
 
-        void uploadCPUBuffers(const std::vector<uint32_t>& triangleIndices, const std::vector<uint64_t>& triangleBitmasks);
+        void uploadCPUBuffers(const std::vector<uint64_t>& triangleBitmasks);
+        void uploadNodes();
         void syncDataToCPU() const;
 
         /** Invalidate the BVH.
@@ -147,9 +158,14 @@ namespace Falcor
 
         ref<ComputePass>                      mLeafUpdater;             ///< Compute pass for refitting the leaf nodes.
         ref<ComputePass>                      mInternalUpdater;         ///< Compute pass for refitting internal nodes.
+        ref<ComputePass>                      mWideUpdater;             ///< Compute pass for refitting wide nodes.
 
         // CPU resources
         mutable std::vector<PackedNode>       mNodes;                   ///< CPU-side copy of packed BVH nodes.
+        mutable std::vector<PackedWideNodeGroup> mWideNodes;            ///< CPU-side copy of packed wide BVH nodes. Empty if the BVH is binary.
+        std::vector<uint32_t>                 mWideChildNodeIndices;    ///< For each wide node child slot, the index of the binary node it was collapsed from.
+        std::vector<uint32_t>                 mTriangleIndices;         ///< Triangle indices sorted by leaf node. This is used for CPU refit.
+        uint32_t                              mNodeWidth = 2;           ///< Number of children per node of the BVH used for sampling.
         std::vector<uint32_t>                 mNodeIndices;             ///< Array of all node indices sorted by tree depth.
         std::vector<RefitEntryInfo>           mPerDepthRefitEntryInfo;  ///< Array containing for each level the number of internal nodes as well as the corresponding offset into 'mpNodeIndicesBuffer'; the very last entry contains the same data, but for all leaf nodes instead.
         uint32_t                              mMaxTriangleCountPerLeaf = 0; ///< After the BVH is built, this contains the maximum light count per leaf node.
@@ -160,8 +176,10 @@ namespace Falcor
         // GPU resources
         ref<Buffer>                           mpBVHNodesBuffer;         ///< Buffer holding all BVH nodes.
         ref<Buffer>                           mpTriangleIndicesBuffer;  ///< Triangle indices sorted by leaf node. Each leaf node refers to a contiguous array of triangle indices.
-        ref<Buffer>                           mpTriangleBitmasksBuffer; ///< Array containing the per triangle bit pattern retracing the tree traversal to reach the triangle: 0=left child, 1=right child.
+        ref<Buffer>                           mpTriangleBitmasksBuffer; ///< Array containing the per triangle bit pattern retracing the tree traversal to reach the triangle: 0=left child, 1=right child. For wide BVHs, each level stores the child slot in log2(width) bits.
         ref<Buffer>                           mpNodeIndicesBuffer;      ///< Buffer holding all node indices sorted by tree depth. This is used for BVH refit.
+        ref<Buffer>                           mpWideNodesBuffer;        ///< Buffer holding all wide BVH nodes.
+        ref<Buffer>                           mpWideChildNodeIndicesBuffer; ///< Buffer holding for each wide node child slot the index of the binary node it was collapsed from. This is used for BVH refit.
 
         friend LightBVHBuilder;
     };
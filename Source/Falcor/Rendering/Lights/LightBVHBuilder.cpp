@@ -29,8 +29,11 @@
 #include "Core/Error.h"
 #include "Utils/Logger.h"
 #include "Utils/Timing/Profiler.h"
+#include "Utils/NumericRange.h"
 #include "Utils/Math/MathConstants.slangh"
 #include <algorithm>
+#include <execution>
+#include <numeric>
 
 namespace
 {
@@ -44,6 +47,15 @@ namespace
     const uint32_t kMaxLeafTriangleCount = 1 << PackedNode::kTriangleCountBits;
     const uint32_t kMaxLeafTriangleOffset = 1 << PackedNode::kTriangleOffsetBits;
 
+    // When building in parallel, ranges with fewer triangles than this are built as independent subtrees.
+    const uint32_t kMinParallelSubtreeTriangleCount = 8192;
+
+    // Ranges with at least this many triangles evaluate the split candidates and partition the triangles in parallel.
+    const uint32_t kMinParallelSplitTriangleCount = 65536;
+
+    // Levels with at least this many internal nodes are refitted in parallel.
+    const size_t kMinParallelRefitNodeCount = 1024;
+
     inline float safeACos(float v)
     {
         return std::acos(std::clamp(v, -1.0f, 1.0f));
@@ -215,6 +227,37 @@ namespace
         const float3 dims = max(float3(epsilon), bb.extent());
         return dims.x * dims.y * dims.z;
     }
+
+    /** Relocates a node that was built as part of an independently built subtree.
+        Only the child index or triangle offset stored in the first dword is patched,
+        as unpacking and repacking the node attributes is lossy.
+    */
+    void relocateNode(PackedNode& node, uint32_t nodeOffset, uint32_t triangleOffset)
+    {
+        if (node.isLeaf())
+        {
+            FALCOR_ASSERT(node.getLeafNode().triangleOffset + triangleOffset < kMaxLeafTriangleOffset);
+            node.data[0].x += triangleOffset;
+        }
+        else
+        {
+            node.data[0].x += nodeOffset;
+        }
+    }
+
+    /** Applies a permutation to a range of values.
+        \param[in,out] values Values to permute.
+        \param[in] offset Offset of the range to permute.
+        \param[in] indices Absolute indices of the values to store at each position of the range.
+        \param[in,out] scratch Scratch memory.
+    */
+    template<typename T>
+    void permuteRange(std::vector<T>& values, uint32_t offset, const std::vector<uint32_t>& indices, std::vector<T>& scratch)
+    {
+        scratch.resize(indices.size());
+        for (size_t i = 0; i < indices.size(); ++i) scratch[i] = values[indices[i]];
+        std::copy(scratch.begin(), scratch.end(), values.begin() + offset);
+    }
 }
 
 namespace Falcor
@@ -225,6 +268,20 @@ namespace Falcor
     {
     }
 
+    void LightBVHBuilder::TriangleSortData::resize(size_t count)
+    {
+        for (uint32_t axis = 0; axis < 3; axis++)
+        {
+            center[axis].resize(count);
+            boundsMin[axis].resize(count);
+            boundsMax[axis].resize(count);
+            coneDirection[axis].resize(count);
+        }
+        cosConeAngle.resize(count);
+        flux.resize(count);
+        triangleIndex.resize(count);
+    }
+
     void LightBVHBuilder::build(RenderContext* pRenderContext, LightBVH& bvh)
     {
         FALCOR_PROFILE(pRenderContext, "LightBVHBuilder::build()");
@@ -235,77 +292,171 @@ namespace Falcor
         // Get global list of emissive triangles.
         FALCOR_ASSERT(bvh.mpLightCollection);
         const auto& triangles = bvh.mpLightCollection->getMeshLightTriangles(pRenderContext);
-        if (triangles.empty()) return;
 
-        // Create list of triangles that should be included in BVH.
-        // For each triangle, precompute data we need for the build.
-        BuildingData data(bvh.mNodes);
-        data.trianglesData.reserve(triangles.size());
+        std::vector<uint64_t> triangleBitmasks;
+        if (!buildNodes(triangles, bvh.mNodes, bvh.mTriangleIndices, triangleBitmasks)) return;
 
-        for (size_t i = 0; i < triangles.size(); i++)
+        // Collapse the binary BVH into a wide BVH. The bitmasks are replaced by the paths through the wide BVH.
+        const uint32_t width = static_cast<uint32_t>(mOptions.nodeWidth);
+        if (width > 2)
         {
-            if (!mOptions.usePreintegration || triangles[i].flux > 0.f)
-            {
-                LightBVHBuilder::TriangleSortData tri;
-                for (uint32_t j = 0; j < 3; j++)
-                {
-                    tri.bounds |= triangles[i].vtx[j].pos;
-                }
-                tri.center = triangles[i].getCenter();
-                tri.coneDirection = triangles[i].normal;
-                tri.cosConeAngle = 1.f; // Single flat emitter => normal bounding cone angle is zero.
-                tri.flux = triangles[i].flux;
-                tri.triangleIndex = static_cast<uint32_t>(i);
+            collapseNodes(bvh.mNodes, width, bvh.mWideNodes, bvh.mWideChildNodeIndices);
+            computeWideTriangleBitmasks(bvh.mWideNodes, width, bvh.mTriangleIndices, triangleBitmasks);
+        }
 
-                data.trianglesData.push_back(tri);
-            }
+        // The BVH is ready, mark it as valid and upload the data.
+        bvh.mIsValid = true;
+        bvh.mMaxTriangleCountPerLeaf = mOptions.maxTriangleCountPerLeaf;
+        bvh.mNodeWidth = width;
+        bvh.uploadCPUBuffers(triangleBitmasks);
+
+        // Computate metadata.
+        bvh.finalize();
+        bvh.mBVHStats.buildSAOHCost = computeSAOHCost(bvh.mNodes, mOptions);
+    }
+
+    bool LightBVHBuilder::refit(RenderContext* pRenderContext, LightBVH& bvh) const
+    {
+        FALCOR_PROFILE(pRenderContext, "LightBVHBuilder::refit()");
+
+        FALCOR_ASSERT(bvh.isValid());
+        FALCOR_ASSERT(bvh.mpLightCollection);
+        const auto& triangles = bvh.mpLightCollection->getMeshLightTriangles(pRenderContext);
+
+        // Make sure the CPU copy of the nodes is current, in case the BVH was last refitted on the GPU.
+        bvh.syncDataToCPU();
+        refitNodes(triangles, bvh.mTriangleIndices, mOptions.useParallelBuild, bvh.mNodes);
+        if (bvh.mNodeWidth > 2) refitWideNodes(bvh.mNodes, bvh.mWideChildNodeIndices, bvh.mWideNodes);
+        bvh.uploadNodes();
+
+        // Track the quality of the hierarchy, which degrades as the emissive geometry moves away from the configuration it was built for.
+        const float cost = computeSAOHCost(bvh.mNodes, mOptions);
+        const float buildCost = bvh.mBVHStats.buildSAOHCost;
+        bvh.mBVHStats.refitSAOHCost = cost;
+
+        return mOptions.maxRefitCostRatio > 0.f && buildCost > 0.f && cost > mOptions.maxRefitCostRatio * buildCost;
+    }
+
+    bool LightBVHBuilder::buildNodes(const std::vector<LightCollection::MeshLightTriangle>& triangles, std::vector<PackedNode>& nodes, std::vector<uint32_t>& triangleIndices, std::vector<uint64_t>& triangleBitmasks) const
+    {
+        nodes.clear();
+        triangleIndices.clear();
+        triangleBitmasks.clear();
+        if (triangles.empty()) return false;
+
+        // Create list of triangles that should be included in BVH.
+        std::vector<uint32_t> includedTriangles;
+        includedTriangles.reserve(triangles.size());
+        for (size_t i = 0; i < triangles.size(); i++)
+        {
+            if (!mOptions.usePreintegration || triangles[i].flux > 0.f) includedTriangles.push_back(static_cast<uint32_t>(i));
         }
 
         // If there are no non-culled triangles, we're done.
-        if (data.trianglesData.empty()) return;
+        if (includedTriangles.empty()) return false;
 
         // Validate options.
         if (mOptions.maxTriangleCountPerLeaf > kMaxLeafTriangleCount)
         {
             FALCOR_THROW("Max triangle count per leaf exceeds the maximum supported ({})", kMaxLeafTriangleCount);
         }
-        if (data.trianglesData.size() > kMaxLeafTriangleOffset + kMaxLeafTriangleCount)
+        if (includedTriangles.size() > kMaxLeafTriangleOffset + kMaxLeafTriangleCount)
         {
             FALCOR_THROW("Emissive triangle count exceeds the maximum supported ({})", kMaxLeafTriangleOffset + kMaxLeafTriangleCount);
         }
 
-        // Allocate temporary memory for the BVH build.
-        // To be grossly conservative, assume each triangle requires two nodes.
-        // This is only system RAM and shouldn't be that much, so it's not worth being more careful about it.
-        // TODO: Better estimate of how many nodes we will need.
-        data.nodes.clear();
-        data.nodes.reserve(2 * data.trianglesData.size());
-        data.triangleIndices.reserve(data.trianglesData.size());
+        // For each triangle, precompute data we need for the build.
+        TriangleSortData trianglesData;
+        trianglesData.resize(includedTriangles.size());
 
-        const uint64_t invalidBitmask = std::numeric_limits<uint64_t>::max();
-        data.triangleBitmasks.resize(triangles.size(), invalidBitmask); // This is sized based on input triangle count, as it's indexed by global triangle index.
+        auto prepareTriangle = [&](uint32_t i)
+        {
+            const auto& triangle = triangles[includedTriangles[i]];
+            AABB bounds;
+            for (uint32_t j = 0; j < 3; j++)
+            {
+                bounds |= triangle.vtx[j].pos;
+            }
+            const float3 center = bounds.center();
+            for (uint32_t axis = 0; axis < 3; axis++)
+            {
+                trianglesData.center[axis][i] = center[axis];
+                trianglesData.boundsMin[axis][i] = bounds.minPoint[axis];
+                trianglesData.boundsMax[axis][i] = bounds.maxPoint[axis];
+                trianglesData.coneDirection[axis][i] = triangle.normal[axis];
+            }
+            trianglesData.cosConeAngle[i] = 1.f; // Single flat emitter => normal bounding cone angle is zero.
+            trianglesData.flux[i] = triangle.flux;
+            trianglesData.triangleIndex[i] = includedTriangles[i];
+        };
+        NumericRange<uint32_t> triangleRange(0, static_cast<uint32_t>(includedTriangles.size()));
+        if (mOptions.useParallelBuild) std::for_each(std::execution::par, triangleRange.begin(), triangleRange.end(), prepareTriangle);
+        else std::for_each(triangleRange.begin(), triangleRange.end(), prepareTriangle);
 
-        // Build the tree.
+        // Build the top of the tree first. The remaining ranges are disjoint and are built as independent subtrees.
+        // Every node is computed from its own range of triangles only, so the result does not depend on the order in which the subtrees are built.
         SplitHeuristicFunction splitFunc = getSplitFunction(mOptions.splitHeuristicSelection);
-        buildInternal(mOptions, splitFunc, 0ull, 0, Range(0, static_cast<uint32_t>(data.trianglesData.size())), data);
-        FALCOR_ASSERT(!data.nodes.empty());
+        const Range rootRange(0, static_cast<uint32_t>(trianglesData.size()));
+        std::vector<TopLevelNode> topLevelNodes;
+        std::vector<SubtreeTask> tasks;
+        if (mOptions.useParallelBuild)
+        {
+            BuildingData data(trianglesData);
+            buildTopLevel(mOptions, splitFunc, 0, rootRange, data, topLevelNodes, tasks);
+        }
+        else
+        {
+            topLevelNodes.emplace_back().taskIndex = 0;
+            tasks.emplace_back(rootRange, 0);
+        }
+
+        auto buildSubtree = [&](SubtreeTask& task)
+        {
+            try
+            {
+                BuildingData data(trianglesData);
+                // To be grossly conservative, assume each triangle requires two nodes.
+                // This is only system RAM and shouldn't be that much, so it's not worth being more careful about it.
+                data.nodes.reserve(2 * task.triangleRange.length());
+                data.triangleIndices.reserve(task.triangleRange.length());
+                buildInternal(mOptions, splitFunc, task.depth, task.triangleRange, data);
+                task.nodes = std::move(data.nodes);
+                task.triangleIndices = std::move(data.triangleIndices);
+            }
+            catch (...)
+            {
+                task.exception = std::current_exception();
+            }
+        };
+        if (mOptions.useParallelBuild) std::for_each(std::execution::par, tasks.begin(), tasks.end(), buildSubtree);
+        else std::for_each(tasks.begin(), tasks.end(), buildSubtree);
+
+        for (const SubtreeTask& task : tasks)
+        {
+            if (task.exception) std::rethrow_exception(task.exception);
+        }
+
+        // Write the nodes in depth-first order.
+        nodes.reserve(2 * trianglesData.size());
+        triangleIndices.reserve(trianglesData.size());
+        gatherNodes(topLevelNodes, tasks, 0, nodes, triangleIndices);
+        FALCOR_ASSERT(!nodes.empty());
+        FALCOR_ASSERT(triangleIndices.size() == trianglesData.size());
+
+        const uint64_t invalidBitmask = std::numeric_limits<uint64_t>::max();
+        triangleBitmasks.resize(triangles.size(), invalidBitmask); // This is sized based on input triangle count, as it's indexed by global triangle index.
+        computeTriangleBitmasks(nodes, triangleIndices, mOptions.useParallelBuild, triangleBitmasks);
 
         size_t numValid = 0;
-        for (auto mask : data.triangleBitmasks)
+        for (auto mask : triangleBitmasks)
             if (mask != invalidBitmask) numValid++;
-        FALCOR_ASSERT(numValid == data.trianglesData.size());
+        FALCOR_ASSERT(numValid == trianglesData.size());
 
         // Compute per-node light bounding cones.
         float cosConeAngle;
-        computeLightingConesInternal(0, data, cosConeAngle);
-
-        // The BVH is ready, mark it as valid and upload the data.
-        bvh.mIsValid = true;
-        bvh.mMaxTriangleCountPerLeaf = mOptions.maxTriangleCountPerLeaf;
-        bvh.uploadCPUBuffers(data.triangleIndices, data.triangleBitmasks);
+        computeLightingConesInternal(0, nodes, cosConeAngle);
 
-        // Computate metadata.
-        bvh.finalize();
+        return true;
     }
 
     bool LightBVHBuilder::renderUI(Gui::Widgets& widget)
@@ -319,8 +470,22 @@ namespace Falcor
         bool optionsChanged = false;
 
         optionsChanged |= widget.checkbox("Allow refitting", options.allowRefitting);
+        if (options.allowRefitting)
+        {
+            optionsChanged |= widget.checkbox("CPU refit", options.useCPURefit);
+            widget.tooltip("Refit the BVH on the CPU instead of the GPU. This allows tracking the SAOH cost growth since the last rebuild.");
+            if (options.useCPURefit)
+            {
+                optionsChanged |= widget.var("Max refit cost ratio", options.maxRefitCostRatio, 0.f, 100.f, 0.1f);
+                widget.tooltip("Rebuild the BVH when refitting has increased its SAOH cost by more than this factor since the last rebuild. Set to zero to never rebuild.");
+            }
+        }
+        optionsChanged |= widget.checkbox("Parallel build", options.useParallelBuild);
+        widget.tooltip("Build independent subtrees in parallel. The resulting BVH is identical to the one built serially.");
         optionsChanged |= widget.var("Max triangle count per leaf", options.maxTriangleCountPerLeaf, 1u, kMaxLeafTriangleCount);
         optionsChanged |= widget.dropdown("Split heuristic", options.splitHeuristicSelection);
+        optionsChanged |= widget.dropdown("Node width", options.nodeWidth);
+        widget.tooltip("Number of children per node of the BVH used for sampling. Wide BVHs are collapsed from the binary BVH and are shallower to traverse.");
 
         if (auto splitGroup = widget.group("Split Options", true))
         {
@@ -349,17 +514,27 @@ namespace Falcor
         return optionsChanged;
     }
 
-    uint32_t LightBVHBuilder::buildInternal(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data)
+    LightBVHBuilder::SplitResult LightBVHBuilder::splitNode(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint32_t depth, const Range& triangleRange, BuildingData& data, AABB& nodeBounds, float& nodeFlux)
     {
         FALCOR_ASSERT(triangleRange.begin < triangleRange.end);
+        TriangleSortData& trianglesData = data.trianglesData;
 
         // Compute the AABB and total flux of the node.
-        float nodeFlux = 0.f;
-        AABB nodeBounds;
+        nodeFlux = 0.f;
+        nodeBounds = AABB();
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            const float* boundsMin = trianglesData.boundsMin[axis].data();
+            const float* boundsMax = trianglesData.boundsMax[axis].data();
+            for (uint32_t dataIndex = triangleRange.begin; dataIndex < triangleRange.end; ++dataIndex)
+            {
+                nodeBounds.minPoint[axis] = math::min(nodeBounds.minPoint[axis], boundsMin[dataIndex]);
+                nodeBounds.maxPoint[axis] = math::max(nodeBounds.maxPoint[axis], boundsMax[dataIndex]);
+            }
+        }
         for (uint32_t dataIndex = triangleRange.begin; dataIndex < triangleRange.end; ++dataIndex)
         {
-            nodeBounds |= data.trianglesData[dataIndex].bounds;
-            nodeFlux += data.trianglesData[dataIndex].flux;
+            nodeFlux += trianglesData.flux[dataIndex];
         }
         FALCOR_ASSERT(nodeBounds.valid());
 
@@ -367,16 +542,73 @@ namespace Falcor
 
         bool trySplitting = triangleRange.length() > (options.createLeavesASAP ? options.maxTriangleCountPerLeaf : 1);
         const SplitResult splitResult = trySplitting ? splitHeuristic(data, triangleRange, nodeBounds, options) : SplitResult();
+        if (!splitResult.isValid()) return splitResult;
 
-        // If we should split, then create an internal node and split.
-        if (splitResult.isValid())
+        FALCOR_ASSERT(triangleRange.begin < splitResult.triangleIndex && splitResult.triangleIndex < triangleRange.end);
+
+        if (depth >= kMaxBVHDepth)
+        {
+            // This is an unrecoverable error since we use bit masks to represent the traversal path from
+            // the root node to each leaf node in the tree, which is necessary for pdf computation with MIS.
+            FALCOR_THROW("BVH depth of {} reached. Maximum of {} allowed.", depth + 1, kMaxBVHDepth);
+        }
+
+        // Sort the centroids and update the lists accordingly.
+        // The partition is computed on a list of indices and then applied to all the arrays.
+        auto& indices = data.sortIndices;
+        indices.resize(triangleRange.length());
+        std::iota(indices.begin(), indices.end(), triangleRange.begin);
+        const float* centers = trianglesData.center[splitResult.axis].data();
+        auto comp = [centers](uint32_t i1, uint32_t i2) { return centers[i1] < centers[i2]; };
+        std::nth_element(indices.begin(), indices.begin() + (splitResult.triangleIndex - triangleRange.begin), indices.end(), comp);
+
+        std::vector<float>* floatArrays[] =
         {
-            FALCOR_ASSERT(triangleRange.begin < splitResult.triangleIndex && splitResult.triangleIndex < triangleRange.end);
+            &trianglesData.center[0], &trianglesData.center[1], &trianglesData.center[2],
+            &trianglesData.boundsMin[0], &trianglesData.boundsMin[1], &trianglesData.boundsMin[2],
+            &trianglesData.boundsMax[0], &trianglesData.boundsMax[1], &trianglesData.boundsMax[2],
+            &trianglesData.coneDirection[0], &trianglesData.coneDirection[1], &trianglesData.coneDirection[2],
+            &trianglesData.cosConeAngle, &trianglesData.flux,
+        };
+        const uint32_t floatArrayCount = (uint32_t)std::size(floatArrays);
+
+        if (data.parallelSplit)
+        {
+            NumericRange<uint32_t> arrayRange(0, floatArrayCount + 1);
+            std::for_each(std::execution::par, arrayRange.begin(), arrayRange.end(), [&](uint32_t arrayIndex)
+            {
+                if (arrayIndex < floatArrayCount)
+                {
+                    std::vector<float> scratch;
+                    permuteRange(*floatArrays[arrayIndex], triangleRange.begin, indices, scratch);
+                }
+                else
+                {
+                    std::vector<uint32_t> scratch;
+                    permuteRange(trianglesData.triangleIndex, triangleRange.begin, indices, scratch);
+                }
+            });
+        }
+        else
+        {
+            for (std::vector<float>* pValues : floatArrays) permuteRange(*pValues, triangleRange.begin, indices, data.floatScratch);
+            permuteRange(trianglesData.triangleIndex, triangleRange.begin, indices, data.indexScratch);
+        }
+
+        return splitResult;
+    }
 
-            // Sort the centroids and update the lists accordingly.
-            auto comp = [dim = splitResult.axis](const TriangleSortData& d1, const TriangleSortData& d2) { return d1.bounds.center()[dim] < d2.bounds.center()[dim]; };
-            std::nth_element(std::begin(data.trianglesData) + triangleRange.begin, std::begin(data.trianglesData) + splitResult.triangleIndex, std::begin(data.trianglesData) + triangleRange.end, comp);
+    uint32_t LightBVHBuilder::buildInternal(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint32_t depth, const Range& triangleRange, BuildingData& data) const
+    {
+        FALCOR_ASSERT(triangleRange.begin < triangleRange.end);
+
+        AABB nodeBounds;
+        float nodeFlux = 0.f;
+        const SplitResult splitResult = splitNode(options, splitHeuristic, depth, triangleRange, data, nodeBounds, nodeFlux);
 
+        // If we should split, then create an internal node and split.
+        if (splitResult.isValid())
+        {
             // Allocate internal node.
             FALCOR_ASSERT(data.nodes.size() < std::numeric_limits<uint32_t>::max());
             const uint32_t nodeIndex = (uint32_t)data.nodes.size();
@@ -387,15 +619,8 @@ namespace Falcor
             node.attribs.flux = nodeFlux;
             // The lighting normal bounding cone will be computed later when all leaf nodes have been created.
 
-            if (depth >= kMaxBVHDepth)
-            {
-                // This is an unrecoverable error since we use bit masks to represent the traversal path from
-                // the root node to each leaf node in the tree, which is necessary for pdf computation with MIS.
-                FALCOR_THROW("BVH depth of {} reached. Maximum of {} allowed.", depth + 1, kMaxBVHDepth);
-            }
-
-            uint32_t leftIndex = buildInternal(options, splitHeuristic, bitmask | (0ull << depth), depth + 1, Range(triangleRange.begin, splitResult.triangleIndex), data);
-            uint32_t rightIndex = buildInternal(options, splitHeuristic, bitmask | (1ull << depth), depth + 1, Range(splitResult.triangleIndex, triangleRange.end), data);
+            uint32_t leftIndex = buildInternal(options, splitHeuristic, depth + 1, Range(triangleRange.begin, splitResult.triangleIndex), data);
+            uint32_t rightIndex = buildInternal(options, splitHeuristic, depth + 1, Range(splitResult.triangleIndex, triangleRange.end), data);
 
             FALCOR_ASSERT(leftIndex == nodeIndex + 1); // The left node should always be placed immediately after the current node.
             node.rightChildIdx = rightIndex;
@@ -424,12 +649,8 @@ namespace Falcor
             FALCOR_ASSERT(node.triangleCount < kMaxLeafTriangleCount);
             FALCOR_ASSERT(node.triangleOffset < kMaxLeafTriangleOffset);
 
-            for (uint32_t triangleIdx = triangleRange.begin, index = 0; triangleIdx < triangleRange.end; ++triangleIdx, ++index)
-            {
-                uint32_t globalTriangleIndex = data.trianglesData[triangleIdx].triangleIndex;
-                data.triangleIndices.push_back(globalTriangleIndex);
-                data.triangleBitmasks[globalTriangleIndex] = bitmask;
-            }
+            // The per triangle bitmasks are computed once the whole tree is done.
+            data.triangleIndices.insert(data.triangleIndices.end(), data.trianglesData.triangleIndex.begin() + triangleRange.begin, data.trianglesData.triangleIndex.begin() + triangleRange.end);
             FALCOR_ASSERT(data.triangleIndices.size() == node.triangleOffset + node.triangleCount);
 
             data.nodes[nodeIndex].setLeafNode(node);
@@ -437,19 +658,421 @@ namespace Falcor
         }
     }
 
-    float3 LightBVHBuilder::computeLightingConesInternal(const uint32_t nodeIndex, BuildingData& data, float& cosConeAngle)
+    uint32_t LightBVHBuilder::buildTopLevel(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint32_t depth, const Range& triangleRange, BuildingData& data, std::vector<TopLevelNode>& topLevelNodes, std::vector<SubtreeTask>& tasks) const
+    {
+        FALCOR_ASSERT(triangleRange.begin < triangleRange.end);
+
+        const uint32_t topLevelIndex = (uint32_t)topLevelNodes.size();
+        topLevelNodes.push_back({});
+
+        auto createTask = [&]()
+        {
+            topLevelNodes[topLevelIndex].taskIndex = (uint32_t)tasks.size();
+            tasks.emplace_back(triangleRange, depth);
+            return topLevelIndex;
+        };
+
+        // Small ranges are built as independent subtrees.
+        if (triangleRange.length() < kMinParallelSubtreeTriangleCount) return createTask();
+
+        AABB nodeBounds;
+        float nodeFlux = 0.f;
+        data.parallelSplit = triangleRange.length() >= kMinParallelSplitTriangleCount;
+        const SplitResult splitResult = splitNode(options, splitHeuristic, depth, triangleRange, data, nodeBounds, nodeFlux);
+
+        // Let the subtree task create the leaf node if the range is not split.
+        if (!splitResult.isValid()) return createTask();
+
+        topLevelNodes[topLevelIndex].bounds = nodeBounds;
+        topLevelNodes[topLevelIndex].flux = nodeFlux;
+
+        uint32_t leftIndex = buildTopLevel(options, splitHeuristic, depth + 1, Range(triangleRange.begin, splitResult.triangleIndex), data, topLevelNodes, tasks);
+        uint32_t rightIndex = buildTopLevel(options, splitHeuristic, depth + 1, Range(splitResult.triangleIndex, triangleRange.end), data, topLevelNodes, tasks);
+
+        topLevelNodes[topLevelIndex].leftIndex = leftIndex;
+        topLevelNodes[topLevelIndex].rightIndex = rightIndex;
+        return topLevelIndex;
+    }
+
+    uint32_t LightBVHBuilder::gatherNodes(const std::vector<TopLevelNode>& topLevelNodes, const std::vector<SubtreeTask>& tasks, uint32_t topLevelIndex, std::vector<PackedNode>& nodes, std::vector<uint32_t>& triangleIndices)
     {
-        if (!data.nodes[nodeIndex].isLeaf())
+        const TopLevelNode& topLevelNode = topLevelNodes[topLevelIndex];
+
+        FALCOR_ASSERT(nodes.size() < std::numeric_limits<uint32_t>::max());
+        const uint32_t nodeIndex = (uint32_t)nodes.size();
+
+        if (topLevelNode.isSubtree())
         {
-            auto node = data.nodes[nodeIndex].getInternalNode();
+            // Append the subtree and relocate its child indices and triangle offsets.
+            const SubtreeTask& task = tasks[topLevelNode.taskIndex];
+            const uint32_t triangleOffset = (uint32_t)triangleIndices.size();
+            nodes.insert(nodes.end(), task.nodes.begin(), task.nodes.end());
+            for (size_t i = nodeIndex; i < nodes.size(); ++i) relocateNode(nodes[i], nodeIndex, triangleOffset);
+            triangleIndices.insert(triangleIndices.end(), task.triangleIndices.begin(), task.triangleIndices.end());
+            return nodeIndex;
+        }
+
+        // Allocate internal node.
+        nodes.push_back({});
+
+        InternalNode node = {};
+        node.attribs.setAABB(topLevelNode.bounds.minPoint, topLevelNode.bounds.maxPoint);
+        node.attribs.flux = topLevelNode.flux;
+
+        uint32_t leftIndex = gatherNodes(topLevelNodes, tasks, topLevelNode.leftIndex, nodes, triangleIndices);
+        uint32_t rightIndex = gatherNodes(topLevelNodes, tasks, topLevelNode.rightIndex, nodes, triangleIndices);
+
+        FALCOR_ASSERT(leftIndex == nodeIndex + 1); // The left node should always be placed immediately after the current node.
+        node.rightChildIdx = rightIndex;
+
+        nodes[nodeIndex].setInternalNode(node);
+        return nodeIndex;
+    }
+
+    void LightBVHBuilder::computeTriangleBitmasks(const std::vector<PackedNode>& nodes, const std::vector<uint32_t>& triangleIndices, bool parallel, std::vector<uint64_t>& triangleBitmasks)
+    {
+        struct NodeLocation
+        {
+            uint32_t nodeIndex;
+            uint32_t depth;
+            uint64_t bitmask;
+        };
+
+        // Collect all leaf nodes along with the bit pattern retracing the tree traversal to reach them: 0=left child, 1=right child.
+        std::vector<NodeLocation> leaves;
+        std::vector<NodeLocation> stack = { NodeLocation{ 0, 0, 0ull } };
+        while (!stack.empty())
+        {
+            const NodeLocation location = stack.back();
+            stack.pop_back();
+
+            if (nodes[location.nodeIndex].isLeaf())
+            {
+                leaves.push_back(location);
+            }
+            else
+            {
+                FALCOR_ASSERT(location.depth < kMaxBVHDepth);
+                const uint32_t rightIndex = nodes[location.nodeIndex].getInternalNode().rightChildIdx;
+                stack.push_back(NodeLocation{ location.nodeIndex + 1, location.depth + 1, location.bitmask | (0ull << location.depth) });
+                stack.push_back(NodeLocation{ rightIndex, location.depth + 1, location.bitmask | (1ull << location.depth) });
+            }
+        }
+
+        // Each triangle is referenced by a single leaf, so the leaves can be processed independently.
+        auto writeBitmasks = [&](const NodeLocation& location)
+        {
+            const LeafNode node = nodes[location.nodeIndex].getLeafNode();
+            for (uint32_t i = 0; i < node.triangleCount; ++i)
+            {
+                triangleBitmasks[triangleIndices[node.triangleOffset + i]] = location.bitmask;
+            }
+        };
+        if (parallel) std::for_each(std::execution::par, leaves.begin(), leaves.end(), writeBitmasks);
+        else std::for_each(leaves.begin(), leaves.end(), writeBitmasks);
+    }
+
+    void LightBVHBuilder::collapseNodes(const std::vector<PackedNode>& nodes, uint32_t width, std::vector<PackedWideNodeGroup>& wideNodes, std::vector<uint32_t>& wideChildNodeIndices)
+    {
+        FALCOR_CHECK(width == 4 || width == 8, "Unsupported light BVH node width ({})", width);
+        FALCOR_ASSERT(!nodes.empty());
+
+        const uint32_t kChildCount = PackedWideNodeGroup::kChildCount;
+        const uint32_t groupCount = width / kChildCount;
+
+        // Compute the height of each binary subtree. The nodes are stored in depth-first order, so the children of a node are located after it.
+        // Note that the first dword of an internal node is the index of its right child.
+        std::vector<uint32_t> heights(nodes.size(), 0);
+        for (size_t i = nodes.size(); i-- > 0;)
+        {
+            if (!nodes[i].isLeaf()) heights[i] = 1 + std::max(heights[i + 1], heights[nodes[i].data[0].x]);
+        }
+
+        struct WideNodeLocation
+        {
+            uint32_t nodeIndex;         ///< Index of the binary node the wide node is collapsed from.
+            uint32_t wideNodeIndex;     ///< Index of the first group of the wide node.
+        };
+
+        wideNodes.clear();
+        wideNodes.reserve(groupCount * (nodes.size() / (width - 1) + 1));
+        wideNodes.resize(groupCount);
+        wideChildNodeIndices.clear();
+        wideChildNodeIndices.resize(groupCount * kChildCount, uint32_t(PackedWideNodeGroup::kInvalidChild));
+
+        std::vector<WideNodeLocation> stack = { WideNodeLocation{ 0, 0 } };
+        std::vector<uint32_t> children;
+        children.reserve(width);
+        while (!stack.empty())
+        {
+            const WideNodeLocation location = stack.back();
+            stack.pop_back();
+
+            // Gather the children of the wide node, keeping them in depth-first order.
+            // The root node is the only binary node that can be a leaf here, in which case the wide root has a single child.
+            children.clear();
+            if (nodes[location.nodeIndex].isLeaf())
+            {
+                children.push_back(location.nodeIndex);
+            }
+            else
+            {
+                children.push_back(location.nodeIndex + 1);
+                children.push_back(nodes[location.nodeIndex].data[0].x);
+            }
+
+            while (children.size() < width)
+            {
+                size_t expandIndex = children.size();
+                for (size_t i = 0; i < children.size(); ++i)
+                {
+                    if (nodes[children[i]].isLeaf()) continue;
+                    if (expandIndex == children.size() || heights[children[i]] > heights[children[expandIndex]]) expandIndex = i;
+                }
+                if (expandIndex == children.size()) break; // All children are leaves.
+
+                const uint32_t nodeIndex = children[expandIndex];
+                children[expandIndex] = nodeIndex + 1;
+                children.insert(children.begin() + expandIndex + 1, nodes[nodeIndex].data[0].x);
+            }
+
+            // Write the children. Internal children are allocated at the end of the list and processed later.
+            for (uint32_t slot = 0; slot < width; ++slot)
+            {
+                const uint32_t groupIndex = location.wideNodeIndex + slot / kChildCount;
+                const uint32_t lane = slot % kChildCount;
+
+                if (slot >= children.size())
+                {
+                    wideNodes[groupIndex].setInvalid(lane);
+                    continue;
+                }
+
+                const uint32_t childIndex = children[slot];
+                uint32_t childRef = nodes[childIndex].data[0].x;
+                if (!nodes[childIndex].isLeaf())
+                {
+                    childRef = static_cast<uint32_t>(wideNodes.size());
+                    if (childRef + groupCount >= PackedWideNodeGroup::kInvalidChild)
+                    {
+                        FALCOR_THROW("Wide light BVH node count exceeds the maximum supported ({})", uint32_t(PackedWideNodeGroup::kInvalidChild));
+                    }
+                    wideNodes.resize(wideNodes.size() + groupCount);
+                    wideChildNodeIndices.resize(wideNodes.size() * kChildCount, uint32_t(PackedWideNodeGroup::kInvalidChild));
+                    stack.push_back(WideNodeLocation{ childIndex, childRef });
+                }
+                wideNodes[groupIndex].setChild(lane, nodes[childIndex], childRef);
+                wideChildNodeIndices[groupIndex * kChildCount + lane] = childIndex;
+            }
+        }
+        FALCOR_ASSERT(wideChildNodeIndices.size() == wideNodes.size() * kChildCount);
+    }
+
+    void LightBVHBuilder::computeWideTriangleBitmasks(const std::vector<PackedWideNodeGroup>& wideNodes, uint32_t width, const std::vector<uint32_t>& triangleIndices, std::vector<uint64_t>& triangleBitmasks)
+    {
+        FALCOR_CHECK(width == 4 || width == 8, "Unsupported light BVH node width ({})", width);
+        FALCOR_ASSERT(!wideNodes.empty());
+
+        const uint32_t kChildCount = PackedWideNodeGroup::kChildCount;
+        const uint32_t bitsPerLevel = width == 4 ? 2 : 3;
+        const uint32_t maxDepth = kMaxBVHDepth / bitsPerLevel;
+
+        struct NodeLocation
+        {
+            uint32_t wideNodeIndex;
+            uint32_t depth;
+            uint64_t bitmask;
+        };
+
+        // Collect all leaf nodes along with the bit pattern retracing the tree traversal to reach them.
+        std::vector<std::pair<LeafNode, uint64_t>> leaves;
+        std::vector<NodeLocation> stack = { NodeLocation{ 0, 0, 0ull } };
+        while (!stack.empty())
+        {
+            const NodeLocation location = stack.back();
+            stack.pop_back();
+
+            if (location.depth >= maxDepth)
+            {
+                FALCOR_THROW("Wide light BVH depth exceeds the maximum supported ({})", maxDepth);
+            }
+
+            for (uint32_t slot = 0; slot < width; ++slot)
+            {
+                const PackedWideNodeGroup& group = wideNodes[location.wideNodeIndex + slot / kChildCount];
+                const uint32_t lane = slot % kChildCount;
+                if (!group.isValid(lane)) continue;
+
+                const uint64_t bitmask = location.bitmask | (uint64_t(slot) << (location.depth * bitsPerLevel));
+                if (group.isLeaf(lane)) leaves.emplace_back(group.getChild(lane).getLeafNode(), bitmask);
+                else stack.push_back(NodeLocation{ group.getChildNodeIndex(lane), location.depth + 1, bitmask });
+            }
+        }
+
+        // Each triangle is referenced by a single leaf, so the leaves can be processed independently.
+        auto writeBitmasks = [&](const std::pair<LeafNode, uint64_t>& leaf)
+        {
+            for (uint32_t i = 0; i < leaf.first.triangleCount; ++i)
+            {
+                triangleBitmasks[triangleIndices[leaf.first.triangleOffset + i]] = leaf.second;
+            }
+        };
+        std::for_each(std::execution::par, leaves.begin(), leaves.end(), writeBitmasks);
+    }
+
+    void LightBVHBuilder::refitNodes(const std::vector<LightCollection::MeshLightTriangle>& triangles, const std::vector<uint32_t>& triangleIndices, bool parallel, std::vector<PackedNode>& nodes)
+    {
+        FALCOR_ASSERT(!nodes.empty());
+
+        // Sort the nodes by depth. The nodes are stored in depth-first order, so the depth of a node is known before it is visited.
+        // Note that the first dword of an internal node is the index of its right child.
+        std::vector<uint32_t> depths(nodes.size(), 0);
+        std::vector<uint32_t> leafIndices;
+        std::vector<std::vector<uint32_t>> internalIndicesPerDepth;
+        for (uint32_t nodeIndex = 0; nodeIndex < nodes.size(); ++nodeIndex)
+        {
+            if (nodes[nodeIndex].isLeaf())
+            {
+                leafIndices.push_back(nodeIndex);
+                continue;
+            }
+
+            const uint32_t depth = depths[nodeIndex];
+            if (internalIndicesPerDepth.size() <= depth) internalIndicesPerDepth.resize(depth + 1);
+            internalIndicesPerDepth[depth].push_back(nodeIndex);
+            depths[nodeIndex + 1] = depths[nodes[nodeIndex].data[0].x] = depth + 1;
+        }
+
+        // The code below follows LightBVHRefit.cs.slang. The nodes of a level only depend on the level below,
+        // so the result does not depend on the order in which the nodes of a level are processed.
+        auto refitLeaf = [&](uint32_t nodeIndex)
+        {
+            LeafNode node = nodes[nodeIndex].getLeafNode();
+
+            // Update the node bounding box.
+            AABB bounds;
+            float3 normalsSum = float3(0.f);
+            for (uint32_t i = 0; i < node.triangleCount; ++i)
+            {
+                const auto& triangle = triangles[triangleIndices[node.triangleOffset + i]];
+                for (uint32_t j = 0; j < 3; ++j)
+                {
+                    bounds.include(triangle.vtx[j].pos);
+                }
+                normalsSum += triangle.normal;
+            }
+            node.attribs.setAABB(bounds.minPoint, bounds.maxPoint);
+
+            // Update the normal bounding cone.
+            const float coneDirectionLength = length(normalsSum);
+            float3 coneDirection = float3(0.f);
+            float cosConeAngle = kInvalidCosConeAngle;
+            if (coneDirectionLength >= FLT_MIN)
+            {
+                coneDirection = normalsSum / coneDirectionLength;
+                cosConeAngle = 1.f;
+                for (uint32_t i = 0; i < node.triangleCount; ++i)
+                {
+                    const auto& triangle = triangles[triangleIndices[node.triangleOffset + i]];
+                    cosConeAngle = std::min(cosConeAngle, dot(coneDirection, triangle.normal));
+                }
+                cosConeAngle = std::max(cosConeAngle, -1.f); // Guard against numerical errors
+            }
+            node.attribs.cosConeAngle = cosConeAngle;
+            node.attribs.coneDirection = coneDirection;
+
+            nodes[nodeIndex].setLeafNode(node);
+        };
+
+        auto refitInternal = [&](uint32_t nodeIndex)
+        {
+            InternalNode node = nodes[nodeIndex].getInternalNode();
+            SharedNodeAttributes leftNode = nodes[nodeIndex + 1].getNodeAttributes();
+            SharedNodeAttributes rightNode = nodes[node.rightChildIdx].getNodeAttributes();
+
+            // Update the node bounding box.
+            float3 leftAabbMin, leftAabbMax;
+            float3 rightAabbMin, rightAabbMax;
+            leftNode.getAABB(leftAabbMin, leftAabbMax);
+            rightNode.getAABB(rightAabbMin, rightAabbMax);
+            node.attribs.setAABB(min(leftAabbMin, rightAabbMin), max(leftAabbMax, rightAabbMax));
+
+            // Update the normal bounding cone.
+            const float3 coneDirectionSum = leftNode.coneDirection + rightNode.coneDirection;
+            const float coneDirectionLength = length(coneDirectionSum);
+            float3 coneDirection = float3(0.f);
+            float cosConeAngle = kInvalidCosConeAngle;
+            if (coneDirectionLength >= FLT_MIN)
+            {
+                coneDirection = coneDirectionSum / coneDirectionLength;
+                if (leftNode.cosConeAngle != kInvalidCosConeAngle && rightNode.cosConeAngle != kInvalidCosConeAngle)
+                {
+                    // Rotate the direction of each child's cone away from the new cone direction by the child's cone spread angle.
+                    const float cosLeftDiffAngle = dot(coneDirection, leftNode.coneDirection);
+                    const float sinLeftDiffAngle = sinFromCos(cosLeftDiffAngle);
+                    const float cosRightDiffAngle = dot(coneDirection, rightNode.coneDirection);
+                    const float sinRightDiffAngle = sinFromCos(cosRightDiffAngle);
+
+                    const float sinLeftConeAngle = sinFromCos(leftNode.cosConeAngle);
+                    const float sinRightConeAngle = sinFromCos(rightNode.cosConeAngle);
+
+                    const float sinLeftTotalAngle = sinLeftConeAngle * cosLeftDiffAngle + sinLeftDiffAngle * leftNode.cosConeAngle;
+                    const float sinRightTotalAngle = sinRightConeAngle * cosRightDiffAngle + sinRightDiffAngle * rightNode.cosConeAngle;
+
+                    // If either sum of angles is greater than pi, the cone would represent the whole sphere and is deactivated.
+                    if (sinLeftTotalAngle > 0.f && sinRightTotalAngle > 0.f)
+                    {
+                        const float cosLeftTotalAngle = leftNode.cosConeAngle * cosLeftDiffAngle - sinLeftConeAngle * sinLeftDiffAngle;
+                        const float cosRightTotalAngle = rightNode.cosConeAngle * cosRightDiffAngle - sinRightConeAngle * sinRightDiffAngle;
+                        cosConeAngle = std::max(std::min(cosLeftTotalAngle, cosRightTotalAngle), -1.f);
+                    }
+                }
+            }
+            node.attribs.cosConeAngle = cosConeAngle;
+            node.attribs.coneDirection = coneDirection;
+
+            nodes[nodeIndex].setInternalNode(node);
+        };
+
+        // Refit the leaf nodes first, then the internal nodes level by level from the bottom up.
+        if (parallel) std::for_each(std::execution::par, leafIndices.begin(), leafIndices.end(), refitLeaf);
+        else std::for_each(leafIndices.begin(), leafIndices.end(), refitLeaf);
+
+        for (size_t depth = internalIndicesPerDepth.size(); depth-- > 0;)
+        {
+            const auto& indices = internalIndicesPerDepth[depth];
+            if (parallel && indices.size() >= kMinParallelRefitNodeCount) std::for_each(std::execution::par, indices.begin(), indices.end(), refitInternal);
+            else std::for_each(indices.begin(), indices.end(), refitInternal);
+        }
+    }
+
+    void LightBVHBuilder::refitWideNodes(const std::vector<PackedNode>& nodes, const std::vector<uint32_t>& wideChildNodeIndices, std::vector<PackedWideNodeGroup>& wideNodes)
+    {
+        FALCOR_ASSERT(wideChildNodeIndices.size() == wideNodes.size() * PackedWideNodeGroup::kChildCount);
+        for (size_t i = 0; i < wideChildNodeIndices.size(); ++i)
+        {
+            const uint32_t nodeIndex = wideChildNodeIndices[i];
+            if (nodeIndex == PackedWideNodeGroup::kInvalidChild) continue;
+
+            PackedWideNodeGroup& group = wideNodes[i / PackedWideNodeGroup::kChildCount];
+            const uint32_t lane = i % PackedWideNodeGroup::kChildCount;
+            group.setChild(lane, nodes[nodeIndex], group.data[0][lane]);
+        }
+    }
+
+    float3 LightBVHBuilder::computeLightingConesInternal(const uint32_t nodeIndex, std::vector<PackedNode>& nodes, float& cosConeAngle)
+    {
+        if (!nodes[nodeIndex].isLeaf())
+        {
+            auto node = nodes[nodeIndex].getInternalNode();
 
             uint32_t leftIndex = nodeIndex + 1;
             uint32_t rightIndex = node.rightChildIdx;
 
             float leftNodeCosConeAngle = kInvalidCosConeAngle;
-            float3 leftNodeConeDirection = computeLightingConesInternal(leftIndex, data, leftNodeCosConeAngle);
+            float3 leftNodeConeDirection = computeLightingConesInternal(leftIndex, nodes, leftNodeCosConeAngle);
             float rightNodeCosConeAngle = kInvalidCosConeAngle;
-            float3 rightNodeConeDirection = computeLightingConesInternal(rightIndex, data, rightNodeCosConeAngle);
+            float3 rightNodeConeDirection = computeLightingConesInternal(rightIndex, nodes, rightNodeCosConeAngle);
 
             // TODO: Asserts in coneUnion
             //float3 coneDirection = coneUnion(leftNodeConeDirection, leftNodeCosConeAngle,
@@ -459,14 +1082,14 @@ namespace Falcor
             // Update bounding cone.
             node.attribs.cosConeAngle = cosConeAngle;
             node.attribs.coneDirection = coneDirection;
-            data.nodes[nodeIndex].setNodeAttributes(node.attribs);
+            nodes[nodeIndex].setNodeAttributes(node.attribs);
 
             return coneDirection;
         }
         else
         {
             // Load bounding cone.
-            auto attribs = data.nodes[nodeIndex].getNodeAttributes();
+            auto attribs = nodes[nodeIndex].getNodeAttributes();
             cosConeAngle = attribs.cosConeAngle;
             return attribs.coneDirection;
         }
@@ -482,7 +1105,7 @@ namespace Falcor
         float3 coneDirectionSum = float3(0.0f);
         for (uint32_t triangleIdx = triangleRange.begin; triangleIdx < triangleRange.end; ++triangleIdx)
         {
-            coneDirectionSum += data.trianglesData[triangleIdx].coneDirection;
+            coneDirectionSum += data.trianglesData.getConeDirection(triangleIdx);
         }
         if (length(coneDirectionSum) >= FLT_MIN)
         {
@@ -490,14 +1113,14 @@ namespace Falcor
             cosTheta = 1.f;
             for (uint32_t triangleIdx = triangleRange.begin; triangleIdx < triangleRange.end; ++triangleIdx)
             {
-                const TriangleSortData& td = data.trianglesData[triangleIdx];
-                cosTheta = computeCosConeAngle(coneDirection, cosTheta, td.coneDirection, td.cosConeAngle);
+                const TriangleSortData& td = data.trianglesData;
+                cosTheta = computeCosConeAngle(coneDirection, cosTheta, td.getConeDirection(triangleIdx), td.cosConeAngle[triangleIdx]);
             }
         }
         return coneDirection;
     }
 
-    LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithEqual(const BuildingData& /*data*/, const Range& triangleRange, const AABB& nodeBounds, const Options& /*parameters*/)
+    LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithEqual(BuildingData& /*data*/, const Range& triangleRange, const AABB& nodeBounds, const Options& /*parameters*/)
     {
         // Find the largest dimension.
         float3 dimensions = nodeBounds.extent();
@@ -524,7 +1147,7 @@ namespace Falcor
         return cost;
     }
 
-    LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithBinnedSAH(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, const Options& parameters)
+    LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithBinnedSAH(BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, const Options& parameters)
     {
         std::pair<float, SplitResult> overallBestSplit = std::make_pair(std::numeric_limits<float>::infinity(), SplitResult());
         FALCOR_ASSERT(!overallBestSplit.second.isValid());
@@ -535,7 +1158,6 @@ namespace Falcor
             uint32_t triangleCount = 0;
 
             Bin() = default;
-            Bin(const TriangleSortData& tri) : bounds(tri.bounds), triangleCount(1) {}
             Bin& operator|= (const Bin& rhs)
             {
                 bounds |= rhs.bounds;
@@ -545,34 +1167,38 @@ namespace Falcor
         };
 
         FALCOR_ASSERT(parameters.binCount > 1);
-        std::vector<Bin> bins(parameters.binCount);
-        std::vector<float> costs(parameters.binCount - 1);
+        const TriangleSortData& trianglesData = data.trianglesData;
 
         /** Helper function that computes the best split along the given dimension using the SAH metric.
             The triangles are binned to n bins, storing only the aggregate parameters (triangle count and bounds).
             Then the cost metric is evaluated for each of the n-1 potential splits.
+            The function only touches the scratch memory of the given dimension, so it can run concurrently for all dimensions.
+            \return The cost and split, or an invalid split if all lights fall on either side of the split.
         */
-        const auto binAlongDimension = [&bins, &costs, &triangleRange, &data, &parameters, &overallBestSplit, &nodeBounds](uint32_t dimension)
+        const auto binAlongDimension = [&](uint32_t dimension)
         {
-            // Helper to compute the bin id for a given triangle.
-            auto getBinId = [&](const TriangleSortData& td)
+            std::vector<Bin> bins(parameters.binCount);
+            std::vector<float> costs(parameters.binCount - 1);
+
+            // Compute the bin id for all triangles. This loop runs over contiguous arrays and is vectorized.
+            const float bmin = nodeBounds.minPoint[dimension], bmax = nodeBounds.maxPoint[dimension];
+            FALCOR_ASSERT(bmin < bmax);
+            const float scale = (float)parameters.binCount / (bmax - bmin);
+            const uint32_t maxBinId = parameters.binCount - 1;
+            const float* centers = trianglesData.center[dimension].data() + triangleRange.begin;
+            std::vector<uint32_t>& binIds = data.binIds[dimension];
+            binIds.resize(triangleRange.length());
+            for (uint32_t i = 0; i < triangleRange.length(); ++i)
             {
-                float bmin = nodeBounds.minPoint[dimension], bmax = nodeBounds.maxPoint[dimension];
-                FALCOR_ASSERT(bmin < bmax);
-                float scale = (float)parameters.binCount / (bmax - bmin);
-                float p = td.bounds.center()[dimension];
-                FALCOR_ASSERT(bmin <= p && p <= bmax);
-                return std::min((uint32_t)((p - bmin) * scale), parameters.binCount - 1);
-            };
-
-            // Reset the bins.
-            for (Bin& bin : bins) bin = Bin();
+                binIds[i] = std::min((uint32_t)((centers[i] - bmin) * scale), maxBinId);
+            }
 
             // Fill the bins with all triangles.
-            for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
+            for (uint32_t i = 0; i < triangleRange.length(); ++i)
             {
-                const auto& td = data.trianglesData[i];
-                bins[getBinId(td)] |= td;
+                Bin& bin = bins[binIds[i]];
+                bin.bounds |= trianglesData.getBounds(triangleRange.begin + i);
+                bin.triangleCount++;
             }
 
             // First, compute A_j(L) * N_j(L) by sweeping over the bins from left to right.
@@ -606,9 +1232,15 @@ namespace Falcor
 
             // Early out if all lights fall on either side of the split.
             if (axisBestSplit.second.triangleIndex == triangleRange.begin ||
-                axisBestSplit.second.triangleIndex == triangleRange.end) return;
+                axisBestSplit.second.triangleIndex == triangleRange.end) return std::make_pair(std::numeric_limits<float>::infinity(), SplitResult());
+
+            return axisBestSplit;
+        };
 
-            if (axisBestSplit.first < overallBestSplit.first)
+        // Keep the cheapest split. The dimensions are visited in order so that ties are resolved the same way regardless of how they were evaluated.
+        const auto selectSplit = [&](const std::pair<float, SplitResult>& axisBestSplit)
+        {
+            if (axisBestSplit.second.isValid() && axisBestSplit.first < overallBestSplit.first)
             {
                 overallBestSplit = axisBestSplit;
                 FALCOR_ASSERT(triangleRange.begin < overallBestSplit.second.triangleIndex && overallBestSplit.second.triangleIndex < triangleRange.end);
@@ -622,13 +1254,19 @@ namespace Falcor
             uint32_t largestDimension = dimensions[2] >= dimensions[0] && dimensions[2] >= dimensions[1] ?
                 2 : (dimensions[1] >= dimensions[0] && dimensions[1] >= dimensions[2] ? 1 : 0);
 
-            binAlongDimension(largestDimension);
+            selectSplit(binAlongDimension(largestDimension));
         }
         else
         {
+            std::pair<float, SplitResult> axisBestSplits[3];
+            NumericRange<uint32_t> dimensionRange(0, 3);
+            auto evalDimension = [&](uint32_t dimension) { axisBestSplits[dimension] = binAlongDimension(dimension); };
+            if (data.parallelSplit) std::for_each(std::execution::par, dimensionRange.begin(), dimensionRange.end(), evalDimension);
+            else std::for_each(dimensionRange.begin(), dimensionRange.end(), evalDimension);
+
             for (uint32_t dimension = 0; dimension < 3; ++dimension)
             {
-                binAlongDimension(dimension);
+                selectSplit(axisBestSplits[dimension]);
             }
         }
 
@@ -679,7 +1317,7 @@ namespace Falcor
         return cost;
     }
 
-    LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithBinnedSAOH(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, const Options& parameters)
+    LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithBinnedSAOH(BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, const Options& parameters)
     {
         std::pair<float, SplitResult> overallBestSplit = std::make_pair(std::numeric_limits<float>::infinity(), SplitResult());
         FALCOR_ASSERT(!overallBestSplit.second.isValid());
@@ -698,7 +1336,6 @@ namespace Falcor
             float cosConeAngle = 1.0f;
 
             Bin() = default;
-            Bin(const TriangleSortData& tri) : bounds(tri.bounds), triangleCount(1), flux(tri.flux), coneDirection(tri.coneDirection), cosConeAngle(tri.cosConeAngle) {}
             Bin& operator|= (const Bin& rhs)
             {
                 bounds |= rhs.bounds;
@@ -711,8 +1348,7 @@ namespace Falcor
         };
 
         FALCOR_ASSERT(parameters.binCount > 1);
-        std::vector<Bin> bins(parameters.binCount);
-        std::vector<float> costs(parameters.binCount - 1);
+        const TriangleSortData& trianglesData = data.trianglesData;
 
         /** Helper function that computes the best split along the given dimension using the SAOH metric.
             The triangles are binned to n bins, storing only the aggregate parameters (triangle count, bounds, flux, and cone direction).
@@ -720,29 +1356,37 @@ namespace Falcor
             Note that while the bounds and flux are accurately represented by the aggregated parameters,
             the bounding cones are approximates based on the bins' bounding cones. This is less expensive,
             but also less precise than computing them directly from the triangles.
+            The function only touches the scratch memory of the given dimension, so it can run concurrently for all dimensions.
+            \return The cost and split, or an invalid split if all lights fall on either side of the split.
         */
-        const auto binAlongDimension = [&bins, &costs, &triangleRange, &data, &parameters, &overallBestSplit, &nodeBounds, largestDimension, dimensions](uint32_t dimension)
+        const auto binAlongDimension = [&](uint32_t dimension)
         {
-            // Helper to compute the bin id for a given triangle.
-            auto getBinId = [&](const TriangleSortData& td)
+            std::vector<Bin> bins(parameters.binCount);
+            std::vector<float> costs(parameters.binCount - 1);
+
+            // Compute the bin id for all triangles. This loop runs over contiguous arrays and is vectorized.
+            const float bmin = nodeBounds.minPoint[dimension], bmax = nodeBounds.maxPoint[dimension];
+            const float w = bmax - bmin;
+            FALCOR_ASSERT(w >= 0.f); // The node bounds can be zero if all primitives are axis-aligned and coplanar
+            const float scale = w > FLT_MIN ? (float)parameters.binCount / w : 0.f;
+            const uint32_t maxBinId = parameters.binCount - 1;
+            const float* centers = trianglesData.center[dimension].data() + triangleRange.begin;
+            std::vector<uint32_t>& binIds = data.binIds[dimension];
+            binIds.resize(triangleRange.length());
+            for (uint32_t i = 0; i < triangleRange.length(); ++i)
             {
-                float bmin = nodeBounds.minPoint[dimension], bmax = nodeBounds.maxPoint[dimension];
-                float w = bmax - bmin;
-                FALCOR_ASSERT(w >= 0.f); // The node bounds can be zero if all primitives are axis-aligned and coplanar
-                float scale = w > FLT_MIN ? (float)parameters.binCount / w : 0.f;
-                float p = td.bounds.center()[dimension];
-                FALCOR_ASSERT(bmin <= p && p <= bmax);
-                return std::min((uint32_t)((p - bmin) * scale), parameters.binCount - 1);
-            };
-
-            // Reset the bins.
-            for (Bin& bin : bins) bin = Bin();
+                binIds[i] = std::min((uint32_t)((centers[i] - bmin) * scale), maxBinId);
+            }
 
             // Fill the bins with all triangles.
-            for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
+            for (uint32_t i = 0; i < triangleRange.length(); ++i)
             {
-                const auto& td = data.trianglesData[i];
-                bins[getBinId(td)] |= td;
+                const uint32_t triIdx = triangleRange.begin + i;
+                Bin& bin = bins[binIds[i]];
+                bin.bounds |= trianglesData.getBounds(triIdx);
+                bin.triangleCount++;
+                bin.flux += trianglesData.flux[triIdx];
+                bin.coneDirection += trianglesData.getConeDirection(triIdx);
             }
 
             // Compute the lighting cones for each bin.
@@ -754,11 +1398,11 @@ namespace Falcor
                 bin.cosConeAngle = length(bin.coneDirection) < FLT_MIN ? kInvalidCosConeAngle : 1.0f;
                 bin.coneDirection = normalize(bin.coneDirection);
             }
-            for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
+            for (uint32_t i = 0; i < triangleRange.length(); ++i)
             {
-                const auto& td = data.trianglesData[i];
-                Bin& bin = bins[getBinId(td)];
-                bin.cosConeAngle = computeCosConeAngle(bin.coneDirection, bin.cosConeAngle, td.coneDirection, td.cosConeAngle);
+                const uint32_t triIdx = triangleRange.begin + i;
+                Bin& bin = bins[binIds[i]];
+                bin.cosConeAngle = computeCosConeAngle(bin.coneDirection, bin.cosConeAngle, trianglesData.getConeDirection(triIdx), trianglesData.cosConeAngle[triIdx]);
             }
 
             // First, compute A_j(L) * N_j(L) by sweeping over the bins from left to right.
@@ -821,9 +1465,15 @@ namespace Falcor
 
             // Early out if all lights fall on either side of the split.
             if (axisBestSplit.second.triangleIndex == triangleRange.begin ||
-                axisBestSplit.second.triangleIndex == triangleRange.end) return;
+                axisBestSplit.second.triangleIndex == triangleRange.end) return std::make_pair(std::numeric_limits<float>::infinity(), SplitResult());
 
-            if (axisBestSplit.first < overallBestSplit.first)
+            return axisBestSplit;
+        };
+
+        // Keep the cheapest split. The dimensions are visited in order so that ties are resolved the same way regardless of how they were evaluated.
+        const auto selectSplit = [&](const std::pair<float, SplitResult>& axisBestSplit)
+        {
+            if (axisBestSplit.second.isValid() && axisBestSplit.first < overallBestSplit.first)
             {
                 overallBestSplit = axisBestSplit;
                 FALCOR_ASSERT(triangleRange.begin < overallBestSplit.second.triangleIndex && overallBestSplit.second.triangleIndex < triangleRange.end);
@@ -833,13 +1483,19 @@ namespace Falcor
         // Compute the best split.
         if (parameters.splitAlongLargest)
         {
-            binAlongDimension(largestDimension);
+            selectSplit(binAlongDimension(largestDimension));
         }
         else
         {
+            std::pair<float, SplitResult> axisBestSplits[3];
+            NumericRange<uint32_t> dimensionRange(0, 3);
+            auto evalDimension = [&](uint32_t dimension) { axisBestSplits[dimension] = binAlongDimension(dimension); };
+            if (data.parallelSplit) std::for_each(std::execution::par, dimensionRange.begin(), dimensionRange.end(), evalDimension);
+            else std::for_each(dimensionRange.begin(), dimensionRange.end(), evalDimension);
+
             for (uint32_t dimension = 0; dimension < 3; ++dimension)
             {
-                binAlongDimension(dimension);
+                selectSplit(axisBestSplits[dimension]);
             }
         }
 
@@ -879,4 +1535,27 @@ namespace Falcor
             FALCOR_THROW("Unsupported SplitHeuristic: {}", static_cast<uint32_t>(heuristic));
         }
     }
+
+    float LightBVHBuilder::computeSAOHCost(const std::vector<PackedNode>& nodes, const Options& options)
+    {
+        FALCOR_ASSERT(!nodes.empty());
+
+        auto evalNodeCost = [&options](const PackedNode& packedNode)
+        {
+            SharedNodeAttributes attribs = packedNode.getNodeAttributes();
+            float3 aabbMin, aabbMax;
+            attribs.getAABB(aabbMin, aabbMax);
+            return evalSAOH(AABB(aabbMin, aabbMax), attribs.flux, attribs.cosConeAngle, options);
+        };
+
+        const float rootCost = evalNodeCost(nodes[0]);
+        if (rootCost <= 0.f) return 0.f;
+
+        double cost = 0.0;
+        for (size_t nodeIndex = 1; nodeIndex < nodes.size(); ++nodeIndex)
+        {
+            cost += evalNodeCost(nodes[nodeIndex]);
+        }
+        return static_cast<float>(cost / rootCost);
+    }
 }
@@ -32,6 +32,7 @@
 #include "Utils/Math/AABB.h"
 #include "Utils/Math/Vector.h"
 #include "Utils/UI/Gui.h"
+#include <exception>
 #include <functional>
 #include <limits>
 #include <memory>
@@ -39,7 +40,7 @@
 
 namespace Falcor
 {
-    /** Utility class for building 2-way light BVH on the CPU.
+    /** Utility class for building 2-way light BVH on the CPU, optionally collapsed into a 4- or 8-way BVH.
 
         The building process can be customized via the |Options|,
         which are also available in the GUI via the |renderUI()| function.
@@ -62,6 +63,19 @@ namespace Falcor
             { SplitHeuristic::BinnedSAOH, "BinnedSAOH" },
         });
 
+        enum class NodeWidth : uint32_t
+        {
+            Binary = 2u,        ///< Binary BVH.
+            Wide4 = 4u,         ///< 4-wide BVH collapsed from the binary BVH. Each node is stored in a single PackedWideNodeGroup.
+            Wide8 = 8u,         ///< 8-wide BVH collapsed from the binary BVH. Each node is stored in two consecutive PackedWideNodeGroups.
+        };
+
+        FALCOR_ENUM_INFO(NodeWidth, {
+            { NodeWidth::Binary, "Binary" },
+            { NodeWidth::Wide4, "Wide4" },
+            { NodeWidth::Wide8, "Wide8" },
+        });
+
         /** Light BVH builder configuration options.
             Note if you change options, please update FALCOR_SCRIPT_BINDING in LightBVHBuilder.cpp
         */
@@ -78,6 +92,10 @@ namespace Falcor
             bool           allowRefitting = true;                                ///< Rather than always rebuilding the BVH from scratch, keep the hierarchy but update the bounds and lighting cones.
             bool           usePreintegration = true;                             ///< Use pre-integration for culling out emissive triangles and use their flux when computing the splits. Only valid when using the BinnedSAOH split heuristic.
             bool           useLightingCones = true;                              ///< Use lighting cones when computing the splits. Only valid when using the BinnedSAOH split heuristic.
+            bool           useParallelBuild = true;                              ///< Build independent subtrees and split candidates in parallel. The resulting BVH is identical to the one built serially.
+            NodeWidth      nodeWidth = NodeWidth::Binary;                        ///< Number of children per node of the BVH used for sampling. Wide BVHs are collapsed from the binary BVH.
+            bool           useCPURefit = false;                                  ///< Refit the BVH on the CPU rather than on the GPU. This allows tracking the quality of the refitted BVH. Only valid when 'allowRefitting' is enabled.
+            float          maxRefitCostRatio = 2.f;                              ///< Rebuild the BVH when refitting has increased its SAOH cost by more than this factor since the last rebuild. Zero disables rebuilding. Only used with CPU refit.
 
             template<typename Archive>
             void serialize(Archive& ar)
@@ -93,6 +111,10 @@ namespace Falcor
                 ar("allowRefitting", allowRefitting);
                 ar("usePreintegration", usePreintegration);
                 ar("useLightingCones", useLightingCones);
+                ar("useParallelBuild", useParallelBuild);
+                ar("nodeWidth", nodeWidth);
+                ar("useCPURefit", useCPURefit);
+                ar("maxRefitCostRatio", maxRefitCostRatio);
             }
         };
 
@@ -106,6 +128,69 @@ namespace Falcor
         */
         void build(RenderContext* pRenderContext, LightBVH& bvh);
 
+        /** Refit the BVH on the CPU to the current emissive triangles, without changing the hierarchy.
+            The SAOH cost of the refitted BVH is compared with the cost after the last rebuild to detect when the hierarchy has degraded.
+            \param[in,out] bvh The light BVH to refit. It needs to have been built using build().
+            \return True if the SAOH cost has grown by more than 'maxRefitCostRatio' and the BVH should be rebuilt.
+        */
+        bool refit(RenderContext* pRenderContext, LightBVH& bvh) const;
+
+        /** Build the BVH nodes on the CPU from a list of emissive triangles.
+            This is the device independent part of build(), which can be used without a GPU.
+            \param[in] triangles List of emissive triangles.
+            \param[out] nodes BVH nodes stored in depth-first order.
+            \param[out] triangleIndices Triangle indices sorted by leaf node.
+            \param[out] triangleBitmasks Per triangle bit pattern retracing the tree traversal to reach the triangle. Indexed by global triangle index.
+            \return True if a BVH was built, false if there were no triangles to include.
+        */
+        bool buildNodes(const std::vector<LightCollection::MeshLightTriangle>& triangles, std::vector<PackedNode>& nodes, std::vector<uint32_t>& triangleIndices, std::vector<uint64_t>& triangleBitmasks) const;
+
+        /** Collapse a binary BVH into a wide BVH.
+            Each wide node is formed by repeatedly replacing the internal child with the tallest subtree by its two children,
+            which minimizes the height of the wide BVH. The attributes of the children are copied verbatim from the binary nodes.
+            \param[in] nodes Binary BVH nodes as returned by buildNodes().
+            \param[in] width Number of children per wide node (4 or 8).
+            \param[out] wideNodes Wide BVH nodes. Each wide node occupies (width / 4) consecutive groups, with the root node located at index 0.
+            \param[out] wideChildNodeIndices For each child slot of the wide nodes, the index of the binary node it was collapsed from, or PackedWideNodeGroup::kInvalidChild if the slot is unused. This is used for refitting the wide nodes.
+        */
+        static void collapseNodes(const std::vector<PackedNode>& nodes, uint32_t width, std::vector<PackedWideNodeGroup>& wideNodes, std::vector<uint32_t>& wideChildNodeIndices);
+
+        /** Compute the per triangle traversal bitmasks of a wide BVH.
+            Each level of the tree uses log2(width) bits to store the index of the child slot that was chosen.
+            An exception is thrown if the wide BVH is too deep for the path to fit in 64 bits.
+            \param[in] wideNodes Wide BVH nodes as returned by collapseNodes().
+            \param[in] width Number of children per wide node (4 or 8).
+            \param[in] triangleIndices Triangle indices sorted by leaf node.
+            \param[in,out] triangleBitmasks Per triangle bitmasks, indexed by global triangle index.
+        */
+        static void computeWideTriangleBitmasks(const std::vector<PackedWideNodeGroup>& wideNodes, uint32_t width, const std::vector<uint32_t>& triangleIndices, std::vector<uint64_t>& triangleBitmasks);
+
+        /** Refit the binary BVH nodes to a list of emissive triangles, without changing the hierarchy.
+            The bounds and normal bounding cones are computed as in the GPU refit. The flux of the nodes is not updated.
+            The nodes are processed level by level from the leaves up, and the result does not depend on 'parallel'.
+            \param[in] triangles List of emissive triangles.
+            \param[in] triangleIndices Triangle indices sorted by leaf node, as returned by buildNodes().
+            \param[in] parallel Refit the nodes of each level in parallel.
+            \param[in,out] nodes BVH nodes stored in depth-first order.
+        */
+        static void refitNodes(const std::vector<LightCollection::MeshLightTriangle>& triangles, const std::vector<uint32_t>& triangleIndices, bool parallel, std::vector<PackedNode>& nodes);
+
+        /** Update the wide BVH nodes from the refitted binary BVH nodes they were collapsed from.
+            \param[in] nodes Binary BVH nodes.
+            \param[in] wideChildNodeIndices Binary node index per wide node child slot, as returned by collapseNodes().
+            \param[in,out] wideNodes Wide BVH nodes.
+        */
+        static void refitWideNodes(const std::vector<PackedNode>& nodes, const std::vector<uint32_t>& wideChildNodeIndices, std::vector<PackedWideNodeGroup>& wideNodes);
+
+        /** Compute the SAOH cost of a BVH.
+            The cost is the sum of the SAOH of all nodes below the root, relative to the SAOH of the root node.
+            It is used for measuring how much refitting has degraded the hierarchy.
+            \param[in] nodes BVH nodes stored in depth-first order.
+            \param[in] options Options used for evaluating the SAOH of a node.
+            \return The relative cost, or zero if the root node has no cost.
+        */
+        static float computeSAOHCost(const std::vector<PackedNode>& nodes, const Options& options);
+
         bool renderUI(Gui::Widgets& widget);
 
         const Options& getOptions() const { return mOptions; }
@@ -133,34 +218,75 @@ namespace Falcor
             }
         };
 
+        /** Per triangle data used during the build, stored as a structure of arrays.
+            All arrays are indexed by the same sort index and are permuted together,
+            so that the inner loops of the split heuristics run over contiguous memory.
+        */
         struct TriangleSortData
         {
-            AABB bounds;                                    ///< World-space bounding box for the light source(s).
-            float3 center = {};                             ///< Center point.
-            float3 coneDirection = {};                      ///< Light emission normal direction.
-            float cosConeAngle = 1.f;                       ///< Cosine normal bounding cone (half) angle.
-            float flux = 0.f;                               ///< Precomputed triangle flux (note, this takes doublesidedness into account).
-            uint32_t triangleIndex = MeshLightData::kInvalidIndex; ///< Index into global triangle list.
+            std::vector<float> center[3];                   ///< Center of the world-space bounding box along each axis.
+            std::vector<float> boundsMin[3];                ///< World-space bounding box minimum along each axis.
+            std::vector<float> boundsMax[3];                ///< World-space bounding box maximum along each axis.
+            std::vector<float> coneDirection[3];            ///< Light emission normal direction.
+            std::vector<float> cosConeAngle;                ///< Cosine normal bounding cone (half) angle.
+            std::vector<float> flux;                        ///< Precomputed triangle flux (note, this takes doublesidedness into account).
+            std::vector<uint32_t> triangleIndex;            ///< Index into global triangle list.
+
+            void resize(size_t count);
+            size_t size() const { return flux.size(); }
+            AABB getBounds(uint32_t i) const { return AABB(float3(boundsMin[0][i], boundsMin[1][i], boundsMin[2][i]), float3(boundsMax[0][i], boundsMax[1][i], boundsMax[2][i])); }
+            float3 getConeDirection(uint32_t i) const { return float3(coneDirection[0][i], coneDirection[1][i], coneDirection[2][i]); }
         };
 
         struct BuildingData
         {
-            std::vector<PackedNode>& nodes;                 ///< BVH nodes generated by the builder.
-            std::vector<TriangleSortData> trianglesData;    ///< Compact list of triangles to include in build.
+            TriangleSortData& trianglesData;                ///< Compact list of triangles to include in build. Concurrent builds operate on disjoint ranges.
+            std::vector<PackedNode> nodes;                  ///< BVH nodes generated by the builder.
             std::vector<uint32_t> triangleIndices;          ///< Triangle indices sorted by leaf node. Each leaf node refers to a contiguous array of triangle indices.
-            std::vector<uint64_t> triangleBitmasks;         ///< Array containing the per triangle bit pattern retracing the tree traversal to reach the triangle: 0=left child, 1=right child; this array gets filled in during the build process. Indexed by global triangle index.
+            std::vector<uint32_t> binIds[3];                ///< Scratch memory holding the bin index of each triangle in the current range, per axis.
+            std::vector<uint32_t> sortIndices;              ///< Scratch memory used when partitioning the triangles.
+            std::vector<float> floatScratch;                ///< Scratch memory used when permuting the triangle data.
+            std::vector<uint32_t> indexScratch;             ///< Scratch memory used when permuting the triangle indices.
             float currentNodeFlux = 0.f;                    ///< Used by computeSAOHSplit() as the leaf creation cost.
+            bool parallelSplit = false;                     ///< Evaluate the split candidates along the three axes in parallel.
+
+            BuildingData(TriangleSortData& triangles) : trianglesData(triangles) {}
+        };
+
+        /** Subtree built independently of the rest of the tree.
+            The nodes and triangle offsets are local to the subtree and get relocated once all subtrees are done.
+        */
+        struct SubtreeTask
+        {
+            Range triangleRange;
+            uint32_t depth;
+            std::vector<PackedNode> nodes;
+            std::vector<uint32_t> triangleIndices;
+            std::exception_ptr exception;                   ///< Exception thrown while building the subtree, if any.
 
-            BuildingData(std::vector<PackedNode>& bvhNodes) : nodes(bvhNodes) {}
+            SubtreeTask(const Range& range, uint32_t _depth) : triangleRange(range), depth(_depth) {}
+        };
+
+        /** Node at the top of the tree, built before the subtrees are dispatched.
+        */
+        struct TopLevelNode
+        {
+            AABB bounds;
+            float flux = 0.f;
+            uint32_t leftIndex = 0;                         ///< Index of the left child in the list of top-level nodes.
+            uint32_t rightIndex = 0;                        ///< Index of the right child in the list of top-level nodes.
+            uint32_t taskIndex = std::numeric_limits<uint32_t>::max(); ///< Index of the subtree task if the node is a subtree root.
+
+            bool isSubtree() const { return taskIndex != std::numeric_limits<uint32_t>::max(); }
         };
 
         /** Compute the split according to a specified heuristic.
-            \param[in] data Prepared light data.
+            \param[in,out] data Prepared light data. Only the scratch memory is modified.
             \param[in] triangleRange Range of triangles to process.
             \param[in] nodeBounds Bounds for the node to be splitted.
             \param[in] parameters Various parameters defining how the building should occur.
         */
-        using SplitHeuristicFunction = std::function<SplitResult(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, const Options& parameters)>;
+        using SplitHeuristicFunction = std::function<SplitResult(BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, const Options& parameters)>;
 
         /** Renders the UI with builder options.
         */
@@ -168,21 +294,55 @@ namespace Falcor
 
         /** Recursive BVH build.
             \param[in] splitHeuristic The splitting heuristic to be used.
-            \param[in] bitmask Bit pattern retracing the tree traversal to reach the node to be built: 0=left child, 1=right child.
             \param[in] depth Depth of the node to be built
             \param[in] triangleRange Range of triangles to process.
             \param[in,out] data Prepared light data.
             \return Index of the allocated node.
         */
-        uint32_t buildInternal(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data);
+        uint32_t buildInternal(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint32_t depth, const Range& triangleRange, BuildingData& data) const;
+
+        /** Recursive build of the top of the tree. Ranges smaller than the parallel build threshold are deferred to subtree tasks.
+            \param[in] splitHeuristic The splitting heuristic to be used.
+            \param[in] depth Depth of the node to be built
+            \param[in] triangleRange Range of triangles to process.
+            \param[in,out] data Prepared light data.
+            \param[in,out] topLevelNodes List of top-level nodes.
+            \param[in,out] tasks List of subtree tasks.
+            \return Index of the top-level node.
+        */
+        uint32_t buildTopLevel(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint32_t depth, const Range& triangleRange, BuildingData& data, std::vector<TopLevelNode>& topLevelNodes, std::vector<SubtreeTask>& tasks) const;
+
+        /** Compute the bounds and flux of a node and the split to apply to it.
+            If the split is valid, the triangles in the range are partitioned accordingly.
+            \return The split result, invalid if a leaf node should be created.
+        */
+        static SplitResult splitNode(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint32_t depth, const Range& triangleRange, BuildingData& data, AABB& nodeBounds, float& nodeFlux);
+
+        /** Relocate the nodes of the subtrees and write them in depth-first order.
+            \param[in] topLevelNodes List of top-level nodes.
+            \param[in] tasks List of subtree tasks.
+            \param[in] topLevelIndex Index of the top-level node to write.
+            \param[in,out] nodes Final list of nodes.
+            \param[in,out] triangleIndices Final list of triangle indices.
+            \return Index of the written node.
+        */
+        static uint32_t gatherNodes(const std::vector<TopLevelNode>& topLevelNodes, const std::vector<SubtreeTask>& tasks, uint32_t topLevelIndex, std::vector<PackedNode>& nodes, std::vector<uint32_t>& triangleIndices);
+
+        /** Compute the per triangle traversal bitmasks from the finished tree.
+            \param[in] nodes BVH nodes.
+            \param[in] triangleIndices Triangle indices sorted by leaf node.
+            \param[in] parallel Process the leaf nodes in parallel.
+            \param[in,out] triangleBitmasks Per triangle bitmasks, indexed by global triangle index.
+        */
+        static void computeTriangleBitmasks(const std::vector<PackedNode>& nodes, const std::vector<uint32_t>& triangleIndices, bool parallel, std::vector<uint64_t>& triangleBitmasks);
 
         /** Recursive computation of lighting cones for all internal nodes.
             \param[in] nodeIndex Index of the current node.
-            \param[in,out] data Updated node data.
+            \param[in,out] nodes Updated node data.
             \param[out] cosConeAngle Cosine of the cone angle of the lighting cone for the current node, or kInvalidCosConeAngle if the cone is invalid.
             \return direction of the lighting cone for the current node.
         */
-        float3 computeLightingConesInternal(const uint32_t nodeIndex, BuildingData& data, float& cosConeAngle);
+        static float3 computeLightingConesInternal(const uint32_t nodeIndex, std::vector<PackedNode>& nodes, float& cosConeAngle);
 
         /** Compute lighting cone for a range of triangles.
             \param[in] triangleRange Range of triangles to process.
@@ -193,9 +353,9 @@ namespace Falcor
         static float3 computeLightingCone(const Range& triangleRange, const BuildingData& data, float& cosTheta);
 
         // See the documentation of SplitHeuristicFunction.
-        static SplitResult computeSplitWithEqual(const BuildingData& /*data*/, const Range& triangleRange, const AABB& nodeBounds, const Options& /*parameters*/);
-        static SplitResult computeSplitWithBinnedSAH(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, const Options& parameters);
-        static SplitResult computeSplitWithBinnedSAOH(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, const Options& parameters);
+        static SplitResult computeSplitWithEqual(BuildingData& /*data*/, const Range& triangleRange, const AABB& nodeBounds, const Options& /*parameters*/);
+        static SplitResult computeSplitWithBinnedSAH(BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, const Options& parameters);
+        static SplitResult computeSplitWithBinnedSAOH(BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, const Options& parameters);
 
         static SplitHeuristicFunction getSplitFunction(SplitHeuristic heuristic);
 
@@ -204,4 +364,5 @@ namespace Falcor
     };
 
     FALCOR_ENUM_REGISTER(LightBVHBuilder::SplitHeuristic);
+    FALCOR_ENUM_REGISTER(LightBVHBuilder::NodeWidth);
 }
@@ -0,0 +1,322 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "LightBVHReferenceSampler.h"
+#include "Core/Error.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kMaxNodeWidth = 8;
+
+        // See LightBVHSampler.slang for the documentation of the functions below.
+
+        float cosSubClamped(float sinThetaA, float cosThetaA, float sinThetaB, float cosThetaB)
+        {
+            if (cosThetaA > cosThetaB) return 1.f;
+            return cosThetaA * cosThetaB + sinThetaA * sinThetaB;
+        }
+
+        float sinSubClamped(float sinThetaA, float cosThetaA, float sinThetaB, float cosThetaB)
+        {
+            if (cosThetaA > cosThetaB) return 0.f;
+            return sinThetaA * cosThetaB - cosThetaA * sinThetaB;
+        }
+
+        float boundCosineTerm(const float3& posW, const float3& normalW, const float3& center, const float3& extent, float& cosThetaCone)
+        {
+            // Bound the solid angle using a bounding sphere that encompasses the bounding box (SolidAngleBoundMethod::Sphere).
+            float sinThetaCone = 0.f;
+            const float3 dir = center - posW;
+            const float sqrRadius = dot(extent, extent);
+            const float centerDistance2 = dot(dir, dir);
+            if (centerDistance2 < sqrRadius)
+            {
+                cosThetaCone = -1.f;
+            }
+            else
+            {
+                const float sin2Theta = sqrRadius / centerDistance2;
+                cosThetaCone = std::sqrt(1.f - sin2Theta);
+                sinThetaCone = std::sqrt(sin2Theta);
+            }
+
+            const float3 L = normalize(dir);
+            const float cosThetaL = std::clamp(dot(normalW, L), -1.f, 1.f);
+            const float sinThetaL = std::sqrt(1.f - cosThetaL * cosThetaL);
+            return std::clamp(cosSubClamped(sinThetaL, cosThetaL, sinThetaCone, cosThetaCone), 0.f, 1.f);
+        }
+    }
+
+    LightBVHReferenceSampler::LightBVHReferenceSampler(const BVHData& data, const LightBVHSampler::Options& options)
+        : mData(data)
+        , mOptions(options)
+    {
+        FALCOR_CHECK(data.nodeWidth == 2 || data.nodeWidth == 4 || data.nodeWidth == 8, "Unsupported light BVH node width ({})", data.nodeWidth);
+        FALCOR_CHECK(data.nodeWidth == 2 ? !data.nodes.empty() : !data.wideNodes.empty(), "Light BVH has no nodes");
+        FALCOR_CHECK(options.solidAngleBoundMethod == SolidAngleBoundMethod::Sphere, "Reference sampler only supports the sphere solid angle bound");
+        FALCOR_CHECK(options.useUniformTriangleSampling, "Reference sampler only supports uniform triangle sampling");
+    }
+
+    bool LightBVHReferenceSampler::sampleTriangle(const float3& posW, const float3& normalW, bool upperHemisphere, float u, uint32_t& triangleIndex, float& pdf) const
+    {
+        triangleIndex = 0;
+        pdf = 0.f;
+
+        float leafPdf;
+        LeafNode node;
+        bool valid = mData.nodeWidth > 2
+            ? traverseWideTree(posW, normalW, upperHemisphere, u, leafPdf, node)
+            : traverseTree(posW, normalW, upperHemisphere, u, leafPdf, node);
+        if (!valid) return false;
+
+        uint32_t idx = std::min((uint32_t)(u * node.triangleCount), node.triangleCount - 1);
+        triangleIndex = mData.triangleIndices[node.triangleOffset + idx];
+        pdf = leafPdf / (float)node.triangleCount;
+        return true;
+    }
+
+    float LightBVHReferenceSampler::evalTriangleSelectionPdf(const float3& posW, const float3& normalW, bool upperHemisphere, uint32_t triangleIndex) const
+    {
+        if (triangleIndex >= mData.triangleBitmasks.size()) return 0.f;
+        const uint64_t bitmask = mData.triangleBitmasks[triangleIndex];
+        if (bitmask == std::numeric_limits<uint64_t>::max()) return 0.f; // Triangle is not in the BVH.
+
+        LeafNode node;
+        float traversalPdf = mData.nodeWidth > 2
+            ? evalWideTraversalPdf(posW, normalW, upperHemisphere, bitmask, node)
+            : evalTraversalPdf(posW, normalW, upperHemisphere, bitmask, node);
+        if (traversalPdf == 0.f) return 0.f;
+
+        FALCOR_ASSERT(std::find(mData.triangleIndices.begin() + node.triangleOffset, mData.triangleIndices.begin() + node.triangleOffset + node.triangleCount, triangleIndex) != mData.triangleIndices.begin() + node.triangleOffset + node.triangleCount);
+        return traversalPdf / (float)node.triangleCount;
+    }
+
+    float LightBVHReferenceSampler::computeImportance(const float3& posW, const float3& normalW, bool upperHemisphere, const SharedNodeAttributes& attribs) const
+    {
+        float flux = 1.f;
+        if (!mOptions.disableNodeFlux) flux = attribs.flux;
+
+        float distance = length(attribs.origin - posW);
+
+        float NdotL = 1.f;
+        float cosThetaBoundingCone = 0.f;
+        if (mOptions.useLightingCone || (mOptions.useBoundingCone && upperHemisphere))
+        {
+            NdotL = boundCosineTerm(posW, normalW, attribs.origin, attribs.extent, cosThetaBoundingCone);
+            if (!(mOptions.useBoundingCone && upperHemisphere)) NdotL = 1.f;
+        }
+
+        float orientationWeight = 1.f;
+        if (mOptions.useLightingCone)
+        {
+            float cosConeAngle = attribs.cosConeAngle;
+            float3 dirToAabb = (attribs.origin - posW) / distance;
+            if (cosConeAngle != kInvalidCosConeAngle && cosConeAngle > 0.f)
+            {
+                float sinConeAngle = std::sqrt(std::max(0.f, 1.f - cosConeAngle * cosConeAngle));
+
+                float cosTheta = dot(attribs.coneDirection, -dirToAabb);
+                float sinTheta = std::sqrt(std::max(0.f, 1.f - cosTheta * cosTheta));
+
+                float sinThetaBoundingCone = std::sqrt(std::max(0.f, 1 - cosThetaBoundingCone * cosThetaBoundingCone));
+
+                float cosTheta0 = cosSubClamped(sinTheta, cosTheta, sinConeAngle, cosConeAngle);
+                float sinTheta0 = sinSubClamped(sinTheta, cosTheta, sinConeAngle, cosConeAngle);
+                float cosThetaPrime = cosSubClamped(sinTheta0, cosTheta0, sinThetaBoundingCone, cosThetaBoundingCone);
+
+                orientationWeight = std::max(0.f, cosThetaPrime);
+            }
+        }
+
+        float halfRadius = std::max(attribs.extent.x, std::max(attribs.extent.y, attribs.extent.z));
+        distance = std::max(halfRadius, distance);
+
+        return (flux * NdotL) * orientationWeight / (distance * distance);
+    }
+
+    bool LightBVHReferenceSampler::traverseTree(const float3& posW, const float3& normalW, bool upperHemisphere, float& u, float& pdf, LeafNode& node) const
+    {
+        pdf = 1.f;
+        uint32_t nodeIndex = 0;
+
+        while (!mData.nodes[nodeIndex].isLeaf())
+        {
+            uint32_t leftNodeIndex = nodeIndex + 1;
+            uint32_t rightNodeIndex = mData.nodes[nodeIndex].getInternalNode().rightChildIdx;
+
+            float leftNodeImportance = computeImportance(posW, normalW, upperHemisphere, mData.nodes[leftNodeIndex].getNodeAttributes());
+            float rightNodeImportance = computeImportance(posW, normalW, upperHemisphere, mData.nodes[rightNodeIndex].getNodeAttributes());
+
+            float totalImportance = leftNodeImportance + rightNodeImportance;
+            if (totalImportance == 0.f) return false;
+
+            float pLeft = leftNodeImportance / totalImportance;
+            float pRight = 1.f - pLeft;
+
+            if (u < pLeft)
+            {
+                u = u / pLeft;
+                pdf *= pLeft;
+                nodeIndex = leftNodeIndex;
+            }
+            else
+            {
+                u = (u - pLeft) / pRight;
+                pdf *= pRight;
+                nodeIndex = rightNodeIndex;
+            }
+        }
+
+        node = mData.nodes[nodeIndex].getLeafNode();
+        return true;
+    }
+
+    float LightBVHReferenceSampler::computeWideChildImportances(const float3& posW, const float3& normalW, bool upperHemisphere, uint32_t nodeIndex, float* importance) const
+    {
+        float totalImportance = 0.f;
+        for (uint32_t slot = 0; slot < mData.nodeWidth; ++slot)
+        {
+            const PackedWideNodeGroup& group = mData.wideNodes[nodeIndex + slot / PackedWideNodeGroup::kChildCount];
+            const uint32_t lane = slot % PackedWideNodeGroup::kChildCount;
+
+            importance[slot] = 0.f;
+            if (group.isValid(lane))
+            {
+                importance[slot] = computeImportance(posW, normalW, upperHemisphere, group.getChild(lane).getNodeAttributes());
+            }
+            totalImportance += importance[slot];
+        }
+        return totalImportance;
+    }
+
+    bool LightBVHReferenceSampler::traverseWideTree(const float3& posW, const float3& normalW, bool upperHemisphere, float& u, float& pdf, LeafNode& node) const
+    {
+        pdf = 1.f;
+        uint32_t nodeIndex = 0;
+
+        while (true)
+        {
+            float importance[kMaxNodeWidth];
+            float totalImportance = computeWideChildImportances(posW, normalW, upperHemisphere, nodeIndex, importance);
+            if (totalImportance == 0.f) return false;
+
+            float uScaled = u * totalImportance;
+            float cdf = 0.f;
+            float selectedCdf = 0.f;
+            uint32_t slot = 0;
+            for (uint32_t i = 0; i < mData.nodeWidth; ++i)
+            {
+                if (importance[i] == 0.f) continue;
+                slot = i;
+                selectedCdf = cdf;
+                cdf += importance[i];
+                if (uScaled < cdf) break;
+            }
+
+            u = std::clamp((uScaled - selectedCdf) / importance[slot], 0.f, 1.f);
+            pdf *= importance[slot] / totalImportance;
+
+            const PackedWideNodeGroup& group = mData.wideNodes[nodeIndex + slot / PackedWideNodeGroup::kChildCount];
+            const uint32_t lane = slot % PackedWideNodeGroup::kChildCount;
+            if (group.isLeaf(lane))
+            {
+                node = group.getChild(lane).getLeafNode();
+                return true;
+            }
+            nodeIndex = group.getChildNodeIndex(lane);
+        }
+    }
+
+    float LightBVHReferenceSampler::evalTraversalPdf(const float3& posW, const float3& normalW, bool upperHemisphere, uint64_t bitmask, LeafNode& node) const
+    {
+        float traversalPdf = 1.f;
+        uint32_t nodeIndex = 0;
+
+        while (!mData.nodes[nodeIndex].isLeaf())
+        {
+            uint32_t leftNodeIndex = nodeIndex + 1;
+            uint32_t rightNodeIndex = mData.nodes[nodeIndex].getInternalNode().rightChildIdx;
+
+            float leftNodeImportance = computeImportance(posW, normalW, upperHemisphere, mData.nodes[leftNodeIndex].getNodeAttributes());
+            float rightNodeImportance = computeImportance(posW, normalW, upperHemisphere, mData.nodes[rightNodeIndex].getNodeAttributes());
+
+            float totalImportance = leftNodeImportance + rightNodeImportance;
+            if (totalImportance == 0.f) return 0.f;
+
+            float pLeft = leftNodeImportance / totalImportance;
+            float pRight = 1.f - pLeft;
+
+            if ((bitmask & 0x1) == 0)
+            {
+                traversalPdf *= pLeft;
+                nodeIndex = leftNodeIndex;
+            }
+            else
+            {
+                traversalPdf *= pRight;
+                nodeIndex = rightNodeIndex;
+            }
+            bitmask >>= 1;
+        }
+
+        node = mData.nodes[nodeIndex].getLeafNode();
+        return traversalPdf;
+    }
+
+    float LightBVHReferenceSampler::evalWideTraversalPdf(const float3& posW, const float3& normalW, bool upperHemisphere, uint64_t bitmask, LeafNode& node) const
+    {
+        const uint32_t bitsPerLevel = mData.nodeWidth == 8 ? 3 : 2;
+        float traversalPdf = 1.f;
+        uint32_t nodeIndex = 0;
+
+        while (true)
+        {
+            float importance[kMaxNodeWidth];
+            float totalImportance = computeWideChildImportances(posW, normalW, upperHemisphere, nodeIndex, importance);
+
+            uint32_t slot = (uint32_t)(bitmask & (mData.nodeWidth - 1));
+            if (importance[slot] == 0.f) return 0.f;
+            traversalPdf *= importance[slot] / totalImportance;
+
+            const PackedWideNodeGroup& group = mData.wideNodes[nodeIndex + slot / PackedWideNodeGroup::kChildCount];
+            const uint32_t lane = slot % PackedWideNodeGroup::kChildCount;
+            if (group.isLeaf(lane))
+            {
+                node = group.getChild(lane).getLeafNode();
+                return traversalPdf;
+            }
+
+            bitmask >>= bitsPerLevel;
+            nodeIndex = group.getChildNodeIndex(lane);
+        }
+    }
+}
@@ -0,0 +1,105 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "LightBVHTypes.slang"
+#include "LightBVHSampler.h"
+#include "Core/Macros.h"
+#include "Utils/Math/Vector.h"
+#include <vector>
+
+namespace Falcor
+{
+    /** CPU reference implementation of the light BVH sampler.
+
+        This class mirrors the traversal and node importance computations in LightBVHSampler.slang
+        for both the binary and the wide BVH layouts. It runs without a GPU device and is used to
+        validate the BVH layouts and sampling probabilities on the CPU.
+
+        Only the SolidAngleBoundMethod::Sphere bound and uniform triangle sampling within leaf nodes
+        are supported.
+    */
+    class FALCOR_API LightBVHReferenceSampler
+    {
+    public:
+        /** BVH data as produced by LightBVHBuilder::buildNodes() and LightBVHBuilder::collapseNodes().
+        */
+        struct BVHData
+        {
+            uint32_t nodeWidth = 2;                         ///< Number of children per node (2, 4 or 8).
+            std::vector<PackedNode> nodes;                  ///< Binary BVH nodes. Used if nodeWidth == 2.
+            std::vector<PackedWideNodeGroup> wideNodes;     ///< Wide BVH nodes. Used if nodeWidth > 2.
+            std::vector<uint32_t> triangleIndices;          ///< Triangle indices sorted by leaf node.
+            std::vector<uint64_t> triangleBitmasks;         ///< Per triangle traversal bitmasks for the layout given by nodeWidth, indexed by global triangle index.
+        };
+
+        /** Constructor. Throws an exception if the options are not supported.
+            \param[in] data BVH data. The data is referenced and must outlive the sampler.
+            \param[in] options Sampler options. Only the traversal options are used.
+        */
+        LightBVHReferenceSampler(const BVHData& data, const LightBVHSampler::Options& options);
+
+        /** Stochastically traverse the BVH to select a triangle.
+            \param[in] posW Shading point in world space.
+            \param[in] normalW Normal at the shading point in world space.
+            \param[in] upperHemisphere True if only upper hemisphere should be considered.
+            \param[in] u Uniform random number.
+            \param[out] triangleIndex Global index of the selected triangle, only valid if true is returned.
+            \param[out] pdf Probability of selecting the triangle, only valid if true is returned.
+            \return True if a triangle was selected, false otherwise.
+        */
+        bool sampleTriangle(const float3& posW, const float3& normalW, bool upperHemisphere, float u, uint32_t& triangleIndex, float& pdf) const;
+
+        /** Evaluate the probability of selecting a triangle.
+            \param[in] posW Shading point in world space.
+            \param[in] normalW Normal at the shading point in world space.
+            \param[in] upperHemisphere True if only upper hemisphere should be considered.
+            \param[in] triangleIndex Global index of the triangle.
+            \return Probability of selecting the triangle, or zero if the triangle is not in the BVH.
+        */
+        float evalTriangleSelectionPdf(const float3& posW, const float3& normalW, bool upperHemisphere, uint32_t triangleIndex) const;
+
+        /** Computes node importance from a given shading point.
+            \param[in] posW Shading point in world space.
+            \param[in] normalW Normal at the shading point in world space.
+            \param[in] upperHemisphere True if only upper hemisphere should be considered.
+            \param[in] attribs Unpacked node attributes.
+            \return Relative importance of the node.
+        */
+        float computeImportance(const float3& posW, const float3& normalW, bool upperHemisphere, const SharedNodeAttributes& attribs) const;
+
+    private:
+        bool traverseTree(const float3& posW, const float3& normalW, bool upperHemisphere, float& u, float& pdf, LeafNode& node) const;
+        bool traverseWideTree(const float3& posW, const float3& normalW, bool upperHemisphere, float& u, float& pdf, LeafNode& node) const;
+        float evalTraversalPdf(const float3& posW, const float3& normalW, bool upperHemisphere, uint64_t bitmask, LeafNode& node) const;
+        float evalWideTraversalPdf(const float3& posW, const float3& normalW, bool upperHemisphere, uint64_t bitmask, LeafNode& node) const;
+        float computeWideChildImportances(const float3& posW, const float3& normalW, bool upperHemisphere, uint32_t nodeIndex, float* importance) const;
+
+        const BVHData& mData;
+        LightBVHSampler::Options mOptions;
+    };
+}
@@ -56,7 +56,15 @@ namespace Falcor
         }
         else if (needsRefit)
         {
-            mpBVH->refit(pRenderContext);
+            if (mOptions.buildOptions.useCPURefit)
+            {
+                // Rebuild right away if refitting has degraded the hierarchy too much.
+                if (mpBVHBuilder->refit(pRenderContext, *mpBVH)) mpBVHBuilder->build(pRenderContext, *mpBVH);
+            }
+            else
+            {
+                mpBVH->refit(pRenderContext);
+            }
             samplerChanged = true;
         }
 
@@ -75,6 +83,7 @@ namespace Falcor
         defines.add("_USE_UNIFORM_TRIANGLE_SAMPLING", mOptions.useUniformTriangleSampling ? "1" : "0");
         defines.add("_ACTUAL_MAX_TRIANGLES_PER_NODE", std::to_string(mOptions.buildOptions.maxTriangleCountPerLeaf));
         defines.add("_SOLID_ANGLE_BOUND_METHOD", std::to_string((uint32_t)mOptions.solidAngleBoundMethod));
+        defines.add("_LIGHT_BVH_WIDTH", std::to_string((uint32_t)mOptions.buildOptions.nodeWidth));
 
         return defines;
     }
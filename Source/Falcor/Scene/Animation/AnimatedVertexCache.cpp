@@ -29,8 +29,11 @@
 #include "Animation.h"
 #include "Core/API/RenderContext.h"
 #include "Scene/Scene.h"
+#include "Utils/Logger.h"
 #include "Utils/Timing/Profiler.h"
 
+#include <cstring>
+
 namespace Falcor
 {
     namespace
@@ -94,12 +97,12 @@ namespace Falcor
         }
     }
 
-    AnimatedVertexCache::AnimatedVertexCache(ref<Device> pDevice, Scene* pScene, const ref<Buffer>& pPrevVertexData, std::vector<CachedCurve>&& cachedCurves, std::vector<CachedMesh>&& cachedMeshes)
+    AnimatedVertexCache::AnimatedVertexCache(ref<Device> pDevice, Scene* pScene, const ref<Buffer>& pPrevVertexData, std::vector<CachedCurve>&& cachedCurves, std::vector<CachedMesh>&& cachedMeshes, const VertexCacheStreamingOptions& streamingOptions)
         : mpDevice(pDevice)
         , mpScene(pScene)
         , mpPrevVertexData(pPrevVertexData)
-        , mCachedCurves(cachedCurves)
-        , mCachedMeshes(cachedMeshes)
+        , mCachedCurves(std::move(cachedCurves))
+        , mCachedMeshes(std::move(cachedMeshes))
     {
         if (mCachedCurves.empty() && mCachedMeshes.empty()) return;
 
@@ -112,7 +115,14 @@ namespace Falcor
             }
 
             initCurveKeyframes();
+        }
+
+        mCurveLSSTrack = (uint32_t)mCachedMeshes.size();
+        mCurvePolyTubeTrack = mCurveLSSTrack + (mCurveLSSCount > 0 ? 1 : 0);
+        if (streamingOptions.enabled) initKeyframeStreaming(streamingOptions);
 
+        if (!mCachedCurves.empty())
+        {
             if (mCurveLSSCount > 0)
             {
                 bindCurveLSSBuffers();
@@ -138,6 +148,12 @@ namespace Falcor
         }
     }
 
+    AnimatedVertexCache::~AnimatedVertexCache()
+    {
+        // Wait for keyframe reads in flight before releasing the cached data.
+        mpKeyframeStreamer.reset();
+    }
+
     bool AnimatedVertexCache::animate(RenderContext* pRenderContext, double time)
     {
         if (!hasAnimations()) return false;
@@ -149,13 +165,13 @@ namespace Falcor
 
             if (mCurveLSSCount > 0)
             {
-                executeCurveLSSVertexUpdatePass(pRenderContext, interpolationInfo);
+                executeCurveLSSVertexUpdatePass(pRenderContext, streamKeyframes(mCurveLSSTrack, interpolationInfo));
                 executeCurveLSSAABBUpdatePass(pRenderContext);
             }
 
             if (mCurvePolyTubeCount > 0)
             {
-                executeCurvePolyTubeVertexUpdatePass(pRenderContext, interpolationInfo);
+                executeCurvePolyTubeVertexUpdatePass(pRenderContext, streamKeyframes(mCurvePolyTubeTrack, interpolationInfo));
             }
 
 
@@ -211,6 +227,40 @@ namespace Falcor
         mGlobalCurveAnimationLength = mCurveKeyframeTimes.empty() ? 0 : mCurveKeyframeTimes.back();
     }
 
+    void AnimatedVertexCache::gatherCurveKeyframe(CurveTessellationMode mode, uint32_t keyframe, std::vector<DynamicCurveVertexData>& vertexData) const
+    {
+        // Concatenate the vertices of all curves with the given tessellation mode at the aligned keyframe time.
+        const double time = mCurveKeyframeTimes[keyframe];
+        std::vector<DynamicCurveVertexData> scratch0, scratch1;
+        vertexData.clear();
+        for (const auto& cache : mCachedCurves)
+        {
+            if (cache.tessellationMode != mode) continue;
+
+            const auto& timeSamples = cache.timeSamples;
+            const uint32_t vertexCount = cache.getVertexCount();
+            uint32_t k = (uint32_t)std::min(size_t(std::lower_bound(timeSamples.begin(), timeSamples.end(), time) - timeSamples.begin()), timeSamples.size() - 1);
+            const DynamicCurveVertexData* pCurr = cache.getKeyframe(k, scratch0);
+
+            if (timeSamples[k] == time || k == 0)
+            {
+                vertexData.insert(vertexData.end(), pCurr, pCurr + vertexCount);
+            }
+            else
+            {
+                // Linearly interpolate at the missing keyframe.
+                const DynamicCurveVertexData* pPrev = cache.getKeyframe(k - 1, scratch1);
+                float t = float((time - timeSamples[k - 1]) / (timeSamples[k] - timeSamples[k - 1]));
+                size_t offset = vertexData.size();
+                vertexData.resize(offset + vertexCount);
+                for (size_t p = 0; p < vertexCount; p++)
+                {
+                    vertexData[offset + p].position = lerp(pPrev[p].position, pCurr[p].position, t);
+                }
+            }
+        }
+    }
+
     void AnimatedVertexCache::bindCurveLSSBuffers()
     {
         // Compute curve vertex and index (segment) count.
@@ -220,14 +270,14 @@ namespace Falcor
         {
             if (mCachedCurves[i].tessellationMode != CurveTessellationMode::LinearSweptSphere) continue;
 
-            mCurveVertexCount += (uint32_t)mCachedCurves[i].vertexData[0].size();
+            mCurveVertexCount += mCachedCurves[i].getVertexCount();
             mCurveIndexCount += (uint32_t)mCachedCurves[i].indexData.size();
         }
 
-        // Create buffers for vertex positions in curve vertex caches.
+        // Create buffers for vertex positions in curve vertex caches, one per keyframe or per streaming slot.
         ResourceBindFlags vbBindFlags = ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess;
-        mpCurveVertexBuffers.resize(mCurveKeyframeTimes.size());
-        for (uint32_t i = 0; i < mCurveKeyframeTimes.size(); i++)
+        mpCurveVertexBuffers.resize(getKeyframeBufferCount(mCurveLSSTrack));
+        for (uint32_t i = 0; i < mpCurveVertexBuffers.size(); i++)
         {
             mpCurveVertexBuffers[i] = mpDevice->createStructuredBuffer(sizeof(DynamicCurveVertexData), mCurveVertexCount, vbBindFlags, MemoryType::DeviceLocal, nullptr, false);
             mpCurveVertexBuffers[i]->setName("AnimatedVertexCache::mpCurveVertexBuffers[" + std::to_string(i) + "]");
@@ -237,41 +287,26 @@ namespace Falcor
         mpPrevCurveVertexBuffer = mpDevice->createStructuredBuffer(sizeof(DynamicCurveVertexData), mCurveVertexCount, vbBindFlags, MemoryType::DeviceLocal, nullptr, false);
         mpPrevCurveVertexBuffer->setName("AnimatedVertexCache::mpPrevCurveVertexBuffer");
 
-        // Initialize vertex buffers with cached positions.
-        uint32_t offset = 0;
-        for (size_t i = 0; i < mCachedCurves.size(); i++)
+        // Initialize vertex buffers with cached positions. Streamed keyframes are uploaded on demand.
+        if (!mpKeyframeStreamer)
         {
-            if (mCachedCurves[i].tessellationMode != CurveTessellationMode::LinearSweptSphere) continue;
-
-            size_t vertexCount = mCachedCurves[i].vertexData[0].size();
-            uint32_t bufSize = uint32_t(vertexCount * sizeof(DynamicCurveVertexData));
-            uint32_t k = 0;
-            const auto& timeSamples = mCachedCurves[i].timeSamples;
-
+            std::vector<DynamicCurveVertexData> keyframeData;
             for (uint32_t j = 0; j < mCurveKeyframeTimes.size(); j++)
             {
-                while (k + 1 < timeSamples.size() && timeSamples[k] < mCurveKeyframeTimes[j]) k++;
-
-                if (timeSamples[k] == mCurveKeyframeTimes[j])
-                {
-                    mpCurveVertexBuffers[j]->setBlob(mCachedCurves[i].vertexData[k].data(), offset, bufSize);
-                }
-                else
-                {
-                    // Linearly interpolate at the missing keyframe.
-                    float t = float((mCurveKeyframeTimes[j] - timeSamples[k - 1]) / (timeSamples[k] - timeSamples[k - 1]));
-                    std::vector<DynamicCurveVertexData> interpVertices(vertexCount);
-                    for (size_t p = 0; p < vertexCount; p++)
-                    {
-                        interpVertices[p].position = lerp(mCachedCurves[i].vertexData[k - 1][p].position, mCachedCurves[i].vertexData[k][p].position, t);
-                    }
-                    mpCurveVertexBuffers[j]->setBlob(interpVertices.data(), offset, bufSize);
-                }
+                gatherCurveKeyframe(CurveTessellationMode::LinearSweptSphere, j, keyframeData);
+                mpCurveVertexBuffers[j]->setBlob(keyframeData.data(), 0, keyframeData.size() * sizeof(DynamicCurveVertexData));
             }
+        }
 
-            // Initialize it with positions at the first keyframe.
-            mpPrevCurveVertexBuffer->setBlob(mCachedCurves[i].vertexData[0].data(), offset, bufSize);
+        // Initialize previous positions with positions at the first keyframe.
+        uint32_t offset = 0;
+        std::vector<DynamicCurveVertexData> scratch;
+        for (size_t i = 0; i < mCachedCurves.size(); i++)
+        {
+            if (mCachedCurves[i].tessellationMode != CurveTessellationMode::LinearSweptSphere) continue;
 
+            uint32_t bufSize = uint32_t(mCachedCurves[i].getVertexCount() * sizeof(DynamicCurveVertexData));
+            mpPrevCurveVertexBuffer->setBlob(mCachedCurves[i].getKeyframe(0, scratch), offset, bufSize);
             offset += bufSize;
         }
 
@@ -315,7 +350,7 @@ namespace Falcor
             PerCurveMetadata curveMeta;
             curveMeta.indexCount = (uint32_t)cache.indexData.size();
             curveMeta.indexOffset = mCurvePolyTubeIndexCount;
-            curveMeta.vertexCount = (uint32_t)cache.vertexData[0].size();
+            curveMeta.vertexCount = cache.getVertexCount();
             curveMeta.vertexOffset = mCurvePolyTubeVertexCount;
             curveMetadata.push_back(curveMeta);
 
@@ -337,48 +372,24 @@ namespace Falcor
         mpCurvePolyTubeMeshMetadataBuffer = mpDevice->createStructuredBuffer(sizeof(PerMeshMetadata), (uint32_t)meshMetadata.size(), ResourceBindFlags::ShaderResource, MemoryType::DeviceLocal, meshMetadata.data(), false);
         mpCurvePolyTubeMeshMetadataBuffer->setName("AnimatedVertexCache::mpCurvePolyTubeMeshMetadataBuffer");
 
-        // Create buffers for vertex positions in curve vertex caches.
+        // Create buffers for vertex positions in curve vertex caches, one per keyframe or per streaming slot.
         ResourceBindFlags vbBindFlags = ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess;
-        mpCurvePolyTubeVertexBuffers.resize(mCurveKeyframeTimes.size());
-        for (uint32_t i = 0; i < mCurveKeyframeTimes.size(); i++)
+        mpCurvePolyTubeVertexBuffers.resize(getKeyframeBufferCount(mCurvePolyTubeTrack));
+        for (uint32_t i = 0; i < mpCurvePolyTubeVertexBuffers.size(); i++)
         {
             mpCurvePolyTubeVertexBuffers[i] = mpDevice->createStructuredBuffer(sizeof(DynamicCurveVertexData), mCurvePolyTubeVertexCount, vbBindFlags, MemoryType::DeviceLocal, nullptr, false);
             mpCurvePolyTubeVertexBuffers[i]->setName("AnimatedVertexCache::mpCurvePolyTubeVertexBuffers[" + std::to_string(i) + "]");
         }
 
-        // Initialize vertex buffers with cached positions.
-        uint32_t offset = 0;
-        for (size_t i = 0; i < mCachedCurves.size(); i++)
+        // Initialize vertex buffers with cached positions. Streamed keyframes are uploaded on demand.
+        if (!mpKeyframeStreamer)
         {
-            if (mCachedCurves[i].tessellationMode != CurveTessellationMode::PolyTube) continue;
-
-            size_t vertexCount = mCachedCurves[i].vertexData[0].size();
-            uint32_t bufSize = uint32_t(vertexCount * sizeof(DynamicCurveVertexData));
-            uint32_t k = 0;
-            const auto& timeSamples = mCachedCurves[i].timeSamples;
-
+            std::vector<DynamicCurveVertexData> keyframeData;
             for (uint32_t j = 0; j < mCurveKeyframeTimes.size(); j++)
             {
-                while (k + 1 < timeSamples.size() && timeSamples[k] < mCurveKeyframeTimes[j]) k++;
-
-                if (timeSamples[k] == mCurveKeyframeTimes[j])
-                {
-                    mpCurvePolyTubeVertexBuffers[j]->setBlob(mCachedCurves[i].vertexData[k].data(), offset, bufSize);
-                }
-                else
-                {
-                    // Linearly interpolate at the missing keyframe.
-                    float t = float((mCurveKeyframeTimes[j] - timeSamples[k - 1]) / (timeSamples[k] - timeSamples[k - 1]));
-                    std::vector<DynamicCurveVertexData> interpVertices(vertexCount);
-                    for (size_t p = 0; p < vertexCount; p++)
-                    {
-                        interpVertices[p].position = lerp(mCachedCurves[i].vertexData[k - 1][p].position, mCachedCurves[i].vertexData[k][p].position, t);
-                    }
-                    mpCurvePolyTubeVertexBuffers[j]->setBlob(interpVertices.data(), offset, bufSize);
-                }
+                gatherCurveKeyframe(CurveTessellationMode::PolyTube, j, keyframeData);
+                mpCurvePolyTubeVertexBuffers[j]->setBlob(keyframeData.data(), 0, keyframeData.size() * sizeof(DynamicCurveVertexData));
             }
-
-            offset += bufSize;
         }
 
         // Create curve strand index buffer.
@@ -387,7 +398,7 @@ namespace Falcor
         mpCurvePolyTubeStrandIndexBuffer->setName("AnimatedVertexCache::mpCurvePolyTubeStrandIndexBuffer");
 
         // Initialize strand index buffer.
-        offset = 0;
+        uint32_t offset = 0;
         const uint32_t strandLastVertexIndex = 0xffffffff;
         std::vector<uint32_t> strandIndexData(mCurvePolyTubeVertexCount);
         for (uint32_t i = 0; i < (uint32_t)mCachedCurves.size(); i++)
@@ -425,11 +436,12 @@ namespace Falcor
 
     void AnimatedVertexCache::initMeshKeyframes()
     {
-        for (const auto& cache : mCachedMeshes)
+        for (uint32_t i = 0; i < (uint32_t)mCachedMeshes.size(); i++)
         {
+            const auto& cache = mCachedMeshes[i];
             mGlobalMeshAnimationLength = std::max(mGlobalMeshAnimationLength, cache.timeSamples.back());
-            mMeshKeyframeCount += (uint32_t)cache.timeSamples.size();
-            mMaxMeshVertexCount = std::max((uint32_t)cache.vertexData.front().size(), mMaxMeshVertexCount);
+            mMeshKeyframeCount += getKeyframeBufferCount(i);
+            mMaxMeshVertexCount = std::max(cache.getVertexCount(), mMaxMeshVertexCount);
         }
     }
 
@@ -440,27 +452,32 @@ namespace Falcor
         meshMetadata.reserve(mCachedMeshes.size());
 
         uint32_t keyframeOffset = 0;
-        for (auto& cache : mCachedMeshes)
+        std::vector<PackedStaticVertexData> scratch;
+        mMeshKeyframeBufferOffsets.clear();
+        for (uint32_t meshIndex = 0; meshIndex < (uint32_t)mCachedMeshes.size(); meshIndex++)
         {
-            FALCOR_ASSERT(cache.vertexData.front().size() == mpScene->getMesh(cache.meshID).vertexCount);
+            const auto& cache = mCachedMeshes[meshIndex];
+            FALCOR_ASSERT(cache.getVertexCount() == mpScene->getMesh(cache.meshID).vertexCount);
 
             PerMeshMetadata meta;
             meta.keyframeBufferOffset = keyframeOffset;
-            meta.vertexCount = (uint32_t)cache.vertexData.front().size();
+            meta.vertexCount = cache.getVertexCount();
             meta.sceneVbOffset = mpScene->getMesh(cache.meshID).vbOffset;
             meta.prevVbOffset = mpScene->getMesh(cache.meshID).prevVbOffset;
             meshMetadata.push_back(meta);
+            mMeshKeyframeBufferOffsets.push_back(keyframeOffset);
 
-            // Create vertex buffer for each keyframe on this mesh
-            for (size_t i = 0; i < cache.vertexData.size(); i++)
+            // Create vertex buffer for each keyframe on this mesh, or for each streaming slot. Streamed keyframes are uploaded on demand.
+            const uint32_t bufferCount = getKeyframeBufferCount(meshIndex);
+            for (uint32_t i = 0; i < bufferCount; i++)
             {
-                auto& data = cache.vertexData[i];
+                const void* pData = mpKeyframeStreamer ? nullptr : cache.getKeyframe(i, scratch);
                 size_t index = keyframeOffset + i;
-                mpMeshVertexBuffers[index] = mpDevice->createStructuredBuffer(sizeof(PackedStaticVertexData), (uint32_t)data.size(), ResourceBindFlags::ShaderResource, MemoryType::DeviceLocal, data.data(), false);
+                mpMeshVertexBuffers[index] = mpDevice->createStructuredBuffer(sizeof(PackedStaticVertexData), meta.vertexCount, ResourceBindFlags::ShaderResource, MemoryType::DeviceLocal, pData, false);
                 mpMeshVertexBuffers[index]->setName("AnimatedVertexCache::mpMeshVertexBuffers[" + std::to_string(index) + "]");
             }
 
-            keyframeOffset += (uint32_t)cache.timeSamples.size();
+            keyframeOffset += bufferCount;
         }
 
         mpMeshMetadataBuffer = mpDevice->createStructuredBuffer(sizeof(PerMeshMetadata), (uint32_t)meshMetadata.size(), ResourceBindFlags::ShaderResource, MemoryType::DeviceLocal, meshMetadata.data(), false);
@@ -494,14 +511,14 @@ namespace Falcor
         FALCOR_ASSERT(mCurveLSSCount > 0);
 
         DefineList defines;
-        defines.add("CURVE_KEYFRAME_COUNT", std::to_string(mCurveKeyframeTimes.size()));
+        defines.add("CURVE_KEYFRAME_COUNT", std::to_string(mpCurveVertexBuffers.size()));
         mpCurveVertexUpdatePass = ComputePass::create(mpDevice, kUpdateCurveVerticesFilename, "main", defines);
 
         auto block = mpCurveVertexUpdatePass->getRootVar()["gCurveVertexUpdater"];
         auto var = block["curvePerKeyframe"];
 
         // Bind curve vertex data.
-        for (uint32_t i = 0; i < mCurveKeyframeTimes.size(); i++) var[i]["vertexData"] = mpCurveVertexBuffers[i];
+        for (uint32_t i = 0; i < mpCurveVertexBuffers.size(); i++) var[i]["vertexData"] = mpCurveVertexBuffers[i];
     }
 
     void AnimatedVertexCache::createCurveLSSAABBUpdatePass()
@@ -519,7 +536,7 @@ namespace Falcor
         FALCOR_ASSERT(mCurvePolyTubeCount > 0);
 
         DefineList defines;
-        defines.add("CURVE_KEYFRAME_COUNT", std::to_string(mCurveKeyframeTimes.size()));
+        defines.add("CURVE_KEYFRAME_COUNT", std::to_string(mpCurvePolyTubeVertexBuffers.size()));
         mpCurvePolyTubeVertexUpdatePass = ComputePass::create(mpDevice, kUpdateCurvePolyTubeVerticesFilename, "main", defines);
 
         auto block = mpCurvePolyTubeVertexUpdatePass->getRootVar()["gCurvePolyTubeVertexUpdater"];
@@ -529,7 +546,92 @@ namespace Falcor
         auto var = block["curvePerKeyframe"];
 
         // Bind curve vertex data.
-        for (uint32_t i = 0; i < mCurveKeyframeTimes.size(); i++) var[i]["vertexData"] = mpCurvePolyTubeVertexBuffers[i];
+        for (uint32_t i = 0; i < mpCurvePolyTubeVertexBuffers.size(); i++) var[i]["vertexData"] = mpCurvePolyTubeVertexBuffers[i];
+    }
+
+    void AnimatedVertexCache::initKeyframeStreaming(const VertexCacheStreamingOptions& options)
+    {
+        // One track per cached mesh, followed by one track for each curve tessellation mode in use.
+        std::vector<KeyframeFile::TrackDesc> tracks;
+        for (const auto& cache : mCachedMeshes)
+        {
+            KeyframeFile::TrackDesc track;
+            track.keyframeCount = cache.getKeyframeCount();
+            track.keyframeSize = uint64_t(cache.getVertexCount()) * sizeof(PackedStaticVertexData);
+            tracks.push_back(track);
+        }
+
+        auto addCurveTrack = [&](CurveTessellationMode mode)
+        {
+            uint64_t vertexCount = 0;
+            for (const auto& cache : mCachedCurves)
+            {
+                if (cache.tessellationMode == mode) vertexCount += cache.getVertexCount();
+            }
+
+            KeyframeFile::TrackDesc track;
+            track.keyframeCount = (uint32_t)mCurveKeyframeTimes.size();
+            track.keyframeSize = vertexCount * sizeof(DynamicCurveVertexData);
+            tracks.push_back(track);
+        };
+        if (mCurveLSSCount > 0) addCurveTrack(CurveTessellationMode::LinearSweptSphere);
+        if (mCurvePolyTubeCount > 0) addCurveTrack(CurveTessellationMode::PolyTube);
+        FALCOR_ASSERT(tracks.size() == mCurvePolyTubeTrack + (mCurvePolyTubeCount > 0 ? 1 : 0));
+
+        // Keyframes are read from the cached data, which reads them from the scene cache if loaded from there.
+        // Curve keyframes are resampled at the aligned keyframe times.
+        auto read = [this, tracks](uint32_t track, uint32_t keyframe, void* pDst)
+        {
+            const size_t size = tracks[track].keyframeSize;
+            if (track < mCachedMeshes.size())
+            {
+                std::vector<PackedStaticVertexData> scratch;
+                std::memcpy(pDst, mCachedMeshes[track].getKeyframe(keyframe, scratch), size);
+                return;
+            }
+
+            auto mode = (mCurveLSSCount > 0 && track == mCurveLSSTrack) ? CurveTessellationMode::LinearSweptSphere : CurveTessellationMode::PolyTube;
+            std::vector<DynamicCurveVertexData> vertexData;
+            gatherCurveKeyframe(mode, keyframe, vertexData);
+            FALCOR_ASSERT(vertexData.size() * sizeof(DynamicCurveVertexData) == size);
+            std::memcpy(pDst, vertexData.data(), size);
+        };
+
+        // Compressed keyframes are small enough to be streamed from memory.
+        bool onDisk = true;
+        for (const auto& cache : mCachedMeshes) onDisk = onDisk && (cache.pKeyframeFile != nullptr || !cache.compressedVertexData.empty());
+        for (const auto& cache : mCachedCurves) onDisk = onDisk && (cache.pKeyframeFile != nullptr || !cache.compressedVertexData.empty());
+        if (!onDisk) logWarning("AnimatedVertexCache: Streaming keyframes held in memory. See SceneCache::offloadKeyframes() for reading them from disk.");
+
+        KeyframeStreamer::Options streamerOptions;
+        streamerOptions.windowSize = options.windowSize;
+        streamerOptions.prefetchCount = options.prefetchCount;
+        mpKeyframeStreamer = std::make_unique<KeyframeStreamer>(tracks, read, streamerOptions);
+
+        logInfo("AnimatedVertexCache: Streaming {} keyframe tracks with a window of {} keyframes.", tracks.size(), options.windowSize);
+    }
+
+    uint32_t AnimatedVertexCache::getKeyframeBufferCount(uint32_t track) const
+    {
+        if (mpKeyframeStreamer) return mpKeyframeStreamer->getSlotCount(track);
+        return track < mCachedMeshes.size() ? (uint32_t)mCachedMeshes[track].timeSamples.size() : (uint32_t)mCurveKeyframeTimes.size();
+    }
+
+    InterpolationInfo AnimatedVertexCache::streamKeyframes(uint32_t track, const InterpolationInfo& info)
+    {
+        if (!mpKeyframeStreamer) return info;
+
+        // Replace keyframe indices by the indices of the streaming slots holding the keyframes.
+        InterpolationInfo slotInfo = info;
+        slotInfo.keyframeIndices = mpKeyframeStreamer->update(track, info.keyframeIndices, [this](uint32_t track, uint32_t slot, const void* pData, size_t size)
+        {
+            ref<Buffer> pBuffer;
+            if (track < mCachedMeshes.size()) pBuffer = mpMeshVertexBuffers[mMeshKeyframeBufferOffsets[track] + slot];
+            else if (mCurveLSSCount > 0 && track == mCurveLSSTrack) pBuffer = mpCurveVertexBuffers[slot];
+            else pBuffer = mpCurvePolyTubeVertexBuffers[slot];
+            pBuffer->setBlob(pData, 0, size);
+        });
+        return slotInfo;
     }
 
 
@@ -544,6 +646,7 @@ namespace Falcor
         {
             auto postInfinityBehavior = mLoopAnimations ? Animation::Behavior::Cycle : Animation::Behavior::Constant;
             mMeshInterpolationInfo[i] = calculateInterpolation(t, mCachedMeshes[i].timeSamples, mPreInfinityBehavior, postInfinityBehavior);
+            if (!copyPrev) mMeshInterpolationInfo[i] = streamKeyframes((uint32_t)i, mMeshInterpolationInfo[i]);
         }
 
         mpMeshInterpolationBuffer->setBlob(mMeshInterpolationInfo.data(), 0, mpMeshInterpolationBuffer->getSize());
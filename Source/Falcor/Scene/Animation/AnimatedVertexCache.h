@@ -27,7 +27,9 @@
  **************************************************************************/
 #pragma once
 #include "Animation.h"
+#include "KeyframeCompression.h"
 #include "SharedTypes.slang"
+#include "VertexCacheStreaming.h"
 #include "Core/API/Buffer.h"
 #include "Core/Pass/ComputePass.h"
 #include "Scene/Curves/CurveConfig.h"
@@ -37,6 +39,7 @@
 
 #include <algorithm>
 #include <limits>
+#include <memory>
 #include <vector>
 
 namespace Falcor
@@ -58,6 +61,49 @@ namespace Falcor
 
         // vertexData[i][j] represents at the i-th keyframe, the cache data of the j-th vertex.
         std::vector<std::vector<DynamicCurveVertexData>> vertexData;
+
+        // Compressed keyframes, used instead of vertexData if not empty.
+        CompressedKeyframes compressedVertexData;
+
+        // Keyframes read on demand from a keyframe file (e.g. the scene cache), used instead of the above if set.
+        std::shared_ptr<const KeyframeFile> pKeyframeFile;
+        uint32_t keyframeTrack = 0;     ///< Track holding the keyframes in pKeyframeFile.
+
+        uint32_t getKeyframeCount() const
+        {
+            if (pKeyframeFile) return pKeyframeFile->getTrack(keyframeTrack).keyframeCount;
+            return compressedVertexData.empty() ? (uint32_t)vertexData.size() : compressedVertexData.getKeyframeCount();
+        }
+
+        uint32_t getVertexCount() const
+        {
+            if (pKeyframeFile) return (uint32_t)(pKeyframeFile->getTrack(keyframeTrack).keyframeSize / sizeof(DynamicCurveVertexData));
+            return compressedVertexData.empty() ? (uint32_t)vertexData.front().size() : compressedVertexData.getVertexCount();
+        }
+
+        /** Get the vertices of a keyframe, which are read or decoded into the scratch buffer unless held in vertexData.
+        */
+        const DynamicCurveVertexData* getKeyframe(uint32_t keyframe, std::vector<DynamicCurveVertexData>& scratch) const
+        {
+            if (pKeyframeFile)
+            {
+                scratch.resize(getVertexCount());
+                pKeyframeFile->readKeyframe(keyframeTrack, keyframe, scratch.data());
+                return scratch.data();
+            }
+            if (compressedVertexData.empty()) return vertexData[keyframe].data();
+            compressedVertexData.decode(keyframe, scratch);
+            return scratch.data();
+        }
+
+        /** Replace the keyframes by compressed keyframes.
+        */
+        void compress(float relativeErrorBound)
+        {
+            if (vertexData.empty()) return;
+            compressedVertexData = CompressedKeyframes::compress(vertexData, relativeErrorBound);
+            vertexData = {};
+        }
     };
 
     struct CachedMesh
@@ -68,13 +114,64 @@ namespace Falcor
 
         // vertexData[i][j] represents at the i-th keyframe, the cache data of the j-th vertex.
         std::vector<std::vector<PackedStaticVertexData>> vertexData;
+
+        // Compressed keyframes, used instead of vertexData if not empty.
+        CompressedKeyframes compressedVertexData;
+
+        // Keyframes read on demand from a keyframe file (e.g. the scene cache), used instead of the above if set.
+        std::shared_ptr<const KeyframeFile> pKeyframeFile;
+        uint32_t keyframeTrack = 0;     ///< Track holding the keyframes in pKeyframeFile.
+
+        uint32_t getKeyframeCount() const
+        {
+            if (pKeyframeFile) return pKeyframeFile->getTrack(keyframeTrack).keyframeCount;
+            return compressedVertexData.empty() ? (uint32_t)vertexData.size() : compressedVertexData.getKeyframeCount();
+        }
+
+        uint32_t getVertexCount() const
+        {
+            if (pKeyframeFile) return (uint32_t)(pKeyframeFile->getTrack(keyframeTrack).keyframeSize / sizeof(PackedStaticVertexData));
+            return compressedVertexData.empty() ? (uint32_t)vertexData.front().size() : compressedVertexData.getVertexCount();
+        }
+
+        /** Get the vertices of a keyframe, which are read or decoded into the scratch buffer unless held in vertexData.
+        */
+        const PackedStaticVertexData* getKeyframe(uint32_t keyframe, std::vector<PackedStaticVertexData>& scratch) const
+        {
+            if (pKeyframeFile)
+            {
+                scratch.resize(getVertexCount());
+                pKeyframeFile->readKeyframe(keyframeTrack, keyframe, scratch.data());
+                return scratch.data();
+            }
+            if (compressedVertexData.empty()) return vertexData[keyframe].data();
+            compressedVertexData.decode(keyframe, scratch);
+            return scratch.data();
+        }
+
+        /** Replace the keyframes by compressed keyframes.
+        */
+        void compress(float relativeErrorBound)
+        {
+            if (vertexData.empty()) return;
+            compressedVertexData = CompressedKeyframes::compress(vertexData, relativeErrorBound);
+            vertexData = {};
+        }
     };
 
+    /** Plays back cached vertex animations of meshes and curves by interpolating keyframes on the GPU.
+
+        By default all keyframes are uploaded to GPU buffers at creation. With streaming enabled, each animated mesh,
+        and each set of linear swept sphere and poly-tube curves, only keeps a window of keyframes around the current
+        time in GPU memory, and upcoming keyframes are prefetched asynchronously. See KeyframeStreamer. Keyframes are
+        read from the cached meshes and curves, which read them on demand from the scene cache (or a keyframe file)
+        when set up by SceneCache, so the full set of keyframes is never held in CPU memory.
+    */
     class FALCOR_API AnimatedVertexCache
     {
     public:
-        AnimatedVertexCache(ref<Device> pDevice, Scene* pScene, const ref<Buffer>& pPrevVertexData, std::vector<CachedCurve>&& cachedCurves, std::vector<CachedMesh>&& cachedMeshes);
-        ~AnimatedVertexCache() = default;
+        AnimatedVertexCache(ref<Device> pDevice, Scene* pScene, const ref<Buffer>& pPrevVertexData, std::vector<CachedCurve>&& cachedCurves, std::vector<CachedMesh>&& cachedMeshes, const VertexCacheStreamingOptions& streamingOptions = {});
+        ~AnimatedVertexCache();
 
         void setIsLooped(bool looped) { mLoopAnimations = looped; }
 
@@ -98,8 +195,13 @@ namespace Falcor
 
         uint64_t getMemoryUsageInBytes() const;
 
+        /** Get the keyframe streamer, or nullptr if streaming is disabled.
+        */
+        const KeyframeStreamer* getKeyframeStreamer() const { return mpKeyframeStreamer.get(); }
+
     private:
         void initCurveKeyframes();
+        void gatherCurveKeyframe(CurveTessellationMode mode, uint32_t keyframe, std::vector<DynamicCurveVertexData>& vertexData) const;
         void bindCurveLSSBuffers();
         void bindCurvePolyTubeBuffers();
 
@@ -112,6 +214,10 @@ namespace Falcor
 
         void createMeshVertexUpdatePass();
 
+        void initKeyframeStreaming(const VertexCacheStreamingOptions& options);
+        uint32_t getKeyframeBufferCount(uint32_t track) const;
+        InterpolationInfo streamKeyframes(uint32_t track, const InterpolationInfo& info);
+
         void executeMeshVertexUpdatePass(RenderContext* pContext, double t, bool copyPrev = false);
 
         // Interpolate vertex positions.
@@ -174,5 +280,11 @@ namespace Falcor
         std::vector<ref<Buffer>> mpMeshVertexBuffers;
         ref<Buffer> mpMeshInterpolationBuffer;
         ref<Buffer> mpMeshMetadataBuffer;
+        std::vector<uint32_t> mMeshKeyframeBufferOffsets; ///< Index of the first keyframe buffer of each mesh.
+
+        // Keyframe streaming. Tracks are the cached meshes in order, followed by the LSS and poly-tube curves if present.
+        std::unique_ptr<KeyframeStreamer> mpKeyframeStreamer;
+        uint32_t mCurveLSSTrack = 0;
+        uint32_t mCurvePolyTubeTrack = 0;
     };
 }
@@ -112,6 +112,18 @@ namespace Falcor
     {}
 
     float4x4 Animation::animate(double currentTime)
+    {
+        Keyframe interpolated = evaluate(currentTime, mCachedFrameIndex);
+
+        float4x4 T = math::matrixFromTranslation(interpolated.translation);
+        float4x4 R = math::matrixFromQuat(interpolated.rotation);
+        float4x4 S = math::matrixFromScaling(interpolated.scaling);
+        float4x4 transform = mul(mul(T, R), S);
+
+        return transform;
+    }
+
+    Animation::Keyframe Animation::evaluate(double currentTime, size_t& frameIndex) const
     {
         // Calculate the sample time.
         double time = currentTime;
@@ -124,43 +136,34 @@ namespace Falcor
         bool isLinearPostInfinity = time > mKeyframes.back().time && this->getPostInfinityBehavior() == Behavior::Linear;
         bool isLinearPreInfinity = time < mKeyframes.front().time && this->getPreInfinityBehavior() == Behavior::Linear;
 
-        Keyframe interpolated;
-
         if (isLinearPreInfinity && mKeyframes.size() > 1)
         {
             const auto& k0 = mKeyframes.front();
-            auto k1 = interpolate(mInterpolationMode, k0.time + kEpsilonTime);
+            auto k1 = interpolate(mInterpolationMode, k0.time + kEpsilonTime, frameIndex);
             double segmentDuration = k1.time - k0.time;
             float t = (float)((time - k0.time) / segmentDuration);
-            interpolated = interpolateLinear(k0, k1, t);
+            return interpolateLinear(k0, k1, t);
         }
         else if (isLinearPostInfinity && mKeyframes.size() > 1)
         {
             const auto& k1 = mKeyframes.back();
-            auto k0 = interpolate(mInterpolationMode, k1.time - kEpsilonTime);
+            auto k0 = interpolate(mInterpolationMode, k1.time - kEpsilonTime, frameIndex);
             double segmentDuration = k1.time - k0.time;
             float t = (float)((time - k0.time) / segmentDuration);
-            interpolated = interpolateLinear(k0, k1, t);
+            return interpolateLinear(k0, k1, t);
         }
         else
         {
-            interpolated = interpolate(mInterpolationMode, time);
+            return interpolate(mInterpolationMode, time, frameIndex);
         }
-
-        float4x4 T = math::matrixFromTranslation(interpolated.translation);
-        float4x4 R = math::matrixFromQuat(interpolated.rotation);
-        float4x4 S = math::matrixFromScaling(interpolated.scaling);
-        float4x4 transform = mul(mul(T, R), S);
-
-        return transform;
     }
 
-    Animation::Keyframe Animation::interpolate(InterpolationMode mode, double time) const
+    Animation::Keyframe Animation::interpolate(InterpolationMode mode, double time, size_t& cachedFrameIndex) const
     {
         FALCOR_ASSERT(!mKeyframes.empty());
 
         // Validate cached frame index.
-        size_t frameIndex = std::clamp(mCachedFrameIndex, (size_t)0, mKeyframes.size() - 1);
+        size_t frameIndex = std::clamp(cachedFrameIndex, (size_t)0, mKeyframes.size() - 1);
         if (time < mKeyframes[frameIndex].time) frameIndex = 0;
 
         // Find frame index.
@@ -171,7 +174,7 @@ namespace Falcor
         }
 
         // Cache frame index;
-        mCachedFrameIndex = frameIndex;
+        cachedFrameIndex = frameIndex;
 
         // Compute index of adjacent frame including optional warping.
         auto adjacentFrame = [this] (size_t frame, int32_t offset = 1)
@@ -222,7 +225,7 @@ namespace Falcor
     // the animation does not behave linearly. If the animation behaves linearly, then the
     // current time is returned. This function should not be used if the current time lies
     // within the range of defined keyframe times.
-    double Animation::calcSampleTime(double currentTime)
+    double Animation::calcSampleTime(double currentTime) const
     {
         double modifiedTime = currentTime;
         double firstKeyframeTime = mKeyframes.front().time;
@@ -256,6 +259,7 @@ namespace Falcor
     void Animation::addKeyframe(const Keyframe& keyframe)
     {
         FALCOR_ASSERT(keyframe.time <= mDuration);
+        mVersion++;
 
         if (mKeyframes.size() == 0 || mKeyframes[0].time > keyframe.time)
         {
@@ -86,7 +86,7 @@ namespace Falcor
 
         /** Set the animated node.
         */
-        void setNodeID(NodeID id) { mNodeID = id; }
+        void setNodeID(NodeID id) { mNodeID = id; mVersion++; }
 
         /** Get the animation duration in seconds.
         */
@@ -143,19 +143,40 @@ namespace Falcor
         */
         bool doesKeyframeExists(double time) const;
 
+        /** Get all keyframes, sorted by time.
+        */
+        const std::vector<Keyframe>& getKeyframes() const { return mKeyframes; }
+
+        /** Get the version of the keyframes and node ID.
+            The version is incremented whenever they are edited, so that copies of them (see AnimationBatch) can be refreshed.
+        */
+        uint32_t getVersion() const { return mVersion; }
+
         /** Compute the animation.
             \param time The current time in seconds. This can be larger then the animation time, in which case the animation will loop.
             \return Returns the animation's transform matrix for the specified time.
         */
         float4x4 animate(double currentTime);
 
+        /** Compute the interpolated keyframe without changing the animation's state.
+            \param[in] currentTime The current time in seconds.
+            \param[in,out] frameIndex Index of the keyframe found by the previous call, used as the starting point of the keyframe search.
+            \return Returns the interpolated keyframe.
+        */
+        Keyframe evaluate(double currentTime, size_t& frameIndex) const;
+
+        /** Calculate the time at which the keyframes are sampled for a time outside of the keyframe range, based on the pre/post-infinity behavior.
+            \param[in] currentTime The current time in seconds. Must lie outside of the keyframe range.
+            \return Returns the sample time, or the current time if the animation behaves linearly.
+        */
+        double calcSampleTime(double currentTime) const;
+
         /* Render the UI.
         */
         void renderUI(Gui::Widgets& widget);
 
     private:
-        Keyframe interpolate(InterpolationMode mode, double time) const;
-        double calcSampleTime(double currentTime);
+        Keyframe interpolate(InterpolationMode mode, double time, size_t& cachedFrameIndex) const;
 
         std::string mName;
         NodeID mNodeID;
@@ -168,7 +189,8 @@ namespace Falcor
         bool mEnableWarping = false;
 
         std::vector<Keyframe> mKeyframes;
-        mutable size_t mCachedFrameIndex = 0;
+        size_t mCachedFrameIndex = 0;
+        uint32_t mVersion = 0;
 
         friend class SceneCache;
     };
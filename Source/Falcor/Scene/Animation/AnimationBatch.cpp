@@ -0,0 +1,257 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "AnimationBatch.h"
+#include "Core/Error.h"
+#include "Utils/NumericRange.h"
+#include "Utils/Math/Common.h"
+#include <algorithm>
+#include <cstring>
+#include <execution>
+#include <limits>
+#include <unordered_set>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kInvalidIndex = std::numeric_limits<uint32_t>::max();
+
+        /// Number of channels evaluated per task. Small enough to keep the per-channel arrays of a task in cache.
+        const uint32_t kChannelsPerTask = 1024;
+
+        /// Minimum number of nodes on a scene graph level to update the level in parallel.
+        const size_t kMinParallelLevelNodeCount = 1024;
+
+        /** Find the last keyframe at or before the given time, or the first keyframe if there is none.
+            This returns the same keyframe as the search in Animation::interpolate(). The cached keyframe and its
+            successor are checked first, which covers sequential playback.
+        */
+        uint32_t findKeyframe(const double* times, uint32_t count, uint32_t cachedIndex, double time)
+        {
+            uint32_t i = std::min(cachedIndex, count - 1);
+            if (times[i] <= time)
+            {
+                if (i + 1 == count || times[i + 1] > time) return i;
+                if (i + 2 == count || times[i + 2] > time) return i + 1;
+            }
+
+            const double* it = std::upper_bound(times, times + count, time);
+            return it == times ? 0 : (uint32_t)(it - times) - 1;
+        }
+
+        /// Sum the versions of a list of animations.
+        uint64_t getTotalVersion(const std::vector<ref<Animation>>& animations)
+        {
+            uint64_t version = 0;
+            for (const auto& pAnimation : animations)
+            {
+                if (pAnimation) version += pAnimation->getVersion();
+            }
+            return version;
+        }
+
+        /// Compose the matrix T * R * S. This gives the same result as multiplying the individual matrices.
+        float4x4 composeMatrix(const float3& t, const quatf& r, const float3& s)
+        {
+            float3x3 R = math::matrixFromQuat(r);
+
+            // clang-format off
+            return float4x4{
+                R[0][0] * s.x,  R[0][1] * s.y,  R[0][2] * s.z,  t.x,    // row 0
+                R[1][0] * s.x,  R[1][1] * s.y,  R[1][2] * s.z,  t.y,    // row 1
+                R[2][0] * s.x,  R[2][1] * s.y,  R[2][2] * s.z,  t.z,    // row 2
+                0.f,            0.f,            0.f,            1.f     // row 3
+            };
+            // clang-format on
+        }
+    }
+
+    AnimationBatch::AnimationBatch(const std::vector<ref<Animation>>& animations)
+        : mSourceCount(animations.size())
+        , mSourceVersion(getTotalVersion(animations))
+    {
+        // Keep the last animation of each node, which overrides the others.
+        std::unordered_set<uint32_t> animatedNodes;
+        for (auto it = animations.rbegin(); it != animations.rend(); ++it)
+        {
+            const auto& pAnimation = *it;
+            if (!pAnimation || pAnimation->getKeyframes().empty()) continue;
+            if (!animatedNodes.insert(pAnimation->getNodeID().get()).second) continue;
+            mAnimations.push_back(pAnimation);
+        }
+        std::reverse(mAnimations.begin(), mAnimations.end());
+
+        // Copy keyframes into the structure-of-arrays layout.
+        mNodeIDs.reserve(mAnimations.size());
+        mKeyframeOffsets.reserve(mAnimations.size() + 1);
+        for (const auto& pAnimation : mAnimations)
+        {
+            mNodeIDs.push_back(pAnimation->getNodeID());
+            mKeyframeOffsets.push_back((uint32_t)mKeyframeTimes.size());
+            for (const auto& keyframe : pAnimation->getKeyframes())
+            {
+                mKeyframeTimes.push_back(keyframe.time);
+                mKeyframeTranslations.push_back(keyframe.translation);
+                mKeyframeRotations.push_back(keyframe.rotation);
+                mKeyframeScalings.push_back(keyframe.scaling);
+            }
+        }
+        FALCOR_CHECK(mKeyframeTimes.size() < kInvalidIndex, "Too many keyframes ({}).", mKeyframeTimes.size());
+        mKeyframeOffsets.push_back((uint32_t)mKeyframeTimes.size());
+
+        const size_t channelCount = mAnimations.size();
+        mCachedFrameIndices.resize(channelCount, 0);
+        mSegmentStarts.resize(channelCount);
+        mSegmentEnds.resize(channelCount);
+        mWeights.resize(channelCount);
+        mTranslations.resize(channelCount);
+        mRotations.resize(channelCount);
+        mScalings.resize(channelCount);
+        mChanged.resize(channelCount, 0);
+    }
+
+    bool AnimationBatch::isUpToDate(const std::vector<ref<Animation>>& animations) const
+    {
+        // Versions only increase, so the sum changes whenever any animation is edited.
+        return animations.size() == mSourceCount && getTotalVersion(animations) == mSourceVersion;
+    }
+
+    void AnimationBatch::evaluate(double time, std::vector<float4x4>& localMatrices)
+    {
+        const uint32_t channelCount = getChannelCount();
+        const uint32_t taskCount = div_round_up(channelCount, kChannelsPerTask);
+        auto task = [&](uint32_t i) { evaluateRange(time, i * kChannelsPerTask, std::min((i + 1) * kChannelsPerTask, channelCount), localMatrices); };
+        auto range = NumericRange<uint32_t>(0, taskCount);
+        if (taskCount > 1) std::for_each(std::execution::par, range.begin(), range.end(), task);
+        else if (taskCount == 1) task(0);
+    }
+
+    void AnimationBatch::evaluateRange(double time, uint32_t begin, uint32_t end, std::vector<float4x4>& localMatrices)
+    {
+        // Find the interpolated keyframe segment of each channel.
+        // This follows Animation::evaluate(), which evaluates the rare channels that are not linearly interpolated between two keyframes.
+        for (uint32_t c = begin; c < end; c++)
+        {
+            const Animation& animation = *mAnimations[c];
+            const uint32_t offset = mKeyframeOffsets[c];
+            const uint32_t count = mKeyframeOffsets[c + 1] - offset;
+            const double* times = &mKeyframeTimes[offset];
+
+            double sampleTime = time;
+            if (time < times[0] || time > times[count - 1]) sampleTime = animation.calcSampleTime(time);
+
+            bool isLinearPostInfinity = sampleTime > times[count - 1] && animation.getPostInfinityBehavior() == Animation::Behavior::Linear;
+            bool isLinearPreInfinity = sampleTime < times[0] && animation.getPreInfinityBehavior() == Animation::Behavior::Linear;
+            bool isHermite = animation.getInterpolationMode() == Animation::InterpolationMode::Hermite && count >= 4;
+
+            if (((isLinearPreInfinity || isLinearPostInfinity) && count > 1) || isHermite)
+            {
+                size_t frameIndex = mCachedFrameIndices[c];
+                Animation::Keyframe keyframe = animation.evaluate(time, frameIndex);
+                mCachedFrameIndices[c] = (uint32_t)frameIndex;
+                mSegmentStarts[c] = kInvalidIndex;
+                mTranslations[c] = keyframe.translation;
+                mRotations[c] = keyframe.rotation;
+                mScalings[c] = keyframe.scaling;
+                continue;
+            }
+
+            const uint32_t i0 = findKeyframe(times, count, mCachedFrameIndices[c], sampleTime);
+            const bool warping = animation.isWarpingEnabled();
+            const uint32_t i1 = warping ? (i0 + 1) % count : std::min(i0 + 1, count - 1);
+            mCachedFrameIndices[c] = i0;
+
+            double segmentDuration = times[i1] - times[i0];
+            if (warping && segmentDuration < 0.0) segmentDuration += animation.getDuration();
+            mWeights[c] = (float)std::clamp(segmentDuration > 0.0 ? (sampleTime - times[i0]) / segmentDuration : 1.0, 0.0, 1.0);
+            mSegmentStarts[c] = offset + i0;
+            mSegmentEnds[c] = offset + i1;
+        }
+
+        // Interpolate translation, rotation and scaling.
+        for (uint32_t c = begin; c < end; c++)
+        {
+            if (mSegmentStarts[c] == kInvalidIndex) continue;
+            mTranslations[c] = lerp(mKeyframeTranslations[mSegmentStarts[c]], mKeyframeTranslations[mSegmentEnds[c]], mWeights[c]);
+        }
+        for (uint32_t c = begin; c < end; c++)
+        {
+            if (mSegmentStarts[c] == kInvalidIndex) continue;
+            mRotations[c] = slerp(mKeyframeRotations[mSegmentStarts[c]], mKeyframeRotations[mSegmentEnds[c]], mWeights[c]);
+        }
+        for (uint32_t c = begin; c < end; c++)
+        {
+            if (mSegmentStarts[c] == kInvalidIndex) continue;
+            mScalings[c] = lerp(mKeyframeScalings[mSegmentStarts[c]], mKeyframeScalings[mSegmentEnds[c]], mWeights[c]);
+        }
+
+        // Compose the local matrices and detect which ones changed.
+        for (uint32_t c = begin; c < end; c++)
+        {
+            FALCOR_ASSERT(mNodeIDs[c].get() < localMatrices.size());
+            float4x4 matrix = composeMatrix(mTranslations[c], mRotations[c], mScalings[c]);
+            float4x4& localMatrix = localMatrices[mNodeIDs[c].get()];
+            mChanged[c] = std::memcmp(&matrix, &localMatrix, sizeof(float4x4)) != 0;
+            localMatrix = matrix;
+        }
+    }
+
+    SceneGraphLevels::SceneGraphLevels(const std::vector<NodeID>& parents)
+    {
+        // Compute the depth of each node. Parents are stored before their children.
+        std::vector<uint32_t> levels(parents.size(), 0);
+        uint32_t levelCount = parents.empty() ? 0 : 1;
+        for (size_t i = 0; i < parents.size(); i++)
+        {
+            if (parents[i] == NodeID::Invalid()) continue;
+            FALCOR_CHECK(parents[i].get() < i, "Scene graph node {} is stored before its parent {}.", i, parents[i].get());
+            levels[i] = levels[parents[i].get()] + 1;
+            levelCount = std::max(levelCount, levels[i] + 1);
+        }
+
+        // Sort nodes by level, keeping the node order within each level.
+        mLevelOffsets.assign(levelCount + 1, 0);
+        for (uint32_t level : levels) mLevelOffsets[level + 1]++;
+        for (uint32_t level = 0; level < levelCount; level++) mLevelOffsets[level + 1] += mLevelOffsets[level];
+
+        mNodes.resize(parents.size());
+        std::vector<uint32_t> cursors(mLevelOffsets.begin(), mLevelOffsets.end() - 1);
+        for (uint32_t i = 0; i < (uint32_t)parents.size(); i++) mNodes[cursors[levels[i]]++] = i;
+    }
+
+    void SceneGraphLevels::forEachNode(const std::function<void(uint32_t)>& func) const
+    {
+        for (uint32_t level = 0; level < getLevelCount(); level++)
+        {
+            auto begin = mNodes.begin() + mLevelOffsets[level];
+            auto end = mNodes.begin() + mLevelOffsets[level + 1];
+            if (end - begin >= (ptrdiff_t)kMinParallelLevelNodeCount) std::for_each(std::execution::par, begin, end, func);
+            else std::for_each(begin, end, func);
+        }
+    }
+}
@@ -0,0 +1,163 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Animation.h"
+#include "Core/Macros.h"
+#include "Scene/SceneIDs.h"
+#include "Utils/Math/Matrix.h"
+#include "Utils/Math/Quaternion.h"
+#include "Utils/Math/Vector.h"
+#include <functional>
+#include <vector>
+
+namespace Falcor
+{
+    /** Evaluates a set of animations together.
+
+        The keyframes of all animations are copied into a structure-of-arrays layout, with separate arrays for the times,
+        translations, rotations and scalings. Each animation becomes a channel. Channels are evaluated in parallel over
+        ranges of channels. Within a range, the keyframe segment and interpolation weight of all channels are found first.
+        Then translation, rotation and scaling are interpolated in separate loops over contiguous arrays. Finally the
+        local matrices are composed.
+
+        Each channel caches the index of the keyframe found in the last evaluation, so the keyframe search is O(1)
+        during sequential playback.
+
+        Channels using Hermite interpolation or linear pre/post-infinity extrapolation are rare. They are evaluated by
+        Animation::evaluate() as part of the segment pass.
+
+        Each evaluation records which channels changed their local matrix, so that unchanged nodes (e.g. animations
+        holding their last keyframe) do not trigger updates of their subtrees.
+
+        The results match Animation::animate(). The keyframes, node IDs and duration are captured at construction, so the
+        batch has to be recreated when they are edited (see isUpToDate()). The interpolation mode, warping and
+        pre/post-infinity behaviors are read from the animations at each evaluation.
+    */
+    class FALCOR_API AnimationBatch
+    {
+    public:
+        AnimationBatch() = default;
+
+        /** Create a batch of animations.
+            Animations without keyframes are ignored. If several animations target the same node, only the last one is
+            evaluated, since it overrides the others.
+            \param[in] animations List of animations.
+        */
+        AnimationBatch(const std::vector<ref<Animation>>& animations);
+
+        /** Check if the batch matches the current keyframes and node IDs of a list of animations.
+            This is cheap enough to be called every frame.
+            \param[in] animations List of animations the batch was created from.
+            \return False if the list or any of its animations was edited since the batch was created.
+        */
+        bool isUpToDate(const std::vector<ref<Animation>>& animations) const;
+
+        /** Get the number of evaluated channels.
+        */
+        uint32_t getChannelCount() const { return (uint32_t)mAnimations.size(); }
+
+        /** Get the animated node of each channel.
+        */
+        const std::vector<NodeID>& getNodeIDs() const { return mNodeIDs; }
+
+        /** Check if the local matrix of a channel changed in the last evaluation.
+        */
+        bool isChannelChanged(uint32_t channel) const { return mChanged[channel] != 0; }
+
+        /** Evaluate all channels.
+            \param[in] time The current time in seconds.
+            \param[in,out] localMatrices Local matrix of each scene graph node. The matrices of the animated nodes are overwritten.
+        */
+        void evaluate(double time, std::vector<float4x4>& localMatrices);
+
+    private:
+        void evaluateRange(double time, uint32_t begin, uint32_t end, std::vector<float4x4>& localMatrices);
+
+        // Source animations.
+        size_t mSourceCount = 0;                    ///< Number of animations the batch was created from.
+        uint64_t mSourceVersion = 0;                ///< Sum of the versions of the animations the batch was created from.
+
+        // Channels.
+        std::vector<ref<Animation>> mAnimations;
+        std::vector<NodeID> mNodeIDs;
+        std::vector<uint32_t> mKeyframeOffsets;     ///< Offset of the first keyframe of each channel, followed by the total keyframe count.
+
+        // Keyframes of all channels.
+        std::vector<double> mKeyframeTimes;
+        std::vector<float3> mKeyframeTranslations;
+        std::vector<quatf> mKeyframeRotations;
+        std::vector<float3> mKeyframeScalings;
+
+        // Per-channel evaluation state.
+        std::vector<uint32_t> mCachedFrameIndices;  ///< Keyframe index found by the last evaluation, relative to the channel's first keyframe.
+        std::vector<uint32_t> mSegmentStarts;       ///< Index of the first keyframe of the interpolated segment, or an invalid index if the channel is already evaluated.
+        std::vector<uint32_t> mSegmentEnds;         ///< Index of the last keyframe of the interpolated segment.
+        std::vector<float> mWeights;                ///< Interpolation weight within the segment.
+        std::vector<float3> mTranslations;
+        std::vector<quatf> mRotations;
+        std::vector<float3> mScalings;
+        std::vector<uint8_t> mChanged;              ///< Nonzero if the local matrix changed in the last evaluation.
+    };
+
+    /** Scene graph nodes grouped by depth.
+        The global matrices of nodes on the same level only depend on the previous levels, so they can be updated in
+        parallel once the previous levels are done.
+    */
+    class FALCOR_API SceneGraphLevels
+    {
+    public:
+        SceneGraphLevels() = default;
+
+        /** Group nodes by depth.
+            \param[in] parents Parent of each node, or NodeID::Invalid() for root nodes. Parents must be stored before their children.
+        */
+        SceneGraphLevels(const std::vector<NodeID>& parents);
+
+        /** Get the number of levels.
+        */
+        uint32_t getLevelCount() const { return (uint32_t)mLevelOffsets.size() - 1; }
+
+        /** Get the nodes of all levels, sorted by level.
+        */
+        const std::vector<uint32_t>& getNodes() const { return mNodes; }
+
+        /** Get the offset of the first node of each level in the node list, followed by the total node count.
+        */
+        const std::vector<uint32_t>& getLevelOffsets() const { return mLevelOffsets; }
+
+        /** Call a function for all nodes, level by level from the roots.
+            Nodes of a level are processed in parallel if the level is large enough.
+            \param[in] func Function called with the index of each node.
+        */
+        void forEachNode(const std::function<void(uint32_t)>& func) const;
+
+    private:
+        std::vector<uint32_t> mNodes;
+        std::vector<uint32_t> mLevelOffsets = { 0 };
+    };
+}
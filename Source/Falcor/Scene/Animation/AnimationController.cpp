@@ -39,16 +39,21 @@ namespace Falcor
         const std::string kInverseTransposeWorldMatrices = "inverseTransposeWorldMatrices";
         const std::string kPrevWorldMatrices = "prevWorldMatrices";
         const std::string kPrevInverseTransposeWorldMatrices = "prevInverseTransposeWorldMatrices";
+
+        /// Minimum number of changed matrices to update the global matrices level by level in parallel.
+        const size_t kMinParallelMatrixUpdateCount = 4096;
+
+        /// Maximum number of unchanged matrices between two changed ones that are uploaded together.
+        const uint32_t kMaxMatrixUploadGap = 16;
     }
 
     AnimationController::AnimationController(ref<Device> pDevice, Scene* pScene, const StaticVertexVector& staticVertexData, const SkinningVertexVector& skinningVertexData, uint32_t prevVertexCount, const std::vector<ref<Animation>>& animations)
         : mpDevice(pDevice)
         , mAnimations(animations)
-        , mNodesEdited(pScene->mSceneGraph.size())
+        , mAnimationBatch(animations)
         , mLocalMatrices(pScene->mSceneGraph.size())
         , mGlobalMatrices(pScene->mSceneGraph.size())
         , mInvTransposeGlobalMatrices(pScene->mSceneGraph.size())
-        , mMatricesChanged(pScene->mSceneGraph.size())
         , mpScene(pScene)
     {
         // Create GPU resources.
@@ -85,6 +90,12 @@ namespace Falcor
 
         createSkinningPass(staticVertexData, skinningVertexData);
 
+        // Group scene graph nodes by depth and set up change tracking.
+        std::vector<NodeID> parents(pScene->mSceneGraph.size());
+        for (size_t i = 0; i < parents.size(); i++) parents[i] = pScene->mSceneGraph[i].parent;
+        mSceneGraphLevels = SceneGraphLevels(parents);
+        mDirtyTracker = SceneGraphDirtyTracker(parents);
+
         // Determine length of global animation loop.
         for (const auto& pAnimation : mAnimations)
         {
@@ -92,7 +103,7 @@ namespace Falcor
         }
     }
 
-    void AnimationController::addAnimatedVertexCaches(std::vector<CachedCurve>&& cachedCurves, std::vector<CachedMesh>&& cachedMeshes, const StaticVertexVector& staticVertexData)
+    void AnimationController::addAnimatedVertexCaches(std::vector<CachedCurve>&& cachedCurves, std::vector<CachedMesh>&& cachedMeshes, const StaticVertexVector& staticVertexData, const VertexCacheStreamingOptions& streamingOptions)
     {
         size_t totalAnimatedMeshVertexCount = 0;
 
@@ -117,7 +128,7 @@ namespace Falcor
             for (auto& cache : cachedMeshes)
             {
                 uint32_t offset = mpScene->getMesh(cache.meshID).vbOffset;
-                for (size_t i = 0; i < cache.vertexData.front().size(); i++)
+                for (size_t i = 0; i < cache.getVertexCount(); i++)
                 {
                     prevVertexData.push_back({ staticVertexData[offset + i].position });
                 }
@@ -156,7 +167,7 @@ namespace Falcor
             mpPrevVertexData->setBlob(prevVertexData.data(), byteOffset, prevVertexData.size() * sizeof(PrevVertexData));
         }
 
-        mpVertexCache = std::make_unique<AnimatedVertexCache>(mpDevice, mpScene, mpPrevVertexData, std::move(cachedCurves), std::move(cachedMeshes));
+        mpVertexCache = std::make_unique<AnimatedVertexCache>(mpDevice, mpScene, mpPrevVertexData, std::move(cachedCurves), std::move(cachedMeshes), streamingOptions);
 
         // Note: It is a workaround to have two pre-infinity behaviors for the cached animation.
         // We need `Cycle` behavior when the length of cached animation is smaller than the length of mesh animation (e.g., tiger forest).
@@ -194,20 +205,25 @@ namespace Falcor
     {
         FALCOR_PROFILE(pRenderContext, "animate");
 
-        std::fill(mMatricesChanged.begin(), mMatricesChanged.end(), false);
+        mDirtyTracker.clear();
+        mUpdateStats = {};
 
         // Check for edited scene nodes and update local matrices.
         const auto& sceneGraph = mpScene->mSceneGraph;
-        bool edited = false;
-        for (size_t i = 0; i < sceneGraph.size(); ++i)
+        bool edited = !mEditedNodes.empty();
+        for (uint32_t nodeID : mEditedNodes)
         {
-            if (mNodesEdited[i])
-            {
-                mLocalMatrices[i] = sceneGraph[i].transform;
-                mNodesEdited[i] = false;
-                mMatricesChanged[i] = true;
-                edited = true;
-            }
+            mLocalMatrices[nodeID] = sceneGraph[nodeID].transform;
+            mDirtyTracker.markDirty(nodeID);
+        }
+        mEditedNodes.clear();
+
+        // Recreate the animation batch if keyframes or node IDs were edited since it was created (e.g. from Python).
+        bool animationsEdited = false;
+        if (!mAnimationBatch.isUpToDate(mAnimations))
+        {
+            mAnimationBatch = AnimationBatch(mAnimations);
+            animationsEdited = mEnabled;
         }
 
         bool changed = false;
@@ -218,7 +234,6 @@ namespace Falcor
         // including transformation matrices, dynamic vertex data etc.
         if (mFirstUpdate || mEnabled != mPrevEnabled)
         {
-            std::fill(mMatricesChanged.begin(), mMatricesChanged.end(), true);
             initLocalMatrices();
             if (mEnabled)
             {
@@ -256,7 +271,7 @@ namespace Falcor
 
         // Perform incremental update.
         // This updates all animated matrices and dynamic vertex data.
-        if (edited || (mEnabled && (time != mTime || mTime != mPrevTime)))
+        if (edited || animationsEdited || (mEnabled && (time != mTime || mTime != mPrevTime)))
         {
             if (edited || hasAnimations())
             {
@@ -264,9 +279,15 @@ namespace Falcor
                 FALCOR_ASSERT(mpInvTransposeWorldMatricesBuffer && mpPrevInvTransposeWorldMatricesBuffer);
                 std::swap(mpPrevWorldMatricesBuffer, mpWorldMatricesBuffer);
                 std::swap(mpPrevInvTransposeWorldMatricesBuffer, mpInvTransposeWorldMatricesBuffer);
-                updateLocalMatrices(time);
-                updateWorldMatrices();
-                uploadWorldMatrices();
+                {
+                    FALCOR_PROFILE(pRenderContext, "updateMatrices");
+                    updateLocalMatrices(time);
+                    updateWorldMatrices();
+                }
+                {
+                    FALCOR_PROFILE(pRenderContext, "uploadWorldMatrices");
+                    uploadWorldMatrices();
+                }
                 bindBuffers();
                 executeSkinningPass(pRenderContext);
                 changed = true;
@@ -289,12 +310,13 @@ namespace Falcor
 
     void AnimationController::updateLocalMatrices(double time)
     {
-        for (auto& pAnimation : mAnimations)
+        mAnimationBatch.evaluate(time, mLocalMatrices);
+
+        // Only mark nodes whose local matrix actually changed, so that the subtrees of paused animations are skipped.
+        const auto& nodeIDs = mAnimationBatch.getNodeIDs();
+        for (uint32_t c = 0; c < mAnimationBatch.getChannelCount(); c++)
         {
-            NodeID nodeID = pAnimation->getNodeID();
-            FALCOR_ASSERT(nodeID.get() < mLocalMatrices.size());
-            mLocalMatrices[nodeID.get()] = pAnimation->animate(time);
-            mMatricesChanged[nodeID.get()] = true;
+            if (mAnimationBatch.isChannelChanged(c)) mDirtyTracker.markDirty(nodeIDs[c].get());
         }
     }
 
@@ -302,19 +324,15 @@ namespace Falcor
     {
         const auto& sceneGraph = mpScene->mSceneGraph;
 
-        for (size_t i = 0; i < mGlobalMatrices.size(); i++)
-        {
-            // Propagate matrix change flag to children.
-            if (sceneGraph[i].parent != NodeID::Invalid())
-            {
-                mMatricesChanged[i] = mMatricesChanged[i] || mMatricesChanged[sceneGraph[i].parent.get()];
-            }
-
-            if (!mMatricesChanged[i] && !updateAll) continue;
+        // Mark the descendants of changed nodes as changed.
+        if (updateAll) mDirtyTracker.markAllDirty();
+        else mDirtyTracker.propagate();
 
+        auto updateMatrix = [&](uint32_t i)
+        {
             mGlobalMatrices[i] = mLocalMatrices[i];
 
-            if (mpScene->mSceneGraph[i].parent != NodeID::Invalid())
+            if (sceneGraph[i].parent != NodeID::Invalid())
             {
                 mGlobalMatrices[i] = mul(mGlobalMatrices[sceneGraph[i].parent.get()], mGlobalMatrices[i]);
             }
@@ -326,7 +344,21 @@ namespace Falcor
                 mSkinningMatrices[i] = mul(mGlobalMatrices[i], sceneGraph[i].localToBindSpace);
                 mInvTransposeSkinningMatrices[i] = transpose(inverse(mSkinningMatrices[i]));
             }
+        };
+
+        // The global matrix of a node depends on the global matrix of its parent. The changed nodes are listed with
+        // parents before their children, so they can be updated in order. Many changed nodes are instead updated
+        // level by level in parallel.
+        const auto& changedNodes = mDirtyTracker.getDirtyNodes();
+        if (changedNodes.size() >= kMinParallelMatrixUpdateCount)
+        {
+            mSceneGraphLevels.forEachNode([&](uint32_t i) { if (mDirtyTracker.isDirty(i)) updateMatrix(i); });
+        }
+        else
+        {
+            for (uint32_t i : changedNodes) updateMatrix(i);
         }
+        mUpdateStats.changedMatrixCount = (uint32_t)changedNodes.size();
     }
 
     void AnimationController::uploadWorldMatrices(bool uploadAll)
@@ -341,25 +373,27 @@ namespace Falcor
             // Upload all matrices.
             mpWorldMatricesBuffer->setBlob(mGlobalMatrices.data(), 0, mpWorldMatricesBuffer->getSize());
             mpInvTransposeWorldMatricesBuffer->setBlob(mInvTransposeGlobalMatrices.data(), 0, mpInvTransposeWorldMatricesBuffer->getSize());
+            mPrevChangedNodes.clear();
+            mUpdateStats.uploadedMatrixCount = (uint32_t)mGlobalMatrices.size();
+            mUpdateStats.uploadRangeCount = 1;
         }
         else
         {
-            // Upload changed matrices only.
-            for (size_t i = 0; i < mGlobalMatrices.size();)
+            // Upload changed matrices only. The buffers are swapped every update, so the current buffers also hold
+            // outdated values of the matrices changed by the previous update.
+            const auto& changedNodes = mDirtyTracker.getDirtyNodes();
+            mUploadIndices.assign(mPrevChangedNodes.begin(), mPrevChangedNodes.end());
+            mUploadIndices.insert(mUploadIndices.end(), changedNodes.begin(), changedNodes.end());
+            computeUploadRanges(mUploadIndices, kMaxMatrixUploadGap, mUploadRanges);
+
+            for (const auto& range : mUploadRanges)
             {
-                // Detect ranges of consecutive matrices that have all changed or not.
-                size_t offset = i;
-                bool changed = mMatricesChanged[i];
-                while (i < mGlobalMatrices.size() && mMatricesChanged[i] == changed) ++i;
-
-                // Upload range of changed matrices.
-                if (changed)
-                {
-                    size_t count = i - offset;
-                    mpWorldMatricesBuffer->setBlob(&mGlobalMatrices[offset], offset * sizeof(float4x4), count * sizeof(float4x4));
-                    mpInvTransposeWorldMatricesBuffer->setBlob(&mInvTransposeGlobalMatrices[offset], offset * sizeof(float4x4), count * sizeof(float4x4));
-                }
+                mpWorldMatricesBuffer->setBlob(&mGlobalMatrices[range.offset], range.offset * sizeof(float4x4), range.count * sizeof(float4x4));
+                mpInvTransposeWorldMatricesBuffer->setBlob(&mInvTransposeGlobalMatrices[range.offset], range.offset * sizeof(float4x4), range.count * sizeof(float4x4));
+                mUpdateStats.uploadedMatrixCount += range.count;
             }
+            mUpdateStats.uploadRangeCount = (uint32_t)mUploadRanges.size();
+            mPrevChangedNodes.assign(changedNodes.begin(), changedNodes.end());
         }
     }
 
@@ -27,11 +27,13 @@
  **************************************************************************/
 #pragma once
 #include "Animation.h"
+#include "AnimationBatch.h"
 #include "AnimatedVertexCache.h"
 #include "Core/Macros.h"
 #include "Core/API/Buffer.h"
 #include "Core/Pass/ComputePass.h"
 #include "Utils/Math/Matrix.h"
+#include "Scene/DirtyTracking.h"
 #include "Scene/SceneTypes.slang"
 #include <memory>
 #include <vector>
@@ -43,6 +45,15 @@ namespace Falcor
     class FALCOR_API AnimationController
     {
     public:
+        /** Statistics of the last update of the global matrices.
+        */
+        struct UpdateStats
+        {
+            uint32_t changedMatrixCount = 0;    ///< Number of global matrices that changed.
+            uint32_t uploadedMatrixCount = 0;   ///< Number of global matrices uploaded to the GPU, including unchanged matrices in merged ranges.
+            uint32_t uploadRangeCount = 0;      ///< Number of uploaded ranges of matrices.
+        };
+
         ~AnimationController() = default;
 
         using StaticVertexVector = std::vector<PackedStaticVertexData>;
@@ -53,8 +64,9 @@ namespace Falcor
         AnimationController(ref<Device> pDevice, Scene* pScene, const StaticVertexVector& staticVertexData, const SkinningVertexVector& skinningVertexData, uint32_t prevVertexCount, const std::vector<ref<Animation>>& animations);
 
         /** Add animated vertex caches (curves and meshes) to the controller.
+            \param[in] streamingOptions Options for streaming keyframes from disk instead of keeping all of them in GPU memory.
         */
-        void addAnimatedVertexCaches(std::vector<CachedCurve>&& cachedCurves, std::vector<CachedMesh>&& cachedMeshes, const StaticVertexVector& staticVertexData);
+        void addAnimatedVertexCaches(std::vector<CachedCurve>&& cachedCurves, std::vector<CachedMesh>&& cachedMeshes, const StaticVertexVector& staticVertexData, const VertexCacheStreamingOptions& streamingOptions = {});
 
         /** Returns true if controller contains animations.
         */
@@ -99,7 +111,7 @@ namespace Falcor
         /** Mark a scene node as being edited externally.
             Ensures that all global matrices depending on this scene node are updated.
         */
-        void setNodeEdited(size_t nodeID) { mNodesEdited[nodeID] = true; }
+        void setNodeEdited(size_t nodeID) { mEditedNodes.push_back((uint32_t)nodeID); }
 
         /** Run the animation system.
             \return true if a change occurred, otherwise false.
@@ -108,7 +120,15 @@ namespace Falcor
 
         /** Check if a matrix changed since last frame.
         */
-        bool isMatrixChanged(NodeID matrixID) const { return mMatricesChanged[matrixID.get()]; }
+        bool isMatrixChanged(NodeID matrixID) const { return mDirtyTracker.isDirty(matrixID.get()); }
+
+        /** Get the matrices that changed since last frame. Parents are listed before their children.
+        */
+        const std::vector<uint32_t>& getChangedMatrices() const { return mDirtyTracker.getDirtyNodes(); }
+
+        /** Get the statistics of the last update of the global matrices.
+        */
+        const UpdateStats& getUpdateStats() const { return mUpdateStats; }
 
         /** Get the local matrices.
             These represent the current local transform for each scene graph node.
@@ -160,11 +180,17 @@ namespace Falcor
 
         // Animation
         std::vector<ref<Animation>> mAnimations;
-        std::vector<bool> mNodesEdited;
+        AnimationBatch mAnimationBatch;             ///< Evaluates all animations together.
+        SceneGraphLevels mSceneGraphLevels;         ///< Scene graph nodes grouped by depth, for updating the global matrices level by level.
+        SceneGraphDirtyTracker mDirtyTracker;       ///< Tracks the matrices changed since last frame.
+        std::vector<uint32_t> mEditedNodes;         ///< Nodes edited externally since last frame.
+        std::vector<uint32_t> mPrevChangedNodes;    ///< Nodes changed by the previous incremental update. Their matrices are outdated in the buffers swapped in by the next update.
+        std::vector<uint32_t> mUploadIndices;       ///< Scratch list of matrices to upload.
+        std::vector<UploadRange> mUploadRanges;     ///< Scratch list of ranges to upload.
+        UpdateStats mUpdateStats;
         std::vector<float4x4> mLocalMatrices;
         std::vector<float4x4> mGlobalMatrices;
         std::vector<float4x4> mInvTransposeGlobalMatrices;
-        std::vector<bool> mMatricesChanged;         ///< Flag per matrix, true if matrix changed since last frame.
 
         bool mFirstUpdate = true;       ///< True if this is the first update.
         bool mEnabled = true;           ///< True if animations are enabled.
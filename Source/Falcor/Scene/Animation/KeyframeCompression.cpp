@@ -0,0 +1,358 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "KeyframeCompression.h"
+#include "Core/Error.h"
+#include "Utils/NumericRange.h"
+#include "Utils/Math/Common.h"
+#include "Utils/Math/ScalarMath.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <execution>
+#include <limits>
+
+namespace Falcor
+{
+    namespace
+    {
+        /// Number of vertices decoded by a single task. Smaller keyframes are decoded on the calling thread.
+        const uint32_t kVerticesPerTask = 16384;
+
+        /// Smallest error bound relative to the largest absolute position, keeps the quantized residuals well within float precision.
+        const double kMinRelativeErrorBound = 1.0 / (1 << 20);
+
+        using LaneType = CompressedKeyframes::LaneType;
+
+        template<typename T>
+        std::vector<const uint32_t*> getKeyframeLanes(const std::vector<std::vector<T>>& keyframes)
+        {
+            static_assert(sizeof(T) % sizeof(uint32_t) == 0);
+            FALCOR_CHECK(!keyframes.empty(), "No keyframes to compress.");
+            FALCOR_CHECK(keyframes.front().size() <= std::numeric_limits<uint32_t>::max(), "Too many vertices in keyframe.");
+
+            std::vector<const uint32_t*> lanes;
+            lanes.reserve(keyframes.size());
+            for (const auto& keyframe : keyframes)
+            {
+                FALCOR_CHECK(keyframe.size() == keyframes.front().size(), "Keyframes have different vertex counts.");
+                lanes.push_back(reinterpret_cast<const uint32_t*>(keyframe.data()));
+            }
+            return lanes;
+        }
+
+        uint32_t getResidualWidth(int32_t minResidual, int32_t maxResidual)
+        {
+            if (minResidual == 0 && maxResidual == 0) return 0;
+            if (minResidual >= std::numeric_limits<int8_t>::min() && maxResidual <= std::numeric_limits<int8_t>::max()) return 1;
+            if (minResidual >= std::numeric_limits<int16_t>::min() && maxResidual <= std::numeric_limits<int16_t>::max()) return 2;
+            return 4;
+        }
+
+        uint64_t getStreamSize(uint32_t width, uint32_t vertexCount)
+        {
+            // Pad each stream to 4 bytes so that all streams are aligned.
+            return (uint64_t(width) * vertexCount + 3) & ~uint64_t(3);
+        }
+
+        void storeResiduals(const std::vector<int32_t>& residuals, uint32_t width, uint8_t* pDst)
+        {
+            for (size_t v = 0; v < residuals.size(); v++)
+            {
+                switch (width)
+                {
+                case 1: { int8_t r = (int8_t)residuals[v]; std::memcpy(pDst + v, &r, 1); break; }
+                case 2: { int16_t r = (int16_t)residuals[v]; std::memcpy(pDst + 2 * v, &r, 2); break; }
+                case 4: { int32_t r = residuals[v]; std::memcpy(pDst + 4 * v, &r, 4); break; }
+                }
+            }
+        }
+
+        /** Call func(v, residual) for the residuals of vertices [begin, end) of a stream.
+        */
+        template<typename Func>
+        void forEachResidual(const uint8_t* pData, uint32_t width, uint32_t begin, uint32_t end, const Func& func)
+        {
+            switch (width)
+            {
+            case 0:
+                for (uint32_t v = begin; v < end; v++) func(v, 0);
+                break;
+            case 1:
+                for (uint32_t v = begin; v < end; v++) func(v, (int32_t)reinterpret_cast<const int8_t*>(pData)[v]);
+                break;
+            case 2:
+                for (uint32_t v = begin; v < end; v++) { int16_t r; std::memcpy(&r, pData + 2 * v, 2); func(v, (int32_t)r); }
+                break;
+            case 4:
+                for (uint32_t v = begin; v < end; v++) { int32_t r; std::memcpy(&r, pData + 4 * v, 4); func(v, r); }
+                break;
+            default:
+                FALCOR_UNREACHABLE();
+            }
+        }
+    }
+
+    CompressedKeyframes CompressedKeyframes::compress(const std::vector<std::vector<PackedStaticVertexData>>& keyframes, float relativeErrorBound)
+    {
+        static_assert(sizeof(PackedStaticVertexData) == 8 * sizeof(uint32_t));
+        const std::vector<LaneType> laneTypes =
+        {
+            LaneType::Quantized, LaneType::Quantized, LaneType::Quantized,  // position
+            LaneType::Exact16x2, LaneType::Exact16x2, LaneType::Exact16x2,  // packedNormalTangentCurveRadius
+            LaneType::Exact, LaneType::Exact,                               // texCrd
+        };
+        auto lanes = getKeyframeLanes(keyframes);
+        return compress(laneTypes, (uint32_t)keyframes.front().size(), lanes, relativeErrorBound);
+    }
+
+    CompressedKeyframes CompressedKeyframes::compress(const std::vector<std::vector<DynamicCurveVertexData>>& keyframes, float relativeErrorBound)
+    {
+        static_assert(sizeof(DynamicCurveVertexData) == 3 * sizeof(uint32_t));
+        const std::vector<LaneType> laneTypes = { LaneType::Quantized, LaneType::Quantized, LaneType::Quantized };
+        auto lanes = getKeyframeLanes(keyframes);
+        return compress(laneTypes, (uint32_t)keyframes.front().size(), lanes, relativeErrorBound);
+    }
+
+    CompressedKeyframes CompressedKeyframes::compress(const std::vector<LaneType>& laneTypes, uint32_t vertexCount, const std::vector<const uint32_t*>& keyframes, float relativeErrorBound)
+    {
+        FALCOR_CHECK(relativeErrorBound > 0.f, "Error bound must be positive.");
+
+        CompressedKeyframes c;
+        c.mKeyframeCount = (uint32_t)keyframes.size();
+        c.mVertexCount = vertexCount;
+        c.mLaneTypes = laneTypes;
+        c.initChannels();
+
+        // Use the middle keyframe as reference, which keeps the residuals of drifting animations small.
+        const uint32_t laneCount = c.getLaneCount();
+        const uint32_t channelCount = c.getChannelCount();
+        c.mReferenceKeyframe = c.mKeyframeCount / 2;
+        const uint32_t* pReference = keyframes[c.mReferenceKeyframe];
+        c.mReference.assign(pReference, pReference + size_t(vertexCount) * laneCount);
+
+        // Derive the error bound from the extent of the reference keyframe.
+        // It is clamped to the precision of the largest position, so residuals always fit in float precision.
+        const bool hasQuantizedLanes = std::find(laneTypes.begin(), laneTypes.end(), LaneType::Quantized) != laneTypes.end();
+        if (hasQuantizedLanes)
+        {
+            std::vector<double> maxAbs(c.mKeyframeCount, 0.0);
+            auto range = NumericRange<uint32_t>(0, c.mKeyframeCount);
+            std::for_each(std::execution::par, range.begin(), range.end(), [&](uint32_t k)
+            {
+                for (size_t i = 0; i < c.mReference.size(); i++)
+                {
+                    if (laneTypes[i % laneCount] != LaneType::Quantized) continue;
+                    double value = std::abs(double(asfloat(keyframes[k][i])));
+                    maxAbs[k] = std::isfinite(value) ? std::max(maxAbs[k], value) : std::numeric_limits<double>::infinity();
+                }
+            });
+            const double maxPosition = *std::max_element(maxAbs.begin(), maxAbs.end());
+            FALCOR_CHECK(std::isfinite(maxPosition), "Keyframes have non-finite positions.");
+
+            double maxExtent = 0.0;
+            for (uint32_t lane = 0; lane < laneCount; lane++)
+            {
+                if (laneTypes[lane] != LaneType::Quantized || vertexCount == 0) continue;
+                double lo = std::numeric_limits<double>::max();
+                double hi = std::numeric_limits<double>::lowest();
+                for (uint32_t v = 0; v < vertexCount; v++)
+                {
+                    double value = asfloat(c.mReference[size_t(v) * laneCount + lane]);
+                    lo = std::min(lo, value);
+                    hi = std::max(hi, value);
+                }
+                maxExtent = std::max(maxExtent, hi - lo);
+            }
+
+            double errorBound = std::max(relativeErrorBound * maxExtent, maxPosition * kMinRelativeErrorBound);
+            c.mErrorBound = errorBound > 0.0 ? (float)errorBound : relativeErrorBound;
+        }
+
+        // Encode the residuals of each keyframe.
+        c.mChannelWidths.resize(size_t(c.mKeyframeCount) * channelCount);
+        std::vector<std::vector<uint8_t>> keyframeData(c.mKeyframeCount);
+        auto range = NumericRange<uint32_t>(0, c.mKeyframeCount);
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](uint32_t k)
+        {
+            const uint32_t* pLanes = keyframes[k];
+            std::vector<int32_t> residuals(vertexCount);
+            for (uint32_t channel = 0; channel < channelCount; channel++)
+            {
+                const uint32_t lane = c.mChannelLanes[channel];
+                const bool highHalf = channel > 0 && c.mChannelLanes[channel - 1] == lane;
+                for (uint32_t v = 0; v < vertexCount; v++)
+                {
+                    const size_t i = size_t(v) * laneCount + lane;
+                    const uint32_t value = pLanes[i];
+                    const uint32_t reference = c.mReference[i];
+                    switch (laneTypes[lane])
+                    {
+                    case LaneType::Quantized:
+                        residuals[v] = (int32_t)std::round((double(asfloat(value)) - double(asfloat(reference))) / c.mErrorBound);
+                        break;
+                    case LaneType::Exact:
+                        residuals[v] = (int32_t)(value - reference);
+                        break;
+                    case LaneType::Exact16x2:
+                    {
+                        const uint32_t shift = highHalf ? 16 : 0;
+                        residuals[v] = (int16_t)(uint16_t)((value >> shift) - (reference >> shift));
+                        break;
+                    }
+                    }
+                }
+
+                int32_t minResidual = 0;
+                int32_t maxResidual = 0;
+                for (int32_t r : residuals)
+                {
+                    minResidual = std::min(minResidual, r);
+                    maxResidual = std::max(maxResidual, r);
+                }
+                const uint32_t width = getResidualWidth(minResidual, maxResidual);
+                c.mChannelWidths[size_t(k) * channelCount + channel] = (uint8_t)width;
+
+                auto& data = keyframeData[k];
+                const size_t offset = data.size();
+                data.resize(offset + getStreamSize(width, vertexCount), 0);
+                storeResiduals(residuals, width, data.data() + offset);
+            }
+        });
+
+        // Concatenate the keyframes.
+        const uint64_t dataSize = c.computeChannelOffsets();
+        c.mData.reserve(dataSize);
+        for (uint32_t k = 0; k < c.mKeyframeCount; k++)
+        {
+            FALCOR_ASSERT(c.mData.size() == c.mChannelOffsets[size_t(k) * channelCount]);
+            c.mData.insert(c.mData.end(), keyframeData[k].begin(), keyframeData[k].end());
+        }
+
+        return c;
+    }
+
+    void CompressedKeyframes::decode(uint32_t keyframe, void* pDst) const
+    {
+        FALCOR_CHECK(keyframe < mKeyframeCount, "Invalid keyframe {}.", keyframe);
+
+        uint32_t* pLanes = static_cast<uint32_t*>(pDst);
+        const uint32_t laneCount = getLaneCount();
+        const uint32_t channelCount = getChannelCount();
+
+        auto decodeRange = [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t channel = 0; channel < channelCount; channel++)
+            {
+                const uint32_t lane = mChannelLanes[channel];
+                const size_t index = size_t(keyframe) * channelCount + channel;
+                const uint8_t* pData = mData.data() + mChannelOffsets[index];
+                const uint32_t width = mChannelWidths[index];
+
+                switch (mLaneTypes[lane])
+                {
+                case LaneType::Quantized:
+                    forEachResidual(pData, width, begin, end, [&](uint32_t v, int32_t r)
+                    {
+                        // Unchanged values keep their exact bit pattern, e.g. negative zeros.
+                        const size_t i = size_t(v) * laneCount + lane;
+                        pLanes[i] = r == 0 ? mReference[i] : asuint(asfloat(mReference[i]) + float(r) * mErrorBound);
+                    });
+                    break;
+                case LaneType::Exact:
+                    forEachResidual(pData, width, begin, end, [&](uint32_t v, int32_t r)
+                    {
+                        const size_t i = size_t(v) * laneCount + lane;
+                        pLanes[i] = mReference[i] + uint32_t(r);
+                    });
+                    break;
+                case LaneType::Exact16x2:
+                    if (channel == 0 || mChannelLanes[channel - 1] != lane)
+                    {
+                        forEachResidual(pData, width, begin, end, [&](uint32_t v, int32_t r)
+                        {
+                            const size_t i = size_t(v) * laneCount + lane;
+                            pLanes[i] = (mReference[i] + uint32_t(r)) & 0xffff;
+                        });
+                    }
+                    else
+                    {
+                        forEachResidual(pData, width, begin, end, [&](uint32_t v, int32_t r)
+                        {
+                            const size_t i = size_t(v) * laneCount + lane;
+                            pLanes[i] |= ((mReference[i] >> 16) + uint32_t(r)) << 16;
+                        });
+                    }
+                    break;
+                }
+            }
+        };
+
+        const uint32_t taskCount = div_round_up(mVertexCount, kVerticesPerTask);
+        if (taskCount > 1)
+        {
+            auto range = NumericRange<uint32_t>(0, taskCount);
+            std::for_each(std::execution::par, range.begin(), range.end(), [&](uint32_t i) { decodeRange(i * kVerticesPerTask, std::min((i + 1) * kVerticesPerTask, mVertexCount)); });
+        }
+        else
+        {
+            decodeRange(0, mVertexCount);
+        }
+    }
+
+    uint64_t CompressedKeyframes::getCompressedSize() const
+    {
+        return mReference.size() * sizeof(uint32_t) + mChannelWidths.size() + mData.size();
+    }
+
+    void CompressedKeyframes::initChannels()
+    {
+        mChannelLanes.clear();
+        for (uint32_t lane = 0; lane < getLaneCount(); lane++)
+        {
+            mChannelLanes.push_back(lane);
+            if (mLaneTypes[lane] == LaneType::Exact16x2) mChannelLanes.push_back(lane);
+        }
+    }
+
+    uint64_t CompressedKeyframes::computeChannelOffsets()
+    {
+        mChannelOffsets.resize(mChannelWidths.size());
+        uint64_t offset = 0;
+        for (size_t i = 0; i < mChannelWidths.size(); i++)
+        {
+            mChannelOffsets[i] = offset;
+            offset += getStreamSize(mChannelWidths[i], mVertexCount);
+        }
+        return offset;
+    }
+
+    void CompressedKeyframes::checkVertexSize(size_t vertexSize) const
+    {
+        FALCOR_CHECK(vertexSize == getLaneCount() * sizeof(uint32_t), "Vertex size {} does not match the {} lanes of the compressed keyframes.", vertexSize, getLaneCount());
+    }
+}
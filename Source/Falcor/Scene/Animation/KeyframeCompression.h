@@ -0,0 +1,136 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/Macros.h"
+#include "Scene/SceneTypes.slang"
+#include <cstdint>
+#include <vector>
+
+namespace Falcor
+{
+    /** Options for compressing the keyframes of cached vertex animations.
+    */
+    struct KeyframeCompressionOptions
+    {
+        bool enabled = false;               ///< Store cached keyframes compressed, see CompressedKeyframes.
+        float relativeErrorBound = 1e-4f;   ///< Maximum position error relative to the largest extent of each animated mesh or curve.
+    };
+
+    /** Keyframes of a cached vertex animation, compressed as quantized deltas against a reference keyframe.
+
+        Vertices are treated as arrays of 32-bit lanes. Each keyframe stores the residuals of each lane against the
+        reference keyframe, with a byte width (0, 1, 2 or 4) chosen per keyframe and lane from the largest residual.
+        Position lanes are quantized with a step equal to the error bound of the animation, which is derived from its
+        extent. Half of the step is left for float rounding, so decoded positions are always within the error bound.
+        All other lanes hold packed data and are stored exactly: as 32-bit deltas of the bit patterns, or as pairs of
+        16-bit deltas for packed halfs and normals. Lanes that do not change cost nothing.
+
+        Keyframes are independent of each other and can be decoded in any order. Large keyframes are decoded in parallel.
+    */
+    class FALCOR_API CompressedKeyframes
+    {
+    public:
+        /** Encoding of a 32-bit lane of a vertex.
+        */
+        enum class LaneType : uint8_t
+        {
+            Quantized,      ///< Float value, quantized within the error bound.
+            Exact,          ///< 32-bit pattern, stored exactly.
+            Exact16x2,      ///< Pair of 16-bit patterns, stored exactly.
+        };
+
+        CompressedKeyframes() = default;
+
+        /** Compress the keyframes of a mesh. Positions are quantized, all other attributes are stored exactly.
+            \param[in] keyframes Keyframes, all with the same number of vertices.
+            \param[in] relativeErrorBound Maximum position error relative to the largest extent of the reference keyframe.
+        */
+        static CompressedKeyframes compress(const std::vector<std::vector<PackedStaticVertexData>>& keyframes, float relativeErrorBound);
+
+        /** Compress the keyframes of curves. Positions are quantized.
+            \param[in] keyframes Keyframes, all with the same number of vertices.
+            \param[in] relativeErrorBound Maximum position error relative to the largest extent of the reference keyframe.
+        */
+        static CompressedKeyframes compress(const std::vector<std::vector<DynamicCurveVertexData>>& keyframes, float relativeErrorBound);
+
+        /** Decode a keyframe.
+            \param[in] keyframe Keyframe index.
+            \param[out] pDst Destination of getVertexCount() vertices of getLaneCount() lanes each.
+        */
+        void decode(uint32_t keyframe, void* pDst) const;
+
+        /** Decode a keyframe into a vector, which is resized to fit the keyframe.
+        */
+        template<typename T>
+        void decode(uint32_t keyframe, std::vector<T>& vertices) const
+        {
+            checkVertexSize(sizeof(T));
+            vertices.resize(mVertexCount);
+            decode(keyframe, vertices.data());
+        }
+
+        bool empty() const { return mKeyframeCount == 0; }
+        uint32_t getKeyframeCount() const { return mKeyframeCount; }
+        uint32_t getVertexCount() const { return mVertexCount; }
+        uint32_t getLaneCount() const { return (uint32_t)mLaneTypes.size(); }
+        uint32_t getReferenceKeyframe() const { return mReferenceKeyframe; }
+
+        /** Get the maximum absolute error of decoded values of quantized lanes.
+        */
+        float getErrorBound() const { return mErrorBound; }
+
+        /** Get the size of the keyframes before compression in bytes.
+        */
+        uint64_t getUncompressedSize() const { return uint64_t(mKeyframeCount) * mVertexCount * getLaneCount() * sizeof(uint32_t); }
+
+        /** Get the size of the compressed keyframes in bytes, including the reference keyframe.
+        */
+        uint64_t getCompressedSize() const;
+
+    private:
+        static CompressedKeyframes compress(const std::vector<LaneType>& laneTypes, uint32_t vertexCount, const std::vector<const uint32_t*>& keyframes, float relativeErrorBound);
+
+        uint32_t getChannelCount() const { return (uint32_t)mChannelLanes.size(); }
+        void initChannels();
+        uint64_t computeChannelOffsets();
+        void checkVertexSize(size_t vertexSize) const;
+
+        uint32_t mKeyframeCount = 0;
+        uint32_t mVertexCount = 0;
+        uint32_t mReferenceKeyframe = 0;
+        float mErrorBound = 0.f;
+        std::vector<LaneType> mLaneTypes;
+        std::vector<uint32_t> mChannelLanes;        ///< Lane of each channel. Exact16x2 lanes are split in two channels.
+        std::vector<uint32_t> mReference;           ///< Lanes of all vertices of the reference keyframe.
+        std::vector<uint8_t> mChannelWidths;        ///< Byte width of the residuals of each channel of each keyframe.
+        std::vector<uint64_t> mChannelOffsets;      ///< Offset of the residuals of each channel of each keyframe in mData, computed from the widths.
+        std::vector<uint8_t> mData;                 ///< Residuals, each channel padded to 4 bytes.
+
+        friend class SceneCache;
+    };
+}
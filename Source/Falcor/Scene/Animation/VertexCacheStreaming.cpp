@@ -0,0 +1,291 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "VertexCacheStreaming.h"
+#include "Core/Error.h"
+#include "Utils/StringFormatters.h"
+#include <BS_thread_pool.hpp>
+#include <fmt/format.h>
+#include <algorithm>
+#include <chrono>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kKeyframeFileVersion = 1;
+        const std::string kTracksSection = "tracks";
+
+        std::string getKeyframeSectionName(uint32_t track, uint32_t keyframe)
+        {
+            return fmt::format("{}/{}", track, keyframe);
+        }
+
+        std::vector<KeyframeFile::TrackDesc> getTracks(const KeyframeFile* pFile)
+        {
+            FALCOR_CHECK(pFile != nullptr, "Missing keyframe file.");
+            std::vector<KeyframeFile::TrackDesc> tracks;
+            for (uint32_t track = 0; track < pFile->getTrackCount(); track++) tracks.push_back(pFile->getTrack(track));
+            return tracks;
+        }
+    }
+
+    void KeyframeFile::write(const std::filesystem::path& path, const std::vector<TrackDesc>& tracks, const KeyframeFunc& getKeyframe)
+    {
+        SceneCacheFile::Writer writer(path, kKeyframeFileVersion);
+        addSections(writer, tracks, getKeyframe);
+        writer.finalize();
+    }
+
+    void KeyframeFile::addSections(SceneCacheFile::Writer& writer, const std::vector<TrackDesc>& tracks, const KeyframeFunc& getKeyframe)
+    {
+        writer.addSection(kTracksSection, tracks);
+
+        for (uint32_t track = 0; track < (uint32_t)tracks.size(); track++)
+        {
+            for (uint32_t keyframe = 0; keyframe < tracks[track].keyframeCount; keyframe++)
+            {
+                const void* pData = getKeyframe(track, keyframe);
+                FALCOR_CHECK(pData != nullptr, "Missing data for keyframe {} of track {}.", keyframe, track);
+                writer.addSection(getKeyframeSectionName(track, keyframe), pData, tracks[track].keyframeSize);
+            }
+        }
+    }
+
+    KeyframeFile::KeyframeFile(const std::filesystem::path& path)
+        : mpReader(std::make_shared<SceneCacheFile::Reader>(path, 1))
+    {
+        if (mpReader->getVersion() != kKeyframeFileVersion) FALCOR_THROW("Unsupported version {} of keyframe file '{}'.", mpReader->getVersion(), path);
+        readTracks();
+    }
+
+    KeyframeFile::KeyframeFile(std::shared_ptr<const SceneCacheFile::Reader> pReader)
+        : mpReader(std::move(pReader))
+    {
+        FALCOR_CHECK(mpReader != nullptr, "Missing keyframe file reader.");
+        readTracks();
+    }
+
+    void KeyframeFile::readTracks()
+    {
+        if (!mpReader->hasSection(kTracksSection)) FALCOR_THROW("Missing track table in keyframe file.");
+        mpReader->readSection(kTracksSection, mTracks);
+
+        for (uint32_t track = 0; track < (uint32_t)mTracks.size(); track++)
+        {
+            for (uint32_t keyframe = 0; keyframe < mTracks[track].keyframeCount; keyframe++)
+            {
+                const auto& info = mpReader->getSectionInfo(getKeyframeSectionName(track, keyframe));
+                if (info.size != mTracks[track].keyframeSize) FALCOR_THROW("Invalid size of keyframe {} of track {} in keyframe file.", keyframe, track);
+            }
+        }
+    }
+
+    void KeyframeFile::readKeyframe(uint32_t track, uint32_t keyframe, void* pDst) const
+    {
+        FALCOR_CHECK(track < getTrackCount() && keyframe < mTracks[track].keyframeCount, "Invalid keyframe {} of track {}.", keyframe, track);
+        mpReader->readSection(getKeyframeSectionName(track, keyframe), pDst, mTracks[track].keyframeSize);
+    }
+
+    KeyframeWindow::KeyframeWindow(uint32_t keyframeCount, uint32_t slotCount, uint32_t prefetchCount)
+    {
+        FALCOR_CHECK(keyframeCount > 0, "Keyframe window needs at least one keyframe.");
+        slotCount = std::min(slotCount, keyframeCount);
+        const uint32_t minSlotCount = std::min(2u, keyframeCount);
+        FALCOR_CHECK(slotCount >= minSlotCount, "Keyframe window needs at least {} slots.", minSlotCount);
+
+        mKeyframeSlots.assign(keyframeCount, kInvalidSlot);
+        mSlots.resize(slotCount);
+        mPrefetchCount = std::min(prefetchCount, slotCount - minSlotCount);
+    }
+
+    std::vector<KeyframeWindow::Load> KeyframeWindow::update(uint2 keyframeIndices)
+    {
+        const uint32_t keyframeCount = getKeyframeCount();
+        FALCOR_CHECK(keyframeIndices.x < keyframeCount && keyframeIndices.y < keyframeCount, "Keyframe indices ({}, {}) out of range.", keyframeIndices.x, keyframeIndices.y);
+
+        // Collect the keyframes wanted in the window in order of need.
+        mWanted.clear();
+        auto addWanted = [this](uint32_t keyframe)
+        {
+            if (std::find(mWanted.begin(), mWanted.end(), keyframe) == mWanted.end()) mWanted.push_back(keyframe);
+        };
+        addWanted(keyframeIndices.x);
+        addWanted(keyframeIndices.y);
+        const size_t requiredCount = mWanted.size();
+        for (uint32_t i = 1; i <= mPrefetchCount; i++) addWanted((keyframeIndices.y + i) % keyframeCount);
+        FALCOR_ASSERT(mWanted.size() <= mSlots.size());
+
+        // Assign slots to the wanted keyframes not in the window yet.
+        std::vector<Load> loads;
+        for (size_t i = 0; i < mWanted.size(); i++)
+        {
+            uint32_t keyframe = mWanted[i];
+            if (mKeyframeSlots[keyframe] != kInvalidSlot) continue;
+
+            uint32_t slot = findFreeSlot(keyframeIndices.x);
+            if (mSlots[slot].keyframe != kInvalidSlot) mKeyframeSlots[mSlots[slot].keyframe] = kInvalidSlot;
+            mSlots[slot] = { keyframe, false };
+            mKeyframeSlots[keyframe] = slot;
+            loads.push_back({ keyframe, slot, i < requiredCount });
+        }
+
+        return loads;
+    }
+
+    bool KeyframeWindow::setLoaded(uint32_t keyframe, uint32_t slot)
+    {
+        if (keyframe >= getKeyframeCount() || mKeyframeSlots[keyframe] != slot) return false;
+        mSlots[slot].loaded = true;
+        return true;
+    }
+
+    bool KeyframeWindow::isResident(uint32_t keyframe) const
+    {
+        uint32_t slot = mKeyframeSlots[keyframe];
+        return slot != kInvalidSlot && mSlots[slot].loaded;
+    }
+
+    uint32_t KeyframeWindow::findFreeSlot(uint32_t playhead) const
+    {
+        // Use an empty slot, or evict the unwanted keyframe needed last when playing forward from the playhead.
+        const uint32_t keyframeCount = getKeyframeCount();
+        uint32_t bestSlot = kInvalidSlot;
+        uint32_t bestDistance = 0;
+        for (uint32_t slot = 0; slot < getSlotCount(); slot++)
+        {
+            uint32_t keyframe = mSlots[slot].keyframe;
+            if (keyframe == kInvalidSlot) return slot;
+            if (std::find(mWanted.begin(), mWanted.end(), keyframe) != mWanted.end()) continue;
+
+            uint32_t distance = (keyframe + keyframeCount - playhead) % keyframeCount;
+            if (bestSlot == kInvalidSlot || distance > bestDistance)
+            {
+                bestSlot = slot;
+                bestDistance = distance;
+            }
+        }
+        FALCOR_ASSERT(bestSlot != kInvalidSlot);
+        return bestSlot;
+    }
+
+    KeyframeStreamer::KeyframeStreamer(std::vector<KeyframeFile::TrackDesc> tracks, ReadFunc read, const Options& options)
+        : mTracks(std::move(tracks))
+        , mRead(std::move(read))
+    {
+        FALCOR_CHECK(mRead != nullptr, "Missing keyframe read function.");
+
+        mWindows.reserve(mTracks.size());
+        for (const auto& track : mTracks)
+        {
+            mWindows.emplace_back(track.keyframeCount, options.windowSize, options.prefetchCount);
+        }
+
+        mpThreadPool = std::make_unique<BS::thread_pool>(options.threadCount);
+    }
+
+    KeyframeStreamer::KeyframeStreamer(std::shared_ptr<const KeyframeFile> pFile, const Options& options)
+        : KeyframeStreamer(getTracks(pFile.get()), [pFile](uint32_t track, uint32_t keyframe, void* pDst) { pFile->readKeyframe(track, keyframe, pDst); }, options)
+    {}
+
+    KeyframeStreamer::~KeyframeStreamer()
+    {
+        for (auto& load : mPendingLoads) load.done.wait();
+    }
+
+    uint2 KeyframeStreamer::update(uint32_t track, uint2 keyframeIndices, const UploadFunc& upload)
+    {
+        FALCOR_CHECK(track < getTrackCount(), "Invalid track index {}.", track);
+        KeyframeWindow& window = mWindows[track];
+        const size_t keyframeSize = mTracks[track].keyframeSize;
+
+        // Upload the prefetched keyframes of the track that finished loading.
+        for (auto it = mPendingLoads.begin(); it != mPendingLoads.end();)
+        {
+            if (it->track == track && it->done.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+            {
+                finishLoad(*it, upload);
+                it = mPendingLoads.erase(it);
+            }
+            else ++it;
+        }
+
+        // Load the keyframes added to the window. Required keyframes are loaded right away.
+        for (const auto& load : window.update(keyframeIndices))
+        {
+            if (load.required)
+            {
+                mReadBuffer.resize(keyframeSize);
+                mRead(track, load.keyframe, mReadBuffer.data());
+                window.setLoaded(load.keyframe, load.slot);
+                upload(track, load.slot, mReadBuffer.data(), keyframeSize);
+                mStats.requiredLoadCount++;
+            }
+            else
+            {
+                PendingLoad& pending = mPendingLoads.emplace_back();
+                pending.track = track;
+                pending.keyframe = load.keyframe;
+                pending.slot = load.slot;
+                pending.data.resize(keyframeSize);
+                pending.done = mpThreadPool->submit([this, &pending]() { mRead(pending.track, pending.keyframe, pending.data.data()); });
+                mStats.prefetchCount++;
+            }
+        }
+
+        // Wait for required keyframes that are still being prefetched.
+        for (uint32_t keyframe : { keyframeIndices.x, keyframeIndices.y })
+        {
+            if (window.isResident(keyframe)) continue;
+
+            const uint32_t slot = window.getSlot(keyframe);
+            auto it = std::find_if(mPendingLoads.begin(), mPendingLoads.end(), [&](const PendingLoad& load) { return load.track == track && load.keyframe == keyframe && load.slot == slot; });
+            FALCOR_ASSERT(it != mPendingLoads.end());
+            it->done.wait();
+            finishLoad(*it, upload);
+            mPendingLoads.erase(it);
+            mStats.waitCount++;
+        }
+
+        return uint2(window.getSlot(keyframeIndices.x), window.getSlot(keyframeIndices.y));
+    }
+
+    void KeyframeStreamer::finishLoad(PendingLoad& load, const UploadFunc& upload)
+    {
+        // Rethrow read errors.
+        load.done.get();
+
+        if (mWindows[load.track].setLoaded(load.keyframe, load.slot))
+        {
+            upload(load.track, load.slot, load.data.data(), load.data.size());
+        }
+        else
+        {
+            mStats.discardedCount++;
+        }
+    }
+}
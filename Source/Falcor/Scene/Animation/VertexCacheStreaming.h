@@ -0,0 +1,278 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/Macros.h"
+#include "Scene/SceneCacheFile.h"
+#include "Utils/Math/Vector.h"
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <limits>
+#include <list>
+#include <memory>
+#include <vector>
+
+namespace BS
+{
+    class thread_pool;
+}
+
+namespace Falcor
+{
+    /** Options for streaming the keyframes of cached vertex animations, see AnimatedVertexCache.
+    */
+    struct VertexCacheStreamingOptions
+    {
+        bool enabled = false;           ///< Stream keyframes from disk instead of keeping all of them in GPU memory.
+        uint32_t windowSize = 8;        ///< Number of keyframes kept resident per animated mesh or curve set, at least 2.
+        uint32_t prefetchCount = 4;     ///< Number of upcoming keyframes loaded ahead of playback, at most windowSize - 2.
+    };
+
+    /** On-disk storage of the keyframes of a set of tracks.
+
+        A track is a sequence of keyframes of equal size, e.g. the vertex data of an animated mesh.
+        Keyframes are stored as individually compressed sections of a SceneCacheFile, so that any keyframe
+        can be read on its own. The sections are either stored in a file of their own, or embedded in
+        another SceneCacheFile such as the scene cache. Reading is thread-safe.
+    */
+    class FALCOR_API KeyframeFile
+    {
+    public:
+        struct TrackDesc
+        {
+            uint32_t keyframeCount = 0;
+            uint32_t reserved = 0;
+            uint64_t keyframeSize = 0;      ///< Size of each keyframe in bytes.
+        };
+
+        /** Function returning the data of a keyframe, which must stay valid until the next call.
+        */
+        using KeyframeFunc = std::function<const void*(uint32_t track, uint32_t keyframe)>;
+
+        /** Write a keyframe file, overwriting any existing file.
+            \param[in] path File path.
+            \param[in] tracks Description of the tracks.
+            \param[in] getKeyframe Function called once per keyframe, in order, to get its data.
+        */
+        static void write(const std::filesystem::path& path, const std::vector<TrackDesc>& tracks, const KeyframeFunc& getKeyframe);
+
+        /** Add the track table and keyframe sections to a file being written.
+            \param[in] writer Writer of the file.
+            \param[in] tracks Description of the tracks.
+            \param[in] getKeyframe Function called once per keyframe, in order, to get its data.
+        */
+        static void addSections(SceneCacheFile::Writer& writer, const std::vector<TrackDesc>& tracks, const KeyframeFunc& getKeyframe);
+
+        /** Open a keyframe file. Throws if the file is not a valid keyframe file.
+            \param[in] path File path.
+        */
+        KeyframeFile(const std::filesystem::path& path);
+
+        /** Open the keyframes embedded in a file with addSections(). Throws if the file holds no valid keyframes.
+            \param[in] pReader Reader of the file, which is shared with the caller.
+        */
+        KeyframeFile(std::shared_ptr<const SceneCacheFile::Reader> pReader);
+
+        uint32_t getTrackCount() const { return (uint32_t)mTracks.size(); }
+
+        const TrackDesc& getTrack(uint32_t track) const { return mTracks[track]; }
+
+        /** Read a keyframe.
+            \param[in] track Track index.
+            \param[in] keyframe Keyframe index.
+            \param[in] pDst Destination buffer of TrackDesc::keyframeSize bytes.
+        */
+        void readKeyframe(uint32_t track, uint32_t keyframe, void* pDst) const;
+
+    private:
+        void readTracks();
+
+        std::shared_ptr<const SceneCacheFile::Reader> mpReader;
+        std::vector<TrackDesc> mTracks;
+    };
+
+    /** Sliding window of keyframes of a single track kept in a fixed number of slots.
+
+        Each update receives the pair of keyframes interpolated at the current time. The window holds these two
+        keyframes followed by the next keyframes in playback order, wrapping around at the end of the track as
+        animations are looped by default. Keyframes missing from the window are assigned to slots, reusing the
+        slots of the keyframes needed furthest in the future. The window only schedules loads, the caller loads
+        the data into the slots and reports completion with setLoaded().
+    */
+    class FALCOR_API KeyframeWindow
+    {
+    public:
+        static constexpr uint32_t kInvalidSlot = std::numeric_limits<uint32_t>::max();
+
+        struct Load
+        {
+            uint32_t keyframe;
+            uint32_t slot;
+            bool required;      ///< True if the keyframe is interpolated at the current time, false if it is prefetched.
+        };
+
+        /** Constructor.
+            \param[in] keyframeCount Number of keyframes in the track.
+            \param[in] slotCount Number of slots, clamped to the keyframe count. Must be at least 2 unless the track has a single keyframe.
+            \param[in] prefetchCount Number of keyframes to prefetch, clamped to the slot count minus 2.
+        */
+        KeyframeWindow(uint32_t keyframeCount, uint32_t slotCount, uint32_t prefetchCount);
+
+        /** Update the window.
+            \param[in] keyframeIndices Keyframes interpolated at the current time.
+            \return Keyframes newly assigned to slots, which need to be loaded. Required loads come first, prefetches follow in playback order.
+        */
+        std::vector<Load> update(uint2 keyframeIndices);
+
+        /** Mark a keyframe as loaded into its slot.
+            \return False if the keyframe has been evicted from the slot since the load was issued, true otherwise.
+        */
+        bool setLoaded(uint32_t keyframe, uint32_t slot);
+
+        /** Get the slot a keyframe is assigned to, or kInvalidSlot if it is not in the window.
+        */
+        uint32_t getSlot(uint32_t keyframe) const { return mKeyframeSlots[keyframe]; }
+
+        /** Check if a keyframe is assigned to a slot and loaded.
+        */
+        bool isResident(uint32_t keyframe) const;
+
+        uint32_t getKeyframeCount() const { return (uint32_t)mKeyframeSlots.size(); }
+        uint32_t getSlotCount() const { return (uint32_t)mSlots.size(); }
+        uint32_t getPrefetchCount() const { return mPrefetchCount; }
+
+    private:
+        struct Slot
+        {
+            uint32_t keyframe = kInvalidSlot;
+            bool loaded = false;
+        };
+
+        uint32_t findFreeSlot(uint32_t playhead) const;
+
+        std::vector<uint32_t> mKeyframeSlots;   ///< Slot of each keyframe, or kInvalidSlot.
+        std::vector<Slot> mSlots;
+        std::vector<uint32_t> mWanted;          ///< Keyframes wanted in the window by the last update.
+        uint32_t mPrefetchCount = 0;
+    };
+
+    /** Streams the keyframes of a set of tracks into fixed sets of slots, one KeyframeWindow per track.
+
+        Keyframes are read through a read function, e.g. from a KeyframeFile. Only the keyframes in flight are
+        held in memory. Prefetched keyframes are read and decompressed on worker threads. The data is handed to the upload function
+        on the thread calling update(), once the read has finished, so the slots (e.g. GPU buffers) are only ever
+        written from that thread. Keyframes needed at the current time that have not been prefetched are read
+        synchronously.
+    */
+    class FALCOR_API KeyframeStreamer
+    {
+    public:
+        /** Function writing the data of a keyframe to a slot of a track.
+        */
+        using UploadFunc = std::function<void(uint32_t track, uint32_t slot, const void* pData, size_t size)>;
+
+        /** Function reading a keyframe of a track into a buffer of TrackDesc::keyframeSize bytes. Called concurrently from the worker threads.
+        */
+        using ReadFunc = std::function<void(uint32_t track, uint32_t keyframe, void* pDst)>;
+
+        struct Options
+        {
+            uint32_t windowSize = 8;        ///< Number of slots per track.
+            uint32_t prefetchCount = 4;     ///< Number of keyframes prefetched per track.
+            uint32_t threadCount = 1;       ///< Number of threads reading prefetched keyframes.
+
+            // Note: Empty constructor needed for clang due to the use of the nested struct constructor in the parent constructor.
+            Options() {}
+        };
+
+        struct Stats
+        {
+            uint64_t prefetchCount = 0;         ///< Number of keyframes read ahead of time.
+            uint64_t requiredLoadCount = 0;     ///< Number of keyframes read synchronously because they were not prefetched.
+            uint64_t waitCount = 0;             ///< Number of updates that waited for a prefetch in flight.
+            uint64_t discardedCount = 0;        ///< Number of prefetched keyframes evicted before they finished loading.
+        };
+
+        /** Constructor.
+            \param[in] tracks Description of the tracks.
+            \param[in] read Function reading keyframes, which must be thread-safe.
+            \param[in] options Options.
+        */
+        KeyframeStreamer(std::vector<KeyframeFile::TrackDesc> tracks, ReadFunc read, const Options& options = Options());
+
+        /** Create a streamer reading the tracks of a keyframe file.
+            \param[in] pFile Keyframe file.
+            \param[in] options Options.
+        */
+        KeyframeStreamer(std::shared_ptr<const KeyframeFile> pFile, const Options& options = Options());
+
+        /** Destructor. Waits for all reads in flight.
+        */
+        ~KeyframeStreamer();
+
+        /** Update the window of a track and upload all keyframes that finished loading.
+            \param[in] track Track index.
+            \param[in] keyframeIndices Keyframes interpolated at the current time.
+            \param[in] upload Function writing keyframe data to a slot.
+            \return Slots holding the two keyframes, which are loaded when the function returns.
+        */
+        uint2 update(uint32_t track, uint2 keyframeIndices, const UploadFunc& upload);
+
+        uint32_t getTrackCount() const { return (uint32_t)mWindows.size(); }
+
+        /** Get the number of slots used by a track, which is at most the window size.
+        */
+        uint32_t getSlotCount(uint32_t track) const { return mWindows[track].getSlotCount(); }
+
+        const KeyframeWindow& getWindow(uint32_t track) const { return mWindows[track]; }
+
+        const KeyframeFile::TrackDesc& getTrack(uint32_t track) const { return mTracks[track]; }
+
+        const Stats& getStats() const { return mStats; }
+
+    private:
+        struct PendingLoad
+        {
+            uint32_t track;
+            uint32_t keyframe;
+            uint32_t slot;
+            std::vector<uint8_t> data;
+            std::future<void> done;
+        };
+
+        void finishLoad(PendingLoad& load, const UploadFunc& upload);
+
+        std::vector<KeyframeFile::TrackDesc> mTracks;
+        ReadFunc mRead;
+        std::vector<KeyframeWindow> mWindows;
+        std::list<PendingLoad> mPendingLoads;
+        std::vector<uint8_t> mReadBuffer;
+        std::unique_ptr<BS::thread_pool> mpThreadPool;
+        Stats mStats;
+    };
+}
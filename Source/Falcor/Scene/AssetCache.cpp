@@ -0,0 +1,239 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "AssetCache.h"
+#include "Core/Error.h"
+#include "Core/Platform/OS.h"
+#include "Utils/Logger.h"
+
+#include <algorithm>
+#include <set>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Scene asset cache directory (subdirectory in the application data directory).
+        */
+        const std::string kDirectory = "NVIDIA/Falcor/AssetCache";
+
+        /** File format versions. These need to be incremented every time the layout of the entries or manifests changes.
+            Changes to how an asset is processed are handled by including a version in the entry key instead.
+        */
+        const uint32_t kEntryVersion = 1;
+        const uint32_t kManifestVersion = 2;
+
+        const std::string kEntriesSection = "Entries";
+    }
+
+    AssetCache::AssetCache(const std::filesystem::path& directory, const Options& options)
+        : mDirectory(directory)
+        , mOptions(options)
+        , mEntries(mDirectory / "entries")
+        , mManifests(mDirectory / "manifests")
+    {
+    }
+
+    std::filesystem::path AssetCache::getDefaultDirectory()
+    {
+        return getAppDataDirectory() / kDirectory;
+    }
+
+    std::string AssetCache::toString(const Key& key)
+    {
+        return FastHash128::toString(key);
+    }
+
+    bool AssetCache::hasEntry(const Key& key) const
+    {
+        return std::filesystem::exists(getEntryPath(key));
+    }
+
+    void AssetCache::writeEntry(const Key& key, const std::function<void(SceneCacheFile::Writer& writer)>& write)
+    {
+        // Entries are small compared to whole scenes, so they are compressed on the calling thread.
+        // Callers typically process many assets in parallel.
+        SceneCacheFile::Writer::Options writerOptions;
+        writerOptions.codec = mOptions.codec;
+        writerOptions.threadCount = 1;
+
+        mEntries.writeFile(getEntryPath(key), [&](const std::filesystem::path& tempPath)
+        {
+            SceneCacheFile::Writer writer(tempPath, kEntryVersion, writerOptions);
+            write(writer);
+            writer.finalize();
+        });
+    }
+
+    std::unique_ptr<SceneCacheFile::Reader> AssetCache::openEntry(const Key& key) const
+    {
+        auto path = getEntryPath(key);
+        if (!std::filesystem::exists(path)) return nullptr;
+
+        std::unique_ptr<SceneCacheFile::Reader> pReader;
+        try
+        {
+            pReader = std::make_unique<SceneCacheFile::Reader>(path, 1);
+        }
+        catch (const std::exception& e)
+        {
+            logWarning("Ignoring invalid asset cache entry '{}': {}", path, e.what());
+            return nullptr;
+        }
+        if (pReader->getVersion() != kEntryVersion) return nullptr;
+
+        DiskCacheDirectory::markUsed(path);
+        return pReader;
+    }
+
+    void AssetCache::removeEntry(const Key& key)
+    {
+        DiskCacheDirectory::removeFile(getEntryPath(key));
+    }
+
+    void AssetCache::writeManifest(const Key& sceneKey, const std::vector<Key>& entries)
+    {
+        mManifests.writeFile(getManifestPath(sceneKey), [&](const std::filesystem::path& tempPath)
+        {
+            SceneCacheFile::Writer::Options writerOptions;
+            writerOptions.threadCount = 1;
+            SceneCacheFile::Writer writer(tempPath, kManifestVersion, writerOptions);
+            writer.addSection(kEntriesSection, entries);
+            writer.finalize();
+        });
+    }
+
+    std::optional<std::vector<AssetCache::Key>> AssetCache::readManifest(const Key& sceneKey) const
+    {
+        auto path = getManifestPath(sceneKey);
+        if (!std::filesystem::exists(path)) return std::nullopt;
+
+        try
+        {
+            SceneCacheFile::Reader reader(path, 1);
+            if (reader.getVersion() != kManifestVersion) return std::nullopt;
+            std::vector<Key> entries;
+            reader.readSection(kEntriesSection, entries);
+            return entries;
+        }
+        catch (const std::exception&)
+        {
+            return std::nullopt;
+        }
+    }
+
+    void AssetCache::removeManifest(const Key& sceneKey)
+    {
+        DiskCacheDirectory::removeFile(getManifestPath(sceneKey));
+    }
+
+    uint64_t AssetCache::collectGarbage()
+    {
+        auto referenced = listReferencedEntries(true);
+        std::set<std::string> referencedNames;
+        for (const auto& key : referenced) referencedNames.insert(toString(key));
+
+        uint64_t freedSize = 0;
+        for (const auto& entry : mEntries.listFiles())
+        {
+            if (referencedNames.count(entry.path.filename().string()) == 0) freedSize += DiskCacheDirectory::removeFile(entry.path);
+        }
+
+        freedSize += mEntries.removeTempFiles();
+        freedSize += mManifests.removeTempFiles();
+        return freedSize;
+    }
+
+    uint64_t AssetCache::enforceSizeBudget()
+    {
+        auto entries = mEntries.listFiles();
+        uint64_t totalSize = 0;
+        for (const auto& entry : entries) totalSize += entry.size;
+        if (totalSize <= mOptions.sizeBudget) return 0;
+
+        auto referenced = listReferencedEntries(false);
+        std::set<std::string> referencedNames;
+        for (const auto& key : referenced) referencedNames.insert(toString(key));
+
+        // Evict unreferenced entries first, each group in least recently used order.
+        DiskCacheDirectory::sortByLastUse(entries);
+        std::stable_partition(entries.begin(), entries.end(), [&](const DiskCacheDirectory::File& entry)
+        {
+            return referencedNames.count(entry.path.filename().string()) == 0;
+        });
+        return DiskCacheDirectory::evict(entries, mOptions.sizeBudget);
+    }
+
+    AssetCache::Stats AssetCache::getStats() const
+    {
+        Stats stats;
+        for (const auto& entry : mEntries.listFiles())
+        {
+            stats.entryCount++;
+            stats.totalSize += entry.size;
+        }
+        stats.manifestCount = mManifests.listFiles().size();
+        return stats;
+    }
+
+    std::filesystem::path AssetCache::getEntryPath(const Key& key) const
+    {
+        auto name = toString(key);
+        return mEntries.getPath() / name.substr(0, 2) / name;
+    }
+
+    std::filesystem::path AssetCache::getManifestPath(const Key& sceneKey) const
+    {
+        return mManifests.getPath() / toString(sceneKey);
+    }
+
+    std::vector<AssetCache::Key> AssetCache::listReferencedEntries(bool removeInvalid)
+    {
+        std::vector<Key> referenced;
+        std::vector<std::filesystem::path> invalidManifests;
+        for (const auto& manifest : mManifests.listFiles())
+        {
+            try
+            {
+                SceneCacheFile::Reader reader(manifest.path, 1);
+                std::vector<Key> entries;
+                if (reader.getVersion() != kManifestVersion) FALCOR_THROW("Unsupported manifest version {}.", reader.getVersion());
+                reader.readSection(kEntriesSection, entries);
+                referenced.insert(referenced.end(), entries.begin(), entries.end());
+            }
+            catch (const std::exception&)
+            {
+                invalidManifests.push_back(manifest.path);
+            }
+        }
+        if (removeInvalid)
+        {
+            for (const auto& path : invalidManifests) DiskCacheDirectory::removeFile(path);
+        }
+        return referenced;
+    }
+}
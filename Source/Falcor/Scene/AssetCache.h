@@ -0,0 +1,149 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "SceneCacheFile.h"
+#include "Core/Macros.h"
+#include "Utils/DiskCacheDirectory.h"
+#include "Utils/FastHash.h"
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Falcor
+{
+    /** Content-addressed cache of processed scene assets.
+
+        Each entry holds the processed data of a single asset (e.g. a mesh after SceneBuilder::processMesh)
+        and is keyed by a hash of all inputs and build flags that affect the processed data. Entries are stored
+        as individual SceneCacheFile files, so editing a single asset of a scene only requires reprocessing that asset.
+
+        A manifest lists the entries used by a scene. Entries that are not referenced by any manifest are
+        removed by collectGarbage(). The total size of the entries is limited by enforceSizeBudget(), which
+        evicts unreferenced entries first and otherwise the least recently used ones.
+
+        Only meshes are cached. Curve tessellation is done by the USD importer on its own curve data before the
+        curves are passed to the SceneBuilder, so tessellated curves are not cached.
+
+        Entries and manifests are stored in a DiskCacheDirectory each.
+        All functions can be called concurrently from multiple threads.
+    */
+    class FALCOR_API AssetCache
+    {
+    public:
+        using Key = FastHash128::MD;
+
+        struct Options
+        {
+            uint64_t sizeBudget = 16ull * 1024 * 1024 * 1024;       ///< Maximum total size of all entries in bytes.
+            SceneCacheFile::Codec codec = SceneCacheFile::Codec::LZ4; ///< Codec used for writing entries.
+
+            // Note: Empty constructor needed for clang due to the use of the nested struct constructor in the parent constructor.
+            Options() {}
+        };
+
+        struct Stats
+        {
+            uint64_t entryCount = 0;
+            uint64_t manifestCount = 0;
+            uint64_t totalSize = 0;     ///< Total size of all entries in bytes.
+        };
+
+        /** Create a cache.
+            \param[in] directory Cache directory. Created if it does not exist.
+            \param[in] options Options.
+        */
+        AssetCache(const std::filesystem::path& directory, const Options& options = Options());
+
+        /** Get the default cache directory (subdirectory in the application data directory).
+        */
+        static std::filesystem::path getDefaultDirectory();
+
+        /** Convert a key to the hexadecimal string used as file name of entries and manifests.
+        */
+        static std::string toString(const Key& key);
+
+        const std::filesystem::path& getDirectory() const { return mDirectory; }
+        const Options& getOptions() const { return mOptions; }
+
+        bool hasEntry(const Key& key) const;
+
+        /** Write an entry, replacing any existing entry with the same key.
+            \param[in] key Entry key.
+            \param[in] write Function adding the sections of the entry.
+        */
+        void writeEntry(const Key& key, const std::function<void(SceneCacheFile::Writer& writer)>& write);
+
+        /** Open an entry and mark it as recently used.
+            \param[in] key Entry key.
+            \return The entry reader, or nullptr if the entry does not exist or is invalid.
+        */
+        std::unique_ptr<SceneCacheFile::Reader> openEntry(const Key& key) const;
+
+        void removeEntry(const Key& key);
+
+        /** Write a scene manifest, replacing any existing manifest with the same key.
+            \param[in] sceneKey Scene key.
+            \param[in] entries Keys of the entries used by the scene.
+        */
+        void writeManifest(const Key& sceneKey, const std::vector<Key>& entries);
+
+        /** Read a scene manifest.
+            \return The keys of the entries used by the scene, or std::nullopt if the manifest does not exist or is invalid.
+        */
+        std::optional<std::vector<Key>> readManifest(const Key& sceneKey) const;
+
+        void removeManifest(const Key& sceneKey);
+
+        /** Remove all entries that are not referenced by any manifest, as well as invalid manifests and leftover temporary files.
+            \return Number of bytes freed.
+        */
+        uint64_t collectGarbage();
+
+        /** Remove entries until the total size is within the size budget.
+            Entries not referenced by any manifest are removed first, then entries in least recently used order.
+            \return Number of bytes freed.
+        */
+        uint64_t enforceSizeBudget();
+
+        Stats getStats() const;
+
+    private:
+        std::filesystem::path getEntryPath(const Key& key) const;
+        std::filesystem::path getManifestPath(const Key& sceneKey) const;
+        std::vector<Key> listReferencedEntries(bool removeInvalid);
+
+        std::filesystem::path mDirectory;
+        Options mOptions;
+        DiskCacheDirectory mEntries;    ///< Entry files, in subdirectories named after the first two characters of the key.
+        DiskCacheDirectory mManifests;  ///< Manifest files.
+    };
+}
@@ -0,0 +1,377 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "AssimpConversion.h"
+#include "Scene.h"
+#include "Core/Error.h"
+#include "Utils/StringUtils.h"
+#include "Utils/NumericRange.h"
+
+#include <assimp/scene.h>
+#include <assimp/GltfMaterial.h>
+
+#include <algorithm>
+#include <execution>
+#include <limits>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Mapping from Assimp to Falcor texture type.
+        */
+        struct TextureMapping
+        {
+            aiTextureType aiType;
+            unsigned int aiIndex;
+            Material::TextureSlot targetType;
+        };
+
+        /** Mapping tables for the different import modes.
+        */
+        static const std::vector<TextureMapping> kTextureMappings[3] =
+        {
+            // Default mappings
+            {
+                { aiTextureType_DIFFUSE, 0, Material::TextureSlot::BaseColor },
+                { aiTextureType_SPECULAR, 0, Material::TextureSlot::Specular },
+                { aiTextureType_EMISSIVE, 0, Material::TextureSlot::Emissive },
+                { aiTextureType_NORMALS, 0, Material::TextureSlot::Normal },
+            },
+            // OBJ mappings
+            {
+                { aiTextureType_DIFFUSE, 0, Material::TextureSlot::BaseColor },
+                { aiTextureType_SPECULAR, 0, Material::TextureSlot::Specular },
+                { aiTextureType_EMISSIVE, 0, Material::TextureSlot::Emissive },
+                // OBJ does not offer a normal map, thus we use the bump map instead.
+                { aiTextureType_HEIGHT, 0, Material::TextureSlot::Normal },
+                { aiTextureType_DISPLACEMENT, 0, Material::TextureSlot::Normal },
+            },
+            // GLTF2 mappings
+            {
+                { aiTextureType_DIFFUSE, 0, Material::TextureSlot::BaseColor },
+                { aiTextureType_EMISSIVE, 0, Material::TextureSlot::Emissive },
+                { aiTextureType_NORMALS, 0, Material::TextureSlot::Normal },
+                // GLTF2 exposes metallic roughness texture.
+                { AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_METALLICROUGHNESS_TEXTURE, Material::TextureSlot::Specular },
+            }
+        };
+
+        /** Run func(i) for all i in [0, count), in parallel if requested.
+        */
+        template<typename Func>
+        void forEachIndex(size_t count, bool parallel, const Func& func)
+        {
+            auto range = NumericRange<size_t>(0, count);
+            if (parallel) std::for_each(std::execution::par, range.begin(), range.end(), func);
+            else std::for_each(range.begin(), range.end(), func);
+        }
+
+        /** Converts specular power to roughness. Note there is no "the conversion".
+            Reference: http://simonstechblog.blogspot.com/2011/12/microfacet-brdf.html
+            \param[in] specPower Specular power of an obsolete Phong BSDF.
+        */
+        float convertSpecPowerToRoughness(float specPower)
+        {
+            return std::clamp(std::sqrt(2.0f / (specPower + 2.0f)), 0.f, 1.f);
+        }
+
+        void createTexCrdList(const aiVector3D* pAiTexCrd, uint32_t count, std::vector<float2>& texCrds)
+        {
+            texCrds.resize(count);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                FALCOR_ASSERT(pAiTexCrd[i].z == 0);
+                texCrds[i] = float2(pAiTexCrd[i].x, pAiTexCrd[i].y);
+            }
+        }
+
+        void createTangentList(const aiVector3D* pAiTangent, const aiVector3D* pAiBitangent, const aiVector3D* pAiNormal, uint32_t count, std::vector<float4>& tangents)
+        {
+            tangents.resize(count);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                // We compute the bitangent at runtime as defined by MikkTSpace: cross(N, tangent.xyz) * tangent.w.
+                // Compute the orientation of the loaded bitangent here to set the sign (w) correctly.
+                float3 T = float3(pAiTangent[i].x, pAiTangent[i].y, pAiTangent[i].z);
+                float3 B = float3(pAiBitangent[i].x, pAiBitangent[i].y, pAiBitangent[i].z);
+                float3 N = float3(pAiNormal[i].x, pAiNormal[i].y, pAiNormal[i].z);
+                float sign = dot(cross(N, T), B) >= 0.f ? 1.f : -1.f;
+                tangents[i] = float4(normalize(T), sign);
+            }
+        }
+
+        void createIndexList(const aiMesh* pAiMesh, std::vector<uint32_t>& indices)
+        {
+            const uint32_t perFaceIndexCount = pAiMesh->mFaces[0].mNumIndices;
+            const uint32_t indexCount = pAiMesh->mNumFaces * perFaceIndexCount;
+
+            indices.resize(indexCount);
+            for (uint32_t i = 0; i < pAiMesh->mNumFaces; i++)
+            {
+                FALCOR_ASSERT(pAiMesh->mFaces[i].mNumIndices == perFaceIndexCount); // Mesh contains mixed primitive types, can be solved using aiProcess_SortByPType
+                for (uint32_t j = 0; j < perFaceIndexCount; j++)
+                    indices[i * perFaceIndexCount + j] = (uint32_t)(pAiMesh->mFaces[i].mIndices[j]);
+            }
+        }
+
+        void loadBones(const aiMesh* pAiMesh, const AssimpBoneLookup& boneLookup, AssimpMeshData& meshData)
+        {
+            const uint32_t vertexCount = pAiMesh->mNumVertices;
+            auto& weights = meshData.boneWeights;
+            auto& ids = meshData.boneIDs;
+
+            weights.assign(vertexCount, float4(0.f));
+            ids.assign(vertexCount, uint4(NodeID::kInvalidID));
+            static_assert(sizeof(uint4) == 4 * sizeof(NodeID::IntType));
+
+            uint32_t ignoredCount = 0;
+            for (uint32_t bone = 0; bone < pAiMesh->mNumBones; bone++)
+            {
+                const aiBone* pAiBone = pAiMesh->mBones[bone];
+                NodeID aiBoneID = boneLookup(pAiBone->mName.C_Str());
+
+                // The way Assimp works, the weights holds the IDs of the vertices it affects.
+                // We loop over all the weights, initializing the vertices data along the way
+                for (uint32_t weightID = 0; weightID < pAiBone->mNumWeights; weightID++)
+                {
+                    // Get the vertex the current weight affects
+                    const aiVertexWeight& aiWeight = pAiBone->mWeights[weightID];
+
+                    // Skip zero weights
+                    if (aiWeight.mWeight == 0.f) continue;
+
+                    // Get the address of the Bone ID and weight for the current vertex
+                    uint4& vertexIds = ids[aiWeight.mVertexId];
+                    float4& vertexWeights = weights[aiWeight.mVertexId];
+
+                    // Find the next unused slot in the bone array of the vertex, and initialize it with the current value
+                    bool emptySlotFound = false;
+                    for (uint32_t j = 0; j < Scene::kMaxBonesPerVertex; j++)
+                    {
+                        if (vertexIds[j] == NodeID::kInvalidID)
+                        {
+                            vertexIds[j] = aiBoneID.getSlang();
+                            vertexWeights[j] = aiWeight.mWeight;
+                            emptySlotFound = true;
+                            break;
+                        }
+                    }
+
+                    if (!emptySlotFound) ignoredCount++;
+                }
+            }
+
+            if (ignoredCount > 0)
+            {
+                meshData.warnings.push_back(fmt::format(
+                    "AssimpImporter: Mesh '{}' has vertices with too many bones attached to them. {} bone weights will be ignored and the animation might not look correct.",
+                    pAiMesh->mName.C_Str(), ignoredCount));
+            }
+
+            // Now we need to normalize the weights for each vertex, since in some models the sum is larger than 1
+            for (uint32_t i = 0; i < vertexCount; i++)
+            {
+                float4& w = weights[i];
+                float f = 0;
+                for (uint32_t j = 0; j < Scene::kMaxBonesPerVertex; j++) f += w[j];
+                w /= f;
+            }
+        }
+
+        AssimpMeshData convertMesh(const aiMesh* pAiMesh, const AssimpBoneLookup& boneLookup, const AssimpConversionOptions& options)
+        {
+            AssimpMeshData meshData;
+
+            createIndexList(pAiMesh, meshData.indices);
+            FALCOR_ASSERT(meshData.indices.size() <= std::numeric_limits<uint32_t>::max());
+
+            if (pAiMesh->HasTextureCoords(0))
+            {
+                createTexCrdList(pAiMesh->mTextureCoords[0], pAiMesh->mNumVertices, meshData.texCrds);
+                FALCOR_ASSERT(!meshData.texCrds.empty());
+            }
+
+            if (options.loadTangents && pAiMesh->HasTangentsAndBitangents())
+            {
+                createTangentList(pAiMesh->mTangents, pAiMesh->mBitangents, pAiMesh->mNormals, pAiMesh->mNumVertices, meshData.tangents);
+                FALCOR_ASSERT(!meshData.tangents.empty());
+            }
+
+            if (pAiMesh->HasBones()) loadBones(pAiMesh, boneLookup, meshData);
+
+            return meshData;
+        }
+
+        void convertTextures(const aiMaterial* pAiMaterial, const std::filesystem::path& searchPath, AssimpImportMode importMode, AssimpMaterialData& materialData)
+        {
+            const auto& textureMappings = kTextureMappings[int(importMode)];
+
+            for (const auto& source : textureMappings)
+            {
+                // Skip if texture of requested type is not available
+                if (pAiMaterial->GetTextureCount(source.aiType) < source.aiIndex + 1) continue;
+
+                // Get the texture name
+                aiString aiPath;
+                pAiMaterial->GetTexture(source.aiType, source.aiIndex, &aiPath);
+                std::string path(aiPath.data);
+                // In GLTF2, the path is encoded as a URI
+                if (importMode == AssimpImportMode::GLTF2) path = decodeURI(path);
+                // Assets may contain windows native paths, replace '\' with '/' to make compatible on Linux.
+                std::replace(path.begin(), path.end(), '\\', '/');
+                if (path.empty())
+                {
+                    materialData.warnings.push_back("AssimpImporter: Texture has empty file name, ignoring.");
+                    continue;
+                }
+
+                materialData.textures.emplace_back(source.targetType, searchPath / path);
+            }
+        }
+
+        AssimpMaterialData convertMaterial(const aiMaterial* pAiMaterial, const std::filesystem::path& searchPath, AssimpImportMode importMode)
+        {
+            AssimpMaterialData materialData;
+
+            aiString name;
+            pAiMaterial->Get(AI_MATKEY_NAME, name);
+
+            // Parse the name
+            materialData.name = std::string(name.C_Str());
+            if (materialData.name.empty())
+            {
+                materialData.warnings.push_back("AssimpImporter: Material with no name found -> renaming to 'unnamed'.");
+                materialData.name = "unnamed";
+            }
+
+            convertTextures(pAiMaterial, searchPath, importMode, materialData);
+
+            // Opacity
+            float opacity;
+            if (pAiMaterial->Get(AI_MATKEY_OPACITY, opacity) == AI_SUCCESS) materialData.opacity = opacity;
+
+            // Bump scaling
+            // TODO AI_MATKEY_BUMPSCALING should probably be a multiplier to the normal map
+
+            // Shininess
+            float shininess;
+            if (pAiMaterial->Get(AI_MATKEY_SHININESS, shininess) == AI_SUCCESS)
+            {
+                // Convert OBJ/MTL Phong exponent to glossiness.
+                if (importMode == AssimpImportMode::OBJ)
+                {
+                    float roughness = convertSpecPowerToRoughness(shininess);
+                    shininess = 1.f - roughness;
+                }
+                materialData.shininess = shininess;
+            }
+
+            // Refraction
+            float refraction;
+            if (pAiMaterial->Get(AI_MATKEY_REFRACTI, refraction) == AI_SUCCESS) materialData.ior = refraction;
+
+            // Diffuse, specular and emissive colors
+            aiColor3D color;
+            if (pAiMaterial->Get(AI_MATKEY_COLOR_DIFFUSE, color) == AI_SUCCESS) materialData.diffuseColor = float3(color.r, color.g, color.b);
+            if (pAiMaterial->Get(AI_MATKEY_COLOR_SPECULAR, color) == AI_SUCCESS) materialData.specularColor = float3(color.r, color.g, color.b);
+            if (pAiMaterial->Get(AI_MATKEY_COLOR_EMISSIVE, color) == AI_SUCCESS) materialData.emissiveColor = float3(color.r, color.g, color.b);
+
+            // Double-Sided
+            int isDoubleSided;
+            if (pAiMaterial->Get(AI_MATKEY_TWOSIDED, isDoubleSided) == AI_SUCCESS) materialData.doubleSided = isDoubleSided != 0;
+
+            // Handle GLTF2 PBR materials
+            if (importMode == AssimpImportMode::GLTF2)
+            {
+                if (pAiMaterial->Get(AI_MATKEY_BASE_COLOR, color) == AI_SUCCESS) materialData.baseColor = float3(color.r, color.g, color.b);
+
+                float metallic;
+                if (pAiMaterial->Get(AI_MATKEY_METALLIC_FACTOR, metallic) == AI_SUCCESS) materialData.metallic = metallic;
+
+                float roughness;
+                if (pAiMaterial->Get(AI_MATKEY_ROUGHNESS_FACTOR, roughness) == AI_SUCCESS) materialData.roughness = roughness;
+            }
+
+            // Parse the information contained in the name
+            // Tokens following a '.' are interpreted as special flags
+            auto nameVec = splitString(materialData.name, ".");
+            for (size_t i = 1; i < nameVec.size(); i++)
+            {
+                std::string str = nameVec[i];
+                std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+                if (str == "doublesided")
+                {
+                    materialData.doubleSided = true;
+                }
+                else
+                {
+                    materialData.warnings.push_back(fmt::format(
+                        "AssimpImporter: Material '{}' has an unknown material property: '{}'.", materialData.name, nameVec[i]));
+                }
+            }
+
+            return materialData;
+        }
+    }
+
+    std::vector<AssimpMeshData> convertAssimpMeshes(
+        const aiScene* pScene,
+        fstd::span<const uint32_t> meshIndices,
+        const AssimpBoneLookup& boneLookup,
+        const AssimpConversionOptions& options)
+    {
+        FALCOR_CHECK(pScene != nullptr, "'pScene' must not be null.");
+        for (uint32_t meshIndex : meshIndices)
+        {
+            FALCOR_CHECK(meshIndex < pScene->mNumMeshes, "Mesh index {} is out of range.", meshIndex);
+            FALCOR_CHECK(pScene->mMeshes[meshIndex]->HasFaces(), "Mesh '{}' has no faces.", pScene->mMeshes[meshIndex]->mName.C_Str());
+        }
+
+        std::vector<AssimpMeshData> meshData(meshIndices.size());
+        forEachIndex(meshIndices.size(), options.useParallelConversion, [&](size_t i)
+        {
+            meshData[i] = convertMesh(pScene->mMeshes[meshIndices[i]], boneLookup, options);
+        });
+        return meshData;
+    }
+
+    std::vector<AssimpMaterialData> convertAssimpMaterials(
+        const aiScene* pScene,
+        const std::filesystem::path& searchPath,
+        const AssimpConversionOptions& options)
+    {
+        FALCOR_CHECK(pScene != nullptr, "'pScene' must not be null.");
+
+        std::vector<AssimpMaterialData> materialData(pScene->mNumMaterials);
+        forEachIndex(materialData.size(), options.useParallelConversion, [&](size_t i)
+        {
+            materialData[i] = convertMaterial(pScene->mMaterials[i], searchPath, options.importMode);
+        });
+        return materialData;
+    }
+}
@@ -0,0 +1,127 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "SceneIDs.h"
+#include "Core/Macros.h"
+#include "Scene/Material/Material.h"
+#include "Utils/Math/Vector.h"
+#include <fstd/span.h> // TODO C++20: Replace with <span>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct aiScene;
+
+namespace Falcor
+{
+    /** Special treatment of the source file format.
+    */
+    enum class AssimpImportMode
+    {
+        Default,
+        OBJ,
+        GLTF2,
+    };
+
+    struct AssimpConversionOptions
+    {
+        AssimpImportMode importMode = AssimpImportMode::Default;
+        bool loadTangents = false;              ///< Convert the tangents of meshes that have them.
+        bool useParallelConversion = true;      ///< Convert meshes and materials in parallel. The results are the same in both cases.
+    };
+
+    /** Vertex and index data converted from an Assimp mesh.
+        Positions and normals are not converted, they can be used directly from the aiMesh.
+    */
+    struct AssimpMeshData
+    {
+        std::vector<uint32_t> indices;          ///< Triangle list indices.
+        std::vector<float2> texCrds;            ///< Texture coordinates, or empty if the mesh has none.
+        std::vector<float4> tangents;           ///< Tangents with the bitangent sign in w, or empty if not loaded.
+        std::vector<uint4> boneIDs;             ///< Bone node IDs per vertex, or empty if the mesh has no bones.
+        std::vector<float4> boneWeights;        ///< Normalized bone weights per vertex, or empty if the mesh has no bones.
+        std::vector<std::string> warnings;      ///< Warnings to be logged by the importer.
+    };
+
+    /** Material parameters converted from an Assimp material.
+        Parameters that are not set by the material are left empty, so that the material defaults are used.
+    */
+    struct AssimpMaterialData
+    {
+        std::string name;
+        std::vector<std::pair<Material::TextureSlot, std::filesystem::path>> textures; ///< Textures to load, in load order.
+        std::optional<float> opacity;           ///< Base color alpha.
+        std::optional<float> shininess;         ///< Specular params alpha. Converted to glossiness for OBJ files.
+        std::optional<float> ior;
+        std::optional<float3> diffuseColor;
+        std::optional<float3> specularColor;
+        std::optional<float3> emissiveColor;
+        std::optional<bool> doubleSided;
+        std::optional<float3> baseColor;        ///< glTF base color, overrides the diffuse color.
+        std::optional<float> metallic;          ///< glTF metallic factor.
+        std::optional<float> roughness;         ///< glTF roughness factor.
+        std::vector<std::string> warnings;      ///< Warnings to be logged by the importer.
+    };
+
+    /** Function returning the ID of the scene graph node of a bone by name.
+        It is called concurrently when converting in parallel.
+    */
+    using AssimpBoneLookup = std::function<NodeID(const std::string& boneName)>;
+
+    /** Convert the index, texture coordinate, tangent and bone data of a set of triangle meshes.
+        Each mesh is converted independently, in parallel if enabled, and stored at the same position as its index,
+        so the result does not depend on the thread count.
+        \param[in] pScene Assimp scene.
+        \param[in] meshIndices Indices of the meshes to convert. All faces of these meshes need to be triangles.
+        \param[in] boneLookup Function returning the node ID of a bone. Only called for meshes with bones.
+        \param[in] options Conversion options.
+        \return Converted data, one entry per mesh index.
+    */
+    FALCOR_API std::vector<AssimpMeshData> convertAssimpMeshes(
+        const aiScene* pScene,
+        fstd::span<const uint32_t> meshIndices,
+        const AssimpBoneLookup& boneLookup,
+        const AssimpConversionOptions& options
+    );
+
+    /** Convert the parameters and texture references of all materials of a scene.
+        No textures are loaded, this is left to the importer so that all texture I/O goes through the TextureManager.
+        \param[in] pScene Assimp scene.
+        \param[in] searchPath Directory that texture paths are relative to.
+        \param[in] options Conversion options.
+        \return Converted data, one entry per material of the scene.
+    */
+    FALCOR_API std::vector<AssimpMaterialData> convertAssimpMaterials(
+        const aiScene* pScene,
+        const std::filesystem::path& searchPath,
+        const AssimpConversionOptions& options
+    );
+}
@@ -0,0 +1,923 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "CPUBVH.h"
+#include "Core/Error.h"
+#include "Utils/NumericRange.h"
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <execution>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Ranges with fewer triangles than this are built as independent subtrees, which are processed in parallel.
+        const uint32_t kMinParallelSubtreeTriangleCount = 4096;
+
+        // Ranges with at least this many triangles are binned in parallel, in chunks of this size.
+        const uint32_t kParallelBinningChunkSize = 65536;
+
+        // Nodes deeper than this are split at the object median rather than using the SAH, which bounds the tree height.
+        const uint32_t kMaxSAHDepth = 64;
+
+        // Size of the traversal stacks. This is larger than the maximum tree height of kMaxSAHDepth + 32.
+        const uint32_t kStackSize = 128;
+
+        struct BuildPrimitive
+        {
+            AABB bounds;
+            float3 centroid;
+        };
+
+        struct Bin
+        {
+            AABB bounds;
+            uint32_t count = 0;
+        };
+
+        struct TopLevelNode
+        {
+            AABB bounds;
+            uint32_t leftIndex = CPUBVH::kInvalidIndex;
+            uint32_t rightIndex = CPUBVH::kInvalidIndex;
+            uint32_t taskIndex = CPUBVH::kInvalidIndex;   ///< Index of the subtree task, or kInvalidIndex for internal nodes.
+        };
+
+        struct SubtreeTask
+        {
+            uint32_t begin;
+            uint32_t end;
+            uint32_t depth;
+            std::vector<CPUBVH::Node> nodes;
+            std::exception_ptr exception;
+
+            SubtreeTask(uint32_t _begin, uint32_t _end, uint32_t _depth) : begin(_begin), end(_end), depth(_depth) {}
+        };
+
+        CPUBVH::Node createNode(const AABB& bounds, uint32_t offset, uint32_t triangleCount)
+        {
+            return { bounds.minPoint, offset, bounds.maxPoint, triangleCount };
+        }
+
+        /** Binned SAH builder operating in place on a range of primitive indices.
+            Splitting a range only touches the primitive indices in that range, so disjoint ranges can be built concurrently.
+        */
+        class Builder
+        {
+        public:
+            Builder(const CPUBVH::Options& options, const std::vector<BuildPrimitive>& primitives, std::vector<uint32_t>& primIndices)
+                : mOptions(options)
+                , mPrimitives(primitives)
+                , mPrimIndices(primIndices)
+            {}
+
+            /** Split a range of primitives.
+                \param[in] begin First primitive of the range.
+                \param[in] end One past the last primitive of the range.
+                \param[in] depth Depth of the node in the tree.
+                \param[in] parallel Compute the bounds and bins in parallel.
+                \param[out] bounds Bounds of the range.
+                \return The position where the range was split, or 'begin' if a leaf node should be created.
+            */
+            uint32_t split(uint32_t begin, uint32_t end, uint32_t depth, bool parallel, AABB& bounds) const
+            {
+                FALCOR_ASSERT(begin < end);
+                const uint32_t count = end - begin;
+                const uint32_t binCount = mOptions.binCount;
+
+                // Compute the bounds and bin the primitives by centroid. Partial results are computed per chunk and reduced
+                // in order, so that the result does not depend on 'parallel'.
+                const uint32_t chunkCount = parallel ? (count + kParallelBinningChunkSize - 1) / kParallelBinningChunkSize : 1;
+                const uint32_t chunkSize = parallel ? kParallelBinningChunkSize : count;
+                std::vector<AABB> chunkBounds(chunkCount);
+                std::vector<AABB> chunkCentroidBounds(chunkCount);
+                auto computeBounds = [&](uint32_t chunkIndex)
+                {
+                    const uint32_t chunkEnd = std::min(end, begin + (chunkIndex + 1) * chunkSize);
+                    for (uint32_t i = begin + chunkIndex * chunkSize; i < chunkEnd; ++i)
+                    {
+                        const BuildPrimitive& primitive = mPrimitives[mPrimIndices[i]];
+                        chunkBounds[chunkIndex].include(primitive.bounds);
+                        chunkCentroidBounds[chunkIndex].include(primitive.centroid);
+                    }
+                };
+                NumericRange<uint32_t> chunkRange(0, chunkCount);
+                if (chunkCount > 1) std::for_each(std::execution::par, chunkRange.begin(), chunkRange.end(), computeBounds);
+                else computeBounds(0);
+
+                bounds = AABB();
+                AABB centroidBounds;
+                for (uint32_t i = 0; i < chunkCount; ++i)
+                {
+                    bounds.include(chunkBounds[i]);
+                    centroidBounds.include(chunkCentroidBounds[i]);
+                }
+
+                if (count == 1) return begin;
+
+                // If all centroids coincide, the primitives cannot be told apart by the heuristic.
+                const float3 centroidExtent = centroidBounds.extent();
+                if (centroidExtent.x <= 0.f && centroidExtent.y <= 0.f && centroidExtent.z <= 0.f)
+                {
+                    return count <= mOptions.maxTriangleCountPerLeaf ? begin : begin + count / 2;
+                }
+
+                const uint32_t largestAxis = centroidExtent.x >= centroidExtent.y ? (centroidExtent.x >= centroidExtent.z ? 0 : 2) : (centroidExtent.y >= centroidExtent.z ? 1 : 2);
+                if (depth >= kMaxSAHDepth) return splitMedian(begin, end, largestAxis);
+
+                const float3 scale = float3(float(binCount)) / max(centroidExtent, float3(std::numeric_limits<float>::min()));
+                auto getBinIndex = [&](const float3& centroid, uint32_t axis)
+                {
+                    const uint32_t binIndex = (uint32_t)((centroid[axis] - centroidBounds.minPoint[axis]) * scale[axis]);
+                    return std::min(binIndex, binCount - 1);
+                };
+
+                std::vector<std::vector<Bin>> chunkBins(chunkCount, std::vector<Bin>(3 * binCount));
+                auto binPrimitives = [&](uint32_t chunkIndex)
+                {
+                    auto& bins = chunkBins[chunkIndex];
+                    const uint32_t chunkEnd = std::min(end, begin + (chunkIndex + 1) * chunkSize);
+                    for (uint32_t i = begin + chunkIndex * chunkSize; i < chunkEnd; ++i)
+                    {
+                        const BuildPrimitive& primitive = mPrimitives[mPrimIndices[i]];
+                        for (uint32_t axis = 0; axis < 3; ++axis)
+                        {
+                            Bin& bin = bins[axis * binCount + getBinIndex(primitive.centroid, axis)];
+                            bin.bounds.include(primitive.bounds);
+                            bin.count++;
+                        }
+                    }
+                };
+                if (chunkCount > 1) std::for_each(std::execution::par, chunkRange.begin(), chunkRange.end(), binPrimitives);
+                else binPrimitives(0);
+
+                std::vector<Bin> bins = std::move(chunkBins[0]);
+                for (uint32_t chunkIndex = 1; chunkIndex < chunkCount; ++chunkIndex)
+                {
+                    for (uint32_t i = 0; i < bins.size(); ++i)
+                    {
+                        bins[i].bounds.include(chunkBins[chunkIndex][i].bounds);
+                        bins[i].count += chunkBins[chunkIndex][i].count;
+                    }
+                }
+
+                // Evaluate the SAH at each bin boundary by sweeping from both sides.
+                float bestCost = std::numeric_limits<float>::infinity();
+                uint32_t bestAxis = CPUBVH::kInvalidIndex;
+                uint32_t bestBin = 0;
+                std::vector<float> rightCosts(binCount);
+                for (uint32_t axis = 0; axis < 3; ++axis)
+                {
+                    if (centroidExtent[axis] <= 0.f) continue;
+                    const Bin* axisBins = &bins[axis * binCount];
+
+                    AABB rightBounds;
+                    uint32_t rightCount = 0;
+                    for (uint32_t i = binCount - 1; i > 0; --i)
+                    {
+                        rightBounds.include(axisBins[i].bounds);
+                        rightCount += axisBins[i].count;
+                        rightCosts[i] = rightCount > 0 ? rightBounds.area() * rightCount : 0.f;
+                    }
+
+                    AABB leftBounds;
+                    uint32_t leftCount = 0;
+                    for (uint32_t i = 1; i < binCount; ++i)
+                    {
+                        leftBounds.include(axisBins[i - 1].bounds);
+                        leftCount += axisBins[i - 1].count;
+                        if (leftCount == 0 || leftCount == count) continue;
+
+                        const float cost = leftBounds.area() * leftCount + rightCosts[i];
+                        if (cost < bestCost)
+                        {
+                            bestCost = cost;
+                            bestAxis = axis;
+                            bestBin = i;
+                        }
+                    }
+                }
+
+                if (bestAxis == CPUBVH::kInvalidIndex) return splitMedian(begin, end, largestAxis);
+
+                // Create a leaf if splitting is not expected to be cheaper. The costs are relative to intersecting one triangle.
+                const float area = bounds.area();
+                const float splitCost = area > 0.f ? mOptions.traversalCost + bestCost / area : std::numeric_limits<float>::infinity();
+                if (count <= mOptions.maxTriangleCountPerLeaf && splitCost >= float(count)) return begin;
+                if (!(area > 0.f)) return splitMedian(begin, end, largestAxis);
+
+                auto it = std::partition(mPrimIndices.begin() + begin, mPrimIndices.begin() + end, [&](uint32_t primIndex)
+                {
+                    return getBinIndex(mPrimitives[primIndex].centroid, bestAxis) < bestBin;
+                });
+                const uint32_t middle = (uint32_t)(it - mPrimIndices.begin());
+                FALCOR_ASSERT(middle > begin && middle < end);
+                return middle;
+            }
+
+            /** Build a subtree in depth-first order. The child indices are relative to the first node of the subtree.
+            */
+            void buildSubtree(uint32_t begin, uint32_t end, uint32_t depth, std::vector<CPUBVH::Node>& nodes) const
+            {
+                const uint32_t nodeIndex = (uint32_t)nodes.size();
+                nodes.push_back({});
+
+                AABB bounds;
+                const uint32_t middle = split(begin, end, depth, false, bounds);
+                if (middle == begin)
+                {
+                    nodes[nodeIndex] = createNode(bounds, begin, end - begin);
+                    return;
+                }
+
+                buildSubtree(begin, middle, depth + 1, nodes);
+                const uint32_t rightIndex = (uint32_t)nodes.size();
+                buildSubtree(middle, end, depth + 1, nodes);
+                nodes[nodeIndex] = createNode(bounds, rightIndex, 0);
+            }
+
+            /** Split the top of the tree serially into subtree tasks.
+            */
+            uint32_t buildTopLevel(uint32_t begin, uint32_t end, uint32_t depth, std::vector<TopLevelNode>& topLevelNodes, std::vector<SubtreeTask>& tasks) const
+            {
+                const uint32_t topLevelIndex = (uint32_t)topLevelNodes.size();
+                topLevelNodes.push_back({});
+
+                auto createTask = [&]()
+                {
+                    topLevelNodes[topLevelIndex].taskIndex = (uint32_t)tasks.size();
+                    tasks.emplace_back(begin, end, depth);
+                    return topLevelIndex;
+                };
+
+                if (end - begin < kMinParallelSubtreeTriangleCount) return createTask();
+
+                AABB bounds;
+                const uint32_t middle = split(begin, end, depth, true, bounds);
+                // Let the subtree task create the leaf node if the range is not split.
+                if (middle == begin) return createTask();
+
+                topLevelNodes[topLevelIndex].bounds = bounds;
+                const uint32_t leftIndex = buildTopLevel(begin, middle, depth + 1, topLevelNodes, tasks);
+                const uint32_t rightIndex = buildTopLevel(middle, end, depth + 1, topLevelNodes, tasks);
+                topLevelNodes[topLevelIndex].leftIndex = leftIndex;
+                topLevelNodes[topLevelIndex].rightIndex = rightIndex;
+                return topLevelIndex;
+            }
+
+        private:
+            uint32_t splitMedian(uint32_t begin, uint32_t end, uint32_t axis) const
+            {
+                const uint32_t middle = begin + (end - begin) / 2;
+                std::nth_element(mPrimIndices.begin() + begin, mPrimIndices.begin() + middle, mPrimIndices.begin() + end, [&](uint32_t a, uint32_t b)
+                {
+                    const float ca = mPrimitives[a].centroid[axis];
+                    const float cb = mPrimitives[b].centroid[axis];
+                    return ca < cb || (ca == cb && a < b);
+                });
+                return middle;
+            }
+
+            const CPUBVH::Options& mOptions;
+            const std::vector<BuildPrimitive>& mPrimitives;
+            std::vector<uint32_t>& mPrimIndices;
+        };
+
+        /** Append the top-level nodes and the subtrees in depth-first order.
+        */
+        uint32_t gatherNodes(const std::vector<TopLevelNode>& topLevelNodes, const std::vector<SubtreeTask>& tasks, uint32_t topLevelIndex, std::vector<CPUBVH::Node>& nodes)
+        {
+            const TopLevelNode& topLevelNode = topLevelNodes[topLevelIndex];
+            const uint32_t nodeIndex = (uint32_t)nodes.size();
+
+            if (topLevelNode.taskIndex != CPUBVH::kInvalidIndex)
+            {
+                // Append the subtree and relocate its child indices. The triangle offsets are already global.
+                const SubtreeTask& task = tasks[topLevelNode.taskIndex];
+                nodes.insert(nodes.end(), task.nodes.begin(), task.nodes.end());
+                for (size_t i = nodeIndex; i < nodes.size(); ++i)
+                {
+                    if (!nodes[i].isLeaf()) nodes[i].offset += nodeIndex;
+                }
+                return nodeIndex;
+            }
+
+            nodes.push_back({});
+            const uint32_t leftIndex = gatherNodes(topLevelNodes, tasks, topLevelNode.leftIndex, nodes);
+            FALCOR_ASSERT(leftIndex == nodeIndex + 1);
+            const uint32_t rightIndex = gatherNodes(topLevelNodes, tasks, topLevelNode.rightIndex, nodes);
+            nodes[nodeIndex] = createNode(topLevelNode.bounds, rightIndex, 0);
+            return nodeIndex;
+        }
+
+        float safeInverse(float d)
+        {
+            const float kMinAbs = 1e-30f;
+            return 1.f / (std::abs(d) >= kMinAbs ? d : std::copysign(kMinAbs, d));
+        }
+
+        bool intersectBox(const CPUBVH::Node& node, const float3& origin, const float3& invDir, float tMin, float tMax, float& tEntry)
+        {
+            const float3 t0 = (node.boundsMin - origin) * invDir;
+            const float3 t1 = (node.boundsMax - origin) * invDir;
+            const float3 tNear = min(t0, t1);
+            const float3 tFar = max(t0, t1);
+            tEntry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, tMin));
+            const float tExit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+            return tEntry <= tExit;
+        }
+
+        /** Moller-Trumbore ray/triangle intersection. Hits are reported in the open range (tMin, tMax).
+        */
+        bool intersectTriangle(const float3& p0, const float3& e1, const float3& e2, const float3& origin, const float3& dir, float tMin, float tMax, float& t, float& u, float& v)
+        {
+            const float3 p = cross(dir, e2);
+            const float det = dot(e1, p);
+            const float invDet = 1.f / det;
+            const float3 s = origin - p0;
+            u = dot(s, p) * invDet;
+            const float3 q = cross(s, e1);
+            v = dot(dir, q) * invDet;
+            t = dot(e2, q) * invDet;
+            return det != 0.f && u >= 0.f && v >= 0.f && u + v <= 1.f && t > tMin && t < tMax;
+        }
+
+        /** Packet rays with precomputed inverse directions and the current hit distances.
+        */
+        struct PacketState
+        {
+            float ox[CPUBVH::kPacketSize];
+            float oy[CPUBVH::kPacketSize];
+            float oz[CPUBVH::kPacketSize];
+            float dx[CPUBVH::kPacketSize];
+            float dy[CPUBVH::kPacketSize];
+            float dz[CPUBVH::kPacketSize];
+            float idx[CPUBVH::kPacketSize];
+            float idy[CPUBVH::kPacketSize];
+            float idz[CPUBVH::kPacketSize];
+            float tMin[CPUBVH::kPacketSize];
+            float tMax[CPUBVH::kPacketSize];
+
+            PacketState(const CPUBVH::RayPacket& rays)
+            {
+                for (uint32_t i = 0; i < CPUBVH::kPacketSize; ++i)
+                {
+                    ox[i] = rays.originX[i];
+                    oy[i] = rays.originY[i];
+                    oz[i] = rays.originZ[i];
+                    dx[i] = rays.dirX[i];
+                    dy[i] = rays.dirY[i];
+                    dz[i] = rays.dirZ[i];
+                    idx[i] = safeInverse(dx[i]);
+                    idy[i] = safeInverse(dy[i]);
+                    idz[i] = safeInverse(dz[i]);
+                    tMin[i] = rays.tMin[i];
+                    tMax[i] = rays.tMax[i];
+                }
+            }
+        };
+
+        /** Intersect a node with the active rays of a packet.
+            \return Bitmask of the lanes that hit the node.
+        */
+        uint32_t intersectBoxPacket(const CPUBVH::Node& node, const PacketState& s, uint32_t mask, float& minEntry)
+        {
+            uint32_t hitMask = 0;
+            float entry = std::numeric_limits<float>::infinity();
+            for (uint32_t i = 0; i < CPUBVH::kPacketSize; ++i)
+            {
+                const float tx0 = (node.boundsMin.x - s.ox[i]) * s.idx[i];
+                const float tx1 = (node.boundsMax.x - s.ox[i]) * s.idx[i];
+                const float ty0 = (node.boundsMin.y - s.oy[i]) * s.idy[i];
+                const float ty1 = (node.boundsMax.y - s.oy[i]) * s.idy[i];
+                const float tz0 = (node.boundsMin.z - s.oz[i]) * s.idz[i];
+                const float tz1 = (node.boundsMax.z - s.oz[i]) * s.idz[i];
+                const float tEntry = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::max(std::min(tz0, tz1), s.tMin[i]));
+                const float tExit = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::min(std::max(tz0, tz1), s.tMax[i]));
+                const bool hit = (tEntry <= tExit) & (((mask >> i) & 1) != 0);
+                hitMask |= uint32_t(hit) << i;
+                entry = hit ? std::min(entry, tEntry) : entry;
+            }
+            minEntry = entry;
+            return hitMask;
+        }
+
+        /** Intersect a triangle with the active rays of a packet.
+            \return Bitmask of the lanes that hit the triangle in (tMin, tMax).
+        */
+        uint32_t intersectTrianglePacket(const float3& p0, const float3& e1, const float3& e2, const PacketState& s, uint32_t mask, float t[], float u[], float v[])
+        {
+            uint32_t hitMask = 0;
+            for (uint32_t i = 0; i < CPUBVH::kPacketSize; ++i)
+            {
+                const float px = s.dy[i] * e2.z - s.dz[i] * e2.y;
+                const float py = s.dz[i] * e2.x - s.dx[i] * e2.z;
+                const float pz = s.dx[i] * e2.y - s.dy[i] * e2.x;
+                const float det = e1.x * px + e1.y * py + e1.z * pz;
+                const float invDet = 1.f / det;
+                const float sx = s.ox[i] - p0.x;
+                const float sy = s.oy[i] - p0.y;
+                const float sz = s.oz[i] - p0.z;
+                const float triU = (sx * px + sy * py + sz * pz) * invDet;
+                const float qx = sy * e1.z - sz * e1.y;
+                const float qy = sz * e1.x - sx * e1.z;
+                const float qz = sx * e1.y - sy * e1.x;
+                const float triV = (s.dx[i] * qx + s.dy[i] * qy + s.dz[i] * qz) * invDet;
+                const float triT = (e2.x * qx + e2.y * qy + e2.z * qz) * invDet;
+                const bool hit = (((mask >> i) & 1) != 0) & (det != 0.f) & (triU >= 0.f) & (triV >= 0.f) & (triU + triV <= 1.f) & (triT > s.tMin[i]) & (triT < t[i]);
+                t[i] = hit ? triT : t[i];
+                u[i] = hit ? triU : u[i];
+                v[i] = hit ? triV : v[i];
+                hitMask |= uint32_t(hit) << i;
+            }
+            return hitMask;
+        }
+    }
+
+    void CPUBVH::RayPacket::setRay(uint32_t lane, const Ray& ray)
+    {
+        FALCOR_ASSERT(lane < kPacketSize);
+        originX[lane] = ray.origin.x;
+        originY[lane] = ray.origin.y;
+        originZ[lane] = ray.origin.z;
+        dirX[lane] = ray.dir.x;
+        dirY[lane] = ray.dir.y;
+        dirZ[lane] = ray.dir.z;
+        tMin[lane] = ray.tMin;
+        tMax[lane] = ray.tMax;
+        activeMask |= 1u << lane;
+    }
+
+    Ray CPUBVH::RayPacket::getRay(uint32_t lane) const
+    {
+        FALCOR_ASSERT(lane < kPacketSize);
+        return Ray(float3(originX[lane], originY[lane], originZ[lane]), float3(dirX[lane], dirY[lane], dirZ[lane]), tMin[lane], tMax[lane]);
+    }
+
+    CPUBVH::Hit CPUBVH::HitPacket::getHit(uint32_t lane) const
+    {
+        FALCOR_ASSERT(lane < kPacketSize);
+        Hit hit;
+        if (instanceID[lane] == kInvalidIndex) return hit;
+        hit.t = t[lane];
+        hit.barycentrics = float2(u[lane], v[lane]);
+        hit.instanceID = instanceID[lane];
+        hit.primitiveIndex = primitiveIndex[lane];
+        return hit;
+    }
+
+    CPUBVH::CPUBVH(const Scene::SceneData& sceneData, const Options& options)
+        : mOptions(options)
+    {
+        FALCOR_CHECK(mOptions.binCount >= 2, "Bin count must be at least 2, got {}.", mOptions.binCount);
+        FALCOR_CHECK(mOptions.maxTriangleCountPerLeaf >= 1, "Max triangle count per leaf must be at least 1.");
+
+        const std::vector<float4x4> globalMatrices = Scene::computeGlobalMatrices(sceneData.sceneGraph);
+
+        // Count the triangles of each mesh instance and validate the mesh data.
+        const auto& instances = sceneData.meshInstanceData;
+        std::vector<uint64_t> triangleOffsets(instances.size() + 1, 0);
+        for (size_t instanceID = 0; instanceID < instances.size(); ++instanceID)
+        {
+            const GeometryInstanceData& instance = instances[instanceID];
+            const GeometryType type = instance.getType();
+            uint32_t triangleCount = 0;
+            if (type == GeometryType::TriangleMesh || type == GeometryType::DisplacedTriangleMesh)
+            {
+                FALCOR_CHECK(instance.geometryID < sceneData.meshDesc.size(), "Mesh instance {} references invalid mesh {}.", instanceID, instance.geometryID);
+                const MeshDesc& mesh = sceneData.meshDesc[instance.geometryID];
+                FALCOR_CHECK((uint64_t)instance.vbOffset + mesh.vertexCount <= sceneData.meshStaticData.size(), "Mesh instance {} references out of bounds vertex data.", instanceID);
+                if (mesh.useVertexIndices())
+                {
+                    const bool use16Bit = (instance.flags & (uint32_t)GeometryInstanceFlags::Use16BitIndices) != 0;
+                    const uint64_t indexDwordCount = use16Bit ? ((uint64_t)mesh.indexCount + 1) / 2 : mesh.indexCount;
+                    FALCOR_CHECK((uint64_t)instance.ibOffset + indexDwordCount <= sceneData.meshIndexData.size(), "Mesh instance {} references out of bounds index data.", instanceID);
+                }
+                triangleCount = mesh.getTriangleCount();
+            }
+            triangleOffsets[instanceID + 1] = triangleOffsets[instanceID] + triangleCount;
+        }
+        FALCOR_CHECK(triangleOffsets.back() < kInvalidIndex, "Scene has too many triangles ({}).", triangleOffsets.back());
+
+        // Transform the triangles to world space.
+        std::vector<Triangle> triangles(triangleOffsets.back());
+        std::vector<TriangleID> triangleIDs(triangleOffsets.back());
+        auto addInstance = [&](uint32_t instanceID)
+        {
+            const GeometryInstanceData& instance = instances[instanceID];
+            const uint32_t triangleCount = uint32_t(triangleOffsets[instanceID + 1] - triangleOffsets[instanceID]);
+            if (triangleCount == 0) return;
+
+            const MeshDesc& mesh = sceneData.meshDesc[instance.geometryID];
+            const float4x4 transform = instance.globalMatrixID < globalMatrices.size() ? globalMatrices[instance.globalMatrixID] : float4x4::identity();
+            const bool use16Bit = (instance.flags & (uint32_t)GeometryInstanceFlags::Use16BitIndices) != 0;
+            const uint32_t* pIndices32 = sceneData.meshIndexData.data() + instance.ibOffset;
+            const uint16_t* pIndices16 = reinterpret_cast<const uint16_t*>(pIndices32);
+
+            for (uint32_t primitiveIndex = 0; primitiveIndex < triangleCount; ++primitiveIndex)
+            {
+                float3 p[3];
+                for (uint32_t j = 0; j < 3; ++j)
+                {
+                    const uint32_t vertexIndex = primitiveIndex * 3 + j;
+                    const uint32_t localIndex = !mesh.useVertexIndices() ? vertexIndex : (use16Bit ? pIndices16[vertexIndex] : pIndices32[vertexIndex]);
+                    FALCOR_ASSERT(localIndex < mesh.vertexCount);
+                    p[j] = transformPoint(transform, sceneData.meshStaticData[instance.vbOffset + localIndex].position);
+                }
+
+                const size_t triangleIndex = triangleOffsets[instanceID] + primitiveIndex;
+                triangles[triangleIndex] = { p[0], p[1] - p[0], p[2] - p[0] };
+                triangleIDs[triangleIndex] = { instanceID, primitiveIndex };
+            }
+        };
+        NumericRange<uint32_t> instanceRange(0, (uint32_t)instances.size());
+        if (mOptions.useParallelBuild) std::for_each(std::execution::par, instanceRange.begin(), instanceRange.end(), addInstance);
+        else std::for_each(instanceRange.begin(), instanceRange.end(), addInstance);
+
+        build(std::move(triangles), std::move(triangleIDs));
+    }
+
+    void CPUBVH::build(std::vector<Triangle> triangles, std::vector<TriangleID> triangleIDs)
+    {
+        mNodes.clear();
+        mTriangles.clear();
+        mTriangleIDs.clear();
+        if (triangles.empty()) return;
+
+        const uint32_t triangleCount = (uint32_t)triangles.size();
+        std::vector<BuildPrimitive> primitives(triangleCount);
+        std::vector<uint32_t> primIndices(triangleCount);
+        NumericRange<uint32_t> triangleRange(0, triangleCount);
+        auto preparePrimitive = [&](uint32_t i)
+        {
+            const Triangle& triangle = triangles[i];
+            AABB bounds(triangle.p0);
+            bounds.include(triangle.p0 + triangle.e1);
+            bounds.include(triangle.p0 + triangle.e2);
+            primitives[i] = { bounds, bounds.center() };
+            primIndices[i] = i;
+        };
+        if (mOptions.useParallelBuild) std::for_each(std::execution::par, triangleRange.begin(), triangleRange.end(), preparePrimitive);
+        else std::for_each(triangleRange.begin(), triangleRange.end(), preparePrimitive);
+
+        // Split the top of the tree serially, then build the subtrees in parallel.
+        Builder builder(mOptions, primitives, primIndices);
+        std::vector<TopLevelNode> topLevelNodes;
+        std::vector<SubtreeTask> tasks;
+        if (mOptions.useParallelBuild)
+        {
+            builder.buildTopLevel(0, triangleCount, 0, topLevelNodes, tasks);
+        }
+        else
+        {
+            topLevelNodes.emplace_back().taskIndex = 0;
+            tasks.emplace_back(0, triangleCount, 0);
+        }
+
+        auto buildSubtree = [&](SubtreeTask& task)
+        {
+            try
+            {
+                builder.buildSubtree(task.begin, task.end, task.depth, task.nodes);
+            }
+            catch (...)
+            {
+                task.exception = std::current_exception();
+            }
+        };
+        if (mOptions.useParallelBuild) std::for_each(std::execution::par, tasks.begin(), tasks.end(), buildSubtree);
+        else std::for_each(tasks.begin(), tasks.end(), buildSubtree);
+
+        for (const SubtreeTask& task : tasks)
+        {
+            if (task.exception) std::rethrow_exception(task.exception);
+        }
+
+        mNodes.reserve(2 * triangleCount);
+        gatherNodes(topLevelNodes, tasks, 0, mNodes);
+        mNodes.shrink_to_fit();
+
+        // Store the triangles in leaf order.
+        mTriangles.resize(triangleCount);
+        mTriangleIDs.resize(triangleCount);
+        auto storeTriangle = [&](uint32_t i)
+        {
+            mTriangles[i] = triangles[primIndices[i]];
+            mTriangleIDs[i] = triangleIDs[primIndices[i]];
+        };
+        if (mOptions.useParallelBuild) std::for_each(std::execution::par, triangleRange.begin(), triangleRange.end(), storeTriangle);
+        else std::for_each(triangleRange.begin(), triangleRange.end(), storeTriangle);
+    }
+
+    AABB CPUBVH::getBounds() const
+    {
+        return mNodes.empty() ? AABB() : AABB(mNodes[0].boundsMin, mNodes[0].boundsMax);
+    }
+
+    CPUBVH::Hit CPUBVH::closestHit(const Ray& ray) const
+    {
+        Hit hit;
+        if (mNodes.empty()) return hit;
+
+        const float3 invDir = float3(safeInverse(ray.dir.x), safeInverse(ray.dir.y), safeInverse(ray.dir.z));
+        float tMax = ray.tMax;
+        uint32_t hitTriangle = kInvalidIndex;
+
+        float tEntry;
+        if (!intersectBox(mNodes[0], ray.origin, invDir, ray.tMin, tMax, tEntry)) return hit;
+
+        uint32_t stack[kStackSize];
+        float stackEntry[kStackSize];
+        uint32_t stackSize = 0;
+        uint32_t nodeIndex = 0;
+        while (true)
+        {
+            const Node& node = mNodes[nodeIndex];
+            if (node.isLeaf())
+            {
+                for (uint32_t i = node.offset; i < node.offset + node.triangleCount; ++i)
+                {
+                    const Triangle& triangle = mTriangles[i];
+                    float t, u, v;
+                    if (intersectTriangle(triangle.p0, triangle.e1, triangle.e2, ray.origin, ray.dir, ray.tMin, tMax, t, u, v))
+                    {
+                        tMax = t;
+                        hitTriangle = i;
+                        hit.barycentrics = float2(u, v);
+                    }
+                }
+            }
+            else
+            {
+                // Visit the nearest child first.
+                uint32_t nearIndex = nodeIndex + 1;
+                uint32_t farIndex = node.offset;
+                float nearEntry, farEntry;
+                const bool hitNear = intersectBox(mNodes[nearIndex], ray.origin, invDir, ray.tMin, tMax, nearEntry);
+                const bool hitFar = intersectBox(mNodes[farIndex], ray.origin, invDir, ray.tMin, tMax, farEntry);
+                if (hitNear && hitFar)
+                {
+                    if (farEntry < nearEntry)
+                    {
+                        std::swap(nearIndex, farIndex);
+                        std::swap(nearEntry, farEntry);
+                    }
+                    FALCOR_ASSERT(stackSize < kStackSize);
+                    stack[stackSize] = farIndex;
+                    stackEntry[stackSize++] = farEntry;
+                    nodeIndex = nearIndex;
+                    continue;
+                }
+                if (hitNear || hitFar)
+                {
+                    nodeIndex = hitNear ? nearIndex : farIndex;
+                    continue;
+                }
+            }
+
+            // Pop the next node, skipping nodes that are farther than the closest hit found so far.
+            while (stackSize > 0 && stackEntry[stackSize - 1] > tMax) stackSize--;
+            if (stackSize == 0) break;
+            nodeIndex = stack[--stackSize];
+        }
+
+        if (hitTriangle != kInvalidIndex)
+        {
+            hit.t = tMax;
+            hit.instanceID = mTriangleIDs[hitTriangle].instanceID;
+            hit.primitiveIndex = mTriangleIDs[hitTriangle].primitiveIndex;
+        }
+        return hit;
+    }
+
+    bool CPUBVH::anyHit(const Ray& ray) const
+    {
+        if (mNodes.empty()) return false;
+
+        const float3 invDir = float3(safeInverse(ray.dir.x), safeInverse(ray.dir.y), safeInverse(ray.dir.z));
+        float tEntry;
+        if (!intersectBox(mNodes[0], ray.origin, invDir, ray.tMin, ray.tMax, tEntry)) return false;
+
+        uint32_t stack[kStackSize];
+        uint32_t stackSize = 0;
+        uint32_t nodeIndex = 0;
+        while (true)
+        {
+            const Node& node = mNodes[nodeIndex];
+            if (node.isLeaf())
+            {
+                for (uint32_t i = node.offset; i < node.offset + node.triangleCount; ++i)
+                {
+                    const Triangle& triangle = mTriangles[i];
+                    float t, u, v;
+                    if (intersectTriangle(triangle.p0, triangle.e1, triangle.e2, ray.origin, ray.dir, ray.tMin, ray.tMax, t, u, v)) return true;
+                }
+            }
+            else
+            {
+                const uint32_t leftIndex = nodeIndex + 1;
+                const uint32_t rightIndex = node.offset;
+                const bool hitLeft = intersectBox(mNodes[leftIndex], ray.origin, invDir, ray.tMin, ray.tMax, tEntry);
+                const bool hitRight = intersectBox(mNodes[rightIndex], ray.origin, invDir, ray.tMin, ray.tMax, tEntry);
+                if (hitLeft && hitRight)
+                {
+                    FALCOR_ASSERT(stackSize < kStackSize);
+                    stack[stackSize++] = rightIndex;
+                }
+                if (hitLeft || hitRight)
+                {
+                    nodeIndex = hitLeft ? leftIndex : rightIndex;
+                    continue;
+                }
+            }
+
+            if (stackSize == 0) break;
+            nodeIndex = stack[--stackSize];
+        }
+        return false;
+    }
+
+    void CPUBVH::closestHit(const RayPacket& rays, HitPacket& hits) const
+    {
+        uint32_t hitTriangles[kPacketSize];
+        for (uint32_t i = 0; i < kPacketSize; ++i)
+        {
+            hits.t[i] = std::numeric_limits<float>::infinity();
+            hits.u[i] = 0.f;
+            hits.v[i] = 0.f;
+            hits.instanceID[i] = kInvalidIndex;
+            hits.primitiveIndex[i] = kInvalidIndex;
+            hitTriangles[i] = kInvalidIndex;
+        }
+        if (mNodes.empty() || rays.activeMask == 0) return;
+
+        // The current closest hit distance of each lane is stored in the state's tMax.
+        PacketState state(rays);
+        float entry;
+        uint32_t mask = intersectBoxPacket(mNodes[0], state, rays.activeMask, entry);
+        if (mask == 0) return;
+
+        struct StackEntry
+        {
+            uint32_t nodeIndex;
+            uint32_t mask;
+        };
+        StackEntry stack[kStackSize];
+        uint32_t stackSize = 0;
+        uint32_t nodeIndex = 0;
+        while (true)
+        {
+            const Node& node = mNodes[nodeIndex];
+            if (node.isLeaf())
+            {
+                for (uint32_t i = node.offset; i < node.offset + node.triangleCount; ++i)
+                {
+                    const Triangle& triangle = mTriangles[i];
+                    const uint32_t hitMask = intersectTrianglePacket(triangle.p0, triangle.e1, triangle.e2, state, mask, state.tMax, hits.u, hits.v);
+                    for (uint32_t lane = 0; lane < kPacketSize; ++lane)
+                    {
+                        hitTriangles[lane] = ((hitMask >> lane) & 1) ? i : hitTriangles[lane];
+                    }
+                }
+            }
+            else
+            {
+                // Visit the child with the nearest entry point over all lanes first.
+                uint32_t nearIndex = nodeIndex + 1;
+                uint32_t farIndex = node.offset;
+                float nearEntry, farEntry;
+                uint32_t nearMask = intersectBoxPacket(mNodes[nearIndex], state, mask, nearEntry);
+                uint32_t farMask = intersectBoxPacket(mNodes[farIndex], state, mask, farEntry);
+                if (nearMask != 0 && farMask != 0)
+                {
+                    if (farEntry < nearEntry)
+                    {
+                        std::swap(nearIndex, farIndex);
+                        std::swap(nearMask, farMask);
+                    }
+                    FALCOR_ASSERT(stackSize < kStackSize);
+                    stack[stackSize++] = { farIndex, farMask };
+                    nodeIndex = nearIndex;
+                    mask = nearMask;
+                    continue;
+                }
+                if (nearMask != 0 || farMask != 0)
+                {
+                    nodeIndex = nearMask != 0 ? nearIndex : farIndex;
+                    mask = nearMask != 0 ? nearMask : farMask;
+                    continue;
+                }
+            }
+
+            // Pop the next node, culling it against the closest hits found so far.
+            mask = 0;
+            while (stackSize > 0 && mask == 0)
+            {
+                const StackEntry& stackEntry = stack[--stackSize];
+                nodeIndex = stackEntry.nodeIndex;
+                mask = intersectBoxPacket(mNodes[nodeIndex], state, stackEntry.mask, entry);
+            }
+            if (mask == 0) break;
+        }
+
+        for (uint32_t lane = 0; lane < kPacketSize; ++lane)
+        {
+            if (hitTriangles[lane] == kInvalidIndex) continue;
+            hits.t[lane] = state.tMax[lane];
+            hits.instanceID[lane] = mTriangleIDs[hitTriangles[lane]].instanceID;
+            hits.primitiveIndex[lane] = mTriangleIDs[hitTriangles[lane]].primitiveIndex;
+        }
+    }
+
+    uint32_t CPUBVH::anyHit(const RayPacket& rays) const
+    {
+        if (mNodes.empty() || rays.activeMask == 0) return 0;
+
+        PacketState state(rays);
+        float entry;
+        uint32_t mask = intersectBoxPacket(mNodes[0], state, rays.activeMask, entry);
+        if (mask == 0) return 0;
+
+        struct StackEntry
+        {
+            uint32_t nodeIndex;
+            uint32_t mask;
+        };
+        StackEntry stack[kStackSize];
+        uint32_t stackSize = 0;
+        uint32_t nodeIndex = 0;
+        uint32_t occludedMask = 0;
+        float t[kPacketSize], u[kPacketSize], v[kPacketSize];
+        while (true)
+        {
+            const Node& node = mNodes[nodeIndex];
+            if (node.isLeaf())
+            {
+                for (uint32_t i = node.offset; i < node.offset + node.triangleCount && mask != 0; ++i)
+                {
+                    const Triangle& triangle = mTriangles[i];
+                    std::copy(std::begin(state.tMax), std::end(state.tMax), t);
+                    const uint32_t hitMask = intersectTrianglePacket(triangle.p0, triangle.e1, triangle.e2, state, mask, t, u, v);
+                    occludedMask |= hitMask;
+                    mask &= ~hitMask;
+                }
+                if ((rays.activeMask & ~occludedMask) == 0) break;
+            }
+            else
+            {
+                const uint32_t leftIndex = nodeIndex + 1;
+                const uint32_t rightIndex = node.offset;
+                const uint32_t leftMask = intersectBoxPacket(mNodes[leftIndex], state, mask, entry);
+                const uint32_t rightMask = intersectBoxPacket(mNodes[rightIndex], state, mask, entry);
+                if (leftMask != 0 && rightMask != 0)
+                {
+                    FALCOR_ASSERT(stackSize < kStackSize);
+                    stack[stackSize++] = { rightIndex, rightMask };
+                }
+                if (leftMask != 0 || rightMask != 0)
+                {
+                    nodeIndex = leftMask != 0 ? leftIndex : rightIndex;
+                    mask = leftMask != 0 ? leftMask : rightMask;
+                    continue;
+                }
+            }
+
+            // Pop the next node that still has rays which are not occluded.
+            mask = 0;
+            while (stackSize > 0 && mask == 0)
+            {
+                const StackEntry& stackEntry = stack[--stackSize];
+                nodeIndex = stackEntry.nodeIndex;
+                mask = stackEntry.mask & ~occludedMask;
+            }
+            if (mask == 0) break;
+        }
+        return occludedMask;
+    }
+}
@@ -0,0 +1,203 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Scene.h"
+#include "Core/Macros.h"
+#include "Utils/Math/AABB.h"
+#include "Utils/Math/Ray.h"
+#include "Utils/Math/Vector.h"
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace Falcor
+{
+    /** Bounding volume hierarchy over the triangle meshes of a scene, for ray tracing on the CPU.
+
+        This is a binary BVH over the world-space triangles of all mesh instances, built using
+        the binned surface area heuristic (SAH). It allows running ray-based algorithms on machines
+        without a GPU, for example for precomputations and tests.
+
+        Rays can be traced one at a time, or in packets of kPacketSize rays that share the traversal.
+        The packet ray/box and ray/triangle tests are written as branch-free loops over the lanes
+        of structure-of-arrays data, so that they can be vectorized by the compiler.
+
+        The BVH is built from the mesh data in Scene::SceneData as prepared by SceneBuilder.
+        Dynamic meshes are included in their bind pose and displaced meshes without displacement.
+        Curves, SDF grids and custom primitives are ignored.
+    */
+    class FALCOR_API CPUBVH
+    {
+    public:
+        static constexpr uint32_t kPacketSize = 8;
+        static constexpr uint32_t kInvalidIndex = std::numeric_limits<uint32_t>::max();
+
+        struct Options
+        {
+            uint32_t binCount = 16;                 ///< Number of bins per axis used for evaluating the SAH.
+            uint32_t maxTriangleCountPerLeaf = 4;   ///< Maximum number of triangles per leaf node.
+            float traversalCost = 1.f;              ///< Cost of traversing a node, relative to the cost of intersecting a triangle.
+            bool useParallelBuild = true;           ///< Build independent subtrees and bin large triangle ranges in parallel. The resulting BVH is identical to the one built serially.
+
+            // Note: Empty constructor needed for clang due to the use of the nested struct constructor in the parent constructor.
+            Options() {}
+
+            template<typename Archive>
+            void serialize(Archive& ar)
+            {
+                ar("binCount", binCount);
+                ar("maxTriangleCountPerLeaf", maxTriangleCountPerLeaf);
+                ar("traversalCost", traversalCost);
+                ar("useParallelBuild", useParallelBuild);
+            }
+        };
+
+        /** BVH node packed into 32B.
+            Internal nodes store the index of their right child, the left child is stored immediately after the node.
+            Leaf nodes store a range of triangles.
+        */
+        struct Node
+        {
+            float3 boundsMin;
+            uint32_t offset;            ///< Index of the right child for internal nodes, index of the first triangle for leaf nodes.
+            float3 boundsMax;
+            uint32_t triangleCount;     ///< Number of triangles in leaf nodes, zero for internal nodes.
+
+            bool isLeaf() const { return triangleCount > 0; }
+        };
+        static_assert(sizeof(Node) == 32);
+
+        /** Result of a closest hit query.
+        */
+        struct Hit
+        {
+            float t = std::numeric_limits<float>::infinity(); ///< Hit distance along the ray.
+            float2 barycentrics = float2(0.f);               ///< Barycentric weights of the triangle's second and third vertices at the hit point.
+            uint32_t instanceID = kInvalidIndex;              ///< Index of the hit mesh instance in SceneData::meshInstanceData.
+            uint32_t primitiveIndex = kInvalidIndex;          ///< Index of the hit triangle in its mesh.
+
+            bool isValid() const { return instanceID != kInvalidIndex; }
+        };
+
+        /** Packet of rays stored as a structure of arrays.
+            Only the lanes set in activeMask are traced.
+        */
+        struct alignas(32) RayPacket
+        {
+            float originX[kPacketSize];
+            float originY[kPacketSize];
+            float originZ[kPacketSize];
+            float dirX[kPacketSize];
+            float dirY[kPacketSize];
+            float dirZ[kPacketSize];
+            float tMin[kPacketSize];
+            float tMax[kPacketSize];
+            uint32_t activeMask = 0;
+
+            /** Set a ray and mark its lane active.
+            */
+            void setRay(uint32_t lane, const Ray& ray);
+
+            Ray getRay(uint32_t lane) const;
+        };
+
+        /** Results of a closest hit query for a packet of rays.
+            Lanes that did not hit anything, or were inactive, have an instance ID of kInvalidIndex.
+        */
+        struct alignas(32) HitPacket
+        {
+            float t[kPacketSize];
+            float u[kPacketSize];
+            float v[kPacketSize];
+            uint32_t instanceID[kPacketSize];
+            uint32_t primitiveIndex[kPacketSize];
+
+            Hit getHit(uint32_t lane) const;
+        };
+
+        /** Build the BVH.
+            \param[in] sceneData Scene data holding the meshes and their instances.
+            \param[in] options Build options.
+        */
+        CPUBVH(const Scene::SceneData& sceneData, const Options& options = Options());
+
+        /** Find the closest hit along a ray.
+            \param[in] ray Ray. Hits are only reported in the range (tMin, tMax).
+            \return The closest hit. The hit is invalid if the ray did not hit anything.
+        */
+        Hit closestHit(const Ray& ray) const;
+
+        /** Check if a ray hits anything.
+            \param[in] ray Ray. Hits are only reported in the range (tMin, tMax).
+            \return True if the ray hits any triangle.
+        */
+        bool anyHit(const Ray& ray) const;
+
+        /** Find the closest hits along a packet of rays.
+            \param[in] rays Ray packet.
+            \param[out] hits Closest hit for each lane.
+        */
+        void closestHit(const RayPacket& rays, HitPacket& hits) const;
+
+        /** Check if the rays of a packet hit anything.
+            \param[in] rays Ray packet.
+            \return Bitmask of the active lanes whose ray hits any triangle.
+        */
+        uint32_t anyHit(const RayPacket& rays) const;
+
+        uint32_t getTriangleCount() const { return (uint32_t)mTriangles.size(); }
+        const std::vector<Node>& getNodes() const { return mNodes; }
+
+        /** Returns the world-space bounds of all triangles. The bounds are invalid if the BVH is empty.
+        */
+        AABB getBounds() const;
+
+    private:
+        /** Triangle stored as a vertex and two edges for Moller-Trumbore intersection.
+        */
+        struct Triangle
+        {
+            float3 p0;
+            float3 e1;
+            float3 e2;
+        };
+
+        struct TriangleID
+        {
+            uint32_t instanceID;
+            uint32_t primitiveIndex;
+        };
+
+        void build(std::vector<Triangle> triangles, std::vector<TriangleID> triangleIDs);
+
+        Options mOptions;
+        std::vector<Node> mNodes;               ///< BVH nodes stored in depth-first order, with the root node at index 0.
+        std::vector<Triangle> mTriangles;       ///< Triangles sorted by leaf node.
+        std::vector<TriangleID> mTriangleIDs;   ///< Instance ID and primitive index of each triangle in mTriangles.
+    };
+}
@@ -0,0 +1,318 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "CacheKeyService.h"
+#include "SceneCacheFile.h"
+#include "Core/Error.h"
+#include "Core/Platform/MemoryMappedFile.h"
+#include "Core/Platform/OS.h"
+#include "Utils/Logger.h"
+
+#include <BS_thread_pool.hpp>
+
+#include <algorithm>
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Default memo file (in the application data directory).
+        */
+        const std::string kDefaultMemoFile = "NVIDIA/Falcor/FileDigests.bin";
+
+        /** Memo file format version. This needs to be incremented every time the layout of the memo or the hash changes.
+        */
+        const uint32_t kMemoVersion = 1;
+
+        /** Version hashed into the keys returned by computeKey().
+        */
+        const uint32_t kKeyVersion = 1;
+
+        const std::string kMemoEntriesSection = "Entries";
+        const std::string kMemoPathsSection = "Paths";
+
+        struct MemoRecord
+        {
+            uint64_t size;
+            int64_t modifiedTime;
+            FastHash128::MD digest;
+            uint64_t pathOffset;
+            uint64_t pathLength;
+        };
+        static_assert(sizeof(MemoRecord) == 48);
+
+        struct FileStatus
+        {
+            uint64_t size = 0;
+            std::filesystem::file_time_type modifiedTime;
+
+            bool operator==(const FileStatus& other) const { return size == other.size && modifiedTime == other.modifiedTime; }
+            bool operator!=(const FileStatus& other) const { return !(*this == other); }
+        };
+
+        FileStatus getFileStatus(const std::filesystem::path& path)
+        {
+            std::error_code ec;
+            FileStatus status;
+            status.size = std::filesystem::file_size(path, ec);
+            if (!ec) status.modifiedTime = std::filesystem::last_write_time(path, ec);
+            if (ec) FALCOR_THROW("Failed to query file '{}': {}", path, ec.message());
+            return status;
+        }
+
+        FastHash128::MD hashFileContents(const std::filesystem::path& path, uint64_t size)
+        {
+            if (size == 0) return FastHash128::compute(nullptr, 0);
+
+            MemoryMappedFile file;
+            if (!file.open(path, MemoryMappedFile::kWholeFile, MemoryMappedFile::AccessHint::SequentialScan))
+            {
+                FALCOR_THROW("Failed to open file '{}'.", path);
+            }
+            return FastHash128::compute(file.getData(), file.getSize());
+        }
+    }
+
+    CacheKeyService::CacheKeyService(const Options& options)
+        : mOptions(options)
+    {
+        if (!mOptions.memoPath.empty()) loadMemo();
+    }
+
+    CacheKeyService::~CacheKeyService()
+    {
+        try
+        {
+            saveMemo();
+        }
+        catch (const std::exception& e)
+        {
+            logWarning("Failed to save the file digest memo: {}", e.what());
+        }
+    }
+
+    std::filesystem::path CacheKeyService::getDefaultMemoPath()
+    {
+        return getAppDataDirectory() / kDefaultMemoFile;
+    }
+
+    CacheKeyService::Digest CacheKeyService::hashFile(const std::filesystem::path& path)
+    {
+        const auto absPath = std::filesystem::absolute(path).lexically_normal();
+        const auto pathStr = absPath.string();
+        const auto status = getFileStatus(absPath);
+        const int64_t modifiedTime = status.modifiedTime.time_since_epoch().count();
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto it = mMemo.find(pathStr);
+            if (it != mMemo.end() && it->second.size == status.size && it->second.modifiedTime == modifiedTime)
+            {
+                mMemoHitCount++;
+                return it->second.digest;
+            }
+        }
+
+        Digest digest = hashFileContents(absPath, status.size);
+        mHashedFileCount++;
+        mHashedBytes += status.size;
+
+        // Only memoize the digest if the file did not change while it was hashed and is not racily modified,
+        // i.e. a modification right after it was hashed would not change the timestamp.
+        const auto now = std::filesystem::file_time_type::clock::now();
+        if (getFileStatus(absPath) == status && now - status.modifiedTime >= std::chrono::seconds(kRacyIntervalSeconds))
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mMemo[pathStr] = MemoEntry{status.size, modifiedTime, digest};
+            mMemoDirty = true;
+        }
+
+        return digest;
+    }
+
+    std::vector<CacheKeyService::Digest> CacheKeyService::hashFiles(const std::vector<std::filesystem::path>& paths)
+    {
+        std::vector<Digest> digests(paths.size());
+        if (paths.size() <= 1 || mOptions.threadCount == 1)
+        {
+            for (size_t i = 0; i < paths.size(); ++i) digests[i] = hashFile(paths[i]);
+            return digests;
+        }
+
+        BS::thread_pool* pThreadPool = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (!mpThreadPool) mpThreadPool = std::make_unique<BS::thread_pool>(mOptions.threadCount);
+            pThreadPool = mpThreadPool.get();
+        }
+
+        // File sizes vary a lot, so each worker fetches the next file from a shared counter instead of
+        // processing a fixed range. A worker stops at the first error, which is rethrown below.
+        std::atomic<size_t> nextIndex{0};
+        const size_t workerCount = std::min<size_t>(paths.size(), pThreadPool->get_thread_count());
+        std::vector<std::future<void>> futures;
+        futures.reserve(workerCount);
+        for (size_t i = 0; i < workerCount; ++i)
+        {
+            futures.push_back(pThreadPool->submit([&]()
+            {
+                for (size_t index = nextIndex++; index < paths.size(); index = nextIndex++)
+                {
+                    digests[index] = hashFile(paths[index]);
+                }
+            }));
+        }
+
+        // Wait for all workers before rethrowing, as they reference local state.
+        for (auto& future : futures) future.wait();
+        for (auto& future : futures) future.get();
+
+        return digests;
+    }
+
+    CacheKeyService::Digest CacheKeyService::computeKey(const std::vector<std::filesystem::path>& paths, const void* pData, size_t size)
+    {
+        auto digests = hashFiles(paths);
+
+        FastHash128 hash;
+        hash.update(kKeyVersion);
+        hash.update((uint64_t)paths.size());
+        for (size_t i = 0; i < paths.size(); ++i)
+        {
+            auto pathStr = paths[i].string();
+            hash.update((uint64_t)pathStr.size());
+            hash.update(pathStr);
+            hash.update(digests[i].data(), digests[i].size());
+        }
+        hash.update((uint64_t)size);
+        hash.update(pData, size);
+        return hash.finalize();
+    }
+
+    void CacheKeyService::saveMemo()
+    {
+        if (mOptions.memoPath.empty()) return;
+
+        std::vector<MemoRecord> records;
+        std::vector<char> paths;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (!mMemoDirty) return;
+
+            records.reserve(mMemo.size());
+            for (const auto& [path, entry] : mMemo)
+            {
+                records.push_back(MemoRecord{entry.size, entry.modifiedTime, entry.digest, paths.size(), path.size()});
+                paths.insert(paths.end(), path.begin(), path.end());
+            }
+            mMemoDirty = false;
+        }
+
+        // Write to a temporary file and rename it, so that concurrent instances never read a partial memo.
+        const auto& memoPath = mOptions.memoPath;
+        auto tempPath = memoPath;
+        tempPath += fmt::format(".{:x}.tmp", std::random_device()());
+        try
+        {
+            if (memoPath.has_parent_path()) std::filesystem::create_directories(memoPath.parent_path());
+
+            SceneCacheFile::Writer::Options writerOptions;
+            writerOptions.threadCount = 1;
+            SceneCacheFile::Writer writer(tempPath, kMemoVersion, writerOptions);
+            writer.addSection(kMemoEntriesSection, records);
+            writer.addSection(kMemoPathsSection, paths);
+            writer.finalize();
+            std::filesystem::rename(tempPath, memoPath);
+        }
+        catch (const std::exception&)
+        {
+            std::error_code ec;
+            std::filesystem::remove(tempPath, ec);
+            std::lock_guard<std::mutex> lock(mMutex);
+            mMemoDirty = true;
+            throw;
+        }
+    }
+
+    void CacheKeyService::clearMemo()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mMemoDirty = mMemoDirty || !mMemo.empty();
+        mMemo.clear();
+    }
+
+    size_t CacheKeyService::getMemoSize() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mMemo.size();
+    }
+
+    CacheKeyService::Stats CacheKeyService::getStats() const
+    {
+        Stats stats;
+        stats.hashedFileCount = mHashedFileCount;
+        stats.hashedBytes = mHashedBytes;
+        stats.memoHitCount = mMemoHitCount;
+        return stats;
+    }
+
+    void CacheKeyService::loadMemo()
+    {
+        if (!std::filesystem::exists(mOptions.memoPath)) return;
+
+        try
+        {
+            SceneCacheFile::Reader reader(mOptions.memoPath, 1);
+            if (reader.getVersion() != kMemoVersion) return;
+
+            std::vector<MemoRecord> records;
+            std::vector<char> paths;
+            reader.readSection(kMemoEntriesSection, records);
+            reader.readSection(kMemoPathsSection, paths);
+
+            std::unordered_map<std::string, MemoEntry> memo;
+            memo.reserve(records.size());
+            for (const auto& record : records)
+            {
+                if (record.pathOffset > paths.size() || record.pathLength > paths.size() - record.pathOffset)
+                {
+                    FALCOR_THROW("Path of memo record is out of bounds.");
+                }
+                std::string path(paths.data() + record.pathOffset, record.pathLength);
+                memo[std::move(path)] = MemoEntry{record.size, record.modifiedTime, record.digest};
+            }
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            mMemo = std::move(memo);
+        }
+        catch (const std::exception& e)
+        {
+            logWarning("Ignoring invalid file digest memo '{}': {}", mOptions.memoPath, e.what());
+        }
+    }
+}
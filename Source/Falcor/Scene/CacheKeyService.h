@@ -0,0 +1,152 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/Macros.h"
+#include "Utils/FastHash.h"
+
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace BS
+{
+    class thread_pool;
+}
+
+namespace Falcor
+{
+    /** Computes cache keys from the contents of source files.
+
+        Files are hashed with FastHash128 from memory-mapped reads, and several files are hashed in parallel.
+        The digests are memoized by (path, size, modification time), so unchanged files are not read again.
+        The memo can be persisted to a sidecar file, which makes validating a warm cache independent of the
+        size of the source files.
+
+        Files modified less than kRacyIntervalSeconds before they were hashed are not memoized, as a later modification
+        within the resolution of the file system timestamps would otherwise go unnoticed.
+
+        All functions can be called concurrently from multiple threads.
+    */
+    class FALCOR_API CacheKeyService
+    {
+    public:
+        using Digest = FastHash128::MD;
+
+        static constexpr int64_t kRacyIntervalSeconds = 2;
+
+        struct Options
+        {
+            std::filesystem::path memoPath;     ///< Sidecar file the memo is loaded from and saved to. Empty to keep the memo in memory only.
+            uint32_t threadCount = 0;           ///< Number of threads used by hashFiles(), or 0 to use the hardware concurrency.
+
+            // Note: Empty constructor needed for clang due to the use of the nested struct constructor in the parent constructor.
+            Options() {}
+        };
+
+        struct Stats
+        {
+            uint64_t hashedFileCount = 0;   ///< Number of files read and hashed.
+            uint64_t hashedBytes = 0;       ///< Number of bytes read and hashed.
+            uint64_t memoHitCount = 0;      ///< Number of files whose digest was taken from the memo.
+        };
+
+        /** Create the service and load the memo from Options::memoPath if it exists.
+            An invalid memo file is ignored.
+            \param[in] options Options.
+        */
+        CacheKeyService(const Options& options = Options());
+
+        /** Destructor. Saves the memo if it has been modified.
+        */
+        ~CacheKeyService();
+
+        /** Get the default memo path (file in the application data directory).
+        */
+        static std::filesystem::path getDefaultMemoPath();
+
+        /** Get the digest of a file's contents.
+            Throws an exception if the file cannot be read.
+            \param[in] path File path.
+            \return The digest.
+        */
+        Digest hashFile(const std::filesystem::path& path);
+
+        /** Get the digests of several files' contents, hashing them in parallel.
+            Throws an exception if any of the files cannot be read.
+            \param[in] paths File paths.
+            \return The digests, in the order of the paths.
+        */
+        std::vector<Digest> hashFiles(const std::vector<std::filesystem::path>& paths);
+
+        /** Compute a key from the paths and contents of several files and additional data.
+            \param[in] paths File paths. The order is significant.
+            \param[in] pData Additional data such as build flags, or nullptr.
+            \param[in] size Size of the additional data in bytes.
+            \return The key.
+        */
+        Digest computeKey(const std::vector<std::filesystem::path>& paths, const void* pData = nullptr, size_t size = 0);
+
+        /** Save the memo to Options::memoPath, if it has been modified since it was loaded or saved.
+            Does nothing if no memo path is set.
+        */
+        void saveMemo();
+
+        /** Remove all memoized digests.
+        */
+        void clearMemo();
+
+        size_t getMemoSize() const;
+        const Options& getOptions() const { return mOptions; }
+        Stats getStats() const;
+
+    private:
+        struct MemoEntry
+        {
+            uint64_t size;
+            int64_t modifiedTime;
+            Digest digest;
+        };
+
+        void loadMemo();
+
+        Options mOptions;
+        std::unique_ptr<BS::thread_pool> mpThreadPool;  ///< Hashing threads, created on first use.
+
+        mutable std::mutex mMutex;
+        std::unordered_map<std::string, MemoEntry> mMemo;   ///< Memoized digests by absolute path.
+        bool mMemoDirty = false;
+
+        std::atomic<uint64_t> mHashedFileCount{0};
+        std::atomic<uint64_t> mHashedBytes{0};
+        std::atomic<uint64_t> mMemoHitCount{0};
+    };
+}
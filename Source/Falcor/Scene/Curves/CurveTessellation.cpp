@@ -27,12 +27,15 @@
  **************************************************************************/
 #include "CurveTessellation.h"
 #include "Core/Error.h"
+#include "Utils/NumericRange.h"
 #include "Utils/Math/Common.h"
 #include "Utils/Math/MathHelpers.h"
 #include "Utils/Math/CubicSpline.h"
 #include "Utils/Math/Matrix.h"
 #include "Utils/Math/Quaternion.h"
+#include <algorithm>
 #include <cmath>
+#include <execution>
 
 namespace Falcor
 {
@@ -74,6 +77,85 @@ namespace Falcor
         // To achieve curveWidth on average, however, we need to scale the initial curveWidth by 1.11 (the number was deducted numerically).
         const float kMeshCompensationScale = 1.11f;
 
+        /// Number of strands tessellated by a single task.
+        const uint32_t kStrandsPerTask = 64;
+
+        /** Layout of the kept strands in the input and output arrays.
+            The output offsets are an exclusive prefix sum over the number of points each strand is tessellated into,
+            so that all strands can be tessellated in parallel, directly into the preallocated output arrays.
+        */
+        struct StrandLayout
+        {
+            std::vector<uint32_t> strandIndices;    ///< Index of each kept strand.
+            std::vector<uint32_t> inputOffsets;     ///< Offset of the first control point of each kept strand.
+            std::vector<uint32_t> outputOffsets;    ///< Offset of the first output point of each kept strand, followed by the total point count.
+
+            uint32_t getStrandCount() const { return (uint32_t)strandIndices.size(); }
+            uint32_t getPointCount() const { return outputOffsets.back(); }
+        };
+
+        /** Run func(begin, end) over ranges of [0, strandCount), in parallel if there is more than one range.
+        */
+        template<typename Func>
+        void forEachStrandRange(uint32_t strandCount, const Func& func)
+        {
+            const uint32_t taskCount = div_round_up(strandCount, kStrandsPerTask);
+            auto task = [&](uint32_t i) { func(i * kStrandsPerTask, std::min((i + 1) * kStrandsPerTask, strandCount)); };
+            auto range = NumericRange<uint32_t>(0, taskCount);
+            if (taskCount > 1) std::for_each(std::execution::par, range.begin(), range.end(), task);
+            else if (taskCount == 1) task(0);
+        }
+
+        /// Number of control points of a strand left after removing consecutive duplicates.
+        uint32_t countUniquePoints(const float3* controlPoints, uint32_t vertexCount)
+        {
+            uint32_t uniqueCount = 1;
+            for (uint32_t j = 0; j + 1 < vertexCount; j++)
+            {
+                if (any(controlPoints[j] != controlPoints[j + 1])) uniqueCount++;
+            }
+            return uniqueCount;
+        }
+
+        StrandLayout computeStrandLayout(uint32_t strandCount, const uint32_t* vertexCountsPerStrand, const float3* controlPoints, uint32_t subdivPerSegment, uint32_t keepOneEveryXStrands, uint32_t keepOneEveryXVerticesPerStrand)
+        {
+            StrandLayout layout;
+            uint32_t inputOffset = 0;
+            for (uint32_t i = 0; i < strandCount; i++)
+            {
+                if (i % keepOneEveryXStrands == 0)
+                {
+                    layout.strandIndices.push_back(i);
+                    layout.inputOffsets.push_back(inputOffset);
+                }
+                inputOffset += vertexCountsPerStrand[i];
+            }
+
+            // Count the output points of each strand.
+            const uint32_t keptCount = layout.getStrandCount();
+            layout.outputOffsets.resize(keptCount + 1);
+            forEachStrandRange(keptCount, [&](uint32_t begin, uint32_t end)
+            {
+                for (uint32_t s = begin; s < end; s++)
+                {
+                    uint32_t uniqueCount = countUniquePoints(controlPoints + layout.inputOffsets[s], vertexCountsPerStrand[layout.strandIndices[s]]);
+                    layout.outputOffsets[s] = div_round_up(subdivPerSegment * (uniqueCount - 1), keepOneEveryXVerticesPerStrand) + 1;
+                }
+            });
+
+            // Exclusive prefix sum.
+            uint32_t offset = 0;
+            for (uint32_t s = 0; s < keptCount; s++)
+            {
+                uint32_t count = layout.outputOffsets[s];
+                layout.outputOffsets[s] = offset;
+                offset += count;
+            }
+            layout.outputOffsets[keptCount] = offset;
+
+            return layout;
+        }
+
         float4 transformSphere(const float4x4& xform, const float4& sphere)
         {
             // Spheres are represented as (center.x, center.y, center.z, radius).
@@ -95,10 +177,14 @@ namespace Falcor
         /// between mesh-from-curves and native mesh, which is used intersection and epsilon calculations.
         inline float sanitizeWidth(float w)
         {
-            return std::max(w, (float)std::numeric_limits<float16_t>::min());
+            static const float kMinWidth = (float)std::numeric_limits<float16_t>::min();
+            return std::max(w, kMinWidth);
         }
 
-        void optimizeStrandGeometry(CubicSplineCache& splineCache, const CurveArrays& curveArrays, StrandArrays& strandArrays, StrandArrays& optimizedStrandArrays, uint32_t pointOffset, uint32_t subdivPerSegment, uint32_t keepOneEveryXVerticesPerStrand, float widthScale)
+        /** Copy the control points of a strand, removing consecutive duplicates.
+            \return Number of remaining control points.
+        */
+        uint32_t removeDuplicatePoints(const CurveArrays& curveArrays, StrandArrays& strandArrays, uint32_t pointOffset)
         {
             strandArrays.controlPoints.clear();
             strandArrays.UVs.clear();
@@ -120,7 +206,15 @@ namespace Falcor
             strandArrays.widths.push_back(curveArrays.widths[pointOffset + strandArrays.vertexCount - 1]);
             if (curveArrays.UVs) strandArrays.UVs.push_back(curveArrays.UVs[pointOffset + strandArrays.vertexCount - 1]);
 
-            optimizedStrandArrays.vertexCount = static_cast<uint32_t>(strandArrays.controlPoints.size());
+            return static_cast<uint32_t>(strandArrays.controlPoints.size());
+        }
+
+        void optimizeStrandGeometry(CubicSplineCache& splineCache, const CurveArrays& curveArrays, StrandArrays& strandArrays, StrandArrays& optimizedStrandArrays, uint32_t pointOffset, uint32_t subdivPerSegment, uint32_t keepOneEveryXVerticesPerStrand, float widthScale)
+        {
+            optimizedStrandArrays.controlPoints.clear();
+            optimizedStrandArrays.UVs.clear();
+            optimizedStrandArrays.widths.clear();
+            optimizedStrandArrays.vertexCount = removeDuplicatePoints(curveArrays, strandArrays, pointOffset);
 
             const CubicSpline<float3>& splinePoints = splineCache.optSplinePoints.setup(strandArrays.controlPoints.data(), optimizedStrandArrays.vertexCount);
             const CubicSpline<float>& splineWidths = splineCache.optSplineWidths.setup(strandArrays.widths.data(), optimizedStrandArrays.vertexCount);
@@ -181,7 +275,7 @@ namespace Falcor
                 prevFwd = normalize(strandArrays.controlPoints[j] - strandArrays.controlPoints[j - 1]);
                 fwd = normalize(strandArrays.controlPoints[j + 1] - strandArrays.controlPoints[j - 1]);
             }
-            else if (j < strandArrays.controlPoints.size() - 2)
+            else if (j < strandArrays.controlPoints.size() - 1)
             {
                 prevFwd = normalize(strandArrays.controlPoints[j] - strandArrays.controlPoints[j - 2]);
                 fwd = normalize(strandArrays.controlPoints[j + 1] - strandArrays.controlPoints[j - 1]);
@@ -203,40 +297,66 @@ namespace Falcor
             FALCOR_ASSERT_LT(std::abs(length(t) - 1.f), 1e-3f);
         }
 
-        void updateMeshResultBuffers(CurveTessellation::MeshResult& result, const CurveArrays& curveArrays, StrandArrays& optimizedStrandArrays, const float3& fwd, const float3& s, const float3& t, uint32_t pointCountPerCrossSection, uint32_t j)
+        /** Unit circle sampled at the points of a cross-section, shared by all cross-sections.
+        */
+        struct CrossSection
         {
-            // Mesh vertices, normals, tangents, and texCrds (if any).
-            for (uint32_t k = 0; k < pointCountPerCrossSection; k++)
-            {
-                float phi = (float)k / (float)pointCountPerCrossSection * (float)M_PI * 2.f;
-                float3 vNormal = std::cos(phi) * s + std::sin(phi) * t;
-
-                float curveRadius = 0.5f * optimizedStrandArrays.widths[j];
-                result.vertices.push_back(optimizedStrandArrays.controlPoints[j] + curveRadius * vNormal);
-                result.normals.push_back(vNormal);
-                result.tangents.push_back(float4(fwd.x, fwd.y, fwd.z, 1));
-                result.radii.push_back(curveRadius);
+            std::vector<float> cosPhi;
+            std::vector<float> sinPhi;
 
-                if (curveArrays.UVs)
+            CrossSection(uint32_t pointCount) : cosPhi(pointCount), sinPhi(pointCount)
+            {
+                for (uint32_t k = 0; k < pointCount; k++)
                 {
-                    result.texCrds.push_back(optimizedStrandArrays.UVs[j]);
+                    float phi = (float)k / (float)pointCount * (float)M_PI * 2.f;
+                    cosPhi[k] = std::cos(phi);
+                    sinPhi[k] = std::sin(phi);
                 }
             }
+
+            uint32_t getPointCount() const { return (uint32_t)cosPhi.size(); }
+        };
+
+        void updateMeshResultBuffers(CurveTessellation::MeshResult& result, const CurveArrays& curveArrays, const StrandArrays& optimizedStrandArrays, const CrossSection& crossSection, const float3& fwd, const float3& s, const float3& t, uint32_t meshVertexOffset, uint32_t j)
+        {
+            const uint32_t pointCountPerCrossSection = crossSection.getPointCount();
+            const uint32_t vertexOffset = meshVertexOffset + j * pointCountPerCrossSection;
+            const float3 center = optimizedStrandArrays.controlPoints[j];
+            const float curveRadius = 0.5f * optimizedStrandArrays.widths[j];
+            const float4 tangent = float4(fwd.x, fwd.y, fwd.z, 1);
+
+            // Mesh vertices, normals, tangents, and texCrds (if any).
+            float3* pVertices = result.vertices.data() + vertexOffset;
+            float3* pNormals = result.normals.data() + vertexOffset;
+            for (uint32_t k = 0; k < pointCountPerCrossSection; k++)
+            {
+                float3 vNormal = crossSection.cosPhi[k] * s + crossSection.sinPhi[k] * t;
+                pVertices[k] = center + curveRadius * vNormal;
+                pNormals[k] = vNormal;
+            }
+            std::fill_n(result.tangents.data() + vertexOffset, pointCountPerCrossSection, tangent);
+            std::fill_n(result.radii.data() + vertexOffset, pointCountPerCrossSection, curveRadius);
+            if (curveArrays.UVs) std::fill_n(result.texCrds.data() + vertexOffset, pointCountPerCrossSection, optimizedStrandArrays.UVs[j]);
         }
 
-        void connectFaceVertices(CurveTessellation::MeshResult& result, uint32_t meshVertexOffset, uint32_t pointCountPerCrossSection, uint32_t quadCountLimit, uint32_t nextCrossSectionVertexOffset, uint32_t multiplier, uint32_t j)
+        void connectFaceVertices(CurveTessellation::MeshResult& result, uint32_t meshVertexOffset, uint32_t meshFaceOffset, uint32_t pointCountPerCrossSection, uint32_t j)
         {
-            for (uint32_t k = 0; k < quadCountLimit; k++)
+            const uint32_t faceOffset = meshFaceOffset + 2 * j * pointCountPerCrossSection;
+            const uint32_t vertexOffset = meshVertexOffset + j * pointCountPerCrossSection;
+            const uint32_t nextVertexOffset = vertexOffset + pointCountPerCrossSection;
+
+            std::fill_n(result.faceVertexCounts.data() + faceOffset, 2 * pointCountPerCrossSection, 3);
+            uint32_t* pIndices = result.faceVertexIndices.data() + 3 * faceOffset;
+            for (uint32_t k = 0; k < pointCountPerCrossSection; k++)
             {
-                result.faceVertexCounts.push_back(3);
-                result.faceVertexIndices.push_back(meshVertexOffset + multiplier * j * pointCountPerCrossSection + k);
-                result.faceVertexIndices.push_back(meshVertexOffset + multiplier * j * pointCountPerCrossSection + (k + nextCrossSectionVertexOffset) % pointCountPerCrossSection);
-                result.faceVertexIndices.push_back(meshVertexOffset + (multiplier * j + 1) * pointCountPerCrossSection + (k + nextCrossSectionVertexOffset) % pointCountPerCrossSection);
-
-                result.faceVertexCounts.push_back(3);
-                result.faceVertexIndices.push_back(meshVertexOffset + multiplier * j * pointCountPerCrossSection + k);
-                result.faceVertexIndices.push_back(meshVertexOffset + (multiplier * j + 1) * pointCountPerCrossSection + (k + nextCrossSectionVertexOffset) % pointCountPerCrossSection);
-                result.faceVertexIndices.push_back(meshVertexOffset + (multiplier * j + 1) * pointCountPerCrossSection + k);
+                uint32_t next = (k + 1) % pointCountPerCrossSection;
+                pIndices[6 * k + 0] = vertexOffset + k;
+                pIndices[6 * k + 1] = vertexOffset + next;
+                pIndices[6 * k + 2] = nextVertexOffset + next;
+
+                pIndices[6 * k + 3] = vertexOffset + k;
+                pIndices[6 * k + 4] = nextVertexOffset + next;
+                pIndices[6 * k + 5] = nextVertexOffset + k;
             }
         }
     }
@@ -250,93 +370,88 @@ namespace Falcor
         FALCOR_ASSERT(degree == 1);
         result.degree = degree;
 
-        uint32_t pointCounts = 0;
-        uint32_t segCounts = 0;
-        uint32_t maxVertexCountsPerStrand = 0;
-        for (uint32_t i = 0; i < strandCount; i += keepOneEveryXStrands)
-        {
-            uint32_t tmpPointCount = div_round_up(subdivPerSegment * (vertexCountsPerStrand[i] - 1), keepOneEveryXVerticesPerStrand) + 1;
-            pointCounts += tmpPointCount;
-            segCounts += tmpPointCount - 1;
-            maxVertexCountsPerStrand = std::max(maxVertexCountsPerStrand, vertexCountsPerStrand[i]);
-        }
-        result.indices.reserve(segCounts);
-        result.points.reserve(pointCounts);
-        result.radius.reserve(pointCounts);
-        result.texCrds.reserve(pointCounts);
-
-        uint32_t pointOffset = 0;
-
-        StrandArrays strandArrays;
-        strandArrays.controlPoints.reserve(maxVertexCountsPerStrand);
-        strandArrays.widths.reserve(maxVertexCountsPerStrand);
-        strandArrays.UVs.reserve(maxVertexCountsPerStrand);
-        CurveArrays curveArrays(controlPoints, widths, UVs);
-
-        StrandArrays optimizedStrandArrays;
-        CubicSplineCache splineCache;
-        for (uint32_t i = 0; i < strandCount; i += keepOneEveryXStrands)
-        {
-            optimizedStrandArrays.controlPoints.clear();
-            optimizedStrandArrays.UVs.clear();
-            optimizedStrandArrays.widths.clear();
-            optimizedStrandArrays.vertexCount = 0;
-            strandArrays.vertexCount = vertexCountsPerStrand[i];
+        // Each strand is tessellated into a run of points, each point but the last one starts a segment.
+        const StrandLayout layout = computeStrandLayout(strandCount, vertexCountsPerStrand, controlPoints, subdivPerSegment, keepOneEveryXStrands, keepOneEveryXVerticesPerStrand);
+        const uint32_t pointCount = layout.getPointCount();
+        result.indices.resize(pointCount - layout.getStrandCount());
+        result.points.resize(pointCount);
+        result.radius.resize(pointCount);
+        if (UVs) result.texCrds.resize(pointCount);
 
-            optimizeStrandGeometry(splineCache, curveArrays, strandArrays, optimizedStrandArrays, pointOffset, subdivPerSegment, keepOneEveryXVerticesPerStrand, widthScale);
+        const CurveArrays curveArrays(controlPoints, widths, UVs);
 
-            const CubicSpline<float3>& splinePoints = splineCache.splinePoints.setup(strandArrays.controlPoints.data(), optimizedStrandArrays.vertexCount);
-            const CubicSpline<float>& splineWidths = splineCache.splineWidths.setup(strandArrays.widths.data(), optimizedStrandArrays.vertexCount);
+        forEachStrandRange(layout.getStrandCount(), [&](uint32_t begin, uint32_t end)
+        {
+            StrandArrays strandArrays;
+            CubicSplineCache splineCache;
 
-            uint32_t tmpCount = 0;
-            for (uint32_t j = 0; j < optimizedStrandArrays.vertexCount - 1; j++)
+            for (uint32_t strand = begin; strand < end; strand++)
             {
-                for (uint32_t k = 0; k < subdivPerSegment; k++)
-                {
-                    if (tmpCount % keepOneEveryXVerticesPerStrand == 0)
-                    {
-                        float t = (float)k / (float)subdivPerSegment;
-                        result.indices.push_back((uint32_t)result.points.size());
+                strandArrays.vertexCount = vertexCountsPerStrand[layout.strandIndices[strand]];
+                const uint32_t uniqueCount = removeDuplicatePoints(curveArrays, strandArrays, layout.inputOffsets[strand]);
 
-                        // Pre-transform curve points.
-                        float4 sph = transformSphere(xform, float4(splinePoints.interpolate(j, t), sanitizeWidth(splineWidths.interpolate(j, t) * 0.5f * widthScale)));
+                const CubicSpline<float3>& splinePoints = splineCache.splinePoints.setup(strandArrays.controlPoints.data(), uniqueCount);
+                const CubicSpline<float>& splineWidths = splineCache.splineWidths.setup(strandArrays.widths.data(), uniqueCount);
 
-                        result.points.push_back(sph.xyz());
-                        result.radius.push_back(sph.w);
-                    }
-                    tmpCount++;
-                }
-            }
+                const uint32_t outputOffset = layout.outputOffsets[strand];
+                uint32_t* pIndices = result.indices.data() + outputOffset - strand;
+                float3* pPoints = result.points.data() + outputOffset;
+                float* pRadius = result.radius.data() + outputOffset;
 
-            // Always keep the last vertex.
-            float4 sph = transformSphere(xform, float4(splinePoints.interpolate(optimizedStrandArrays.vertexCount - 2, 1.f), sanitizeWidth(splineWidths.interpolate(optimizedStrandArrays.vertexCount - 2, 1.f) * 0.5f * widthScale)));
-            result.points.push_back(sph.xyz());
-            result.radius.push_back(sph.w);
-
-            // Texture coordinates.
-            if (UVs)
-            {
-                const CubicSpline<float2>& splineUVs = splineCache.splineUVs.setup(strandArrays.UVs.data(), optimizedStrandArrays.vertexCount);
-                tmpCount = 0;
-                for (uint32_t j = 0; j < optimizedStrandArrays.vertexCount - 1; j++)
+                uint32_t tmpCount = 0;
+                uint32_t outputCount = 0;
+                for (uint32_t j = 0; j < uniqueCount - 1; j++)
                 {
                     for (uint32_t k = 0; k < subdivPerSegment; k++)
                     {
                         if (tmpCount % keepOneEveryXVerticesPerStrand == 0)
                         {
                             float t = (float)k / (float)subdivPerSegment;
-                            result.texCrds.push_back(splineUVs.interpolate(j, t));
+                            pIndices[outputCount] = outputOffset + outputCount;
+
+                            // Pre-transform curve points.
+                            float4 sph = transformSphere(xform, float4(splinePoints.interpolate(j, t), sanitizeWidth(splineWidths.interpolate(j, t) * 0.5f * widthScale)));
+
+                            pPoints[outputCount] = sph.xyz();
+                            pRadius[outputCount] = sph.w;
+                            outputCount++;
                         }
                         tmpCount++;
                     }
                 }
 
                 // Always keep the last vertex.
-                result.texCrds.push_back(splineUVs.interpolate(optimizedStrandArrays.vertexCount - 2, 1.f));
-            }
+                float4 sph = transformSphere(xform, float4(splinePoints.interpolate(uniqueCount - 2, 1.f), sanitizeWidth(splineWidths.interpolate(uniqueCount - 2, 1.f) * 0.5f * widthScale)));
+                pPoints[outputCount] = sph.xyz();
+                pRadius[outputCount] = sph.w;
+                outputCount++;
+                FALCOR_ASSERT(outputOffset + outputCount == layout.outputOffsets[strand + 1]);
+
+                // Texture coordinates.
+                if (UVs)
+                {
+                    const CubicSpline<float2>& splineUVs = splineCache.splineUVs.setup(strandArrays.UVs.data(), uniqueCount);
+                    float2* pTexCrds = result.texCrds.data() + outputOffset;
+                    tmpCount = 0;
+                    outputCount = 0;
+                    for (uint32_t j = 0; j < uniqueCount - 1; j++)
+                    {
+                        for (uint32_t k = 0; k < subdivPerSegment; k++)
+                        {
+                            if (tmpCount % keepOneEveryXVerticesPerStrand == 0)
+                            {
+                                float t = (float)k / (float)subdivPerSegment;
+                                pTexCrds[outputCount++] = splineUVs.interpolate(j, t);
+                            }
+                            tmpCount++;
+                        }
+                    }
 
-            for (uint32_t j = i; j < std::min(strandCount, i + keepOneEveryXStrands); j++) pointOffset += vertexCountsPerStrand[j];
-        }
+                    // Always keep the last vertex.
+                    pTexCrds[outputCount] = splineUVs.interpolate(uniqueCount - 2, 1.f);
+                }
+            }
+        });
 
         return result;
     }
@@ -344,76 +459,62 @@ namespace Falcor
     CurveTessellation::MeshResult CurveTessellation::convertToPolytube(uint32_t strandCount, const uint32_t* vertexCountsPerStrand, const float3* controlPoints, const float* widths, const float2* UVs, uint32_t subdivPerSegment, uint32_t keepOneEveryXStrands, uint32_t keepOneEveryXVerticesPerStrand, float widthScale, uint32_t pointCountPerCrossSection)
     {
         MeshResult result;
-        uint32_t vertexCounts = 0;
-        uint32_t faceCounts = 0;
-        uint32_t maxVertexCountsPerStrand = 0;
-        for (uint32_t i = 0; i < strandCount; i += keepOneEveryXStrands)
-        {
-            uint32_t tmpPointCount = div_round_up(subdivPerSegment * (vertexCountsPerStrand[i] - 1), keepOneEveryXVerticesPerStrand) + 1;
-            vertexCounts += pointCountPerCrossSection * tmpPointCount;
-            faceCounts += 2 * pointCountPerCrossSection * (tmpPointCount - 1);
-            maxVertexCountsPerStrand = std::max(maxVertexCountsPerStrand, vertexCountsPerStrand[i]);
-        }
-        result.vertices.reserve(vertexCounts);
-        result.normals.reserve(vertexCounts);
-        result.tangents.reserve(vertexCounts);
-        result.texCrds.reserve(vertexCounts);
-        result.radii.reserve(vertexCounts);
-        result.faceVertexCounts.reserve(faceCounts);
-        result.faceVertexIndices.reserve(faceCounts * 3);
-
-        uint32_t pointOffset = 0;
-        uint32_t meshVertexOffset = 0;
-
-        StrandArrays strandArrays;
-        strandArrays.controlPoints.reserve(maxVertexCountsPerStrand);
-        strandArrays.widths.reserve(maxVertexCountsPerStrand);
-        strandArrays.UVs.reserve(maxVertexCountsPerStrand);
-        CurveArrays curveArrays(controlPoints, widths, UVs);
-
-        StrandArrays optimizedStrandArrays;
-        CubicSplineCache splineCache;
-        for (uint32_t i = 0; i < strandCount; i += keepOneEveryXStrands)
+
+        // Each strand is tessellated into a run of cross-sections, which are connected by two triangles per cross-section point.
+        const StrandLayout layout = computeStrandLayout(strandCount, vertexCountsPerStrand, controlPoints, subdivPerSegment, keepOneEveryXStrands, keepOneEveryXVerticesPerStrand);
+        const uint32_t vertexCount = pointCountPerCrossSection * layout.getPointCount();
+        const uint32_t faceCount = 2 * pointCountPerCrossSection * (layout.getPointCount() - layout.getStrandCount());
+        result.vertices.resize(vertexCount);
+        result.normals.resize(vertexCount);
+        result.tangents.resize(vertexCount);
+        if (UVs) result.texCrds.resize(vertexCount);
+        result.radii.resize(vertexCount);
+        result.faceVertexCounts.resize(faceCount);
+        result.faceVertexIndices.resize(faceCount * 3);
+
+        const CurveArrays curveArrays(controlPoints, widths, UVs);
+        const CrossSection crossSection(pointCountPerCrossSection);
+
+        forEachStrandRange(layout.getStrandCount(), [&](uint32_t begin, uint32_t end)
         {
-            optimizedStrandArrays.controlPoints.clear();
-            optimizedStrandArrays.UVs.clear();
-            optimizedStrandArrays.widths.clear();
-            optimizedStrandArrays.vertexCount = 0;
+            StrandArrays strandArrays;
+            StrandArrays optimizedStrandArrays;
+            CubicSplineCache splineCache;
 
-            strandArrays.vertexCount = vertexCountsPerStrand[i];
+            for (uint32_t strand = begin; strand < end; strand++)
+            {
+                strandArrays.vertexCount = vertexCountsPerStrand[layout.strandIndices[strand]];
 
-            optimizeStrandGeometry(splineCache, curveArrays, strandArrays, optimizedStrandArrays, pointOffset, subdivPerSegment, keepOneEveryXVerticesPerStrand, widthScale);
+                optimizeStrandGeometry(splineCache, curveArrays, strandArrays, optimizedStrandArrays, layout.inputOffsets[strand], subdivPerSegment, keepOneEveryXVerticesPerStrand, widthScale);
+                FALCOR_ASSERT(layout.outputOffsets[strand] + optimizedStrandArrays.controlPoints.size() == layout.outputOffsets[strand + 1]);
 
-            for (uint32_t j = i; j < std::min(strandCount, i + keepOneEveryXStrands); j++) pointOffset += vertexCountsPerStrand[j];
+                const uint32_t meshVertexOffset = pointCountPerCrossSection * layout.outputOffsets[strand];
+                const uint32_t meshFaceOffset = 2 * pointCountPerCrossSection * (layout.outputOffsets[strand] - strand);
 
-            // Build the initial frame.
-            float3 fwd, s, t;
-            fwd = normalize(optimizedStrandArrays.controlPoints[1] - optimizedStrandArrays.controlPoints[0]);
-            FALCOR_ASSERT_LT(std::abs(length(fwd) - 1.f), 1e-3f);
-            buildFrame(fwd, s, t);
+                // Build the initial frame.
+                float3 fwd, s, t;
+                fwd = normalize(optimizedStrandArrays.controlPoints[1] - optimizedStrandArrays.controlPoints[0]);
+                FALCOR_ASSERT_LT(std::abs(length(fwd) - 1.f), 1e-3f);
+                buildFrame(fwd, s, t);
 
-            // Create mesh.
-            for (uint32_t j = 0; j < optimizedStrandArrays.controlPoints.size(); j++)
-            {
-                // Update the curve's frame vectors: [fwd, s, t]
-                updateCurveFrame(optimizedStrandArrays, fwd, s, t, j);
+                // Create mesh.
+                for (uint32_t j = 0; j < optimizedStrandArrays.controlPoints.size(); j++)
+                {
+                    // Update the curve's frame vectors: [fwd, s, t]
+                    updateCurveFrame(optimizedStrandArrays, fwd, s, t, j);
 
-                // Mesh vertices, normals, tangents, and texCrds (if any).
-                updateMeshResultBuffers(result, curveArrays, optimizedStrandArrays, fwd, s, t, pointCountPerCrossSection, j);
+                    // Mesh vertices, normals, tangents, and texCrds (if any).
+                    updateMeshResultBuffers(result, curveArrays, optimizedStrandArrays, crossSection, fwd, s, t, meshVertexOffset, j);
 
-                // Mesh faces.
-                if (j < optimizedStrandArrays.controlPoints.size() - 1)
-                {
-                    uint32_t quadCountLimit = pointCountPerCrossSection;
-                    connectFaceVertices(result, meshVertexOffset, pointCountPerCrossSection, quadCountLimit, 1, 1, j);
+                    // Mesh faces.
+                    if (j < optimizedStrandArrays.controlPoints.size() - 1)
+                    {
+                        connectFaceVertices(result, meshVertexOffset, meshFaceOffset, pointCountPerCrossSection, j);
+                    }
                 }
             }
-
-            meshVertexOffset += pointCountPerCrossSection * (uint32_t)optimizedStrandArrays.controlPoints.size();
-        }
+        });
 
         return result;
     }
-
-
 }
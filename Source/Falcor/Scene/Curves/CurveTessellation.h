@@ -34,6 +34,9 @@
 
 namespace Falcor
 {
+    /** Conversion of curve strands to linear swept spheres or triangle meshes.
+        Strands are tessellated in parallel directly into the output arrays, the result does not depend on the thread count.
+    */
     class FALCOR_API CurveTessellation
     {
     public:
@@ -0,0 +1,175 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "DirtyTracking.h"
+#include "Core/Error.h"
+#include <algorithm>
+#include <numeric>
+
+namespace Falcor
+{
+    namespace
+    {
+        /// Maximum fraction of moved instances for refitting a TLAS instead of rebuilding it.
+        const double kMaxRefitMovedInstanceFraction = 0.25;
+
+        /// Maximum number of consecutive TLAS refits before it is rebuilt.
+        const uint32_t kMaxConsecutiveTlasRefits = 32;
+    }
+
+    void computeUploadRanges(std::vector<uint32_t>& indices, uint32_t maxGap, std::vector<UploadRange>& ranges)
+    {
+        std::sort(indices.begin(), indices.end());
+        indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+        ranges.clear();
+        for (uint32_t index : indices)
+        {
+            if (!ranges.empty() && index - (ranges.back().offset + ranges.back().count) <= maxGap)
+            {
+                ranges.back().count = index - ranges.back().offset + 1;
+            }
+            else
+            {
+                ranges.push_back({ index, 1 });
+            }
+        }
+    }
+
+    SceneGraphDirtyTracker::SceneGraphDirtyTracker(const std::vector<NodeID>& parents)
+        : mDirty(parents.size(), 0)
+    {
+        // Build the child lists.
+        mChildOffsets.assign(parents.size() + 1, 0);
+        for (size_t i = 0; i < parents.size(); i++)
+        {
+            if (parents[i] == NodeID::Invalid()) continue;
+            FALCOR_CHECK(parents[i].get() < i, "Scene graph node {} is stored before its parent {}.", i, parents[i].get());
+            mChildOffsets[parents[i].get() + 1]++;
+        }
+        std::partial_sum(mChildOffsets.begin(), mChildOffsets.end(), mChildOffsets.begin());
+
+        mChildren.resize(mChildOffsets.back());
+        std::vector<uint32_t> cursors(mChildOffsets.begin(), mChildOffsets.end() - 1);
+        for (uint32_t i = 0; i < (uint32_t)parents.size(); i++)
+        {
+            if (parents[i] != NodeID::Invalid()) mChildren[cursors[parents[i].get()]++] = i;
+        }
+    }
+
+    void SceneGraphDirtyTracker::markDirty(uint32_t nodeID)
+    {
+        FALCOR_ASSERT(nodeID < mDirty.size());
+        mMarkedNodes.push_back(nodeID);
+    }
+
+    void SceneGraphDirtyTracker::markAllDirty()
+    {
+        std::fill(mDirty.begin(), mDirty.end(), 1);
+        mDirtyNodes.resize(mDirty.size());
+        std::iota(mDirtyNodes.begin(), mDirtyNodes.end(), 0);
+        mMarkedNodes.clear();
+    }
+
+    void SceneGraphDirtyTracker::propagate()
+    {
+        // Traverse the subtrees of the marked nodes in index order. Parents are stored before their children, so the
+        // subtree of a node is always traversed before any marked nodes inside of it, which are then skipped.
+        std::sort(mMarkedNodes.begin(), mMarkedNodes.end());
+
+        bool reachedDirtyNodes = false;
+        for (uint32_t markedNode : mMarkedNodes)
+        {
+            if (mDirty[markedNode]) continue;
+
+            mStack.push_back(markedNode);
+            while (!mStack.empty())
+            {
+                uint32_t node = mStack.back();
+                mStack.pop_back();
+                mDirty[node] = 1;
+                mDirtyNodes.push_back(node);
+
+                for (uint32_t i = mChildOffsets[node]; i < mChildOffsets[node + 1]; i++)
+                {
+                    // Subtrees of nodes dirtied by a previous propagation are already dirty.
+                    if (mDirty[mChildren[i]]) reachedDirtyNodes = true;
+                    else mStack.push_back(mChildren[i]);
+                }
+            }
+        }
+        mMarkedNodes.clear();
+
+        // Nodes dirtied by a previous propagation may be listed before their newly dirtied parents.
+        // Restore the order of parents before children by sorting by index.
+        if (reachedDirtyNodes) std::sort(mDirtyNodes.begin(), mDirtyNodes.end());
+    }
+
+    void SceneGraphDirtyTracker::clear()
+    {
+        if (mDirtyNodes.size() == mDirty.size())
+        {
+            std::fill(mDirty.begin(), mDirty.end(), 0);
+        }
+        else
+        {
+            for (uint32_t node : mDirtyNodes) mDirty[node] = 0;
+        }
+        mDirtyNodes.clear();
+        mMarkedNodes.clear();
+    }
+
+    NodeItemMap::NodeItemMap(const std::vector<uint32_t>& itemNodeIDs, uint32_t nodeCount)
+    {
+        mItemOffsets.assign(nodeCount + 1, 0);
+        for (uint32_t nodeID : itemNodeIDs)
+        {
+            FALCOR_CHECK(nodeID < nodeCount, "Invalid node ID {}.", nodeID);
+            mItemOffsets[nodeID + 1]++;
+        }
+        std::partial_sum(mItemOffsets.begin(), mItemOffsets.end(), mItemOffsets.begin());
+
+        mItems.resize(itemNodeIDs.size());
+        std::vector<uint32_t> cursors(mItemOffsets.begin(), mItemOffsets.end() - 1);
+        for (uint32_t i = 0; i < (uint32_t)itemNodeIDs.size(); i++) mItems[cursors[itemNodeIDs[i]]++] = i;
+    }
+
+    void NodeItemMap::appendItems(const std::vector<uint32_t>& nodeIDs, std::vector<uint32_t>& items) const
+    {
+        for (uint32_t nodeID : nodeIDs)
+        {
+            FALCOR_ASSERT(nodeID + 1 < mItemOffsets.size());
+            items.insert(items.end(), mItems.begin() + mItemOffsets[nodeID], mItems.begin() + mItemOffsets[nodeID + 1]);
+        }
+    }
+
+    bool shouldRefitTlas(bool canRefit, uint32_t movedInstanceCount, uint32_t instanceCount, uint32_t refitCount)
+    {
+        if (!canRefit || refitCount >= kMaxConsecutiveTlasRefits) return false;
+        return movedInstanceCount <= kMaxRefitMovedInstanceFraction * instanceCount;
+    }
+}
@@ -0,0 +1,140 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/Macros.h"
+#include "Scene/SceneIDs.h"
+#include <cstdint>
+#include <vector>
+
+namespace Falcor
+{
+    /** Range of consecutive elements of a buffer.
+    */
+    struct UploadRange
+    {
+        uint32_t offset = 0;    ///< Index of the first element.
+        uint32_t count = 0;     ///< Number of elements.
+
+        bool operator==(const UploadRange& other) const { return offset == other.offset && count == other.count; }
+    };
+
+    /** Compute the ranges of a buffer to upload for a set of changed elements.
+        Ranges separated by at most maxGap unchanged elements are merged, as uploading a few unchanged elements is cheaper than issuing another upload.
+        \param[in,out] indices Indices of the changed elements. Sorted and deduplicated in place.
+        \param[in] maxGap Maximum number of unchanged elements between two merged ranges.
+        \param[out] ranges Minimal list of ranges covering all changed elements, sorted by offset.
+    */
+    FALCOR_API void computeUploadRanges(std::vector<uint32_t>& indices, uint32_t maxGap, std::vector<UploadRange>& ranges);
+
+    /** Tracks changed scene graph nodes.
+
+        Nodes are marked dirty when their local transform changes. propagate() then marks all their descendants dirty by
+        traversing the subtrees of the marked nodes only, so the cost of an update is proportional to the number of changed
+        nodes rather than to the size of the scene graph. The dirty state is kept until the next call to clear(), which
+        is also proportional to the number of dirty nodes.
+    */
+    class FALCOR_API SceneGraphDirtyTracker
+    {
+    public:
+        SceneGraphDirtyTracker() = default;
+
+        /** Create a tracker for a scene graph.
+            \param[in] parents Parent of each node, or NodeID::Invalid() for root nodes. Parents must be stored before their children.
+        */
+        SceneGraphDirtyTracker(const std::vector<NodeID>& parents);
+
+        uint32_t getNodeCount() const { return (uint32_t)mDirty.size(); }
+
+        /** Mark a node as changed. Its descendants are marked by the next call to propagate().
+        */
+        void markDirty(uint32_t nodeID);
+
+        /** Mark all nodes as changed.
+        */
+        void markAllDirty();
+
+        /** Mark the descendants of all nodes marked since the last call.
+            The dirty nodes are appended to the list returned by getDirtyNodes().
+        */
+        void propagate();
+
+        /** Check if a node changed. Only valid for descendants after propagate() has been called.
+        */
+        bool isDirty(uint32_t nodeID) const { return mDirty[nodeID] != 0; }
+
+        /** Get the dirty nodes. Parents are listed before their children.
+        */
+        const std::vector<uint32_t>& getDirtyNodes() const { return mDirtyNodes; }
+
+        /** Reset all nodes to unchanged.
+        */
+        void clear();
+
+    private:
+        std::vector<uint32_t> mChildOffsets;    ///< Offset of the first child of each node, followed by the total child count.
+        std::vector<uint32_t> mChildren;        ///< Children of all nodes.
+        std::vector<uint8_t> mDirty;            ///< Flag per node, nonzero if the node changed.
+        std::vector<uint32_t> mMarkedNodes;     ///< Nodes marked since the last propagation.
+        std::vector<uint32_t> mDirtyNodes;      ///< Dirty nodes, parents before children.
+        std::vector<uint32_t> mStack;           ///< Traversal stack.
+    };
+
+    /** Maps scene graph nodes to the items (e.g. geometry instances) transformed by them.
+    */
+    class FALCOR_API NodeItemMap
+    {
+    public:
+        NodeItemMap() = default;
+
+        /** Create a map.
+            \param[in] itemNodeIDs Node of each item.
+            \param[in] nodeCount Number of scene graph nodes.
+        */
+        NodeItemMap(const std::vector<uint32_t>& itemNodeIDs, uint32_t nodeCount);
+
+        /** Append the items of a list of nodes.
+            \param[in] nodeIDs List of nodes.
+            \param[out] items Items transformed by the nodes, in the order of the nodes.
+        */
+        void appendItems(const std::vector<uint32_t>& nodeIDs, std::vector<uint32_t>& items) const;
+
+    private:
+        std::vector<uint32_t> mItemOffsets;     ///< Offset of the first item of each node, followed by the total item count.
+        std::vector<uint32_t> mItems;
+    };
+
+    /** Decide whether to refit or rebuild a TLAS after instances moved.
+        Refitting keeps the tree topology, so the quality of the TLAS degrades when many instances move or after many consecutive refits.
+        \param[in] canRefit True if the TLAS was built to allow updates.
+        \param[in] movedInstanceCount Number of instances moved since the TLAS was last built or refit.
+        \param[in] instanceCount Total number of instances.
+        \param[in] refitCount Number of refits since the TLAS was last rebuilt.
+        \return True if the TLAS should be refit, false if it should be rebuilt.
+    */
+    FALCOR_API bool shouldRefitTlas(bool canRefit, uint32_t movedInstanceCount, uint32_t instanceCount, uint32_t refitCount);
+}
@@ -0,0 +1,633 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+
+// This code is based on pbrt:
+// pbrt is Copyright(c) 1998-2020 Matt Pharr, Wenzel Jakob, and Greg Humphreys.
+// The pbrt source code is licensed under the Apache License, Version 2.0.
+// SPDX: Apache-2.0
+
+#include "LoopSubdivide.h"
+#include "Core/Error.h"
+#include "Utils/ParallelFor.h"
+#include <BS_thread_pool.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kInvalid = std::numeric_limits<uint32_t>::max();
+
+        /// Minimum number of elements processed by a single task.
+        const uint32_t kBlockSize = 4096;
+
+        inline uint32_t next(uint32_t i) { return (i + 1) % 3; }
+        inline uint32_t prev(uint32_t i) { return (i + 2) % 3; }
+
+        inline float beta(uint32_t valence)
+        {
+            if (valence == 3)
+                return 3.f / 16.f;
+            else
+                return 3.f / (8.f * valence);
+        }
+
+        inline float loopGamma(uint32_t valence)
+        {
+            return 1.f / (valence + 3.f / (8.f * beta(valence)));
+        }
+
+        /** Mesh at one level of subdivision.
+            Each face stores its three vertices and the neighboring face across each edge, where edge k connects the
+            vertices k and next(k). Each vertex stores one of its faces, where the traversal of its one-ring starts.
+        */
+        struct SubdivMesh
+        {
+            std::vector<float3> positions;
+            std::vector<uint32_t> startFaces;
+            std::vector<uint8_t> boundary;
+            std::vector<uint8_t> regular;
+
+            std::vector<uint32_t> faceVertices;     ///< Three vertices per face.
+            std::vector<uint32_t> faceNeighbors;    ///< Three neighbor faces per face, kInvalid on boundary edges.
+
+            uint32_t getVertexCount() const { return (uint32_t)positions.size(); }
+            uint32_t getFaceCount() const { return (uint32_t)(faceVertices.size() / 3); }
+
+            uint32_t vnum(uint32_t face, uint32_t vert) const
+            {
+                for (uint32_t i = 0; i < 3; ++i)
+                {
+                    if (faceVertices[3 * face + i] == vert)
+                        return i;
+                }
+                FALCOR_THROW("Basic logic error in vnum().");
+            }
+
+            uint32_t nextFace(uint32_t face, uint32_t vert) const { return faceNeighbors[3 * face + vnum(face, vert)]; }
+            uint32_t prevFace(uint32_t face, uint32_t vert) const { return faceNeighbors[3 * face + prev(vnum(face, vert))]; }
+            uint32_t nextVert(uint32_t face, uint32_t vert) const { return faceVertices[3 * face + next(vnum(face, vert))]; }
+            uint32_t prevVert(uint32_t face, uint32_t vert) const { return faceVertices[3 * face + prev(vnum(face, vert))]; }
+
+            /// Get the vertices of face edge e, which is edge e % 3 of face e / 3, ordered by index.
+            std::pair<uint32_t, uint32_t> getEdgeVertices(uint32_t e) const
+            {
+                uint32_t v0 = faceVertices[e];
+                uint32_t v1 = faceVertices[e - e % 3 + next(e % 3)];
+                return std::make_pair(std::min(v0, v1), std::max(v0, v1));
+            }
+
+            uint32_t otherVert(uint32_t face, uint32_t v0, uint32_t v1) const
+            {
+                for (uint32_t i = 0; i < 3; ++i)
+                {
+                    uint32_t v = faceVertices[3 * face + i];
+                    if (v != v0 && v != v1)
+                        return v;
+                }
+                FALCOR_THROW("Basic logic error in otherVert().");
+            }
+
+            uint32_t valence(uint32_t vert) const
+            {
+                uint32_t f = startFaces[vert];
+                if (!boundary[vert])
+                {
+                    // Compute valence of interior vertex.
+                    uint32_t nf = 1;
+                    while ((f = nextFace(f, vert)) != startFaces[vert])
+                        ++nf;
+                    return nf;
+                }
+                else
+                {
+                    // Compute valence of boundary vertex.
+                    uint32_t nf = 1;
+                    while ((f = nextFace(f, vert)) != kInvalid)
+                        ++nf;
+                    f = startFaces[vert];
+                    while ((f = prevFace(f, vert)) != kInvalid)
+                        ++nf;
+                    return nf + 1;
+                }
+            }
+
+            /** Get the positions of the one-ring of a vertex.
+                \param[in] vert Vertex.
+                \param[out] ring Positions, resized to the valence of the vertex.
+            */
+            void oneRing(uint32_t vert, std::vector<float3>& ring) const
+            {
+                ring.clear();
+                uint32_t face = startFaces[vert];
+                if (!boundary[vert])
+                {
+                    // Get one-ring vertices for interior vertex.
+                    do
+                    {
+                        ring.push_back(positions[nextVert(face, vert)]);
+                        face = nextFace(face, vert);
+                    } while (face != startFaces[vert]);
+                }
+                else
+                {
+                    // Get one-ring vertices for boundary vertex.
+                    uint32_t f2;
+                    while ((f2 = nextFace(face, vert)) != kInvalid)
+                        face = f2;
+                    ring.push_back(positions[nextVert(face, vert)]);
+                    do
+                    {
+                        ring.push_back(positions[prevVert(face, vert)]);
+                        face = prevFace(face, vert);
+                    } while (face != kInvalid);
+                }
+            }
+
+            float3 weightOneRing(uint32_t vert, float beta, std::vector<float3>& ring) const
+            {
+                oneRing(vert, ring);
+                uint32_t valence = (uint32_t)ring.size();
+                float3 p = (1 - valence * beta) * positions[vert];
+                for (uint32_t i = 0; i < valence; ++i)
+                    p += beta * ring[i];
+                return p;
+            }
+
+            float3 weightBoundary(uint32_t vert, float beta, std::vector<float3>& ring) const
+            {
+                oneRing(vert, ring);
+                uint32_t valence = (uint32_t)ring.size();
+                float3 p = (1 - 2 * beta) * positions[vert];
+                p += beta * ring[0];
+                p += beta * ring[valence - 1];
+                return p;
+            }
+        };
+
+        /** Face edges grouped by their vertices.
+            The face edges are sorted by their smaller vertex, then by their
+            larger vertex, then by index. Face edges connecting the same vertices are thus consecutive, ordered as
+            they are referenced by the faces.
+        */
+        struct EdgeGroups
+        {
+            std::vector<uint32_t> offsets;  ///< Offset of the face edges of each smaller vertex, plus the total count.
+            std::vector<uint32_t> edges;    ///< Sorted face edges.
+        };
+
+        EdgeGroups groupEdges(const SubdivMesh& mesh, BS::thread_pool* pThreadPool)
+        {
+            const uint32_t vertexCount = mesh.getVertexCount();
+            const uint32_t edgeCount = (uint32_t)mesh.faceVertices.size();
+
+            // Counting sort by smaller vertex, which keeps the face edges of each vertex in order.
+            EdgeGroups groups;
+            groups.offsets.assign(vertexCount + 1, 0);
+            for (uint32_t e = 0; e < edgeCount; ++e)
+                groups.offsets[mesh.getEdgeVertices(e).first + 1]++;
+            for (uint32_t v = 0; v < vertexCount; ++v)
+                groups.offsets[v + 1] += groups.offsets[v];
+
+            groups.edges.resize(edgeCount);
+            std::vector<uint32_t> cursors(groups.offsets.begin(), groups.offsets.end() - 1);
+            for (uint32_t e = 0; e < edgeCount; ++e)
+                groups.edges[cursors[mesh.getEdgeVertices(e).first]++] = e;
+
+            // Sort the face edges of each vertex by larger vertex.
+            parallelFor(
+                pThreadPool,
+                vertexCount,
+                [&](uint32_t begin, uint32_t end)
+                {
+                    for (uint32_t v = begin; v < end; ++v)
+                    {
+                        auto first = groups.edges.begin() + groups.offsets[v];
+                        auto last = groups.edges.begin() + groups.offsets[v + 1];
+                        if (last - first > 1)
+                        {
+                            std::sort(
+                                first,
+                                last,
+                                [&](uint32_t a, uint32_t b)
+                                { return std::make_pair(mesh.getEdgeVertices(a).second, a) < std::make_pair(mesh.getEdgeVertices(b).second, b); }
+                            );
+                        }
+                    }
+                },
+                kBlockSize
+            );
+
+            return groups;
+        }
+
+        SubdivMesh createBaseMesh(fstd::span<const float3> positions, fstd::span<const uint32_t> indices, BS::thread_pool* pThreadPool)
+        {
+            if (indices.size() % 3 != 0)
+                FALCOR_THROW("Index count ({}) is not a multiple of 3.", indices.size());
+            if (indices.size() > std::numeric_limits<uint32_t>::max() / 4 || positions.size() > std::numeric_limits<uint32_t>::max() / 4)
+                FALCOR_THROW("Mesh is too large to subdivide.");
+
+            SubdivMesh mesh;
+            mesh.positions.assign(positions.begin(), positions.end());
+            mesh.faceVertices.assign(indices.begin(), indices.end());
+            mesh.faceNeighbors.assign(indices.size(), kInvalid);
+
+            const uint32_t vertexCount = mesh.getVertexCount();
+            const uint32_t faceCount = mesh.getFaceCount();
+
+            // Set vertex to face indices. Each vertex starts at the last face referencing it.
+            mesh.startFaces.assign(vertexCount, kInvalid);
+            for (uint32_t i = 0; i < faceCount * 3; ++i)
+            {
+                uint32_t v = mesh.faceVertices[i];
+                if (v >= vertexCount)
+                    FALCOR_THROW("Vertex index {} is out of range ({} vertices).", v, vertexCount);
+                mesh.startFaces[v] = i / 3;
+            }
+            for (uint32_t v = 0; v < vertexCount; ++v)
+            {
+                if (mesh.startFaces[v] == kInvalid)
+                    FALCOR_THROW("Vertex {} is not referenced by any triangle.", v);
+            }
+
+            // Set neighbor indices in faces. Face edges connecting the same vertices are paired in the order they are
+            // referenced, i.e. the second face edge is the neighbor of the first, the fourth of the third and so on.
+            EdgeGroups groups = groupEdges(mesh, pThreadPool);
+            parallelFor(
+                pThreadPool,
+                vertexCount,
+                [&](uint32_t begin, uint32_t end)
+                {
+                    for (uint32_t i = groups.offsets[begin]; i + 1 < groups.offsets[end]; ++i)
+                    {
+                        uint32_t e0 = groups.edges[i];
+                        uint32_t e1 = groups.edges[i + 1];
+                        if (mesh.getEdgeVertices(e0) == mesh.getEdgeVertices(e1))
+                        {
+                            mesh.faceNeighbors[e0] = e1 / 3;
+                            mesh.faceNeighbors[e1] = e0 / 3;
+                            ++i;
+                        }
+                    }
+                },
+                kBlockSize
+            );
+
+            // Finish vertex initialization.
+            mesh.boundary.resize(vertexCount);
+            mesh.regular.resize(vertexCount);
+            parallelFor(
+                pThreadPool,
+                vertexCount,
+                [&](uint32_t begin, uint32_t end)
+                {
+                    for (uint32_t v = begin; v < end; ++v)
+                    {
+                        uint32_t f = mesh.startFaces[v];
+                        do
+                        {
+                            f = mesh.nextFace(f, v);
+                        } while (f != kInvalid && f != mesh.startFaces[v]);
+                        mesh.boundary[v] = f == kInvalid;
+                        uint32_t valence = mesh.valence(v);
+                        mesh.regular[v] = mesh.boundary[v] ? valence == 4 : valence == 6;
+                    }
+                },
+                kBlockSize
+            );
+
+            return mesh;
+        }
+
+        SubdivMesh subdivide(const SubdivMesh& mesh, BS::thread_pool* pThreadPool)
+        {
+            const uint32_t vertexCount = mesh.getVertexCount();
+            const uint32_t faceCount = mesh.getFaceCount();
+            const uint32_t edgeCount = faceCount * 3;
+
+            // Find the unique edges. Each edge is owned by the first face edge referencing its vertices.
+            EdgeGroups groups = groupEdges(mesh, pThreadPool);
+            std::vector<uint32_t> owners(edgeCount);
+            parallelFor(
+                pThreadPool,
+                vertexCount,
+                [&](uint32_t begin, uint32_t end)
+                {
+                    uint32_t owner = kInvalid;
+                    for (uint32_t i = groups.offsets[begin]; i < groups.offsets[end]; ++i)
+                    {
+                        uint32_t e = groups.edges[i];
+                        if (owner == kInvalid || mesh.getEdgeVertices(e) != mesh.getEdgeVertices(owner))
+                            owner = e;
+                        owners[e] = owner;
+                    }
+                },
+                kBlockSize
+            );
+
+            // Number the odd vertices in the order their edges are first referenced (blockwise prefix sum).
+            const uint32_t blockCount = (edgeCount + kBlockSize - 1) / kBlockSize;
+            std::vector<uint32_t> blockOffsets(blockCount + 1, 0);
+            parallelFor(
+                pThreadPool,
+                blockCount,
+                [&](uint32_t begin, uint32_t end)
+                {
+                    for (uint32_t b = begin; b < end; ++b)
+                    {
+                        uint32_t count = 0;
+                        for (uint32_t e = b * kBlockSize; e < std::min(edgeCount, (b + 1) * kBlockSize); ++e)
+                            count += owners[e] == e;
+                        blockOffsets[b + 1] = count;
+                    }
+                },
+                kBlockSize
+            );
+            for (uint32_t b = 0; b < blockCount; ++b)
+                blockOffsets[b + 1] += blockOffsets[b];
+            const uint32_t oddCount = blockOffsets[blockCount];
+
+            std::vector<uint32_t> oddVertices(edgeCount); ///< Odd vertex of each face edge.
+            std::vector<uint32_t> oddOwners(oddCount);    ///< Owning face edge of each odd vertex.
+            parallelFor(
+                pThreadPool,
+                blockCount,
+                [&](uint32_t begin, uint32_t end)
+                {
+                    for (uint32_t b = begin; b < end; ++b)
+                    {
+                        uint32_t index = blockOffsets[b];
+                        for (uint32_t e = b * kBlockSize; e < std::min(edgeCount, (b + 1) * kBlockSize); ++e)
+                        {
+                            if (owners[e] == e)
+                            {
+                                oddOwners[index] = e;
+                                oddVertices[e] = vertexCount + index++;
+                            }
+                        }
+                    }
+                },
+                kBlockSize
+            );
+            parallelFor(
+                pThreadPool,
+                edgeCount,
+                [&](uint32_t begin, uint32_t end)
+                {
+                    for (uint32_t e = begin; e < end; ++e)
+                        oddVertices[e] = oddVertices[owners[e]];
+                },
+                kBlockSize
+            );
+
+            SubdivMesh child;
+            child.positions.resize(vertexCount + oddCount);
+            child.startFaces.resize(vertexCount + oddCount);
+            child.boundary.resize(vertexCount + oddCount);
+            child.regular.resize(vertexCount + oddCount);
+            child.faceVertices.resize(faceCount * 12);
+            child.faceNeighbors.resize(faceCount * 12);
+
+            // Update vertex positions for even vertices. Face k of the children of face f is 4 * f + k.
+            parallelFor(
+                pThreadPool,
+                vertexCount,
+                [&](uint32_t begin, uint32_t end)
+                {
+                    std::vector<float3> ring;
+                    for (uint32_t v = begin; v < end; ++v)
+                    {
+                        if (!mesh.boundary[v])
+                        {
+                            // Apply one-ring rule for even vertex.
+                            if (mesh.regular[v])
+                                child.positions[v] = mesh.weightOneRing(v, 1.f / 16.f, ring);
+                            else
+                                child.positions[v] = mesh.weightOneRing(v, beta(mesh.valence(v)), ring);
+                        }
+                        else
+                        {
+                            // Apply boundary rule for even vertex.
+                            child.positions[v] = mesh.weightBoundary(v, 1.f / 8.f, ring);
+                        }
+
+                        uint32_t startFace = mesh.startFaces[v];
+                        child.startFaces[v] = 4 * startFace + mesh.vnum(startFace, v);
+                        child.boundary[v] = mesh.boundary[v];
+                        child.regular[v] = mesh.regular[v];
+                    }
+                },
+                kBlockSize
+            );
+
+            // Compute new odd edge vertices.
+            parallelFor(
+                pThreadPool,
+                oddCount,
+                [&](uint32_t begin, uint32_t end)
+                {
+                    for (uint32_t i = begin; i < end; ++i)
+                    {
+                        uint32_t e = oddOwners[i];
+                        uint32_t face = e / 3;
+                        uint32_t v0 = mesh.faceVertices[e];
+                        uint32_t v1 = mesh.faceVertices[3 * face + next(e % 3)];
+                        uint32_t neighbor = mesh.faceNeighbors[e];
+
+                        uint32_t vert = vertexCount + i;
+                        child.regular[vert] = true;
+                        child.boundary[vert] = neighbor == kInvalid;
+                        child.startFaces[vert] = 4 * face + 3;
+
+                        // Apply edge rules to compute new vertex position.
+                        float3 p0 = mesh.positions[std::min(v0, v1)];
+                        float3 p1 = mesh.positions[std::max(v0, v1)];
+                        float3 p;
+                        if (neighbor == kInvalid)
+                        {
+                            p = 0.5f * p0;
+                            p += 0.5f * p1;
+                        }
+                        else
+                        {
+                            p = 3.f / 8.f * p0;
+                            p += 3.f / 8.f * p1;
+                            p += 1.f / 8.f * mesh.positions[mesh.otherVert(face, v0, v1)];
+                            p += 1.f / 8.f * mesh.positions[mesh.otherVert(neighbor, v0, v1)];
+                        }
+                        child.positions[vert] = p;
+                    }
+                },
+                kBlockSize
+            );
+
+            // Update new mesh topology.
+            parallelFor(
+                pThreadPool,
+                faceCount,
+                [&](uint32_t begin, uint32_t end)
+                {
+                    for (uint32_t face = begin; face < end; ++face)
+                    {
+                        const uint32_t* v = &mesh.faceVertices[3 * face];
+                        const uint32_t* f = &mesh.faceNeighbors[3 * face];
+                        uint32_t* childVertices = &child.faceVertices[12 * face];
+                        uint32_t* childNeighbors = &child.faceNeighbors[12 * face];
+
+                        for (uint32_t j = 0; j < 3; ++j)
+                        {
+                            // Update children face indices for siblings.
+                            childNeighbors[3 * 3 + j] = 4 * face + next(j);
+                            childNeighbors[3 * j + next(j)] = 4 * face + 3;
+
+                            // Update children face indices for neighbor children.
+                            uint32_t f2 = f[j];
+                            childNeighbors[3 * j + j] = f2 != kInvalid ? 4 * f2 + mesh.vnum(f2, v[j]) : kInvalid;
+                            f2 = f[prev(j)];
+                            childNeighbors[3 * j + prev(j)] = f2 != kInvalid ? 4 * f2 + mesh.vnum(f2, v[j]) : kInvalid;
+
+                            // Update child vertex index to new even vertex.
+                            childVertices[3 * j + j] = v[j];
+
+                            // Update child vertex index to new odd vertex.
+                            uint32_t vert = oddVertices[3 * face + j];
+                            childVertices[3 * j + next(j)] = vert;
+                            childVertices[3 * next(j) + j] = vert;
+                            childVertices[3 * 3 + j] = vert;
+                        }
+                    }
+                },
+                kBlockSize
+            );
+
+            return child;
+        }
+    }
+
+    LoopSubdivideResult loopSubdivide(uint32_t levels, fstd::span<const float3> positions, fstd::span<const uint32_t> indices, BS::thread_pool* pThreadPool)
+    {
+        SubdivMesh mesh = createBaseMesh(positions, indices, pThreadPool);
+
+        for (uint32_t i = 0; i < levels; ++i)
+        {
+            if (mesh.faceVertices.size() > std::numeric_limits<uint32_t>::max() / 4)
+                FALCOR_THROW("Mesh is too large to subdivide {} times.", levels);
+            mesh = subdivide(mesh, pThreadPool);
+        }
+
+        const uint32_t vertexCount = mesh.getVertexCount();
+
+        // Push vertices to limit surface.
+        std::vector<float3> pLimit(vertexCount);
+        parallelFor(
+            pThreadPool,
+            vertexCount,
+            [&](uint32_t begin, uint32_t end)
+            {
+                std::vector<float3> ring;
+                for (uint32_t v = begin; v < end; ++v)
+                {
+                    if (mesh.boundary[v])
+                        pLimit[v] = mesh.weightBoundary(v, 1.f / 5.f, ring);
+                    else
+                        pLimit[v] = mesh.weightOneRing(v, loopGamma(mesh.valence(v)), ring);
+                }
+            },
+            kBlockSize
+        );
+        mesh.positions = std::move(pLimit);
+
+        // Compute vertex tangents on limit surface.
+        std::vector<float3> Ns(vertexCount);
+        parallelFor(
+            pThreadPool,
+            vertexCount,
+            [&](uint32_t begin, uint32_t end)
+            {
+                std::vector<float3> pRing;
+                for (uint32_t v = begin; v < end; ++v)
+                {
+                    float3 S(0.f);
+                    float3 T(0.f);
+                    mesh.oneRing(v, pRing);
+                    uint32_t valence = (uint32_t)pRing.size();
+                    const float3& p = mesh.positions[v];
+                    if (!mesh.boundary[v])
+                    {
+                        // Compute tangents of interior face.
+                        for (uint32_t j = 0; j < valence; ++j)
+                        {
+                            S += std::cos(2.f * float(M_PI) * j / valence) * float3(pRing[j]);
+                            T += std::sin(2.f * float(M_PI) * j / valence) * float3(pRing[j]);
+                        }
+                    }
+                    else
+                    {
+                        // Compute tangents of boundary face.
+                        S = pRing[valence - 1] - pRing[0];
+                        if (valence == 2)
+                        {
+                            T = float3(pRing[0] + pRing[1] - 2.f * p);
+                        }
+                        else if (valence == 3)
+                        {
+                            T = pRing[1] - p;
+                        }
+                        else if (valence == 4) // regular
+                        {
+                            T = float3(-1.f * pRing[0] + 2.f * pRing[1] + 2.f * pRing[2] + -1.f * pRing[3] + -2.f * p);
+                        }
+                        else
+                        {
+                            float theta = float(M_PI) / float(valence - 1);
+                            T = float3(std::sin(theta) * (pRing[0] + pRing[valence - 1]));
+                            for (uint32_t k = 1; k < valence - 1; ++k)
+                            {
+                                float wt = (2 * std::cos(theta) - 2) * std::sin((k)*theta);
+                                T += float3(wt * pRing[k]);
+                            }
+                            T = -T;
+                        }
+                    }
+                    Ns[v] = cross(S, T);
+                }
+            },
+            kBlockSize
+        );
+
+        LoopSubdivideResult result;
+        result.positions = std::move(mesh.positions);
+        result.normals = std::move(Ns);
+        result.indices = std::move(mesh.faceVertices);
+        return result;
+    }
+}
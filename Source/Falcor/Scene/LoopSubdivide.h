@@ -0,0 +1,77 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+
+// This code is based on pbrt:
+// pbrt is Copyright(c) 1998-2020 Matt Pharr, Wenzel Jakob, and Greg Humphreys.
+// The pbrt source code is licensed under the Apache License, Version 2.0.
+// SPDX: Apache-2.0
+
+#pragma once
+#include "Core/Macros.h"
+#include "Utils/Math/Vector.h"
+#include <fstd/span.h> // TODO C++20: Replace with <span>
+#include <vector>
+
+namespace BS
+{
+class thread_pool;
+}
+
+namespace Falcor
+{
+    struct LoopSubdivideResult
+    {
+        std::vector<float3> positions;      ///< Vertex positions on the limit surface.
+        std::vector<float3> normals;        ///< Vertex normals on the limit surface (not normalized).
+        std::vector<uint32_t> indices;      ///< Triangle list indices.
+    };
+
+    /** Subdivide a triangle mesh using Loop subdivision and push the vertices to the limit surface.
+
+        This is an array-based version of pbrt's implementation, which produces bit-identical results. Each level is
+        computed from flat face/vertex arrays: edges are deduplicated by sorting the face edges by their vertices, and
+        the vertices and faces of the next level are computed in parallel.
+
+        Vertices of the subdivided mesh are ordered as the vertices of the input mesh, followed by one vertex per edge
+        in the order in which the edges are first referenced by the faces. Each face is split into four faces,
+        which are stored consecutively in the order of the parent faces.
+
+        Throws a RuntimeError if the indices are invalid or a vertex is not referenced by any triangle.
+        \param[in] levels Number of subdivision levels.
+        \param[in] positions Vertex positions.
+        \param[in] indices Triangle list indices.
+        \param[in] pThreadPool Thread pool to use, or nullptr to subdivide on the calling thread.
+        \return The subdivided mesh.
+    */
+    FALCOR_API LoopSubdivideResult loopSubdivide(
+        uint32_t levels,
+        fstd::span<const float3> positions,
+        fstd::span<const uint32_t> indices,
+        BS::thread_pool* pThreadPool = nullptr
+    );
+}
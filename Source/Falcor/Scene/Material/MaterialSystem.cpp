@@ -322,6 +322,19 @@ namespace Falcor
         return mMaterials[materialID.get()];
     }
 
+    void MaterialSystem::reportTextureUsage(const MaterialID materialID, uint32_t mipLevel)
+    {
+        if (!mpTextureManager->isStreamingEnabled()) return;
+
+        const auto& pMaterial = getMaterial(materialID);
+        for (uint32_t slot = 0; slot < (uint32_t)Material::TextureSlot::Count; slot++)
+        {
+            // Streamed textures keep their handle when the resident texture is replaced, so the material's texture is looked up.
+            if (auto pTexture = pMaterial->getTexture((Material::TextureSlot)slot))
+                mpTextureManager->reportTextureUsage(mpTextureManager->addTexture(pTexture), mipLevel);
+        }
+    }
+
     ref<Material> MaterialSystem::getMaterialByName(const std::string& name) const
     {
         for (const auto& pMaterial : mMaterials)
@@ -478,6 +491,10 @@ namespace Falcor
                 updateMaterial(materialID);
         }
 
+        // Promote and evict mip levels of streamed textures. Replaced textures need to be rebound.
+        if (mpTextureManager->updateStreaming())
+            updateFlags |= Material::UpdateFlags::ResourcesChanged;
+
         // Include updates recorded since last update.
         // After this point no more material changes are expected.
         updateFlags |= mMaterialUpdates;
@@ -635,6 +652,16 @@ namespace Falcor
         s.textureTexelCount = textureStats.textureTexelCount;
         s.textureTexelChannelCount = textureStats.textureTexelChannelCount;
         s.textureMemoryInBytes = textureStats.textureMemoryInBytes;
+        s.streamedTextureCount = textureStats.streamedTextureCount;
+        s.textureStreamingResidentBytes = textureStats.streamingResidentBytes;
+        s.textureStreamingRequestedBytes = textureStats.streamingRequestedBytes;
+        s.textureStreamingBudgetBytes = textureStats.streamingBudgetBytes;
+        s.textureLoadCompletedCount = textureStats.asyncLoadCompletedCount;
+        s.textureLoadCancelledCount = textureStats.asyncLoadCancelledCount;
+        s.textureLoadMissedDeadlineCount = textureStats.asyncLoadMissedDeadlineCount;
+        s.textureLoadMaxBytesInFlight = textureStats.asyncLoadMaxBytesInFlight;
+        s.textureLoadAverageLatency = textureStats.asyncLoadAverageLatency;
+        s.textureLoadMaxLatency = textureStats.asyncLoadMaxLatency;
 
         return s;
     }
@@ -59,15 +59,25 @@ namespace Falcor
     public:
         struct MaterialStats
         {
-            uint64_t materialTypeCount = 0;             ///< Number of material types.
-            uint64_t materialCount = 0;                 ///< Number of materials.
-            uint64_t materialOpaqueCount = 0;           ///< Number of materials that are opaque.
-            uint64_t materialMemoryInBytes = 0;         ///< Total memory in bytes used by the material data.
-            uint64_t textureCount = 0;                  ///< Number of unique textures. A texture can be referenced by multiple materials.
-            uint64_t textureCompressedCount = 0;        ///< Number of unique compressed textures.
-            uint64_t textureTexelCount = 0;             ///< Total number of texels in all textures.
-            uint64_t textureTexelChannelCount = 0;      ///< Total number of texel channels in all textures.
-            uint64_t textureMemoryInBytes = 0;          ///< Total memory in bytes used by the textures.
+            uint64_t materialTypeCount = 0;              ///< Number of material types.
+            uint64_t materialCount = 0;                  ///< Number of materials.
+            uint64_t materialOpaqueCount = 0;            ///< Number of materials that are opaque.
+            uint64_t materialMemoryInBytes = 0;          ///< Total memory in bytes used by the material data.
+            uint64_t textureCount = 0;                   ///< Number of unique textures. A texture can be referenced by multiple materials.
+            uint64_t textureCompressedCount = 0;         ///< Number of unique compressed textures.
+            uint64_t textureTexelCount = 0;              ///< Total number of texels in all textures.
+            uint64_t textureTexelChannelCount = 0;       ///< Total number of texel channels in all textures.
+            uint64_t textureMemoryInBytes = 0;           ///< Total memory in bytes used by the textures.
+            uint64_t streamedTextureCount = 0;           ///< Number of streamed textures.
+            uint64_t textureStreamingResidentBytes = 0;  ///< Size of the resident mip levels of streamed textures in bytes.
+            uint64_t textureStreamingRequestedBytes = 0; ///< Size of the mip levels of streamed textures that are resident or wanted in bytes.
+            uint64_t textureStreamingBudgetBytes = 0;    ///< Memory budget for streamed textures in bytes.
+            uint64_t textureLoadCompletedCount = 0;      ///< Number of completed asynchronous texture loads.
+            uint64_t textureLoadCancelledCount = 0;      ///< Number of cancelled asynchronous texture loads.
+            uint64_t textureLoadMissedDeadlineCount = 0; ///< Number of asynchronous texture loads completed after their deadline.
+            uint64_t textureLoadMaxBytesInFlight = 0;    ///< Maximum size of decoded texture data waiting to be uploaded in bytes.
+            double textureLoadAverageLatency = 0.0;      ///< Average time in seconds from request to completion of asynchronous texture loads.
+            double textureLoadMaxLatency = 0.0;          ///< Maximum time in seconds from request to completion of asynchronous texture loads.
         };
 
         /** Constructor. Throws an exception if creation failed.
@@ -231,6 +241,14 @@ namespace Falcor
         */
         ref<Material> getMaterialByName(const std::string& name) const;
 
+        /** Report that the textures of a material were sampled in the current frame.
+            This drives which mip levels of streamed textures are resident, see TextureManager::reportTextureUsage().
+            The usage is applied by the next call to update().
+            \param[in] materialID The material ID.
+            \param[in] mipLevel Most detailed mip level sampled from the textures.
+        */
+        void reportTextureUsage(const MaterialID materialID, uint32_t mipLevel);
+
         /** Remove all duplicate materials.
             \param[in] idMap Vector that holds for each material the ID of the material that replaces it.
             \return The number of materials removed.
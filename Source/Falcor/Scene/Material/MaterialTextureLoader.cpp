@@ -30,6 +30,23 @@
 
 namespace Falcor
 {
+    namespace
+    {
+        int32_t getLoadPriority(Material::TextureSlot slot)
+        {
+            switch (slot)
+            {
+            case Material::TextureSlot::Displacement:
+                return 2;
+            case Material::TextureSlot::BaseColor:
+            case Material::TextureSlot::Normal:
+                return 1;
+            default:
+                return 0;
+            }
+        }
+    }
+
     MaterialTextureLoader::MaterialTextureLoader(TextureManager& textureManager, bool useSrgb)
         : mUseSrgb(useSrgb)
         , mTextureManager(textureManager)
@@ -52,6 +69,10 @@ namespace Falcor
 
         bool srgb = mUseSrgb && pMaterial->getTextureSlotInfo(slot).srgb;
 
+        AsyncTextureLoader::LoadOptions loadOptions;
+        loadOptions.priority = getLoadPriority(slot);
+        loadOptions.cancellationToken = mCancellationToken;
+
         // Request texture to be loaded.
         auto handle = mTextureManager.loadTexture(
             path,
@@ -62,13 +83,21 @@ namespace Falcor
             Bitmap::ImportFlags::None,
             nullptr /*search dirs*/,
             nullptr /*load count*/,
-            pMaterial.get()
+            pMaterial.get(),
+            loadOptions
         );
 
         // Store assignment to material for later.
         mTextureAssignments.emplace_back(TextureAssignment{ pMaterial, slot, handle });
     }
 
+    void MaterialTextureLoader::cancel()
+    {
+        mCancellationToken.cancel();
+        mTextureManager.waitForAllTexturesLoading();
+        mTextureAssignments.clear();
+    }
+
     void MaterialTextureLoader::assignTextures()
     {
         mTextureManager.waitForAllTexturesLoading();
@@ -41,6 +41,9 @@ namespace Falcor
         material assignment is stored. When the client destroys the instance of the
         `MaterialTextureLoader`, it blocks until all textures are loaded and assigns
         them to the materials.
+
+        Textures that affect the geometry (displacement) are loaded first, followed by
+        the textures with the largest visual impact (base color and normals).
     */
     class FALCOR_API MaterialTextureLoader
     {
@@ -59,6 +62,12 @@ namespace Falcor
         {
             assignTextures();
         }
+
+        /** Cancel the pending load requests and drop all texture assignments.
+            Blocks until the requests in progress have finished.
+        */
+        void cancel();
+
     private:
         void assignTextures();
 
@@ -70,6 +79,7 @@ namespace Falcor
         };
 
         bool mUseSrgb;
+        AsyncTextureLoader::CancellationToken mCancellationToken;
         std::vector<TextureAssignment> mTextureAssignments;
         TextureManager& mTextureManager;
     };
@@ -0,0 +1,560 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "PlyMesh.h"
+#include "Core/Error.h"
+#include "Core/Platform/MemoryMappedFile.h"
+#include "Core/Platform/OS.h"
+#include "Utils/StringFormatters.h"
+#include <fast_float/fast_float.h>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace Falcor
+{
+    namespace
+    {
+        enum class Format
+        {
+            Ascii,
+            BinaryLittleEndian,
+            BinaryBigEndian,
+        };
+
+        enum class ScalarType
+        {
+            Int8,
+            UInt8,
+            Int16,
+            UInt16,
+            Int32,
+            UInt32,
+            Float32,
+            Float64,
+        };
+
+        struct Property
+        {
+            std::string name;
+            ScalarType type = ScalarType::Float32;  ///< Type of the value, or of the list items.
+            bool isList = false;
+            ScalarType countType = ScalarType::UInt8;
+        };
+
+        struct Element
+        {
+            std::string name;
+            size_t count = 0;
+            std::vector<Property> properties;
+        };
+
+        struct Header
+        {
+            Format format = Format::Ascii;
+            std::vector<Element> elements;
+            size_t dataOffset = 0;
+        };
+
+        /** Vertex attribute components stored in PLY properties.
+        */
+        enum class VertexComponent
+        {
+            None,
+            X, Y, Z,
+            NX, NY, NZ,
+            U, V,
+        };
+
+        bool parseScalarType(std::string_view name, ScalarType& type)
+        {
+            if (name == "char" || name == "int8") type = ScalarType::Int8;
+            else if (name == "uchar" || name == "uint8") type = ScalarType::UInt8;
+            else if (name == "short" || name == "int16") type = ScalarType::Int16;
+            else if (name == "ushort" || name == "uint16") type = ScalarType::UInt16;
+            else if (name == "int" || name == "int32") type = ScalarType::Int32;
+            else if (name == "uint" || name == "uint32") type = ScalarType::UInt32;
+            else if (name == "float" || name == "float32") type = ScalarType::Float32;
+            else if (name == "double" || name == "float64") type = ScalarType::Float64;
+            else return false;
+            return true;
+        }
+
+        size_t getScalarSize(ScalarType type)
+        {
+            switch (type)
+            {
+            case ScalarType::Int8:
+            case ScalarType::UInt8:
+                return 1;
+            case ScalarType::Int16:
+            case ScalarType::UInt16:
+                return 2;
+            case ScalarType::Int32:
+            case ScalarType::UInt32:
+            case ScalarType::Float32:
+                return 4;
+            case ScalarType::Float64:
+                return 8;
+            }
+            FALCOR_UNREACHABLE();
+        }
+
+        std::vector<std::string_view> splitTokens(std::string_view line)
+        {
+            std::vector<std::string_view> tokens;
+            size_t pos = 0;
+            while (true)
+            {
+                pos = line.find_first_not_of(" \t\r", pos);
+                if (pos == std::string_view::npos) break;
+                size_t end = line.find_first_of(" \t\r", pos);
+                if (end == std::string_view::npos) end = line.size();
+                tokens.push_back(line.substr(pos, end - pos));
+                pos = end;
+            }
+            return tokens;
+        }
+
+        Header parseHeader(const char* pData, size_t size)
+        {
+            Header header;
+            size_t pos = 0;
+            bool hasFormat = false;
+
+            auto readLine = [&]()
+            {
+                size_t end = std::string_view(pData, size).find('\n', pos);
+                if (end == std::string_view::npos) FALCOR_THROW("Unexpected end of header.");
+                std::string_view line(pData + pos, end - pos);
+                pos = end + 1;
+                return line;
+            };
+
+            auto tokens = splitTokens(readLine());
+            if (tokens.size() != 1 || tokens[0] != "ply") FALCOR_THROW("Missing 'ply' magic.");
+
+            while (true)
+            {
+                tokens = splitTokens(readLine());
+                if (tokens.empty() || tokens[0] == "comment" || tokens[0] == "obj_info") continue;
+
+                if (tokens[0] == "end_header")
+                {
+                    break;
+                }
+                else if (tokens[0] == "format" && tokens.size() == 3)
+                {
+                    if (tokens[1] == "ascii") header.format = Format::Ascii;
+                    else if (tokens[1] == "binary_little_endian") header.format = Format::BinaryLittleEndian;
+                    else if (tokens[1] == "binary_big_endian") header.format = Format::BinaryBigEndian;
+                    else FALCOR_THROW("Unknown format '{}'.", tokens[1]);
+                    hasFormat = true;
+                }
+                else if (tokens[0] == "element" && tokens.size() == 3)
+                {
+                    Element element;
+                    element.name = tokens[1];
+                    auto result = std::from_chars(tokens[2].data(), tokens[2].data() + tokens[2].size(), element.count);
+                    if (result.ec != std::errc()) FALCOR_THROW("Invalid element count '{}'.", tokens[2]);
+                    header.elements.push_back(std::move(element));
+                }
+                else if (tokens[0] == "property" && !header.elements.empty())
+                {
+                    Property property;
+                    bool valid = false;
+                    if (tokens.size() == 3)
+                    {
+                        valid = parseScalarType(tokens[1], property.type);
+                        property.name = tokens[2];
+                    }
+                    else if (tokens.size() == 5 && tokens[1] == "list")
+                    {
+                        property.isList = true;
+                        valid = parseScalarType(tokens[2], property.countType) && parseScalarType(tokens[3], property.type);
+                        property.name = tokens[4];
+                    }
+                    if (!valid) FALCOR_THROW("Invalid property '{}'.", std::string_view(tokens.front().data(), tokens.back().data() + tokens.back().size() - tokens.front().data()));
+                    header.elements.back().properties.push_back(std::move(property));
+                }
+                else
+                {
+                    FALCOR_THROW("Invalid header line starting with '{}'.", tokens[0]);
+                }
+            }
+
+            if (!hasFormat) FALCOR_THROW("Missing format.");
+            header.dataOffset = pos;
+            return header;
+        }
+
+        /** Reads scalars from binary data, optionally swapping the byte order.
+        */
+        template<bool SwapBytes>
+        class BinaryReader
+        {
+        public:
+            BinaryReader(const char* pData, const char* pEnd) : mpData(pData), mpEnd(pEnd) {}
+
+            template<typename T>
+            T read(ScalarType type)
+            {
+                switch (type)
+                {
+                case ScalarType::Int8: return (T)load<int8_t>();
+                case ScalarType::UInt8: return (T)load<uint8_t>();
+                case ScalarType::Int16: return (T)load<int16_t>();
+                case ScalarType::UInt16: return (T)load<uint16_t>();
+                case ScalarType::Int32: return (T)load<int32_t>();
+                case ScalarType::UInt32: return (T)load<uint32_t>();
+                case ScalarType::Float32: return (T)load<float>();
+                case ScalarType::Float64: return (T)load<double>();
+                }
+                FALCOR_UNREACHABLE();
+            }
+
+            void skip(ScalarType type, size_t count)
+            {
+                if (count > getMaxCount(getScalarSize(type))) FALCOR_THROW("Unexpected end of data.");
+                mpData += getScalarSize(type) * count;
+            }
+
+            /** Get the minimum size of a value in the data.
+            */
+            static size_t getMinValueSize(ScalarType type) { return getScalarSize(type); }
+
+            /** Get the maximum number of items of the given minimum size that fit in the remaining data.
+            */
+            size_t getMaxCount(size_t minSize) const { return size_t(mpEnd - mpData) / minSize; }
+
+        private:
+            template<typename T>
+            T load()
+            {
+                if (size_t(mpEnd - mpData) < sizeof(T)) FALCOR_THROW("Unexpected end of data.");
+                char bytes[sizeof(T)];
+                if constexpr (SwapBytes)
+                {
+                    for (size_t i = 0; i < sizeof(T); ++i) bytes[i] = mpData[sizeof(T) - 1 - i];
+                }
+                else
+                {
+                    std::memcpy(bytes, mpData, sizeof(T));
+                }
+                mpData += sizeof(T);
+                T value;
+                std::memcpy(&value, bytes, sizeof(T));
+                return value;
+            }
+
+            const char* mpData;
+            const char* mpEnd;
+        };
+
+        /** Reads scalars from whitespace separated ASCII data.
+        */
+        class AsciiReader
+        {
+        public:
+            AsciiReader(const char* pData, const char* pEnd) : mpData(pData), mpEnd(pEnd) {}
+
+            template<typename T>
+            T read(ScalarType)
+            {
+                while (mpData < mpEnd && std::isspace((unsigned char)*mpData)) ++mpData;
+                if (mpData < mpEnd && *mpData == '+') ++mpData;
+                double value = 0.0;
+                auto result = fast_float::from_chars(mpData, mpEnd, value);
+                if (result.ec != std::errc()) FALCOR_THROW("Invalid or missing value.");
+                mpData = result.ptr;
+                return (T)value;
+            }
+
+            void skip(ScalarType type, size_t count)
+            {
+                for (size_t i = 0; i < count; ++i) read<double>(type);
+            }
+
+            /** Get the minimum size of a value in the data, a digit followed by a separator.
+            */
+            static size_t getMinValueSize(ScalarType) { return 2; }
+
+            /** Get the maximum number of items of the given minimum size that fit in the remaining data.
+                The last value does not need a separator.
+            */
+            size_t getMaxCount(size_t minSize) const { return (size_t(mpEnd - mpData) + 1) / minSize; }
+
+        private:
+            const char* mpData;
+            const char* mpEnd;
+        };
+
+        VertexComponent getVertexComponent(const std::string& name)
+        {
+            if (name == "x") return VertexComponent::X;
+            if (name == "y") return VertexComponent::Y;
+            if (name == "z") return VertexComponent::Z;
+            if (name == "nx") return VertexComponent::NX;
+            if (name == "ny") return VertexComponent::NY;
+            if (name == "nz") return VertexComponent::NZ;
+            if (name == "u" || name == "s" || name == "texture_u" || name == "texture_s") return VertexComponent::U;
+            if (name == "v" || name == "t" || name == "texture_v" || name == "texture_t") return VertexComponent::V;
+            return VertexComponent::None;
+        }
+
+        /** Read the number of items of a list property.
+            Throws if the count is negative or if the items can't fit in the remaining data, so that corrupt counts
+            are reported as errors instead of failing allocations.
+        */
+        template<typename Reader>
+        size_t readListCount(Reader& reader, const Property& property)
+        {
+            double count = reader.template read<double>(property.countType);
+            if (!(count >= 0.0) || count != std::floor(count)) FALCOR_THROW("Invalid list count {}.", count);
+            if (count > (double)reader.getMaxCount(Reader::getMinValueSize(property.type)))
+                FALCOR_THROW("List count {} exceeds the remaining data.", count);
+            return (size_t)count;
+        }
+
+        /** Check that an element count fits in the remaining data before allocating storage for it.
+        */
+        template<typename Reader>
+        void checkElementCount(const Reader& reader, const Element& element)
+        {
+            size_t minSize = 0;
+            for (const auto& property : element.properties)
+                minSize += Reader::getMinValueSize(property.isList ? property.countType : property.type);
+            if (minSize > 0 && element.count > reader.getMaxCount(minSize))
+                FALCOR_THROW("Element '{}' count {} exceeds the remaining data.", element.name, element.count);
+        }
+
+        template<typename Reader>
+        void skipProperty(Reader& reader, const Property& property)
+        {
+            size_t count = property.isList ? readListCount(reader, property) : 1;
+            reader.skip(property.type, count);
+        }
+
+        template<typename Reader>
+        void readVertices(Reader& reader, const Element& element, PlyMesh& mesh)
+        {
+            std::vector<VertexComponent> components;
+            uint32_t mask = 0;
+            for (const auto& property : element.properties)
+            {
+                auto component = property.isList ? VertexComponent::None : getVertexComponent(property.name);
+                components.push_back(component);
+                mask |= 1u << (uint32_t)component;
+            }
+
+            auto hasComponents = [&](std::initializer_list<VertexComponent> list)
+            {
+                for (auto c : list) if (!(mask & (1u << (uint32_t)c))) return false;
+                return true;
+            };
+            if (!hasComponents({ VertexComponent::X, VertexComponent::Y, VertexComponent::Z })) FALCOR_THROW("Missing vertex positions.");
+            const bool hasNormals = hasComponents({ VertexComponent::NX, VertexComponent::NY, VertexComponent::NZ });
+            const bool hasTexCoords = hasComponents({ VertexComponent::U, VertexComponent::V });
+
+            checkElementCount(reader, element);
+            mesh.positions.resize(element.count);
+            if (hasNormals) mesh.normals.resize(element.count);
+            if (hasTexCoords) mesh.texCoords.resize(element.count);
+
+            float3 dummyNormal;
+            float2 dummyTexCoord;
+            for (size_t i = 0; i < element.count; ++i)
+            {
+                float3& position = mesh.positions[i];
+                float3& normal = hasNormals ? mesh.normals[i] : dummyNormal;
+                float2& texCoord = hasTexCoords ? mesh.texCoords[i] : dummyTexCoord;
+
+                for (size_t j = 0; j < components.size(); ++j)
+                {
+                    const auto& property = element.properties[j];
+                    switch (components[j])
+                    {
+                    case VertexComponent::X: position.x = reader.template read<float>(property.type); break;
+                    case VertexComponent::Y: position.y = reader.template read<float>(property.type); break;
+                    case VertexComponent::Z: position.z = reader.template read<float>(property.type); break;
+                    case VertexComponent::NX: normal.x = reader.template read<float>(property.type); break;
+                    case VertexComponent::NY: normal.y = reader.template read<float>(property.type); break;
+                    case VertexComponent::NZ: normal.z = reader.template read<float>(property.type); break;
+                    case VertexComponent::U: texCoord.x = reader.template read<float>(property.type); break;
+                    case VertexComponent::V: texCoord.y = reader.template read<float>(property.type); break;
+                    default: skipProperty(reader, property); break;
+                    }
+                }
+            }
+        }
+
+        template<typename Reader>
+        void readFaces(Reader& reader, const Element& element, PlyMesh& mesh)
+        {
+            size_t indicesProperty = element.properties.size();
+            for (size_t j = 0; j < element.properties.size(); ++j)
+            {
+                const auto& property = element.properties[j];
+                if (property.isList && (property.name == "vertex_indices" || property.name == "vertex_index")) indicesProperty = j;
+            }
+            if (indicesProperty == element.properties.size()) FALCOR_THROW("Missing face vertex indices.");
+            checkElementCount(reader, element);
+
+            // Most meshes are made of triangles and quads.
+            mesh.indices.reserve(mesh.indices.size() + element.count * 3);
+
+            std::vector<uint32_t> polygon;
+            for (size_t i = 0; i < element.count; ++i)
+            {
+                for (size_t j = 0; j < element.properties.size(); ++j)
+                {
+                    const auto& property = element.properties[j];
+                    if (j != indicesProperty)
+                    {
+                        skipProperty(reader, property);
+                        continue;
+                    }
+
+                    size_t count = readListCount(reader, property);
+                    polygon.resize(count);
+                    for (size_t k = 0; k < count; ++k) polygon[k] = reader.template read<uint32_t>(property.type);
+
+                    // Triangulate as a fan.
+                    for (size_t k = 2; k < count; ++k)
+                    {
+                        mesh.indices.push_back(polygon[0]);
+                        mesh.indices.push_back(polygon[k - 1]);
+                        mesh.indices.push_back(polygon[k]);
+                    }
+                }
+            }
+        }
+
+        template<typename Reader>
+        void readBody(Reader& reader, const Header& header, PlyMesh& mesh)
+        {
+            bool hasVertices = false;
+            for (const auto& element : header.elements)
+            {
+                if (element.name == "vertex")
+                {
+                    readVertices(reader, element, mesh);
+                    hasVertices = true;
+                }
+                else if (element.name == "face")
+                {
+                    readFaces(reader, element, mesh);
+                }
+                else if (!element.properties.empty())
+                {
+                    for (size_t i = 0; i < element.count; ++i)
+                    {
+                        for (const auto& property : element.properties) skipProperty(reader, property);
+                    }
+                }
+            }
+            if (!hasVertices) FALCOR_THROW("Missing vertex element.");
+        }
+    }
+
+    std::vector<float3> PlyMesh::computeFaceNormals() const
+    {
+        std::vector<float3> faceNormals(getTriangleCount());
+        for (size_t i = 0; i < faceNormals.size(); ++i)
+        {
+            const float3& p0 = positions[indices[i * 3 + 0]];
+            const float3& p1 = positions[indices[i * 3 + 1]];
+            const float3& p2 = positions[indices[i * 3 + 2]];
+            float3 n = cross(p1 - p0, p2 - p0);
+            float len = length(n);
+            faceNormals[i] = len > 0.f ? n / len : float3(0.f);
+        }
+        return faceNormals;
+    }
+
+    PlyMesh PlyMesh::createFromFile(const std::filesystem::path& path)
+    {
+        try
+        {
+            if (hasExtension(path, "gz"))
+            {
+                std::string data = decompressFile(path);
+                return createFromMemory(data.data(), data.size());
+            }
+
+            MemoryMappedFile file(path, MemoryMappedFile::kWholeFile, MemoryMappedFile::AccessHint::SequentialScan);
+            if (!file.isOpen()) FALCOR_THROW("Failed to open file.");
+            return createFromMemory(file.getData(), file.getSize());
+        }
+        catch (const RuntimeError& e)
+        {
+            FALCOR_THROW("Failed to load PLY file '{}': {}", path, e.what());
+        }
+    }
+
+    PlyMesh PlyMesh::createFromMemory(const void* pData, size_t size)
+    {
+        const char* pChars = static_cast<const char*>(pData);
+        Header header = parseHeader(pChars, size);
+
+        PlyMesh mesh;
+        const char* pBody = pChars + header.dataOffset;
+        const char* pEnd = pChars + size;
+        switch (header.format)
+        {
+        case Format::Ascii:
+        {
+            AsciiReader reader(pBody, pEnd);
+            readBody(reader, header, mesh);
+            break;
+        }
+        case Format::BinaryLittleEndian:
+        {
+            BinaryReader<false> reader(pBody, pEnd);
+            readBody(reader, header, mesh);
+            break;
+        }
+        case Format::BinaryBigEndian:
+        {
+            BinaryReader<true> reader(pBody, pEnd);
+            readBody(reader, header, mesh);
+            break;
+        }
+        }
+
+        const uint32_t vertexCount = mesh.getVertexCount();
+        for (uint32_t index : mesh.indices)
+        {
+            if (index >= vertexCount) FALCOR_THROW("Vertex index {} out of range (vertex count is {}).", index, vertexCount);
+        }
+
+        return mesh;
+    }
+}
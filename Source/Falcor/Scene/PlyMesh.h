@@ -0,0 +1,80 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/Macros.h"
+#include "Utils/Math/Vector.h"
+#include <filesystem>
+#include <vector>
+
+namespace Falcor
+{
+    /** Triangle mesh loaded from a PLY file.
+
+        This is a lightweight alternative to loading PLY files through Assimp. The file is memory-mapped and parsed in
+        a single pass into flat attribute arrays, which can be passed to SceneBuilder::addMesh() without conversion.
+        ASCII, binary little-endian and binary big-endian files are supported, optionally gzip compressed.
+
+        Vertex attributes are read from the properties x/y/z, nx/ny/nz and u/v (or s/t, texture_u/texture_v,
+        texture_s/texture_t) of the "vertex" element. Faces are read from the vertex_indices (or vertex_index) list
+        property of the "face" element. Polygons are triangulated as fans, which splits quads into the triangles
+        (0, 1, 2) and (0, 2, 3). All other elements and properties are ignored.
+
+        Loading is thread-safe, so many files can be loaded in parallel.
+    */
+    struct FALCOR_API PlyMesh
+    {
+        std::vector<float3> positions;      ///< Vertex positions.
+        std::vector<float3> normals;        ///< Vertex normals, or empty if the file has none.
+        std::vector<float2> texCoords;      ///< Vertex texture coordinates as stored in the file, or empty if the file has none.
+        std::vector<uint32_t> indices;      ///< Triangle list indices.
+
+        uint32_t getVertexCount() const { return (uint32_t)positions.size(); }
+        uint32_t getTriangleCount() const { return (uint32_t)(indices.size() / 3); }
+
+        /** Compute a normal for each triangle, e.g. for meshes without vertex normals.
+            Degenerate triangles get a zero normal.
+            \return List of normals, one per triangle.
+        */
+        std::vector<float3> computeFaceNormals() const;
+
+        /** Load a mesh from a PLY file. Files with extension ".gz" are decompressed first.
+            Throws a RuntimeError if the file cannot be read or is invalid.
+            \param[in] path File path.
+            \return The mesh.
+        */
+        static PlyMesh createFromFile(const std::filesystem::path& path);
+
+        /** Load a mesh from PLY data in memory.
+            Throws a RuntimeError if the data is invalid.
+            \param[in] pData Pointer to the data.
+            \param[in] size Size of the data in bytes.
+            \return The mesh.
+        */
+        static PlyMesh createFromMemory(const void* pData, size_t size);
+    };
+}
@@ -67,6 +67,9 @@ namespace Falcor
         // The target is max 0.5GB intermediate memory per BLAS group. Note that this is not a strict limit.
         const size_t kMaxBLASBuildMemory = 1ull << 29;
 
+        // Maximum number of unchanged geometry instances between two changed ones that are uploaded together.
+        const uint32_t kMaxInstanceUploadGap = 16;
+
         const std::string kParameterBlockName = "gScene";
         const std::string kGeometryInstanceBufferName = "geometryInstances";
         const std::string kMeshBufferName = "meshes";
@@ -165,6 +168,9 @@ namespace Falcor
     Scene::Scene(ref<Device> pDevice, SceneData&& sceneData)
         : mpDevice(pDevice)
     {
+        // Decode the geometry arrays of scenes loaded from a scene cache.
+        if (sceneData.pGeometryFile) SceneCache::loadGeometry(sceneData);
+
         // Copy/move scene data to member variables.
         mPath = sceneData.path;
         mRenderSettings = sceneData.renderSettings;
@@ -187,6 +193,11 @@ namespace Falcor
         mGeometryInstanceData.insert(std::end(mGeometryInstanceData), std::begin(sceneData.curveInstanceData), std::end(sceneData.curveInstanceData));
         mGeometryInstanceData.insert(std::end(mGeometryInstanceData), std::begin(sceneData.sdfGridInstances), std::end(sceneData.sdfGridInstances));
 
+        // Map scene graph nodes to the instances they transform, for finding the instances moved by animations.
+        std::vector<uint32_t> instanceNodeIDs(mGeometryInstanceData.size());
+        for (size_t i = 0; i < instanceNodeIDs.size(); i++) instanceNodeIDs[i] = mGeometryInstanceData[i].globalMatrixID;
+        mNodeInstanceMap = NodeItemMap(instanceNodeIDs, (uint32_t)mSceneGraph.size());
+
         mMeshDesc = std::move(sceneData.meshDesc);
         mMeshNames = std::move(sceneData.meshNames);
         mMeshBBs = std::move(sceneData.meshBBs);
@@ -242,11 +253,12 @@ namespace Falcor
         for (const auto &mesh : sceneData.cachedMeshes)
         {
             if (!mMeshDesc[mesh.meshID.get()].isAnimated()) FALCOR_THROW("Cached Mesh Animation: Referenced mesh ID is not dynamic");
-            if (mesh.timeSamples.size() != mesh.vertexData.size()) FALCOR_THROW("Cached Mesh Animation: Time sample count mismatch.");
+            if (mesh.timeSamples.size() != mesh.getKeyframeCount()) FALCOR_THROW("Cached Mesh Animation: Time sample count mismatch.");
             for (const auto &vertices : mesh.vertexData)
             {
                 if (vertices.size() != mMeshDesc[mesh.meshID.get()].vertexCount) FALCOR_THROW("Cached Mesh Animation: Vertex count mismatch.");
             }
+            if (mesh.vertexData.empty() && mesh.getKeyframeCount() > 0 && mesh.getVertexCount() != mMeshDesc[mesh.meshID.get()].vertexCount) FALCOR_THROW("Cached Mesh Animation: Vertex count mismatch.");
         }
         for (const auto& cache : sceneData.cachedCurves)
         {
@@ -257,7 +269,7 @@ namespace Falcor
         }
 
         // Must be placed after curve data/AABB creation.
-        mpAnimationController->addAnimatedVertexCaches(std::move(sceneData.cachedCurves), std::move(sceneData.cachedMeshes), sceneData.meshStaticData);
+        mpAnimationController->addAnimatedVertexCaches(std::move(sceneData.cachedCurves), std::move(sceneData.cachedMeshes), sceneData.meshStaticData, sceneData.vertexCacheStreaming);
 
         // Finalize scene.
         finalize();
@@ -273,6 +285,22 @@ namespace Falcor
         return ref<Scene>(new Scene(pDevice, std::move(sceneData)));
     }
 
+    std::vector<float4x4> Scene::computeGlobalMatrices(const std::vector<Node>& sceneGraph)
+    {
+        // Parent nodes are stored before their children, see AnimationController::updateWorldMatrices().
+        std::vector<float4x4> globalMatrices(sceneGraph.size());
+        for (size_t i = 0; i < sceneGraph.size(); ++i)
+        {
+            globalMatrices[i] = sceneGraph[i].transform;
+            if (sceneGraph[i].parent != NodeID::Invalid())
+            {
+                FALCOR_CHECK(sceneGraph[i].parent.get() < i, "Scene graph node {} is stored before its parent.", i);
+                globalMatrices[i] = mul(globalMatrices[sceneGraph[i].parent.get()], globalMatrices[i]);
+            }
+        }
+        return globalMatrices;
+    }
+
     void Scene::updateSceneDefines()
     {
         DefineList defines;
@@ -920,9 +948,11 @@ namespace Falcor
 
         bool dataChanged = false;
         const auto& globalMatrices = mpAnimationController->getGlobalMatrices();
+        mInstanceUploadIndices.clear();
 
-        for (auto& inst : mGeometryInstanceData)
+        auto updateInstance = [&](uint32_t instanceID)
         {
+            auto& inst = mGeometryInstanceData[instanceID];
             if (inst.getType() == GeometryType::TriangleMesh || inst.getType() == GeometryType::DisplacedTriangleMesh)
             {
                 uint32_t prevFlags = inst.flags;
@@ -942,15 +972,34 @@ namespace Falcor
                 if (isWorldFrontFaceCW) inst.flags |= (uint32_t)GeometryInstanceFlags::IsWorldFrontFaceCW;
                 else inst.flags &= ~(uint32_t)GeometryInstanceFlags::IsWorldFrontFaceCW;
 
-                dataChanged |= (inst.flags != prevFlags);
+                if (inst.flags != prevFlags)
+                {
+                    mInstanceUploadIndices.push_back(instanceID);
+                    dataChanged = true;
+                }
             }
-        }
+        };
 
-        if (forceUpdate || dataChanged)
+        if (forceUpdate)
         {
+            for (uint32_t instanceID = 0; instanceID < (uint32_t)mGeometryInstanceData.size(); instanceID++) updateInstance(instanceID);
+
             uint32_t byteSize = (uint32_t)(mGeometryInstanceData.size() * sizeof(GeometryInstanceData));
             mpGeometryInstancesBuffer->setBlob(mGeometryInstanceData.data(), 0, byteSize);
+            mSceneStats.instanceUploadRangeCount = 1;
+            return;
+        }
+
+        // Only the instances moved in this update can have changed flags. Upload the changed instances in merged ranges.
+        for (uint32_t instanceID : mMovedInstances) updateInstance(instanceID);
+        if (!dataChanged) return;
+
+        computeUploadRanges(mInstanceUploadIndices, kMaxInstanceUploadGap, mInstanceUploadRanges);
+        for (const auto& range : mInstanceUploadRanges)
+        {
+            mpGeometryInstancesBuffer->setBlob(&mGeometryInstanceData[range.offset], range.offset * sizeof(GeometryInstanceData), range.count * sizeof(GeometryInstanceData));
         }
+        mSceneStats.instanceUploadRangeCount = mInstanceUploadRanges.size();
     }
 
     Scene::UpdateFlags Scene::updateRaytracingAABBData(bool forceUpdate)
@@ -1860,6 +1909,8 @@ namespace Falcor
 
     Scene::UpdateFlags Scene::update(RenderContext* pRenderContext, double currentTime)
     {
+        FALCOR_PROFILE(pRenderContext, "updateScene");
+
         // Run scene update callback.
         if (mUpdateCallback) mUpdateCallback(ref<Scene>(this), currentTime);
 
@@ -1888,24 +1939,29 @@ namespace Falcor
             bindParameterBlock();
         }
 
+        mMovedInstances.clear();
         if (mpAnimationController->animate(pRenderContext, currentTime))
         {
             mUpdates |= UpdateFlags::SceneGraphChanged;
             if (mpAnimationController->hasSkinnedMeshes()) mUpdates |= UpdateFlags::MeshesChanged;
 
-            for (const auto& inst : mGeometryInstanceData)
-            {
-                if (mpAnimationController->isMatrixChanged(NodeID{ inst.globalMatrixID }))
-                {
-                    mUpdates |= UpdateFlags::GeometryMoved;
-                }
-            }
+            // Find the instances transformed by the changed matrices.
+            mNodeInstanceMap.appendItems(mpAnimationController->getChangedMatrices(), mMovedInstances);
+            if (!mMovedInstances.empty()) mUpdates |= UpdateFlags::GeometryMoved;
 
             // We might end up setting the flag even if curves haven't changed (if looping is disabled for example).
             if (mpAnimationController->hasAnimatedCurveCaches()) mUpdates |= UpdateFlags::CurvesMoved;
             if (mpAnimationController->hasAnimatedMeshCaches()) mUpdates |= UpdateFlags::MeshesChanged;
         }
 
+        // Record the amount of transform data updated.
+        const auto& animationStats = mpAnimationController->getUpdateStats();
+        mSceneStats.changedTransformCount = animationStats.changedMatrixCount;
+        mSceneStats.uploadedTransformCount = animationStats.uploadedMatrixCount;
+        mSceneStats.transformUploadRangeCount = animationStats.uploadRangeCount;
+        mSceneStats.movedInstanceCount = mMovedInstances.size();
+        mSceneStats.instanceUploadRangeCount = 0;
+
         for (const auto& pGridVolume : mGridVolumes)
         {
             pGridVolume->updatePlayback(currentTime);
@@ -1921,7 +1977,10 @@ namespace Falcor
 
         if (is_set(mUpdates, UpdateFlags::GeometryMoved))
         {
-            invalidateTlasCache();
+            FALCOR_PROFILE(pRenderContext, "updateGeometryInstances");
+
+            // The TLASes are refit or rebuilt on next use depending on the number of moved instances.
+            for (auto& [rayTypeCount, tlas] : mTlasCache) tlas.movedInstanceCount += (uint32_t)mMovedInstances.size();
             updateGeometryInstances(false);
         }
 
@@ -2220,6 +2279,17 @@ namespace Falcor
                 << "  TLAS count: " << s.tlasCount << std::endl
                 << "  TLAS memory (final): " << formatByteSize(s.tlasMemoryInBytes) << std::endl
                 << "  TLAS memory (scratch): " << formatByteSize(s.tlasScratchMemoryInBytes) << std::endl
+                << "  TLAS refits: " << s.tlasRefitCount << std::endl
+                << "  TLAS rebuilds: " << s.tlasRebuildCount << std::endl
+                << std::endl;
+
+            // Update stats.
+            oss << "Update stats (last frame):" << std::endl
+                << "  Changed transform count: " << s.changedTransformCount << std::endl
+                << "  Uploaded transform count: " << s.uploadedTransformCount << std::endl
+                << "  Transform upload count: " << s.transformUploadRangeCount << std::endl
+                << "  Moved instance count: " << s.movedInstanceCount << std::endl
+                << "  Instance upload count: " << s.instanceUploadRangeCount << std::endl
                 << std::endl;
 
             // Material stats.
@@ -2234,8 +2304,24 @@ namespace Falcor
                 << "  Texture texel count: " << s.materials.textureTexelCount << std::endl
                 << "  Texture memory: " << formatByteSize(s.materials.textureMemoryInBytes) << std::endl
                 << "  Bytes/texel (average): " << std::fixed << std::setprecision(2) << bytesPerTexel << std::endl
-                << "  Channels/texel (average): " << std::fixed << std::setprecision(2) << channelsPerTexel << std::endl
-                << std::endl;
+                << "  Channels/texel (average): " << std::fixed << std::setprecision(2) << channelsPerTexel << std::endl;
+            if (s.materials.streamedTextureCount > 0)
+            {
+                oss << "  Texture count (streamed): " << s.materials.streamedTextureCount << std::endl
+                    << "  Texture streaming memory (resident): " << formatByteSize(s.materials.textureStreamingResidentBytes) << std::endl
+                    << "  Texture streaming memory (requested): " << formatByteSize(s.materials.textureStreamingRequestedBytes) << std::endl
+                    << "  Texture streaming memory (budget): " << formatByteSize(s.materials.textureStreamingBudgetBytes) << std::endl;
+            }
+            if (s.materials.textureLoadCompletedCount + s.materials.textureLoadCancelledCount > 0)
+            {
+                oss << "  Texture loads (async): " << s.materials.textureLoadCompletedCount << std::endl
+                    << "  Texture loads (cancelled): " << s.materials.textureLoadCancelledCount << std::endl
+                    << "  Texture loads (missed deadline): " << s.materials.textureLoadMissedDeadlineCount << std::endl
+                    << "  Texture load memory (max in flight): " << formatByteSize(s.materials.textureLoadMaxBytesInFlight) << std::endl
+                    << "  Texture load latency (average): " << std::fixed << std::setprecision(3) << s.materials.textureLoadAverageLatency << " s" << std::endl
+                    << "  Texture load latency (max): " << std::fixed << std::setprecision(3) << s.materials.textureLoadMaxLatency << " s" << std::endl;
+            }
+            oss << std::endl;
 
             // Analytic light stats.
             oss << "Analytic light stats:" << std::endl
@@ -3738,6 +3824,14 @@ namespace Falcor
         auto it = mTlasCache.find(rayTypeCount);
         if (it != mTlasCache.end()) tlas = it->second;
 
+        // Refit the existing TLAS if few instances moved, otherwise rebuild it. Refitting degrades the TLAS quality.
+        bool isAnimated = mpAnimationController->hasAnimations() || mpAnimationController->hasAnimatedVertexCaches();
+        if (tlas.pTlasObject != nullptr)
+        {
+            bool canRefit = isAnimated && tlas.updateMode == UpdateMode::Refit && mTlasUpdateMode == UpdateMode::Refit;
+            if (!shouldRefitTlas(canRefit, tlas.movedInstanceCount, (uint32_t)mGeometryInstanceData.size(), tlas.refitCount)) tlas.pTlasObject = nullptr;
+        }
+
         // Prepare instance descs.
         // Note if there are no instances, we'll build an empty TLAS.
         fillInstanceDesc(mInstanceDescs, rayTypeCount, perMeshHitEntry);
@@ -3748,7 +3842,7 @@ namespace Falcor
         inputs.flags = RtAccelerationStructureBuildFlags::None;
 
         // Add build flags for dynamic scenes if TLAS should be updating instead of rebuilt
-        if ((mpAnimationController->hasAnimations() || mpAnimationController->hasAnimatedVertexCaches()) && mTlasUpdateMode == UpdateMode::Refit)
+        if (isAnimated && mTlasUpdateMode == UpdateMode::Refit)
         {
             inputs.flags |= RtAccelerationStructureBuildFlags::AllowUpdate;
 
@@ -3823,6 +3917,18 @@ namespace Falcor
         pRenderContext->buildAccelerationStructure(asDesc, 0, nullptr);
         pRenderContext->uavBarrier(tlas.pTlasBuffer.get());
 
+        if ((inputs.flags & RtAccelerationStructureBuildFlags::PerformUpdate) != RtAccelerationStructureBuildFlags::None)
+        {
+            tlas.refitCount++;
+            mSceneStats.tlasRefitCount++;
+        }
+        else
+        {
+            tlas.refitCount = 0;
+            mSceneStats.tlasRebuildCount++;
+        }
+        tlas.movedInstanceCount = 0;
+
         mTlasCache[rayTypeCount] = tlas;
         updateRaytracingTLASStats();
     }
@@ -3836,13 +3942,13 @@ namespace Falcor
             buildBlas(pRenderContext);
         }
 
-        // On first execution, when meshes have moved, when there's a new ray type count, or when a BLAS has changed, create/update the TLAS
+        // On first execution, when instances have moved, when there's a new ray type count, or when a BLAS has changed, create/update the TLAS
         //
         // The raytracing shader table has one hit record per ray type and geometry. We need to know the ray type count in order to setup the indexing properly.
         // Note that for DXR 1.1 ray queries, the shader table is not used and the ray type count doesn't matter and can be set to zero.
         //
         auto tlasIt = mTlasCache.find(rayTypeCount);
-        if (tlasIt == mTlasCache.end() || !tlasIt->second.pTlasObject)
+        if (tlasIt == mTlasCache.end() || !tlasIt->second.pTlasObject || tlasIt->second.movedInstanceCount > 0)
         {
             // We need a hit entry per mesh right now to pass GeometryIndex()
             buildTlas(pRenderContext, rayTypeCount, true);
@@ -4156,6 +4262,16 @@ namespace Falcor
         d["textureTexelCount"] = stats.materials.textureTexelCount;
         d["textureTexelChannelCount"] = stats.materials.textureTexelChannelCount;
         d["textureMemoryInBytes"] = stats.materials.textureMemoryInBytes;
+        d["streamedTextureCount"] = stats.materials.streamedTextureCount;
+        d["textureStreamingResidentBytes"] = stats.materials.textureStreamingResidentBytes;
+        d["textureStreamingRequestedBytes"] = stats.materials.textureStreamingRequestedBytes;
+        d["textureStreamingBudgetBytes"] = stats.materials.textureStreamingBudgetBytes;
+        d["textureLoadCompletedCount"] = stats.materials.textureLoadCompletedCount;
+        d["textureLoadCancelledCount"] = stats.materials.textureLoadCancelledCount;
+        d["textureLoadMissedDeadlineCount"] = stats.materials.textureLoadMissedDeadlineCount;
+        d["textureLoadMaxBytesInFlight"] = stats.materials.textureLoadMaxBytesInFlight;
+        d["textureLoadAverageLatency"] = stats.materials.textureLoadAverageLatency;
+        d["textureLoadMaxLatency"] = stats.materials.textureLoadMaxLatency;
 
         // Raytracing stats
         d["blasGroupCount"] = stats.blasGroupCount;
@@ -4169,6 +4285,15 @@ namespace Falcor
         d["tlasCount"] = stats.tlasCount;
         d["tlasMemoryInBytes"] = stats.tlasMemoryInBytes;
         d["tlasScratchMemoryInBytes"] = stats.tlasScratchMemoryInBytes;
+        d["tlasRefitCount"] = stats.tlasRefitCount;
+        d["tlasRebuildCount"] = stats.tlasRebuildCount;
+
+        // Update stats
+        d["changedTransformCount"] = stats.changedTransformCount;
+        d["uploadedTransformCount"] = stats.uploadedTransformCount;
+        d["transformUploadRangeCount"] = stats.transformUploadRangeCount;
+        d["movedInstanceCount"] = stats.movedInstanceCount;
+        d["instanceUploadRangeCount"] = stats.instanceUploadRangeCount;
 
         // Light stats
         d["activeLightCount"] = stats.activeLightCount;
@@ -4368,6 +4493,9 @@ namespace Falcor
         scene.def("replace_material", [](const Scene* pScene, uint32_t index, ref<Material> replacementMaterial) {
             pScene->getMaterialSystem().replaceMaterial(MaterialID{ index }, replacementMaterial); }, "index"_a, "replacement_material"_a);
 
+        scene.def("report_texture_usage", [](const Scene* pScene, uint32_t index, uint32_t mipLevel) {
+            pScene->getMaterialSystem().reportTextureUsage(MaterialID{ index }, mipLevel); }, "index"_a, "mip_level"_a);
+
         scene.def("get_material_params", getMaterialParamsPython);
         scene.def("set_material_params", setMaterialParamsPython);
 
@@ -29,6 +29,7 @@
 #include "SceneIDs.h"
 #include "SceneTypes.slang"
 #include "HitInfo.h"
+#include "DirtyTracking.h"
 #include "Animation/Animation.h"
 #include "Animation/AnimationController.h"
 #include "Displacement/DisplacementUpdateTask.slang"
@@ -328,6 +329,7 @@ namespace Falcor
             std::vector<std::vector<uint32_t>> meshIdToInstanceIds; ///< Mapping of what instances belong to which mesh.
             std::vector<MeshGroup> meshGroups;                      ///< List of mesh groups. Each group maps to a BLAS for ray tracing.
             std::vector<CachedMesh> cachedMeshes;                   ///< Cached data for vertex-animated meshes.
+            VertexCacheStreamingOptions vertexCacheStreaming;       ///< Options for streaming cached keyframes. Not stored in the scene cache.
             uint32_t prevVertexCount = 0;                           ///< Number of vertices that the AnimationController needs to allocate to store previous frame vertices.
 
             bool useCompressedHitInfo = false;                      ///< True if scene should used compressed HitInfo (on scenes with triangles meshes only).
@@ -357,6 +359,8 @@ namespace Falcor
             // Custom primitive data
             std::vector<CustomPrimitiveDesc> customPrimitiveDesc;   ///< Custom primitive descriptors.
             std::vector<AABB> customPrimitiveAABBs;                 ///< List of AABBs for custom primitives in world space. Each custom primitive consists of one AABB.
+
+            std::shared_ptr<const SceneCacheFile::Reader> pGeometryFile; ///< Scene cache the mesh and curve geometry arrays are loaded from on demand, or nullptr if they are loaded. See SceneCache::loadGeometry().
         };
 
         /** Statistics.
@@ -411,6 +415,15 @@ namespace Falcor
             uint64_t tlasCount = 0;                     ///< Number of TLASes.
             uint64_t tlasMemoryInBytes = 0;             ///< Total memory in bytes used by the TLASes.
             uint64_t tlasScratchMemoryInBytes = 0;      ///< Additional memory in bytes kept around for TLAS updates etc.
+            uint64_t tlasRefitCount = 0;                ///< Number of TLAS refits since the scene was loaded.
+            uint64_t tlasRebuildCount = 0;              ///< Number of TLAS builds since the scene was loaded.
+
+            // Update stats (last call to update())
+            uint64_t changedTransformCount = 0;         ///< Number of transform matrices that changed.
+            uint64_t uploadedTransformCount = 0;        ///< Number of transform matrices uploaded to the GPU.
+            uint64_t transformUploadRangeCount = 0;     ///< Number of uploads of transform matrices.
+            uint64_t movedInstanceCount = 0;            ///< Number of geometry instances whose transform changed.
+            uint64_t instanceUploadRangeCount = 0;      ///< Number of uploads of geometry instance data.
 
             // Light stats
             uint64_t activeLightCount = 0;              ///< Number of active lights.
@@ -465,6 +478,14 @@ namespace Falcor
         */
         static ref<Scene> create(ref<Device> pDevice, SceneData&& sceneData);
 
+        /** Compute the world matrices of the scene graph nodes from their local transforms, without animations.
+            This is used by CPU code working on the scene data directly. Scenes use AnimationController::getGlobalMatrices() instead.
+            Throws if a node is stored before its parent.
+            \param[in] sceneGraph Scene graph nodes.
+            eturn World matrix of each node.
+        */
+        static std::vector<float4x4> computeGlobalMatrices(const std::vector<Node>& sceneGraph);
+
         /** Return the associated GPU device.
         */
         const ref<Device>& getDevice() const { return mpDevice; }
@@ -1025,6 +1046,12 @@ namespace Falcor
         */
         const ref<Vao>& getMeshVao16() const { return mpMeshVao16Bit; }
 
+        /** Vertex buffer slots of the mesh and curve VAOs. Both mesh VAOs share the same vertex and index buffers.
+        */
+        static constexpr uint32_t kStaticDataBufferIndex = 0;
+        static constexpr uint32_t kDrawIdBufferIndex = kStaticDataBufferIndex + 1;
+        static constexpr uint32_t kVertexBufferCount = kDrawIdBufferIndex + 1;
+
         /** Get the scene's VAO for curves.
         */
         const ref<Vao>& getCurveVao() const { return mpCurveVao; }
@@ -1125,10 +1152,6 @@ namespace Falcor
         friend class AnimationController;
         friend class AnimatedVertexCache;
 
-        static constexpr uint32_t kStaticDataBufferIndex = 0;
-        static constexpr uint32_t kDrawIdBufferIndex = kStaticDataBufferIndex + 1;
-        static constexpr uint32_t kVertexBufferCount = kDrawIdBufferIndex + 1;
-
         void createMeshVao(uint32_t drawCount, const std::vector<uint32_t>& indexData, const std::vector<PackedStaticVertexData>& staticData, const std::vector<SkinningVertexData>& skinningData);
         void createCurveVao(const std::vector<uint32_t>& indexData, const std::vector<StaticCurveVertexData>& staticData);
         void createMeshUVTiles(const std::vector<MeshDesc>& meshDesc, const std::vector<uint32_t>& indexData, const std::vector<PackedStaticVertexData>& staticData);
@@ -1157,6 +1180,7 @@ namespace Falcor
         void updateBounds();
 
         /** Update geometry instances.
+            \param[in] forceUpdate If true, all instances are updated and uploaded. Otherwise only the instances moved in the current update are.
         */
         void updateGeometryInstances(bool forceUpdate);
 
@@ -1261,6 +1285,10 @@ namespace Falcor
         GeometryTypeFlags mGeometryTypes;                           ///< Set of geometry types that exist in the scene.
 
         std::vector<GeometryInstanceData> mGeometryInstanceData;    ///< Geometry instance data (for all types of geometry).
+        NodeItemMap mNodeInstanceMap;                               ///< Maps scene graph nodes to the geometry instances they transform.
+        std::vector<uint32_t> mMovedInstances;                      ///< Geometry instances moved in the current update.
+        std::vector<uint32_t> mInstanceUploadIndices;               ///< Scratch list of geometry instances to upload.
+        std::vector<UploadRange> mInstanceUploadRanges;             ///< Scratch list of ranges of geometry instances to upload.
 
         bool mUseCompressedHitInfo = false;                         ///< True if scene should used compressed HitInfo (on scenes with triangles meshes only).
         bool mHas16BitIndices = false;                              ///< True if any meshes use 16-bit indices.
@@ -1398,6 +1426,8 @@ namespace Falcor
             ref<RtAccelerationStructure> pTlasObject;
             ref<Buffer> pTlasBuffer;
             UpdateMode updateMode = UpdateMode::Rebuild;    ///< Update mode this TLAS was created with.
+            uint32_t movedInstanceCount = 0;                ///< Number of instances moved since this TLAS was last built.
+            uint32_t refitCount = 0;                        ///< Number of refits since this TLAS was last rebuilt.
         };
 
         std::unordered_map<uint32_t, TlasData> mTlasCache;  ///< Top Level Acceleration Structure for scene data cached per shader ray type count.
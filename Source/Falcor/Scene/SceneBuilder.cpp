@@ -27,6 +27,7 @@
  **************************************************************************/
 #include "SceneBuilder.h"
 #include "SceneCache.h"
+#include "CacheKeyService.h"
 #include "Importer.h"
 #include "Curves/CurveConfig.h"
 #include "Material/StandardMaterial.h"
@@ -38,6 +39,7 @@
 #include "Utils/Math/MathHelpers.h"
 #include "Utils/ObjectIDPython.h"
 #include "Utils/NumericRange.h"
+#include "Utils/StringUtils.h"
 #include <mikktspace.h>
 #include <filesystem>
 #include <cmath>
@@ -191,15 +193,78 @@ namespace Falcor
             return indexData;
         }
 
-        SceneCache::Key computeSceneCacheKey(const std::filesystem::path& path, SceneBuilder::Flags buildFlags)
+        /** Version of the processed mesh data, included in the asset cache keys.
+            This needs to be incremented every time processMesh() changes its output!
+        */
+        const uint32_t kProcessedMeshVersion = 2;
+
+        const std::string kProcessedMeshInfoSection = "Info";
+        const std::string kProcessedMeshIndexSection = "IndexData";
+        const std::string kProcessedMeshStaticSection = "StaticData";
+        const std::string kProcessedMeshSkinningSection = "SkinningData";
+        const std::string kProcessedMeshAttributeIndexSection = "AttributeIndices";
+        const std::string kProcessedMeshTangentSection = "Tangents";
+
+        template<typename T>
+        void hashAttribute(FastHash128& hash, const SceneBuilder::Mesh& mesh, const SceneBuilder::Mesh::Attribute<T>& attribute)
+        {
+            hash.update((uint32_t)attribute.frequency);
+            hash.update(attribute.pData != nullptr);
+            if (attribute.pData) hash.update(attribute.pData, mesh.getAttributeCount(attribute) * sizeof(T));
+        }
+
+        /** Write a processed mesh to an asset cache entry. The optional outputs of processMesh() are stored if given.
+        */
+        void writeProcessedMesh(SceneCacheFile::Writer& writer, const SceneBuilder::ProcessedMesh& mesh, const SceneBuilder::MeshAttributeIndices* pAttributeIndices, const std::vector<float4>* pTangents)
+        {
+            const uint64_t info[2] = { mesh.indexCount, mesh.use16BitIndices ? 1u : 0u };
+            writer.addSection(kProcessedMeshInfoSection, info, sizeof(info));
+            writer.addSection(kProcessedMeshIndexSection, mesh.indexData);
+            writer.addSection(kProcessedMeshStaticSection, mesh.staticData);
+            writer.addSection(kProcessedMeshSkinningSection, mesh.skinningData);
+            if (pAttributeIndices) writer.addSection(kProcessedMeshAttributeIndexSection, *pAttributeIndices);
+            if (pTangents) writer.addSection(kProcessedMeshTangentSection, *pTangents);
+        }
+
+        void readProcessedMesh(const SceneCacheFile::Reader& reader, SceneBuilder::ProcessedMesh& mesh, SceneBuilder::MeshAttributeIndices* pAttributeIndices, std::vector<float4>* pTangents)
+        {
+            uint64_t info[2];
+            reader.readSection(kProcessedMeshInfoSection, info, sizeof(info));
+            mesh.indexCount = info[0];
+            mesh.use16BitIndices = info[1] != 0;
+            reader.readSection(kProcessedMeshIndexSection, mesh.indexData);
+            reader.readSection(kProcessedMeshStaticSection, mesh.staticData);
+            reader.readSection(kProcessedMeshSkinningSection, mesh.skinningData);
+            if (pAttributeIndices) reader.readSection(kProcessedMeshAttributeIndexSection, *pAttributeIndices);
+
+            // Tangents are only returned if processMesh() generated them.
+            if (pTangents)
+            {
+                std::vector<float4> tangents;
+                reader.readSection(kProcessedMeshTangentSection, tangents);
+                if (!tangents.empty()) *pTangents = std::move(tangents);
+            }
+        }
+
+        SceneCache::Key computeSceneCacheKey(CacheKeyService& keyService, const std::vector<std::filesystem::path>& paths, SceneBuilder::Flags buildFlags)
+        {
+            // The key covers the paths and contents of the files, which are hashed in parallel. The file digests are
+            // memoized by the key service, so validating a warm cache does not require reading the files.
+            SceneBuilder::Flags cacheFlags = buildFlags & (~(SceneBuilder::Flags::UseCache | SceneBuilder::Flags::RebuildCache | SceneBuilder::Flags::UseTextureCache | SceneBuilder::Flags::UseTextureStreaming | SceneBuilder::Flags::UseVertexCacheStreaming));
+            auto key = keyService.computeKey(paths, &cacheFlags, sizeof(cacheFlags));
+            keyService.saveMemo();
+            return key;
+        }
+
+        SceneCache::LegacyKey computeLegacySceneCacheKey(const std::filesystem::path& path, SceneBuilder::Flags buildFlags)
         {
-            SceneBuilder::Flags cacheFlags = buildFlags & (~(SceneBuilder::Flags::UseCache | SceneBuilder::Flags::RebuildCache));
+            // Legacy caches were keyed by the scene path and build flags alone. Flags added since do not affect the cache contents.
+            SceneBuilder::Flags cacheFlags = buildFlags & (~(SceneBuilder::Flags::UseCache | SceneBuilder::Flags::RebuildCache | SceneBuilder::Flags::UseTextureCache | SceneBuilder::Flags::UseTextureStreaming | SceneBuilder::Flags::UseVertexCacheStreaming));
             SHA1 sha1;
             auto pathStr = path.string();
             sha1.update(pathStr.data(), pathStr.size());
             sha1.update(&cacheFlags, sizeof(cacheFlags));
             return sha1.finalize();
-
         }
     }
 
@@ -210,6 +275,12 @@ namespace Falcor
     {
         mAssetResolver = AssetResolver::getDefaultResolver();
         mSceneData.pMaterials = std::make_unique<MaterialSystem>(mpDevice);
+
+        if (is_set(flags, Flags::UseTextureCache))
+        {
+            mpTextureCache = std::make_shared<TextureCache>();
+        }
+        setupTextureManager(mSceneData.pMaterials->getTextureManager());
     }
 
     SceneBuilder::SceneBuilder(ref<Device> pDevice, const std::filesystem::path& path, const Settings& settings, Flags flags)
@@ -221,20 +292,48 @@ namespace Falcor
             throw ImporterError(path, "Can't find scene file '{}'.", path);
         }
 
-        // Compute scene cache key based on absolute scene path and build flags.
-        mSceneCacheKey = computeSceneCacheKey(resolvedPath, flags);
-
         // Determine if scene cache should be written after import.
         bool useCache = is_set(flags, Flags::UseCache);
         bool rebuildCache = is_set(flags, Flags::RebuildCache);
         mWriteSceneCache = useCache || rebuildCache;
+        if (mWriteSceneCache || is_set(flags, Flags::UseVertexCacheStreaming))
+        {
+            // The scene cache key covers the contents of all files the scene depends on and the build flags.
+            // The key also names the keyframe file used for streaming keyframes without a scene cache.
+            // The dependencies are recorded during import and stored under a key of the scene file alone,
+            // so the key can be computed before importing the scene again.
+            CacheKeyService::Options options;
+            options.memoPath = CacheKeyService::getDefaultMemoPath();
+            mpCacheKeyService = std::make_unique<CacheKeyService>(options);
+            mSceneFileKey = computeSceneCacheKey(*mpCacheKeyService, { resolvedPath }, flags);
+            auto dependencies = SceneCache::readDependencies(mSceneFileKey);
+            if (!dependencies.empty())
+            {
+                try
+                {
+                    mSceneCacheKey = computeSceneCacheKey(*mpCacheKeyService, dependencies, flags);
+                    mHasSceneCacheKey = true;
+                }
+                catch (const std::exception& e)
+                {
+                    logInfo("Not using the scene cache, as a dependency of the scene cannot be read: {}", e.what());
+                }
+            }
+            mAssetResolver.setResolveCallback([this](const std::filesystem::path& resolvedPath) { addDependency(resolvedPath); });
+        }
+        if (mWriteSceneCache)
+        {
+            mpAssetCache = std::make_unique<AssetCache>(AssetCache::getDefaultDirectory());
+        }
 
         // Try to load scene cache if supported, available and requested.
-        if (useCache && !rebuildCache && SceneCache::hasValidCache(mSceneCacheKey))
+        if (useCache && !rebuildCache && mHasSceneCacheKey && SceneCache::hasValidCache(mSceneCacheKey))
         {
             try
             {
-                mpScene = Scene::create(pDevice, SceneCache::readCache(pDevice, mSceneCacheKey));
+                auto sceneData = SceneCache::readCache(pDevice, mSceneCacheKey, [this](TextureManager& textureManager) { setupTextureManager(textureManager); });
+                setupVertexCacheStreaming(sceneData);
+                mpScene = Scene::create(pDevice, std::move(sceneData));
                 return;
             }
             catch (const std::exception& e)
@@ -243,6 +342,27 @@ namespace Falcor
             }
         }
 
+        // Otherwise fall back to a legacy cache written by an earlier version.
+        // A cache of the current format is only written once the scene is imported again, e.g. with Flags::RebuildCache.
+        if (useCache && !rebuildCache)
+        {
+            auto legacyKey = computeLegacySceneCacheKey(resolvedPath, flags);
+            if (SceneCache::hasValidLegacyCache(legacyKey))
+            {
+                try
+                {
+                    auto sceneData = SceneCache::readLegacyCache(pDevice, legacyKey, [this](TextureManager& textureManager) { setupTextureManager(textureManager); });
+                    setupVertexCacheStreaming(sceneData);
+                    mpScene = Scene::create(pDevice, std::move(sceneData));
+                    return;
+                }
+                catch (const std::exception& e)
+                {
+                    throw ImporterError(resolvedPath, "Failed to load legacy scene cache: {}", e.what());
+                }
+            }
+        }
+
         import(path);
     }
 
@@ -252,7 +372,11 @@ namespace Falcor
         importFromMemory(buffer, byteSize, extension);
     }
 
-    SceneBuilder::~SceneBuilder() {}
+    SceneBuilder::~SceneBuilder()
+    {
+        // The scene was not built (e.g. the import failed), so the pending texture loads are not needed.
+        if (mpMaterialTextureLoader) mpMaterialTextureLoader->cancel();
+    }
 
     inline std::map<std::string, std::string> convertDictToMap(const pybind11::dict& dict_)
     {
@@ -319,12 +443,26 @@ namespace Falcor
         mAssetResolverStack.pop_back();
     }
 
+    void SceneBuilder::addDependency(const std::filesystem::path& path)
+    {
+        if (!mpCacheKeyService) return;
+
+        std::error_code ec;
+        if (!std::filesystem::is_regular_file(path, ec)) return;
+        auto canonicalPath = std::filesystem::weakly_canonical(path, ec);
+        if (ec) return;
+
+        std::lock_guard<std::mutex> lock(mDependencyMutex);
+        mDependencies.insert(canonicalPath);
+    }
+
     ref<Scene> SceneBuilder::getScene()
     {
         if (mpScene) return mpScene;
 
         // Finish loading textures. This blocks until all textures are loaded and assigned.
         mpMaterialTextureLoader.reset();
+        if (mpTextureCache) mpTextureCache->enforceSizeBudget();
 
         // If no meshes were added, we create a dummy mesh to keep the scene generation working.
         // Scenes with no meshes can be useful for example when using volumes in isolation.
@@ -377,6 +515,7 @@ namespace Falcor
         createMeshBoundingBoxes();
         createCurveData();
         calculateCurveBoundingBoxes();
+        compressVertexCaches();
 
         // Create instance data.
         uint32_t tlasInstanceIndex = 0;
@@ -387,14 +526,38 @@ namespace Falcor
 
         mSceneData.useCompressedHitInfo = is_set(mFlags, Flags::UseCompressedHitInfo);
 
+        // Compute the scene cache key from the files used during import.
+        if (mpCacheKeyService)
+        {
+            try
+            {
+                updateSceneCacheKey();
+            }
+            catch (const std::exception& e)
+            {
+                logWarning("Failed to compute the scene cache key, the scene cache is not written: {}", e.what());
+                mHasSceneCacheKey = false;
+                mWriteSceneCache = false;
+            }
+        }
+
         // Write scene cache if requested.
         if (mWriteSceneCache)
         {
             SceneCache::writeCache(mSceneData, mSceneCacheKey);
+
+            // Record the asset cache entries used by the scene, so they are kept by garbage collection.
+            if (mpAssetCache)
+            {
+                mpAssetCache->writeManifest(mSceneCacheKey, mAssetCacheKeys);
+                mpAssetCache->collectGarbage();
+                mpAssetCache->enforceSizeBudget();
+            }
             timeReport.measure("Writing cache");
         }
 
         // Create the scene object.
+        setupVertexCacheStreaming(mSceneData);
         mpScene = Scene::create(mpDevice, std::move(mSceneData));
         mSceneData = {};
 
@@ -445,7 +608,115 @@ namespace Falcor
         return addMesh(mesh);
     }
 
-    SceneBuilder::ProcessedMesh SceneBuilder::processMesh(const Mesh& mesh_, MeshAttributeIndices* pAttributeIndices, std::vector<float4>* pTangents) const
+    SceneBuilder::ProcessedMesh SceneBuilder::processMesh(const Mesh& mesh, MeshAttributeIndices* pAttributeIndices, std::vector<float4>* pTangents) const
+    {
+        if (!mpAssetCache) return processMeshImpl(mesh, pAttributeIndices, pTangents);
+
+        auto key = computeMeshCacheKey(mesh, mFlags);
+        {
+            std::lock_guard<std::mutex> lock(mAssetCacheMutex);
+            mAssetCacheKeys.push_back(key);
+        }
+
+        // The attribute indices and tangents are stored in the entry once requested by any caller.
+        bool storeAttributeIndices = pAttributeIndices != nullptr;
+        bool storeTangents = pTangents != nullptr;
+        if (auto pEntry = mpAssetCache->openEntry(key))
+        {
+            const bool hasAttributeIndices = pEntry->hasSection(kProcessedMeshAttributeIndexSection);
+            const bool hasTangents = pEntry->hasSection(kProcessedMeshTangentSection);
+            if ((!pAttributeIndices || hasAttributeIndices) && (!pTangents || hasTangents))
+            {
+                ProcessedMesh processedMesh;
+                processedMesh.name = mesh.name;
+                processedMesh.topology = mesh.topology;
+                processedMesh.pMaterial = mesh.pMaterial;
+                processedMesh.isFrontFaceCW = mesh.isFrontFaceCW;
+                processedMesh.isAnimated = mesh.isAnimated;
+                processedMesh.skeletonNodeId = mesh.skeletonNodeId;
+                try
+                {
+                    readProcessedMesh(*pEntry, processedMesh, pAttributeIndices, pTangents);
+                    return processedMesh;
+                }
+                catch (const std::exception& e)
+                {
+                    logWarning("Failed to read the mesh '{}' from the asset cache, processing it again: {}", mesh.name, e.what());
+                }
+            }
+            else
+            {
+                // Reprocess the mesh to add the requested outputs, keeping the ones stored already.
+                storeAttributeIndices = storeAttributeIndices || hasAttributeIndices;
+                storeTangents = storeTangents || hasTangents;
+            }
+        }
+
+        MeshAttributeIndices attributeIndices;
+        std::vector<float4> tangents;
+        auto processedMesh = processMeshImpl(mesh, storeAttributeIndices ? &attributeIndices : nullptr, storeTangents ? &tangents : nullptr);
+        mpAssetCache->writeEntry(key, [&](SceneCacheFile::Writer& writer)
+        {
+            writeProcessedMesh(writer, processedMesh, storeAttributeIndices ? &attributeIndices : nullptr, storeTangents ? &tangents : nullptr);
+        });
+        if (pAttributeIndices) *pAttributeIndices = std::move(attributeIndices);
+        if (pTangents && !tangents.empty()) *pTangents = std::move(tangents);
+        return processedMesh;
+    }
+
+    void SceneBuilder::updateSceneCacheKey()
+    {
+        std::vector<std::filesystem::path> dependencies;
+        {
+            std::lock_guard<std::mutex> lock(mDependencyMutex);
+            dependencies.assign(mDependencies.begin(), mDependencies.end());
+        }
+
+        SceneCache::Key previousKey;
+        bool hasPreviousKey = !SceneCache::readDependencies(mSceneFileKey, &previousKey).empty();
+
+        mSceneCacheKey = computeSceneCacheKey(*mpCacheKeyService, dependencies, mFlags);
+        mHasSceneCacheKey = true;
+
+        // Remove the cache of a previous version of the scene, which can no longer be loaded.
+        if (hasPreviousKey && previousKey != mSceneCacheKey)
+        {
+            SceneCache::removeCache(previousKey);
+            if (mpAssetCache) mpAssetCache->removeManifest(previousKey);
+        }
+        SceneCache::writeDependencies(mSceneFileKey, dependencies, mSceneCacheKey);
+    }
+
+    AssetCache::Key SceneBuilder::computeMeshCacheKey(const Mesh& mesh, Flags flags)
+    {
+        const Flags processFlags = flags & (Flags::UseOriginalTangentSpace | Flags::NonIndexedVertices | Flags::Force32BitIndices);
+
+        FastHash128 hash;
+        hash.update(kProcessedMeshVersion);
+        hash.update((uint32_t)processFlags);
+        hash.update(mesh.faceCount);
+        hash.update(mesh.vertexCount);
+        hash.update(mesh.indexCount);
+        hash.update((uint32_t)mesh.topology);
+        hash.update(mesh.useOriginalTangentSpace);
+        hash.update(mesh.mergeDuplicateVertices);
+        hash.update(mesh.pIndices != nullptr);
+        if (mesh.pIndices) hash.update(mesh.pIndices, mesh.indexCount * sizeof(uint32_t));
+        hashAttribute(hash, mesh, mesh.positions);
+        hashAttribute(hash, mesh, mesh.normals);
+        hashAttribute(hash, mesh, mesh.tangents);
+        hashAttribute(hash, mesh, mesh.texCrds);
+        hashAttribute(hash, mesh, mesh.curveRadii);
+        hashAttribute(hash, mesh, mesh.boneIDs);
+        hashAttribute(hash, mesh, mesh.boneWeights);
+
+        // The texture transform of the material is baked into the texture coordinates.
+        const float4x4 texTransform = mesh.pMaterial ? mesh.pMaterial->getTextureTransform().getMatrix() : float4x4::identity();
+        hash.update(&texTransform, sizeof(texTransform));
+        return hash.finalize();
+    }
+
+    SceneBuilder::ProcessedMesh SceneBuilder::processMeshImpl(const Mesh& mesh_, MeshAttributeIndices* pAttributeIndices, std::vector<float4>* pTangents) const
     {
         // This function preprocesses a mesh into the final runtime representation.
         // Note the function needs to be thread safe. The following steps are performed:
@@ -1166,6 +1437,34 @@ namespace Falcor
 
     // Internal
 
+    void SceneBuilder::setupTextureManager(TextureManager& textureManager) const
+    {
+        textureManager.setTextureCache(mpTextureCache);
+
+        if (is_set(mFlags, Flags::UseTextureStreaming))
+        {
+            TextureStreamingPolicy::Options options;
+            options.memoryBudget = uint64_t(mSettings.getOption("TextureStreaming:budgetMB", 1024u)) * 1024 * 1024;
+            options.tailSize = mSettings.getOption("TextureStreaming:tailSize", options.tailSize);
+            textureManager.enableStreaming(options);
+        }
+    }
+
+    void SceneBuilder::setupVertexCacheStreaming(Scene::SceneData& sceneData) const
+    {
+        auto& options = sceneData.vertexCacheStreaming;
+        options.enabled = is_set(mFlags, Flags::UseVertexCacheStreaming);
+        options.windowSize = mSettings.getOption("VertexCacheStreaming:windowSize", options.windowSize);
+        options.prefetchCount = mSettings.getOption("VertexCacheStreaming:prefetchCount", options.prefetchCount);
+
+        // Read the streamed keyframes from disk instead of holding all of them in memory.
+        if (options.enabled && (!sceneData.cachedMeshes.empty() || !sceneData.cachedCurves.empty()))
+        {
+            if (mHasSceneCacheKey) SceneCache::offloadKeyframes(sceneData, mSceneCacheKey);
+            else logWarning("Scene has no cache key, keyframes of cached vertex animations are streamed from memory.");
+        }
+    }
+
     void SceneBuilder::updateLinkedObjects(NodeID nodeID, NodeID newNodeID)
     {
         // Helper function to update all objects linked from a node to point to newNodeID.
@@ -2904,6 +3203,31 @@ namespace Falcor
         }
     }
 
+    void SceneBuilder::compressVertexCaches()
+    {
+        if (!is_set(mFlags, Flags::UseVertexCacheCompression)) return;
+        if (mSceneData.cachedMeshes.empty() && mSceneData.cachedCurves.empty()) return;
+
+        // Keyframes are compressed in parallel within each cache.
+        const float relativeErrorBound = mSettings.getOption("VertexCacheCompression:errorBound", 1e-4f);
+        uint64_t uncompressedSize = 0;
+        uint64_t compressedSize = 0;
+        for (auto& cache : mSceneData.cachedMeshes)
+        {
+            cache.compress(relativeErrorBound);
+            uncompressedSize += cache.compressedVertexData.getUncompressedSize();
+            compressedSize += cache.compressedVertexData.getCompressedSize();
+        }
+        for (auto& cache : mSceneData.cachedCurves)
+        {
+            cache.compress(relativeErrorBound);
+            uncompressedSize += cache.compressedVertexData.getUncompressedSize();
+            compressedSize += cache.compressedVertexData.getCompressedSize();
+        }
+
+        logInfo("Compressed vertex cache keyframes from {} to {}.", formatByteSize(uncompressedSize), formatByteSize(compressedSize));
+    }
+
     FALCOR_SCRIPT_BINDING(SceneBuilder)
     {
         using namespace pybind11::literals;
@@ -2941,6 +3265,10 @@ namespace Falcor
         flags.value("TessellateCurvesIntoPolyTubes", SceneBuilder::Flags::TessellateCurvesIntoPolyTubes);
         flags.value("UseCache", SceneBuilder::Flags::UseCache);
         flags.value("RebuildCache", SceneBuilder::Flags::RebuildCache);
+        flags.value("UseTextureCache", SceneBuilder::Flags::UseTextureCache);
+        flags.value("UseTextureStreaming", SceneBuilder::Flags::UseTextureStreaming);
+        flags.value("UseVertexCacheStreaming", SceneBuilder::Flags::UseVertexCacheStreaming);
+        flags.value("UseVertexCacheCompression", SceneBuilder::Flags::UseVertexCacheCompression);
         ScriptBindings::addEnumBinaryOperators(flags);
 
         pybind11::class_<SceneBuilder> sceneBuilder(m, "SceneBuilder");
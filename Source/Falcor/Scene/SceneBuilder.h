@@ -27,6 +27,8 @@
  **************************************************************************/
 #pragma once
 #include "Scene.h"
+#include "AssetCache.h"
+#include "CacheKeyService.h"
 #include "SceneCache.h"
 #include "SceneIDs.h"
 #include "Transform.h"
@@ -47,6 +49,8 @@
 
 #include <filesystem>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -77,9 +81,13 @@ namespace Falcor
             DontUseDisplacement             = 0x4000,   ///< Don't use displacement mapping.
             UseCompressedHitInfo            = 0x8000,   ///< Use compressed hit info (on scenes with triangle meshes only).
             TessellateCurvesIntoPolyTubes   = 0x10000,  ///< Tessellate curves into poly-tubes (the default is linear swept spheres).
+            UseTextureStreaming             = 0x20000,  ///< Stream texture mip levels within a memory budget, see TextureManager::enableStreaming(). The budget in MB is set by the 'TextureStreaming:budgetMB' option.
+            UseVertexCacheStreaming         = 0x40000,  ///< Stream keyframes of cached vertex animations from disk through a sliding window, see KeyframeStreamer. Keyframes are read from the scene cache, or from a keyframe file written next to it. The window is set by the 'VertexCacheStreaming:windowSize' and 'VertexCacheStreaming:prefetchCount' options.
+            UseVertexCacheCompression       = 0x80000,  ///< Store keyframes of cached vertex animations as quantized deltas, see CompressedKeyframes. The position error bound relative to the extent of each animation is set by the 'VertexCacheCompression:errorBound' option.
 
-            UseCache                        = 0x10000000, ///< Enable scene caching. This caches the runtime scene representation on disk to reduce load time.
-            RebuildCache                    = 0x20000000, ///< Rebuild scene cache.
+            UseCache                        = 0x10000000, ///< Enable scene caching. This caches the runtime scene representation on disk to reduce load time. Processed meshes are additionally cached per asset, see AssetCache.
+            RebuildCache                    = 0x20000000, ///< Rebuild scene cache. Unchanged assets are still loaded from the asset cache.
+            UseTextureCache                 = 0x40000000, ///< Cache processed textures (converted format and mips) on disk to reduce load time, see TextureCache.
 
             Default = None
         };
@@ -169,7 +177,7 @@ namespace Falcor
             }
 
             template<typename T>
-            size_t getAttributeCount(const Attribute<T>& attribute)
+            size_t getAttributeCount(const Attribute<T>& attribute) const
             {
                 switch (attribute.frequency)
                 {
@@ -367,6 +375,15 @@ namespace Falcor
         /// Pop the state of the asset resolver from the stack.
         void popAssetResolver();
 
+        /** Add a file the scene depends on.
+            The scene cache key covers the contents of all dependencies, so modifying any of them invalidates the cache.
+            Files resolved through the asset resolver of the builder are added automatically. Importers add other files
+            they read, e.g. included files or files resolved by third-party libraries.
+            Paths that do not refer to regular files are ignored. Can be called concurrently from multiple threads.
+            \param[in] path File path.
+        */
+        void addDependency(const std::filesystem::path& path);
+
         /** Get the scene. Make sure to add all the objects before calling this function
             \return nullptr if something went wrong, otherwise a new Scene object
         */
@@ -431,6 +448,14 @@ namespace Falcor
         */
         ProcessedMesh processMesh(const Mesh& mesh, MeshAttributeIndices* pAttributeIndices = nullptr, std::vector<float4>* pTangents = nullptr) const;
 
+        /** Compute the asset cache key of a processed mesh.
+            The key is a hash of all mesh data, the texture transform of the material and the build flags that affect the result of processMesh().
+            \param mesh The mesh.
+            \param flags Build flags.
+            \return The asset cache key.
+        */
+        static AssetCache::Key computeMeshCacheKey(const Mesh& mesh, Flags flags);
+
         /** Generate tangents for a mesh.
             \param mesh The mesh to generate tangents for. If successful, the tangent attribute on the mesh will be set to the output vector.
             \param tangents Output for generated tangents.
@@ -772,7 +797,12 @@ namespace Falcor
         Scene::SceneData mSceneData;
         ref<Scene> mpScene;
         SceneCache::Key mSceneCacheKey;
+        bool mHasSceneCacheKey = false; ///< True if mSceneCacheKey is valid. Only scenes loaded from a file have a key.
         bool mWriteSceneCache = false;  ///< True if scene cache should be written after import.
+        SceneCache::Key mSceneFileKey;  ///< Key computed from the scene file and build flags alone. The dependencies of the scene are stored under this key.
+        std::unique_ptr<CacheKeyService> mpCacheKeyService; ///< Service computing the scene cache key, or nullptr if no key is needed.
+        std::mutex mDependencyMutex;
+        std::set<std::filesystem::path> mDependencies;  ///< Files the scene depends on, recorded during import.
 
         SceneGraph mSceneGraph;
 
@@ -783,6 +813,17 @@ namespace Falcor
 
         std::unique_ptr<MaterialTextureLoader> mpMaterialTextureLoader;
 
+        std::unique_ptr<AssetCache> mpAssetCache;       ///< Per-asset cache, or nullptr if caching is disabled.
+        mutable std::mutex mAssetCacheMutex;
+        mutable std::vector<AssetCache::Key> mAssetCacheKeys; ///< Keys of all asset cache entries used by the scene. Written to the scene manifest.
+        std::shared_ptr<TextureCache> mpTextureCache;   ///< Processed texture cache, or nullptr if disabled.
+
+        ProcessedMesh processMeshImpl(const Mesh& mesh, MeshAttributeIndices* pAttributeIndices, std::vector<float4>* pTangents) const;
+
+        /** Compute the scene cache key from the dependencies recorded during import and store them for later loads.
+        */
+        void updateSceneCacheKey();
+
         // Helpers
         bool doesNodeHaveAnimation(NodeID nodeID) const;
         void updateLinkedObjects(NodeID oldNodeID, NodeID newNodeID);
@@ -790,6 +831,8 @@ namespace Falcor
         bool mergeNodes(NodeID dstNodeID, NodeID srcNodeID);
         void flipTriangleWinding(MeshSpec& mesh);
         void updateSDFGridID(SdfGridID oldID, SdfGridID newID);
+        void setupTextureManager(TextureManager& textureManager) const;
+        void setupVertexCacheStreaming(Scene::SceneData& sceneData) const;
 
         /** Split a mesh by the given axis-aligned splitting plane.
             \return Pair of optional mesh IDs for the meshes on the left and right side, respectively.
@@ -836,6 +879,7 @@ namespace Falcor
         void createSceneGraph();
         void createMeshBoundingBoxes();
         void calculateCurveBoundingBoxes();
+        void compressVertexCaches();
 
         friend class SceneCache;
         friend class SceneBuilderDump;
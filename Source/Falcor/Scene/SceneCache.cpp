@@ -26,6 +26,7 @@
  # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  **************************************************************************/
 #include "SceneCache.h"
+#include "SceneCacheFile.h"
 #include "Material/StandardMaterial.h"
 #include "Material/HairMaterial.h"
 #include "Material/ClothMaterial.h"
@@ -34,7 +35,9 @@
 
 #include <lz4_stream/lz4_stream.h>
 
+#include <algorithm>
 #include <fstream>
+#include <sstream>
 
 namespace Falcor
 {
@@ -43,7 +46,12 @@ namespace Falcor
         /** Specfies the current cache file version.
             This needs to be incremented every time the file format changes!
         */
-        const uint32_t kVersion = 25;
+        const uint32_t kVersion = 30;
+
+        /** Last version of the legacy stream format, which stores all data in a single LZ4 stream.
+            Caches of this version can still be read, see SceneCache::readLegacyCache().
+        */
+        const uint32_t kLegacyVersion = 25;
 
         /** Scene cache directory (subdirectory in the application data directory).
         */
@@ -61,6 +69,117 @@ namespace Falcor
             {
                 return std::memcmp(magic, kMagic, sizeof(Header::magic)) == 0 && version == kVersion;
             }
+
+            bool isLegacy() const
+            {
+                return std::memcmp(magic, kMagic, sizeof(Header::magic)) == 0 && version == kLegacyVersion;
+            }
+        };
+
+        // Sections of the scene cache file. Large geometry arrays are stored in their own sections,
+        // so they can be decoded in parallel straight into the scene data when the scene is created.
+        // The keyframes of cached vertex animations are stored as KeyframeFile sections, one track per
+        // cached mesh followed by one track per cached curve, and are read on demand. Compressed keyframes
+        // are stored as is in a section of their own and their tracks are left empty.
+        const std::string kSceneDataSection = "SceneData";
+        const std::string kMeshIndexDataSection = "MeshIndexData";
+        const std::string kMeshStaticDataSection = "MeshStaticData";
+        const std::string kMeshSkinningDataSection = "MeshSkinningData";
+        const std::string kCurveIndexDataSection = "CurveIndexData";
+        const std::string kCurveStaticDataSection = "CurveStaticData";
+        const std::string kCompressedKeyframesSection = "CompressedKeyframes";
+
+        /** Extension of the keyframe files written next to the scene caches, see SceneCache::offloadKeyframes().
+        */
+        const std::string kKeyframeFileExtension = ".keyframes";
+
+        /** Extension of the dependency files written next to the scene caches, see SceneCache::writeDependencies().
+        */
+        const std::string kDependencyFileExtension = ".deps";
+
+        std::filesystem::path appendExtension(std::filesystem::path path, const std::string& extension)
+        {
+            path += extension;
+            return path;
+        }
+
+        bool parseKey(const std::string& str, SceneCache::Key& key)
+        {
+            if (str.size() != 2 * key.size()) return false;
+            for (size_t i = 0; i < key.size(); ++i)
+            {
+                auto digit = [](char c) -> int
+                {
+                    if (c >= '0' && c <= '9') return c - '0';
+                    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+                    return -1;
+                };
+                int hi = digit(str[2 * i]), lo = digit(str[2 * i + 1]);
+                if (hi < 0 || lo < 0) return false;
+                key[i] = uint8_t(hi << 4 | lo);
+            }
+            return true;
+        }
+
+        template<typename T>
+        bool isCompressed(const T& cache)
+        {
+            return !cache.pKeyframeFile && !cache.compressedVertexData.empty();
+        }
+
+        /** Keyframe tracks of the cached vertex animations of a scene, one per cached mesh followed by one per cached curve.
+            The tracks of compressed keyframes are empty, as these are kept compressed in memory.
+        */
+        class KeyframeTracks
+        {
+        public:
+            KeyframeTracks(const Scene::SceneData& sceneData)
+                : mSceneData(sceneData)
+            {
+                for (const auto& cache : sceneData.cachedMeshes) addTrack(cache, sizeof(PackedStaticVertexData));
+                for (const auto& cache : sceneData.cachedCurves) addTrack(cache, sizeof(DynamicCurveVertexData));
+            }
+
+            const std::vector<KeyframeFile::TrackDesc>& getTracks() const { return mTracks; }
+
+            /** Get the data of a keyframe, which stays valid until the next call.
+            */
+            const void* getKeyframe(uint32_t track, uint32_t keyframe)
+            {
+                const size_t meshCount = mSceneData.cachedMeshes.size();
+                if (track < meshCount) return mSceneData.cachedMeshes[track].getKeyframe(keyframe, mMeshScratch);
+                return mSceneData.cachedCurves[track - meshCount].getKeyframe(keyframe, mCurveScratch);
+            }
+
+        private:
+            template<typename T>
+            void addTrack(const T& cache, size_t vertexSize)
+            {
+                KeyframeFile::TrackDesc track;
+                if (!isCompressed(cache) && cache.getKeyframeCount() > 0)
+                {
+                    track.keyframeCount = cache.getKeyframeCount();
+                    track.keyframeSize = uint64_t(cache.getVertexCount()) * vertexSize;
+                }
+                mTracks.push_back(track);
+            }
+
+            const Scene::SceneData& mSceneData;
+            std::vector<KeyframeFile::TrackDesc> mTracks;
+            std::vector<PackedStaticVertexData> mMeshScratch;
+            std::vector<DynamicCurveVertexData> mCurveScratch;
+        };
+
+        /** Read-only stream buffer over a block of memory.
+        */
+        class MemoryStreamBuf : public std::streambuf
+        {
+        public:
+            MemoryStreamBuf(const void* pData, size_t size)
+            {
+                char* p = const_cast<char*>(static_cast<const char*>(pData));
+                setg(p, p, p + size);
+            }
         };
     }
 
@@ -204,10 +323,36 @@ namespace Falcor
         // Verify header.
         Header header;
         fs.read(reinterpret_cast<char*>(&header), sizeof(header));
-        return !fs.eof() && header.isValid();
+        if (fs.eof() || !header.isValid()) return false;
+
+        // Verify section table.
+        try
+        {
+            SceneCacheFile::Reader reader(cachePath);
+            return reader.hasSection(kSceneDataSection);
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
     }
 
-    void SceneCache::writeCache(const Scene::SceneData& sceneData, const Key& key)
+    bool SceneCache::hasValidLegacyCache(const LegacyKey& key)
+    {
+        auto cachePath = getLegacyCachePath(key);
+        if (!std::filesystem::exists(cachePath)) return false;
+
+        // Open file.
+        std::ifstream fs(cachePath.c_str(), std::ios_base::binary);
+        if (fs.bad()) return false;
+
+        // Verify header.
+        Header header;
+        fs.read(reinterpret_cast<char*>(&header), sizeof(header));
+        return !fs.eof() && header.isLegacy();
+    }
+
+    void SceneCache::writeCache(const Scene::SceneData& sceneData, const Key& key, SceneCacheFile::Codec codec)
     {
         auto cachePath = getCachePath(key);
 
@@ -216,24 +361,20 @@ namespace Falcor
         // Create directories if not existing.
         std::filesystem::create_directories(cachePath.parent_path());
 
-        // Open file.
-        std::ofstream fs(cachePath.c_str(), std::ios_base::binary);
-        if (fs.bad()) FALCOR_THROW("Failed to create scene cache file '{}'.", cachePath);
-
-        // Write header (uncompressed).
-        Header header;
-        std::memcpy(header.magic, kMagic, sizeof(Header::magic));
-        header.version = kVersion;
-        fs.write(reinterpret_cast<const char*>(&header), sizeof(header));
-
-        // Write cache (compressed).
-        lz4_stream::basic_ostream<kBlockSize> zs(fs);
-        OutputStream stream(zs);
-        writeSceneData(stream, sceneData);
-        if (fs.bad()) FALCOR_THROW("Failed to write scene cache file to '{}'.", cachePath);
+        // Write geometry sections followed by the section holding the remaining scene data.
+        SceneCacheFile::Writer::Options options;
+        options.codec = codec;
+        options.chunkSize = kBlockSize;
+        SceneCacheFile::Writer writer(cachePath, kVersion, options);
+        std::ostringstream ss(std::ios_base::binary);
+        OutputStream stream(ss);
+        writeSceneData(stream, sceneData, writer);
+        std::string data = ss.str();
+        writer.addSection(kSceneDataSection, data.data(), data.size());
+        writer.finalize();
     }
 
-    Scene::SceneData SceneCache::readCache(ref<Device> pDevice, const Key& key)
+    Scene::SceneData SceneCache::readCache(ref<Device> pDevice, const Key& key, const std::function<void(TextureManager&)>& setupTextureManager)
     {
         auto cachePath = getCachePath(key);
 
@@ -247,23 +388,104 @@ namespace Falcor
         Header header;
         fs.read(reinterpret_cast<char*>(&header), sizeof(header));
         if (!header.isValid()) FALCOR_THROW("Invalid header in scene cache file '{}'.", cachePath);
+        fs.close();
+
+        // Read memory-mapped cache. Geometry and keyframe sections are decoded on demand later.
+        auto pReader = std::make_shared<SceneCacheFile::Reader>(cachePath);
+        std::vector<uint8_t> data;
+        pReader->readSection(kSceneDataSection, data);
+        MemoryStreamBuf buf(data.data(), data.size());
+        std::istream is(&buf);
+        InputStream stream(is);
+        auto sceneData = readSceneData(stream, pDevice, pReader, setupTextureManager);
+        if (is.fail()) FALCOR_THROW("Failed to read scene cache file from '{}'.", cachePath);
+        return sceneData;
+    }
+
+    Scene::SceneData SceneCache::readLegacyCache(ref<Device> pDevice, const LegacyKey& key, const std::function<void(TextureManager&)>& setupTextureManager)
+    {
+        auto cachePath = getLegacyCachePath(key);
+
+        logInfo("Loading legacy scene cache from '{}'.", cachePath);
+
+        // Open file.
+        std::ifstream fs(cachePath.c_str(), std::ios_base::binary);
+        if (fs.bad()) FALCOR_THROW("Failed to open scene cache file '{}'.", cachePath);
+
+        // Read header (uncompressed).
+        Header header;
+        fs.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!header.isLegacy()) FALCOR_THROW("Invalid header in legacy scene cache file '{}'.", cachePath);
 
-        // Read cache (compressed).
+        // Read cache (compressed). All data including geometry and keyframes is read at once.
         lz4_stream::basic_istream<kBlockSize, kBlockSize> zs(fs);
         InputStream stream(zs);
-        auto sceneData = readSceneData(stream, pDevice);
+        auto sceneData = readSceneData(stream, pDevice, nullptr, setupTextureManager);
         if (fs.bad()) FALCOR_THROW("Failed to read scene cache file from '{}'.", cachePath);
         return sceneData;
     }
 
+    void SceneCache::loadGeometry(Scene::SceneData& sceneData)
+    {
+        auto pReader = std::move(sceneData.pGeometryFile);
+        if (!pReader) return;
+
+        pReader->readSection(kMeshIndexDataSection, sceneData.meshIndexData);
+        pReader->readSection(kMeshStaticDataSection, sceneData.meshStaticData);
+        pReader->readSection(kMeshSkinningDataSection, sceneData.meshSkinningData);
+        pReader->readSection(kCurveIndexDataSection, sceneData.curveIndexData);
+        pReader->readSection(kCurveStaticDataSection, sceneData.curveStaticData);
+    }
+
+    void SceneCache::removeCache(const Key& key)
+    {
+        // Errors are ignored, the files may be in use by another process.
+        auto cachePath = getCachePath(key);
+        std::error_code ec;
+        std::filesystem::remove(cachePath, ec);
+        std::filesystem::remove(appendExtension(cachePath, kKeyframeFileExtension), ec);
+    }
+
+    std::vector<std::filesystem::path> SceneCache::readDependencies(const Key& sceneFileKey, Key* pKey)
+    {
+        // The file holds the key of the scene cache followed by one dependency per line.
+        std::ifstream fs(appendExtension(getCachePath(sceneFileKey), kDependencyFileExtension));
+        std::string line;
+        Key key;
+        if (!std::getline(fs, line) || !parseKey(line, key)) return {};
+
+        std::vector<std::filesystem::path> dependencies;
+        while (std::getline(fs, line))
+        {
+            if (!line.empty()) dependencies.push_back(std::filesystem::u8path(line));
+        }
+        if (pKey) *pKey = key;
+        return dependencies;
+    }
+
+    void SceneCache::writeDependencies(const Key& sceneFileKey, const std::vector<std::filesystem::path>& dependencies, const Key& key)
+    {
+        auto path = appendExtension(getCachePath(sceneFileKey), kDependencyFileExtension);
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream fs(path, std::ios_base::trunc);
+        fs << FastHash128::toString(key) << '\n';
+        for (const auto& dependency : dependencies) fs << dependency.u8string() << '\n';
+        if (!fs) FALCOR_THROW("Failed to write scene dependency file '{}'.", path);
+    }
+
     std::filesystem::path SceneCache::getCachePath(const Key& key)
+    {
+        return getAppDataDirectory() / kDirectory / FastHash128::toString(key);
+    }
+
+    std::filesystem::path SceneCache::getLegacyCachePath(const LegacyKey& key)
     {
         return getAppDataDirectory() / kDirectory / SHA1::toString(key);
     }
 
     // SceneData
 
-    void SceneCache::writeSceneData(OutputStream& stream, const Scene::SceneData& sceneData)
+    void SceneCache::writeSceneData(OutputStream& stream, const Scene::SceneData& sceneData, SceneCacheFile::Writer& writer)
     {
         writeMarker(stream, "Path");
         stream.write(sceneData.path);
@@ -340,23 +562,21 @@ namespace Falcor
         {
             stream.write(cachedMesh.meshID);
             stream.write(cachedMesh.timeSamples);
-            stream.write((uint32_t)cachedMesh.vertexData.size());
-            for (const auto& data : cachedMesh.vertexData) stream.write(data);
         }
         stream.write(sceneData.useCompressedHitInfo);
         stream.write(sceneData.has16BitIndices);
         stream.write(sceneData.has32BitIndices);
         stream.write(sceneData.meshDrawCount);
-        stream.write(sceneData.meshIndexData);
-        stream.write(sceneData.meshStaticData);
-        stream.write(sceneData.meshSkinningData);
+        writer.addSection(kMeshIndexDataSection, sceneData.meshIndexData);
+        writer.addSection(kMeshStaticDataSection, sceneData.meshStaticData);
+        writer.addSection(kMeshSkinningDataSection, sceneData.meshSkinningData);
 
         writeMarker(stream, "Curves");
         stream.write(sceneData.curveDesc);
         stream.write(sceneData.curveBBs);
         stream.write(sceneData.curveInstanceData);
-        stream.write(sceneData.curveIndexData);
-        stream.write(sceneData.curveStaticData);
+        writer.addSection(kCurveIndexDataSection, sceneData.curveIndexData);
+        writer.addSection(kCurveStaticDataSection, sceneData.curveStaticData);
 
         stream.write((uint32_t)sceneData.cachedCurves.size());
         for (const auto& cachedCurve : sceneData.cachedCurves)
@@ -365,9 +585,8 @@ namespace Falcor
             stream.write(cachedCurve.geometryID);
             stream.write(cachedCurve.timeSamples);
             stream.write(cachedCurve.indexData);
-            stream.write((uint32_t)cachedCurve.vertexData.size());
-            for (const auto& data : cachedCurve.vertexData) stream.write(data);
         }
+        writeKeyframes(writer, sceneData);
 
         writeMarker(stream, "CustomPrimitives");
         stream.write(sceneData.customPrimitiveDesc);
@@ -376,10 +595,12 @@ namespace Falcor
         writeMarker(stream, "End");
     }
 
-    Scene::SceneData SceneCache::readSceneData(InputStream& stream, ref<Device> pDevice)
+    Scene::SceneData SceneCache::readSceneData(InputStream& stream, ref<Device> pDevice, std::shared_ptr<const SceneCacheFile::Reader> pReader, const std::function<void(TextureManager&)>& setupTextureManager)
     {
         Scene::SceneData sceneData;
         sceneData.pMaterials = std::make_unique<MaterialSystem>(pDevice);
+        if (setupTextureManager)
+            setupTextureManager(sceneData.pMaterials->getTextureManager());
 
         readMarker(stream, "Path");
         stream.read(sceneData.path);
@@ -461,23 +682,32 @@ namespace Falcor
         {
             stream.read(cachedMesh.meshID);
             stream.read(cachedMesh.timeSamples);
-            cachedMesh.vertexData.resize(stream.read<uint32_t>());
-            for (auto& data : cachedMesh.vertexData) stream.read(data);
+            if (!pReader)
+            {
+                cachedMesh.vertexData.resize(stream.read<uint32_t>());
+                for (auto& data : cachedMesh.vertexData) stream.read(data);
+            }
         }
         stream.read(sceneData.useCompressedHitInfo);
         stream.read(sceneData.has16BitIndices);
         stream.read(sceneData.has32BitIndices);
         stream.read(sceneData.meshDrawCount);
-        stream.read(sceneData.meshIndexData);
-        stream.read(sceneData.meshStaticData);
-        stream.read(sceneData.meshSkinningData);
+        if (!pReader)
+        {
+            stream.read(sceneData.meshIndexData);
+            stream.read(sceneData.meshStaticData);
+            stream.read(sceneData.meshSkinningData);
+        }
 
         readMarker(stream, "Curves");
         stream.read(sceneData.curveDesc);
         stream.read(sceneData.curveBBs);
         stream.read(sceneData.curveInstanceData);
-        stream.read(sceneData.curveIndexData);
-        stream.read(sceneData.curveStaticData);
+        if (!pReader)
+        {
+            stream.read(sceneData.curveIndexData);
+            stream.read(sceneData.curveStaticData);
+        }
 
         sceneData.cachedCurves.resize(stream.read<uint32_t>());
         for (auto& cachedCurve : sceneData.cachedCurves)
@@ -486,8 +716,11 @@ namespace Falcor
             stream.read(cachedCurve.geometryID);
             stream.read(cachedCurve.timeSamples);
             stream.read(cachedCurve.indexData);
-            cachedCurve.vertexData.resize(stream.read<uint32_t>());
-            for (auto& data : cachedCurve.vertexData) stream.read(data);
+            if (!pReader)
+            {
+                cachedCurve.vertexData.resize(stream.read<uint32_t>());
+                for (auto& data : cachedCurve.vertexData) stream.read(data);
+            }
         }
 
         readMarker(stream, "CustomPrimitives");
@@ -496,11 +729,167 @@ namespace Falcor
 
         readMarker(stream, "End");
 
+        // Compressed keyframes are held in memory. Geometry is decoded when the scene is created and all other keyframes are read when needed.
+        // Legacy caches hold all data in the stream.
+        if (pReader)
+        {
+            if (pReader->hasSection(kCompressedKeyframesSection))
+            {
+                std::vector<uint8_t> compressedData;
+                pReader->readSection(kCompressedKeyframesSection, compressedData);
+                MemoryStreamBuf compressedBuf(compressedData.data(), compressedData.size());
+                std::istream compressedIs(&compressedBuf);
+                InputStream compressedStream(compressedIs);
+                for (auto& cache : sceneData.cachedMeshes) cache.compressedVertexData = readCompressedKeyframes(compressedStream);
+                for (auto& cache : sceneData.cachedCurves) cache.compressedVertexData = readCompressedKeyframes(compressedStream);
+                if (compressedIs.fail()) FALCOR_THROW("Failed to read compressed keyframes.");
+            }
+            if (!sceneData.cachedMeshes.empty() || !sceneData.cachedCurves.empty()) bindKeyframes(sceneData, std::make_shared<KeyframeFile>(pReader));
+            sceneData.pGeometryFile = std::move(pReader);
+        }
+
         pMaterialTextureLoader.reset();
 
         return sceneData;
     }
 
+    // Keyframes
+
+    void SceneCache::writeKeyframes(SceneCacheFile::Writer& writer, const Scene::SceneData& sceneData)
+    {
+        if (sceneData.cachedMeshes.empty() && sceneData.cachedCurves.empty()) return;
+
+        KeyframeTracks tracks(sceneData);
+        KeyframeFile::addSections(writer, tracks.getTracks(), [&](uint32_t track, uint32_t keyframe) { return tracks.getKeyframe(track, keyframe); });
+
+        // Write the compressed keyframes of all caches, with empty entries for uncompressed caches.
+        bool hasCompressed = false;
+        for (const auto& cache : sceneData.cachedMeshes) hasCompressed = hasCompressed || isCompressed(cache);
+        for (const auto& cache : sceneData.cachedCurves) hasCompressed = hasCompressed || isCompressed(cache);
+        if (!hasCompressed) return;
+
+        std::ostringstream ss;
+        OutputStream stream(ss);
+        for (const auto& cache : sceneData.cachedMeshes) writeCompressedKeyframes(stream, isCompressed(cache) ? cache.compressedVertexData : CompressedKeyframes());
+        for (const auto& cache : sceneData.cachedCurves) writeCompressedKeyframes(stream, isCompressed(cache) ? cache.compressedVertexData : CompressedKeyframes());
+        std::string data = ss.str();
+        writer.addSection(kCompressedKeyframesSection, data.data(), data.size());
+    }
+
+    void SceneCache::offloadKeyframes(Scene::SceneData& sceneData, const Key& key)
+    {
+        // Compressed keyframes are small enough to be kept in memory.
+        bool onDisk = true;
+        for (const auto& cache : sceneData.cachedMeshes) onDisk = onDisk && (cache.pKeyframeFile != nullptr || isCompressed(cache));
+        for (const auto& cache : sceneData.cachedCurves) onDisk = onDisk && (cache.pKeyframeFile != nullptr || isCompressed(cache));
+        if (onDisk) return;
+
+        // Use the keyframes of the scene cache if it exists.
+        auto cachePath = getCachePath(key);
+        try
+        {
+            auto pReader = std::make_shared<SceneCacheFile::Reader>(cachePath);
+            if (pReader->getVersion() == kVersion)
+            {
+                bindKeyframes(sceneData, std::make_shared<KeyframeFile>(pReader));
+                return;
+            }
+        }
+        catch (const std::exception&)
+        {
+            // No usable scene cache.
+        }
+
+        // Otherwise use a keyframe file named by the cache key, which is only written if missing or invalid.
+        auto keyframePath = appendExtension(cachePath, kKeyframeFileExtension);
+        try
+        {
+            if (std::filesystem::exists(keyframePath))
+            {
+                bindKeyframes(sceneData, std::make_shared<KeyframeFile>(keyframePath));
+                return;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            logWarning("Rewriting invalid keyframe file '{}': {}", keyframePath, e.what());
+        }
+
+        logInfo("Writing keyframe file to '{}'.", keyframePath);
+        std::filesystem::create_directories(keyframePath.parent_path());
+        {
+            KeyframeTracks tracks(sceneData);
+            KeyframeFile::write(keyframePath, tracks.getTracks(), [&](uint32_t track, uint32_t keyframe) { return tracks.getKeyframe(track, keyframe); });
+        }
+        bindKeyframes(sceneData, std::make_shared<KeyframeFile>(keyframePath));
+    }
+
+    void SceneCache::bindKeyframes(Scene::SceneData& sceneData, std::shared_ptr<const KeyframeFile> pKeyframes)
+    {
+        const size_t meshCount = sceneData.cachedMeshes.size();
+        if (pKeyframes->getTrackCount() != meshCount + sceneData.cachedCurves.size()) FALCOR_THROW("Keyframe track count does not match the cached vertex animations.");
+
+        // Validate all tracks before modifying the scene data. The tracks of compressed keyframes are empty.
+        auto validate = [&](const auto& cache, uint32_t track, size_t vertexSize)
+        {
+            const auto& desc = pKeyframes->getTrack(track);
+            const size_t keyframeCount = isCompressed(cache) ? 0 : cache.timeSamples.size();
+            if (isCompressed(cache) && cache.compressedVertexData.getKeyframeCount() != cache.timeSamples.size()) FALCOR_THROW("Invalid compressed keyframes of track {}.", track);
+            if (desc.keyframeCount != keyframeCount || desc.keyframeSize % vertexSize != 0) FALCOR_THROW("Invalid keyframe track {}.", track);
+        };
+        for (size_t i = 0; i < meshCount; i++) validate(sceneData.cachedMeshes[i], (uint32_t)i, sizeof(PackedStaticVertexData));
+        for (size_t i = 0; i < sceneData.cachedCurves.size(); i++) validate(sceneData.cachedCurves[i], uint32_t(meshCount + i), sizeof(DynamicCurveVertexData));
+
+        // Replace the uncompressed keyframes held in memory by the keyframes on disk.
+        auto bind = [&](auto& cache, uint32_t track)
+        {
+            if (isCompressed(cache)) return;
+            cache.vertexData = {};
+            cache.pKeyframeFile = pKeyframes;
+            cache.keyframeTrack = track;
+        };
+        for (size_t i = 0; i < meshCount; i++) bind(sceneData.cachedMeshes[i], (uint32_t)i);
+        for (size_t i = 0; i < sceneData.cachedCurves.size(); i++) bind(sceneData.cachedCurves[i], uint32_t(meshCount + i));
+    }
+
+    void SceneCache::writeCompressedKeyframes(OutputStream& stream, const CompressedKeyframes& keyframes)
+    {
+        stream.write(keyframes.mKeyframeCount);
+        stream.write(keyframes.mVertexCount);
+        stream.write(keyframes.mReferenceKeyframe);
+        stream.write(keyframes.mErrorBound);
+        stream.write(keyframes.mLaneTypes);
+        stream.write(keyframes.mReference);
+        stream.write(keyframes.mChannelWidths);
+        stream.write(keyframes.mData);
+    }
+
+    CompressedKeyframes SceneCache::readCompressedKeyframes(InputStream& stream)
+    {
+        CompressedKeyframes keyframes;
+        stream.read(keyframes.mKeyframeCount);
+        stream.read(keyframes.mVertexCount);
+        stream.read(keyframes.mReferenceKeyframe);
+        stream.read(keyframes.mErrorBound);
+        stream.read(keyframes.mLaneTypes);
+        stream.read(keyframes.mReference);
+        stream.read(keyframes.mChannelWidths);
+        stream.read(keyframes.mData);
+
+        // The channel layout is derived from the lane types and widths.
+        keyframes.initChannels();
+        const size_t channelCount = keyframes.getChannelCount();
+        const bool validWidths = std::all_of(keyframes.mChannelWidths.begin(), keyframes.mChannelWidths.end(), [](uint8_t width) { return width == 0 || width == 1 || width == 2 || width == 4; });
+        if (!validWidths ||
+            keyframes.mReference.size() != size_t(keyframes.mVertexCount) * keyframes.getLaneCount() ||
+            keyframes.mChannelWidths.size() != size_t(keyframes.mKeyframeCount) * channelCount ||
+            keyframes.computeChannelOffsets() != keyframes.mData.size())
+        {
+            FALCOR_THROW("Invalid compressed keyframes.");
+        }
+        return keyframes;
+    }
+
     // Metadata
 
     void SceneCache::writeMetadata(OutputStream& stream, const Scene::Metadata& metadata)
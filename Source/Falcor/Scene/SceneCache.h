@@ -27,6 +27,7 @@
  **************************************************************************/
 #pragma once
 #include "Scene.h"
+#include "SceneCacheFile.h"
 #include "Animation/Animation.h"
 #include "Camera/Camera.h"
 #include "Lights/EnvMap.h"
@@ -40,8 +41,12 @@
 #include "Core/Macros.h"
 #include "Core/API/fwd.h"
 #include "Utils/CryptoUtils.h"
+#include "Utils/FastHash.h"
+#include "Utils/Image/TextureManager.h"
 
 #include <filesystem>
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -50,11 +55,25 @@ namespace Falcor
     /** Helper class for reading and writing scene cache files.
         The scene cache is used to heavily reduce load times of more complex assets.
         The cache stores a binary representation of `Scene::SceneData` which contains everything to re-create a `Scene`.
+        Caches are stored in the SceneCacheFile format. The large geometry arrays and the keyframes of cached vertex
+        animations are stored in separate sections, which are only decoded when needed: geometry when the scene
+        is created (see loadGeometry()), and each keyframe when it is uploaded or streamed to the GPU.
+
+        Cache keys cover the contents of all files a scene depends on. These are only known after importing the scene,
+        so they are stored under a key computed from the scene file alone (see writeDependencies()), which is used to
+        compute the cache key before importing the scene again.
+
+        Caches of the legacy format (version 25), which stores all data in a single LZ4 stream, can still be read.
+        These were keyed by the scene path and build flags alone, see hasValidLegacyCache().
     */
     class FALCOR_API SceneCache
     {
     public:
-        using Key = SHA1::MD;
+        using Key = FastHash128::MD;
+
+        /** Key of legacy caches, a SHA1 digest of the absolute scene path and build flags.
+        */
+        using LegacyKey = SHA1::MD;
 
         /** Check if there is a valid scene cache for a given cache key.
             \param[in] key Cache key.
@@ -65,24 +84,85 @@ namespace Falcor
         /** Write a scene cache.
             \param[in] sceneData Scene data.
             \param[in] key Cache key.
+            \param[in] codec Compression codec. Use LZ4HC for smaller caches at the cost of a slower write.
         */
-        static void writeCache(const Scene::SceneData& sceneData, const Key& key);
+        static void writeCache(const Scene::SceneData& sceneData, const Key& key, SceneCacheFile::Codec codec = SceneCacheFile::Codec::LZ4);
 
         /** Read a scene cache.
             \param[in] pDevice GPU device.
             \param[in] key Cache key.
+            \param[in] setupTextureManager Optional function called to configure the texture manager (e.g. texture cache or streaming) before material textures are loaded.
             \return Returns the loaded scene data.
         */
-        static Scene::SceneData readCache(ref<Device> pDevice, const Key& key);
+        static Scene::SceneData readCache(ref<Device> pDevice, const Key& key, const std::function<void(TextureManager&)>& setupTextureManager = {});
+
+        /** Check if there is a valid legacy cache for a given legacy cache key.
+            Legacy caches are only written by earlier versions, so they are read as a fallback if there is no cache for the current key.
+            \param[in] key Legacy cache key.
+            \return Returns true if a valid legacy cache exists.
+        */
+        static bool hasValidLegacyCache(const LegacyKey& key);
+
+        /** Read a legacy scene cache. All data is read at once, including geometry and keyframes.
+            \param[in] pDevice GPU device.
+            \param[in] key Legacy cache key.
+            \param[in] setupTextureManager Optional function called to configure the texture manager before material textures are loaded.
+            \return Returns the loaded scene data.
+        */
+        static Scene::SceneData readLegacyCache(ref<Device> pDevice, const LegacyKey& key, const std::function<void(TextureManager&)>& setupTextureManager = {});
+
+        /** Decode the geometry arrays of scene data read from a scene cache. Does nothing if they are loaded already.
+            This is called when creating a scene and only needs to be called explicitly for accessing the arrays before.
+            \param[in,out] sceneData Scene data.
+        */
+        static void loadGeometry(Scene::SceneData& sceneData);
+
+        /** Release the keyframes of cached vertex animations held in memory, and read them on demand from disk instead.
+            The keyframes are read from the scene cache of the key if it exists. Otherwise they are written to a keyframe
+            file named by the key next to the scene caches once, and later loads of the same scene reuse the file.
+            \param[in,out] sceneData Scene data.
+            \param[in] key Cache key.
+        */
+        static void offloadKeyframes(Scene::SceneData& sceneData, const Key& key);
+
+        /** Remove a scene cache and its keyframe file if they exist.
+            \param[in] key Cache key.
+        */
+        static void removeCache(const Key& key);
+
+        /** Read the files a scene depends on, written by writeDependencies().
+            \param[in] sceneFileKey Key computed from the scene file and build flags alone.
+            \param[out] pKey Key of the scene cache written along with the dependencies, or nullptr.
+            \return The dependencies, or an empty list if there are none.
+        */
+        static std::vector<std::filesystem::path> readDependencies(const Key& sceneFileKey, Key* pKey = nullptr);
+
+        /** Write the files a scene depends on, along with the key of the scene cache computed from them.
+            \param[in] sceneFileKey Key computed from the scene file and build flags alone.
+            \param[in] dependencies Files the scene depends on.
+            \param[in] key Cache key computed from the dependencies.
+        */
+        static void writeDependencies(const Key& sceneFileKey, const std::vector<std::filesystem::path>& dependencies, const Key& key);
 
     private:
         class OutputStream;
         class InputStream;
 
         static std::filesystem::path getCachePath(const Key& key);
+        static std::filesystem::path getLegacyCachePath(const LegacyKey& key);
 
-        static void writeSceneData(OutputStream& stream, const Scene::SceneData& sceneData);
-        static Scene::SceneData readSceneData(InputStream& stream, ref<Device> pDevice);
+        static void writeSceneData(OutputStream& stream, const Scene::SceneData& sceneData, SceneCacheFile::Writer& writer);
+        /** Read scene data. Geometry arrays and keyframes are left in the sections of pReader.
+            If pReader is nullptr, the scene data is read from a legacy cache, which holds all data in the stream.
+        */
+        static Scene::SceneData readSceneData(InputStream& stream, ref<Device> pDevice, std::shared_ptr<const SceneCacheFile::Reader> pReader, const std::function<void(TextureManager&)>& setupTextureManager);
+
+        static void writeKeyframes(SceneCacheFile::Writer& writer, const Scene::SceneData& sceneData);
+        /** Bind the keyframe tracks of the cached vertex animations that are not compressed. Compressed keyframes are kept in memory.
+        */
+        static void bindKeyframes(Scene::SceneData& sceneData, std::shared_ptr<const KeyframeFile> pKeyframes);
+        static void writeCompressedKeyframes(OutputStream& stream, const CompressedKeyframes& keyframes);
+        static CompressedKeyframes readCompressedKeyframes(InputStream& stream);
 
         static void writeMetadata(OutputStream& stream, const Scene::Metadata& metadata);
         static Scene::Metadata readMetadata(InputStream& stream);
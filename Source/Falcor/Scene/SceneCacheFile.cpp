@@ -0,0 +1,339 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "SceneCacheFile.h"
+#include "Core/Error.h"
+#include "Utils/StringFormatters.h"
+
+#include <BS_thread_pool.hpp>
+#include <lz4.h>
+#include <lz4hc.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <future>
+
+namespace Falcor
+{
+    namespace
+    {
+        const char* kMagic = "FalcorS$";
+
+        /** File header. The first two fields match the header of the legacy stream format,
+            so the version of either format can be determined by reading the first 12 bytes.
+        */
+        struct FileHeader
+        {
+            uint8_t magic[8]{};
+            uint32_t version{};
+            uint32_t sectionCount{};
+            uint64_t tableOffset{};         ///< File offset of the section table, zero until the file is finalized.
+            uint64_t chunkCount{};
+        };
+
+        static_assert(sizeof(FileHeader) == 32);
+
+        uint64_t alignOffset(uint64_t offset)
+        {
+            return (offset + SceneCacheFile::kAlignment - 1) / SceneCacheFile::kAlignment * SceneCacheFile::kAlignment;
+        }
+
+        bool isLZ4Codec(SceneCacheFile::Codec codec)
+        {
+            return codec == SceneCacheFile::Codec::LZ4 || codec == SceneCacheFile::Codec::LZ4HC;
+        }
+
+        /** Compress a block of data.
+            \return Compressed size in bytes, or zero if the data does not fit the destination buffer.
+        */
+        int compressData(SceneCacheFile::Codec codec, int compressionLevel, const char* pSrc, char* pDst, int srcSize, int dstCapacity)
+        {
+            switch (codec)
+            {
+            case SceneCacheFile::Codec::LZ4:
+                return LZ4_compress_default(pSrc, pDst, srcSize, dstCapacity);
+            case SceneCacheFile::Codec::LZ4HC:
+                return LZ4_compress_HC(pSrc, pDst, srcSize, dstCapacity, compressionLevel);
+            default:
+                return 0;
+            }
+        }
+    }
+
+    // Writer
+
+    struct SceneCacheFile::Writer::CompressedChunk
+    {
+        Codec codec = Codec::None;
+        uint32_t storedSize = 0;
+        std::vector<char> data;         ///< Compressed data, empty if the chunk is stored uncompressed.
+    };
+
+    SceneCacheFile::Writer::Writer(const std::filesystem::path& path, uint32_t version, const Options& options)
+        : mPath(path)
+        , mVersion(version)
+        , mOptions(options)
+    {
+        FALCOR_CHECK(options.chunkSize > 0 && options.chunkSize <= LZ4_MAX_INPUT_SIZE, "Invalid chunk size {}.", options.chunkSize);
+        FALCOR_CHECK(
+            options.codec == Codec::None || options.codec == Codec::LZ4 || options.codec == Codec::LZ4HC,
+            "Invalid codec {}.", (uint32_t)options.codec
+        );
+
+        mStream.open(path, std::ios_base::binary | std::ios_base::trunc);
+        if (!mStream.good()) FALCOR_THROW("Failed to create scene cache file '{}'.", path);
+
+        // Write an empty header, which is replaced when finalizing the file.
+        FileHeader header;
+        mStream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        mOffset = sizeof(header);
+
+        if (options.codec != Codec::None && options.threadCount != 1)
+            mpThreadPool = std::make_unique<BS::thread_pool>(options.threadCount);
+    }
+
+    SceneCacheFile::Writer::~Writer() = default;
+
+    void SceneCacheFile::Writer::addSection(const std::string& name, const void* pData, size_t size)
+    {
+        FALCOR_CHECK(!mFinalized, "Cannot add sections to a finalized scene cache file.");
+        FALCOR_CHECK(!name.empty() && name.size() <= kMaxSectionNameLength, "Invalid section name '{}'.", name);
+        FALCOR_CHECK(std::none_of(mSections.begin(), mSections.end(), [&](const SectionEntry& s) { return name == s.name; }), "Duplicate section '{}'.", name);
+
+        const size_t chunkSize = mOptions.chunkSize;
+
+        SectionEntry section;
+        std::memcpy(section.name, name.data(), name.size());
+        section.size = size;
+        section.firstChunk = mChunks.size();
+        section.chunkCount = (uint32_t)((size + chunkSize - 1) / chunkSize);
+        section.chunkSize = (uint32_t)chunkSize;
+        section.codec = mOptions.codec;
+
+        const char* pSrc = static_cast<const char*>(pData);
+        auto compress = [this, pSrc, size, chunkSize](uint32_t i)
+        {
+            size_t offset = i * chunkSize;
+            int srcSize = (int)std::min(chunkSize, size - offset);
+            CompressedChunk chunk;
+            if (mOptions.codec != Codec::None)
+            {
+                chunk.data.resize(LZ4_compressBound(srcSize));
+                int compressedSize = compressData(mOptions.codec, mOptions.compressionLevel, pSrc + offset, chunk.data.data(), srcSize, (int)chunk.data.size());
+                // Store the chunk uncompressed if compression does not reduce its size.
+                if (compressedSize > 0 && compressedSize < srcSize)
+                {
+                    chunk.codec = mOptions.codec;
+                    chunk.storedSize = (uint32_t)compressedSize;
+                    chunk.data.resize(compressedSize);
+                    return chunk;
+                }
+            }
+            chunk.codec = Codec::None;
+            chunk.storedSize = (uint32_t)srcSize;
+            chunk.data = {};
+            return chunk;
+        };
+
+        if (mpThreadPool)
+        {
+            // Compress chunks concurrently while writing them in order. The number of chunks in flight
+            // is bounded to limit the memory used for compressed data.
+            const size_t maxInFlight = 2 * mpThreadPool->get_thread_count();
+            std::deque<std::future<CompressedChunk>> queue;
+            uint32_t nextChunk = 0;
+            for (uint32_t i = 0; i < section.chunkCount; ++i)
+            {
+                while (nextChunk < section.chunkCount && queue.size() < maxInFlight)
+                    queue.push_back(mpThreadPool->submit(compress, nextChunk++));
+                writeChunk(queue.front().get(), pSrc + (size_t)i * chunkSize);
+                queue.pop_front();
+            }
+        }
+        else
+        {
+            for (uint32_t i = 0; i < section.chunkCount; ++i)
+                writeChunk(compress(i), pSrc + (size_t)i * chunkSize);
+        }
+
+        mSections.push_back(section);
+        if (!mStream.good()) FALCOR_THROW("Failed to write section '{}' to scene cache file '{}'.", name, mPath);
+    }
+
+    void SceneCacheFile::Writer::finalize()
+    {
+        FALCOR_CHECK(!mFinalized, "Scene cache file is already finalized.");
+
+        // Write section table.
+        writePadding();
+        FileHeader header;
+        std::memcpy(header.magic, kMagic, sizeof(FileHeader::magic));
+        header.version = mVersion;
+        header.sectionCount = (uint32_t)mSections.size();
+        header.tableOffset = mOffset;
+        header.chunkCount = mChunks.size();
+        mStream.write(reinterpret_cast<const char*>(mSections.data()), mSections.size() * sizeof(SectionEntry));
+        mStream.write(reinterpret_cast<const char*>(mChunks.data()), mChunks.size() * sizeof(ChunkEntry));
+
+        // Write header.
+        mStream.seekp(0);
+        mStream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        mStream.close();
+        if (mStream.fail()) FALCOR_THROW("Failed to write scene cache file '{}'.", mPath);
+
+        mFinalized = true;
+    }
+
+    void SceneCacheFile::Writer::writeChunk(const CompressedChunk& chunk, const char* pData)
+    {
+        writePadding();
+        ChunkEntry entry;
+        entry.offset = mOffset;
+        entry.storedSize = chunk.storedSize;
+        entry.codec = chunk.codec;
+        mStream.write(chunk.codec == Codec::None ? pData : chunk.data.data(), chunk.storedSize);
+        mOffset += chunk.storedSize;
+        mChunks.push_back(entry);
+    }
+
+    void SceneCacheFile::Writer::writePadding()
+    {
+        static const char kZeros[kAlignment] = {};
+        uint64_t padding = alignOffset(mOffset) - mOffset;
+        mStream.write(kZeros, padding);
+        mOffset += padding;
+    }
+
+    // Reader
+
+    SceneCacheFile::Reader::Reader(const std::filesystem::path& path, uint32_t threadCount)
+        : mPath(path)
+    {
+        if (!mFile.open(path)) FALCOR_THROW("Failed to open scene cache file '{}'.", path);
+
+        const uint8_t* pData = static_cast<const uint8_t*>(mFile.getData());
+        const uint64_t fileSize = mFile.getMappedSize();
+
+        // Read header.
+        FileHeader header;
+        if (fileSize < sizeof(header)) FALCOR_THROW("Scene cache file '{}' is truncated.", path);
+        std::memcpy(&header, pData, sizeof(header));
+        if (std::memcmp(header.magic, kMagic, sizeof(FileHeader::magic)) != 0) FALCOR_THROW("Invalid header in scene cache file '{}'.", path);
+        if (header.tableOffset == 0) FALCOR_THROW("Scene cache file '{}' is incomplete.", path);
+        mVersion = header.version;
+
+        // Read section table.
+        uint64_t tableSize = header.sectionCount * sizeof(SectionEntry) + header.chunkCount * sizeof(ChunkEntry);
+        if (header.tableOffset > fileSize || header.chunkCount > fileSize || tableSize > fileSize - header.tableOffset)
+            FALCOR_THROW("Scene cache file '{}' is truncated.", path);
+
+        mSections.resize(header.sectionCount);
+        mChunks.resize(header.chunkCount);
+        std::memcpy(mSections.data(), pData + header.tableOffset, mSections.size() * sizeof(SectionEntry));
+        std::memcpy(mChunks.data(), pData + header.tableOffset + mSections.size() * sizeof(SectionEntry), mChunks.size() * sizeof(ChunkEntry));
+
+        // Validate the table so that decoding only needs to check the chunk contents.
+        for (uint32_t sectionIndex = 0; sectionIndex < mSections.size(); ++sectionIndex)
+        {
+            auto& section = mSections[sectionIndex];
+            section.name[kMaxSectionNameLength] = '\0';
+            std::string name = section.name;
+
+            if (!isLZ4Codec(section.codec) && section.codec != Codec::None)
+                FALCOR_THROW("Section '{}' in scene cache file '{}' uses unsupported codec {}.", name, path, (uint32_t)section.codec);
+
+            bool valid = section.chunkSize > 0 && section.firstChunk <= mChunks.size() && section.chunkCount <= mChunks.size() - section.firstChunk &&
+                section.chunkCount == (section.size + section.chunkSize - 1) / section.chunkSize;
+            uint64_t storedSize = 0;
+            for (uint32_t i = 0; valid && i < section.chunkCount; ++i)
+            {
+                const auto& chunk = mChunks[section.firstChunk + i];
+                uint64_t chunkSize = std::min<uint64_t>(section.chunkSize, section.size - (uint64_t)i * section.chunkSize);
+                // Chunks are either stored uncompressed or with the codec of the section.
+                valid = chunk.offset <= header.tableOffset && chunk.storedSize <= header.tableOffset - chunk.offset &&
+                    ((chunk.codec == Codec::None && chunk.storedSize == chunkSize) || (chunk.codec == section.codec && chunk.codec != Codec::None));
+                storedSize += chunk.storedSize;
+            }
+            if (!valid || name.empty() || mSectionIndices.count(name) != 0) FALCOR_THROW("Invalid section '{}' in scene cache file '{}'.", name, path);
+
+            mSectionIndices[name] = sectionIndex;
+            mSectionInfos.push_back({name, section.size, storedSize, section.chunkCount, section.codec});
+        }
+
+        if (threadCount != 1) mpThreadPool = std::make_unique<BS::thread_pool>(threadCount);
+    }
+
+    SceneCacheFile::Reader::~Reader() = default;
+
+    const SceneCacheFile::SectionInfo& SceneCacheFile::Reader::getSectionInfo(const std::string& name) const
+    {
+        auto it = mSectionIndices.find(name);
+        if (it == mSectionIndices.end()) FALCOR_THROW("Section '{}' not found in scene cache file '{}'.", name, mPath);
+        return mSectionInfos[it->second];
+    }
+
+    void SceneCacheFile::Reader::readSection(const std::string& name, void* pDst, size_t size) const
+    {
+        const auto& info = getSectionInfo(name);
+        const auto& section = mSections[mSectionIndices.at(name)];
+        FALCOR_CHECK(size == section.size, "Size {} does not match size {} of section '{}'.", size, section.size, name);
+
+        const char* pFileData = static_cast<const char*>(mFile.getData());
+        char* pDstData = static_cast<char*>(pDst);
+
+        // Decode chunks in parallel straight into the destination.
+        std::atomic<bool> failed = false;
+        auto decode = [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                const auto& chunk = mChunks[section.firstChunk + i];
+                uint64_t offset = (uint64_t)i * section.chunkSize;
+                int chunkSize = (int)std::min<uint64_t>(section.chunkSize, section.size - offset);
+                if (chunk.codec == Codec::None)
+                    std::memcpy(pDstData + offset, pFileData + chunk.offset, chunkSize);
+                else if (LZ4_decompress_safe(pFileData + chunk.offset, pDstData + offset, (int)chunk.storedSize, chunkSize) != chunkSize)
+                    failed = true;
+            }
+        };
+
+        if (mpThreadPool && info.chunkCount > 1)
+            mpThreadPool->parallelize_loop(0u, info.chunkCount, decode, info.chunkCount).wait();
+        else
+            decode(0, info.chunkCount);
+
+        if (failed) FALCOR_THROW("Failed to decode section '{}' in scene cache file '{}'.", name, mPath);
+    }
+
+    void SceneCacheFile::Reader::checkElementSize(const SectionInfo& info, size_t elementSize) const
+    {
+        if (info.size % elementSize != 0)
+            FALCOR_THROW("Size {} of section '{}' is not a multiple of the element size {}.", info.size, info.name, elementSize);
+    }
+}
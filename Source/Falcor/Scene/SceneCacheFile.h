@@ -0,0 +1,228 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/Macros.h"
+#include "Core/Platform/MemoryMappedFile.h"
+
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace BS
+{
+    class thread_pool;
+}
+
+namespace Falcor
+{
+    /** Sectioned container format used by the scene cache.
+
+        A file consists of a header, the data of a number of named sections and a section table at the end of the file.
+        The data of each section is split into chunks of a fixed uncompressed size. Each chunk is compressed independently
+        and stored at an aligned file offset. Chunks that do not compress are stored uncompressed.
+        Chunks are compressed and decompressed concurrently on a thread pool. The writer keeps a bounded queue
+        of chunks in flight and writes them in order, so the file contents do not depend on the thread count.
+
+        Files are read through a memory mapping. Sections are only decoded when requested, and the chunks of a section
+        are decoded in parallel straight into the destination memory. This allows large trivially-copyable arrays
+        such as vertex and index data to be loaded without copying them through intermediate buffers.
+
+        The header is only valid once the section table has been written, so an interrupted write never results
+        in a file that can be opened.
+    */
+    class FALCOR_API SceneCacheFile
+    {
+    public:
+        static constexpr size_t kAlignment = 4096;                      ///< Alignment of chunk data in the file.
+        static constexpr size_t kDefaultChunkSize = 1 * 1024 * 1024;    ///< Default uncompressed chunk size in bytes.
+        static constexpr size_t kMaxSectionNameLength = 31;
+
+        /** Compression codec. Both LZ4 variants produce LZ4 block data and decompress at the same speed.
+        */
+        enum class Codec : uint32_t
+        {
+            None = 0,       ///< Uncompressed.
+            LZ4 = 1,        ///< LZ4, fast compression.
+            LZ4HC = 2,      ///< LZ4 high compression, slower compression with a higher ratio. Useful for archival caches.
+        };
+
+    private:
+        // On-disk layout of the section table. The table stores all section entries followed by all chunk entries.
+
+        struct SectionEntry
+        {
+            char name[kMaxSectionNameLength + 1] = {};
+            uint64_t size = 0;              ///< Uncompressed size in bytes.
+            uint64_t firstChunk = 0;        ///< Index of the first chunk entry.
+            uint32_t chunkCount = 0;
+            uint32_t chunkSize = 0;         ///< Uncompressed size of all but the last chunk.
+            Codec codec = Codec::None;      ///< Codec used for compressing the chunks.
+            uint32_t reserved = 0;
+        };
+
+        struct ChunkEntry
+        {
+            uint64_t offset = 0;            ///< File offset in bytes.
+            uint32_t storedSize = 0;        ///< Stored size in bytes.
+            Codec codec = Codec::None;      ///< Codec of the section, or None if the chunk is stored uncompressed.
+        };
+
+    public:
+        struct SectionInfo
+        {
+            std::string name;
+            uint64_t size = 0;              ///< Uncompressed size in bytes.
+            uint64_t storedSize = 0;        ///< Size of the stored chunks in bytes, excluding alignment padding.
+            uint32_t chunkCount = 0;
+            Codec codec = Codec::None;
+        };
+
+        /** Writes a scene cache file.
+            Sections are written in the order they are added. The file is only complete after calling finalize().
+        */
+        class FALCOR_API Writer
+        {
+        public:
+            struct Options
+            {
+                Codec codec = Codec::LZ4;                   ///< Codec used for all sections.
+                int compressionLevel = 9;                   ///< Compression level of the LZ4HC codec (1-12).
+                size_t chunkSize = kDefaultChunkSize;       ///< Uncompressed size of the chunks in bytes.
+                uint32_t threadCount = 0;                   ///< Number of compression threads, 0 to use all hardware threads.
+
+                // Note: Empty constructor needed for clang due to the use of the nested struct constructor in the parent constructor.
+                Options() {}
+            };
+
+            /** Create a file, overwriting any existing file.
+                \param[in] path File path.
+                \param[in] version Format version stored in the header.
+                \param[in] options Options.
+            */
+            Writer(const std::filesystem::path& path, uint32_t version, const Options& options = Options());
+            ~Writer();
+
+            /** Add a section.
+                \param[in] name Unique name of the section, at most kMaxSectionNameLength characters.
+                \param[in] pData Section data.
+                \param[in] size Size of the section data in bytes.
+            */
+            void addSection(const std::string& name, const void* pData, size_t size);
+
+            template<typename T>
+            void addSection(const std::string& name, const std::vector<T>& vec)
+            {
+                static_assert(std::is_trivially_copyable<T>::value && !std::is_same<T, bool>::value);
+                addSection(name, vec.data(), vec.size() * sizeof(T));
+            }
+
+            /** Write the section table and header. No sections can be added afterwards.
+            */
+            void finalize();
+
+        private:
+            struct CompressedChunk;
+
+            void writeChunk(const CompressedChunk& chunk, const char* pData);
+            void writePadding();
+
+            std::filesystem::path mPath;
+            std::ofstream mStream;
+            uint32_t mVersion;
+            Options mOptions;
+            uint64_t mOffset = 0;
+            std::vector<SectionEntry> mSections;
+            std::vector<ChunkEntry> mChunks;
+            std::unique_ptr<BS::thread_pool> mpThreadPool;  ///< Compression threads, or nullptr if compressing on the calling thread.
+            bool mFinalized = false;
+        };
+
+        /** Reads a scene cache file through a memory mapping.
+            Throws if the file cannot be opened or its header or section table is invalid.
+        */
+        class FALCOR_API Reader
+        {
+        public:
+            /** Open a file.
+                \param[in] path File path.
+                \param[in] threadCount Number of decompression threads, 0 to use all hardware threads.
+            */
+            Reader(const std::filesystem::path& path, uint32_t threadCount = 0);
+            ~Reader();
+
+            /** Get the format version stored in the header.
+            */
+            uint32_t getVersion() const { return mVersion; }
+
+            bool hasSection(const std::string& name) const { return mSectionIndices.count(name) != 0; }
+
+            /** Get the info of all sections in the order they were written.
+            */
+            const std::vector<SectionInfo>& getSections() const { return mSectionInfos; }
+
+            /** Get the info of a section. Throws if the section does not exist.
+            */
+            const SectionInfo& getSectionInfo(const std::string& name) const;
+
+            /** Decode a section into a caller provided buffer. Throws if the section does not exist or is corrupt.
+                \param[in] name Section name.
+                \param[in] pDst Destination buffer.
+                \param[in] size Size of the destination buffer, must match the size of the section.
+            */
+            void readSection(const std::string& name, void* pDst, size_t size) const;
+
+            /** Decode a section into a vector, which is resized to fit the section.
+            */
+            template<typename T>
+            void readSection(const std::string& name, std::vector<T>& vec) const
+            {
+                static_assert(std::is_trivially_copyable<T>::value && !std::is_same<T, bool>::value);
+                const auto& info = getSectionInfo(name);
+                checkElementSize(info, sizeof(T));
+                vec.resize(info.size / sizeof(T));
+                readSection(name, vec.data(), info.size);
+            }
+
+        private:
+            void checkElementSize(const SectionInfo& info, size_t elementSize) const;
+
+            std::filesystem::path mPath;
+            MemoryMappedFile mFile;
+            uint32_t mVersion = 0;
+            std::vector<SectionEntry> mSections;
+            std::vector<ChunkEntry> mChunks;
+            std::vector<SectionInfo> mSectionInfos;
+            std::map<std::string, uint32_t> mSectionIndices;
+            std::unique_ptr<BS::thread_pool> mpThreadPool;  ///< Decompression threads, or nullptr if decompressing on the calling thread.
+        };
+    };
+}
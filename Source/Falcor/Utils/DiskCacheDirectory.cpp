@@ -0,0 +1,155 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "DiskCacheDirectory.h"
+#include <fmt/format.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace Falcor
+{
+namespace
+{
+/// Extension of temporary files, inserted before the extension of the file.
+const std::string kTempExtension = ".tmp";
+
+/// Temporary files older than this are considered leftovers of interrupted writes.
+const auto kTempFileMaxAge = std::chrono::hours(1);
+
+bool isTempFile(const std::filesystem::path& path)
+{
+    return path.extension() == kTempExtension || path.stem().extension() == kTempExtension;
+}
+} // namespace
+
+DiskCacheDirectory::DiskCacheDirectory(const std::filesystem::path& path) : mPath(path)
+{
+    std::filesystem::create_directories(mPath);
+}
+
+void DiskCacheDirectory::writeFile(const std::filesystem::path& path, const std::function<void(const std::filesystem::path& tempPath)>& write)
+{
+    std::filesystem::create_directories(path.parent_path());
+    auto tempPath = getTempPath(path);
+    try
+    {
+        write(tempPath);
+        std::filesystem::rename(tempPath, path);
+    }
+    catch (const std::exception&)
+    {
+        removeFile(tempPath);
+        throw;
+    }
+}
+
+std::vector<DiskCacheDirectory::File> DiskCacheDirectory::listFiles() const
+{
+    std::vector<File> files;
+    std::error_code ec;
+    for (const auto& it : std::filesystem::recursive_directory_iterator(mPath, ec))
+    {
+        if (!it.is_regular_file(ec) || isTempFile(it.path()))
+            continue;
+        File file;
+        file.path = it.path();
+        file.size = it.file_size(ec);
+        if (ec)
+            continue;
+        file.lastUsed = it.last_write_time(ec);
+        if (ec)
+            continue;
+        files.push_back(file);
+    }
+    return files;
+}
+
+uint64_t DiskCacheDirectory::removeTempFiles() const
+{
+    uint64_t freedSize = 0;
+    const auto now = std::filesystem::file_time_type::clock::now();
+    std::error_code ec;
+    for (const auto& it : std::filesystem::recursive_directory_iterator(mPath, ec))
+    {
+        if (!it.is_regular_file(ec) || !isTempFile(it.path()))
+            continue;
+        auto lastWriteTime = it.last_write_time(ec);
+        if (!ec && now - lastWriteTime > kTempFileMaxAge)
+            freedSize += removeFile(it.path());
+    }
+    return freedSize;
+}
+
+void DiskCacheDirectory::markUsed(const std::filesystem::path& path)
+{
+    std::error_code ec;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+}
+
+uint64_t DiskCacheDirectory::removeFile(const std::filesystem::path& path)
+{
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    if (ec)
+        size = 0;
+    return std::filesystem::remove(path, ec) ? size : 0;
+}
+
+void DiskCacheDirectory::sortByLastUse(std::vector<File>& files)
+{
+    std::sort(files.begin(), files.end(), [](const File& a, const File& b) { return a.lastUsed < b.lastUsed; });
+}
+
+uint64_t DiskCacheDirectory::evict(const std::vector<File>& files, uint64_t sizeBudget)
+{
+    uint64_t totalSize = 0;
+    for (const auto& file : files)
+        totalSize += file.size;
+
+    uint64_t freedSize = 0;
+    for (const auto& file : files)
+    {
+        if (totalSize <= sizeBudget)
+            break;
+        // Files removed concurrently free nothing, but no longer count against the budget either.
+        freedSize += removeFile(file.path);
+        totalSize -= file.size;
+    }
+    return freedSize;
+}
+
+std::filesystem::path DiskCacheDirectory::getTempPath(const std::filesystem::path& path)
+{
+    // Make the name unique across threads of this process and across instances.
+    size_t threadHash = std::hash<std::thread::id>()(std::this_thread::get_id());
+    auto name = fmt::format(
+        "{}.{:x}.{}{}{}", path.stem().string(), threadHash, mTempCounter++, kTempExtension, path.extension().string()
+    );
+    return path.parent_path() / name;
+}
+} // namespace Falcor
@@ -0,0 +1,115 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/Macros.h"
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+namespace Falcor
+{
+/**
+ * Directory holding the files of an on-disk cache.
+ *
+ * Files are written to a temporary file in the same directory and renamed, so concurrent readers never see
+ * partial files. The modification time of a file is its last use, which is used for least recently used eviction.
+ * Temporary files left over by interrupted writes are removed by removeTempFiles().
+ *
+ * All file system errors other than failed writes are ignored, as files may be removed concurrently by other
+ * processes using the same cache. All functions can be called concurrently from multiple threads.
+ */
+class FALCOR_API DiskCacheDirectory
+{
+public:
+    struct File
+    {
+        std::filesystem::path path;
+        uint64_t size = 0;
+        std::filesystem::file_time_type lastUsed;
+    };
+
+    /**
+     * Create the directory if it does not exist.
+     * @param[in] path Directory path.
+     */
+    DiskCacheDirectory(const std::filesystem::path& path);
+
+    const std::filesystem::path& getPath() const { return mPath; }
+
+    /**
+     * Write a file through a temporary file, replacing any existing file.
+     * Throws an exception if the file cannot be written. The temporary file is removed on failure.
+     * @param[in] path File path, in the directory or one of its subdirectories (created if needed).
+     * @param[in] write Function writing the temporary file, called with its path. The extension of the file is kept.
+     */
+    void writeFile(const std::filesystem::path& path, const std::function<void(const std::filesystem::path& tempPath)>& write);
+
+    /**
+     * List all files in the directory and its subdirectories, excluding temporary files.
+     */
+    std::vector<File> listFiles() const;
+
+    /**
+     * Remove temporary files older than an hour, which are leftovers of interrupted writes.
+     * @return Number of bytes freed.
+     */
+    uint64_t removeTempFiles() const;
+
+    /**
+     * Mark a file as recently used.
+     */
+    static void markUsed(const std::filesystem::path& path);
+
+    /**
+     * Remove a file.
+     * @return Number of bytes freed.
+     */
+    static uint64_t removeFile(const std::filesystem::path& path);
+
+    /**
+     * Sort files in least recently used order.
+     */
+    static void sortByLastUse(std::vector<File>& files);
+
+    /**
+     * Remove files in the given order until the total size of the files is within a size budget.
+     * @param[in] files Files in eviction order.
+     * @param[in] sizeBudget Maximum total size in bytes.
+     * @return Number of bytes freed.
+     */
+    static uint64_t evict(const std::vector<File>& files, uint64_t sizeBudget);
+
+private:
+    std::filesystem::path getTempPath(const std::filesystem::path& path);
+
+    std::filesystem::path mPath;
+    std::atomic<uint64_t> mTempCounter{0};
+};
+} // namespace Falcor
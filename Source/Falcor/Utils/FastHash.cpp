@@ -0,0 +1,96 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "FastHash.h"
+#include "Core/Error.h"
+
+#define XXH_INLINE_ALL
+#include <xxhash/xxhash.h>
+
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+namespace Falcor
+{
+namespace
+{
+// The state is stored in FastHash128 and copied along with it. It only references the default secret,
+// which is a global constant, so copies are valid.
+static_assert(sizeof(XXH3_state_t) <= sizeof(FastHash128) && alignof(XXH3_state_t) <= alignof(FastHash128));
+static_assert(std::is_trivially_copyable_v<XXH3_state_t>);
+} // namespace
+
+FastHash128::FastHash128()
+{
+    auto pState = new (mState) XXH3_state_t;
+    XXH3_INITSTATE(pState);
+    XXH3_128bits_reset(pState);
+}
+
+void FastHash128::update(const void* data, size_t len)
+{
+    if (!data || len == 0)
+        return;
+
+    if (XXH3_128bits_update(reinterpret_cast<XXH3_state_t*>(mState), data, len) != XXH_OK)
+        FALCOR_THROW("Failed to update hash.");
+}
+
+FastHash128::MD FastHash128::finalize() const
+{
+    XXH128_canonical_t canonical;
+    XXH128_canonicalFromHash(&canonical, XXH3_128bits_digest(reinterpret_cast<const XXH3_state_t*>(mState)));
+
+    MD md;
+    static_assert(sizeof(canonical.digest) == sizeof(MD));
+    std::memcpy(md.data(), canonical.digest, md.size());
+    return md;
+}
+
+FastHash128::MD FastHash128::compute(const void* data, size_t len)
+{
+    XXH128_canonical_t canonical;
+    XXH128_canonicalFromHash(&canonical, XXH3_128bits(data, len));
+
+    MD md;
+    std::memcpy(md.data(), canonical.digest, md.size());
+    return md;
+}
+
+std::string FastHash128::toString(const MD& md)
+{
+    static const char kHexDigits[] = "0123456789abcdef";
+    std::string str(2 * md.size(), '0');
+    for (size_t i = 0; i < md.size(); ++i)
+    {
+        str[2 * i] = kHexDigits[md[i] >> 4];
+        str[2 * i + 1] = kHexDigits[md[i] & 0xf];
+    }
+    return str;
+}
+} // namespace Falcor
@@ -0,0 +1,103 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/Macros.h"
+#include <array>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <cstdint>
+#include <cstdlib>
+
+namespace Falcor
+{
+/**
+ * Helper to compute a fast non-cryptographic 128-bit hash.
+ *
+ * This is a wrapper around XXH3_128bits from xxHash (see external/include/xxhash). The digest is the
+ * canonical (big-endian) representation of the XXH128 hash, so it matches the reference implementation.
+ *
+ * The hash is deterministic across platforms and runs, and is intended for cache keys and change
+ * detection. It must not be used where collisions can be provoked deliberately.
+ */
+class FALCOR_API FastHash128
+{
+public:
+    using MD = std::array<uint8_t, 16>; ///< Message digest.
+
+    FastHash128();
+
+    /**
+     * Update hash by adding the given data.
+     * @param[in] data Data to hash.
+     * @param[in] len Length of data in bytes.
+     */
+    void update(const void* data, size_t len);
+
+    /**
+     * Update hash by adding one value of fundamental type T.
+     * @param[in] Value to hash.
+     */
+    template<typename T, std::enable_if_t<std::is_fundamental<T>::value, bool> = true>
+    void update(const T& value)
+    {
+        update(&value, sizeof(value));
+    }
+
+    /**
+     * Update hash by adding the given string view.
+     */
+    void update(const std::string_view str) { update(str.data(), str.size()); }
+
+    /**
+     * Return final message digest.
+     * The hash state is not modified, so more data can be added afterwards.
+     * @return Returns the message digest.
+     */
+    MD finalize() const;
+
+    /**
+     * Compute hash over the given data.
+     * @param[in] data Data to hash.
+     * @param[in] len Length of data in bytes.
+     * @return Returns the message digest.
+     */
+    static MD compute(const void* data, size_t len);
+
+    /**
+     * Convert hash to 32-character string in hexadecimal notation.
+     */
+    static std::string toString(const MD& md);
+
+private:
+    static constexpr size_t kStateSize = 576;
+
+    /// Storage for the XXH3_state_t, which is kept opaque to not expose xxHash in this header.
+    alignas(64) uint8_t mState[kStateSize];
+};
+} // namespace Falcor
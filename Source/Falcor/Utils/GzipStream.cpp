@@ -0,0 +1,198 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "GzipStream.h"
+#include "Core/Error.h"
+#include "Utils/StringFormatters.h"
+#include <zlib.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+/// Size in bytes of the blocks read from the compressed file.
+const size_t kInputBlockSize = 256 * 1024;
+} // namespace
+
+GzipStream::GzipStream(const std::filesystem::path& path, const Options& options)
+    : mPath(path), mOptions(options), mFile(path, std::ios::binary)
+{
+    FALCOR_CHECK(mOptions.chunkSize > 0, "'chunkSize' must be at least 1.");
+    FALCOR_CHECK(mOptions.maxQueuedChunks > 0, "'maxQueuedChunks' must be at least 1.");
+
+    if (!mFile)
+        FALCOR_THROW("Failed to read from file '{}'.", path);
+
+    mThread = std::thread(&GzipStream::runDecompressor, this);
+}
+
+GzipStream::~GzipStream()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTerminate = true;
+    }
+    mCondition.notify_all();
+
+    mThread.join();
+}
+
+bool GzipStream::read(std::string& chunk)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    // Hand the storage of the previous chunk back to the decompression thread.
+    if (chunk.capacity() > mFreeChunk.capacity())
+        mFreeChunk = std::move(chunk);
+
+    auto isReady = [&]() { return !mQueue.empty() || mDone; };
+    if (!isReady())
+    {
+        mStats.stallCount++;
+        mCondition.wait(lock, isReady);
+    }
+
+    if (mQueue.empty())
+    {
+        chunk.clear();
+        if (mpError)
+            std::rethrow_exception(mpError);
+        return false;
+    }
+
+    chunk = std::move(mQueue.front());
+    mQueue.pop_front();
+    mBufferedBytes -= chunk.size();
+
+    lock.unlock();
+    mCondition.notify_all();
+    return true;
+}
+
+GzipStream::Stats GzipStream::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+void GzipStream::runDecompressor()
+{
+    std::exception_ptr pError;
+    try
+    {
+        decompress();
+    }
+    catch (...)
+    {
+        pError = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mpError = pError;
+        mDone = true;
+    }
+    mCondition.notify_all();
+}
+
+void GzipStream::decompress()
+{
+    z_stream zs = {};
+    // MAX_WBITS | 32 to support both zlib or gzip files.
+    if (inflateInit2(&zs, MAX_WBITS | 32) != Z_OK)
+        FALCOR_THROW("inflateInit2 failed while decompressing.");
+    std::unique_ptr<z_stream, int (*)(z_streamp)> inflateGuard(&zs, inflateEnd);
+
+    std::vector<char> input(kInputBlockSize);
+    std::string chunk;
+    size_t chunkFill = 0;
+
+    while (true)
+    {
+        // Read the next block of compressed data.
+        if (zs.avail_in == 0)
+        {
+            mFile.read(input.data(), input.size());
+            const size_t count = static_cast<size_t>(mFile.gcount());
+            if (count == 0)
+                FALCOR_THROW("Failure to decompress file '{}' (unexpected end of file).", mPath);
+            zs.next_in = reinterpret_cast<Bytef*>(input.data());
+            zs.avail_in = (uInt)count;
+        }
+
+        if (chunk.size() != mOptions.chunkSize)
+            chunk.resize(mOptions.chunkSize);
+
+        zs.next_out = reinterpret_cast<Bytef*>(chunk.data() + chunkFill);
+        zs.avail_out = (uInt)(mOptions.chunkSize - chunkFill);
+
+        int ret = inflate(&zs, Z_NO_FLUSH);
+        // Z_BUF_ERROR only signals that no progress was possible, more input is read above.
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+            FALCOR_THROW("Failure to decompress file '{}' (error: {}).", mPath, ret);
+
+        chunkFill = mOptions.chunkSize - zs.avail_out;
+        if (chunkFill == mOptions.chunkSize || (ret == Z_STREAM_END && chunkFill > 0))
+        {
+            chunk.resize(chunkFill);
+            if (!pushChunk(chunk, zs.total_in))
+                return;
+            chunkFill = 0;
+        }
+
+        if (ret == Z_STREAM_END)
+            break;
+    }
+}
+
+bool GzipStream::pushChunk(std::string& chunk, uint64_t compressedBytes)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    // Apply back-pressure while the queue is full.
+    mCondition.wait(lock, [&]() { return mTerminate || mQueue.size() < mOptions.maxQueuedChunks; });
+    if (mTerminate)
+        return false;
+
+    mBufferedBytes += chunk.size();
+    mStats.compressedBytes = compressedBytes;
+    mStats.decompressedBytes += chunk.size();
+    mStats.maxBufferedBytes = std::max(mStats.maxBufferedBytes, mBufferedBytes);
+    mQueue.push_back(std::move(chunk));
+
+    // Continue with recycled storage if available.
+    chunk = std::move(mFreeChunk);
+    mFreeChunk = std::string();
+
+    lock.unlock();
+    mCondition.notify_all();
+    return true;
+}
+} // namespace Falcor
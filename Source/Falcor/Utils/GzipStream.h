@@ -0,0 +1,130 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/Macros.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace Falcor
+{
+/**
+ * Streaming reader for gzip (or zlib) compressed files.
+ *
+ * The file is decompressed on a background thread into chunks of Options::chunkSize bytes, which are handed to the
+ * reader in order through read(). At most Options::maxQueuedChunks decompressed chunks are queued, which bounds the
+ * memory used to roughly (maxQueuedChunks + 3) * chunkSize, independent of the file size. The compressed file is
+ * read incrementally as well, so neither the compressed nor the decompressed file is ever fully held in memory.
+ *
+ * Decompression overlaps with the processing of the chunks on the calling thread, which makes it possible to
+ * pipeline e.g. parsing against decompression.
+ */
+class FALCOR_API GzipStream
+{
+public:
+    struct Options
+    {
+        /// Size in bytes of the decompressed chunks returned by read(). The last chunk may be smaller.
+        size_t chunkSize = 1024 * 1024;
+        /// Maximum number of decompressed chunks waiting to be read.
+        uint32_t maxQueuedChunks = 4;
+
+        // Note: Empty constructor needed for clang due to the use of the nested struct constructor in the parent constructor.
+        Options() {}
+    };
+
+    struct Stats
+    {
+        uint64_t compressedBytes = 0;    ///< Number of compressed bytes read from the file.
+        uint64_t decompressedBytes = 0;  ///< Number of decompressed bytes produced.
+        uint64_t maxBufferedBytes = 0;   ///< Maximum size in bytes of the decompressed chunks queued at any time.
+        uint32_t stallCount = 0;         ///< Number of times read() blocked waiting for the decompression thread.
+    };
+
+    /**
+     * Constructor. Opens the file and starts decompressing it on a background thread.
+     * Throws an exception if the file cannot be opened.
+     * @param[in] path File path.
+     * @param[in] options Options.
+     */
+    GzipStream(const std::filesystem::path& path, const Options& options = Options());
+
+    /**
+     * Destructor. Stops the background thread, discarding any data not yet read.
+     */
+    ~GzipStream();
+
+    GzipStream(const GzipStream&) = delete;
+    GzipStream& operator=(const GzipStream&) = delete;
+
+    /**
+     * Read the next chunk of decompressed data. Blocks until the chunk is available.
+     * Throws an exception if the file cannot be read or decompressed.
+     * @param[out] chunk Replaced by the next chunk, which is never empty. The previous storage of the string is
+     *                   recycled for later chunks, so passing the same string on every call avoids allocations.
+     * @return False if the end of the stream has been reached, true otherwise.
+     */
+    bool read(std::string& chunk);
+
+    /**
+     * Get stats. Can be called while the stream is being read.
+     */
+    Stats getStats() const;
+
+    const std::filesystem::path& getPath() const { return mPath; }
+    const Options& getOptions() const { return mOptions; }
+
+private:
+    void runDecompressor();
+    void decompress();
+    bool pushChunk(std::string& chunk, uint64_t compressedBytes);
+
+    std::filesystem::path mPath;
+    Options mOptions;
+    std::ifstream mFile;                ///< Compressed file. Only accessed by the decompression thread after construction.
+
+    mutable std::mutex mMutex;
+    std::condition_variable mCondition; ///< Signaled when a chunk is queued or read, or the stream terminates.
+    std::thread mThread;
+
+    // Internal state. Do not access outside of critical section.
+    std::deque<std::string> mQueue;     ///< Decompressed chunks waiting to be read.
+    std::string mFreeChunk;             ///< Storage of a chunk already read, recycled by the decompression thread.
+    std::exception_ptr mpError;         ///< Error raised by the decompression thread.
+    uint64_t mBufferedBytes = 0;        ///< Size in bytes of the queued chunks.
+    bool mDone = false;                 ///< True when the decompression thread has finished.
+    bool mTerminate = false;            ///< True when the decompression thread should stop.
+    Stats mStats;
+};
+} // namespace Falcor
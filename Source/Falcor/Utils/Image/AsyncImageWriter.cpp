@@ -0,0 +1,213 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "AsyncImageWriter.h"
+#include "Core/Error.h"
+#include "Utils/Logger.h"
+#include <algorithm>
+
+namespace Falcor
+{
+namespace
+{
+double getSeconds(AsyncImageWriter::Clock::duration duration)
+{
+    return std::chrono::duration<double>(duration).count();
+}
+} // namespace
+
+AsyncImageWriter::AsyncImageWriter(const Options& options, Encoder encoder, CompletionCallback callback)
+    : mOptions(options), mEncoder(std::move(encoder)), mCallback(std::move(callback))
+{
+    FALCOR_CHECK(mOptions.threadCount > 0, "'threadCount' must be at least 1.");
+
+    if (!mEncoder)
+    {
+        mEncoder = [](Image& image)
+        {
+            Bitmap::saveImage(
+                image.path,
+                image.width,
+                image.height,
+                image.fileFormat,
+                image.exportFlags,
+                image.resourceFormat,
+                image.isTopDown,
+                image.data.data()
+            );
+        };
+    }
+
+    for (uint32_t i = 0; i < mOptions.threadCount; ++i)
+        mThreads.emplace_back(&AsyncImageWriter::runWorker, this);
+}
+
+AsyncImageWriter::~AsyncImageWriter()
+{
+    flush();
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTerminate = true;
+    }
+    mWorkCondition.notify_all();
+
+    for (auto& thread : mThreads)
+        thread.join();
+}
+
+uint64_t AsyncImageWriter::write(Image image)
+{
+    const uint64_t size = image.data.size();
+
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    if (mStats.submittedCount == 0)
+        mStartTime = Clock::now();
+
+    // Apply back-pressure while the data in flight exceeds the budget.
+    auto canSubmit = [&]() { return mStats.bytesInFlight == 0 || mStats.bytesInFlight + size <= mOptions.maxBytesInFlight; };
+    if (!canSubmit())
+    {
+        const auto stallStart = Clock::now();
+        mDoneCondition.wait(lock, canSubmit);
+        mStats.stallCount++;
+        mStats.stallTime += getSeconds(Clock::now() - stallStart);
+    }
+
+    const uint64_t id = mNextID++;
+    mStats.submittedCount++;
+    mStats.bytesInFlight += size;
+    mStats.maxBytesInFlight = std::max(mStats.maxBytesInFlight, mStats.bytesInFlight);
+    mQueue.push_back({id, std::move(image)});
+
+    lock.unlock();
+    mWorkCondition.notify_one();
+
+    return id;
+}
+
+void AsyncImageWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDoneCondition.wait(lock, [&]() { return mReportedCount == mNextID; });
+}
+
+AsyncImageWriter::Stats AsyncImageWriter::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+void AsyncImageWriter::resetStats()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    const uint64_t bytesInFlight = mStats.bytesInFlight;
+    mStats = Stats();
+    mStats.bytesInFlight = bytesInFlight;
+    mStats.maxBytesInFlight = bytesInFlight;
+}
+
+void AsyncImageWriter::runWorker()
+{
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mWorkCondition.wait(lock, [&]() { return mTerminate || !mQueue.empty(); });
+        if (mQueue.empty())
+            return;
+
+        Job job = std::move(mQueue.front());
+        mQueue.pop_front();
+        lock.unlock();
+
+        Result result;
+        result.id = job.id;
+        result.path = job.image.path;
+        result.sizeInBytes = job.image.data.size();
+
+        const auto encodeStart = Clock::now();
+        try
+        {
+            mEncoder(job.image);
+            result.success = true;
+        }
+        catch (const std::exception& e)
+        {
+            result.error = e.what();
+        }
+        result.encodeTime = getSeconds(Clock::now() - encodeStart);
+
+        // Free the image data before releasing it from the budget.
+        job.image.data = {};
+
+        lock.lock();
+        mStats.bytesInFlight -= result.sizeInBytes;
+        mStats.encodeTime += result.encodeTime;
+        mResults.emplace(result.id, std::move(result));
+        mDoneCondition.notify_all();
+
+        reportResults(lock);
+    }
+}
+
+void AsyncImageWriter::reportResults(std::unique_lock<std::mutex>& lock)
+{
+    // Only one thread reports at a time. It also reports the results other threads complete in the meantime.
+    if (mReporting)
+        return;
+    mReporting = true;
+
+    while (true)
+    {
+        auto it = mResults.find(mNextReportID);
+        if (it == mResults.end())
+            break;
+        Result result = std::move(it->second);
+        mResults.erase(it);
+        mNextReportID++;
+
+        lock.unlock();
+        if (mCallback)
+            mCallback(result);
+        else if (!result.success)
+            logWarning("Failed to write image '{}': {}", result.path, result.error);
+        lock.lock();
+
+        mStats.completedCount++;
+        if (result.success)
+            mStats.bytesWritten += result.sizeInBytes;
+        else
+            mStats.failedCount++;
+        mStats.elapsedTime = getSeconds(Clock::now() - mStartTime);
+        mReportedCount++;
+    }
+
+    mReporting = false;
+    mDoneCondition.notify_all();
+}
+} // namespace Falcor
@@ -0,0 +1,193 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Bitmap.h"
+#include "Core/Macros.h"
+#include "Core/API/Formats.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Falcor
+{
+/**
+ * Writes images to disk on a fixed pool of encoder threads.
+ *
+ * Images are encoded in submission order by Options::threadCount threads. The image data waiting in the queue or being
+ * encoded is bounded by Options::maxBytesInFlight: write() blocks while the budget is exceeded, which throttles the
+ * producer (e.g. rendering) to the speed of the disk instead of buffering an unbounded number of frames.
+ *
+ * Completion is reported in submission order, regardless of the order in which the encoder threads finish. This makes
+ * it possible to track the last image that is fully written, e.g. to resume an interrupted capture.
+ */
+class FALCOR_API AsyncImageWriter
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Options
+    {
+        /// Number of encoder threads.
+        uint32_t threadCount = 4;
+        /// Maximum size in bytes of image data queued or being encoded. An image is always accepted if no data is in flight.
+        uint64_t maxBytesInFlight = 1024ull * 1024 * 1024;
+
+        // Note: Empty constructor needed for clang due to the use of the nested struct constructor in the parent constructor.
+        Options() {}
+    };
+
+    /// Image to write. The arguments match Bitmap::saveImage().
+    struct Image
+    {
+        std::filesystem::path path;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        Bitmap::FileFormat fileFormat = Bitmap::FileFormat::PngFile;
+        Bitmap::ExportFlags exportFlags = Bitmap::ExportFlags::None;
+        ResourceFormat resourceFormat = ResourceFormat::Unknown;
+        bool isTopDown = true;
+        std::vector<uint8_t> data;
+    };
+
+    /// Result of writing an image.
+    struct Result
+    {
+        uint64_t id = 0;             ///< ID returned by write().
+        std::filesystem::path path;  ///< Path of the image.
+        uint64_t sizeInBytes = 0;    ///< Size of the image data.
+        bool success = false;        ///< True if the image was written.
+        std::string error;           ///< Error message if the image failed to write.
+        double encodeTime = 0.0;     ///< Time in seconds spent encoding and writing the image.
+    };
+
+    /**
+     * Function encoding and writing an image. Throws an exception on failure.
+     * Called concurrently from the encoder threads.
+     */
+    using Encoder = std::function<void(Image& image)>;
+
+    /**
+     * Function called when an image has been written or failed to write.
+     * Calls are serialized and in submission order, but may come from any encoder thread. Must not throw.
+     */
+    using CompletionCallback = std::function<void(const Result& result)>;
+
+    struct Stats
+    {
+        uint64_t submittedCount = 0;     ///< Number of images submitted.
+        uint64_t completedCount = 0;     ///< Number of images reported complete, including failed ones.
+        uint64_t failedCount = 0;        ///< Number of images that failed to write.
+        uint64_t bytesWritten = 0;       ///< Size in bytes of the image data of all successfully written images.
+        uint64_t bytesInFlight = 0;      ///< Size in bytes of image data queued or being encoded.
+        uint64_t maxBytesInFlight = 0;   ///< Maximum size in bytes of image data queued or being encoded.
+        uint64_t stallCount = 0;         ///< Number of write() calls that blocked because of back-pressure.
+        double stallTime = 0.0;          ///< Time in seconds write() blocked because of back-pressure.
+        double encodeTime = 0.0;         ///< Time in seconds spent in the encoder, summed over all threads.
+        double elapsedTime = 0.0;        ///< Time in seconds from the first submission to the last completion.
+
+        /// Throughput in bytes of image data per second of elapsed time.
+        double getThroughput() const { return elapsedTime > 0.0 ? bytesWritten / elapsedTime : 0.0; }
+    };
+
+    /**
+     * Constructor.
+     * @param[in] options Options.
+     * @param[in] encoder Function writing an image. If empty, images are written with Bitmap::saveImage().
+     * @param[in] callback Function called when an image completes. Failures are logged if empty.
+     */
+    AsyncImageWriter(const Options& options = Options(), Encoder encoder = {}, CompletionCallback callback = {});
+
+    /**
+     * Destructor.
+     * Blocks until all submitted images are written and all threads have terminated.
+     */
+    ~AsyncImageWriter();
+
+    /**
+     * Queue an image for writing.
+     * Blocks while the image data in flight exceeds Options::maxBytesInFlight.
+     * @param[in] image Image to write.
+     * @return ID of the image, increasing in submission order starting at 0.
+     */
+    uint64_t write(Image image);
+
+    /**
+     * Block until all submitted images have been written and reported.
+     */
+    void flush();
+
+    /**
+     * Get stats. Stats are accumulated since construction or the last call to resetStats().
+     */
+    Stats getStats() const;
+
+    /**
+     * Reset the accumulated stats. Should be called while no images are in flight.
+     */
+    void resetStats();
+
+    const Options& getOptions() const { return mOptions; }
+
+private:
+    void runWorker();
+    void reportResults(std::unique_lock<std::mutex>& lock);
+
+    struct Job
+    {
+        uint64_t id;
+        Image image;
+    };
+
+    Options mOptions;
+    Encoder mEncoder;
+    CompletionCallback mCallback;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mWorkCondition;  ///< Signaled when a job is queued or the workers terminate.
+    std::condition_variable mDoneCondition;  ///< Signaled when data in flight is released or results are reported.
+    std::vector<std::thread> mThreads;
+
+    // Internal state. Do not access outside of critical section.
+    std::deque<Job> mQueue;                  ///< Jobs waiting for an encoder thread.
+    std::map<uint64_t, Result> mResults;     ///< Results waiting to be reported in order.
+    uint64_t mNextID = 0;                    ///< ID of the next submitted image.
+    uint64_t mNextReportID = 0;              ///< ID of the next result to report.
+    uint64_t mReportedCount = 0;             ///< Number of results for which the completion callback has returned.
+    bool mReporting = false;                 ///< True while a thread is calling the completion callback.
+    bool mTerminate = false;
+    Stats mStats;
+    Clock::time_point mStartTime;            ///< Time of the first submission since the last stats reset.
+};
+} // namespace Falcor
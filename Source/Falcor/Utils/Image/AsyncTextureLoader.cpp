@@ -27,6 +27,8 @@
  **************************************************************************/
 #include "AsyncTextureLoader.h"
 #include "Core/API/Device.h"
+#include "Core/Platform/OS.h"
+#include "Utils/Logger.h"
 #include "Utils/Threading.h"
 
 namespace Falcor
@@ -34,18 +36,96 @@ namespace Falcor
 namespace
 {
 constexpr size_t kUploadsPerFlush = 16; ///< Number of texture uploads before issuing a flush (to keep upload heap from growing).
-}
 
-AsyncTextureLoader::AsyncTextureLoader(ref<Device> pDevice, size_t threadCount) : mpDevice(pDevice)
+/**
+ * Backend loading textures from file and uploading them to a GPU device.
+ * Single non-DDS files are decoded to a bitmap before the upload. DDS files and mips loaded from individual files
+ * are loaded entirely in the upload stage, so their data is not counted as in flight.
+ */
+class DeviceBackend : public AsyncTextureLoader::Backend
 {
+public:
+    DeviceBackend(ref<Device> pDevice) : mpDevice(pDevice) {}
+
+    std::unique_ptr<AsyncTextureLoader::DecodedTexture> decode(const AsyncTextureLoader::LoadDesc& desc) override
+    {
+        auto pData = std::make_unique<DecodedBitmap>();
+        if (desc.paths.size() == 1 && !hasExtension(desc.paths[0], "dds"))
+        {
+            const auto& path = desc.paths[0];
+            if (!std::filesystem::exists(path))
+            {
+                logWarning("Error when loading image file. File '{}' does not exist.", path);
+                return nullptr;
+            }
+            pData->pBitmap = Bitmap::createFromFile(path, true, desc.importFlags, mpDevice->getHDRImageDecoder());
+            if (!pData->pBitmap)
+                return nullptr;
+            pData->sizeInBytes = pData->pBitmap->getSize();
+        }
+        return pData;
+    }
+
+    ref<Texture> upload(const AsyncTextureLoader::LoadDesc& desc, AsyncTextureLoader::DecodedTexture& data) override
+    {
+        const Bitmap* pBitmap = static_cast<const DecodedBitmap&>(data).pBitmap.get();
+        if (!pBitmap)
+        {
+            if (desc.paths.size() == 1)
+                return Texture::createFromFile(mpDevice, desc.paths[0], desc.generateMipLevels, desc.loadAsSRGB, desc.bindFlags, desc.importFlags);
+            else
+                return Texture::createMippedFromFiles(mpDevice, desc.paths, desc.loadAsSRGB, desc.bindFlags, desc.importFlags);
+        }
+
+        ResourceFormat texFormat = pBitmap->getFormat();
+        if (desc.loadAsSRGB)
+            texFormat = linearToSrgbFormat(texFormat);
+
+        ref<Texture> pTexture = mpDevice->createTexture2D(
+            pBitmap->getWidth(),
+            pBitmap->getHeight(),
+            texFormat,
+            1,
+            desc.generateMipLevels ? Texture::kMaxPossible : 1,
+            pBitmap->getData(),
+            desc.bindFlags
+        );
+        pTexture->setSourcePath(desc.paths[0]);
+        pTexture->setImportFlags(desc.importFlags);
+        return pTexture;
+    }
+
+    void flush() override { mpDevice->wait(); }
+
+private:
+    struct DecodedBitmap : AsyncTextureLoader::DecodedTexture
+    {
+        Bitmap::UniqueConstPtr pBitmap; ///< Decoded bitmap, or nullptr if the texture is loaded in the upload stage.
+    };
+
+    ref<Device> mpDevice;
+};
+} // namespace
+
+AsyncTextureLoader::AsyncTextureLoader(ref<Device> pDevice, size_t threadCount) : mpBackend(std::make_unique<DeviceBackend>(pDevice))
+{
+    mOptions.threadCount = threadCount;
     runWorkers(threadCount);
 }
 
+AsyncTextureLoader::AsyncTextureLoader(std::unique_ptr<Backend> pBackend, const Options& options)
+    : mpBackend(std::move(pBackend)), mOptions(options)
+{
+    FALCOR_CHECK(mpBackend, "Missing backend.");
+    FALCOR_CHECK(mOptions.threadCount > 0, "'threadCount' must be at least 1.");
+    runWorkers(mOptions.threadCount);
+}
+
 AsyncTextureLoader::~AsyncTextureLoader()
 {
     terminateWorkers();
 
-    mpDevice->wait();
+    mpBackend->flush();
 }
 
 std::future<ref<Texture>> AsyncTextureLoader::loadMippedFromFiles(
@@ -53,13 +133,11 @@ std::future<ref<Texture>> AsyncTextureLoader::loadMippedFromFiles(
     bool loadAsSrgb,
     ResourceBindFlags bindFlags,
     Bitmap::ImportFlags importFlags,
-    LoadCallback callback
+    LoadCallback callback,
+    const LoadOptions& loadOptions
 )
 {
-    std::lock_guard<std::mutex> lock(mMutex);
-    mLoadRequestQueue.push(LoadRequest{{paths.begin(), paths.end()}, false, loadAsSrgb, bindFlags, importFlags, callback});
-    mCondition.notify_one();
-    return mLoadRequestQueue.back().promise.get_future();
+    return load(LoadDesc{{paths.begin(), paths.end()}, false, loadAsSrgb, bindFlags, importFlags}, std::move(callback), loadOptions);
 }
 
 std::future<ref<Texture>> AsyncTextureLoader::loadFromFile(
@@ -68,13 +146,31 @@ std::future<ref<Texture>> AsyncTextureLoader::loadFromFile(
     bool loadAsSrgb,
     ResourceBindFlags bindFlags,
     Bitmap::ImportFlags importFlags,
-    LoadCallback callback
+    LoadCallback callback,
+    const LoadOptions& loadOptions
 )
+{
+    return load(LoadDesc{{path}, generateMipLevels, loadAsSrgb, bindFlags, importFlags}, std::move(callback), loadOptions);
+}
+
+std::future<ref<Texture>> AsyncTextureLoader::load(LoadDesc desc, LoadCallback callback, const LoadOptions& loadOptions)
 {
     std::lock_guard<std::mutex> lock(mMutex);
-    mLoadRequestQueue.push(LoadRequest{{path}, generateMipLevels, loadAsSrgb, bindFlags, importFlags, callback});
+    const QueueKey key{-loadOptions.priority, loadOptions.deadline, mRequestCounter++};
+    auto& request = mLoadRequestQueue[key];
+    request = LoadRequest{std::move(desc), loadOptions, std::move(callback), {}, Clock::now()};
+    mStats.maxQueueDepth = std::max(mStats.maxQueueDepth, mLoadRequestQueue.size());
     mCondition.notify_one();
-    return mLoadRequestQueue.back().promise.get_future();
+    return request.promise.get_future();
+}
+
+AsyncTextureLoader::Stats AsyncTextureLoader::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    Stats stats = mStats;
+    stats.queueDepth = mLoadRequestQueue.size();
+    stats.averageLatency = stats.completedCount > 0 ? mTotalLatency / stats.completedCount : 0.0;
+    return stats;
 }
 
 void AsyncTextureLoader::runWorkers(size_t threadCount)
@@ -84,7 +180,7 @@ void AsyncTextureLoader::runWorkers(size_t threadCount)
         threadCount,
         [&]()
         {
-            mpDevice->wait();
+            mpBackend->flush();
             mFlushPending = false;
             mUploadCounter = 0;
         }
@@ -96,10 +192,20 @@ void AsyncTextureLoader::runWorkers(size_t threadCount)
     }
 }
 
+bool AsyncTextureLoader::canStartRequest() const
+{
+    if (mLoadRequestQueue.empty())
+        return false;
+
+    // Cancelled requests don't decode any data, so they are started even if the budget is exhausted.
+    return mStats.bytesInFlight < mOptions.maxBytesInFlight || mLoadRequestQueue.begin()->second.options.cancellationToken.isCancelled();
+}
+
 void AsyncTextureLoader::runWorker()
 {
     // This function is the entry point for worker threads.
     // The workers wait on the load request queue and load a texture when woken up.
+    // To bound memory use, workers wait before decoding while the decoded data in flight exceeds the budget.
     // To avoid the upload heap growing too large, we synchronize the threads and
     // issue a global GPU flush at regular intervals.
 
@@ -107,7 +213,7 @@ void AsyncTextureLoader::runWorker()
     {
         // Wait on condition until more work is ready.
         std::unique_lock<std::mutex> lock(mMutex);
-        mCondition.wait(lock, [&]() { return mTerminate || !mLoadRequestQueue.empty() || mFlushPending; });
+        mCondition.wait(lock, [&]() { return (mTerminate && mLoadRequestQueue.empty()) || mFlushPending || canStartRequest(); });
 
         // Sync thread if a flush is pending.
         if (mFlushPending)
@@ -119,50 +225,74 @@ void AsyncTextureLoader::runWorker()
         }
 
         // Terminate thread unless there is more work to do.
-        if (mTerminate && mLoadRequestQueue.empty() && !mFlushPending)
+        if (mTerminate && mLoadRequestQueue.empty())
             break;
 
-        // Go back waiting if queue is currently empty.
-        if (mLoadRequestQueue.empty())
-            continue;
-
         // Pop next load request from queue.
-        auto request = std::move(mLoadRequestQueue.front());
-        mLoadRequestQueue.pop();
+        auto it = mLoadRequestQueue.begin();
+        auto request = std::move(it->second);
+        mLoadRequestQueue.erase(it);
 
         lock.unlock();
 
-        // Load the textures (this part is running in parallel).
+        // Decode and upload the texture (this part is running in parallel).
+        // Cancellation is checked before each stage.
         ref<Texture> pTexture;
-        if (request.paths.size() == 1)
+        bool cancelled = request.options.cancellationToken.isCancelled();
+        uint64_t decodedSize = 0;
+        if (!cancelled)
         {
-            pTexture = Texture::createFromFile(
-                mpDevice, request.paths[0], request.generateMipLevels, request.loadAsSRGB, request.bindFlags, request.importFlags
-            );
-        }
-        else
-        {
-            pTexture = Texture::createMippedFromFiles(mpDevice, request.paths, request.loadAsSRGB, request.bindFlags, request.importFlags);
+            std::unique_ptr<DecodedTexture> pData = mpBackend->decode(request.desc);
+            if (pData)
+            {
+                decodedSize = pData->sizeInBytes;
+                lock.lock();
+                mStats.bytesInFlight += decodedSize;
+                mStats.maxBytesInFlight = std::max(mStats.maxBytesInFlight, mStats.bytesInFlight);
+                lock.unlock();
+
+                cancelled = request.options.cancellationToken.isCancelled();
+                if (!cancelled)
+                    pTexture = mpBackend->upload(request.desc, *pData);
+            }
         }
 
-        request.promise.set_value(pTexture);
+        lock.lock();
 
-        if (request.callback)
+        // Release the decoded data and record stats.
+        mStats.bytesInFlight -= decodedSize;
+        if (cancelled)
         {
-            request.callback(pTexture);
+            mStats.cancelledCount++;
+        }
+        else
+        {
+            const auto now = Clock::now();
+            const double latency = std::chrono::duration<double>(now - request.requestTime).count();
+            mStats.completedCount++;
+            mStats.maxLatency = std::max(mStats.maxLatency, latency);
+            mTotalLatency += latency;
+            if (now > request.options.deadline)
+                mStats.missedDeadlineCount++;
         }
-
-        lock.lock();
 
         // Issue a global flush if necessary.
         // TODO: It would be better to check the size of the upload heap instead.
         if (!mTerminate && pTexture != nullptr && ++mUploadCounter >= kUploadsPerFlush)
         {
             mFlushPending = true;
-            mCondition.notify_all();
         }
 
-        mCondition.notify_one();
+        // Wake up all workers, as releasing the decoded data may allow several of them to start.
+        lock.unlock();
+        mCondition.notify_all();
+
+        request.promise.set_value(pTexture);
+
+        if (request.callback)
+        {
+            request.callback(pTexture);
+        }
     }
 }
 
@@ -30,13 +30,17 @@
 #include "Core/API/fwd.h"
 #include "Core/API/Resource.h"
 #include "Core/API/Texture.h"
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <filesystem>
 #include <functional>
 #include <future>
+#include <map>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
+#include <tuple>
 #include <vector>
 #include <fstd/span.h>
 
@@ -46,11 +50,122 @@ class Barrier;
 
 /**
  * Utility class to load textures asynchronously using multiple worker threads.
+ *
+ * Requests are processed in order of priority, then deadline, then submission. Each load is split in two stages:
+ * the texture data is decoded on the CPU and then uploaded to the GPU. The size of decoded data that has not been
+ * uploaded yet is limited by Options::maxBytesInFlight: workers wait before decoding the next request while the
+ * budget is exceeded. This is a soft bound, as the size of a texture is only known once it has been decoded, so
+ * the requests being decoded when the budget is reached can exceed it. Requests can be cancelled with a
+ * CancellationToken until their upload starts.
+ *
+ * The stages are implemented by a Backend, which defaults to loading from file and uploading to a GPU device.
  */
 class FALCOR_API AsyncTextureLoader
 {
 public:
     using LoadCallback = std::function<void(ref<Texture> pTexture)>;
+    using Clock = std::chrono::steady_clock;
+
+    struct Options
+    {
+        /// Number of worker threads.
+        size_t threadCount = std::thread::hardware_concurrency();
+        /// Maximum size in bytes of decoded texture data not yet uploaded. A request is always decoded if no data is in flight.
+        /// Soft bound: data is counted after decoding, so concurrent decodes can exceed it by up to one texture per worker.
+        uint64_t maxBytesInFlight = 512ull * 1024 * 1024;
+
+        // Note: Empty constructor needed for clang due to the use of the nested struct constructor in the parent constructor.
+        Options() {}
+    };
+
+    /**
+     * Token to cancel load requests.
+     * Copies share their state, so a single token can cancel any number of requests.
+     */
+    class CancellationToken
+    {
+    public:
+        CancellationToken() : mpCancelled(std::make_shared<std::atomic<bool>>(false)) {}
+
+        void cancel() { mpCancelled->store(true); }
+        bool isCancelled() const { return mpCancelled->load(); }
+
+    private:
+        std::shared_ptr<std::atomic<bool>> mpCancelled;
+    };
+
+    /// Scheduling options of a load request.
+    struct LoadOptions
+    {
+        /// Requests with higher priority are loaded first.
+        int32_t priority = 0;
+        /// Among requests of equal priority, the earliest deadline is loaded first. Requests are loaded even if past their deadline.
+        Clock::time_point deadline = Clock::time_point::max();
+        /// Token to cancel the request. Cancelled requests complete with nullptr.
+        CancellationToken cancellationToken;
+
+        // Note: Empty constructor needed for clang due to the use of the nested struct constructor in the parent constructor.
+        LoadOptions() {}
+    };
+
+    /// Description of the texture to load.
+    struct LoadDesc
+    {
+        std::vector<std::filesystem::path> paths; ///< Path of the texture, or paths of all mips starting from mip0.
+        bool generateMipLevels = false;
+        bool loadAsSRGB = false;
+        ResourceBindFlags bindFlags = ResourceBindFlags::ShaderResource;
+        Bitmap::ImportFlags importFlags = Bitmap::ImportFlags::None;
+    };
+
+    /// Decoded texture data. Backends derive from this to hold their data.
+    struct DecodedTexture
+    {
+        uint64_t sizeInBytes = 0; ///< Size of the decoded data, counted against Options::maxBytesInFlight.
+
+        virtual ~DecodedTexture() = default;
+    };
+
+    /**
+     * Interface implementing the stages of a texture load.
+     * All functions are called from the worker threads, concurrently for different requests.
+     */
+    class Backend
+    {
+    public:
+        virtual ~Backend() = default;
+
+        /**
+         * Decode the data of a texture.
+         * @return Decoded data, or nullptr if the texture failed to load.
+         */
+        virtual std::unique_ptr<DecodedTexture> decode(const LoadDesc& desc) = 0;
+
+        /**
+         * Create a texture from decoded data.
+         * @return The texture, or nullptr if the texture failed to load.
+         */
+        virtual ref<Texture> upload(const LoadDesc& desc, DecodedTexture& data) = 0;
+
+        /**
+         * Wait for previous uploads to finish. This is called every few uploads while all workers are synchronized,
+         * to keep the upload heap from growing.
+         */
+        virtual void flush() {}
+    };
+
+    struct Stats
+    {
+        size_t queueDepth = 0;              ///< Number of requests waiting in the queue.
+        size_t maxQueueDepth = 0;           ///< Maximum number of requests waiting in the queue.
+        uint64_t bytesInFlight = 0;         ///< Size in bytes of decoded data not yet uploaded.
+        uint64_t maxBytesInFlight = 0;      ///< Maximum size in bytes of decoded data not yet uploaded.
+        uint64_t completedCount = 0;        ///< Number of completed requests, including failed loads but not cancelled requests.
+        uint64_t cancelledCount = 0;        ///< Number of cancelled requests.
+        uint64_t missedDeadlineCount = 0;   ///< Number of requests completed after their deadline.
+        double averageLatency = 0.0;        ///< Average time in seconds from request to completion of completed requests.
+        double maxLatency = 0.0;            ///< Maximum time in seconds from request to completion of completed requests.
+    };
 
     /**
      * Constructor.
@@ -58,9 +173,16 @@ public:
      */
     AsyncTextureLoader(ref<Device> pDevice, size_t threadCount = std::thread::hardware_concurrency());
 
+    /**
+     * Constructor.
+     * @param[in] pBackend Backend implementing the decode and upload stages.
+     * @param[in] options Options.
+     */
+    AsyncTextureLoader(std::unique_ptr<Backend> pBackend, const Options& options = Options());
+
     /**
      * Destructor.
-     * Blocks until all threads have terminated.
+     * Blocks until all queued requests have completed and all threads have terminated.
      */
     ~AsyncTextureLoader();
 
@@ -71,6 +193,7 @@ public:
      * @param[in] bindFlags The bind flags for the texture resource.
      * @param[in] importFlags Optional flags for the file import.
      * @param[in] callback Function called after the texture load has finished.
+     * @param[in] loadOptions Scheduling options.
      * @return A future to a new texture, or nullptr if the texture failed to load.
      */
     std::future<ref<Texture>> loadMippedFromFiles(
@@ -78,7 +201,8 @@ public:
         bool loadAsSRGB,
         ResourceBindFlags bindFlags = ResourceBindFlags::ShaderResource,
         Bitmap::ImportFlags importFlags = Bitmap::ImportFlags::None,
-        LoadCallback callback = {}
+        LoadCallback callback = {},
+        const LoadOptions& loadOptions = LoadOptions()
     );
 
     /**
@@ -89,6 +213,7 @@ public:
      * @param[in] bindFlags The bind flags for the texture resource.
      * @param[in] importFlags Optional flags for the file import.
      * @param[in] callback Function called after the texture load has finished.
+     * @param[in] loadOptions Scheduling options.
      * @return A future to a new texture, or nullptr if the texture failed to load.
      */
     std::future<ref<Texture>> loadFromFile(
@@ -97,34 +222,54 @@ public:
         bool loadAsSRGB,
         ResourceBindFlags bindFlags = ResourceBindFlags::ShaderResource,
         Bitmap::ImportFlags importFlags = Bitmap::ImportFlags::None,
-        LoadCallback callback = {}
+        LoadCallback callback = {},
+        const LoadOptions& loadOptions = LoadOptions()
     );
 
+    /**
+     * Request loading a texture.
+     * @param[in] desc Description of the texture.
+     * @param[in] callback Function called after the texture load has finished, or the request was cancelled.
+     * @param[in] loadOptions Scheduling options.
+     * @return A future to a new texture, or nullptr if the texture failed to load or the request was cancelled.
+     */
+    std::future<ref<Texture>> load(LoadDesc desc, LoadCallback callback = {}, const LoadOptions& loadOptions = LoadOptions());
+
+    const Options& getOptions() const { return mOptions; }
+
+    Stats getStats() const;
+
 private:
     void runWorkers(size_t threadCount);
     void runWorker();
     void terminateWorkers();
+    bool canStartRequest() const;
 
     struct LoadRequest
     {
-        std::vector<std::filesystem::path> paths;
-        bool generateMipLevels;
-        bool loadAsSRGB;
-        ResourceBindFlags bindFlags;
-        Bitmap::ImportFlags importFlags;
+        LoadDesc desc;
+        LoadOptions options;
         LoadCallback callback;
         std::promise<ref<Texture>> promise;
+        Clock::time_point requestTime;
     };
 
-    ref<Device> mpDevice;
+    /// Queue order: highest priority first, then earliest deadline, then submission order.
+    using QueueKey = std::tuple<int32_t, Clock::time_point, uint64_t>;
+
+    std::unique_ptr<Backend> mpBackend;
+    Options mOptions;
 
-    std::mutex mMutex;                      ///< Mutex for synchronizing access to shared resources.
+    mutable std::mutex mMutex;              ///< Mutex for synchronizing access to shared resources.
     std::condition_variable mCondition;     ///< Condition variable for workers to wait on.
     std::shared_ptr<Barrier> mFlushBarrier; ///< Barrier for flushing the GPU to upload textures.
     std::vector<std::thread> mThreads;      ///< Worker threads.
 
     // Internal state. Do not access outside of critical section.
-    std::queue<LoadRequest> mLoadRequestQueue; ///< Texture loading request queue.
+    std::map<QueueKey, LoadRequest> mLoadRequestQueue; ///< Texture loading request queue.
+    uint64_t mRequestCounter = 0;                      ///< Number of submitted requests, used to keep the queue order stable.
+    Stats mStats;
+    double mTotalLatency = 0.0;
 
     bool mTerminate = false;     ///< Flag to terminate worker threads.
     bool mFlushPending = false;  ///< Flag to indicate a GPU flush is pending.
@@ -26,6 +26,7 @@
  # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  **************************************************************************/
 #include "Bitmap.h"
+#include "HDRImageDecoder.h"
 #include "Core/Macros.h"
 #include "Core/API/Texture.h"
 #include "Core/Platform/MemoryMappedFile.h"
@@ -237,7 +238,12 @@ Bitmap::UniqueConstPtr Bitmap::create(uint32_t width, uint32_t height, ResourceF
     return Bitmap::UniqueConstPtr(new Bitmap(width, height, format, pData));
 }
 
-Bitmap::UniqueConstPtr Bitmap::createFromFile(const std::filesystem::path& path, bool isTopDown, ImportFlags importFlags)
+Bitmap::UniqueConstPtr Bitmap::createFromFile(
+    const std::filesystem::path& path,
+    bool isTopDown,
+    ImportFlags importFlags,
+    const HDRImageDecoder* pHDRImageDecoder
+)
 {
     if (!std::filesystem::exists(path))
     {
@@ -245,6 +251,13 @@ Bitmap::UniqueConstPtr Bitmap::createFromFile(const std::filesystem::path& path,
         return nullptr;
     }
 
+    // Decode EXR and HDR images in parallel directly into the final format. Unsupported variants fall back to FreeImage.
+    if (pHDRImageDecoder && !is_set(importFlags, ImportFlags::ForceFreeImage) && HDRImageDecoder::isSupported(path))
+    {
+        if (auto pBmp = pHDRImageDecoder->decode(path, isTopDown, importFlags))
+            return pBmp;
+    }
+
     FREE_IMAGE_FORMAT fifFormat = FIF_UNKNOWN;
 
     fifFormat = FreeImage_GetFileType(path.string().c_str(), 0);
@@ -35,6 +35,7 @@
 namespace Falcor
 {
 class Texture;
+class HDRImageDecoder;
 
 /**
  * A class representing a memory bitmap
@@ -54,6 +55,7 @@ public:
     {
         None = 0u,                  ///< Default.
         ConvertToFloat16 = 1u << 0, ///< Convert HDR images to 16-bit float per channel on import.
+        ForceFreeImage = 1u << 1,   ///< Always decode with FreeImage, bypassing the HDRImageDecoder passed to createFromFile().
     };
 
     enum class FileFormat
@@ -87,9 +89,16 @@ public:
      * @param[in] isTopDown Control the memory layout of the image. If true, the top-left pixel is the first pixel in the buffer, otherwise
      * the bottom-left pixel is first.
      * @param[in] importFlags Flags to control how the file is imported. See ImportFlags above.
+     * @param[in] pHDRImageDecoder Decoder used for EXR and HDR images (see Device::getHDRImageDecoder()), or nullptr to decode all images
+     * with FreeImage.
      * @return If loading was successful, a new object. Otherwise, nullptr.
      */
-    static UniqueConstPtr createFromFile(const std::filesystem::path& path, bool isTopDown, ImportFlags importFlags = ImportFlags::None);
+    static UniqueConstPtr createFromFile(
+        const std::filesystem::path& path,
+        bool isTopDown,
+        ImportFlags importFlags = ImportFlags::None,
+        const HDRImageDecoder* pHDRImageDecoder = nullptr
+    );
 
     /**
      * Store a memory buffer to a file.
@@ -167,6 +176,8 @@ protected:
     uint32_t mRowPitch = 0; ///< Row pitch in bytes.
     uint32_t mSize = 0;     ///< Total size in bytes.
     ResourceFormat mFormat = ResourceFormat::Unknown;
+
+    friend class HDRImageDecoder;
 };
 
 FALCOR_ENUM_CLASS_OPERATORS(Bitmap::ExportFlags);
@@ -0,0 +1,518 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "HDRImageDecoder.h"
+#include "Core/Platform/MemoryMappedFile.h"
+#include "Core/Platform/OS.h"
+#include "Utils/Logger.h"
+#include "Utils/Math/Float16.h"
+#include "Utils/ParallelFor.h"
+
+#include <BS_thread_pool.hpp>
+
+#include <ImfChannelList.h>
+#include <ImfFrameBuffer.h>
+#include <ImfHeader.h>
+#include <ImfIO.h>
+#include <ImfInputFile.h>
+#include <ImfPartType.h>
+#include <ImfTileDescription.h>
+#include <IexBaseExc.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+/// Minimum number of scanlines decoded by a single task.
+const uint32_t kMinBlockRows = 32;
+
+/// Row of the destination bitmap a row of the image is written to.
+uint32_t getDstRow(uint32_t y, uint32_t height, bool isTopDown)
+{
+    return isTopDown ? y : height - 1 - y;
+}
+
+/// Convert a row of RGBA floats to RGBA16Float, using the same rounding as the FreeImage import path.
+void convertRowToFloat16(const float* pSrc, uint16_t* pDst, uint32_t width)
+{
+    for (uint32_t i = 0; i < width * 4; ++i)
+        pDst[i] = math::float16_t(pSrc[i]).toBits();
+}
+
+/**
+ * OpenEXR input stream reading from a memory-mapped file.
+ * Reporting the stream as memory-mapped lets OpenEXR read chunks in place instead of copying them.
+ */
+class MemoryIStream : public Imf::IStream
+{
+public:
+    MemoryIStream(const std::string& fileName, const uint8_t* pData, size_t size)
+        : Imf::IStream(fileName.c_str()), mpData(reinterpret_cast<const char*>(pData)), mSize(size)
+    {}
+
+    bool isMemoryMapped() const override { return true; }
+
+    bool read(char c[], int n) override
+    {
+        checkRange(n);
+        std::memcpy(c, mpData + mPos, n);
+        mPos += n;
+        return mPos < mSize;
+    }
+
+    char* readMemoryMapped(int n) override
+    {
+        checkRange(n);
+        // OpenEXR only reads from the returned pointer.
+        char* p = const_cast<char*>(mpData + mPos);
+        mPos += n;
+        return p;
+    }
+
+    uint64_t tellg() override { return mPos; }
+    void seekg(uint64_t pos) override { mPos = pos; }
+
+private:
+    void checkRange(int n) const
+    {
+        if (n < 0 || mPos + n > mSize)
+            throw Iex::InputExc("Unexpected end of file.");
+    }
+
+    const char* mpData;
+    uint64_t mSize;
+    uint64_t mPos = 0;
+};
+
+/// Number of scanlines per chunk of a scanline EXR file.
+uint32_t getExrChunkRows(Imf::Compression compression)
+{
+    switch (compression)
+    {
+    case Imf::ZIP_COMPRESSION:
+    case Imf::PXR24_COMPRESSION:
+        return 16;
+    case Imf::PIZ_COMPRESSION:
+    case Imf::B44_COMPRESSION:
+    case Imf::B44A_COMPRESSION:
+    case Imf::DWAA_COMPRESSION:
+        return 32;
+    case Imf::DWAB_COMPRESSION:
+        return 256;
+    default:
+        return 1;
+    }
+}
+
+/// Header of a Radiance HDR file.
+struct HdrHeader
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    size_t dataOffset = 0; ///< Offset of the first scanline.
+};
+
+bool readHdrLine(const uint8_t* pData, size_t size, size_t& pos, std::string_view& line)
+{
+    const uint8_t* pEnd = static_cast<const uint8_t*>(std::memchr(pData + pos, '\n', size - pos));
+    if (!pEnd)
+        return false;
+    line = std::string_view(reinterpret_cast<const char*>(pData + pos), pEnd - (pData + pos));
+    pos = pEnd - pData + 1;
+    return true;
+}
+
+/// Parse the header and resolution string. Only the standard orientation (-Y height +X width) is supported.
+bool parseHdrHeader(const uint8_t* pData, size_t size, HdrHeader& header)
+{
+    size_t pos = 0;
+    std::string_view line;
+    if (!readHdrLine(pData, size, pos, line) || line.substr(0, 2) != "#?")
+        return false;
+
+    // Header variables end with an empty line. Besides the format, they only hold metadata FreeImage ignores as well.
+    while (true)
+    {
+        if (!readHdrLine(pData, size, pos, line))
+            return false;
+        if (line.empty())
+            break;
+        if (line.substr(0, 7) == "FORMAT=" && line.substr(7) != "32-bit_rle_rgbe")
+            return false;
+    }
+
+    if (!readHdrLine(pData, size, pos, line))
+        return false;
+    unsigned int width = 0, height = 0;
+    char tail = 0;
+    if (std::sscanf(std::string(line).c_str(), "-Y %u +X %u%c", &height, &width, &tail) != 2 || width == 0 || height == 0)
+        return false;
+
+    header.width = width;
+    header.height = height;
+    header.dataOffset = pos;
+    return true;
+}
+
+/// Check if a scanline of the given width can be run-length encoded.
+bool isHdrRleWidth(uint32_t width)
+{
+    return width >= 8 && width <= 0x7fff;
+}
+
+/**
+ * Find the offsets of all scanlines, validating the run-length encoding on the way.
+ * As in FreeImage, a scanline without a run-length encoding marker starts a block of flat pixels covering the rest
+ * of the image.
+ * @param[out] offsets Offsets of the scanlines, with an additional entry for the end of the data.
+ * @param[out] firstFlatRow First scanline stored as flat pixels, or the height if all scanlines are encoded.
+ * @return False if the data is truncated or invalid.
+ */
+bool findHdrScanlines(const uint8_t* pData, size_t size, const HdrHeader& header, std::vector<size_t>& offsets, uint32_t& firstFlatRow)
+{
+    const uint32_t width = header.width;
+    offsets.resize(header.height + 1);
+    firstFlatRow = isHdrRleWidth(width) ? header.height : 0;
+
+    size_t pos = header.dataOffset;
+    for (uint32_t y = 0; y < header.height; ++y)
+    {
+        offsets[y] = pos;
+        if (y < firstFlatRow)
+        {
+            if (pos + 4 > size)
+                return false;
+            const uint8_t* p = pData + pos;
+            if (p[0] != 2 || p[1] != 2 || (p[2] & 0x80))
+            {
+                firstFlatRow = y;
+            }
+            else
+            {
+                if (((uint32_t(p[2]) << 8) | p[3]) != width)
+                    return false;
+                pos += 4;
+                for (uint32_t c = 0; c < 4; ++c)
+                {
+                    for (uint32_t x = 0; x < width;)
+                    {
+                        if (pos >= size)
+                            return false;
+                        uint32_t count = pData[pos];
+                        const bool isRun = count > 128;
+                        if (isRun)
+                            count -= 128;
+                        if (count == 0 || x + count > width)
+                            return false;
+                        pos += isRun ? 2 : 1 + count;
+                        x += count;
+                    }
+                }
+                if (pos > size)
+                    return false;
+            }
+        }
+        if (y >= firstFlatRow)
+        {
+            pos += size_t(width) * 4;
+            if (pos > size)
+                return false;
+        }
+    }
+    offsets[header.height] = pos;
+    return true;
+}
+
+/// Decode a scanline validated by findHdrScanlines() to interleaved RGBE.
+void decodeHdrScanline(const uint8_t* pSrc, uint32_t width, bool isFlat, uint8_t* pRgbe)
+{
+    if (isFlat)
+    {
+        std::memcpy(pRgbe, pSrc, size_t(width) * 4);
+        return;
+    }
+
+    pSrc += 4;
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        for (uint32_t x = 0; x < width;)
+        {
+            uint32_t count = *pSrc++;
+            if (count > 128)
+            {
+                count -= 128;
+                const uint8_t value = *pSrc++;
+                for (uint32_t i = 0; i < count; ++i)
+                    pRgbe[(x + i) * 4 + c] = value;
+            }
+            else
+            {
+                for (uint32_t i = 0; i < count; ++i)
+                    pRgbe[(x + i) * 4 + c] = *pSrc++;
+            }
+            x += count;
+        }
+    }
+}
+
+/// Scale factors for each RGBE exponent, computed as in FreeImage.
+std::array<float, 256> computeHdrExponentScales()
+{
+    std::array<float, 256> scales;
+    scales[0] = 0.f;
+    for (int e = 1; e < 256; ++e)
+        scales[e] = (float)std::ldexp(1.0, e - (128 + 8));
+    return scales;
+}
+
+void convertHdrRow(const uint8_t* pRgbe, uint32_t width, float* pDst)
+{
+    static const std::array<float, 256> kScales = computeHdrExponentScales();
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        const float scale = kScales[pRgbe[x * 4 + 3]];
+        pDst[x * 4 + 0] = pRgbe[x * 4 + 0] * scale;
+        pDst[x * 4 + 1] = pRgbe[x * 4 + 1] * scale;
+        pDst[x * 4 + 2] = pRgbe[x * 4 + 2] * scale;
+        pDst[x * 4 + 3] = 1.f;
+    }
+}
+} // namespace
+
+HDRImageDecoder::HDRImageDecoder(const Options& options) : mOptions(options)
+{
+    if (mOptions.threadCount != 1)
+        mpThreadPool = std::make_unique<BS::thread_pool>(mOptions.threadCount);
+}
+
+HDRImageDecoder::~HDRImageDecoder() = default;
+
+bool HDRImageDecoder::isSupported(const std::filesystem::path& path)
+{
+    return hasExtension(path, "exr") || hasExtension(path, "hdr");
+}
+
+Bitmap::UniqueConstPtr HDRImageDecoder::decode(const std::filesystem::path& path, bool isTopDown, Bitmap::ImportFlags importFlags) const
+{
+    if (!isSupported(path))
+        return nullptr;
+
+    MemoryMappedFile file(path, MemoryMappedFile::kWholeFile, MemoryMappedFile::AccessHint::SequentialScan);
+    if (!file.isOpen())
+        return nullptr;
+
+    const uint8_t* pData = static_cast<const uint8_t*>(file.getData());
+    const bool toFloat16 = is_set(importFlags, Bitmap::ImportFlags::ConvertToFloat16);
+    if (hasExtension(path, "exr"))
+        return decodeExr(path, pData, file.getSize(), isTopDown, toFloat16);
+    else
+        return decodeHdr(path, pData, file.getSize(), isTopDown, toFloat16);
+}
+
+Bitmap::UniqueConstPtr HDRImageDecoder::decodeExr(
+    const std::filesystem::path& path,
+    const uint8_t* pData,
+    size_t size,
+    bool isTopDown,
+    bool toFloat16
+) const
+{
+    const std::string fileName = path.string();
+    Imath::Box2i dataWindow;
+    Imf::PixelType readType = Imf::FLOAT;
+    bool hasAlpha = false;
+    uint32_t blockRows = 0;
+
+    try
+    {
+        MemoryIStream stream(fileName, pData, size);
+        Imf::InputFile file(stream, 0);
+        const Imf::Header& header = file.header();
+        if (header.hasType() && Imf::isDeepData(header.type()))
+            return nullptr;
+
+        bool allHalf = true;
+        for (const char* name : {"R", "G", "B", "A"})
+        {
+            const Imf::Channel* pChannel = header.channels().findChannel(name);
+            if (!pChannel)
+            {
+                if (name[0] != 'A')
+                    return nullptr;
+                continue;
+            }
+            if (pChannel->type == Imf::UINT || pChannel->xSampling != 1 || pChannel->ySampling != 1)
+                return nullptr;
+            allHalf &= pChannel->type == Imf::HALF;
+            hasAlpha |= name[0] == 'A';
+        }
+
+        // Half channels are read directly when converting to float16. Float channels are read as floats and rounded
+        // by float16_t to match the FreeImage path.
+        readType = toFloat16 && allHalf ? Imf::HALF : Imf::FLOAT;
+
+        // Align blocks to the chunks of the file so each chunk is decompressed by a single task.
+        const uint32_t chunkRows = header.hasTileDescription() ? header.tileDescription().ySize : getExrChunkRows(header.compression());
+        blockRows = std::max(1u, kMinBlockRows / chunkRows) * chunkRows;
+        dataWindow = header.dataWindow();
+    }
+    catch (const std::exception& e)
+    {
+        logDebug("HDRImageDecoder: Failed to read EXR header of '{}': {}", path, e.what());
+        return nullptr;
+    }
+
+    const uint32_t width = dataWindow.max.x - dataWindow.min.x + 1;
+    const uint32_t height = dataWindow.max.y - dataWindow.min.y + 1;
+    const ResourceFormat format = toFloat16 ? ResourceFormat::RGBA16Float : ResourceFormat::RGBA32Float;
+    Bitmap::UniquePtr pBitmap(new Bitmap(width, height, format));
+    uint8_t* pDst = pBitmap->getData();
+    const size_t rowPitch = pBitmap->getRowPitch();
+
+    // Blocks are read straight into the bitmap if they do not need flipping or conversion, otherwise via a temporary buffer.
+    const size_t readPixelSize = readType == Imf::HALF ? 8 : 16;
+    const bool readDirect = isTopDown && readPixelSize * width == rowPitch;
+    const uint32_t blockCount = (height + blockRows - 1) / blockRows;
+    std::atomic<bool> failed{false};
+
+    auto readBlocks = [&](uint32_t beginBlock, uint32_t endBlock)
+    {
+        try
+        {
+            MemoryIStream stream(fileName, pData, size);
+            Imf::InputFile file(stream, 0);
+            std::vector<uint8_t> buffer(readDirect ? 0 : blockRows * width * readPixelSize);
+
+            for (uint32_t block = beginBlock; block < endBlock && !failed; ++block)
+            {
+                const uint32_t y0 = block * blockRows;
+                const uint32_t y1 = std::min(y0 + blockRows, height);
+
+                // The frame buffer is addressed with data window coordinates, offset the base pointer accordingly.
+                uint8_t* pBlock = readDirect ? pDst + y0 * rowPitch : buffer.data();
+                const size_t yStride = readDirect ? rowPitch : width * readPixelSize;
+                const size_t channelSize = readPixelSize / 4;
+                char* pBase = reinterpret_cast<char*>(pBlock) - ptrdiff_t(dataWindow.min.x) * readPixelSize -
+                              ptrdiff_t(dataWindow.min.y + y0) * yStride;
+
+                Imf::FrameBuffer frameBuffer;
+                const char* names[] = {"R", "G", "B", "A"};
+                for (uint32_t c = 0; c < 4; ++c)
+                    frameBuffer.insert(names[c], Imf::Slice(readType, pBase + c * channelSize, readPixelSize, yStride, 1, 1, 1.0));
+                file.setFrameBuffer(frameBuffer);
+                file.readPixels(dataWindow.min.y + y0, dataWindow.min.y + y1 - 1);
+
+                if (readDirect)
+                    continue;
+                for (uint32_t y = y0; y < y1; ++y)
+                {
+                    const uint8_t* pSrcRow = buffer.data() + (y - y0) * yStride;
+                    uint8_t* pDstRow = pDst + getDstRow(y, height, isTopDown) * rowPitch;
+                    if (toFloat16 && readType == Imf::FLOAT)
+                        convertRowToFloat16(reinterpret_cast<const float*>(pSrcRow), reinterpret_cast<uint16_t*>(pDstRow), width);
+                    else
+                        std::memcpy(pDstRow, pSrcRow, yStride);
+                }
+            }
+        }
+        catch (const std::exception& e)
+        {
+            logDebug("HDRImageDecoder: Failed to read EXR image '{}': {}", path, e.what());
+            failed = true;
+        }
+    };
+    parallelFor(mpThreadPool.get(), blockCount, readBlocks);
+
+    if (failed)
+        return nullptr;
+    return pBitmap;
+}
+
+Bitmap::UniqueConstPtr HDRImageDecoder::decodeHdr(
+    const std::filesystem::path& path,
+    const uint8_t* pData,
+    size_t size,
+    bool isTopDown,
+    bool toFloat16
+) const
+{
+    HdrHeader header;
+    if (!parseHdrHeader(pData, size, header))
+    {
+        logDebug("HDRImageDecoder: Unsupported HDR header in '{}'.", path);
+        return nullptr;
+    }
+
+    std::vector<size_t> offsets;
+    uint32_t firstFlatRow = 0;
+    if (!findHdrScanlines(pData, size, header, offsets, firstFlatRow))
+    {
+        logDebug("HDRImageDecoder: Invalid or unsupported HDR scanline encoding in '{}'.", path);
+        return nullptr;
+    }
+
+    const uint32_t width = header.width;
+    const uint32_t height = header.height;
+    const ResourceFormat format = toFloat16 ? ResourceFormat::RGBA16Float : ResourceFormat::RGBA32Float;
+    Bitmap::UniquePtr pBitmap(new Bitmap(width, height, format));
+    uint8_t* pDst = pBitmap->getData();
+    const size_t rowPitch = pBitmap->getRowPitch();
+
+    auto decodeRows = [&](uint32_t y0, uint32_t y1)
+    {
+        std::vector<uint8_t> rgbe(size_t(width) * 4);
+        std::vector<float> row(toFloat16 ? size_t(width) * 4 : 0);
+        for (uint32_t y = y0; y < y1; ++y)
+        {
+            decodeHdrScanline(pData + offsets[y], width, y >= firstFlatRow, rgbe.data());
+            uint8_t* pDstRow = pDst + getDstRow(y, height, isTopDown) * rowPitch;
+            if (toFloat16)
+            {
+                convertHdrRow(rgbe.data(), width, row.data());
+                convertRowToFloat16(row.data(), reinterpret_cast<uint16_t*>(pDstRow), width);
+            }
+            else
+            {
+                convertHdrRow(rgbe.data(), width, reinterpret_cast<float*>(pDstRow));
+            }
+        }
+    };
+    parallelFor(mpThreadPool.get(), height, decodeRows);
+
+    return pBitmap;
+}
+} // namespace Falcor
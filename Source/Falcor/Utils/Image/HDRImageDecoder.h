@@ -0,0 +1,101 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Bitmap.h"
+#include "Core/Macros.h"
+#include <filesystem>
+#include <memory>
+
+namespace BS
+{
+class thread_pool;
+}
+
+namespace Falcor
+{
+/**
+ * Multithreaded decoder for OpenEXR and Radiance HDR images.
+ *
+ * Large HDR images such as environment maps are slow to load through FreeImage, which decodes on a single thread
+ * into an intermediate image that is then converted and copied again. This decoder writes directly into a Bitmap
+ * in the final resource format, in parallel over blocks of scanlines.
+ *
+ * OpenEXR files are read with the OpenEXR library. Each thread reads its own blocks, which are aligned to the
+ * compressed chunks (or tile rows) of the file so no chunk is decompressed twice. Radiance HDR files are scanned once
+ * to locate the run-length encoded scanlines, which are then decoded in parallel.
+ *
+ * The output matches Bitmap::createFromFile() using FreeImage: RGBA32Float, or RGBA16Float with
+ * Bitmap::ImportFlags::ConvertToFloat16, with alpha set to 1 if the image has none. Images the decoder does not
+ * handle (e.g. EXR files without RGB channels, deep or subsampled EXR images, XYZE or old-style run-length encoded
+ * HDR images) are rejected so the caller can fall back to FreeImage.
+ */
+class FALCOR_API HDRImageDecoder
+{
+public:
+    struct Options
+    {
+        /// Number of threads. 0 uses the hardware concurrency.
+        uint32_t threadCount = 0;
+
+        // Note: Empty constructor needed for clang due to the use of the nested struct constructor in the parent constructor.
+        Options() {}
+    };
+
+    /**
+     * Create a decoder.
+     * @param[in] options Options.
+     */
+    HDRImageDecoder(const Options& options = Options());
+    ~HDRImageDecoder();
+
+    /**
+     * Check if the decoder handles files with the extension of the given path (.exr and .hdr).
+     */
+    static bool isSupported(const std::filesystem::path& path);
+
+    /**
+     * Decode an image file.
+     * @param[in] path Path of the file.
+     * @param[in] isTopDown If true, the top-left pixel is the first pixel in the buffer, otherwise the bottom-left pixel is first.
+     * @param[in] importFlags Import flags. Only Bitmap::ImportFlags::ConvertToFloat16 is used.
+     * @return The decoded bitmap, or nullptr if the file could not be read or is not supported by the decoder.
+     */
+    Bitmap::UniqueConstPtr decode(const std::filesystem::path& path, bool isTopDown, Bitmap::ImportFlags importFlags) const;
+
+    const Options& getOptions() const { return mOptions; }
+
+private:
+    Bitmap::UniqueConstPtr decodeExr(const std::filesystem::path& path, const uint8_t* pData, size_t size, bool isTopDown, bool toFloat16)
+        const;
+    Bitmap::UniqueConstPtr decodeHdr(const std::filesystem::path& path, const uint8_t* pData, size_t size, bool isTopDown, bool toFloat16)
+        const;
+
+    Options mOptions;
+    std::unique_ptr<BS::thread_pool> mpThreadPool;
+};
+} // namespace Falcor
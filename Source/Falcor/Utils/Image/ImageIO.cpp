@@ -331,6 +331,36 @@ void setImage(
 }
 
 // Saves image data to a DDS file using the specified compression mode. Optionally generates mips.
+// Create an NVTT surface from a bitmap. The image dimensions may be smaller than the bitmap if clamped.
+nvtt::Surface createSurface(const Bitmap& bitmap, const ExportData& image)
+{
+    uint32_t srcWidth = bitmap.getWidth();
+    uint32_t srcHeight = bitmap.getHeight();
+
+    nvtt::Surface surface;
+    FormatType type = getFormatType(image.format);
+    if (type == FormatType::Sint || type == FormatType::Snorm)
+    {
+        setImage<int8_t>(bitmap.getData(), surface, image, srcWidth, srcHeight, image.depth);
+    }
+    else if (type == FormatType::Uint || type == FormatType::Unorm || type == FormatType::UnormSrgb)
+    {
+        setImage<uint8_t>(bitmap.getData(), surface, image, srcWidth, srcHeight, image.depth);
+    }
+    else if (type == FormatType::Float)
+    {
+        if (getNumChannelBits(image.format, 0) == 16)
+        {
+            setImage<float16_t>(bitmap.getData(), surface, image, srcWidth, srcHeight, image.depth);
+        }
+        else if (getNumChannelBits(image.format, 0) == 32)
+        {
+            setImage<float>(bitmap.getData(), surface, image, srcWidth, srcHeight, image.depth);
+        }
+    }
+    return surface;
+}
+
 void exportDDS(const std::filesystem::path& path, ExportData& image, ImageIO::CompressionMode mode, bool generateMips)
 {
     nvtt::CompressionOptions compressionOptions;
@@ -653,41 +683,74 @@ void ImageIO::saveToDDS(const std::filesystem::path& path, const Bitmap& bitmap,
             }
         }
 
-        uint32_t srcWidth = bitmap.getWidth();
-        uint32_t srcHeight = bitmap.getHeight();
+        image.images.push_back(createSurface(bitmap, image));
 
-        nvtt::Surface surface;
-        FormatType type = getFormatType(image.format);
-        if (type == FormatType::Sint || type == FormatType::Snorm)
+        // NVTT's Surface is designed to only hold uncompressed data, which means saving a compressed image as-is
+        // requires the data be re-compressed. The selected compression mode is updated here to reflect this.
+        if (isCompressedFormat(image.format) && mode == CompressionMode::None)
         {
-            setImage<int8_t>(bitmap.getData(), surface, image, srcWidth, srcHeight, image.depth);
+            mode = convertFormatToMode(image.format);
         }
-        else if (type == FormatType::Uint || type == FormatType::Unorm || type == FormatType::UnormSrgb)
+
+        exportDDS(path, image, mode, generateMips);
+    }
+    catch (const RuntimeError& e)
+    {
+        FALCOR_THROW("Failed to save DDS image to '{}': {}", path, e.what());
+    }
+}
+
+void ImageIO::saveToDDS(
+    const std::filesystem::path& path,
+    const Bitmap& bitmap,
+    const std::vector<Bitmap::UniqueConstPtr>& mips,
+    CompressionMode mode
+)
+{
+    if (!hasExtension(path, "dds"))
+    {
+        logWarning("Saving DDS image to '{}' which does not have 'dds' file extension.", path);
+    }
+
+    try
+    {
+        ExportData image;
+        image.type = nvtt::TextureType::TextureType_2D;
+        image.width = bitmap.getWidth();
+        image.height = bitmap.getHeight();
+        image.depth = 1;
+        image.format = bitmap.getFormat();
+        image.faceCount = 1;
+        image.mipLevels = 1 + (uint32_t)mips.size();
+
+        if (isCompressedFormat(image.format))
         {
-            setImage<uint8_t>(bitmap.getData(), surface, image, srcWidth, srcHeight, image.depth);
+            FALCOR_THROW("Precomputed mips are not supported for compressed images.");
         }
-        else if (type == FormatType::Float)
+        if (getFormatChannelCount(image.format) == 2 && mode != CompressionMode::BC5)
         {
-            if (getNumChannelBits(image.format, 0) == 16)
-            {
-                setImage<float16_t>(bitmap.getData(), surface, image, srcWidth, srcHeight, image.depth);
-            }
-            else if (getNumChannelBits(image.format, 0) == 32)
-            {
-                setImage<float>(bitmap.getData(), surface, image, srcWidth, srcHeight, image.depth);
-            }
+            FALCOR_THROW("Only BC5 compression is supported for two channel images.");
+        }
+        if (image.mipLevels > nvtt::countMipmaps(image.width, image.height, image.depth))
+        {
+            FALCOR_THROW("Too many mip levels.");
         }
 
-        image.images.push_back(surface);
-
-        // NVTT's Surface is designed to only hold uncompressed data, which means saving a compressed image as-is
-        // requires the data be re-compressed. The selected compression mode is updated here to reflect this.
-        if (isCompressedFormat(image.format) && mode == CompressionMode::None)
+        image.images.push_back(createSurface(bitmap, image));
+        for (uint32_t m = 1; m < image.mipLevels; ++m)
         {
-            mode = convertFormatToMode(image.format);
+            const Bitmap& mip = *mips[m - 1];
+            ExportData mipImage = image;
+            mipImage.width = std::max(1u, image.width >> m);
+            mipImage.height = std::max(1u, image.height >> m);
+            if (mip.getFormat() != image.format || mip.getWidth() != mipImage.width || mip.getHeight() != mipImage.height)
+            {
+                FALCOR_THROW("Mip level {} does not match the format or dimensions of the base level.", m);
+            }
+            image.images.push_back(createSurface(mip, mipImage));
         }
 
-        exportDDS(path, image, mode, generateMips);
+        exportDDS(path, image, mode, false);
     }
     catch (const RuntimeError& e)
     {
@@ -30,6 +30,7 @@
 #include "Core/Macros.h"
 #include "Core/API/Texture.h"
 #include <filesystem>
+#include <vector>
 
 namespace Falcor
 {
@@ -105,6 +106,21 @@ public:
         bool generateMips = false
     );
 
+    /**
+     * Saves a bitmap and its precomputed mip chain to a DDS file, e.g. as generated by MipGenerator.
+     * Throws an exception if the path is invalid, the mips do not match the bitmap or the image cannot be saved.
+     * @param[in] path Path to save to.
+     * @param[in] bitmap Bitmap object holding mip level 0.
+     * @param[in] mips Mip levels starting at level 1, with the format of the bitmap and dimensions halved per level.
+     * @param[in] mode Block compression mode.
+     */
+    static void saveToDDS(
+        const std::filesystem::path& path,
+        const Bitmap& bitmap,
+        const std::vector<Bitmap::UniqueConstPtr>& mips,
+        CompressionMode mode = CompressionMode::None
+    );
+
     /**
      * Saves a Texture to a DDS file. All mips and array images are saved.
      * Throws an exception if the path is invalid or the image cannot be saved.
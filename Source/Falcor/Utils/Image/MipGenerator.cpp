@@ -0,0 +1,520 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "MipGenerator.h"
+#include "Core/Error.h"
+#include "Utils/Color/ColorHelpers.slang"
+#include "Utils/Math/ScalarMath.h"
+#include "Utils/ParallelFor.h"
+#include <BS_thread_pool.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace Falcor
+{
+namespace
+{
+/// Radius of the Kaiser and Lanczos filters in texels of the destination level.
+const float kFilterRadius = 3.f;
+/// Shape parameter of the Kaiser window.
+const float kKaiserAlpha = 4.f;
+/// Number of bisection steps when searching the alpha scale that preserves coverage.
+const uint32_t kCoverageSearchSteps = 16;
+
+enum class ChannelType
+{
+    Unorm8,
+    Unorm16,
+    Float16,
+    Float32,
+};
+
+struct FormatInfo
+{
+    ChannelType type;
+    uint32_t channelCount;
+    bool hasAlpha;   ///< True if the last of 4 channels is alpha (and not unused, as in BGRX).
+    bool isSrgb;     ///< True if the color channels are sRGB encoded.
+};
+
+bool getFormatInfo(ResourceFormat format, FormatInfo& info)
+{
+    if (format == ResourceFormat::Unknown || isCompressedFormat(format))
+        return false;
+
+    info.channelCount = getFormatChannelCount(format);
+    if (info.channelCount < 1 || info.channelCount > 4)
+        return false;
+
+    // Reject packed formats and formats with channels of different sizes.
+    const uint32_t bits = getNumChannelBits(format, 0);
+    for (uint32_t c = 1; c < info.channelCount; ++c)
+    {
+        if (getNumChannelBits(format, c) != bits)
+            return false;
+    }
+    if (getFormatBytesPerBlock(format) * 8 != bits * info.channelCount)
+        return false;
+
+    const FormatType type = getFormatType(format);
+    if ((type == FormatType::Unorm || type == FormatType::UnormSrgb) && bits == 8)
+        info.type = ChannelType::Unorm8;
+    else if (type == FormatType::Unorm && bits == 16)
+        info.type = ChannelType::Unorm16;
+    else if (type == FormatType::Float && bits == 16)
+        info.type = ChannelType::Float16;
+    else if (type == FormatType::Float && bits == 32)
+        info.type = ChannelType::Float32;
+    else
+        return false;
+
+    info.hasAlpha = info.channelCount == 4 && format != ResourceFormat::BGRX8Unorm && format != ResourceFormat::BGRX8UnormSrgb;
+    info.isSrgb = isSrgbFormat(format);
+    return true;
+}
+
+/// Per-axis filter weights. The taps of destination texel i are in [offsets[i], offsets[i + 1]).
+struct AxisWeights
+{
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> indices; ///< Source texel indices, clamped to the edge.
+    std::vector<float> weights;
+};
+
+float sinc(float x)
+{
+    if (std::abs(x) < 1e-6f)
+        return 1.f;
+    x *= (float)M_PI;
+    return std::sin(x) / x;
+}
+
+/// Modified Bessel function of the first kind of order 0.
+float besselI0(float x)
+{
+    float sum = 1.f;
+    float term = 1.f;
+    for (uint32_t k = 1; k < 32 && term > 1e-8f * sum; ++k)
+    {
+        float y = x / (2.f * k);
+        term *= y * y;
+        sum += term;
+    }
+    return sum;
+}
+
+float evalKernel(MipGenerator::Filter filter, float x)
+{
+    if (std::abs(x) >= kFilterRadius)
+        return 0.f;
+
+    switch (filter)
+    {
+    case MipGenerator::Filter::Kaiser:
+    {
+        float t = x / kFilterRadius;
+        return sinc(x) * besselI0(kKaiserAlpha * std::sqrt(1.f - t * t)) / besselI0(kKaiserAlpha);
+    }
+    case MipGenerator::Filter::Lanczos:
+        return sinc(x) * sinc(x / kFilterRadius);
+    default:
+        FALCOR_UNREACHABLE();
+    }
+    return 0.f;
+}
+
+AxisWeights computeAxisWeights(uint32_t srcSize, uint32_t dstSize, MipGenerator::Filter filter)
+{
+    AxisWeights axis;
+    axis.offsets.reserve(dstSize + 1);
+
+    // Destination texel i covers [i * scale, (i + 1) * scale) in source texels.
+    const float scale = float(srcSize) / float(dstSize);
+    const float radius = filter == MipGenerator::Filter::Box ? 0.5f : kFilterRadius;
+
+    for (uint32_t i = 0; i < dstSize; ++i)
+    {
+        axis.offsets.push_back((uint32_t)axis.indices.size());
+
+        const float center = (i + 0.5f) * scale;
+        const int first = (int)std::floor(center - radius * scale);
+        const int last = (int)std::ceil(center + radius * scale);
+
+        float weightSum = 0.f;
+        for (int j = first; j <= last; ++j)
+        {
+            float weight;
+            if (filter == MipGenerator::Filter::Box)
+            {
+                // Exact overlap of the source texel with the destination footprint.
+                weight = std::max(0.f, std::min(float(j + 1), (i + 1) * scale) - std::max(float(j), i * scale));
+            }
+            else
+            {
+                weight = evalKernel(filter, (j + 0.5f - center) / scale);
+            }
+            if (weight == 0.f)
+                continue;
+
+            axis.indices.push_back((uint32_t)std::clamp(j, 0, (int)srcSize - 1));
+            axis.weights.push_back(weight);
+            weightSum += weight;
+        }
+
+        FALCOR_ASSERT(weightSum > 0.f);
+        for (size_t t = axis.offsets.back(); t < axis.weights.size(); ++t)
+            axis.weights[t] /= weightSum;
+    }
+
+    axis.offsets.push_back((uint32_t)axis.indices.size());
+    return axis;
+}
+
+/// Floating-point level with channelCount values per texel.
+struct Level
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<float> data;
+};
+
+/// Converts rows between the bitmap format and linear floating-point values.
+class RowCodec
+{
+public:
+    RowCodec(const FormatInfo& info, bool srgb) : mInfo(info), mSrgb(srgb)
+    {
+        // Lookup tables for decoding 8-bit values of color and alpha channels.
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            mAlphaLut[i] = i / 255.f;
+            mColorLut[i] = srgb ? sRGBToLinear(i / 255.f) : i / 255.f;
+        }
+    }
+
+    void decode(const uint8_t* pSrc, float* pDst, uint32_t texelCount) const
+    {
+        const uint32_t C = mInfo.channelCount;
+        const uint32_t count = texelCount * C;
+        switch (mInfo.type)
+        {
+        case ChannelType::Unorm8:
+            for (uint32_t i = 0; i < count; ++i)
+                pDst[i] = isColorChannel(i % C) ? mColorLut[pSrc[i]] : mAlphaLut[pSrc[i]];
+            break;
+        case ChannelType::Unorm16:
+        {
+            const uint16_t* pSrc16 = reinterpret_cast<const uint16_t*>(pSrc);
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                float v = pSrc16[i] / 65535.f;
+                pDst[i] = mSrgb && isColorChannel(i % C) ? sRGBToLinear(v) : v;
+            }
+            break;
+        }
+        case ChannelType::Float16:
+        {
+            const uint16_t* pSrc16 = reinterpret_cast<const uint16_t*>(pSrc);
+            for (uint32_t i = 0; i < count; ++i)
+                pDst[i] = math::f16tof32(pSrc16[i]);
+            break;
+        }
+        case ChannelType::Float32:
+            std::copy_n(reinterpret_cast<const float*>(pSrc), count, pDst);
+            break;
+        }
+    }
+
+    void encode(const float* pSrc, uint8_t* pDst, uint32_t texelCount, float alphaScale) const
+    {
+        const uint32_t C = mInfo.channelCount;
+        const uint32_t count = texelCount * C;
+        auto unorm = [&](uint32_t i)
+        {
+            float v = pSrc[i];
+            if (i % C == 3 && mInfo.hasAlpha)
+                v *= alphaScale;
+            v = std::clamp(v, 0.f, 1.f);
+            return mSrgb && isColorChannel(i % C) ? linearToSRGB(v) : v;
+        };
+
+        switch (mInfo.type)
+        {
+        case ChannelType::Unorm8:
+            for (uint32_t i = 0; i < count; ++i)
+                pDst[i] = (uint8_t)(unorm(i) * 255.f + 0.5f);
+            break;
+        case ChannelType::Unorm16:
+        {
+            uint16_t* pDst16 = reinterpret_cast<uint16_t*>(pDst);
+            for (uint32_t i = 0; i < count; ++i)
+                pDst16[i] = (uint16_t)(unorm(i) * 65535.f + 0.5f);
+            break;
+        }
+        case ChannelType::Float16:
+        case ChannelType::Float32:
+        {
+            // Float values are not clamped, except for scaled alpha.
+            auto value = [&](uint32_t i)
+            { return i % C == 3 && mInfo.hasAlpha && alphaScale != 1.f ? std::min(pSrc[i] * alphaScale, 1.f) : pSrc[i]; };
+            if (mInfo.type == ChannelType::Float16)
+            {
+                uint16_t* pDst16 = reinterpret_cast<uint16_t*>(pDst);
+                for (uint32_t i = 0; i < count; ++i)
+                    pDst16[i] = (uint16_t)math::f32tof16(value(i));
+            }
+            else
+            {
+                float* pDst32 = reinterpret_cast<float*>(pDst);
+                for (uint32_t i = 0; i < count; ++i)
+                    pDst32[i] = value(i);
+            }
+            break;
+        }
+        }
+    }
+
+private:
+    /// The 4th channel is alpha or unused and is never sRGB encoded.
+    bool isColorChannel(uint32_t c) const { return c < 3; }
+
+    FormatInfo mInfo;
+    bool mSrgb;
+    std::array<float, 256> mColorLut;
+    std::array<float, 256> mAlphaLut;
+};
+
+/// Horizontal pass: filter a row of srcWidth texels to the destination width.
+template<uint32_t C>
+void filterRow(const float* pSrc, float* pDst, const AxisWeights& axis)
+{
+    const uint32_t dstWidth = (uint32_t)axis.offsets.size() - 1;
+    for (uint32_t x = 0; x < dstWidth; ++x)
+    {
+        float acc[C] = {};
+        for (uint32_t t = axis.offsets[x]; t < axis.offsets[x + 1]; ++t)
+        {
+            const float w = axis.weights[t];
+            const float* pTexel = pSrc + axis.indices[t] * C;
+            for (uint32_t c = 0; c < C; ++c)
+                acc[c] += w * pTexel[c];
+        }
+        for (uint32_t c = 0; c < C; ++c)
+            pDst[x * C + c] = acc[c];
+    }
+}
+
+void filterRow(uint32_t channelCount, const float* pSrc, float* pDst, const AxisWeights& axis)
+{
+    switch (channelCount)
+    {
+    case 1:
+        return filterRow<1>(pSrc, pDst, axis);
+    case 2:
+        return filterRow<2>(pSrc, pDst, axis);
+    case 3:
+        return filterRow<3>(pSrc, pDst, axis);
+    case 4:
+        return filterRow<4>(pSrc, pDst, axis);
+    default:
+        FALCOR_UNREACHABLE();
+    }
+}
+
+uint64_t countCoverage(const float* pData, size_t texelCount, float alphaReference)
+{
+    uint64_t count = 0;
+    for (size_t i = 0; i < texelCount; ++i)
+        count += pData[i * 4 + 3] > alphaReference ? 1 : 0;
+    return count;
+}
+
+/// Find the scale for alpha so that the fraction of texels with alpha above the reference matches the target.
+float computeAlphaScale(const Level& level, float alphaReference, float targetCoverage)
+{
+    const size_t texelCount = (size_t)level.width * level.height;
+
+    // Bisect for the threshold that yields the target coverage; alpha is then scaled to map it to the reference.
+    float lo = 0.f;
+    float hi = 1.f;
+    float threshold = alphaReference;
+    for (uint32_t i = 0; i < kCoverageSearchSteps; ++i)
+    {
+        float coverage = float(countCoverage(level.data.data(), texelCount, threshold)) / texelCount;
+        if (coverage > targetCoverage)
+            lo = threshold;
+        else if (coverage < targetCoverage)
+            hi = threshold;
+        else
+            break;
+        threshold = 0.5f * (lo + hi);
+    }
+
+    return threshold > 0.f ? alphaReference / threshold : 1.f;
+}
+} // namespace
+
+MipGenerator::MipGenerator(const Options& options) : mOptions(options)
+{
+    if (mOptions.threadCount != 1)
+        mpThreadPool = std::make_unique<BS::thread_pool>(mOptions.threadCount);
+}
+
+MipGenerator::~MipGenerator() = default;
+
+bool MipGenerator::isFormatSupported(ResourceFormat format)
+{
+    FormatInfo info;
+    return getFormatInfo(format, info);
+}
+
+uint32_t MipGenerator::getMipCount(uint32_t width, uint32_t height)
+{
+    uint32_t count = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size /= 2)
+        count++;
+    return count;
+}
+
+std::vector<Bitmap::UniqueConstPtr> MipGenerator::generate(const Bitmap& bitmap, bool srgb)
+{
+    const ResourceFormat format = bitmap.getFormat();
+    FormatInfo info;
+    if (!getFormatInfo(format, info))
+        FALCOR_THROW("Cannot generate mips for bitmaps of format '{}'.", to_string(format));
+
+    // Only filter in linear space for formats that have an sRGB variant, matching how textures are loaded.
+    srgb = info.isSrgb || (srgb && linearToSrgbFormat(format) != format);
+    const RowCodec codec(info, srgb);
+    const uint32_t C = info.channelCount;
+    const bool preserveAlphaCoverage = mOptions.preserveAlphaCoverage && info.hasAlpha;
+    BS::thread_pool* pThreadPool = mpThreadPool.get();
+
+    // Rows of level 0 are decoded on the fly, so it is never stored as floats.
+    auto getBaseRow = [&](uint32_t y, float* pScratch) -> const float*
+    {
+        codec.decode(bitmap.getData() + (size_t)y * bitmap.getRowPitch(), pScratch, bitmap.getWidth());
+        return pScratch;
+    };
+
+    float targetCoverage = 0.f;
+    if (preserveAlphaCoverage)
+    {
+        std::vector<uint64_t> rowCoverage(bitmap.getHeight());
+        parallelFor(
+            pThreadPool,
+            bitmap.getHeight(),
+            [&](uint32_t begin, uint32_t end)
+            {
+                std::vector<float> row(bitmap.getWidth() * C);
+                for (uint32_t y = begin; y < end; ++y)
+                    rowCoverage[y] = countCoverage(getBaseRow(y, row.data()), bitmap.getWidth(), mOptions.alphaReference);
+            }
+        );
+        uint64_t coverage = 0;
+        for (auto count : rowCoverage)
+            coverage += count;
+        targetCoverage = float(coverage) / ((uint64_t)bitmap.getWidth() * bitmap.getHeight());
+    }
+
+    std::vector<Bitmap::UniqueConstPtr> mips;
+    const uint32_t mipCount = getMipCount(bitmap.getWidth(), bitmap.getHeight());
+    mips.reserve(mipCount - 1);
+
+    Level src;
+    src.width = bitmap.getWidth();
+    src.height = bitmap.getHeight();
+    std::vector<uint8_t> encoded;
+
+    for (uint32_t mip = 1; mip < mipCount; ++mip)
+    {
+        Level dst;
+        dst.width = std::max(1u, src.width / 2);
+        dst.height = std::max(1u, src.height / 2);
+        dst.data.resize((size_t)dst.width * dst.height * C);
+
+        const AxisWeights weightsX = computeAxisWeights(src.width, dst.width, mOptions.filter);
+        const AxisWeights weightsY = computeAxisWeights(src.height, dst.height, mOptions.filter);
+        const size_t srcRowSize = (size_t)src.width * C;
+        const size_t dstRowSize = (size_t)dst.width * C;
+        const uint32_t dstRowPitch = getFormatRowPitch(format, dst.width);
+        encoded.resize((size_t)dstRowPitch * dst.height);
+
+        parallelFor(
+            pThreadPool,
+            dst.height,
+            [&](uint32_t begin, uint32_t end)
+            {
+                std::vector<float> scratch(srcRowSize);
+                std::vector<float> column(srcRowSize);
+                for (uint32_t y = begin; y < end; ++y)
+                {
+                    // Vertical pass: weighted sum of full source rows.
+                    std::fill(column.begin(), column.end(), 0.f);
+                    for (uint32_t t = weightsY.offsets[y]; t < weightsY.offsets[y + 1]; ++t)
+                    {
+                        const uint32_t srcY = weightsY.indices[t];
+                        const float* pRow = mip == 1 ? getBaseRow(srcY, scratch.data()) : src.data.data() + srcY * srcRowSize;
+                        const float w = weightsY.weights[t];
+                        float* pColumn = column.data();
+                        for (size_t i = 0; i < srcRowSize; ++i)
+                            pColumn[i] += w * pRow[i];
+                    }
+
+                    // Horizontal pass on the vertically filtered row.
+                    float* pDstRow = dst.data.data() + y * dstRowSize;
+                    filterRow(C, column.data(), pDstRow, weightsX);
+                    if (!preserveAlphaCoverage)
+                        codec.encode(pDstRow, encoded.data() + (size_t)y * dstRowPitch, dst.width, 1.f);
+                }
+            }
+        );
+
+        if (preserveAlphaCoverage)
+        {
+            const float alphaScale = computeAlphaScale(dst, mOptions.alphaReference, targetCoverage);
+            parallelFor(
+                pThreadPool,
+                dst.height,
+                [&](uint32_t begin, uint32_t end)
+                {
+                    for (uint32_t y = begin; y < end; ++y)
+                        codec.encode(dst.data.data() + y * dstRowSize, encoded.data() + (size_t)y * dstRowPitch, dst.width, alphaScale);
+                }
+            );
+        }
+
+        mips.push_back(Bitmap::create(dst.width, dst.height, format, encoded.data()));
+
+        // The next level is filtered from the unscaled and unquantized values of this level.
+        src = std::move(dst);
+    }
+
+    return mips;
+}
+} // namespace Falcor
@@ -0,0 +1,117 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Bitmap.h"
+#include "Core/Macros.h"
+#include "Core/API/Formats.h"
+#include <memory>
+#include <vector>
+
+namespace BS
+{
+class thread_pool;
+}
+
+namespace Falcor
+{
+/**
+ * Generates mip chains of bitmaps on the CPU.
+ *
+ * Each level is downsampled from the previous one with a separable filter, using the floating-point result of
+ * the previous level so that quantization errors do not accumulate. Levels are downsampled by a factor of 2 and
+ * rounded down (D3D convention). Odd dimensions are handled by stretching the filter footprint over the source
+ * extent, so every source texel contributes to the next level. Texels outside the image are clamped to the edge.
+ *
+ * Color channels of 8- and 16-bit unorm images are filtered in linear space if the format is sRGB or sRGB
+ * decoding is requested. The alpha channel is always filtered as-is and can optionally be rescaled per level to
+ * preserve the fraction of texels passing an alpha test, which otherwise shrinks for alpha-tested foliage.
+ *
+ * Rows of each level are processed in parallel. The filter loops work on contiguous rows of floats so the
+ * compiler can vectorize them.
+ */
+class FALCOR_API MipGenerator
+{
+public:
+    enum class Filter
+    {
+        Box,     ///< Box filter. Averages 2x2 texels for even dimensions.
+        Kaiser,  ///< Kaiser-windowed sinc filter with a radius of 3 texels of the next level.
+        Lanczos, ///< Lanczos filter with a radius of 3 texels of the next level.
+    };
+
+    struct Options
+    {
+        /// Downsampling filter.
+        Filter filter = Filter::Box;
+        /// Rescale alpha so that each level has the same fraction of texels with alpha above alphaReference as level 0.
+        bool preserveAlphaCoverage = false;
+        /// Alpha test threshold used when preserving alpha coverage.
+        float alphaReference = 0.5f;
+        /// Number of threads. 0 uses the hardware concurrency.
+        uint32_t threadCount = 0;
+
+        // Note: Empty constructor needed for clang due to the use of the nested struct constructor in the parent constructor.
+        Options() {}
+    };
+
+    /**
+     * Create a mip generator.
+     * @param[in] options Options.
+     */
+    MipGenerator(const Options& options = Options());
+    ~MipGenerator();
+
+    /**
+     * Check if mips can be generated for bitmaps of the given format.
+     * Supported are uncompressed formats with 1 to 4 channels of equal size that are 8-bit or 16-bit unorm
+     * (including sRGB), 16-bit float or 32-bit float.
+     */
+    static bool isFormatSupported(ResourceFormat format);
+
+    /**
+     * Get the number of levels in a full mip chain, including level 0.
+     */
+    static uint32_t getMipCount(uint32_t width, uint32_t height);
+
+    /**
+     * Generate the full mip chain of a bitmap.
+     * Throws an exception if the format is not supported.
+     * @param[in] bitmap Level 0. The bitmap is not copied into the result.
+     * @param[in] srgb Filter color channels of unorm formats in linear space, decoding and encoding with the sRGB
+     * transfer function. This is implied for sRGB formats and ignored for float formats.
+     * @return Levels 1 to getMipCount() - 1 in the format of the bitmap. Empty if the bitmap is 1x1.
+     */
+    std::vector<Bitmap::UniqueConstPtr> generate(const Bitmap& bitmap, bool srgb = false);
+
+    const Options& getOptions() const { return mOptions; }
+
+private:
+    Options mOptions;
+    std::unique_ptr<BS::thread_pool> mpThreadPool;
+};
+} // namespace Falcor
@@ -0,0 +1,226 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "TextureCache.h"
+#include "Core/Error.h"
+#include "Core/API/Formats.h"
+#include "Core/Platform/OS.h"
+#include "Utils/Logger.h"
+
+namespace Falcor
+{
+namespace
+{
+/// Texture cache directory (subdirectory in the application data directory).
+const std::string kDirectory = "NVIDIA/Falcor/TextureCache";
+
+/// Version hashed into the entry keys. This needs to be incremented every time the processing of textures changes.
+const uint32_t kTextureCacheVersion = 2;
+
+const std::string kEntryExtension = ".dds";
+const std::string kMemoFile = "FileDigests.bin";
+
+CacheKeyService::Options getKeyServiceOptions(const std::filesystem::path& directory)
+{
+    CacheKeyService::Options options;
+    options.memoPath = directory / kMemoFile;
+    return options;
+}
+} // namespace
+
+TextureCache::TextureCache(const Options& options)
+    : mOptions(options)
+    , mDirectory(options.directory.empty() ? getDefaultDirectory() : options.directory)
+    , mEntries(mDirectory / "entries")
+    , mKeyService(getKeyServiceOptions(mDirectory))
+    , mMipGenerator(options.mipOptions)
+{}
+
+std::filesystem::path TextureCache::getDefaultDirectory()
+{
+    return getAppDataDirectory() / kDirectory;
+}
+
+ImageIO::CompressionMode TextureCache::selectCompressionMode(ResourceFormat format)
+{
+    if (isCompressedFormat(format))
+        return ImageIO::CompressionMode::None;
+
+    const uint32_t channelCount = getFormatChannelCount(format);
+    const FormatType type = getFormatType(format);
+    if (type == FormatType::Float)
+        return channelCount == 3 ? ImageIO::CompressionMode::BC6 : ImageIO::CompressionMode::None;
+
+    if ((type == FormatType::Unorm || type == FormatType::UnormSrgb) && getNumChannelBits(format, 0) == 8)
+    {
+        switch (channelCount)
+        {
+        case 1:
+            return ImageIO::CompressionMode::BC4;
+        case 2:
+            return ImageIO::CompressionMode::BC5;
+        default:
+            return ImageIO::CompressionMode::BC7;
+        }
+    }
+
+    return ImageIO::CompressionMode::None;
+}
+
+TextureCache::Key TextureCache::computeKey(
+    const std::filesystem::path& path,
+    bool generateMips,
+    bool loadAsSrgb,
+    Bitmap::ImportFlags importFlags
+)
+{
+    const auto digest = mKeyService.hashFile(path);
+
+    FastHash128 hash;
+    hash.update(kTextureCacheVersion);
+    hash.update(digest.data(), digest.size());
+    hash.update(generateMips);
+    hash.update((uint32_t)importFlags);
+    hash.update(mOptions.compress);
+    if (generateMips)
+    {
+        // The sRGB flag only changes the entry through the filtering of mips.
+        const auto& mipOptions = mOptions.mipOptions;
+        hash.update(loadAsSrgb);
+        hash.update((uint32_t)mipOptions.filter);
+        hash.update(mipOptions.preserveAlphaCoverage);
+        hash.update(mipOptions.alphaReference);
+    }
+    return hash.finalize();
+}
+
+std::filesystem::path TextureCache::findEntry(const Key& key) const
+{
+    auto path = getEntryPath(key);
+    if (!std::filesystem::exists(path))
+        return {};
+
+    DiskCacheDirectory::markUsed(path);
+    return path;
+}
+
+std::filesystem::path TextureCache::writeEntry(const Key& key, const Bitmap& bitmap, bool generateMips, bool loadAsSrgb)
+{
+    // Mips are generated by MipGenerator if it supports the format, otherwise by ImageIO::saveToDDS().
+    const bool useMipGenerator = generateMips && MipGenerator::isFormatSupported(bitmap.getFormat());
+
+    // Block compression requires the dimensions to be a multiple of 4, which saveToDDS() only ensures when generating mips.
+    auto mode = mOptions.compress ? selectCompressionMode(bitmap.getFormat()) : ImageIO::CompressionMode::None;
+    if ((!generateMips || useMipGenerator) && (bitmap.getWidth() % 4 != 0 || bitmap.getHeight() % 4 != 0))
+        mode = ImageIO::CompressionMode::None;
+
+    auto path = getEntryPath(key);
+    mEntries.writeFile(
+        path,
+        [&](const std::filesystem::path& tempPath)
+        {
+            if (useMipGenerator)
+                ImageIO::saveToDDS(tempPath, bitmap, mMipGenerator.generate(bitmap, loadAsSrgb), mode);
+            else
+                ImageIO::saveToDDS(tempPath, bitmap, mode, generateMips);
+        }
+    );
+    return path;
+}
+
+std::filesystem::path TextureCache::getEntry(
+    const std::filesystem::path& path,
+    bool generateMips,
+    bool loadAsSrgb,
+    Bitmap::ImportFlags importFlags,
+    const HDRImageDecoder* pHDRImageDecoder
+)
+{
+    try
+    {
+        auto key = computeKey(path, generateMips, loadAsSrgb, importFlags);
+        if (auto entryPath = findEntry(key); !entryPath.empty())
+        {
+            mHitCount++;
+            return entryPath;
+        }
+
+        auto pBitmap = Bitmap::createFromFile(path, true /* top-down */, importFlags, pHDRImageDecoder);
+        if (!pBitmap)
+            FALCOR_THROW("Failed to load image.");
+
+        auto entryPath = writeEntry(key, *pBitmap, generateMips, loadAsSrgb);
+        mMissCount++;
+        return entryPath;
+    }
+    catch (const std::exception& e)
+    {
+        logWarning("Failed to cache texture '{}': {}", path, e.what());
+        mErrorCount++;
+        return {};
+    }
+}
+
+void TextureCache::removeEntry(const Key& key)
+{
+    DiskCacheDirectory::removeFile(getEntryPath(key));
+}
+
+uint64_t TextureCache::enforceSizeBudget()
+{
+    uint64_t freedSize = mEntries.removeTempFiles();
+
+    auto entries = mEntries.listFiles();
+    DiskCacheDirectory::sortByLastUse(entries);
+    freedSize += DiskCacheDirectory::evict(entries, mOptions.sizeBudget);
+
+    return freedSize;
+}
+
+uint64_t TextureCache::getTotalSize() const
+{
+    uint64_t totalSize = 0;
+    for (const auto& entry : mEntries.listFiles())
+        totalSize += entry.size;
+    return totalSize;
+}
+
+TextureCache::Stats TextureCache::getStats() const
+{
+    Stats stats;
+    stats.hitCount = mHitCount;
+    stats.missCount = mMissCount;
+    stats.errorCount = mErrorCount;
+    return stats;
+}
+
+std::filesystem::path TextureCache::getEntryPath(const Key& key) const
+{
+    auto name = FastHash128::toString(key);
+    return mEntries.getPath() / name.substr(0, 2) / (name + kEntryExtension);
+}
+} // namespace Falcor
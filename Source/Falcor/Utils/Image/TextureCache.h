@@ -0,0 +1,178 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Bitmap.h"
+#include "ImageIO.h"
+#include "MipGenerator.h"
+#include "Core/Macros.h"
+#include "Scene/CacheKeyService.h"
+#include "Utils/DiskCacheDirectory.h"
+#include "Utils/FastHash.h"
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace Falcor
+{
+/**
+ * Disk cache of processed textures.
+ *
+ * Each entry is a DDS file holding a texture after decoding, format conversion and optional mip generation
+ * (using MipGenerator) and block compression, so that loading it only requires ImageIO::loadTextureFromDDS(). Entries are keyed
+ * by the contents of the source file and the flags that affect processing, so a texture used by several
+ * scenes is processed once, and editing the source file creates a new entry.
+ *
+ * The total size of the entries is limited by enforceSizeBudget(), which evicts the least recently used
+ * entries. Entries are stored in a DiskCacheDirectory. All functions can be called concurrently from multiple threads.
+ */
+class FALCOR_API TextureCache
+{
+public:
+    using Key = FastHash128::MD;
+
+    struct Options
+    {
+        /// Cache directory. Created if it does not exist. Empty to use getDefaultDirectory().
+        std::filesystem::path directory;
+        /// Maximum total size of all entries in bytes.
+        uint64_t sizeBudget = 8ull * 1024 * 1024 * 1024;
+        /// Block-compress textures using the mode returned by selectCompressionMode().
+        bool compress = false;
+        /// Options for generating mips.
+        MipGenerator::Options mipOptions;
+
+        // Note: Empty constructor needed for clang due to the use of the nested struct constructor in the parent constructor.
+        Options() {}
+    };
+
+    struct Stats
+    {
+        uint64_t hitCount = 0;   ///< Number of textures found in the cache.
+        uint64_t missCount = 0;  ///< Number of textures processed and written to the cache.
+        uint64_t errorCount = 0; ///< Number of textures that could not be processed or written.
+    };
+
+    /**
+     * Create a cache.
+     * @param[in] options Options.
+     */
+    TextureCache(const Options& options = Options());
+
+    /**
+     * Get the default cache directory (subdirectory in the application data directory).
+     */
+    static std::filesystem::path getDefaultDirectory();
+
+    /**
+     * Select the block compression mode for a texture format.
+     * BC4 and BC5 are used for one and two channel formats, BC6 for floating-point formats without alpha and
+     * BC7 for other 8-bit formats. Returns CompressionMode::None for formats that are not compressed.
+     * @param[in] format Format of the source image.
+     * @return The compression mode.
+     */
+    static ImageIO::CompressionMode selectCompressionMode(ResourceFormat format);
+
+    /**
+     * Compute the key of a texture.
+     * Throws an exception if the source file cannot be read.
+     * @param[in] path Source file path.
+     * @param[in] generateMips Whether the full mip chain is generated.
+     * @param[in] loadAsSrgb Whether the texture is loaded as sRGB, which affects mip generation.
+     * @param[in] importFlags Flags used for importing the source file.
+     * @return The key.
+     */
+    Key computeKey(const std::filesystem::path& path, bool generateMips, bool loadAsSrgb, Bitmap::ImportFlags importFlags);
+
+    /**
+     * Find an entry and mark it as recently used.
+     * @param[in] key Entry key.
+     * @return Path of the DDS file, or an empty path if the entry does not exist.
+     */
+    std::filesystem::path findEntry(const Key& key) const;
+
+    /**
+     * Process an image and write it as an entry, replacing any existing entry with the same key.
+     * Throws an exception if the image cannot be processed or written.
+     * @param[in] key Entry key.
+     * @param[in] bitmap Source image.
+     * @param[in] generateMips Generate the full mip chain.
+     * @param[in] loadAsSrgb Filter the color channels of mips in linear space. See MipGenerator::generate().
+     * @return Path of the DDS file.
+     */
+    std::filesystem::path writeEntry(const Key& key, const Bitmap& bitmap, bool generateMips, bool loadAsSrgb = false);
+
+    /**
+     * Get the processed version of a texture, loading and processing the source file on a cache miss.
+     * @param[in] path Source file path.
+     * @param[in] generateMips Whether the full mip chain is generated.
+     * @param[in] loadAsSrgb Whether the texture is loaded as sRGB, which affects mip generation.
+     * @param[in] importFlags Flags used for importing the source file.
+     * @param[in] pHDRImageDecoder Decoder used for EXR and HDR source files, or nullptr. See Bitmap::createFromFile().
+     * @return Path of the DDS file, or an empty path if the texture cannot be cached. Errors are logged.
+     */
+    std::filesystem::path getEntry(
+        const std::filesystem::path& path,
+        bool generateMips,
+        bool loadAsSrgb,
+        Bitmap::ImportFlags importFlags,
+        const HDRImageDecoder* pHDRImageDecoder = nullptr
+    );
+
+    void removeEntry(const Key& key);
+
+    /**
+     * Remove entries in least recently used order until the total size is within the size budget.
+     * Also removes leftover temporary files.
+     * @return Number of bytes freed.
+     */
+    uint64_t enforceSizeBudget();
+
+    /**
+     * Get the total size of all entries in bytes.
+     */
+    uint64_t getTotalSize() const;
+
+    const std::filesystem::path& getDirectory() const { return mDirectory; }
+    const Options& getOptions() const { return mOptions; }
+    Stats getStats() const;
+
+private:
+    std::filesystem::path getEntryPath(const Key& key) const;
+
+    Options mOptions;
+    std::filesystem::path mDirectory;
+    DiskCacheDirectory mEntries; ///< Entry files, in subdirectories named after the first two characters of the key.
+    CacheKeyService mKeyService; ///< Memoizes source file digests in the cache directory.
+    MipGenerator mMipGenerator;
+
+    std::atomic<uint64_t> mHitCount{0};
+    std::atomic<uint64_t> mMissCount{0};
+    std::atomic<uint64_t> mErrorCount{0};
+};
+} // namespace Falcor
@@ -26,12 +26,16 @@
  # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  **************************************************************************/
 #include "TextureManager.h"
+#include "MipGenerator.h"
 #include "Core/AssetResolver.h"
 #include "Core/API/Device.h"
+#include "Core/Platform/OS.h"
 #include "Utils/Logger.h"
 #include "Utils/NumericRange.h"
 
+#include <algorithm>
 #include <execution>
+#include <iterator>
 
 // Temporarily disable asynchronous texture loader until Falcor supports parallel GPU work submission.
 // Until then `TextureManager` should only called from the main thread.
@@ -49,7 +53,14 @@ TextureManager::TextureManager(ref<Device> pDevice, size_t maxTextureCount, size
     : mpDevice(pDevice), mAsyncTextureLoader(pDevice, threadCount), mMaxTextureCount(std::min(maxTextureCount, kMaxTextureHandleCount))
 {}
 
-TextureManager::~TextureManager() {}
+TextureManager::~TextureManager()
+{
+    // Cancel the pending requests and wait for their callbacks, as they access the texture descs.
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (auto& [id, cancellationToken] : mPendingLoads)
+        cancellationToken.cancel();
+    mCondition.wait(lock, [&]() { return mLoadRequestsInProgress == 0; });
+}
 
 TextureManager::CpuTextureHandle TextureManager::addTexture(const ref<Texture>& pTexture)
 {
@@ -113,7 +124,8 @@ TextureManager::CpuTextureHandle TextureManager::loadUdimTexture(
     bool async,
     Bitmap::ImportFlags importFlags,
     const AssetResolver* assetResolver,
-    size_t* loadedTextureCount
+    size_t* loadedTextureCount,
+    const AsyncTextureLoader::LoadOptions& loadOptions
 )
 {
     std::string filename = path.filename().string();
@@ -125,7 +137,9 @@ TextureManager::CpuTextureHandle TextureManager::loadUdimTexture(
 
     auto pos = filename.find("<UDIM>");
     if (pos == std::string::npos)
-        return loadTexture(path, generateMipLevels, loadAsSRGB, bindFlags, async, importFlags, assetResolver, loadedTextureCount);
+        return loadTexture(
+            path, generateMipLevels, loadAsSRGB, bindFlags, async, importFlags, assetResolver, loadedTextureCount, nullptr, loadOptions
+        );
 
     std::filesystem::path dirpath = path.parent_path();
     filename.replace(pos, 6, "[1-9][0-9][0-9][0-9]");
@@ -168,7 +182,7 @@ TextureManager::CpuTextureHandle TextureManager::loadUdimTexture(
         maxIndex = std::max<size_t>(maxIndex, udim);
         udimIndices.push_back(udim);
         // Do not pass on assetResolver as paths are already resolved, nor loadedTextureCount as we've already set it above.
-        handles.push_back(loadTexture(it, generateMipLevels, loadAsSRGB, bindFlags, async, importFlags));
+        handles.push_back(loadTexture(it, generateMipLevels, loadAsSRGB, bindFlags, async, importFlags, nullptr, nullptr, nullptr, loadOptions));
 
         FALCOR_CHECK(udim >= 1001, "Texture {} is not a valid UDIM texture, as it violates the valid UDIM range of 1001-9999", it);
     }
@@ -194,13 +208,15 @@ TextureManager::CpuTextureHandle TextureManager::loadTexture(
     Bitmap::ImportFlags importFlags,
     const AssetResolver* assetResolver,
     size_t* loadedTextureCount,
-    const Object* owner
+    const Object* owner,
+    const AsyncTextureLoader::LoadOptions& loadOptions
 )
 {
     if (path.string().find("<UDIM>") != std::string::npos)
     {
-        CpuTextureHandle handle =
-            loadUdimTexture(path, generateMipLevels, loadAsSRGB, bindFlags, async, importFlags, assetResolver, loadedTextureCount);
+        CpuTextureHandle handle = loadUdimTexture(
+            path, generateMipLevels, loadAsSRGB, bindFlags, async, importFlags, assetResolver, loadedTextureCount, loadOptions
+        );
 
         std::lock_guard<std::mutex> lock(mMutex);
         registerOwner(handle, owner);
@@ -293,6 +309,9 @@ TextureManager::CpuTextureHandle TextureManager::loadTexture(
         // Add to key-to-handle map.
         mKeyToHandle[textureKey] = handle;
 
+        // Keep the cancellation token so that pending requests can be cancelled on destruction.
+        mPendingLoads[handle.getID()] = loadOptions.cancellationToken;
+
         // Function called by the async texture loader when loading finishes.
         // It's called by a worker thread so needs to acquire the mutex before changing any state.
         auto callback = [=](ref<Texture> pTexture)
@@ -308,6 +327,7 @@ TextureManager::CpuTextureHandle TextureManager::loadTexture(
             if (pTexture)
                 mTextureToHandle[pTexture.get()] = handle;
 
+            mPendingLoads.erase(handle.getID());
             mLoadRequestsInProgress--;
             mCondition.notify_all();
         };
@@ -315,23 +335,16 @@ TextureManager::CpuTextureHandle TextureManager::loadTexture(
         // Issue load request to texture loader.
         if (paths.size() > 1)
         {
-            mAsyncTextureLoader.loadMippedFromFiles(paths, loadAsSRGB, bindFlags, importFlags, callback);
+            mAsyncTextureLoader.loadMippedFromFiles(paths, loadAsSRGB, bindFlags, importFlags, callback, loadOptions);
         }
         else
         {
-            mAsyncTextureLoader.loadFromFile(paths[0], generateMipLevels, loadAsSRGB, bindFlags, importFlags, callback);
+            mAsyncTextureLoader.loadFromFile(paths[0], generateMipLevels, loadAsSRGB, bindFlags, importFlags, callback, loadOptions);
         }
 #else
         // Load texture from main thread.
-        ref<Texture> pTexture;
-        if (paths.size() > 1)
-        {
-            pTexture = Texture::createMippedFromFiles(mpDevice, paths, loadAsSRGB, bindFlags, importFlags);
-        }
-        else
-        {
-            pTexture = Texture::createFromFile(mpDevice, paths[0], generateMipLevels, loadAsSRGB, bindFlags, importFlags);
-        }
+        StreamedTexture streamed;
+        ref<Texture> pTexture = createTexture(textureKey, &streamed);
 
         // Add new texture desc.
         TextureDesc desc = {TextureState::Loaded, pTexture};
@@ -344,6 +357,9 @@ TextureManager::CpuTextureHandle TextureManager::loadTexture(
         if (pTexture)
             mTextureToHandle[pTexture.get()] = handle;
 
+        if (streamed.pTailTexture)
+            addStreamedTexture(handle, std::move(streamed));
+
         mCondition.notify_all();
 #endif
     }
@@ -391,6 +407,7 @@ void TextureManager::endDeferredLoading()
     {
         TextureKey key;
         CpuTextureHandle handle;
+        StreamedTexture streamed;
     };
 
     // Get a list of textures to load.
@@ -416,21 +433,10 @@ void TextureManager::endDeferredLoading()
         jobRange.end(),
         [&](size_t i)
         {
-            const auto& job = jobs[i];
+            auto& job = jobs[i];
             auto& desc = getDesc(job.handle);
-            if (job.key.fullPaths.size() == 1)
-            {
-                desc.pTexture = Texture::createFromFile(
-                    mpDevice, job.key.fullPaths[0], job.key.generateMipLevels, job.key.loadAsSRGB, job.key.bindFlags, job.key.importFlags
-                );
-                logDebug("Loading texture from '{}'", job.key.fullPaths[0]);
-            }
-            else
-            {
-                desc.pTexture =
-                    Texture::createMippedFromFiles(mpDevice, job.key.fullPaths, job.key.loadAsSRGB, job.key.bindFlags, job.key.importFlags);
-                logDebug("Loading mipped texture from '{}'", job.key.fullPaths[0]);
-            }
+            desc.pTexture = createTexture(job.key, &job.streamed);
+            logDebug("Loading {}texture from '{}'", job.key.fullPaths.size() > 1 ? "mipped " : "", job.key.fullPaths[0]);
             if (texturesLoaded.fetch_add(1) % 10 == 9)
             {
                 logDebug("Flush");
@@ -442,11 +448,13 @@ void TextureManager::endDeferredLoading()
     mpDevice->wait();
 
     // Mark loaded textures and add them to lookup table.
-    for (const auto& job : jobs)
+    for (auto& job : jobs)
     {
         auto& desc = getDesc(job.handle);
         desc.state = desc.pTexture ? TextureState::Loaded : TextureState::Invalid;
         mTextureToHandle[desc.pTexture.get()] = job.handle;
+        if (job.streamed.pTailTexture)
+            addStreamedTexture(job.handle, std::move(job.streamed));
     }
 }
 
@@ -492,6 +500,15 @@ void TextureManager::removeNonUdimTexture(const CpuTextureHandle& handle)
     if (it != mKeyToHandle.end())
         mKeyToHandle.erase(it);
 
+    // Streamed textures keep their tail texture mapped in addition to the resident texture.
+    if (auto streamedIt = mStreamedTextures.find(handle.getID()); streamedIt != mStreamedTextures.end())
+    {
+        if (streamedIt->second.pTailTexture != desc.pTexture)
+            mTextureToHandle.erase(streamedIt->second.pTailTexture.get());
+        mpStreamingPolicy->removeTexture(handle.getID());
+        mStreamedTextures.erase(streamedIt);
+    }
+
     if (desc.pTexture)
     {
         FALCOR_ASSERT(mTextureToHandle.find(desc.pTexture.get()) != mTextureToHandle.end());
@@ -642,9 +659,198 @@ TextureManager::Stats TextureManager::getStats() const
         if (isCompressedFormat(t.pTexture->getFormat()))
             s.textureCompressedCount++;
     }
+    if (mpStreamingPolicy)
+    {
+        const auto streamingStats = mpStreamingPolicy->getStats();
+        s.streamedTextureCount = streamingStats.textureCount;
+        s.streamingResidentBytes = streamingStats.residentBytes;
+        s.streamingRequestedBytes = streamingStats.requestedBytes;
+        s.streamingBudgetBytes = mpStreamingPolicy->getOptions().memoryBudget;
+        s.streamingPromotedMipCount = streamingStats.promotedMipCount;
+        s.streamingEvictedMipCount = streamingStats.evictedMipCount;
+    }
+    const auto loaderStats = mAsyncTextureLoader.getStats();
+    s.asyncLoadCompletedCount = loaderStats.completedCount;
+    s.asyncLoadCancelledCount = loaderStats.cancelledCount;
+    s.asyncLoadMissedDeadlineCount = loaderStats.missedDeadlineCount;
+    s.asyncLoadMaxBytesInFlight = loaderStats.maxBytesInFlight;
+    s.asyncLoadAverageLatency = loaderStats.averageLatency;
+    s.asyncLoadMaxLatency = loaderStats.maxLatency;
     return s;
 }
 
+void TextureManager::enableStreaming(const TextureStreamingPolicy::Options& options)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mpStreamingPolicy)
+    {
+        mpStreamingPolicy->setOptions(options);
+        return;
+    }
+    mpStreamingPolicy = std::make_unique<TextureStreamingPolicy>(options);
+    mpMipGenerator = std::make_unique<MipGenerator>();
+}
+
+void TextureManager::reportTextureUsage(const CpuTextureHandle& handle, uint32_t mipLevel)
+{
+    if (!mpStreamingPolicy || !handle || handle.isUdim())
+        return;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mpStreamingPolicy->reportUsage(handle.getID(), mipLevel);
+}
+
+bool TextureManager::updateStreaming()
+{
+    if (!mpStreamingPolicy)
+        return false;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    const std::vector<uint32_t> changedIDs = mpStreamingPolicy->update();
+    for (uint32_t id : changedIDs)
+    {
+        const CpuTextureHandle handle{id};
+        const StreamedTexture& streamed = mStreamedTextures.at(id);
+        const uint32_t residentMip = mpStreamingPolicy->getResidentMip(id);
+
+        // Replace the resident texture. The current texture is kept if the mips can't be generated.
+        ref<Texture> pTexture = residentMip < streamed.tailMip ? createResidentTexture(streamed, residentMip) : streamed.pTailTexture;
+        if (!pTexture)
+            continue;
+
+        // The tail texture stays mapped to the handle.
+        auto& desc = getDesc(handle);
+        if (desc.pTexture != streamed.pTailTexture)
+            mTextureToHandle.erase(desc.pTexture.get());
+        desc.pTexture = pTexture;
+        mTextureToHandle[desc.pTexture.get()] = handle;
+    }
+
+    return !changedIDs.empty();
+}
+
+bool TextureManager::isStreamable(const TextureKey& key) const
+{
+    return mpStreamingPolicy && key.fullPaths.size() == 1 && key.generateMipLevels && key.bindFlags == ResourceBindFlags::ShaderResource &&
+           !hasExtension(key.fullPaths[0], "dds");
+}
+
+ref<Texture> TextureManager::createTexture(const TextureKey& key, StreamedTexture* pStreamed) const
+{
+    if (key.fullPaths.size() > 1)
+        return Texture::createMippedFromFiles(mpDevice, key.fullPaths, key.loadAsSRGB, key.bindFlags, key.importFlags);
+
+    // Textures that can't be streamed, e.g. due to an unsupported format, are loaded as usual.
+    if (pStreamed && isStreamable(key))
+    {
+        if (auto pTexture = createStreamedTexture(key, *pStreamed))
+            return pTexture;
+    }
+
+    // Cached textures are loaded with ImageIO::loadTextureFromDDS(), which uses the default bind flags.
+    const auto& path = key.fullPaths[0];
+    if (mpTextureCache && key.bindFlags == ResourceBindFlags::ShaderResource && !hasExtension(path, "dds"))
+    {
+        auto cachePath =
+            mpTextureCache->getEntry(path, key.generateMipLevels, key.loadAsSRGB, key.importFlags, mpDevice->getHDRImageDecoder());
+        if (!cachePath.empty())
+        {
+            if (auto pTexture = ImageIO::loadTextureFromDDS(mpDevice, cachePath, key.loadAsSRGB))
+            {
+                pTexture->setSourcePath(path);
+                pTexture->setImportFlags(key.importFlags);
+                return pTexture;
+            }
+        }
+    }
+
+    return Texture::createFromFile(mpDevice, path, key.generateMipLevels, key.loadAsSRGB, key.bindFlags, key.importFlags);
+}
+
+ref<Texture> TextureManager::createStreamedTexture(const TextureKey& key, StreamedTexture& streamed) const
+{
+    const auto& path = key.fullPaths[0];
+    if (!std::filesystem::exists(path))
+        return nullptr;
+
+    Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(path, true, key.importFlags, mpDevice->getHDRImageDecoder());
+    if (!pBitmap || !MipGenerator::isFormatSupported(pBitmap->getFormat()))
+        return nullptr;
+
+    const ResourceFormat format = pBitmap->getFormat();
+    streamed.format = key.loadAsSRGB ? linearToSrgbFormat(format) : format;
+    streamed.path = path;
+    streamed.importFlags = key.importFlags;
+    streamed.loadAsSRGB = key.loadAsSRGB;
+    streamed.width = pBitmap->getWidth();
+    streamed.height = pBitmap->getHeight();
+
+    // Only keep the mip tail, the more detailed levels are generated again when promoted.
+    auto mips = mpMipGenerator->generate(*pBitmap, key.loadAsSRGB);
+    mips.insert(mips.begin(), std::move(pBitmap));
+    streamed.mipCount = (uint32_t)mips.size();
+    streamed.tailMip = TextureStreamingPolicy::computeTailMip(streamed.width, streamed.height, streamed.mipCount, mpStreamingPolicy->getOptions().tailSize);
+    std::move(mips.begin() + streamed.tailMip, mips.end(), std::back_inserter(streamed.tailMips));
+    streamed.pTailTexture = createResidentTexture(streamed, streamed.tailMip);
+
+    logDebug("Streaming texture from '{}': size={}x{} mips={} tail={}", path, streamed.width, streamed.height, streamed.mipCount, streamed.tailMip);
+    return streamed.pTailTexture;
+}
+
+ref<Texture> TextureManager::createResidentTexture(const StreamedTexture& streamed, uint32_t firstMip) const
+{
+    FALCOR_ASSERT(firstMip < streamed.mipCount);
+
+    std::vector<const Bitmap*> mips;
+    if (firstMip >= streamed.tailMip)
+    {
+        for (uint32_t mip = firstMip; mip < streamed.mipCount; ++mip)
+            mips.push_back(streamed.tailMips[mip - streamed.tailMip].get());
+        return createTextureFromMips(streamed, mips);
+    }
+
+    // Generate the levels above the mip tail from the source file. They are released once uploaded.
+    Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(streamed.path, true, streamed.importFlags, mpDevice->getHDRImageDecoder());
+    const bool changed = !pBitmap || pBitmap->getWidth() != streamed.width || pBitmap->getHeight() != streamed.height ||
+                         (streamed.loadAsSRGB ? linearToSrgbFormat(pBitmap->getFormat()) : pBitmap->getFormat()) != streamed.format;
+    if (changed)
+    {
+        logWarning("Failed to stream texture from '{}', the file has changed.", streamed.path);
+        return nullptr;
+    }
+    auto generated = mpMipGenerator->generate(*pBitmap, streamed.loadAsSRGB);
+    generated.insert(generated.begin(), std::move(pBitmap));
+    FALCOR_ASSERT(generated.size() == streamed.mipCount);
+
+    for (uint32_t mip = firstMip; mip < streamed.tailMip; ++mip)
+        mips.push_back(generated[mip].get());
+    for (const auto& pMip : streamed.tailMips)
+        mips.push_back(pMip.get());
+    return createTextureFromMips(streamed, mips);
+}
+
+ref<Texture> TextureManager::createTextureFromMips(const StreamedTexture& streamed, const std::vector<const Bitmap*>& mips) const
+{
+    // Pack the mip levels contiguously, as expected for the initial data of a texture.
+    std::vector<uint8_t> data;
+    for (const Bitmap* pMip : mips)
+        data.insert(data.end(), pMip->getData(), pMip->getData() + pMip->getSize());
+
+    ref<Texture> pTexture = mpDevice->createTexture2D(
+        mips[0]->getWidth(), mips[0]->getHeight(), streamed.format, 1, (uint32_t)mips.size(), data.data(), ResourceBindFlags::ShaderResource
+    );
+    pTexture->setSourcePath(streamed.path);
+    pTexture->setImportFlags(streamed.importFlags);
+    return pTexture;
+}
+
+void TextureManager::addStreamedTexture(const CpuTextureHandle& handle, StreamedTexture&& streamed)
+{
+    mpStreamingPolicy->addTexture(handle.getID(), streamed.width, streamed.height, streamed.mipCount, streamed.format);
+    FALCOR_ASSERT(mpStreamingPolicy->getTailMip(handle.getID()) == streamed.tailMip);
+    mStreamedTextures[handle.getID()] = std::move(streamed);
+}
+
 TextureManager::CpuTextureHandle TextureManager::addDesc(const TextureDesc& desc)
 {
     CpuTextureHandle handle;
@@ -27,6 +27,8 @@
  **************************************************************************/
 #pragma once
 #include "AsyncTextureLoader.h"
+#include "TextureCache.h"
+#include "TextureStreamingPolicy.h"
 #include "Core/Macros.h"
 #include "Core/API/fwd.h"
 #include "Core/API/Resource.h"
@@ -44,6 +46,7 @@
 namespace Falcor
 {
 class AssetResolver;
+class MipGenerator;
 
 /**
  * Multi-threaded texture manager.
@@ -54,6 +57,8 @@ class AssetResolver;
  * Each managed texture is assigned a unique handle upon loading.
  * This handle is used in shader code to reference the given texture
  * in the array of GPU texture descriptors.
+ *
+ * Optionally, textures can be streamed within a memory budget, see enableStreaming().
  */
 class FALCOR_API TextureManager
 {
@@ -68,11 +73,23 @@ public:
 
     struct Stats
     {
-        uint64_t textureCount = 0;             ///< Number of unique textures. A texture can be referenced by multiple materials.
-        uint64_t textureCompressedCount = 0;   ///< Number of unique compressed textures.
-        uint64_t textureTexelCount = 0;        ///< Total number of texels in all textures.
-        uint64_t textureTexelChannelCount = 0; ///< Total number of texel channels in all textures.
-        uint64_t textureMemoryInBytes = 0;     ///< Total memory in bytes used by the textures.
+        uint64_t textureCount = 0;                 ///< Number of unique textures. A texture can be referenced by multiple materials.
+        uint64_t textureCompressedCount = 0;       ///< Number of unique compressed textures.
+        uint64_t textureTexelCount = 0;            ///< Total number of texels in all textures.
+        uint64_t textureTexelChannelCount = 0;     ///< Total number of texel channels in all textures.
+        uint64_t textureMemoryInBytes = 0;         ///< Total memory in bytes used by the textures.
+        uint64_t streamedTextureCount = 0;         ///< Number of streamed textures.
+        uint64_t streamingResidentBytes = 0;       ///< Size of the resident mip levels of streamed textures in bytes.
+        uint64_t streamingRequestedBytes = 0;      ///< Size of the mip levels of streamed textures that are resident or wanted in bytes.
+        uint64_t streamingBudgetBytes = 0;         ///< Memory budget for streamed textures in bytes.
+        uint64_t streamingPromotedMipCount = 0;    ///< Total number of mip levels promoted by updateStreaming().
+        uint64_t streamingEvictedMipCount = 0;     ///< Total number of mip levels evicted by updateStreaming().
+        uint64_t asyncLoadCompletedCount = 0;      ///< Number of completed asynchronous load requests.
+        uint64_t asyncLoadCancelledCount = 0;      ///< Number of cancelled asynchronous load requests.
+        uint64_t asyncLoadMissedDeadlineCount = 0; ///< Number of asynchronous load requests completed after their deadline.
+        uint64_t asyncLoadMaxBytesInFlight = 0;    ///< Maximum size of decoded texture data waiting to be uploaded in bytes.
+        double asyncLoadAverageLatency = 0.0;      ///< Average time in seconds from request to completion of asynchronous loads.
+        double asyncLoadMaxLatency = 0.0;          ///< Maximum time in seconds from request to completion of asynchronous loads.
     };
 
     /**
@@ -146,6 +163,9 @@ public:
      */
     TextureManager(ref<Device> pDevice, size_t maxTextureCount, size_t threadCount = std::thread::hardware_concurrency());
 
+    /**
+     * Destructor. Cancels all pending load requests and waits for the requests in progress to finish.
+     */
     ~TextureManager();
 
     /**
@@ -169,6 +189,8 @@ public:
      * @param[in] importFlags Optional flags for the file import.
      * @param[in] assetResolver Optional asset resolver for resolving file paths.
      * @param[out] loadedTextureCount Optionally can provided the number of actually loaded textures (2+ can happen with UDIMs)
+     * @param[in] owner Optional object using the texture.
+     * @param[in] loadOptions Scheduling options of the asynchronous load request. Cancelled requests leave the texture loaded as nullptr.
      * @return Unique handle to the texture, or an invalid handle if the texture can't be found.
      */
     CpuTextureHandle loadTexture(
@@ -180,7 +202,8 @@ public:
         Bitmap::ImportFlags importFlags = Bitmap::ImportFlags::None,
         const AssetResolver* assetResolver = nullptr,
         size_t* loadedTextureCount = nullptr,
-        const Object* owner = nullptr
+        const Object* owner = nullptr,
+        const AsyncTextureLoader::LoadOptions& loadOptions = AsyncTextureLoader::LoadOptions()
     );
 
     /**
@@ -279,6 +302,43 @@ public:
      */
     Stats getStats() const;
 
+    /**
+     * Set a disk cache for processed textures, or nullptr to disable caching.
+     * Textures loaded from single non-DDS files with the default bind flags are then loaded from the cache.
+     * Asynchronous loads through AsyncTextureLoader do not use the cache.
+     * @param[in] pTextureCache The texture cache.
+     */
+    void setTextureCache(std::shared_ptr<TextureCache> pTextureCache) { mpTextureCache = std::move(pTextureCache); }
+    const std::shared_ptr<TextureCache>& getTextureCache() const { return mpTextureCache; }
+
+    /**
+     * Enable streaming of texture mip levels within a memory budget, or update the options if already enabled.
+     * Textures loaded afterwards from single non-DDS files with generated mips and the default bind flags are streamed.
+     * Only their mip tail is kept in CPU memory and resident on the GPU at first. More detailed levels are then promoted
+     * and evicted by updateStreaming() as decided by TextureStreamingPolicy. Promoted levels are generated from the source
+     * file on demand and released from CPU memory once uploaded.
+     * Streamed textures do not use the texture cache.
+     * @param[in] options Options for the streaming policy.
+     */
+    void enableStreaming(const TextureStreamingPolicy::Options& options = TextureStreamingPolicy::Options());
+    bool isStreamingEnabled() const { return mpStreamingPolicy != nullptr; }
+
+    /**
+     * Report that a texture was sampled in the current frame.
+     * Streamed textures without any reported usage want all their mip levels resident.
+     * Does nothing if the texture is not streamed. MaterialSystem::reportTextureUsage() reports the textures of a material.
+     * @param[in] handle Texture handle.
+     * @param[in] mipLevel Most detailed mip level sampled from the texture.
+     */
+    void reportTextureUsage(const CpuTextureHandle& handle, uint32_t mipLevel);
+
+    /**
+     * Promote and evict mip levels of streamed textures. This should be called once per frame.
+     * A texture whose resident mip levels change is replaced by a new texture object, so the textures need to be rebound.
+     * @return True if any texture was replaced.
+     */
+    bool updateStreaming();
+
 private:
     size_t getUdimRange(size_t requiredSize);
     void freeUdimRange(size_t rangeStart);
@@ -300,7 +360,8 @@ private:
         bool async = true,
         Bitmap::ImportFlags importFlags = Bitmap::ImportFlags::None,
         const AssetResolver* assetResolver = nullptr,
-        size_t* loadedTextureCount = nullptr
+        size_t* loadedTextureCount = nullptr,
+        const AsyncTextureLoader::LoadOptions& loadOptions = AsyncTextureLoader::LoadOptions()
     );
 
     /**
@@ -339,6 +400,29 @@ private:
         }
     };
 
+    /**
+     * State of a streamed texture. Only the mip tail is kept in CPU memory, more detailed levels are generated on demand.
+     */
+    struct StreamedTexture
+    {
+        std::vector<Bitmap::UniqueConstPtr> tailMips;    ///< Mip levels of the mip tail, starting with tailMip.
+        ResourceFormat format = ResourceFormat::Unknown; ///< Texture format, the sRGB format if loaded as sRGB.
+        std::filesystem::path path;                      ///< Source path.
+        Bitmap::ImportFlags importFlags = Bitmap::ImportFlags::None;
+        bool loadAsSRGB = false;
+        uint32_t width = 0;                              ///< Width of mip level 0.
+        uint32_t height = 0;                             ///< Height of mip level 0.
+        uint32_t mipCount = 0;                           ///< Number of mip levels.
+        uint32_t tailMip = 0;                            ///< First mip level of the mip tail.
+        ref<Texture> pTailTexture;                       ///< Texture holding the mip tail. It is kept alive as it may be referenced by materials.
+    };
+
+    bool isStreamable(const TextureKey& key) const;
+    ref<Texture> createTexture(const TextureKey& key, StreamedTexture* pStreamed = nullptr) const;
+    ref<Texture> createStreamedTexture(const TextureKey& key, StreamedTexture& streamed) const;
+    ref<Texture> createResidentTexture(const StreamedTexture& streamed, uint32_t firstMip) const;
+    ref<Texture> createTextureFromMips(const StreamedTexture& streamed, const std::vector<const Bitmap*>& mips) const;
+    void addStreamedTexture(const CpuTextureHandle& handle, StreamedTexture&& streamed);
     CpuTextureHandle addDesc(const TextureDesc& desc);
     TextureDesc& getDesc(const CpuTextureHandle& handle);
     void registerOwner(const CpuTextureHandle& handle, const Object* owner);
@@ -370,9 +454,17 @@ private:
 
     bool mUseDeferredLoading = false;
 
-    AsyncTextureLoader mAsyncTextureLoader; ///< Utility for asynchronous texture loading.
+    /// Cancellation tokens of the load requests in progress, indexed by handle ID.
+    std::map<uint32_t, AsyncTextureLoader::CancellationToken> mPendingLoads;
+
+    AsyncTextureLoader mAsyncTextureLoader;       ///< Utility for asynchronous texture loading.
+    std::shared_ptr<TextureCache> mpTextureCache; ///< Disk cache of processed textures, or nullptr if disabled.
     size_t mLoadRequestsInProgress = 0;     ///< Number of load requests currently in progress.
 
+    std::unique_ptr<TextureStreamingPolicy> mpStreamingPolicy; ///< Streaming policy, or nullptr if streaming is disabled.
+    std::unique_ptr<MipGenerator> mpMipGenerator;              ///< Generates the CPU mip chains of streamed textures.
+    std::map<uint32_t, StreamedTexture> mStreamedTextures;     ///< Streamed textures, indexed by handle ID.
+
     const size_t mMaxTextureCount; ///< Maximum number of textures that can be simultaneously managed.
 };
 } // namespace Falcor
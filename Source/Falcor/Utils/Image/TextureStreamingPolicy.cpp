@@ -0,0 +1,279 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "TextureStreamingPolicy.h"
+#include "Core/Error.h"
+#include <algorithm>
+
+namespace Falcor
+{
+TextureStreamingPolicy::TextureStreamingPolicy(const Options& options) : mOptions(options) {}
+
+void TextureStreamingPolicy::addTexture(uint32_t id, uint32_t width, uint32_t height, uint32_t mipCount, ResourceFormat format)
+{
+    FALCOR_CHECK(!hasTexture(id), "Texture {} already exists.", id);
+    FALCOR_CHECK(width > 0 && height > 0 && mipCount > 0, "Invalid texture dimensions.");
+
+    Texture texture;
+    texture.mipSizes.resize(mipCount);
+    for (uint32_t mip = 0; mip < mipCount; ++mip)
+        texture.mipSizes[mip] = getMipSize(width, height, format, mip);
+
+    texture.tailMip = computeTailMip(width, height, mipCount, mOptions.tailSize);
+    texture.residentMip = texture.tailMip;
+    for (uint32_t mip = texture.tailMip; mip < mipCount; ++mip)
+        texture.residentBytes += texture.mipSizes[mip];
+
+    mResidentBytes += texture.residentBytes;
+    mTextures.emplace(id, std::move(texture));
+}
+
+void TextureStreamingPolicy::removeTexture(uint32_t id)
+{
+    auto it = mTextures.find(id);
+    if (it == mTextures.end())
+        return;
+
+    if (it->second.isEvictable())
+        mVictims.erase(getVictimKey(id, it->second));
+    mResidentBytes -= it->second.residentBytes;
+    mTextures.erase(it);
+}
+
+void TextureStreamingPolicy::reportUsage(uint32_t id, uint32_t mipLevel)
+{
+    auto it = mTextures.find(id);
+    if (it == mTextures.end())
+        return;
+
+    auto& texture = it->second;
+    texture.frameMip = std::min(texture.frameMip, std::min(mipLevel, (uint32_t)texture.mipSizes.size() - 1));
+}
+
+std::vector<uint32_t> TextureStreamingPolicy::update()
+{
+    std::set<uint32_t> changed;
+
+    // Apply the reported usage.
+    for (auto& [id, texture] : mTextures)
+    {
+        if (texture.frameMip == kNoUsage)
+            continue;
+
+        if (texture.isEvictable())
+            mVictims.erase(getVictimKey(id, texture));
+        texture.desiredMip = texture.frameMip;
+        texture.lastUsedFrame = (int64_t)mFrameIndex;
+        texture.frameMip = kNoUsage;
+        if (texture.isEvictable())
+            mVictims.insert(getVictimKey(id, texture));
+    }
+
+    // Enforce the budget, which may have been reduced.
+    while (mResidentBytes > mOptions.memoryBudget && !mVictims.empty())
+    {
+        uint32_t id = std::get<3>(*mVictims.begin());
+        evict(id, mTextures.at(id));
+        changed.insert(id);
+    }
+
+    // Promotion order: most recently used first, then coarsest resident mip first.
+    using PromotionKey = std::tuple<int64_t, int64_t, uint32_t>;
+    auto getPromotionKey = [](uint32_t id, const Texture& texture)
+    { return PromotionKey(-texture.lastUsedFrame, -(int64_t)texture.residentMip, id); };
+
+    std::set<PromotionKey> candidates;
+    for (const auto& [id, texture] : mTextures)
+    {
+        if (texture.residentMip > texture.desiredMip)
+            candidates.insert(getPromotionKey(id, texture));
+    }
+
+    uint64_t promotedBytes = 0;
+    while (!candidates.empty())
+    {
+        uint32_t id = std::get<2>(*candidates.begin());
+        candidates.erase(candidates.begin());
+        auto& texture = mTextures.at(id);
+
+        // Always allow one promotion per update, so mips larger than the update budget are eventually loaded.
+        const uint64_t size = texture.mipSizes[texture.residentMip - 1];
+        if (promotedBytes > 0 && promotedBytes + size > mOptions.updateBudget)
+            break;
+
+        // Skip the candidate if it does not fit, a smaller mip of another texture may still fit.
+        if (mResidentBytes + size > mOptions.memoryBudget && !evictFor(texture, size, changed))
+            continue;
+
+        promote(id, texture);
+        promotedBytes += size;
+        changed.insert(id);
+
+        if (texture.residentMip > texture.desiredMip)
+            candidates.insert(getPromotionKey(id, texture));
+    }
+
+    mFrameIndex++;
+    return std::vector<uint32_t>(changed.begin(), changed.end());
+}
+
+uint32_t TextureStreamingPolicy::getResidentMip(uint32_t id) const
+{
+    auto it = mTextures.find(id);
+    FALCOR_CHECK(it != mTextures.end(), "Texture {} does not exist.", id);
+    return it->second.residentMip;
+}
+
+uint32_t TextureStreamingPolicy::getDesiredMip(uint32_t id) const
+{
+    auto it = mTextures.find(id);
+    FALCOR_CHECK(it != mTextures.end(), "Texture {} does not exist.", id);
+    return it->second.desiredMip;
+}
+
+uint32_t TextureStreamingPolicy::getTailMip(uint32_t id) const
+{
+    auto it = mTextures.find(id);
+    FALCOR_CHECK(it != mTextures.end(), "Texture {} does not exist.", id);
+    return it->second.tailMip;
+}
+
+uint32_t TextureStreamingPolicy::computeTailMip(uint32_t width, uint32_t height, uint32_t mipCount, uint32_t tailSize)
+{
+    FALCOR_CHECK(mipCount > 0, "'mipCount' must be at least 1.");
+    // The tail starts at the first level that fits in the tail size.
+    for (uint32_t mip = 0; mip < mipCount; ++mip)
+    {
+        if (std::max(width >> mip, 1u) <= tailSize && std::max(height >> mip, 1u) <= tailSize)
+            return mip;
+    }
+    return mipCount - 1;
+}
+
+TextureStreamingPolicy::Stats TextureStreamingPolicy::getStats() const
+{
+    Stats stats;
+    stats.textureCount = mTextures.size();
+    stats.residentBytes = mResidentBytes;
+    stats.promotedMipCount = mPromotedMipCount;
+    stats.evictedMipCount = mEvictedMipCount;
+    for (const auto& [id, texture] : mTextures)
+    {
+        const uint32_t mipCount = (uint32_t)texture.mipSizes.size();
+        for (uint32_t mip = std::min(texture.residentMip, texture.desiredMip); mip < mipCount; ++mip)
+        {
+            stats.requestedBytes += texture.mipSizes[mip];
+            if (mip >= texture.tailMip)
+                stats.tailBytes += texture.mipSizes[mip];
+        }
+    }
+    return stats;
+}
+
+uint64_t TextureStreamingPolicy::getMipSize(uint32_t width, uint32_t height, ResourceFormat format, uint32_t mipLevel)
+{
+    const uint32_t mipWidth = std::max(width >> mipLevel, 1u);
+    const uint32_t mipHeight = std::max(height >> mipLevel, 1u);
+    const uint32_t blockWidth = getFormatWidthCompressionRatio(format);
+    const uint32_t blockHeight = getFormatHeightCompressionRatio(format);
+    return (uint64_t)((mipWidth + blockWidth - 1) / blockWidth) * ((mipHeight + blockHeight - 1) / blockHeight) *
+           getFormatBytesPerBlock(format);
+}
+
+TextureStreamingPolicy::VictimKey TextureStreamingPolicy::getVictimKey(uint32_t id, const Texture& texture)
+{
+    return VictimKey(!texture.isOverResident(), texture.lastUsedFrame, texture.residentMip, id);
+}
+
+uint32_t TextureStreamingPolicy::getEvictionLimit(const Texture& victim, const Texture& candidate)
+{
+    // Less recently used textures can be evicted down to the tail, others only down to the mip they use.
+    if (victim.lastUsedFrame < candidate.lastUsedFrame)
+        return victim.tailMip;
+    return std::min(victim.desiredMip, victim.tailMip);
+}
+
+void TextureStreamingPolicy::promote(uint32_t id, Texture& texture)
+{
+    FALCOR_ASSERT(texture.residentMip > 0);
+    if (texture.isEvictable())
+        mVictims.erase(getVictimKey(id, texture));
+
+    texture.residentMip--;
+    texture.residentBytes += texture.mipSizes[texture.residentMip];
+    mResidentBytes += texture.mipSizes[texture.residentMip];
+    mPromotedMipCount++;
+
+    if (texture.isEvictable())
+        mVictims.insert(getVictimKey(id, texture));
+}
+
+void TextureStreamingPolicy::evict(uint32_t id, Texture& texture)
+{
+    FALCOR_ASSERT(texture.isEvictable());
+    mVictims.erase(getVictimKey(id, texture));
+
+    texture.residentBytes -= texture.mipSizes[texture.residentMip];
+    mResidentBytes -= texture.mipSizes[texture.residentMip];
+    texture.residentMip++;
+    mEvictedMipCount++;
+
+    if (texture.isEvictable())
+        mVictims.insert(getVictimKey(id, texture));
+}
+
+bool TextureStreamingPolicy::evictFor(const Texture& candidate, uint64_t requiredBytes, std::set<uint32_t>& changed)
+{
+    const uint64_t targetBytes = mOptions.memoryBudget >= requiredBytes ? mOptions.memoryBudget - requiredBytes : 0;
+    if (mResidentBytes <= targetBytes)
+        return true;
+
+    // Check that enough memory can be freed before evicting anything.
+    uint64_t evictableBytes = 0;
+    for (const auto& key : mVictims)
+    {
+        const auto& victim = mTextures.at(std::get<3>(key));
+        for (uint32_t mip = victim.residentMip; mip < getEvictionLimit(victim, candidate); ++mip)
+            evictableBytes += victim.mipSizes[mip];
+        if (mResidentBytes - evictableBytes <= targetBytes)
+            break;
+    }
+    if (mResidentBytes - std::min(evictableBytes, mResidentBytes) > targetBytes)
+        return false;
+
+    while (mResidentBytes > targetBytes)
+    {
+        // Victims are ordered such that the first one is always evictable if any is.
+        uint32_t id = std::get<3>(*mVictims.begin());
+        auto& victim = mTextures.at(id);
+        FALCOR_ASSERT(victim.residentMip < getEvictionLimit(victim, candidate));
+        evict(id, victim);
+        changed.insert(id);
+    }
+    return true;
+}
+} // namespace Falcor
@@ -0,0 +1,200 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/Macros.h"
+#include "Core/API/Formats.h"
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <set>
+#include <tuple>
+#include <vector>
+
+namespace Falcor
+{
+/**
+ * Residency and eviction policy for streamed textures.
+ *
+ * This class decides which mip levels of a set of textures are resident within a memory budget. It does not
+ * own any resources, so it can be used and tested without a GPU device. Each texture has a resident mip, which
+ * is the most detailed mip level resident in memory; all coarser levels are resident as well. The mip tail,
+ * i.e. all levels no larger than Options::tailSize, is always resident, so textures are loaded coarse mips first.
+ *
+ * Usage is reported with reportUsage() as the most detailed mip level sampled from a texture, e.g. from
+ * shader feedback. Textures that have never been used want their full mip chain. Each call to update()
+ * promotes textures one mip level at a time, in order of most recently used first and coarsest resident mip
+ * first, so that the available memory is spread over all textures before any is refined further. When the
+ * budget is exhausted, mips are evicted from textures that have more levels resident than they use, and
+ * then from the least recently used textures. A texture is never evicted in favor of a texture that was
+ * used less recently.
+ *
+ * The policy is deterministic: the result only depends on the sequence of calls, with ties broken by ID.
+ */
+class FALCOR_API TextureStreamingPolicy
+{
+public:
+    struct Options
+    {
+        /// Memory budget for all textures in bytes.
+        uint64_t memoryBudget = 1024ull * 1024 * 1024;
+        /// Maximum number of bytes promoted per call to update(), to bound the upload work per frame.
+        uint64_t updateBudget = 64ull * 1024 * 1024;
+        /// Mip levels with width and height no larger than this are always resident.
+        uint32_t tailSize = 64;
+
+        // Note: Empty constructor needed for clang due to the use of the nested struct constructor in the parent constructor.
+        Options() {}
+    };
+
+    struct Stats
+    {
+        uint64_t textureCount = 0;      ///< Number of streamed textures.
+        uint64_t residentBytes = 0;     ///< Size of all resident mip levels in bytes.
+        uint64_t tailBytes = 0;         ///< Size of all mip tails in bytes. These are resident even if over budget.
+        uint64_t requestedBytes = 0;    ///< Size of all mip levels that are resident or wanted in bytes.
+        uint64_t promotedMipCount = 0;  ///< Total number of mip levels promoted by update().
+        uint64_t evictedMipCount = 0;   ///< Total number of mip levels evicted by update().
+    };
+
+    /**
+     * Create a policy.
+     * @param[in] options Options.
+     */
+    TextureStreamingPolicy(const Options& options = Options());
+
+    /**
+     * Set the options. A smaller memory budget is enforced on the next update().
+     * The tail size only applies to textures added afterwards.
+     */
+    void setOptions(const Options& options) { mOptions = options; }
+    const Options& getOptions() const { return mOptions; }
+
+    /**
+     * Add a texture. Its mip tail is resident.
+     * Throws an exception if a texture with the same ID already exists.
+     * @param[in] id Unique texture ID.
+     * @param[in] width Width of mip level 0.
+     * @param[in] height Height of mip level 0.
+     * @param[in] mipCount Number of mip levels.
+     * @param[in] format Texture format, used to compute the size of mip levels.
+     */
+    void addTexture(uint32_t id, uint32_t width, uint32_t height, uint32_t mipCount, ResourceFormat format);
+
+    /**
+     * Remove a texture. Does nothing if the texture does not exist.
+     */
+    void removeTexture(uint32_t id);
+
+    bool hasTexture(uint32_t id) const { return mTextures.find(id) != mTextures.end(); }
+
+    /**
+     * Report that a texture was used in the current frame.
+     * Multiple reports for the same texture in a frame are combined.
+     * @param[in] id Texture ID. Unknown IDs are ignored.
+     * @param[in] mipLevel Most detailed mip level sampled from the texture.
+     */
+    void reportUsage(uint32_t id, uint32_t mipLevel);
+
+    /**
+     * Apply the usage reported since the last update, promote and evict mips, and start a new frame.
+     * @return IDs of the textures whose resident mip changed, in ascending order.
+     */
+    std::vector<uint32_t> update();
+
+    /**
+     * Get the most detailed resident mip level of a texture.
+     * Throws an exception if the texture does not exist.
+     */
+    uint32_t getResidentMip(uint32_t id) const;
+
+    /**
+     * Get the most detailed mip level a texture should have resident, based on the reported usage.
+     * Throws an exception if the texture does not exist.
+     */
+    uint32_t getDesiredMip(uint32_t id) const;
+
+    /**
+     * Get the first mip level of the always resident mip tail of a texture.
+     * Throws an exception if the texture does not exist.
+     */
+    uint32_t getTailMip(uint32_t id) const;
+
+    /**
+     * Get the index of the current frame, i.e. the number of calls to update().
+     */
+    uint64_t getFrameIndex() const { return mFrameIndex; }
+
+    Stats getStats() const;
+
+    /**
+     * Compute the first mip level of the mip tail, i.e. the first level no larger than the tail size.
+     * This is the tail mip getTailMip() returns for textures added with the given tail size.
+     */
+    static uint32_t computeTailMip(uint32_t width, uint32_t height, uint32_t mipCount, uint32_t tailSize);
+
+    /**
+     * Get the size of a mip level in bytes.
+     */
+    static uint64_t getMipSize(uint32_t width, uint32_t height, ResourceFormat format, uint32_t mipLevel);
+
+private:
+    static constexpr uint32_t kNoUsage = std::numeric_limits<uint32_t>::max();
+    static constexpr int64_t kNeverUsed = -1;
+
+    struct Texture
+    {
+        std::vector<uint64_t> mipSizes;
+        uint32_t tailMip = 0;
+        uint32_t residentMip = 0;
+        uint32_t desiredMip = 0;
+        uint32_t frameMip = kNoUsage; ///< Most detailed mip reported in the current frame.
+        int64_t lastUsedFrame = kNeverUsed;
+        uint64_t residentBytes = 0;
+
+        bool isOverResident() const { return residentMip < desiredMip; }
+        bool isEvictable() const { return residentMip < tailMip; }
+    };
+
+    /// Eviction order: over-resident textures first, then least recently used, then most detailed resident mip.
+    using VictimKey = std::tuple<bool, int64_t, uint32_t, uint32_t>;
+
+    static VictimKey getVictimKey(uint32_t id, const Texture& texture);
+    static uint32_t getEvictionLimit(const Texture& victim, const Texture& candidate);
+    void promote(uint32_t id, Texture& texture);
+    void evict(uint32_t id, Texture& texture);
+    bool evictFor(const Texture& candidate, uint64_t requiredBytes, std::set<uint32_t>& changed);
+
+    Options mOptions;
+    std::map<uint32_t, Texture> mTextures;
+    std::set<VictimKey> mVictims; ///< Textures with mips above the tail resident, in eviction order.
+    uint64_t mResidentBytes = 0;
+    uint64_t mFrameIndex = 0;
+    uint64_t mPromotedMipCount = 0;
+    uint64_t mEvictedMipCount = 0;
+};
+} // namespace Falcor
@@ -1,5 +1,5 @@
 /***************************************************************************
- # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
  #
  # Redistribution and use in source and binary forms, with or without
  # modification, are permitted provided that the following conditions
@@ -25,27 +25,31 @@
  # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
  # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  **************************************************************************/
-
-// This code is based on pbrt:
-// pbrt is Copyright(c) 1998-2020 Matt Pharr, Wenzel Jakob, and Greg Humphreys.
-// The pbrt source code is licensed under the Apache License, Version 2.0.
-// SPDX: Apache-2.0
-
 #pragma once
-#include "Utils/Math/Vector.h"
-#include <fstd/span.h> // TODO C++20: Replace with <span>
-#include <vector>
+#include <BS_thread_pool.hpp>
+#include <algorithm>
+#include <cstdint>
 
-namespace Falcor::pbrt
+namespace Falcor
 {
-
-struct LoopSubdivideResult
+/**
+ * Run func(begin, end) over contiguous blocks of [0, count) on a thread pool and wait for all blocks to finish.
+ * The loop runs on the calling thread if there is no thread pool or if it fits in a single block.
+ * @param[in] pThreadPool Thread pool, or nullptr to run on the calling thread.
+ * @param[in] count Number of iterations.
+ * @param[in] func Function called with the iteration range [begin, end) of each block.
+ * @param[in] minBlockSize Minimum number of iterations per block, used to keep the tasks from becoming too small.
+ */
+template<typename Func>
+void parallelFor(BS::thread_pool* pThreadPool, uint32_t count, const Func& func, uint32_t minBlockSize = 1)
 {
-    std::vector<float3> positions;
-    std::vector<float3> normals;
-    std::vector<uint32_t> indices;
-};
-
-LoopSubdivideResult loopSubdivide(uint32_t levels, fstd::span<const float3> positions, fstd::span<const uint32_t> vertices);
+    if (!pThreadPool || count <= std::max(minBlockSize, 1u))
+    {
+        func(0u, count);
+        return;
+    }
 
-} // namespace Falcor::pbrt
+    const uint32_t blockCount = std::min<uint32_t>(pThreadPool->get_thread_count(), (count + minBlockSize - 1) / minBlockSize);
+    pThreadPool->parallelize_loop(0u, count, func, blockCount).wait();
+}
+} // namespace Falcor
@@ -723,7 +723,7 @@ ref<Texture> PreviewSurfaceConverter::loadTexture(const StandardMaterialSpec::Co
     {
         // Create the texture by first reading the image (which is relatively slow) outside of the mutex,
         // and then creating the texture itself inside it.
-        Bitmap::UniqueConstPtr pBitmap(Bitmap::createFromFile(ci.texturePath, false));
+        Bitmap::UniqueConstPtr pBitmap(Bitmap::createFromFile(ci.texturePath, false, Bitmap::ImportFlags::None, mpDevice->getHDRImageDecoder()));
         if (pBitmap)
         {
             ResourceFormat format = pBitmap->getFormat();
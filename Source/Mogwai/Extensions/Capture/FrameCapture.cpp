@@ -28,6 +28,7 @@
 #include "Falcor.h"
 #include "FrameCapture.h"
 #include "Utils/Scripting/ScriptWriter.h"
+#include "Utils/StringUtils.h"
 #include <filesystem>
 
 namespace Mogwai
@@ -42,6 +43,10 @@ namespace Mogwai
         const std::string kOutputs = "outputs";
         const std::string kCapture = "capture";
 
+        // Number of images whose readback can be in flight. Resolving a readback waits for the GPU copy, keeping a
+        // few frames in flight lets rendering continue while earlier frames are copied.
+        const size_t kMaxPendingReadbacks = 8;
+
         template<typename T>
         std::vector<typename T::value_type::first_type> getFirstOfPair(const T& pair)
         {
@@ -63,6 +68,13 @@ namespace Mogwai
         : CaptureTrigger(pRenderer, "Frame Capture")
     {
         mpImageProcessing = std::make_unique<ImageProcessing>(pRenderer->getDevice());
+        mpImageWriter = std::make_unique<AsyncImageWriter>();
+    }
+
+    FrameCapture::~FrameCapture()
+    {
+        // Write the remaining images. The writer blocks until they are on disk.
+        resolveReadbacks(0);
     }
 
     void FrameCapture::renderUI(Gui* pGui)
@@ -154,6 +166,15 @@ namespace Mogwai
             for (const auto& output : unmarkedOutputs) pGraph->unmarkOutput(output);
             pGraph->compile(pRenderContext);
         }
+
+        resolveReadbacks(kMaxPendingReadbacks);
+    }
+
+    void FrameCapture::endRange(RenderGraph* pGraph, const Range& r)
+    {
+        resolveReadbacks(0);
+        mpImageWriter->flush();
+        logWriterStats();
     }
 
     void FrameCapture::captureOutput(RenderContext* pRenderContext, RenderGraph* pGraph, const uint32_t outputIndex)
@@ -248,10 +269,59 @@ namespace Mogwai
             Bitmap::ExportFlags flags = Bitmap::ExportFlags::None;
             if (mask == TextureChannelFlags::RGBA) flags |= Bitmap::ExportFlags::ExportAlpha;
 
-            pTex->captureToFile(0, 0, filename, fileformat, flags);
+            queueReadback(pRenderContext, pTex, filename, fileformat, flags);
         }
     }
 
+    void FrameCapture::queueReadback(RenderContext* pRenderContext, const ref<Texture>& pTex, const std::string& filename, Bitmap::FileFormat fileFormat, Bitmap::ExportFlags exportFlags)
+    {
+        if (fileFormat == Bitmap::FileFormat::DdsFile) FALCOR_THROW("Frame capture does not support saving to DDS.");
+
+        AsyncImageWriter::Image image;
+        image.path = filename;
+        image.width = pTex->getWidth();
+        image.height = pTex->getHeight();
+        image.fileFormat = fileFormat;
+        image.exportFlags = exportFlags;
+        image.resourceFormat = pTex->getFormat();
+
+        // HDR textures with less than 3 channels are expanded to RGBA, as in Texture::captureToFile().
+        ref<Texture> pSrc = pTex;
+        if (getFormatType(pTex->getFormat()) == FormatType::Float && getFormatChannelCount(pTex->getFormat()) < 3)
+        {
+            pSrc = mpRenderer->getDevice()->createTexture2D(image.width, image.height, ResourceFormat::RGBA32Float, 1, 1, nullptr, ResourceBindFlags::RenderTarget | ResourceBindFlags::ShaderResource);
+            pRenderContext->blit(pTex->getSRV(0, 1, 0, 1), pSrc->getRTV(0, 0, 1));
+            image.resourceFormat = ResourceFormat::RGBA32Float;
+        }
+
+        mPendingReadbacks.push_back({ pRenderContext->asyncReadTextureSubresource(pSrc.get(), 0), std::move(image) });
+    }
+
+    void FrameCapture::resolveReadbacks(size_t maxPendingCount)
+    {
+        // Hand the oldest readbacks to the writer. This blocks if the encoders fall behind the memory budget.
+        while (mPendingReadbacks.size() > maxPendingCount)
+        {
+            PendingReadback readback = std::move(mPendingReadbacks.front());
+            mPendingReadbacks.pop_front();
+            readback.image.data = readback.pTask->getData();
+            mpImageWriter->write(std::move(readback.image));
+        }
+    }
+
+    void FrameCapture::logWriterStats()
+    {
+        const auto stats = mpImageWriter->getStats();
+        if (stats.submittedCount == 0) return;
+
+        logInfo("Frame capture wrote {} images ({}) in {:.2f} s ({}/s). Encoding took {:.2f} s, rendering stalled {} times for {:.2f} s waiting for the disk.",
+            stats.completedCount - stats.failedCount, formatByteSize(stats.bytesWritten), stats.elapsedTime, formatByteSize((size_t)stats.getThroughput()),
+            stats.encodeTime, stats.stallCount, stats.stallTime);
+        if (stats.failedCount > 0) logWarning("Frame capture failed to write {} images.", stats.failedCount);
+
+        mpImageWriter->resetStats();
+    }
+
     void FrameCapture::addFrames(const RenderGraph* pGraph, const uint64_vec& frames)
     {
         for (auto f : frames) addRange(pGraph, f, 1);
@@ -278,5 +348,10 @@ namespace Mogwai
         if (!pGraph) return;
         uint64_t frameID = mpRenderer->getGlobalClock().getFrame();
         triggerFrame(mpRenderer->getRenderContext(), pGraph, frameID);
+
+        // Single captures are written before returning.
+        resolveReadbacks(0);
+        mpImageWriter->flush();
+        logWriterStats();
     }
 }
@@ -28,7 +28,9 @@
 #pragma once
 #include "../../Mogwai.h"
 #include "CaptureTrigger.h"
+#include "Utils/Image/AsyncImageWriter.h"
 #include "Utils/Image/ImageProcessing.h"
+#include <deque>
 
 namespace Mogwai
 {
@@ -36,11 +38,13 @@ namespace Mogwai
     {
     public:
         static UniquePtr create(Renderer* pRenderer);
+        ~FrameCapture();
         virtual void renderUI(Gui* pGui) override;
         virtual void registerScriptBindings(pybind11::module& m) override;
         virtual std::string getScriptVar() const override;
         virtual std::string getScript(const std::string& var) const override;
         virtual void triggerFrame(RenderContext* pRenderContext, RenderGraph* pGraph, uint64_t frameID) override;
+        virtual void endRange(RenderGraph* pGraph, const Range& r) override;
         void capture();
 
     private:
@@ -51,8 +55,21 @@ namespace Mogwai
         void addFrames(const std::string& graphName, const uint64_vec& frames);
         std::string graphFramesStr(const RenderGraph* pGraph);
         void captureOutput(RenderContext* pRenderContext, RenderGraph* pGraph, const uint32_t outputIndex);
+        void queueReadback(RenderContext* pRenderContext, const ref<Texture>& pTex, const std::string& filename, Bitmap::FileFormat fileFormat, Bitmap::ExportFlags exportFlags);
+        void resolveReadbacks(size_t maxPendingCount);
+        void logWriterStats();
+
+        /** Readback of a captured image, written once the copy has completed on the GPU.
+        */
+        struct PendingReadback
+        {
+            CopyContext::ReadTextureTask::SharedPtr pTask;
+            AsyncImageWriter::Image image;      ///< Image description, without data.
+        };
 
         bool mCaptureAllOutputs = false;
         std::unique_ptr<ImageProcessing> mpImageProcessing;
+        std::deque<PendingReadback> mPendingReadbacks;  ///< Readbacks in flight, oldest first.
+        std::unique_ptr<AsyncImageWriter> mpImageWriter;
     };
 }
@@ -87,6 +87,7 @@ namespace Mogwai
             bool silentMode = false;
             bool useSceneCache = false;
             bool rebuildSceneCache = false;
+            bool useTextureCache = false;
         };
 
         using KeyCallback = std::function<bool(bool pressed, uint32_t key)>;
@@ -8,7 +8,7 @@ struct DensityChild
     uint index;
     float accumulator;
 
-    bool isLeaf() { return index == 0; }
+    bool isLeaf() const { return index == 0; }
 };
 
 #define PARENT_OFFSET_BIT_COUNT 3
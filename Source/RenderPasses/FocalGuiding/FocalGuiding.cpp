@@ -2,6 +2,7 @@
 #include "RenderGraph/RenderPassHelpers.h"
 #include "RenderGraph/RenderPassStandardFlags.h"
 #include "FocalDensities.h"
+#include "FocalGuidingCPU.h"
 #include "FocalViz.h"
 #include "GuidedRayViz.h"
 #include "GuidedRays.h"
@@ -17,6 +18,7 @@ extern "C" FALCOR_API_EXPORT void registerPlugin(Falcor::PluginRegistry& registr
     registry.registerClass<RenderPass, GuidedRays>();
     registry.registerClass<RenderPass, NodeSplitting>();
     registry.registerClass<RenderPass, NodePruning>();
+    ScriptBindings::registerBinding(FocalGuidingCPU::registerBindings);
 }
 
 namespace
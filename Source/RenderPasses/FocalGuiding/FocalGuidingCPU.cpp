@@ -0,0 +1,1043 @@
+#include "FocalGuidingCPU.h"
+#include "Utils/ParallelFor.h"
+#include "Utils/Properties.h"
+#include "Utils/Scripting/ndarray.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+// Maximum number of density accumulation buffers used by a training pass. The tiles are distributed over this many
+// batches, each accumulating into its own buffer. The count doesn't depend on the machine so that the order of the
+// reduction is fixed.
+const uint32_t kMaxTrainingBatchCount = 256;
+
+// Minimum number of octree nodes reduced by a thread.
+const uint32_t kMinNodeBlockSize = 64;
+
+// Constants matching the GPU passes.
+const float3 kIntensityFactor = float3(1.f / 3.f);
+const float kGuidedRaysMinRoughness = 0.1f;
+const float kMinCosTheta = 1e-6f;
+const float kMinGGXAlpha = 0.0064f;
+const float kMinLightDistSqr = 1e-9f;
+const float kDielectricF0 = 0.04f;
+
+/** Pseudorandom number generator based on SplitMix64.
+*/
+struct RandomGenerator
+{
+    uint64_t state;
+
+    RandomGenerator(uint2 pixel, uint32_t sampleIndex, uint32_t stream)
+    {
+        state = ((uint64_t)pixel.y << 32 | pixel.x) * 0x9e3779b97f4a7c15ull;
+        state ^= ((uint64_t)stream << 32 | sampleIndex) * 0xbf58476d1ce4e5b9ull;
+        next();
+    }
+
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    float next1D() { return (next() >> 40) * (1.f / 16777216.f); }
+};
+
+float luminance(const float3& rgb)
+{
+    return dot(rgb, float3(0.2126f, 0.7152f, 0.0722f));
+}
+
+/** Offset a ray origin along the face normal to avoid self-intersection. This is a port of computeRayOrigin().
+*/
+float3 computeRayOrigin(const float3& pos, const float3& normal)
+{
+    const float kOrigin = 1.f / 32.f;
+    const float kFloatScale = 1.f / 65536.f;
+    const float kIntScale = 256.f;
+
+    float3 result;
+    for (int i = 0; i < 3; ++i)
+    {
+        const int32_t intOffset = (int32_t)(normal[i] * kIntScale);
+        const float intPos = math::asfloat(math::asint(pos[i]) + (pos[i] < 0.f ? -intOffset : intOffset));
+        result[i] = std::abs(pos[i]) < kOrigin ? pos[i] + normal[i] * kFloatScale : intPos;
+    }
+    return result;
+}
+
+void buildFrame(const float3& N, float3& T, float3& B)
+{
+    // Branchless orthonormal basis by Duff et al., "Building an Orthonormal Basis, Revisited", JCGT 2017.
+    const float sign = std::copysign(1.f, N.z);
+    const float a = -1.f / (sign + N.z);
+    const float b = N.x * N.y * a;
+    T = float3(1.f + sign * N.x * N.x * a, sign * b, -sign * N.x);
+    B = float3(b, sign + N.y * N.y * a, -N.y);
+}
+
+float evalNdfGGX(float alpha, float cosTheta)
+{
+    const float a2 = alpha * alpha;
+    const float d = ((cosTheta * a2 - cosTheta) * cosTheta + 1.f);
+    return a2 / (d * d * float(M_PI));
+}
+
+float evalG1GGX(float alpha, float cosTheta)
+{
+    const float a2 = alpha * alpha;
+    return 2.f * cosTheta / (cosTheta + std::sqrt(a2 + (1.f - a2) * cosTheta * cosTheta));
+}
+
+// Octree helpers, see DensityNode.slang.
+
+AABB shrinkBox(const AABB& box, uint32_t childIndex)
+{
+    const float3 axisIndices = float3(float(childIndex % 2), float((childIndex / 2) % 2), float(childIndex / 4));
+    const float3 halfExtent = box.extent() * 0.5f;
+    const float3 minPoint = box.minPoint + axisIndices * halfExtent;
+    return AABB(minPoint, minPoint + halfExtent);
+}
+
+bool intersectRayAABB(const float3& origin, const float3& dir, const AABB& box, float2& nearFar)
+{
+    const float3 invDir = 1.f / dir;
+    const float3 lo = (box.minPoint - origin) * invDir;
+    const float3 hi = (box.maxPoint - origin) * invDir;
+    const float3 tmin = min(lo, hi), tmax = max(lo, hi);
+    nearFar.x = std::max(0.f, std::max(tmin.x, std::max(tmin.y, tmin.z)));
+    nearFar.y = std::min(tmax.x, std::min(tmax.y, tmax.z));
+    return nearFar.x <= nearFar.y;
+}
+
+/** Traversal state shared by the recursive octree functions.
+    The depth passed to the functions counts the node itself, so the root node is at depth 1 and nodes at
+    maxOctreeDepth are treated as leaves, matching the traversal stacks of the GPU passes.
+*/
+struct OctreeRay
+{
+    const std::vector<DensityNode>& nodes;
+    uint32_t maxOctreeDepth;
+    float3 origin;
+    float3 dir;
+    float hitDist;
+    float invGlobalAccumulator;
+};
+
+void storeDensitiesNoNarrowing(const OctreeRay& ray, uint32_t nodeIndex, const AABB& box, uint32_t depth, float contribution, float* pAccumulators)
+{
+    for (uint32_t childIndex = 0; childIndex < 8; ++childIndex)
+    {
+        const DensityChild& child = ray.nodes[nodeIndex].childs[childIndex];
+        const AABB childBox = shrinkBox(box, childIndex);
+        float2 nearFar;
+        if (!intersectRayAABB(ray.origin, ray.dir, childBox, nearFar) || nearFar.x >= ray.hitDist) continue;
+
+        const float lengthWeight = std::min(ray.hitDist, nearFar.y) - nearFar.x;
+        pAccumulators[nodeIndex * 8 + childIndex] += lengthWeight * contribution;
+        if (!child.isLeaf() && depth < ray.maxOctreeDepth)
+        {
+            storeDensitiesNoNarrowing(ray, child.index, childBox, depth + 1, contribution, pAccumulators);
+        }
+    }
+}
+
+float computeNarrowingWeight(const OctreeRay& ray, const DensityChild& child, const AABB& childBox, const float2& nearFar, float narrowFactor)
+{
+    const float lengthWeight = std::min(ray.hitDist, nearFar.y) - nearFar.x;
+    const float densityTimesVolume = child.accumulator * ray.invGlobalAccumulator / childBox.volume();
+    return std::pow(lengthWeight * densityTimesVolume, narrowFactor);
+}
+
+float sumNarrowingWeights(const OctreeRay& ray, uint32_t nodeIndex, const AABB& box, uint32_t depth, float narrowFactor)
+{
+    float weightsSum = 0.f;
+    for (uint32_t childIndex = 0; childIndex < 8; ++childIndex)
+    {
+        const DensityChild& child = ray.nodes[nodeIndex].childs[childIndex];
+        const AABB childBox = shrinkBox(box, childIndex);
+        float2 nearFar;
+        if (!intersectRayAABB(ray.origin, ray.dir, childBox, nearFar) || nearFar.x >= ray.hitDist) continue;
+
+        if (child.isLeaf() || depth >= ray.maxOctreeDepth)
+            weightsSum += computeNarrowingWeight(ray, child, childBox, nearFar, narrowFactor);
+        else
+            weightsSum += sumNarrowingWeights(ray, child.index, childBox, depth + 1, narrowFactor);
+    }
+    return weightsSum;
+}
+
+/** Distribute a contribution over the intersected leaves proportionally to their narrowing weights.
+    Internal nodes receive the sum of their leaves.
+    \return Sum of the narrowing weights of the subtree.
+*/
+float storeDensitiesWithNarrowing(const OctreeRay& ray, uint32_t nodeIndex, const AABB& box, uint32_t depth, float narrowFactor, float scale, float* pAccumulators)
+{
+    float subtreeWeight = 0.f;
+    for (uint32_t childIndex = 0; childIndex < 8; ++childIndex)
+    {
+        const DensityChild& child = ray.nodes[nodeIndex].childs[childIndex];
+        const AABB childBox = shrinkBox(box, childIndex);
+        float2 nearFar;
+        if (!intersectRayAABB(ray.origin, ray.dir, childBox, nearFar) || nearFar.x >= ray.hitDist) continue;
+
+        const float weight = child.isLeaf() || depth >= ray.maxOctreeDepth
+            ? computeNarrowingWeight(ray, child, childBox, nearFar, narrowFactor)
+            : storeDensitiesWithNarrowing(ray, child.index, childBox, depth + 1, narrowFactor, scale, pAccumulators);
+        pAccumulators[nodeIndex * 8 + childIndex] += weight * scale;
+        subtreeWeight += weight;
+    }
+    return subtreeWeight;
+}
+
+float evalDirectionPdf(const OctreeRay& ray, uint32_t nodeIndex, const AABB& box, uint32_t depth)
+{
+    float pdf = 0.f;
+    for (uint32_t childIndex = 0; childIndex < 8; ++childIndex)
+    {
+        const DensityChild& child = ray.nodes[nodeIndex].childs[childIndex];
+        const AABB childBox = shrinkBox(box, childIndex);
+        float2 nearFar;
+        if (!intersectRayAABB(ray.origin, ray.dir, childBox, nearFar)) continue;
+
+        if (child.isLeaf() || depth >= ray.maxOctreeDepth)
+        {
+            const float densityTimesVolume = child.accumulator * ray.invGlobalAccumulator;
+            const float near3 = nearFar.x * nearFar.x * nearFar.x;
+            const float far3 = nearFar.y * nearFar.y * nearFar.y;
+            pdf += (far3 - near3) * densityTimesVolume / (3.f * childBox.volume());
+        }
+        else
+        {
+            pdf += evalDirectionPdf(ray, child.index, childBox, depth + 1);
+        }
+    }
+    return pdf;
+}
+
+DensityNode emptyNode(float accumulator)
+{
+    DensityNode node = {};
+    for (DensityChild& child : node.childs) child = {0, accumulator};
+    return node;
+}
+} // namespace
+
+/** State of a path, see ScatterRayData in FocalShared.slang.
+*/
+struct FocalGuidingCPU::PathContext
+{
+    RandomGenerator rng;
+    float3 radiance = float3(0.f);
+    bool terminated = false;
+    float3 thp = float3(1.f);
+    uint32_t pathLength = 0;
+    float3 origin = float3(0.f);
+    float3 direction = float3(0.f);
+
+    std::vector<float3> origins;        ///< Scratch space for the segment origins of training paths.
+    std::vector<float> contributions;   ///< Scratch space for the segment contributions of training paths.
+
+    PathContext(uint32_t maxBounces) : rng(uint2(0), 0, 0), origins(maxBounces + 2), contributions(maxBounces + 1) {}
+
+    void begin(const RandomGenerator& _rng)
+    {
+        rng = _rng;
+        radiance = float3(0.f);
+        terminated = false;
+        thp = float3(1.f);
+        pathLength = 0;
+    }
+};
+
+/** Shading data at a hit point. The normals are flipped to face the incoming ray, so all surfaces are two-sided.
+*/
+struct FocalGuidingCPU::ShadingPoint
+{
+    float3 posW;
+    float3 faceN;
+    float3 N;
+    float3 V;                           ///< Direction towards the origin of the incoming ray.
+    const MaterialParams* pMaterial;
+
+    float3 getDiffuse() const { return pMaterial->baseColor * (1.f - pMaterial->metallic); }
+    float3 getF0() const { return lerp(float3(kDielectricF0), pMaterial->baseColor, float3(pMaterial->metallic)); }
+    float getAlpha() const { return std::max(kMinGGXAlpha, pMaterial->roughness * pMaterial->roughness); }
+
+    float getDiffuseProb() const
+    {
+        const float diffuseWeight = luminance(getDiffuse());
+        const float specularWeight = luminance(getF0());
+        return diffuseWeight + specularWeight > 0.f ? diffuseWeight / (diffuseWeight + specularWeight) : 1.f;
+    }
+
+    /** Evaluate the BSDF times the cosine term.
+    */
+    float3 eval(const float3& L) const
+    {
+        const float NdotV = dot(N, V);
+        const float NdotL = dot(N, L);
+        if (NdotV < kMinCosTheta || NdotL < kMinCosTheta || dot(faceN, L) <= 0.f) return float3(0.f);
+
+        const float3 H = normalize(V + L);
+        const float NdotH = std::max(0.f, dot(N, H));
+        const float VdotH = std::max(0.f, dot(V, H));
+        const float alpha = getAlpha();
+        const float3 F0 = getF0();
+        const float3 F = F0 + (float3(1.f) - F0) * std::pow(1.f - VdotH, 5.f);
+        const float D = evalNdfGGX(alpha, NdotH);
+        const float G = evalG1GGX(alpha, NdotV) * evalG1GGX(alpha, NdotL);
+
+        return getDiffuse() * (NdotL * float(M_1_PI)) + F * (D * G / (4.f * NdotV));
+    }
+
+    float evalPdf(const float3& L) const
+    {
+        const float NdotL = dot(N, L);
+        if (dot(N, V) < kMinCosTheta || NdotL < kMinCosTheta) return 0.f;
+
+        const float3 H = normalize(V + L);
+        const float VdotH = dot(V, H);
+        const float pDiffuse = getDiffuseProb();
+        const float diffusePdf = NdotL * float(M_1_PI);
+        const float specularPdf = VdotH > 0.f ? evalNdfGGX(getAlpha(), std::max(0.f, dot(N, H))) * dot(N, H) / (4.f * VdotH) : 0.f;
+        return pDiffuse * diffusePdf + (1.f - pDiffuse) * specularPdf;
+    }
+
+    /** Sample a direction from the diffuse or the GGX lobe.
+    */
+    bool sample(RandomGenerator& rng, float3& L, float& pdf) const
+    {
+        float3 T, B;
+        buildFrame(N, T, B);
+        const float u0 = rng.next1D();
+        const float u1 = rng.next1D();
+        const float u2 = rng.next1D();
+        const float phi = 2.f * float(M_PI) * u2;
+
+        if (u0 < getDiffuseProb())
+        {
+            // Cosine-weighted hemisphere sampling.
+            const float r = std::sqrt(u1);
+            L = T * (r * std::cos(phi)) + B * (r * std::sin(phi)) + N * std::sqrt(std::max(0.f, 1.f - u1));
+        }
+        else
+        {
+            // GGX normal distribution sampling.
+            const float a2 = getAlpha() * getAlpha();
+            const float cosTheta = std::sqrt((1.f - u1) / (1.f + (a2 - 1.f) * u1));
+            const float sinTheta = std::sqrt(std::max(0.f, 1.f - cosTheta * cosTheta));
+            const float3 H = T * (sinTheta * std::cos(phi)) + B * (sinTheta * std::sin(phi)) + N * cosTheta;
+            L = 2.f * dot(V, H) * H - V;
+        }
+
+        pdf = evalPdf(L);
+        return pdf > 0.f;
+    }
+};
+
+FocalGuidingCPU::FocalGuidingCPU(const Scene::SceneData& sceneData, const Options& options)
+    : FocalGuidingCPU(sceneData, sceneData.pMaterials ? getMaterialParams(sceneData.pMaterials->getMaterials()) : std::vector<MaterialParams>(), options)
+{}
+
+FocalGuidingCPU::FocalGuidingCPU(const Scene::SceneData& sceneData, std::vector<MaterialParams> materials, const Options& options)
+    : mOptions(options)
+    , mBVH(sceneData)
+    , mMaterials(std::move(materials))
+{
+    FALCOR_CHECK(mOptions.initOctreeDepth >= 1, "Initial octree depth must be at least 1.");
+    FALCOR_CHECK(mOptions.maxOctreeDepth >= 1, "Max octree depth must be at least 1.");
+    FALCOR_CHECK(mOptions.narrowEachNthPass >= 1, "Narrow each Nth pass must be at least 1.");
+    FALCOR_CHECK(mOptions.tileSize >= 1, "Tile size must be at least 1.");
+    FALCOR_CHECK(!sceneData.cameras.empty(), "Scene has no camera.");
+
+    mpCamera = sceneData.cameras[std::min<size_t>(sceneData.selectedCamera, sceneData.cameras.size() - 1)];
+    mSceneBounds = mBVH.getBounds();
+
+    // Copy the mesh data needed for shading. The BVH validates the mesh data.
+    mMeshes = sceneData.meshDesc;
+    mIndexData = sceneData.meshIndexData;
+    mVertexData = sceneData.meshStaticData;
+
+    const std::vector<float4x4> globalMatrices = Scene::computeGlobalMatrices(sceneData.sceneGraph);
+    mInstances.reserve(sceneData.meshInstanceData.size());
+    for (const GeometryInstanceData& instanceData : sceneData.meshInstanceData)
+    {
+        Instance instance;
+        instance.transform = instanceData.globalMatrixID < globalMatrices.size() ? globalMatrices[instanceData.globalMatrixID] : float4x4::identity();
+        instance.normalTransform = inverse(transpose(instance.transform));
+        instance.materialID = instanceData.materialID;
+        instance.vbOffset = instanceData.vbOffset;
+        instance.ibOffset = instanceData.ibOffset;
+        instance.meshID = instanceData.geometryID;
+        instance.use16BitIndices = (instanceData.flags & (uint32_t)GeometryInstanceFlags::Use16BitIndices) != 0;
+        mInstances.push_back(instance);
+    }
+
+    for (const ref<Light>& pLight : sceneData.lights)
+    {
+        LightData light = pLight->getData();
+        if (light.type == (uint32_t)LightType::Distant)
+        {
+            // Distant lights are approximated by directional lights, ignoring the subtended angle.
+            light.type = (uint32_t)LightType::Directional;
+        }
+        if (light.type == (uint32_t)LightType::Point || light.type == (uint32_t)LightType::Directional)
+            mLights.push_back(light);
+        else
+            logWarning("FocalGuidingCPU: Analytic area light '{}' is not supported and is ignored.", pLight->getName());
+    }
+
+    if (sceneData.pEnvMap) logWarning("FocalGuidingCPU: Environment maps are not supported and are ignored.");
+
+    if (mOptions.threadCount != 1)
+        mpThreadPool = std::make_unique<BS::thread_pool>(mOptions.threadCount);
+
+    reset();
+}
+
+std::vector<FocalGuidingCPU::MaterialParams> FocalGuidingCPU::getMaterialParams(const std::vector<ref<Material>>& materials)
+{
+    std::vector<MaterialParams> materialParams;
+    materialParams.reserve(materials.size());
+    for (const ref<Material>& pMaterial : materials)
+    {
+        MaterialParams params;
+        if (auto pStandardMaterial = dynamic_ref_cast<StandardMaterial>(pMaterial))
+        {
+            params.baseColor = pStandardMaterial->getBaseColor3();
+            if (pStandardMaterial->getShadingModel() == ShadingModel::MetalRough)
+            {
+                params.roughness = pStandardMaterial->getRoughness();
+                params.metallic = pStandardMaterial->getMetallic();
+            }
+            else
+            {
+                // Approximate the specular-glossiness model by a dielectric with the same glossiness.
+                params.roughness = 1.f - pStandardMaterial->getSpecularParams().w;
+            }
+            params.emission = pStandardMaterial->getEmissiveColor() * pStandardMaterial->getEmissiveFactor();
+            params.hasTransmission = pStandardMaterial->getSpecularTransmission() > 0.f || pStandardMaterial->getDiffuseTransmission() > 0.f;
+
+            for (uint32_t slot = 0; slot < (uint32_t)Material::TextureSlot::Count; ++slot)
+                params.hasTextures |= pStandardMaterial->getTexture((Material::TextureSlot)slot) != nullptr;
+            if (params.hasTextures)
+                logWarning("FocalGuidingCPU: Material '{}' has textures, which are ignored. Using its constant parameters.", pMaterial->getName());
+        }
+        else
+        {
+            logWarning("FocalGuidingCPU: Material '{}' is not a StandardMaterial. Using default parameters.", pMaterial->getName());
+        }
+        materialParams.push_back(params);
+    }
+    return materialParams;
+}
+
+Scene::SceneData FocalGuidingCPU::createSceneData(Scene& scene)
+{
+    Scene::SceneData sceneData;
+    sceneData.path = scene.getPath();
+    sceneData.cameras.push_back(scene.getCamera());
+    sceneData.lights = scene.getLights();
+    sceneData.pEnvMap = scene.getEnvMap();
+
+    // Flatten the scene graph, each node holds the current global matrix.
+    for (const float4x4& globalMatrix : scene.getAnimationController()->getGlobalMatrices())
+        sceneData.sceneGraph.emplace_back("", NodeID::Invalid(), globalMatrix, float4x4::identity(), float4x4::identity());
+
+    for (uint32_t meshID = 0; meshID < scene.getMeshCount(); ++meshID)
+        sceneData.meshDesc.push_back(scene.getMesh(MeshID(meshID)));
+
+    for (uint32_t instanceID = 0; instanceID < scene.getGeometryInstanceCount(); ++instanceID)
+    {
+        const GeometryInstanceData& instance = scene.getGeometryInstance(instanceID);
+        if (instance.getType() == GeometryType::TriangleMesh || instance.getType() == GeometryType::DisplacedTriangleMesh)
+            sceneData.meshInstanceData.push_back(instance);
+    }
+
+    // Both mesh VAOs share the vertex and index buffers, see Scene::createMeshVao().
+    const ref<Vao>& pVao = scene.getMeshVao() ? scene.getMeshVao() : scene.getMeshVao16();
+    if (pVao)
+    {
+        if (pVao->getIndexBuffer()) sceneData.meshIndexData = pVao->getIndexBuffer()->getElements<uint32_t>();
+        sceneData.meshStaticData = pVao->getVertexBuffer(Scene::kStaticDataBufferIndex)->getElements<PackedStaticVertexData>();
+    }
+
+    return sceneData;
+}
+
+void FocalGuidingCPU::reset()
+{
+    mNodes = genUniformNodes(mOptions.initOctreeDepth);
+    FALCOR_CHECK(mNodes.size() <= mOptions.maxNodesSize, "Initial octree has {} nodes, which exceeds the max nodes size of {}.", mNodes.size(), mOptions.maxNodesSize);
+    mGlobalAccumulator = 1.f;
+    mPassCount = 0;
+}
+
+bool FocalGuidingCPU::trainPass(uint2 frameDim)
+{
+    FALCOR_CHECK(frameDim.x > 0 && frameDim.y > 0, "Invalid frame dimensions.");
+    if (mPassCount >= mOptions.maxPassCount) return false;
+
+    const bool useNarrowing = mOptions.useNarrowing && mOptions.narrowFromPass <= mPassCount && mPassCount % mOptions.narrowEachNthPass == 0;
+    const CameraData& camera = mpCamera->getData();
+
+    // Distribute the tiles over batches, each accumulating densities into its own buffer.
+    // The last entry of each buffer holds the global accumulator.
+    const uint2 tileCount = (frameDim + (mOptions.tileSize - 1)) / mOptions.tileSize;
+    const uint32_t totalTileCount = tileCount.x * tileCount.y;
+    const uint32_t batchCount = std::min(totalTileCount, kMaxTrainingBatchCount);
+    const size_t accumulatorCount = mNodes.size() * 8 + 1;
+    std::vector<float> accumulators(batchCount * accumulatorCount, 0.f);
+
+    parallelFor(
+        mpThreadPool.get(),
+        batchCount,
+        [&](uint32_t batchBegin, uint32_t batchEnd)
+        {
+            PathContext ctx(mOptions.maxBounces);
+            for (uint32_t batchIndex = batchBegin; batchIndex < batchEnd; ++batchIndex)
+            {
+                float* pAccumulators = accumulators.data() + batchIndex * accumulatorCount;
+                const uint32_t tileBegin = uint32_t((uint64_t)totalTileCount * batchIndex / batchCount);
+                const uint32_t tileEnd = uint32_t((uint64_t)totalTileCount * (batchIndex + 1) / batchCount);
+                for (uint32_t tileIndex = tileBegin; tileIndex < tileEnd; ++tileIndex)
+                {
+                    const uint2 tileOrigin = uint2(tileIndex % tileCount.x, tileIndex / tileCount.x) * mOptions.tileSize;
+                    const uint2 tileEndPixel = min(tileOrigin + mOptions.tileSize, frameDim);
+                    for (uint32_t y = tileOrigin.y; y < tileEndPixel.y; ++y)
+                    {
+                        for (uint32_t x = tileOrigin.x; x < tileEndPixel.x; ++x)
+                        {
+                            ctx.begin(RandomGenerator(uint2(x, y), mPassCount, 0));
+                            trainPath(camera, uint2(x, y), frameDim, useNarrowing, ctx, pAccumulators);
+                        }
+                    }
+                }
+            }
+        }
+    );
+
+    // Decay the previous densities and add the new ones, reducing the batches in order.
+    parallelFor(
+        mpThreadPool.get(),
+        (uint32_t)mNodes.size(),
+        [&](uint32_t nodeBegin, uint32_t nodeEnd)
+        {
+            for (uint32_t nodeIndex = nodeBegin; nodeIndex < nodeEnd; ++nodeIndex)
+            {
+                for (uint32_t childIndex = 0; childIndex < 8; ++childIndex)
+                {
+                    float accumulator = mNodes[nodeIndex].childs[childIndex].accumulator * mOptions.decay;
+                    for (uint32_t batchIndex = 0; batchIndex < batchCount; ++batchIndex)
+                        accumulator += accumulators[batchIndex * accumulatorCount + nodeIndex * 8 + childIndex];
+                    mNodes[nodeIndex].childs[childIndex].accumulator = accumulator;
+                }
+            }
+        },
+        kMinNodeBlockSize
+    );
+    mGlobalAccumulator *= mOptions.decay;
+    for (uint32_t batchIndex = 0; batchIndex < batchCount; ++batchIndex)
+        mGlobalAccumulator += accumulators[batchIndex * accumulatorCount + accumulatorCount - 1];
+
+    // Split and prune on the schedule of NodeSplitting and NodePruning, which see the index of the pass that just ran.
+    if (mOptions.useSplitting && mPassCount >= mOptions.narrowFromPass && mPassCount % mOptions.narrowEachNthPass == 0)
+        splitNodes();
+    if (mOptions.usePruning && mPassCount + 1 == mOptions.maxPassCount)
+        pruneNodes();
+
+    mPassCount++;
+    return true;
+}
+
+void FocalGuidingCPU::train(uint2 frameDim)
+{
+    while (trainPass(frameDim)) {}
+}
+
+std::vector<float4> FocalGuidingCPU::render(uint2 frameDim, uint32_t sampleCount, uint32_t frameIndex) const
+{
+    FALCOR_CHECK(frameDim.x > 0 && frameDim.y > 0, "Invalid frame dimensions.");
+    FALCOR_CHECK(sampleCount > 0, "Sample count must be at least 1.");
+
+    const CameraData& camera = mpCamera->getData();
+    std::vector<float4> image((size_t)frameDim.x * frameDim.y);
+
+    const uint2 tileCount = (frameDim + (mOptions.tileSize - 1)) / mOptions.tileSize;
+    parallelFor(
+        mpThreadPool.get(),
+        tileCount.x * tileCount.y,
+        [&](uint32_t tileBegin, uint32_t tileEnd)
+        {
+            PathContext ctx(mOptions.maxBounces);
+            for (uint32_t tileIndex = tileBegin; tileIndex < tileEnd; ++tileIndex)
+            {
+                const uint2 tileOrigin = uint2(tileIndex % tileCount.x, tileIndex / tileCount.x) * mOptions.tileSize;
+                const uint2 tileEndPixel = min(tileOrigin + mOptions.tileSize, frameDim);
+                for (uint32_t y = tileOrigin.y; y < tileEndPixel.y; ++y)
+                {
+                    for (uint32_t x = tileOrigin.x; x < tileEndPixel.x; ++x)
+                    {
+                        float3 color = float3(0.f);
+                        for (uint32_t sampleIndex = 0; sampleIndex < sampleCount; ++sampleIndex)
+                        {
+                            ctx.begin(RandomGenerator(uint2(x, y), frameIndex * sampleCount + sampleIndex, 1));
+                            color += renderPath(camera, uint2(x, y), frameDim, ctx);
+                        }
+                        image[(size_t)y * frameDim.x + x] = float4(color / float(sampleCount), 1.f);
+                    }
+                }
+            }
+        }
+    );
+
+    return image;
+}
+
+std::vector<DensityNode> FocalGuidingCPU::genUniformNodes(uint32_t depth)
+{
+    FALCOR_CHECK(depth >= 1, "Octree depth must be at least 1.");
+
+    std::vector<DensityNode> nodes;
+    uint32_t levelBegin = 0;
+    uint32_t levelCount = 1;
+    nodes.push_back(emptyNode(1.f / 8.f));
+    for (uint32_t d = 0; d < depth - 1; ++d)
+    {
+        for (uint32_t i = levelBegin; i < levelBegin + levelCount; ++i)
+        {
+            for (uint32_t childIndex = 0; childIndex < 8; ++childIndex)
+            {
+                nodes[i].childs[childIndex].index = (uint32_t)nodes.size();
+                DensityNode node = emptyNode(1.f / ((float)levelCount * 64.f));
+                node.parentIndex = i;
+                node.parentOffsetAndDepth = childIndex | ((d + 1) << PARENT_OFFSET_BIT_COUNT);
+                nodes.push_back(node);
+            }
+        }
+        levelBegin += levelCount;
+        levelCount *= 8;
+    }
+    return nodes;
+}
+
+Ray FocalGuidingCPU::computePrimaryRay(const CameraData& camera, uint2 pixel, uint2 frameDim) const
+{
+    // Pinhole camera without jitter, see Camera::computeRayPinhole().
+    const float2 p = (float2(pixel) + float2(0.5f)) / float2(frameDim);
+    const float2 ndc = float2(2.f, -2.f) * p + float2(-1.f, 1.f);
+    const float3 dir = normalize(ndc.x * camera.cameraU + ndc.y * camera.cameraV + camera.cameraW);
+    const float invCos = 1.f / dot(normalize(camera.cameraW), dir);
+    return Ray(camera.posW, dir, camera.nearZ * invCos, camera.farZ * invCos);
+}
+
+bool FocalGuidingCPU::loadShadingPoint(const Ray& ray, const CPUBVH::Hit& hit, ShadingPoint& sp) const
+{
+    const Instance& instance = mInstances[hit.instanceID];
+    const MeshDesc& mesh = mMeshes[instance.meshID];
+    const uint32_t* pIndices32 = mIndexData.data() + instance.ibOffset;
+    const uint16_t* pIndices16 = reinterpret_cast<const uint16_t*>(pIndices32);
+
+    const float3 barycentrics = float3(1.f - hit.barycentrics.x - hit.barycentrics.y, hit.barycentrics.x, hit.barycentrics.y);
+    float3 p[3];
+    float3 normal = float3(0.f);
+    for (uint32_t j = 0; j < 3; ++j)
+    {
+        const uint32_t vertexIndex = hit.primitiveIndex * 3 + j;
+        const uint32_t localIndex = !mesh.useVertexIndices() ? vertexIndex : (instance.use16BitIndices ? pIndices16[vertexIndex] : pIndices32[vertexIndex]);
+        const StaticVertexData vertex = mVertexData[instance.vbOffset + localIndex].unpack();
+        p[j] = transformPoint(instance.transform, vertex.position);
+        normal += vertex.normal * barycentrics[j];
+    }
+
+    const float3 faceN = cross(p[1] - p[0], p[2] - p[0]);
+    if (dot(faceN, faceN) == 0.f) return false;
+
+    sp.posW = p[0] * barycentrics.x + p[1] * barycentrics.y + p[2] * barycentrics.z;
+    sp.V = -ray.dir;
+    sp.faceN = normalize(faceN);
+    if (dot(sp.faceN, sp.V) < 0.f) sp.faceN = -sp.faceN;
+    normal = transformVector(instance.normalTransform, normal);
+    sp.N = dot(normal, normal) > 0.f ? normalize(normal) : sp.faceN;
+    if (dot(sp.N, sp.faceN) < 0.f) sp.N = -sp.N;
+
+    static const MaterialParams kDefaultMaterial;
+    sp.pMaterial = instance.materialID < mMaterials.size() ? &mMaterials[instance.materialID] : &kDefaultMaterial;
+    return true;
+}
+
+float3 FocalGuidingCPU::evalDirectAnalytic(const ShadingPoint& sp, PathContext& ctx) const
+{
+    const uint32_t lightCount = (uint32_t)mLights.size();
+    if (lightCount == 0) return float3(0.f);
+
+    // Pick one of the analytic light sources randomly with equal probability.
+    const uint32_t lightIndex = std::min(uint32_t(ctx.rng.next1D() * lightCount), lightCount - 1);
+    const float invPdf = (float)lightCount;
+    const LightData& light = mLights[lightIndex];
+
+    float3 dir;
+    float distance;
+    float3 Li;
+    if (light.type == (uint32_t)LightType::Point)
+    {
+        const float3 toLight = light.posW - sp.posW;
+        const float distSqr = std::max(dot(toLight, toLight), kMinLightDistSqr);
+        distance = std::sqrt(distSqr);
+        dir = toLight / distance;
+
+        // Spot light falloff, see samplePointLight().
+        const float cosTheta = -dot(dir, light.dirW);
+        float falloff = 1.f;
+        if (cosTheta < light.cosOpeningAngle)
+            falloff = 0.f;
+        else if (light.penumbraAngle > 0.f)
+            falloff = math::smoothstep(0.f, light.penumbraAngle, light.openingAngle - std::acos(cosTheta));
+        Li = light.intensity * falloff / distSqr;
+    }
+    else
+    {
+        distance = std::numeric_limits<float>::max();
+        dir = -light.dirW;
+        Li = light.intensity;
+    }
+
+    if (dot(sp.faceN, dir) <= kMinCosTheta || all(Li == float3(0.f))) return float3(0.f);
+
+    const float3 origin = computeRayOrigin(sp.posW, sp.faceN);
+    if (mBVH.anyHit(Ray(origin, dir, 0.f, distance))) return float3(0.f);
+
+    return sp.eval(dir) * Li * invPdf;
+}
+
+float3 FocalGuidingCPU::samplePointByDensities(PathContext& ctx) const
+{
+    AABB box = mSceneBounds;
+    uint32_t nodeIndex = 0;
+    float parentAccumulator = mGlobalAccumulator;
+
+    for (uint32_t depth = 0; depth < mOptions.maxOctreeDepth; ++depth)
+    {
+        // Select a child proportionally to the accumulators.
+        const float r = ctx.rng.next1D();
+        const float stop = r * parentAccumulator;
+        float accumulator = 0.f;
+        uint32_t childIndex = 0;
+        for (; childIndex < 8; ++childIndex)
+        {
+            accumulator += mNodes[nodeIndex].childs[childIndex].accumulator;
+            if (stop < accumulator) break;
+        }
+        if (childIndex >= 8) childIndex = std::min(uint32_t(r * 8.f), 7u);
+
+        const DensityChild& child = mNodes[nodeIndex].childs[childIndex];
+        box = shrinkBox(box, childIndex);
+        if (child.isLeaf()) break;
+        nodeIndex = child.index;
+        parentAccumulator = child.accumulator;
+    }
+
+    const float3 u = float3(ctx.rng.next1D(), ctx.rng.next1D(), ctx.rng.next1D());
+    return box.minPoint + u * box.extent();
+}
+
+float FocalGuidingCPU::getDirectionPdf(const float3& origin, const float3& dir) const
+{
+    const OctreeRay ray = {mNodes, mOptions.maxOctreeDepth, origin, dir, 0.f, 1.f / mGlobalAccumulator};
+    return evalDirectionPdf(ray, 0, mSceneBounds, 1);
+}
+
+bool FocalGuidingCPU::generateRay(const ShadingPoint& sp, PathContext& ctx) const
+{
+    // Guided rays are only used on rough, opaque materials, see FocalShared::enableGuidedRaysForMaterial().
+    const bool enableGuidedRays = sp.pMaterial->roughness > kGuidedRaysMinRoughness && !sp.pMaterial->hasTransmission;
+    const float3 rayOrigin = computeRayOrigin(sp.posW, sp.faceN);
+
+    float3 dir;
+    if (enableGuidedRays && ctx.rng.next1D() < mOptions.guidedRayProb)
+    {
+        dir = normalize(samplePointByDensities(ctx) - rayOrigin);
+        ctx.origin = computeRayOrigin(sp.posW, dot(sp.faceN, dir) >= 0.f ? sp.faceN : -sp.faceN);
+    }
+    else
+    {
+        float bsdfPdf;
+        if (!sp.sample(ctx.rng, dir, bsdfPdf)) return false;
+        ctx.origin = rayOrigin;
+        if (!enableGuidedRays)
+        {
+            ctx.direction = dir;
+            ctx.thp *= sp.eval(dir) / bsdfPdf;
+            return any(ctx.thp > 0.f);
+        }
+    }
+
+    // Weigh by the MIS pdf of guided and BSDF sampling, see FocalShared::getMisPdf().
+    const float pdf = mOptions.guidedRayProb * getDirectionPdf(ctx.origin, dir) + (1.f - mOptions.guidedRayProb) * sp.evalPdf(dir);
+    if (!(pdf > 0.f)) return false;
+    ctx.direction = dir;
+    ctx.thp *= sp.eval(dir) / pdf;
+    return true;
+}
+
+void FocalGuidingCPU::traceScatterRay(PathContext& ctx, bool computeDirect, bool stopOnEmissive) const
+{
+    const Ray ray(ctx.origin, ctx.direction);
+    const CPUBVH::Hit hit = mBVH.closestHit(ray);
+    ShadingPoint sp;
+    if (!hit.isValid() || !loadShadingPoint(ray, hit, sp))
+    {
+        ctx.terminated = true;
+        return;
+    }
+
+    // Process the hit, see FocalShared::handleHit().
+    const float3 rayOrigin = computeRayOrigin(sp.posW, sp.faceN);
+    if (mOptions.useEmissiveLights && (computeDirect || ctx.pathLength > 0))
+    {
+        const float3 emission = sp.pMaterial->emission;
+        ctx.radiance += ctx.thp * emission;
+        if (stopOnEmissive && dot(emission, float3(1.f)) > 0.001f)
+        {
+            ctx.terminated = true;
+            ctx.origin = rayOrigin;
+            return;
+        }
+    }
+
+    if (ctx.pathLength >= mOptions.maxBounces)
+    {
+        ctx.terminated = true;
+        ctx.origin = rayOrigin;
+        return;
+    }
+
+    if (mOptions.useAnalyticLights) ctx.radiance += ctx.thp * evalDirectAnalytic(sp, ctx);
+
+    if (!generateRay(sp, ctx))
+    {
+        ctx.terminated = true;
+        ctx.origin = rayOrigin;
+        return;
+    }
+
+    ctx.pathLength++;
+}
+
+void FocalGuidingCPU::trainPath(const CameraData& camera, uint2 pixel, uint2 frameDim, bool useNarrowing, PathContext& ctx, float* pAccumulators) const
+{
+    // See tracePath() in FocalDensities.rt.slang.
+    const Ray primaryRay = computePrimaryRay(camera, pixel, frameDim);
+    const CPUBVH::Hit hit = mBVH.closestHit(primaryRay);
+    ShadingPoint sp;
+    if (!hit.isValid() || !loadShadingPoint(primaryRay, hit, sp)) return;
+
+    if (!generateRay(sp, ctx)) return;
+
+    float maxContribution = 0.f;
+    uint32_t depthCount = 0;
+    for (; depthCount <= mOptions.maxBounces && !ctx.terminated; depthCount++)
+    {
+        ctx.origins[depthCount] = ctx.origin;
+        traceScatterRay(ctx, true, true);
+        ctx.contributions[depthCount] = dot(kIntensityFactor, ctx.radiance);
+        maxContribution = std::max(maxContribution, ctx.contributions[depthCount]);
+    }
+    ctx.origins[depthCount] = ctx.origin;
+
+    if (mOptions.useRelativeContributions)
+    {
+        // Each segment receives the radiance gathered from its end onwards.
+        for (uint32_t depth = depthCount - 1; depth > 0; depth--) ctx.contributions[depth] -= ctx.contributions[depth - 1];
+        for (uint32_t depth = depthCount - 1; depth > 0; depth--) ctx.contributions[depth - 1] += ctx.contributions[depth];
+    }
+
+    for (uint32_t depth = 0; depth < depthCount; depth++)
+    {
+        if (!mOptions.integrateLastHits && depth == depthCount - 1) continue;
+        const float contribution = mOptions.useRelativeContributions ? ctx.contributions[depth] : maxContribution;
+        storeDensities(ctx.origins[depth], ctx.origins[depth + 1], contribution, useNarrowing, pAccumulators);
+    }
+}
+
+float3 FocalGuidingCPU::renderPath(const CameraData& camera, uint2 pixel, uint2 frameDim, PathContext& ctx) const
+{
+    // See tracePath() in FocalGuiding.rt.slang.
+    const Ray primaryRay = computePrimaryRay(camera, pixel, frameDim);
+    const CPUBVH::Hit hit = mBVH.closestHit(primaryRay);
+    ShadingPoint sp;
+    if (!hit.isValid() || !loadShadingPoint(primaryRay, hit, sp)) return float3(0.f);
+
+    float3 color = float3(0.f);
+    if (mOptions.computeDirect)
+    {
+        color += sp.pMaterial->emission;
+        if (mOptions.useAnalyticLights) color += evalDirectAnalytic(sp, ctx);
+    }
+
+    if (!generateRay(sp, ctx)) ctx.terminated = true;
+    for (uint32_t depth = 0; depth <= mOptions.maxBounces && !ctx.terminated; depth++)
+    {
+        traceScatterRay(ctx, mOptions.computeDirect, false);
+    }
+
+    return color + ctx.radiance;
+}
+
+void FocalGuidingCPU::storeDensities(const float3& origin, const float3& hitPos, float contribution, bool useNarrowing, float* pAccumulators) const
+{
+    // See storeDensitiesNoNarrowing() and storeDensitiesWithNarrowing() in FocalDensities.rt.slang.
+    const float hitDist = length(hitPos - origin);
+    if (contribution <= 0.f || hitDist <= 0.f) return;
+
+    const OctreeRay ray = {mNodes, mOptions.maxOctreeDepth, origin, (hitPos - origin) / hitDist, hitDist, 1.f / mGlobalAccumulator};
+    float2 nearFar;
+    const bool hitsScene = intersectRayAABB(ray.origin, ray.dir, mSceneBounds, nearFar) && nearFar.x < hitDist;
+
+    float* pGlobalAccumulator = pAccumulators + mNodes.size() * 8;
+    if (!useNarrowing)
+    {
+        if (hitsScene) *pGlobalAccumulator += (std::min(hitDist, nearFar.y) - nearFar.x) * contribution;
+        storeDensitiesNoNarrowing(ray, 0, mSceneBounds, 1, contribution, pAccumulators);
+    }
+    else
+    {
+        const float weightsSum = sumNarrowingWeights(ray, 0, mSceneBounds, 1, mOptions.narrowFactor);
+        if (!(weightsSum > 0.f)) return;
+        if (hitsScene) *pGlobalAccumulator += contribution;
+        storeDensitiesWithNarrowing(ray, 0, mSceneBounds, 1, mOptions.narrowFactor, contribution / weightsSum, pAccumulators);
+    }
+}
+
+void FocalGuidingCPU::splitNodes()
+{
+    // See NodeSplitting.slang. Nodes are split in order, so the result is deterministic.
+    // As on the GPU, the children of the root node are not split, and nodes created here are not split again.
+    const float invGlobalAccumulator = 1.f / mGlobalAccumulator;
+    const uint32_t nodesSize = (uint32_t)mNodes.size();
+    for (uint32_t nodeIndex = 1; nodeIndex < nodesSize; ++nodeIndex)
+    {
+        for (uint32_t childIndex = 0; childIndex < 8; ++childIndex)
+        {
+            const DensityChild child = mNodes[nodeIndex].childs[childIndex];
+            if (!child.isLeaf() || child.accumulator * invGlobalAccumulator <= mOptions.splittingThreshold) continue;
+
+            const uint32_t depth = (mNodes[nodeIndex].parentOffsetAndDepth >> PARENT_OFFSET_BIT_COUNT) + 1;
+            if (depth >= mOptions.maxOctreeDepth) continue;
+            if (mNodes.size() >= mOptions.maxNodesSize) return;
+
+            DensityNode node = emptyNode(child.accumulator / 8.f);
+            node.parentIndex = nodeIndex;
+            node.parentOffsetAndDepth = childIndex | (depth << PARENT_OFFSET_BIT_COUNT);
+            mNodes[nodeIndex].childs[childIndex].index = (uint32_t)mNodes.size();
+            mNodes.push_back(node);
+        }
+    }
+}
+
+void FocalGuidingCPU::pruneNodes()
+{
+    // See NodePruning.slang. Nodes are processed bottom-up, collapsing nodes whose children have a uniform density.
+    // Collapsed nodes are unlinked from their parent but stay allocated.
+    const float invGlobalAccumulator = 1.f / mGlobalAccumulator;
+    const uint32_t nodesSize = (uint32_t)mNodes.size();
+    std::vector<float> maxDensities(nodesSize, 0.f);
+    std::vector<float> avgDensities(nodesSize, 0.f);
+
+    for (uint32_t depth = mOptions.maxOctreeDepth; depth > 0; depth--)
+    {
+        const float invVolume = std::pow(8.f, float(depth + 1));
+        // The root node has no parent to collapse it into.
+        for (uint32_t nodeIndex = 1; nodeIndex < nodesSize; ++nodeIndex)
+        {
+            DensityNode& node = mNodes[nodeIndex];
+            if ((node.parentOffsetAndDepth >> PARENT_OFFSET_BIT_COUNT) + 1 != depth) continue;
+
+            float maxDensity = 0.f;
+            float avgDensity = 0.f;
+            for (const DensityChild& child : node.childs)
+            {
+                const float childMaxDensity = child.isLeaf() ? child.accumulator * invGlobalAccumulator * invVolume : maxDensities[child.index];
+                const float childAvgDensity = child.isLeaf() ? childMaxDensity : avgDensities[child.index];
+                maxDensity = std::max(maxDensity, childMaxDensity);
+                avgDensity += childAvgDensity;
+            }
+            avgDensity *= 1.f / 8.f;
+
+            if (maxDensity <= mOptions.pruneFactor * avgDensity)
+            {
+                mNodes[node.parentIndex].childs[node.parentOffsetAndDepth & PARENT_OFFSET_BITS].index = 0;
+            }
+            else
+            {
+                maxDensities[nodeIndex] = maxDensity;
+                avgDensities[nodeIndex] = avgDensity;
+            }
+        }
+    }
+}
+
+void FocalGuidingCPU::registerBindings(pybind11::module& m)
+{
+    using namespace pybind11::literals;
+
+    pybind11::class_<FocalGuidingCPU> focalGuidingCPU(m, "FocalGuidingCPU");
+    focalGuidingCPU.def(
+        pybind11::init(
+            [](const ref<Scene>& pScene, const pybind11::dict& options)
+            {
+                FALCOR_CHECK(pScene, "'scene' must not be None.");
+                return std::make_unique<FocalGuidingCPU>(
+                    createSceneData(*pScene), getMaterialParams(pScene->getMaterials()), deserializeFromProperties<Options>(Properties(options))
+                );
+            }
+        ),
+        "scene"_a,
+        "options"_a = pybind11::dict()
+    );
+    focalGuidingCPU.def("reset", &FocalGuidingCPU::reset);
+    focalGuidingCPU.def("train_pass", &FocalGuidingCPU::trainPass, "frame_dim"_a);
+    focalGuidingCPU.def("train", &FocalGuidingCPU::train, "frame_dim"_a);
+    focalGuidingCPU.def(
+        "render",
+        [](const FocalGuidingCPU& self, uint2 frameDim, uint32_t sampleCount, uint32_t frameIndex)
+        {
+            // Return the image as a numpy array of shape (height, width, 4).
+            auto pImage = new std::vector<float4>(self.render(frameDim, sampleCount, frameIndex));
+            pybind11::capsule owner(pImage, [](void* p) noexcept { delete reinterpret_cast<std::vector<float4>*>(p); });
+            pybind11::size_t shape[3] = {frameDim.y, frameDim.x, 4};
+            return pybind11::ndarray<pybind11::numpy>(
+                pImage->data(), 3, shape, owner, nullptr, pybind11::dtype<float>(), pybind11::device::cpu::value
+            );
+        },
+        "frame_dim"_a,
+        "sample_count"_a,
+        "frame_index"_a = 0
+    );
+    focalGuidingCPU.def(
+        "get_densities",
+        [](const FocalGuidingCPU& self)
+        {
+            // Return the child accumulators normalized by the global accumulator as a numpy array of shape (nodes, 8).
+            auto pDensities = new std::vector<float>();
+            pDensities->reserve(self.getNodesSize() * 8);
+            for (const DensityNode& node : self.getNodes())
+                for (const DensityChild& child : node.childs) pDensities->push_back(child.accumulator / self.getGlobalAccumulator());
+            pybind11::capsule owner(pDensities, [](void* p) noexcept { delete reinterpret_cast<std::vector<float>*>(p); });
+            pybind11::size_t shape[2] = {self.getNodesSize(), 8};
+            return pybind11::ndarray<pybind11::numpy>(
+                pDensities->data(), 2, shape, owner, nullptr, pybind11::dtype<float>(), pybind11::device::cpu::value
+            );
+        }
+    );
+    focalGuidingCPU.def_property_readonly("nodes_size", &FocalGuidingCPU::getNodesSize);
+    focalGuidingCPU.def_property_readonly("global_accumulator", &FocalGuidingCPU::getGlobalAccumulator);
+    focalGuidingCPU.def_property_readonly("pass_count", &FocalGuidingCPU::getPassCount);
+    focalGuidingCPU.def_property_readonly("options", [](const FocalGuidingCPU& self) { return serializeToProperties(self.getOptions()).toPython(); });
+}
@@ -0,0 +1,225 @@
+#pragma once
+#include "Falcor.h"
+#include "Scene/CPUBVH.h"
+#include "Utils/Scripting/ScriptBindings.h"
+
+#include "DensityNode.h"
+
+#include <BS_thread_pool.hpp>
+
+#include <memory>
+#include <vector>
+
+using namespace Falcor;
+
+/** CPU implementation of the FocalGuiding training and render loop.
+
+    This runs the same algorithm as the render graph FocalDensities -> NodeSplitting -> NodePruning -> FocalGuiding
+    without a GPU device, so that guiding quality can be regression-tested and octrees trained on CPU-only machines.
+    The density octree uses the DensityNode layout of the GPU passes, so nodes trained on the CPU can be uploaded
+    to the GPU passes and vice versa.
+
+    Rays are traced using CPUBVH over the triangle meshes of the scene. Materials are evaluated with a CPU port of the
+    diffuse and GGX lobes of StandardMaterial, using the constant material parameters (textures are ignored).
+    Point and directional lights are sampled explicitly, emissive triangles contribute when hit. The environment map
+    is not supported.
+
+    Both training and rendering run in parallel over image tiles. During training each batch of tiles accumulates
+    densities into its own buffer, which are reduced in a fixed order, so results do not depend on the thread count.
+
+    The backend only needs the host-side scene data. It is created either from a Scene::SceneData assembled without a
+    device, or from a loaded scene using createSceneData(), which is what the Python binding does.
+*/
+class FocalGuidingCPU
+{
+public:
+    struct Options
+    {
+        // Path tracing, see FocalGuiding.
+        uint32_t maxBounces = 3;                ///< Max number of indirect bounces.
+        float guidedRayProb = 0.5f;             ///< Probability of sampling a guided ray on materials that support it.
+        bool computeDirect = true;              ///< Compute direct illumination at the primary hit.
+        bool useAnalyticLights = true;          ///< Sample point and directional lights.
+        bool useEmissiveLights = true;          ///< Add emission of hit emissive triangles.
+
+        // Training, see FocalDensities.
+        uint32_t maxPassCount = 5;              ///< Number of training passes.
+        uint32_t initOctreeDepth = 3;           ///< Depth of the uniform octree the training starts from.
+        uint32_t maxOctreeDepth = 5;            ///< Maximum depth of the octree.
+        uint32_t maxNodesSize = 2000;           ///< Maximum number of octree nodes.
+        float decay = 0.5f;                     ///< Factor applied to the accumulated densities before each training pass.
+        bool useRelativeContributions = true;   ///< Weigh each path segment by the radiance gathered after it, instead of the radiance of the whole path.
+        bool useNarrowing = true;               ///< Distribute contributions along a segment proportionally to the current densities.
+        float narrowFactor = 1.f;               ///< Exponent applied to the densities when narrowing.
+        uint32_t narrowFromPass = 2;            ///< First training pass that uses narrowing.
+        uint32_t narrowEachNthPass = 1;         ///< Use narrowing only on every Nth pass.
+        bool integrateLastHits = true;          ///< Store densities along the last segment of each path.
+
+        // Splitting and pruning, see NodeSplitting and NodePruning.
+        bool useSplitting = true;               ///< Split leaves with a high density after training passes, on the schedule given by narrowFromPass and narrowEachNthPass.
+        float splittingThreshold = 0.001f;      ///< Minimum fraction of the total density for a leaf to be split.
+        bool usePruning = true;                 ///< Collapse nodes with a uniform density after the last training pass.
+        float pruneFactor = 2.f;                ///< Nodes whose max child density is below pruneFactor times the average child density are collapsed.
+
+        uint32_t tileSize = 16;                 ///< Size of the image tiles processed in parallel.
+        uint32_t threadCount = 0;               ///< Number of worker threads. 0 uses the hardware concurrency, 1 runs on the calling thread.
+
+        // Note: Empty constructor needed for clang due to the use of the nested struct constructor in the parent constructor.
+        Options() {}
+
+        template<typename Archive>
+        void serialize(Archive& ar)
+        {
+            ar("maxBounces", maxBounces);
+            ar("guidedRayProb", guidedRayProb);
+            ar("computeDirect", computeDirect);
+            ar("useAnalyticLights", useAnalyticLights);
+            ar("useEmissiveLights", useEmissiveLights);
+            ar("maxPassCount", maxPassCount);
+            ar("initOctreeDepth", initOctreeDepth);
+            ar("maxOctreeDepth", maxOctreeDepth);
+            ar("maxNodesSize", maxNodesSize);
+            ar("decay", decay);
+            ar("useRelativeContributions", useRelativeContributions);
+            ar("useNarrowing", useNarrowing);
+            ar("narrowFactor", narrowFactor);
+            ar("narrowFromPass", narrowFromPass);
+            ar("narrowEachNthPass", narrowEachNthPass);
+            ar("integrateLastHits", integrateLastHits);
+            ar("useSplitting", useSplitting);
+            ar("splittingThreshold", splittingThreshold);
+            ar("usePruning", usePruning);
+            ar("pruneFactor", pruneFactor);
+            ar("tileSize", tileSize);
+            ar("threadCount", threadCount);
+        }
+    };
+
+    /** Constant material parameters evaluated on the CPU.
+        Material textures are not sampled, textured materials are shaded with their constant parameters instead.
+    */
+    struct MaterialParams
+    {
+        float3 baseColor = float3(0.5f);
+        float roughness = 1.f;
+        float metallic = 0.f;
+        float3 emission = float3(0.f);
+        bool hasTransmission = false;   ///< Transmission is not evaluated, but disables guided rays as on the GPU.
+        bool hasTextures = false;       ///< The material has textures, which are ignored. Shading differs from the GPU passes.
+    };
+
+    /** Create the backend and build the BVH.
+        \param[in] sceneData Scene data holding the meshes, materials, lights and cameras.
+        The data is only accessed during construction, except for the camera.
+        \param[in] options Options.
+    */
+    FocalGuidingCPU(const Scene::SceneData& sceneData, const Options& options = Options());
+
+    /** Create the backend with explicit material parameters. This does not require a material system, so the
+        backend can be created without a device.
+        \param[in] sceneData Scene data holding the meshes, lights and cameras. The material system is ignored.
+        The data is only accessed during construction, except for the camera.
+        \param[in] materials Material parameters indexed by material ID. Missing entries use the default parameters.
+        \param[in] options Options.
+    */
+    FocalGuidingCPU(const Scene::SceneData& sceneData, std::vector<MaterialParams> materials, const Options& options = Options());
+
+    /** Extract the constant parameters of materials. Materials other than StandardMaterial use the default parameters.
+        Materials with textures are flagged with MaterialParams::hasTextures and a warning is logged.
+    */
+    static std::vector<MaterialParams> getMaterialParams(const std::vector<ref<Material>>& materials);
+
+    /** Create the scene data used by the backend from a loaded scene.
+        The vertex and index data are read back from the GPU, so this includes the current pose of animated meshes.
+        The scene graph is flattened into the current global matrices. Materials are not included, use
+        getMaterialParams() with the materials of the scene.
+        \param[in] scene Scene.
+        \return Scene data holding the triangle meshes, lights and the active camera.
+    */
+    static Scene::SceneData createSceneData(Scene& scene);
+
+    /** Reset the octree to the uniform octree of depth Options::initOctreeDepth.
+    */
+    void reset();
+
+    /** Run a single training pass followed by splitting and pruning, as scheduled by the options.
+        \param[in] frameDim Number of training paths in each dimension, one per pixel.
+        \return False if all training passes have already been executed, true otherwise.
+    */
+    bool trainPass(uint2 frameDim);
+
+    /** Run all remaining training passes.
+        \param[in] frameDim Number of training paths in each dimension, one per pixel.
+    */
+    void train(uint2 frameDim);
+
+    /** Render an image with guided path tracing using the current octree.
+        The aspect ratio of the camera should be set to match frameDim.
+        \param[in] frameDim Image dimensions.
+        \param[in] sampleCount Number of paths per pixel.
+        \param[in] frameIndex Frame index used to decorrelate the random numbers of several calls.
+        \return Image in row-major order, with alpha set to 1.
+    */
+    std::vector<float4> render(uint2 frameDim, uint32_t sampleCount, uint32_t frameIndex = 0) const;
+
+    const Options& getOptions() const { return mOptions; }
+    const std::vector<DensityNode>& getNodes() const { return mNodes; }
+    uint32_t getNodesSize() const { return (uint32_t)mNodes.size(); }
+    float getGlobalAccumulator() const { return mGlobalAccumulator; }
+    uint32_t getPassCount() const { return mPassCount; }
+    const CPUBVH& getBVH() const { return mBVH; }
+
+    /** Generate a uniform octree, matching FocalDensities.
+        \param[in] depth Depth of the octree, at least 1.
+        \return Nodes in breadth-first order.
+    */
+    static std::vector<DensityNode> genUniformNodes(uint32_t depth);
+
+    static void registerBindings(pybind11::module& m);
+
+private:
+    struct Instance
+    {
+        float4x4 transform;
+        float4x4 normalTransform;
+        uint32_t materialID;
+        uint32_t vbOffset;
+        uint32_t ibOffset;
+        uint32_t meshID;
+        bool use16BitIndices;
+    };
+
+    struct PathContext;
+    struct ShadingPoint;
+
+    Ray computePrimaryRay(const CameraData& camera, uint2 pixel, uint2 frameDim) const;
+    bool loadShadingPoint(const Ray& ray, const CPUBVH::Hit& hit, ShadingPoint& sp) const;
+    float3 evalDirectAnalytic(const ShadingPoint& sp, PathContext& ctx) const;
+    bool generateRay(const ShadingPoint& sp, PathContext& ctx) const;
+    void traceScatterRay(PathContext& ctx, bool computeDirect, bool stopOnEmissive) const;
+    void trainPath(const CameraData& camera, uint2 pixel, uint2 frameDim, bool useNarrowing, PathContext& ctx, float* pAccumulators) const;
+    float3 renderPath(const CameraData& camera, uint2 pixel, uint2 frameDim, PathContext& ctx) const;
+
+    float3 samplePointByDensities(PathContext& ctx) const;
+    float getDirectionPdf(const float3& origin, const float3& dir) const;
+    void storeDensities(const float3& origin, const float3& hitPos, float contribution, bool useNarrowing, float* pAccumulators) const;
+
+    void splitNodes();
+    void pruneNodes();
+
+    Options mOptions;
+    std::unique_ptr<BS::thread_pool> mpThreadPool; ///< Thread pool, or nullptr when running on the calling thread.
+    CPUBVH mBVH;
+    AABB mSceneBounds;
+    ref<Camera> mpCamera;
+    std::vector<Instance> mInstances;
+    std::vector<MeshDesc> mMeshes;
+    std::vector<uint32_t> mIndexData;
+    std::vector<PackedStaticVertexData> mVertexData;
+    std::vector<MaterialParams> mMaterials;
+    std::vector<LightData> mLights;             ///< Point and directional lights.
+
+    std::vector<DensityNode> mNodes;
+    float mGlobalAccumulator = 1.f;
+    uint32_t mPassCount = 0;
+};
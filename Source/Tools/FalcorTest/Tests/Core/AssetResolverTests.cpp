@@ -188,6 +188,29 @@ CPU_TEST(AssetResolver)
         EXPECT_EQ(resolver.resolvePath("asset1"), kTestRoot / "media3/asset1");
     }
 
+    // Test resolve callback.
+    {
+        AssetResolver resolver;
+        std::vector<std::filesystem::path> resolvedPaths;
+        resolver.setResolveCallback([&](const std::filesystem::path& path) { resolvedPaths.push_back(path); });
+
+        resolver.addSearchPath(kTestRoot / "media2");
+        resolver.resolvePath("asset2");
+        resolver.resolvePath("asset3");
+        EXPECT_EQ(resolvedPaths.size(), 1);
+        EXPECT_EQ(resolvedPaths[0], kTestRoot / "media2/asset2");
+
+        // The callback is copied along with the resolver.
+        AssetResolver copy = resolver;
+        copy.addSearchPath(kTestRoot / "media4");
+        copy.resolvePathPattern("textures", R"(mip[0-9]\.png)");
+        EXPECT_EQ(resolvedPaths.size(), 5);
+
+        resolver.setResolveCallback({});
+        resolver.resolvePath("asset2");
+        EXPECT_EQ(resolvedPaths.size(), 5);
+    }
+
     removeTestFiles(ctx);
 }
 
@@ -0,0 +1,440 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "FocalGuiding/FocalGuidingCPU.h"
+#include "Core/Plugin.h"
+#include "RenderGraph/RenderGraph.h"
+#include "Scene/SceneBuilder.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace Falcor
+{
+namespace
+{
+/// Quad of the test scene, split into the triangles (p0, p1, p2) and (p0, p2, p3).
+struct Quad
+{
+    float3 p0, p1, p2, p3;
+    uint32_t materialID;
+};
+
+/// Box with an open front, lit by a point light below the ceiling.
+const Quad kQuads[] = {
+    {float3(0, 0, 0), float3(1, 0, 0), float3(1, 0, 1), float3(0, 0, 1), 0}, // Floor
+    {float3(0, 1, 0), float3(0, 1, 1), float3(1, 1, 1), float3(1, 1, 0), 0}, // Ceiling
+    {float3(0, 0, 0), float3(0, 1, 0), float3(1, 1, 0), float3(1, 0, 0), 0}, // Back
+    {float3(0, 0, 0), float3(0, 0, 1), float3(0, 1, 1), float3(0, 1, 0), 1}, // Left
+    {float3(1, 0, 0), float3(1, 1, 0), float3(1, 1, 1), float3(1, 0, 1), 2}, // Right
+    // Occluder hiding the light from most of the floor, so that indirect light dominates there.
+    {float3(0.2f, 0.7f, 0.2f), float3(0.2f, 0.7f, 0.8f), float3(0.8f, 0.7f, 0.8f), float3(0.8f, 0.7f, 0.2f), 0},
+};
+
+std::vector<FocalGuidingCPU::MaterialParams> createMaterials()
+{
+    FocalGuidingCPU::MaterialParams white;
+    white.baseColor = float3(0.8f);
+    FocalGuidingCPU::MaterialParams red;
+    red.baseColor = float3(0.8f, 0.1f, 0.1f);
+    FocalGuidingCPU::MaterialParams glossy;
+    glossy.baseColor = float3(0.1f, 0.8f, 0.1f);
+    glossy.roughness = 0.3f;
+    return {white, red, glossy};
+}
+
+ref<Camera> createCamera()
+{
+    ref<Camera> pCamera = Camera::create("Camera");
+    pCamera->setPosition(float3(0.5f, 0.5f, 2.2f));
+    pCamera->setTarget(float3(0.5f, 0.5f, 0.f));
+    pCamera->setUpVector(float3(0.f, 1.f, 0.f));
+    pCamera->setAspectRatio(1.f);
+    return pCamera;
+}
+
+ref<PointLight> createLight()
+{
+    ref<PointLight> pLight = PointLight::create("Light");
+    pLight->setWorldPosition(float3(0.5f, 0.9f, 0.5f));
+    pLight->setIntensity(float3(1.f));
+    return pLight;
+}
+
+/// Headless scene data assembled without a device.
+struct TestScene
+{
+    Scene::SceneData sceneData;
+    std::vector<FocalGuidingCPU::MaterialParams> materials;
+};
+
+void addQuad(TestScene& scene, const Quad& quad)
+{
+    auto& sceneData = scene.sceneData;
+    MeshDesc mesh = {};
+    mesh.vbOffset = (uint32_t)sceneData.meshStaticData.size();
+    mesh.ibOffset = (uint32_t)sceneData.meshIndexData.size();
+    mesh.vertexCount = 4;
+    mesh.indexCount = 6;
+
+    for (const float3& position : {quad.p0, quad.p1, quad.p2, quad.p3})
+    {
+        PackedStaticVertexData vertex = {};
+        vertex.position = position;
+        sceneData.meshStaticData.push_back(vertex);
+    }
+    for (uint32_t index : {0, 1, 2, 0, 2, 3})
+        sceneData.meshIndexData.push_back(index);
+
+    GeometryInstanceData instance(GeometryType::TriangleMesh);
+    instance.globalMatrixID = 0;
+    instance.materialID = quad.materialID;
+    instance.geometryID = (uint32_t)sceneData.meshDesc.size();
+    instance.vbOffset = mesh.vbOffset;
+    instance.ibOffset = mesh.ibOffset;
+    instance.instanceIndex = (uint32_t)sceneData.meshInstanceData.size();
+    sceneData.meshInstanceData.push_back(instance);
+    sceneData.meshDesc.push_back(mesh);
+}
+
+TestScene createTestScene()
+{
+    TestScene scene;
+    scene.sceneData.sceneGraph.emplace_back("Root", NodeID::Invalid(), float4x4::identity(), float4x4::identity(), float4x4::identity());
+    scene.materials = createMaterials();
+    for (const Quad& quad : kQuads)
+        addQuad(scene, quad);
+    scene.sceneData.cameras.push_back(createCamera());
+    scene.sceneData.lights.push_back(createLight());
+    return scene;
+}
+
+/// Create the test scene on the GPU, with two-sided standard materials matching createMaterials().
+ref<Scene> createGPUScene(ref<Device> pDevice)
+{
+    SceneBuilder builder(pDevice, Settings());
+
+    std::vector<ref<Material>> materials;
+    for (const FocalGuidingCPU::MaterialParams& params : createMaterials())
+    {
+        ref<StandardMaterial> pMaterial = StandardMaterial::create(pDevice, "Material");
+        pMaterial->setBaseColor3(params.baseColor);
+        pMaterial->setRoughness(params.roughness);
+        pMaterial->setMetallic(params.metallic);
+        pMaterial->setDoubleSided(true);
+        materials.push_back(pMaterial);
+    }
+
+    SceneBuilder::Node node;
+    node.name = "Root";
+    node.transform = float4x4::identity();
+    node.meshBind = float4x4::identity();
+    node.localToBindPose = float4x4::identity();
+    const NodeID nodeID = builder.addNode(node);
+
+    for (const Quad& quad : kQuads)
+    {
+        const float3 normal = normalize(cross(quad.p1 - quad.p0, quad.p2 - quad.p0));
+        TriangleMesh::VertexList vertices = {
+            {quad.p0, normal, float2(0.f, 0.f)},
+            {quad.p1, normal, float2(1.f, 0.f)},
+            {quad.p2, normal, float2(1.f, 1.f)},
+            {quad.p3, normal, float2(0.f, 1.f)},
+        };
+        ref<TriangleMesh> pMesh = TriangleMesh::create(vertices, {0, 1, 2, 0, 2, 3});
+        builder.addMeshInstance(nodeID, builder.addTriangleMesh(pMesh, materials[quad.materialID]));
+    }
+
+    builder.addCamera(createCamera());
+    builder.addLight(createLight());
+    return builder.getScene();
+}
+
+/// Per-pixel sums of the luminance and its square, and the mean luminance of each frame.
+struct LuminanceStats
+{
+    std::vector<double> sum;
+    std::vector<double> sumSqr;
+    std::vector<double> frameMeans;
+
+    void add(const float4* pImage, size_t pixelCount)
+    {
+        sum.resize(pixelCount, 0.0);
+        sumSqr.resize(pixelCount, 0.0);
+        double frameSum = 0.0;
+        for (size_t i = 0; i < pixelCount; ++i)
+        {
+            const double value = dot(pImage[i].xyz(), float3(0.2126f, 0.7152f, 0.0722f));
+            sum[i] += value;
+            sumSqr[i] += value * value;
+            frameSum += value;
+        }
+        frameMeans.push_back(frameSum / pixelCount);
+    }
+
+    /// Mean luminance over all pixels and frames.
+    double getMean() const
+    {
+        double mean = 0.0;
+        for (double frameMean : frameMeans)
+            mean += frameMean;
+        return mean / frameMeans.size();
+    }
+
+    /// Standard error of getMean(), estimated from the spread of the frame means.
+    double getStandardError() const
+    {
+        const double mean = getMean();
+        double variance = 0.0;
+        for (double frameMean : frameMeans)
+            variance += (frameMean - mean) * (frameMean - mean);
+        variance /= frameMeans.size() - 1;
+        return std::sqrt(variance / frameMeans.size());
+    }
+
+    /// Per-pixel variance of a single sample, averaged over all pixels.
+    double getMeanPixelVariance() const
+    {
+        const double n = (double)frameMeans.size();
+        double variance = 0.0;
+        for (size_t i = 0; i < sum.size(); ++i)
+            variance += (sumSqr[i] - sum[i] * sum[i] / n) / (n - 1.0);
+        return variance / sum.size();
+    }
+};
+
+FocalGuidingCPU::Options createOptions(uint32_t threadCount)
+{
+    FocalGuidingCPU::Options options;
+    options.maxPassCount = 4;
+    options.initOctreeDepth = 2;
+    options.maxOctreeDepth = 5;
+    options.narrowFromPass = 1;
+    options.splittingThreshold = 0.005f;
+    options.tileSize = 8;
+    options.threadCount = threadCount;
+    return options;
+}
+
+float computeAverageLuminance(const std::vector<float4>& image)
+{
+    double sum = 0.0;
+    for (const float4& color : image)
+        sum += dot(color.xyz(), float3(0.2126f, 0.7152f, 0.0722f));
+    return float(sum / image.size());
+}
+} // namespace
+
+CPU_TEST(FocalGuidingCPU_ThreadCountInvariant)
+{
+    const TestScene scene = createTestScene();
+    const uint2 frameDim(48, 40);
+
+    FocalGuidingCPU serial(scene.sceneData, scene.materials, createOptions(1));
+    FocalGuidingCPU parallel(scene.sceneData, scene.materials, createOptions(4));
+    serial.train(frameDim);
+    parallel.train(frameDim);
+
+    EXPECT_EQ(serial.getPassCount(), 4u);
+    EXPECT_EQ(parallel.getPassCount(), 4u);
+    EXPECT_EQ(serial.getGlobalAccumulator(), parallel.getGlobalAccumulator());
+    ASSERT_EQ(serial.getNodesSize(), parallel.getNodesSize());
+    EXPECT_EQ(std::memcmp(serial.getNodes().data(), parallel.getNodes().data(), serial.getNodesSize() * sizeof(DensityNode)), 0);
+
+    const std::vector<float4> serialImage = serial.render(frameDim, 4);
+    const std::vector<float4> parallelImage = parallel.render(frameDim, 4);
+    ASSERT_EQ(serialImage.size(), parallelImage.size());
+    EXPECT_EQ(std::memcmp(serialImage.data(), parallelImage.data(), serialImage.size() * sizeof(float4)), 0);
+}
+
+CPU_TEST(FocalGuidingCPU_DensityStatistics)
+{
+    const TestScene scene = createTestScene();
+    const FocalGuidingCPU::Options options = createOptions(0);
+    FocalGuidingCPU guiding(scene.sceneData, scene.materials, options);
+    guiding.train(uint2(64, 64));
+
+    // Training must have refined the uniform octree without exceeding the limits.
+    const uint32_t uniformNodesSize = (uint32_t)FocalGuidingCPU::genUniformNodes(options.initOctreeDepth).size();
+    const std::vector<DensityNode>& nodes = guiding.getNodes();
+    EXPECT_GT(guiding.getNodesSize(), uniformNodesSize);
+    EXPECT_LE(guiding.getNodesSize(), options.maxNodesSize);
+    EXPECT_GT(guiding.getGlobalAccumulator(), 0.f);
+
+    // Every path segment adds to the accumulators of all nested boxes it crosses, so the accumulator of each inner
+    // child must equal the sum of its node's child accumulators, and the global accumulator the sum of the root's.
+    auto sumChilds = [&](uint32_t nodeIndex)
+    {
+        double sum = 0.0;
+        for (const DensityChild& child : nodes[nodeIndex].childs)
+            sum += child.accumulator;
+        return sum;
+    };
+    EXPECT_LE(std::abs(sumChilds(0) - guiding.getGlobalAccumulator()), 1e-4 * guiding.getGlobalAccumulator());
+
+    std::vector<uint32_t> stack = {0};
+    uint32_t linkedNodeCount = 1;
+    while (!stack.empty())
+    {
+        const uint32_t nodeIndex = stack.back();
+        stack.pop_back();
+        const uint32_t depth = nodes[nodeIndex].parentOffsetAndDepth >> PARENT_OFFSET_BIT_COUNT;
+        for (uint32_t childIndex = 0; childIndex < 8; ++childIndex)
+        {
+            const DensityChild& child = nodes[nodeIndex].childs[childIndex];
+            EXPECT_GE(child.accumulator, 0.f);
+            if (child.isLeaf()) continue;
+
+            ASSERT_LT(child.index, nodes.size());
+            const DensityNode& childNode = nodes[child.index];
+            EXPECT_EQ(childNode.parentIndex, nodeIndex);
+            EXPECT_EQ(childNode.parentOffsetAndDepth & PARENT_OFFSET_BITS, childIndex);
+            EXPECT_EQ(childNode.parentOffsetAndDepth >> PARENT_OFFSET_BIT_COUNT, depth + 1);
+            EXPECT_LT(depth + 1, options.maxOctreeDepth);
+            EXPECT_LE(std::abs(sumChilds(child.index) - child.accumulator), 1e-4 * guiding.getGlobalAccumulator() + 1e-3 * child.accumulator)
+                << "node=" << child.index;
+            stack.push_back(child.index);
+            linkedNodeCount++;
+        }
+    }
+    EXPECT_GT(linkedNodeCount, uniformNodesSize);
+}
+
+CPU_TEST(FocalGuidingCPU_GuidedMatchesReference)
+{
+    // Guiding changes the sampling but not the expected value, so a guided render must match an unguided reference.
+    const TestScene scene = createTestScene();
+    const uint2 frameDim(24, 24);
+    const uint32_t sampleCount = 256;
+
+    FocalGuidingCPU::Options referenceOptions = createOptions(0);
+    referenceOptions.guidedRayProb = 0.f;
+    FocalGuidingCPU reference(scene.sceneData, scene.materials, referenceOptions);
+    const float referenceLuminance = computeAverageLuminance(reference.render(frameDim, sampleCount));
+
+    FocalGuidingCPU guided(scene.sceneData, scene.materials, createOptions(0));
+    guided.train(uint2(64, 64));
+    const float guidedLuminance = computeAverageLuminance(guided.render(frameDim, sampleCount));
+
+    ASSERT_GT(referenceLuminance, 0.f);
+    EXPECT_LE(std::abs(guidedLuminance - referenceLuminance), 0.03f * referenceLuminance)
+        << "guided=" << guidedLuminance << " reference=" << referenceLuminance;
+}
+
+GPU_TEST(FocalGuidingCPU_MatchesGPU)
+{
+    // The CPU backend uses a Lambertian diffuse lobe and separable masking, whereas StandardMaterial uses the
+    // Frostbite diffuse lobe and height-correlated masking, so the means only agree up to this relative tolerance.
+    const double kBSDFTolerance = 0.05;
+    const uint2 frameDim(32, 32);
+    const uint32_t warmupFrameCount = 8; // Frames rendered while the GPU passes train the octree.
+    const uint32_t frameCount = 64;
+    const size_t pixelCount = (size_t)frameDim.x * frameDim.y;
+
+    PluginManager::instance().loadPluginByName("GBuffer");
+    PluginManager::instance().loadPluginByName("FocalGuiding");
+
+    ref<Device> pDevice = ctx.getDevice();
+    RenderContext* pRenderContext = ctx.getRenderContext();
+    ref<Scene> pScene = createGPUScene(pDevice);
+    pScene->update(pRenderContext, 0.0);
+
+    // The passes run with their default options, which match the defaults of FocalGuidingCPU::Options.
+    ref<RenderGraph> pGraph = RenderGraph::create(pDevice, "FocalGuiding");
+    for (const char* type : {"VBufferRT", "FocalDensities", "NodeSplitting", "NodePruning", "FocalGuiding"})
+    {
+        ref<RenderPass> pPass = RenderPass::create(type, pDevice);
+        if (!pPass)
+            FALCOR_THROW("Could not create render pass '{}'", type);
+        pGraph->addPass(pPass, type);
+    }
+    pGraph->addEdge("VBufferRT.vbuffer", "FocalDensities.vbuffer");
+    pGraph->addEdge("FocalDensities", "NodeSplitting");
+    pGraph->addEdge("NodeSplitting", "NodePruning");
+    pGraph->addEdge("NodePruning", "FocalGuiding");
+    pGraph->addEdge("VBufferRT.vbuffer", "FocalGuiding.vbuffer");
+    pGraph->markOutput("FocalGuiding.color");
+    pGraph->setScene(pScene);
+    ref<Fbo> pTargetFbo = Fbo::create2D(pDevice, frameDim.x, frameDim.y, ResourceFormat::RGBA32Float);
+    pGraph->onResize(pTargetFbo.get());
+
+    LuminanceStats gpuStats;
+    for (uint32_t frame = 0; frame < warmupFrameCount + frameCount; ++frame)
+    {
+        pScene->update(pRenderContext, 0.0);
+        pGraph->execute(pRenderContext);
+        if (frame < warmupFrameCount)
+            continue;
+
+        ref<Texture> pOutput = pGraph->getOutput("FocalGuiding.color")->asTexture();
+        const std::vector<uint8_t> data = pRenderContext->readTextureSubresource(pOutput.get(), 0);
+        ASSERT_EQ(data.size(), pixelCount * sizeof(float4));
+        gpuStats.add(reinterpret_cast<const float4*>(data.data()), pixelCount);
+    }
+
+    // The CPU backend renders the same scene, read back from the GPU, with one sample per pixel and frame.
+    FocalGuidingCPU cpu(FocalGuidingCPU::createSceneData(*pScene), FocalGuidingCPU::getMaterialParams(pScene->getMaterials()));
+    cpu.train(frameDim);
+    LuminanceStats cpuStats;
+    for (uint32_t frame = 0; frame < frameCount; ++frame)
+    {
+        const std::vector<float4> image = cpu.render(frameDim, 1, frame);
+        ASSERT_EQ(image.size(), pixelCount);
+        cpuStats.add(image.data(), pixelCount);
+    }
+
+    const double gpuMean = gpuStats.getMean();
+    const double cpuMean = cpuStats.getMean();
+    ASSERT_GT(cpuMean, 0.0);
+    const double standardError = std::sqrt(gpuStats.getStandardError() * gpuStats.getStandardError() + cpuStats.getStandardError() * cpuStats.getStandardError());
+    EXPECT_LE(std::abs(gpuMean - cpuMean), 4.0 * standardError + kBSDFTolerance * cpuMean)
+        << "gpu=" << gpuMean << " cpu=" << cpuMean << " standardError=" << standardError;
+
+    // Both octrees are trained with the same options, so the noise of the guided paths should be comparable.
+    const double varianceRatio = gpuStats.getMeanPixelVariance() / cpuStats.getMeanPixelVariance();
+    EXPECT_GE(varianceRatio, 0.5) << "gpu=" << gpuStats.getMeanPixelVariance() << " cpu=" << cpuStats.getMeanPixelVariance();
+    EXPECT_LE(varianceRatio, 2.0) << "gpu=" << gpuStats.getMeanPixelVariance() << " cpu=" << cpuStats.getMeanPixelVariance();
+}
+
+GPU_TEST(FocalGuidingCPU_MaterialTextures)
+{
+    ref<Device> pDevice = ctx.getDevice();
+    ref<StandardMaterial> pMaterial = StandardMaterial::create(pDevice, "Material");
+    pMaterial->setBaseColor3(float3(0.3f));
+    std::vector<ref<Material>> materials = {pMaterial};
+    EXPECT(!FocalGuidingCPU::getMaterialParams(materials)[0].hasTextures);
+
+    // Textures are not sampled, the material is flagged and shaded with its constant parameters.
+    const uint32_t texel = 0xffffffff;
+    pMaterial->setBaseColorTexture(pDevice->createTexture2D(1, 1, ResourceFormat::RGBA8Unorm, 1, 1, &texel));
+    const auto params = FocalGuidingCPU::getMaterialParams(materials);
+    ASSERT_EQ(params.size(), 1);
+    EXPECT(params[0].hasTextures);
+    EXPECT(all(params[0].baseColor == float3(0.3f)));
+}
+} // namespace Falcor
@@ -0,0 +1,872 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Rendering/Lights/LightBVHBuilder.h"
+#include "Utils/Math/MathConstants.slangh"
+#include "Utils/Timing/CpuTimer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <numeric>
+#include <random>
+
+namespace Falcor
+{
+namespace
+{
+/// Generate clustered emissive triangles. Some of them have zero flux and get culled by the pre-integration.
+std::vector<LightCollection::MeshLightTriangle> createRandomTriangles(uint32_t count, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u(0.f, 1.f);
+    auto randomFloat3 = [&]() { return float3(u(rng), u(rng), u(rng)); };
+
+    std::vector<LightCollection::MeshLightTriangle> triangles(count);
+    float3 clusterCenter = float3(0.f);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (i % 256 == 0)
+            clusterCenter = randomFloat3() * 100.f;
+
+        auto& tri = triangles[i];
+        const float3 center = clusterCenter + (randomFloat3() - 0.5f) * 10.f;
+        const float size = 0.01f + u(rng);
+        for (uint32_t j = 0; j < 3; ++j)
+            tri.vtx[j].pos = center + (randomFloat3() - 0.5f) * size;
+
+        const float3 n = cross(tri.vtx[1].pos - tri.vtx[0].pos, tri.vtx[2].pos - tri.vtx[0].pos);
+        tri.area = 0.5f * length(n);
+        tri.normal = tri.area > 0.f ? normalize(n) : float3(0.f, 0.f, 1.f);
+        tri.flux = u(rng) < 0.1f ? 0.f : u(rng) * 10.f;
+        tri.lightIdx = 0;
+    }
+    return triangles;
+}
+
+struct BuildResult
+{
+    std::vector<PackedNode> nodes;
+    std::vector<uint32_t> triangleIndices;
+    std::vector<uint64_t> triangleBitmasks;
+};
+
+BuildResult build(const LightBVHBuilder::Options& options, const std::vector<LightCollection::MeshLightTriangle>& triangles)
+{
+    BuildResult result;
+    LightBVHBuilder builder(options);
+    builder.buildNodes(triangles, result.nodes, result.triangleIndices, result.triangleBitmasks);
+    return result;
+}
+
+/** Reference copy of the original recursive light BVH builder, which sorted an array of per-triangle structs in place.
+    It is kept here to check that the flattened, parallel builder produces the same hierarchy.
+*/
+namespace reference
+{
+struct TriangleSortData
+{
+    AABB bounds;
+    float3 coneDirection = float3(0.f);
+    float cosConeAngle = 1.f;
+    float flux = 0.f;
+    uint32_t triangleIndex = 0;
+};
+
+struct Range
+{
+    uint32_t begin;
+    uint32_t end;
+    uint32_t length() const { return end - begin; }
+    uint32_t middle() const { return (begin + end) / 2; }
+};
+
+struct SplitResult
+{
+    uint32_t axis = std::numeric_limits<uint32_t>::max();
+    uint32_t triangleIndex = std::numeric_limits<uint32_t>::max();
+    bool isValid() const { return axis != std::numeric_limits<uint32_t>::max() && triangleIndex != std::numeric_limits<uint32_t>::max(); }
+};
+
+struct BuildingData
+{
+    std::vector<TriangleSortData> trianglesData;
+    BuildResult result;
+    float currentNodeFlux = 0.f;
+};
+
+using Options = LightBVHBuilder::Options;
+
+float safeACos(float v)
+{
+    return std::acos(std::clamp(v, -1.0f, 1.0f));
+}
+
+float sinFromCos(float cosAngle)
+{
+    return std::sqrt(std::max(0.f, 1.f - cosAngle * cosAngle));
+}
+
+float computeCosConeAngle(const float3& coneDir, const float cosTheta, const float3& otherConeDir, const float cosOtherTheta)
+{
+    float cosResult = kInvalidCosConeAngle;
+    if (cosTheta != kInvalidCosConeAngle && cosOtherTheta != kInvalidCosConeAngle)
+    {
+        const float cosDiffTheta = dot(coneDir, otherConeDir);
+        const float sinDiffTheta = sinFromCos(cosDiffTheta);
+        const float sinOtherTheta = sinFromCos(cosOtherTheta);
+        float cosTotalTheta = cosOtherTheta * cosDiffTheta - sinOtherTheta * sinDiffTheta;
+        float sinTotalTheta = sinOtherTheta * cosDiffTheta + cosOtherTheta * sinDiffTheta;
+        if (sinTotalTheta > 0.f)
+            cosResult = std::min(cosTheta, cosTotalTheta);
+    }
+    return cosResult;
+}
+
+float3 coneUnionOld(float3 aDir, float aCosTheta, float3 bDir, float bCosTheta, float& cosResult)
+{
+    float3 dir = aDir + bDir;
+    if (aCosTheta == kInvalidCosConeAngle || bCosTheta == kInvalidCosConeAngle || all(dir == float3(0.0f)))
+    {
+        cosResult = kInvalidCosConeAngle;
+        return float3(0.0f);
+    }
+    dir = normalize(dir);
+    const float aDiff = safeACos(dot(dir, aDir));
+    const float bDiff = safeACos(dot(dir, bDir));
+    cosResult = std::cos(std::max(aDiff + std::acos(aCosTheta), bDiff + std::acos(bCosTheta)));
+    return dir;
+}
+
+float aabbVolume(const AABB& bb, float epsilon)
+{
+    if (!bb.valid())
+        return -std::numeric_limits<float>::infinity();
+    const float3 dims = max(float3(epsilon), bb.extent());
+    return dims.x * dims.y * dims.z;
+}
+
+float evalSAH(const AABB& bounds, const uint32_t triangleCount, const Options& parameters)
+{
+    float aabbCost = bounds.valid() ? (parameters.useVolumeOverSA ? aabbVolume(bounds, parameters.volumeEpsilon) : bounds.area()) : 0.f;
+    return aabbCost * (float)triangleCount;
+}
+
+float computeOrientationCost(const float theta_o)
+{
+    float theta_w = std::min(theta_o + float(M_PI_2), float(M_PI));
+    float sin_theta_o = std::sin(theta_o);
+    float cos_theta_o = std::cos(theta_o);
+    return float(M_2PI) * (1.0f - cos_theta_o) +
+           float(M_PI_2) * (2.0f * theta_w * sin_theta_o - std::cos(theta_o - 2.0f * theta_w) - 2.0f * theta_o * sin_theta_o + cos_theta_o);
+}
+
+float evalSAOH(const AABB& bounds, const float flux, const float cosTheta, const Options& parameters)
+{
+    float fluxCost = parameters.usePreintegration ? flux : 1.0f;
+    float aabbCost = bounds.valid() ? (parameters.useVolumeOverSA ? aabbVolume(bounds, parameters.volumeEpsilon) : bounds.area()) : 0.f;
+    float theta = cosTheta != kInvalidCosConeAngle ? safeACos(cosTheta) : float(M_PI);
+    float orientationCost = parameters.useLightingCones ? computeOrientationCost(theta) : 1.0f;
+    return fluxCost * aabbCost * orientationCost;
+}
+
+uint32_t largestDimension(const AABB& bounds)
+{
+    float3 dimensions = bounds.extent();
+    return dimensions[2] >= dimensions[0] && dimensions[2] >= dimensions[1] ? 2 : (dimensions[1] >= dimensions[0] ? 1 : 0);
+}
+
+float3 computeLightingCone(const Range& triangleRange, const BuildingData& data, float& cosTheta)
+{
+    float3 coneDirection = float3(0.0f);
+    cosTheta = kInvalidCosConeAngle;
+    float3 coneDirectionSum = float3(0.0f);
+    for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
+        coneDirectionSum += data.trianglesData[i].coneDirection;
+    if (length(coneDirectionSum) >= FLT_MIN)
+    {
+        coneDirection = normalize(coneDirectionSum);
+        cosTheta = 1.f;
+        for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
+        {
+            const TriangleSortData& td = data.trianglesData[i];
+            cosTheta = computeCosConeAngle(coneDirection, cosTheta, td.coneDirection, td.cosConeAngle);
+        }
+    }
+    return coneDirection;
+}
+
+SplitResult computeSplitWithEqual(const BuildingData&, const Range& triangleRange, const AABB& nodeBounds, const Options&)
+{
+    SplitResult result;
+    result.axis = largestDimension(nodeBounds);
+    result.triangleIndex = triangleRange.middle();
+    return result;
+}
+
+SplitResult computeSplitWithBinnedSAH(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, const Options& parameters)
+{
+    std::pair<float, SplitResult> overallBestSplit = std::make_pair(std::numeric_limits<float>::infinity(), SplitResult());
+
+    struct Bin
+    {
+        AABB bounds;
+        uint32_t triangleCount = 0;
+        Bin& operator|=(const Bin& rhs)
+        {
+            bounds |= rhs.bounds;
+            triangleCount += rhs.triangleCount;
+            return *this;
+        }
+    };
+
+    std::vector<Bin> bins(parameters.binCount);
+    std::vector<float> costs(parameters.binCount - 1);
+
+    const auto binAlongDimension = [&](uint32_t dimension)
+    {
+        auto getBinId = [&](const TriangleSortData& td)
+        {
+            float bmin = nodeBounds.minPoint[dimension], bmax = nodeBounds.maxPoint[dimension];
+            float scale = (float)parameters.binCount / (bmax - bmin);
+            float p = td.bounds.center()[dimension];
+            return std::min((uint32_t)((p - bmin) * scale), parameters.binCount - 1);
+        };
+
+        for (Bin& bin : bins)
+            bin = Bin();
+        for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
+        {
+            const auto& td = data.trianglesData[i];
+            Bin& bin = bins[getBinId(td)];
+            bin.bounds |= td.bounds;
+            bin.triangleCount++;
+        }
+
+        Bin total;
+        for (size_t i = 0; i < costs.size(); ++i)
+        {
+            total |= bins[i];
+            costs[i] = evalSAH(total.bounds, total.triangleCount, parameters);
+        }
+        total = Bin();
+        for (size_t i = costs.size(); i > 0; --i)
+        {
+            total |= bins[i];
+            costs[i - 1] += evalSAH(total.bounds, total.triangleCount, parameters);
+        }
+
+        std::pair<float, SplitResult> axisBestSplit = std::make_pair(std::numeric_limits<float>::infinity(), SplitResult{dimension, 0});
+        for (uint32_t i = 0, triIdx = triangleRange.begin; i < costs.size(); ++i)
+        {
+            triIdx += bins[i].triangleCount;
+            if (costs[i] < axisBestSplit.first)
+                axisBestSplit = std::make_pair(costs[i], SplitResult{dimension, triIdx});
+        }
+
+        if (axisBestSplit.second.triangleIndex == triangleRange.begin || axisBestSplit.second.triangleIndex == triangleRange.end)
+            return;
+        if (axisBestSplit.first < overallBestSplit.first)
+            overallBestSplit = axisBestSplit;
+    };
+
+    if (parameters.splitAlongLargest)
+    {
+        binAlongDimension(largestDimension(nodeBounds));
+    }
+    else
+    {
+        for (uint32_t dimension = 0; dimension < 3; ++dimension)
+            binAlongDimension(dimension);
+    }
+
+    if (!overallBestSplit.second.isValid())
+    {
+        if (triangleRange.length() <= parameters.maxTriangleCountPerLeaf)
+            return SplitResult();
+        return computeSplitWithEqual(data, triangleRange, nodeBounds, parameters);
+    }
+
+    if (parameters.useLeafCreationCost && triangleRange.length() <= parameters.maxTriangleCountPerLeaf)
+    {
+        float leafCost = evalSAH(nodeBounds, triangleRange.length(), parameters);
+        if (leafCost <= overallBestSplit.first)
+            return SplitResult();
+    }
+
+    return overallBestSplit.second;
+}
+
+SplitResult computeSplitWithBinnedSAOH(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, const Options& parameters)
+{
+    std::pair<float, SplitResult> overallBestSplit = std::make_pair(std::numeric_limits<float>::infinity(), SplitResult());
+    const float3 dimensions = nodeBounds.extent();
+    const uint32_t largest = largestDimension(nodeBounds);
+
+    struct Bin
+    {
+        AABB bounds;
+        uint32_t triangleCount = 0;
+        float flux = 0.0f;
+        float3 coneDirection = float3(0.0f);
+        float cosConeAngle = 1.0f;
+        Bin& operator|=(const Bin& rhs)
+        {
+            bounds |= rhs.bounds;
+            triangleCount += rhs.triangleCount;
+            flux += rhs.flux;
+            coneDirection += rhs.coneDirection;
+            return *this;
+        }
+    };
+
+    std::vector<Bin> bins(parameters.binCount);
+    std::vector<float> costs(parameters.binCount - 1);
+
+    const auto binAlongDimension = [&](uint32_t dimension)
+    {
+        auto getBinId = [&](const TriangleSortData& td)
+        {
+            float bmin = nodeBounds.minPoint[dimension], bmax = nodeBounds.maxPoint[dimension];
+            float w = bmax - bmin;
+            float scale = w > FLT_MIN ? (float)parameters.binCount / w : 0.f;
+            float p = td.bounds.center()[dimension];
+            return std::min((uint32_t)((p - bmin) * scale), parameters.binCount - 1);
+        };
+
+        for (Bin& bin : bins)
+            bin = Bin();
+        for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
+        {
+            const auto& td = data.trianglesData[i];
+            Bin& bin = bins[getBinId(td)];
+            bin.bounds |= td.bounds;
+            bin.triangleCount++;
+            bin.flux += td.flux;
+            bin.coneDirection += td.coneDirection;
+        }
+
+        for (Bin& bin : bins)
+        {
+            bin.cosConeAngle = length(bin.coneDirection) < FLT_MIN ? kInvalidCosConeAngle : 1.0f;
+            bin.coneDirection = normalize(bin.coneDirection);
+        }
+        for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
+        {
+            const auto& td = data.trianglesData[i];
+            Bin& bin = bins[getBinId(td)];
+            bin.cosConeAngle = computeCosConeAngle(bin.coneDirection, bin.cosConeAngle, td.coneDirection, td.cosConeAngle);
+        }
+
+        Bin total;
+        for (size_t i = 0; i < costs.size(); ++i)
+        {
+            total |= bins[i];
+            float cosTheta = kInvalidCosConeAngle;
+            if (length(total.coneDirection) >= FLT_MIN)
+            {
+                cosTheta = 1.f;
+                float3 coneDir = normalize(total.coneDirection);
+                for (size_t j = 0; j <= i; ++j)
+                    cosTheta = computeCosConeAngle(coneDir, cosTheta, bins[j].coneDirection, bins[j].cosConeAngle);
+            }
+            costs[i] = evalSAOH(total.bounds, total.flux, cosTheta, parameters);
+        }
+        total = Bin();
+        for (size_t i = costs.size(); i > 0; --i)
+        {
+            total |= bins[i];
+            float cosTheta = kInvalidCosConeAngle;
+            if (length(total.coneDirection) >= FLT_MIN)
+            {
+                cosTheta = 1.f;
+                float3 coneDir = normalize(total.coneDirection);
+                for (size_t j = i; j <= costs.size(); ++j)
+                    cosTheta = computeCosConeAngle(coneDir, cosTheta, bins[j].coneDirection, bins[j].cosConeAngle);
+            }
+            costs[i - 1] += evalSAOH(total.bounds, total.flux, cosTheta, parameters);
+        }
+
+        std::pair<float, SplitResult> axisBestSplit = std::make_pair(std::numeric_limits<float>::infinity(), SplitResult{dimension, 0});
+        for (uint32_t i = 0, triIdx = triangleRange.begin; i < costs.size(); ++i)
+        {
+            triIdx += bins[i].triangleCount;
+            if (costs[i] < axisBestSplit.first)
+                axisBestSplit = std::make_pair(costs[i], SplitResult{dimension, triIdx});
+        }
+        axisBestSplit.first *= dimensions[largest] / dimensions[dimension];
+
+        if (axisBestSplit.second.triangleIndex == triangleRange.begin || axisBestSplit.second.triangleIndex == triangleRange.end)
+            return;
+        if (axisBestSplit.first < overallBestSplit.first)
+            overallBestSplit = axisBestSplit;
+    };
+
+    if (parameters.splitAlongLargest)
+    {
+        binAlongDimension(largest);
+    }
+    else
+    {
+        for (uint32_t dimension = 0; dimension < 3; ++dimension)
+            binAlongDimension(dimension);
+    }
+
+    if (!overallBestSplit.second.isValid())
+    {
+        if (triangleRange.length() <= parameters.maxTriangleCountPerLeaf)
+            return SplitResult();
+        return computeSplitWithEqual(data, triangleRange, nodeBounds, parameters);
+    }
+
+    if (parameters.useLeafCreationCost && triangleRange.length() <= parameters.maxTriangleCountPerLeaf)
+    {
+        float cosTheta = kInvalidCosConeAngle;
+        computeLightingCone(triangleRange, data, cosTheta);
+        float leafCost = evalSAOH(nodeBounds, data.currentNodeFlux, cosTheta, parameters);
+        if (leafCost <= overallBestSplit.first)
+            return SplitResult();
+    }
+
+    return overallBestSplit.second;
+}
+
+using SplitFunction = SplitResult (*)(const BuildingData&, const Range&, const AABB&, const Options&);
+
+uint32_t buildInternal(const Options& options, SplitFunction splitFunc, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data)
+{
+    float nodeFlux = 0.f;
+    AABB nodeBounds;
+    for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
+    {
+        nodeBounds |= data.trianglesData[i].bounds;
+        nodeFlux += data.trianglesData[i].flux;
+    }
+    data.currentNodeFlux = nodeFlux;
+
+    bool trySplitting = triangleRange.length() > (options.createLeavesASAP ? options.maxTriangleCountPerLeaf : 1);
+    const SplitResult splitResult = trySplitting ? splitFunc(data, triangleRange, nodeBounds, options) : SplitResult();
+
+    auto& nodes = data.result.nodes;
+    const uint32_t nodeIndex = (uint32_t)nodes.size();
+    nodes.push_back({});
+
+    if (splitResult.isValid())
+    {
+        auto comp = [dim = splitResult.axis](const TriangleSortData& d1, const TriangleSortData& d2)
+        { return d1.bounds.center()[dim] < d2.bounds.center()[dim]; };
+        std::nth_element(
+            data.trianglesData.begin() + triangleRange.begin, data.trianglesData.begin() + splitResult.triangleIndex,
+            data.trianglesData.begin() + triangleRange.end, comp
+        );
+
+        InternalNode node = {};
+        node.attribs.setAABB(nodeBounds.minPoint, nodeBounds.maxPoint);
+        node.attribs.flux = nodeFlux;
+
+        buildInternal(options, splitFunc, bitmask | (0ull << depth), depth + 1, Range{triangleRange.begin, splitResult.triangleIndex}, data);
+        node.rightChildIdx =
+            buildInternal(options, splitFunc, bitmask | (1ull << depth), depth + 1, Range{splitResult.triangleIndex, triangleRange.end}, data);
+        nodes[nodeIndex].setInternalNode(node);
+    }
+    else
+    {
+        LeafNode node = {};
+        node.attribs.setAABB(nodeBounds.minPoint, nodeBounds.maxPoint);
+        node.attribs.flux = nodeFlux;
+        float cosTheta;
+        node.attribs.coneDirection = computeLightingCone(triangleRange, data, cosTheta);
+        node.attribs.cosConeAngle = cosTheta;
+        node.triangleCount = triangleRange.length();
+        node.triangleOffset = (uint32_t)data.result.triangleIndices.size();
+
+        for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
+        {
+            uint32_t globalTriangleIndex = data.trianglesData[i].triangleIndex;
+            data.result.triangleIndices.push_back(globalTriangleIndex);
+            data.result.triangleBitmasks[globalTriangleIndex] = bitmask;
+        }
+        nodes[nodeIndex].setLeafNode(node);
+    }
+    return nodeIndex;
+}
+
+float3 computeLightingConesInternal(const uint32_t nodeIndex, BuildingData& data, float& cosConeAngle)
+{
+    auto& nodes = data.result.nodes;
+    if (nodes[nodeIndex].isLeaf())
+    {
+        auto attribs = nodes[nodeIndex].getNodeAttributes();
+        cosConeAngle = attribs.cosConeAngle;
+        return attribs.coneDirection;
+    }
+
+    auto node = nodes[nodeIndex].getInternalNode();
+    float leftCosConeAngle = kInvalidCosConeAngle;
+    float3 leftConeDirection = computeLightingConesInternal(nodeIndex + 1, data, leftCosConeAngle);
+    float rightCosConeAngle = kInvalidCosConeAngle;
+    float3 rightConeDirection = computeLightingConesInternal(node.rightChildIdx, data, rightCosConeAngle);
+
+    float3 coneDirection = coneUnionOld(leftConeDirection, leftCosConeAngle, rightConeDirection, rightCosConeAngle, cosConeAngle);
+    node.attribs.cosConeAngle = cosConeAngle;
+    node.attribs.coneDirection = coneDirection;
+    nodes[nodeIndex].setNodeAttributes(node.attribs);
+    return coneDirection;
+}
+
+BuildResult build(const Options& options, const std::vector<LightCollection::MeshLightTriangle>& triangles)
+{
+    BuildingData data;
+    for (size_t i = 0; i < triangles.size(); i++)
+    {
+        if (!options.usePreintegration || triangles[i].flux > 0.f)
+        {
+            TriangleSortData tri;
+            for (uint32_t j = 0; j < 3; j++)
+                tri.bounds |= triangles[i].vtx[j].pos;
+            tri.coneDirection = triangles[i].normal;
+            tri.flux = triangles[i].flux;
+            tri.triangleIndex = static_cast<uint32_t>(i);
+            data.trianglesData.push_back(tri);
+        }
+    }
+    if (data.trianglesData.empty())
+        return {};
+
+    data.result.triangleBitmasks.resize(triangles.size(), std::numeric_limits<uint64_t>::max());
+    SplitFunction splitFunc = options.splitHeuristicSelection == LightBVHBuilder::SplitHeuristic::Equal ? computeSplitWithEqual
+                              : options.splitHeuristicSelection == LightBVHBuilder::SplitHeuristic::BinnedSAH ? computeSplitWithBinnedSAH
+                                                                                                              : computeSplitWithBinnedSAOH;
+    buildInternal(options, splitFunc, 0ull, 0, Range{0, static_cast<uint32_t>(data.trianglesData.size())}, data);
+
+    float cosConeAngle;
+    computeLightingConesInternal(0, data, cosConeAngle);
+    return std::move(data.result);
+}
+} // namespace reference
+
+/// Follow the bitmask of each triangle from the root and check that it leads to the leaf node referencing the triangle.
+void validateBitmasks(CPUUnitTestContext& ctx, const BuildResult& result)
+{
+    for (uint32_t triangleIndex : result.triangleIndices)
+    {
+        const uint64_t bitmask = result.triangleBitmasks[triangleIndex];
+        ASSERT_NE(bitmask, std::numeric_limits<uint64_t>::max());
+
+        uint32_t nodeIndex = 0;
+        uint32_t depth = 0;
+        while (!result.nodes[nodeIndex].isLeaf())
+        {
+            ASSERT_LT(depth, 64u);
+            bool right = (bitmask >> depth) & 1;
+            nodeIndex = right ? result.nodes[nodeIndex].getInternalNode().rightChildIdx : nodeIndex + 1;
+            depth++;
+        }
+
+        const LeafNode leaf = result.nodes[nodeIndex].getLeafNode();
+        bool found = false;
+        for (uint32_t i = 0; i < leaf.triangleCount; ++i)
+            found |= result.triangleIndices[leaf.triangleOffset + i] == triangleIndex;
+        EXPECT(found) << "triangleIndex=" << triangleIndex;
+    }
+}
+} // namespace
+
+CPU_TEST(LightBVHBuilder_ParallelMatchesSerial)
+{
+    // The triangle count is large enough to exercise the parallel split evaluation at the top of the tree.
+    const auto triangles = createRandomTriangles(100000, 1234);
+
+    for (auto heuristic : {LightBVHBuilder::SplitHeuristic::Equal, LightBVHBuilder::SplitHeuristic::BinnedSAH, LightBVHBuilder::SplitHeuristic::BinnedSAOH})
+    {
+        LightBVHBuilder::Options options;
+        options.splitHeuristicSelection = heuristic;
+
+        options.useParallelBuild = false;
+        BuildResult serial = build(options, triangles);
+        options.useParallelBuild = true;
+        BuildResult parallel = build(options, triangles);
+
+        ASSERT_GT(serial.nodes.size(), 0u);
+        ASSERT_EQ(serial.nodes.size(), parallel.nodes.size()) << "heuristic=" << enumToString(heuristic);
+        EXPECT_EQ(std::memcmp(serial.nodes.data(), parallel.nodes.data(), serial.nodes.size() * sizeof(PackedNode)), 0) << "heuristic=" << enumToString(heuristic);
+        EXPECT(serial.triangleIndices == parallel.triangleIndices) << "heuristic=" << enumToString(heuristic);
+        EXPECT(serial.triangleBitmasks == parallel.triangleBitmasks) << "heuristic=" << enumToString(heuristic);
+
+        validateBitmasks(ctx, parallel);
+    }
+}
+
+CPU_TEST(LightBVHBuilder_MatchesOriginal)
+{
+    const auto triangles = createRandomTriangles(20000, 8765);
+
+    for (auto heuristic : {LightBVHBuilder::SplitHeuristic::Equal, LightBVHBuilder::SplitHeuristic::BinnedSAH, LightBVHBuilder::SplitHeuristic::BinnedSAOH})
+    {
+        for (bool createLeavesASAP : {true, false})
+        {
+            LightBVHBuilder::Options options;
+            options.splitHeuristicSelection = heuristic;
+            options.createLeavesASAP = createLeavesASAP;
+
+            BuildResult expected = reference::build(options, triangles);
+            BuildResult result = build(options, triangles);
+
+            // The node layout, the bounds, the leaf contents and the traversal paths match exactly.
+            // The flux and the cones are sums over the triangles and may differ in the last bits.
+            ASSERT_GT(expected.nodes.size(), 0u);
+            ASSERT_EQ(result.nodes.size(), expected.nodes.size()) << "heuristic=" << enumToString(heuristic);
+            EXPECT(result.triangleIndices == expected.triangleIndices) << "heuristic=" << enumToString(heuristic);
+            EXPECT(result.triangleBitmasks == expected.triangleBitmasks) << "heuristic=" << enumToString(heuristic);
+
+            for (size_t nodeIndex = 0; nodeIndex < expected.nodes.size(); ++nodeIndex)
+            {
+                const PackedNode& node = result.nodes[nodeIndex];
+                const PackedNode& expectedNode = expected.nodes[nodeIndex];
+                ASSERT_EQ(node.isLeaf(), expectedNode.isLeaf()) << "nodeIndex=" << nodeIndex;
+                if (node.isLeaf())
+                {
+                    EXPECT_EQ(node.getLeafNode().triangleCount, expectedNode.getLeafNode().triangleCount) << "nodeIndex=" << nodeIndex;
+                    EXPECT_EQ(node.getLeafNode().triangleOffset, expectedNode.getLeafNode().triangleOffset) << "nodeIndex=" << nodeIndex;
+                }
+                else
+                {
+                    EXPECT_EQ(node.getInternalNode().rightChildIdx, expectedNode.getInternalNode().rightChildIdx) << "nodeIndex=" << nodeIndex;
+                }
+
+                SharedNodeAttributes attribs = node.getNodeAttributes();
+                SharedNodeAttributes expectedAttribs = expectedNode.getNodeAttributes();
+                EXPECT(all(attribs.origin == expectedAttribs.origin)) << "nodeIndex=" << nodeIndex;
+                EXPECT(all(attribs.extent == expectedAttribs.extent)) << "nodeIndex=" << nodeIndex;
+                EXPECT_LE(std::abs(attribs.flux - expectedAttribs.flux), 1e-4f * expectedAttribs.flux) << "nodeIndex=" << nodeIndex;
+                EXPECT_LE(std::abs(attribs.cosConeAngle - expectedAttribs.cosConeAngle), 1e-4f) << "nodeIndex=" << nodeIndex;
+                EXPECT_LE(length(attribs.coneDirection - expectedAttribs.coneDirection), 1e-4f) << "nodeIndex=" << nodeIndex;
+            }
+
+            validateBitmasks(ctx, result);
+        }
+    }
+}
+
+CPU_TEST(LightBVHBuilder_Culling)
+{
+    const auto triangles = createRandomTriangles(10000, 5678);
+    uint32_t nonZeroFluxCount = 0;
+    for (const auto& tri : triangles)
+        nonZeroFluxCount += tri.flux > 0.f ? 1 : 0;
+
+    LightBVHBuilder::Options options;
+    options.usePreintegration = true;
+    BuildResult result = build(options, triangles);
+    EXPECT_EQ(result.triangleIndices.size(), nonZeroFluxCount);
+    EXPECT_EQ(result.triangleBitmasks.size(), triangles.size());
+    for (uint32_t triangleIndex : result.triangleIndices)
+        EXPECT_GT(triangles[triangleIndex].flux, 0.f);
+    validateBitmasks(ctx, result);
+
+    // No triangles.
+    EXPECT_FALSE(LightBVHBuilder(options).buildNodes({}, result.nodes, result.triangleIndices, result.triangleBitmasks));
+    EXPECT(result.nodes.empty());
+}
+
+CPU_TEST(LightBVHBuilder_RefitParallelMatchesSerial)
+{
+    const auto triangles = createRandomTriangles(100000, 2468);
+    LightBVHBuilder::Options options;
+    BuildResult result = build(options, triangles);
+    ASSERT_GT(result.nodes.size(), 0u);
+
+    // Move the triangles so that the refit changes all the nodes.
+    auto movedTriangles = triangles;
+    std::mt19937 rng(13579);
+    std::uniform_real_distribution<float> u(-1.f, 1.f);
+    for (auto& tri : movedTriangles)
+    {
+        const float3 offset = float3(u(rng), u(rng), u(rng));
+        for (uint32_t j = 0; j < 3; ++j)
+            tri.vtx[j].pos += offset;
+    }
+
+    auto serialNodes = result.nodes;
+    LightBVHBuilder::refitNodes(movedTriangles, result.triangleIndices, false, serialNodes);
+    auto parallelNodes = result.nodes;
+    LightBVHBuilder::refitNodes(movedTriangles, result.triangleIndices, true, parallelNodes);
+
+    EXPECT_EQ(std::memcmp(serialNodes.data(), parallelNodes.data(), serialNodes.size() * sizeof(PackedNode)), 0);
+    EXPECT_NE(std::memcmp(serialNodes.data(), result.nodes.data(), serialNodes.size() * sizeof(PackedNode)), 0);
+}
+
+CPU_TEST(LightBVHBuilder_RefitBounds)
+{
+    const auto triangles = createRandomTriangles(10000, 97531);
+    LightBVHBuilder::Options options;
+    BuildResult result = build(options, triangles);
+    ASSERT_GT(result.nodes.size(), 0u);
+
+    // Refitting to the geometry the BVH was built for keeps the bounds and the flux.
+    auto refitNodes = result.nodes;
+    LightBVHBuilder::refitNodes(triangles, result.triangleIndices, true, refitNodes);
+    for (size_t nodeIndex = 0; nodeIndex < refitNodes.size(); ++nodeIndex)
+    {
+        SharedNodeAttributes built = result.nodes[nodeIndex].getNodeAttributes();
+        SharedNodeAttributes refit = refitNodes[nodeIndex].getNodeAttributes();
+        EXPECT_EQ(refitNodes[nodeIndex].data[0].x, result.nodes[nodeIndex].data[0].x) << "nodeIndex=" << nodeIndex;
+        EXPECT_EQ(refit.flux, built.flux) << "nodeIndex=" << nodeIndex;
+        EXPECT_LE(length(refit.origin - built.origin), 1e-3f * (1.f + length(built.extent))) << "nodeIndex=" << nodeIndex;
+        EXPECT_LE(length(refit.extent - built.extent), 1e-3f * (1.f + length(built.extent))) << "nodeIndex=" << nodeIndex;
+    }
+
+    // Scale the scene and check that the refitted nodes bound all the triangles in their subtree, up to the half precision extents.
+    auto movedTriangles = triangles;
+    for (auto& tri : movedTriangles)
+        for (uint32_t j = 0; j < 3; ++j)
+            tri.vtx[j].pos = tri.vtx[j].pos * float3(2.f, 0.5f, 1.f) + float3(10.f, 0.f, -5.f);
+
+    refitNodes = result.nodes;
+    LightBVHBuilder::refitNodes(movedTriangles, result.triangleIndices, true, refitNodes);
+
+    std::vector<AABB> leafBounds(refitNodes.size());
+    for (size_t nodeIndex = refitNodes.size(); nodeIndex-- > 0;)
+    {
+        if (refitNodes[nodeIndex].isLeaf())
+        {
+            const LeafNode leaf = refitNodes[nodeIndex].getLeafNode();
+            for (uint32_t i = 0; i < leaf.triangleCount; ++i)
+                for (uint32_t j = 0; j < 3; ++j)
+                    leafBounds[nodeIndex].include(movedTriangles[result.triangleIndices[leaf.triangleOffset + i]].vtx[j].pos);
+        }
+        else
+        {
+            const InternalNode node = refitNodes[nodeIndex].getInternalNode();
+            leafBounds[nodeIndex] = leafBounds[nodeIndex + 1] | leafBounds[node.rightChildIdx];
+        }
+
+        SharedNodeAttributes attribs = refitNodes[nodeIndex].getNodeAttributes();
+        float3 aabbMin, aabbMax;
+        attribs.getAABB(aabbMin, aabbMax);
+        const float3 tolerance = 1e-3f * (float3(1.f) + abs(attribs.origin) + attribs.extent);
+        EXPECT(all(aabbMin <= leafBounds[nodeIndex].minPoint + tolerance)) << "nodeIndex=" << nodeIndex;
+        EXPECT(all(aabbMax >= leafBounds[nodeIndex].maxPoint - tolerance)) << "nodeIndex=" << nodeIndex;
+    }
+}
+
+CPU_TEST(LightBVHBuilder_RefitCost)
+{
+    const auto triangles = createRandomTriangles(50000, 8642);
+    LightBVHBuilder::Options options;
+    BuildResult result = build(options, triangles);
+    ASSERT_GT(result.nodes.size(), 0u);
+    const float buildCost = LightBVHBuilder::computeSAOHCost(result.nodes, options);
+    EXPECT_GT(buildCost, 0.f);
+
+    // Refitting to the same geometry keeps the quality of the hierarchy.
+    auto refitNodes = result.nodes;
+    LightBVHBuilder::refitNodes(triangles, result.triangleIndices, true, refitNodes);
+    const float staticCost = LightBVHBuilder::computeSAOHCost(refitNodes, options);
+    EXPECT_LT(staticCost, options.maxRefitCostRatio * buildCost);
+
+    // A rigid translation does not change the relative cost.
+    auto movedTriangles = triangles;
+    for (auto& tri : movedTriangles)
+        for (uint32_t j = 0; j < 3; ++j)
+            tri.vtx[j].pos += float3(8.f, -4.f, 2.f);
+    refitNodes = result.nodes;
+    LightBVHBuilder::refitNodes(movedTriangles, result.triangleIndices, true, refitNodes);
+    const float translatedCost = LightBVHBuilder::computeSAOHCost(refitNodes, options);
+    EXPECT_LE(std::abs(translatedCost - staticCost), 1e-2f * staticCost);
+
+    // Scrambling the triangles across the clusters degrades the hierarchy past the rebuild threshold.
+    std::mt19937 rng(1111);
+    std::vector<uint32_t> permutation(triangles.size());
+    std::iota(permutation.begin(), permutation.end(), 0);
+    std::shuffle(permutation.begin(), permutation.end(), rng);
+    for (size_t i = 0; i < triangles.size(); ++i)
+        movedTriangles[i] = triangles[permutation[i]];
+    refitNodes = result.nodes;
+    LightBVHBuilder::refitNodes(movedTriangles, result.triangleIndices, true, refitNodes);
+    const float scrambledCost = LightBVHBuilder::computeSAOHCost(refitNodes, options);
+    EXPECT_GT(scrambledCost, options.maxRefitCostRatio * buildCost);
+}
+
+CPU_TEST(LightBVHBuilder_RefitWideNodes)
+{
+    const auto triangles = createRandomTriangles(10000, 3690);
+    LightBVHBuilder::Options options;
+    BuildResult result = build(options, triangles);
+    ASSERT_GT(result.nodes.size(), 0u);
+
+    auto movedTriangles = triangles;
+    for (auto& tri : movedTriangles)
+        for (uint32_t j = 0; j < 3; ++j)
+            tri.vtx[j].pos *= 3.f;
+    auto refitNodes = result.nodes;
+    LightBVHBuilder::refitNodes(movedTriangles, result.triangleIndices, true, refitNodes);
+
+    for (uint32_t width : {4u, 8u})
+    {
+        std::vector<PackedWideNodeGroup> wideNodes;
+        std::vector<uint32_t> wideChildNodeIndices;
+        LightBVHBuilder::collapseNodes(result.nodes, width, wideNodes, wideChildNodeIndices);
+        auto refitWideNodes = wideNodes;
+        LightBVHBuilder::refitWideNodes(refitNodes, wideChildNodeIndices, refitWideNodes);
+
+        // Collapsing the refitted binary BVH gives the same result as refitting the wide BVH.
+        std::vector<PackedWideNodeGroup> expectedWideNodes;
+        LightBVHBuilder::collapseNodes(refitNodes, width, expectedWideNodes, wideChildNodeIndices);
+        ASSERT_EQ(refitWideNodes.size(), expectedWideNodes.size());
+        EXPECT_EQ(std::memcmp(refitWideNodes.data(), expectedWideNodes.data(), refitWideNodes.size() * sizeof(PackedWideNodeGroup)), 0)
+            << "width=" << width;
+    }
+}
+
+CPU_TEST(LightBVHBuilder_Benchmark, TAGS("benchmark"))
+{
+    const auto triangles = createRandomTriangles(1 << 19, 4321);
+
+    for (bool useParallelBuild : {false, true})
+    {
+        LightBVHBuilder::Options options;
+        options.useParallelBuild = useParallelBuild;
+
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        BuildResult result = build(options, triangles);
+        double duration = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+
+        EXPECT_GT(result.nodes.size(), 0u);
+        logInfo(
+            "LightBVHBuilder: {} triangles, {} nodes, {} build: {:.1f} ms", triangles.size(), result.nodes.size(),
+            useParallelBuild ? "parallel" : "serial", duration
+        );
+
+        startTime = CpuTimer::getCurrentTimePoint();
+        LightBVHBuilder::refitNodes(triangles, result.triangleIndices, useParallelBuild, result.nodes);
+        duration = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+        logInfo("LightBVHBuilder: {} refit: {:.1f} ms", useParallelBuild ? "parallel" : "serial", duration);
+    }
+}
+} // namespace Falcor
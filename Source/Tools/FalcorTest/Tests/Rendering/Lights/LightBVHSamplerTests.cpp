@@ -0,0 +1,261 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Rendering/Lights/LightBVHBuilder.h"
+#include "Rendering/Lights/LightBVHReferenceSampler.h"
+
+#include <cmath>
+#include <random>
+
+namespace Falcor
+{
+namespace
+{
+/// Generate clustered emissive triangles. Some of them have zero flux and get culled by the pre-integration.
+std::vector<LightCollection::MeshLightTriangle> createRandomTriangles(uint32_t count, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u(0.f, 1.f);
+    auto randomFloat3 = [&]() { return float3(u(rng), u(rng), u(rng)); };
+
+    std::vector<LightCollection::MeshLightTriangle> triangles(count);
+    float3 clusterCenter = float3(0.f);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (i % 64 == 0)
+            clusterCenter = randomFloat3() * 100.f;
+
+        auto& tri = triangles[i];
+        const float3 center = clusterCenter + (randomFloat3() - 0.5f) * 10.f;
+        const float size = 0.01f + u(rng);
+        for (uint32_t j = 0; j < 3; ++j)
+            tri.vtx[j].pos = center + (randomFloat3() - 0.5f) * size;
+
+        const float3 n = cross(tri.vtx[1].pos - tri.vtx[0].pos, tri.vtx[2].pos - tri.vtx[0].pos);
+        tri.area = 0.5f * length(n);
+        tri.normal = tri.area > 0.f ? normalize(n) : float3(0.f, 0.f, 1.f);
+        tri.flux = u(rng) < 0.1f ? 0.f : 0.1f + u(rng) * 10.f;
+        tri.lightIdx = 0;
+    }
+    return triangles;
+}
+
+LightBVHReferenceSampler::BVHData build(const std::vector<LightCollection::MeshLightTriangle>& triangles, LightBVHBuilder::NodeWidth width)
+{
+    LightBVHReferenceSampler::BVHData data;
+    LightBVHBuilder builder(LightBVHBuilder::Options{});
+    builder.buildNodes(triangles, data.nodes, data.triangleIndices, data.triangleBitmasks);
+
+    data.nodeWidth = (uint32_t)width;
+    if (data.nodeWidth > 2)
+    {
+        std::vector<uint32_t> wideChildNodeIndices;
+        LightBVHBuilder::collapseNodes(data.nodes, data.nodeWidth, data.wideNodes, wideChildNodeIndices);
+        LightBVHBuilder::computeWideTriangleBitmasks(data.wideNodes, data.nodeWidth, data.triangleIndices, data.triangleBitmasks);
+    }
+    return data;
+}
+
+/// Returns the height of the wide BVH.
+uint32_t getWideTreeHeight(const LightBVHReferenceSampler::BVHData& data, uint32_t nodeIndex = 0)
+{
+    uint32_t height = 0;
+    for (uint32_t slot = 0; slot < data.nodeWidth; ++slot)
+    {
+        const PackedWideNodeGroup& group = data.wideNodes[nodeIndex + slot / PackedWideNodeGroup::kChildCount];
+        const uint32_t lane = slot % PackedWideNodeGroup::kChildCount;
+        if (group.isValid(lane) && !group.isLeaf(lane))
+            height = std::max(height, getWideTreeHeight(data, group.getChildNodeIndex(lane)));
+    }
+    return height + 1;
+}
+
+const LightBVHBuilder::NodeWidth kNodeWidths[] = {
+    LightBVHBuilder::NodeWidth::Binary,
+    LightBVHBuilder::NodeWidth::Wide4,
+    LightBVHBuilder::NodeWidth::Wide8,
+};
+
+const uint32_t kTriangleCounts[] = {1, 5, 300, 4000};
+} // namespace
+
+CPU_TEST(LightBVHSampler_WideLayout)
+{
+    for (uint32_t triangleCount : kTriangleCounts)
+    {
+        const auto triangles = createRandomTriangles(triangleCount, triangleCount);
+        const auto binary = build(triangles, LightBVHBuilder::NodeWidth::Binary);
+        if (binary.nodes.empty())
+            continue; // All triangles were culled.
+
+        for (auto width : {LightBVHBuilder::NodeWidth::Wide4, LightBVHBuilder::NodeWidth::Wide8})
+        {
+            const auto wide = build(triangles, width);
+
+            // Check that all triangles are reachable and that each wide leaf is a leaf of the binary BVH.
+            uint32_t reachedCount = 0;
+            for (const auto& group : wide.wideNodes)
+            {
+                for (uint32_t lane = 0; lane < PackedWideNodeGroup::kChildCount; ++lane)
+                {
+                    if (!group.isValid(lane) || !group.isLeaf(lane))
+                        continue;
+                    const LeafNode leaf = group.getChild(lane).getLeafNode();
+                    reachedCount += leaf.triangleCount;
+                    EXPECT_LE(leaf.triangleOffset + leaf.triangleCount, (uint32_t)binary.triangleIndices.size());
+                }
+            }
+            EXPECT_EQ(reachedCount, (uint32_t)binary.triangleIndices.size());
+
+            // The wide BVH should be shallower than the binary BVH.
+            uint32_t binaryHeight = 0;
+            for (uint32_t triangleIndex : binary.triangleIndices)
+            {
+                uint64_t bitmask = binary.triangleBitmasks[triangleIndex];
+                uint32_t nodeIndex = 0;
+                uint32_t depth = 0;
+                while (!binary.nodes[nodeIndex].isLeaf())
+                {
+                    nodeIndex = (bitmask & 1) ? binary.nodes[nodeIndex].getInternalNode().rightChildIdx : nodeIndex + 1;
+                    bitmask >>= 1;
+                    depth++;
+                }
+                binaryHeight = std::max(binaryHeight, depth);
+            }
+            EXPECT_LE(getWideTreeHeight(wide), std::max(1u, binaryHeight));
+        }
+    }
+}
+
+CPU_TEST(LightBVHSampler_PdfsSumToOne)
+{
+    // Without the cosine bounds all nodes have non-zero importance, so the selection PDFs over all triangles should sum to one.
+    LightBVHSampler::Options options;
+    options.useBoundingCone = false;
+    options.useLightingCone = false;
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> u(0.f, 1.f);
+
+    for (uint32_t triangleCount : kTriangleCounts)
+    {
+        const auto triangles = createRandomTriangles(triangleCount, triangleCount + 1);
+        for (auto width : kNodeWidths)
+        {
+            const auto data = build(triangles, width);
+            if (data.triangleIndices.empty())
+                continue;
+            LightBVHReferenceSampler sampler(data, options);
+
+            for (uint32_t i = 0; i < 16; ++i)
+            {
+                const float3 posW = float3(u(rng), u(rng), u(rng)) * 120.f - 10.f;
+                const float3 normalW = float3(0.f, 0.f, 1.f);
+
+                double sum = 0.0;
+                for (uint32_t triangleIndex = 0; triangleIndex < triangles.size(); ++triangleIndex)
+                    sum += sampler.evalTriangleSelectionPdf(posW, normalW, false, triangleIndex);
+                EXPECT_LE(std::abs(sum - 1.0), 1e-3) << fmt::format("width={} triangleCount={} sum={}", (uint32_t)width, triangleCount, sum);
+            }
+        }
+    }
+}
+
+CPU_TEST(LightBVHSampler_SampledPdfMatchesEval)
+{
+    // Use the default traversal options, which include the bounding and lighting cones.
+    LightBVHSampler::Options options;
+
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> u(0.f, 1.f);
+
+    for (uint32_t triangleCount : kTriangleCounts)
+    {
+        const auto triangles = createRandomTriangles(triangleCount, triangleCount + 2);
+        for (auto width : kNodeWidths)
+        {
+            const auto data = build(triangles, width);
+            if (data.triangleIndices.empty())
+                continue;
+            LightBVHReferenceSampler sampler(data, options);
+
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                const float3 posW = float3(u(rng), u(rng), u(rng)) * 120.f - 10.f;
+                const float3 normalW = normalize(float3(u(rng), u(rng), u(rng)) - 0.5f);
+                const bool upperHemisphere = (i & 1) != 0;
+
+                uint32_t triangleIndex;
+                float pdf;
+                if (!sampler.sampleTriangle(posW, normalW, upperHemisphere, u(rng), triangleIndex, pdf))
+                    continue;
+
+                EXPECT_GT(pdf, 0.f);
+                EXPECT_GT(triangles[triangleIndex].flux, 0.f);
+                const float evalPdf = sampler.evalTriangleSelectionPdf(posW, normalW, upperHemisphere, triangleIndex);
+                EXPECT_LE(std::abs(evalPdf - pdf), 1e-5f * pdf) << fmt::format("width={} triangleIndex={}", (uint32_t)width, triangleIndex);
+            }
+        }
+    }
+}
+
+CPU_TEST(LightBVHSampler_WideMatchesBinaryFarField)
+{
+    // Far away from the emitters, the node importance reduces to the flux scaled by an almost constant factor.
+    // The selection probability of each triangle is then the flux of its leaf over the total flux in both layouts.
+    LightBVHSampler::Options options;
+    options.useBoundingCone = false;
+    options.useLightingCone = false;
+
+    const float3 posW = float3(1e7f, 0.f, 0.f);
+    const float3 normalW = float3(-1.f, 0.f, 0.f);
+
+    for (uint32_t triangleCount : kTriangleCounts)
+    {
+        const auto triangles = createRandomTriangles(triangleCount, triangleCount + 3);
+        const auto binary = build(triangles, LightBVHBuilder::NodeWidth::Binary);
+        if (binary.triangleIndices.empty())
+            continue;
+        LightBVHReferenceSampler binarySampler(binary, options);
+
+        for (auto width : {LightBVHBuilder::NodeWidth::Wide4, LightBVHBuilder::NodeWidth::Wide8})
+        {
+            const auto wide = build(triangles, width);
+            LightBVHReferenceSampler wideSampler(wide, options);
+
+            for (uint32_t triangleIndex = 0; triangleIndex < triangles.size(); ++triangleIndex)
+            {
+                const float binaryPdf = binarySampler.evalTriangleSelectionPdf(posW, normalW, false, triangleIndex);
+                const float widePdf = wideSampler.evalTriangleSelectionPdf(posW, normalW, false, triangleIndex);
+                EXPECT_LE(std::abs(widePdf - binaryPdf), 1e-3f * binaryPdf)
+                    << fmt::format("width={} triangleIndex={} binaryPdf={} widePdf={}", (uint32_t)width, triangleIndex, binaryPdf, widePdf);
+            }
+        }
+    }
+}
+} // namespace Falcor
@@ -0,0 +1,372 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/Animation/AnimationBatch.h"
+#include "Utils/Timing/CpuTimer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+namespace Falcor
+{
+namespace
+{
+/// Generate an animation with random keyframes. The first keyframe is at a random time after the start.
+ref<Animation> createAnimation(std::mt19937& rng, NodeID nodeID, uint32_t keyframeCount)
+{
+    std::uniform_real_distribution<float> u(-1.f, 1.f);
+
+    const double duration = 10.0;
+    ref<Animation> pAnimation = Animation::create("test", nodeID, duration);
+
+    double time = 1.0 + 0.5 * (u(rng) + 1.f);
+    quatf rotation = normalize(quatf(u(rng), u(rng), u(rng), u(rng)));
+    for (uint32_t i = 0; i < keyframeCount; i++)
+    {
+        Animation::Keyframe keyframe;
+        keyframe.time = time;
+        keyframe.translation = float3(u(rng), u(rng), u(rng)) * 10.f;
+        keyframe.scaling = float3(1.5f + u(rng), 1.5f + u(rng), 1.5f + u(rng));
+        // Keep some consecutive rotations almost equal to cover the linear fallback of slerp.
+        if (i % 3 != 2) rotation = normalize(quatf(u(rng), u(rng), u(rng), u(rng)));
+        keyframe.rotation = rotation;
+        pAnimation->addKeyframe(keyframe);
+        time += (duration - 1.5) / 8.0 * (0.25 + 0.75 * 0.5 * (u(rng) + 1.f));
+    }
+    return pAnimation;
+}
+
+/// Generate animations covering all interpolation modes and pre/post-infinity behaviors.
+std::vector<ref<Animation>> createAnimations(uint32_t count, uint32_t maxKeyframeCount, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<ref<Animation>> animations;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t keyframeCount = 1 + rng() % maxKeyframeCount;
+        ref<Animation> pAnimation = createAnimation(rng, NodeID{ i }, keyframeCount);
+        pAnimation->setPreInfinityBehavior(Animation::Behavior(rng() % 4));
+        pAnimation->setPostInfinityBehavior(Animation::Behavior(rng() % 4));
+        pAnimation->setInterpolationMode(rng() % 4 == 0 ? Animation::InterpolationMode::Hermite : Animation::InterpolationMode::Linear);
+        pAnimation->setEnableWarping(rng() % 4 == 0);
+        animations.push_back(pAnimation);
+    }
+    return animations;
+}
+
+bool isNear(const float4x4& a, const float4x4& b)
+{
+    for (int r = 0; r < 4; r++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            if (!(std::abs(a[r][c] - b[r][c]) <= 1e-5f * std::max(1.f, std::abs(b[r][c])))) return false;
+        }
+    }
+    return true;
+}
+
+/// Compute global matrices by traversing the nodes in order, as parents are stored before their children.
+std::vector<float4x4> computeGlobalMatrices(const std::vector<NodeID>& parents, const std::vector<float4x4>& localMatrices)
+{
+    std::vector<float4x4> globalMatrices(localMatrices.size());
+    for (size_t i = 0; i < parents.size(); i++)
+    {
+        globalMatrices[i] = parents[i] == NodeID::Invalid() ? localMatrices[i] : mul(globalMatrices[parents[i].get()], localMatrices[i]);
+    }
+    return globalMatrices;
+}
+
+/// Generate a random forest. Each node is a root with some probability, otherwise its parent is one of the previous nodes.
+std::vector<NodeID> createSceneGraph(uint32_t nodeCount, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<NodeID> parents(nodeCount, NodeID::Invalid());
+    for (uint32_t i = 1; i < nodeCount; i++)
+    {
+        // Prefer recent nodes as parents to get deeper hierarchies.
+        if (rng() % 16 != 0) parents[i] = NodeID{ i - 1 - rng() % std::min(i, 64u) };
+    }
+    return parents;
+}
+} // namespace
+
+CPU_TEST(AnimationBatch_Evaluate)
+{
+    const uint32_t channelCount = 3000;
+    auto animations = createAnimations(channelCount, 8, 1);
+    AnimationBatch batch(animations);
+    EXPECT_EQ(batch.getChannelCount(), channelCount);
+
+    // Play forward across the keyframe range and beyond it, then backward, then jump around.
+    std::vector<double> times;
+    for (int i = -40; i <= 400; i++) times.push_back(i * 0.05);
+    for (int i = 400; i >= -40; i -= 3) times.push_back(i * 0.05);
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<double> u(-20.0, 40.0);
+    for (int i = 0; i < 100; i++) times.push_back(u(rng));
+
+    std::vector<float4x4> localMatrices(channelCount);
+    uint32_t mismatchCount = 0;
+    for (double time : times)
+    {
+        batch.evaluate(time, localMatrices);
+        for (uint32_t i = 0; i < channelCount; i++)
+        {
+            if (!isNear(localMatrices[i], animations[i]->animate(time))) mismatchCount++;
+        }
+    }
+    EXPECT_EQ(mismatchCount, 0);
+}
+
+CPU_TEST(AnimationBatch_ChangedSettings)
+{
+    // Settings changed after creating the batch are picked up by the next evaluation.
+    const uint32_t channelCount = 500;
+    auto animations = createAnimations(channelCount, 6, 3);
+    AnimationBatch batch(animations);
+
+    std::vector<float4x4> localMatrices(channelCount);
+    for (uint32_t pass = 0; pass < 4; pass++)
+    {
+        for (const auto& pAnimation : animations)
+        {
+            pAnimation->setPreInfinityBehavior(Animation::Behavior(pass));
+            pAnimation->setPostInfinityBehavior(Animation::Behavior(3 - pass));
+            pAnimation->setInterpolationMode(pass % 2 == 0 ? Animation::InterpolationMode::Hermite : Animation::InterpolationMode::Linear);
+            pAnimation->setEnableWarping(pass >= 2);
+        }
+
+        uint32_t mismatchCount = 0;
+        for (int i = -20; i <= 300; i += 7)
+        {
+            double time = i * 0.07;
+            batch.evaluate(time, localMatrices);
+            for (uint32_t j = 0; j < channelCount; j++)
+            {
+                if (!isNear(localMatrices[j], animations[j]->animate(time))) mismatchCount++;
+            }
+        }
+        EXPECT_EQ(mismatchCount, 0) << "pass " << pass;
+    }
+}
+
+CPU_TEST(AnimationBatch_SharedNodes)
+{
+    std::mt19937 rng(4);
+    std::vector<ref<Animation>> animations = {
+        createAnimation(rng, NodeID{ 0 }, 4),
+        createAnimation(rng, NodeID{ 1 }, 4),
+        createAnimation(rng, NodeID{ 0 }, 5),
+        Animation::create("empty", NodeID{ 2 }, 10.0),
+    };
+
+    // The last animation of node 0 overrides the first one, and the animation without keyframes is ignored.
+    AnimationBatch batch(animations);
+    ASSERT_EQ(batch.getChannelCount(), 2);
+    EXPECT(batch.getNodeIDs()[0] == NodeID{ 1 });
+    EXPECT(batch.getNodeIDs()[1] == NodeID{ 0 });
+
+    std::vector<float4x4> localMatrices(3, float4x4::identity());
+    batch.evaluate(3.0, localMatrices);
+    EXPECT(isNear(localMatrices[0], animations[2]->animate(3.0)));
+    EXPECT(isNear(localMatrices[1], animations[1]->animate(3.0)));
+    EXPECT(isNear(localMatrices[2], float4x4::identity()));
+}
+
+CPU_TEST(AnimationBatch_ChangedChannels)
+{
+    // The first animation has its last keyframe before 6s, the second one moves linearly over the whole duration.
+    std::mt19937 rng(5);
+    ref<Animation> pMoving = Animation::create("moving", NodeID{ 1 }, 10.0);
+    for (double time : { 0.0, 10.0 })
+    {
+        Animation::Keyframe keyframe;
+        keyframe.time = time;
+        keyframe.translation = float3((float)time);
+        pMoving->addKeyframe(keyframe);
+    }
+    std::vector<ref<Animation>> animations = { createAnimation(rng, NodeID{ 0 }, 4), pMoving };
+    animations[0]->setPostInfinityBehavior(Animation::Behavior::Constant);
+    AnimationBatch batch(animations);
+
+    // All channels change on the first evaluation, and none when evaluating the same time again.
+    std::vector<float4x4> localMatrices(2, float4x4::identity());
+    batch.evaluate(2.0, localMatrices);
+    EXPECT(batch.isChannelChanged(0));
+    EXPECT(batch.isChannelChanged(1));
+    batch.evaluate(2.0, localMatrices);
+    EXPECT(!batch.isChannelChanged(0));
+    EXPECT(!batch.isChannelChanged(1));
+
+    // A channel holding its last keyframe does not change.
+    batch.evaluate(6.0, localMatrices);
+    batch.evaluate(6.5, localMatrices);
+    EXPECT(!batch.isChannelChanged(0));
+    EXPECT(batch.isChannelChanged(1));
+}
+
+CPU_TEST(AnimationBatch_Edited)
+{
+    std::mt19937 rng(6);
+    std::vector<ref<Animation>> animations = { createAnimation(rng, NodeID{ 0 }, 4), Animation::create("empty", NodeID{ 1 }, 10.0) };
+    AnimationBatch batch(animations);
+    EXPECT(batch.isUpToDate(animations));
+    EXPECT_EQ(batch.getChannelCount(), 1);
+
+    // Changing settings does not require recreating the batch.
+    animations[0]->setInterpolationMode(Animation::InterpolationMode::Hermite);
+    EXPECT(batch.isUpToDate(animations));
+
+    // Adding keyframes, including to an animation ignored by the batch, does.
+    Animation::Keyframe keyframe;
+    keyframe.time = 5.0;
+    keyframe.translation = float3(1.f, 2.f, 3.f);
+    animations[1]->addKeyframe(keyframe);
+    EXPECT(!batch.isUpToDate(animations));
+
+    batch = AnimationBatch(animations);
+    EXPECT(batch.isUpToDate(animations));
+    ASSERT_EQ(batch.getChannelCount(), 2);
+    std::vector<float4x4> localMatrices(2, float4x4::identity());
+    batch.evaluate(5.0, localMatrices);
+    EXPECT(isNear(localMatrices[1], animations[1]->animate(5.0)));
+
+    // So do changing node IDs and adding animations.
+    animations[1]->setNodeID(NodeID{ 0 });
+    EXPECT(!batch.isUpToDate(animations));
+    batch = AnimationBatch(animations);
+    animations.push_back(createAnimation(rng, NodeID{ 1 }, 2));
+    EXPECT(!batch.isUpToDate(animations));
+}
+
+CPU_TEST(SceneGraphLevels_Update)
+{
+    const uint32_t nodeCount = 20000;
+    std::vector<NodeID> parents = createSceneGraph(nodeCount, 5);
+
+    SceneGraphLevels levels(parents);
+    const auto& nodes = levels.getNodes();
+    const auto& offsets = levels.getLevelOffsets();
+    ASSERT_EQ(nodes.size(), nodeCount);
+    ASSERT_EQ(offsets.size(), levels.getLevelCount() + 1);
+    EXPECT_EQ(offsets.back(), nodeCount);
+
+    // Roots are on the first level, and the parent of each node is on the previous level.
+    std::vector<uint32_t> nodeLevels(nodeCount, ~0u);
+    for (uint32_t level = 0; level < levels.getLevelCount(); level++)
+    {
+        for (uint32_t i = offsets[level]; i < offsets[level + 1]; i++) nodeLevels[nodes[i]] = level;
+    }
+    uint32_t invalidCount = 0;
+    for (uint32_t i = 0; i < nodeCount; i++)
+    {
+        uint32_t expectedLevel = parents[i] == NodeID::Invalid() ? 0 : nodeLevels[parents[i].get()] + 1;
+        if (nodeLevels[i] != expectedLevel) invalidCount++;
+    }
+    EXPECT_EQ(invalidCount, 0);
+    EXPECT_GT(levels.getLevelCount(), 2);
+
+    // Update global matrices level by level.
+    std::mt19937 rng(6);
+    std::uniform_real_distribution<float> u(-1.f, 1.f);
+    std::vector<float4x4> localMatrices(nodeCount);
+    for (auto& m : localMatrices)
+    {
+        m = math::matrixFromTranslation(float3(u(rng), u(rng), u(rng)));
+        m = mul(m, float4x4(math::matrixFromQuat(normalize(quatf(u(rng), u(rng), u(rng), u(rng))))));
+    }
+
+    std::vector<float4x4> globalMatrices(nodeCount);
+    levels.forEachNode([&](uint32_t i)
+    {
+        globalMatrices[i] = parents[i] == NodeID::Invalid() ? localMatrices[i] : mul(globalMatrices[parents[i].get()], localMatrices[i]);
+    });
+
+    auto expected = computeGlobalMatrices(parents, localMatrices);
+    uint32_t mismatchCount = 0;
+    for (uint32_t i = 0; i < nodeCount; i++)
+    {
+        if (std::memcmp(&globalMatrices[i], &expected[i], sizeof(float4x4)) != 0) mismatchCount++;
+    }
+    EXPECT_EQ(mismatchCount, 0);
+
+    // An empty scene graph has no levels.
+    EXPECT_EQ(SceneGraphLevels(std::vector<NodeID>()).getLevelCount(), 0);
+}
+
+CPU_TEST(AnimationBatch_Benchmark, TAGS("benchmark"))
+{
+    const uint32_t channelCount = 100000;
+    const uint32_t frameCount = 60;
+    auto animations = createAnimations(channelCount, 16, 7);
+    for (const auto& pAnimation : animations)
+    {
+        pAnimation->setInterpolationMode(Animation::InterpolationMode::Linear);
+        pAnimation->setPreInfinityBehavior(Animation::Behavior::Cycle);
+        pAnimation->setPostInfinityBehavior(Animation::Behavior::Cycle);
+    }
+    AnimationBatch batch(animations);
+
+    std::vector<float4x4> localMatrices(channelCount);
+    std::vector<float4x4> batchMatrices(channelCount);
+
+    auto t0 = CpuTimer::getCurrentTimePoint();
+    for (uint32_t frame = 0; frame < frameCount; frame++)
+    {
+        double time = frame / 30.0;
+        for (uint32_t i = 0; i < channelCount; i++) localMatrices[animations[i]->getNodeID().get()] = animations[i]->animate(time);
+    }
+    auto t1 = CpuTimer::getCurrentTimePoint();
+    for (uint32_t frame = 0; frame < frameCount; frame++)
+    {
+        double time = frame / 30.0;
+        batch.evaluate(time, batchMatrices);
+    }
+    auto t2 = CpuTimer::getCurrentTimePoint();
+
+    uint32_t mismatchCount = 0;
+    for (uint32_t i = 0; i < channelCount; i++)
+    {
+        if (!isNear(batchMatrices[i], localMatrices[i])) mismatchCount++;
+    }
+    EXPECT_EQ(mismatchCount, 0);
+
+    double scalarTime = CpuTimer::calcDuration(t0, t1) / frameCount;
+    double batchTime = CpuTimer::calcDuration(t1, t2) / frameCount;
+    logInfo(
+        "Animation of {} channels: per animation {:.2f} ms/frame, batched {:.2f} ms/frame ({:.1f}x)",
+        channelCount,
+        scalarTime,
+        batchTime,
+        scalarTime / batchTime
+    );
+}
+} // namespace Falcor
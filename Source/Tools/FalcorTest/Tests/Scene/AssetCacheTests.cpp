@@ -0,0 +1,265 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/AssetCache.h"
+#include "Scene/SceneBuilder.h"
+#include "Scene/Material/StandardMaterial.h"
+#include "Core/Platform/OS.h"
+
+#include <filesystem>
+#include <fstream>
+
+namespace Falcor
+{
+namespace
+{
+/// Removes the directory when going out of scope.
+struct TempDirectory
+{
+    std::filesystem::path path = getTempFilePath();
+    TempDirectory() { std::filesystem::create_directories(path); }
+    ~TempDirectory() { std::filesystem::remove_all(path); }
+};
+
+AssetCache::Key makeKey(uint8_t value)
+{
+    AssetCache::Key key = {};
+    key[0] = value;
+    return key;
+}
+
+/// Write an entry holding a single section with 1000 copies of the given value.
+void writeEntry(AssetCache& cache, const AssetCache::Key& key, uint32_t value)
+{
+    std::vector<uint32_t> data(1000, value);
+    cache.writeEntry(key, [&](SceneCacheFile::Writer& writer) { writer.addSection("Data", data); });
+}
+
+std::optional<uint32_t> readEntry(const AssetCache& cache, const AssetCache::Key& key)
+{
+    auto pEntry = cache.openEntry(key);
+    if (!pEntry) return std::nullopt;
+    std::vector<uint32_t> data;
+    pEntry->readSection("Data", data);
+    return data.empty() ? std::nullopt : std::make_optional(data[0]);
+}
+
+std::filesystem::path findEntryFile(const AssetCache& cache, const AssetCache::Key& key)
+{
+    for (const auto& it : std::filesystem::recursive_directory_iterator(cache.getDirectory() / "entries"))
+    {
+        if (it.path().filename() == AssetCache::toString(key)) return it.path();
+    }
+    return {};
+}
+
+/// Synthetic quad mesh with buffers owned by the struct.
+struct TestMesh
+{
+    std::vector<uint32_t> indices = {0, 1, 2, 0, 2, 3};
+    std::vector<float3> positions = {float3(0, 0, 0), float3(1, 0, 0), float3(1, 1, 0), float3(0, 1, 0)};
+    std::vector<float3> normals = std::vector<float3>(4, float3(0, 0, 1));
+    std::vector<float2> texCrds = {float2(0, 0), float2(1, 0), float2(1, 1), float2(0, 1)};
+
+    SceneBuilder::Mesh getMesh(const std::string& name = "Quad") const
+    {
+        SceneBuilder::Mesh mesh;
+        mesh.name = name;
+        mesh.faceCount = 2;
+        mesh.vertexCount = (uint32_t)positions.size();
+        mesh.indexCount = (uint32_t)indices.size();
+        mesh.pIndices = indices.data();
+        mesh.topology = Vao::Topology::TriangleList;
+        mesh.positions = {positions.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex};
+        mesh.normals = {normals.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex};
+        mesh.texCrds = {texCrds.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex};
+        return mesh;
+    }
+};
+} // namespace
+
+CPU_TEST(AssetCache_Entries)
+{
+    TempDirectory dir;
+    AssetCache cache(dir.path);
+
+    EXPECT(!cache.hasEntry(makeKey(1)));
+    EXPECT(cache.openEntry(makeKey(1)) == nullptr);
+
+    writeEntry(cache, makeKey(1), 10);
+    writeEntry(cache, makeKey(2), 20);
+    EXPECT(cache.hasEntry(makeKey(1)));
+    EXPECT(readEntry(cache, makeKey(1)) == 10u);
+    EXPECT(readEntry(cache, makeKey(2)) == 20u);
+
+    // Entries are replaced when written again.
+    writeEntry(cache, makeKey(1), 11);
+    EXPECT(readEntry(cache, makeKey(1)) == 11u);
+
+    cache.removeEntry(makeKey(1));
+    EXPECT(!cache.hasEntry(makeKey(1)));
+    EXPECT_EQ(cache.getStats().entryCount, 1);
+
+    // Corrupt entries are treated as missing.
+    {
+        std::ofstream fs(findEntryFile(cache, makeKey(2)), std::ios_base::binary | std::ios_base::trunc);
+        fs << "corrupt";
+    }
+    EXPECT(cache.openEntry(makeKey(2)) == nullptr);
+
+    // A failed write does not leave an entry behind.
+    EXPECT_THROW(cache.writeEntry(makeKey(3), [](SceneCacheFile::Writer&) { FALCOR_THROW("Processing failed"); }));
+    EXPECT(!cache.hasEntry(makeKey(3)));
+}
+
+CPU_TEST(AssetCache_Manifests)
+{
+    TempDirectory dir;
+    AssetCache cache(dir.path);
+
+    EXPECT(!cache.readManifest(makeKey(100)).has_value());
+
+    std::vector<AssetCache::Key> entries = {makeKey(1), makeKey(2), makeKey(3)};
+    cache.writeManifest(makeKey(100), entries);
+    auto manifest = cache.readManifest(makeKey(100));
+    ASSERT(manifest.has_value());
+    EXPECT(*manifest == entries);
+    EXPECT_EQ(cache.getStats().manifestCount, 1);
+
+    cache.removeManifest(makeKey(100));
+    EXPECT(!cache.readManifest(makeKey(100)).has_value());
+}
+
+CPU_TEST(AssetCache_GarbageCollection)
+{
+    TempDirectory dir;
+    AssetCache cache(dir.path);
+
+    for (uint8_t i = 1; i <= 3; ++i) writeEntry(cache, makeKey(i), i);
+    cache.writeManifest(makeKey(100), {makeKey(1), makeKey(2)});
+    cache.writeManifest(makeKey(101), {makeKey(2)});
+
+    // Only the unreferenced entry is removed.
+    EXPECT_GT(cache.collectGarbage(), 0);
+    EXPECT(cache.hasEntry(makeKey(1)));
+    EXPECT(cache.hasEntry(makeKey(2)));
+    EXPECT(!cache.hasEntry(makeKey(3)));
+
+    // Entries shared between scenes are kept as long as one scene references them.
+    cache.removeManifest(makeKey(100));
+    cache.collectGarbage();
+    EXPECT(!cache.hasEntry(makeKey(1)));
+    EXPECT(cache.hasEntry(makeKey(2)));
+
+    // Invalid manifests are removed and do not keep entries alive.
+    {
+        std::ofstream fs(dir.path / "manifests" / AssetCache::toString(makeKey(101)), std::ios_base::binary | std::ios_base::trunc);
+        fs << "corrupt";
+    }
+    cache.collectGarbage();
+    EXPECT(!cache.hasEntry(makeKey(2)));
+    EXPECT_EQ(cache.getStats().manifestCount, 0);
+    EXPECT_EQ(cache.getStats().entryCount, 0);
+}
+
+CPU_TEST(AssetCache_SizeBudget)
+{
+    TempDirectory dir;
+
+    uint64_t entrySize = 0;
+    {
+        AssetCache cache(dir.path);
+        for (uint8_t i = 1; i <= 4; ++i) writeEntry(cache, makeKey(i), i);
+        cache.writeManifest(makeKey(100), {makeKey(1), makeKey(2), makeKey(3)});
+        entrySize = cache.getStats().totalSize / 4;
+
+        // Set the last use times explicitly: entry 1 is the least recently used.
+        auto now = std::filesystem::file_time_type::clock::now();
+        for (uint8_t i = 1; i <= 4; ++i) std::filesystem::last_write_time(findEntryFile(cache, makeKey(i)), now - std::chrono::minutes(10 - i));
+    }
+
+    AssetCache::Options options;
+    options.sizeBudget = 2 * entrySize;
+    AssetCache cache(dir.path, options);
+
+    // The unreferenced entry is evicted first, then the least recently used.
+    EXPECT_EQ(cache.enforceSizeBudget(), 2 * entrySize);
+    EXPECT(!cache.hasEntry(makeKey(4)));
+    EXPECT(!cache.hasEntry(makeKey(1)));
+    EXPECT(cache.hasEntry(makeKey(2)));
+    EXPECT(cache.hasEntry(makeKey(3)));
+    EXPECT_LE(cache.getStats().totalSize, options.sizeBudget);
+
+    // Nothing is evicted when within budget.
+    EXPECT_EQ(cache.enforceSizeBudget(), 0);
+}
+
+CPU_TEST(AssetCache_MeshKeys)
+{
+    TestMesh a;
+    TestMesh b;
+    const auto flags = SceneBuilder::Flags::Default;
+    const auto key = SceneBuilder::computeMeshCacheKey(a.getMesh(), flags);
+
+    // Keys depend on the mesh data, not on the buffer addresses or the name.
+    EXPECT(SceneBuilder::computeMeshCacheKey(b.getMesh("Other"), flags) == key);
+
+    // Editing the data changes the key.
+    b.positions[2].z = 0.5f;
+    EXPECT(SceneBuilder::computeMeshCacheKey(b.getMesh(), flags) != key);
+    b = TestMesh();
+    b.indices[5] = 1;
+    EXPECT(SceneBuilder::computeMeshCacheKey(b.getMesh(), flags) != key);
+
+    // Attributes with a different frequency change the key.
+    auto mesh = a.getMesh();
+    mesh.texCrds = {a.texCrds.data(), SceneBuilder::Mesh::AttributeFrequency::Constant};
+    EXPECT(SceneBuilder::computeMeshCacheKey(mesh, flags) != key);
+
+    // Only build flags that affect mesh processing change the key.
+    EXPECT(SceneBuilder::computeMeshCacheKey(a.getMesh(), SceneBuilder::Flags::Force32BitIndices) != key);
+    EXPECT(SceneBuilder::computeMeshCacheKey(a.getMesh(), SceneBuilder::Flags::NonIndexedVertices) != key);
+    EXPECT(SceneBuilder::computeMeshCacheKey(a.getMesh(), SceneBuilder::Flags::DontMergeMaterials | SceneBuilder::Flags::UseCache) == key);
+}
+
+GPU_TEST(AssetCache_MeshKeysTextureTransform)
+{
+    // The texture transform is baked into the texture coordinates, so it changes the key.
+    TestMesh a;
+    auto mesh = a.getMesh();
+    mesh.pMaterial = StandardMaterial::create(ctx.getDevice(), "testMaterial");
+    const auto flags = SceneBuilder::Flags::Default;
+    const auto key = SceneBuilder::computeMeshCacheKey(mesh, flags);
+    EXPECT(SceneBuilder::computeMeshCacheKey(a.getMesh(), flags) == key);
+
+    Transform texTransform;
+    texTransform.setScaling(float3(2.f, 2.f, 1.f));
+    mesh.pMaterial->setTextureTransform(texTransform);
+    EXPECT(SceneBuilder::computeMeshCacheKey(mesh, flags) != key);
+}
+} // namespace Falcor
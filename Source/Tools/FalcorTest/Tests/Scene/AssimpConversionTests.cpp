@@ -0,0 +1,383 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/AssimpConversion.h"
+#include "Utils/StringUtils.h"
+#include "Core/Platform/OS.h"
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <nlohmann/json.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+const uint32_t kMeshCount = 64;
+const uint32_t kMaterialCount = 6;
+const uint32_t kSkinnedMesh = 3;
+const NodeID::IntType kJointNodeID = 100;
+
+const char* kMaterialNames[kMaterialCount] = {"Plain", "", "Painted.doubleSided", "Glass.unknownFlag", "Metal", "Textured"};
+
+using json = nlohmann::json;
+
+/// Builds the binary buffer and accessors of a glTF file.
+struct GltfBuffer
+{
+    std::vector<uint8_t> data;
+    json bufferViews = json::array();
+    json accessors = json::array();
+
+    template<typename T>
+    uint32_t addAccessor(const std::vector<T>& values, uint32_t componentType, const char* type, uint32_t count)
+    {
+        json view = {{"buffer", 0}, {"byteOffset", data.size()}, {"byteLength", values.size() * sizeof(T)}};
+        const uint8_t* pValues = reinterpret_cast<const uint8_t*>(values.data());
+        data.insert(data.end(), pValues, pValues + values.size() * sizeof(T));
+        while (data.size() % 4 != 0)
+            data.push_back(0);
+
+        bufferViews.push_back(view);
+        accessors.push_back({{"bufferView", bufferViews.size() - 1}, {"componentType", componentType}, {"type", type}, {"count", count}});
+        return (uint32_t)accessors.size() - 1;
+    }
+};
+
+const uint32_t kFloat = 5126;
+const uint32_t kUnsignedShort = 5123;
+const uint32_t kUnsignedInt = 5125;
+
+/**
+ * Writes a glTF file with grid meshes of varying sizes, some of them with tangents, materials with
+ * various parameters and flags in their names, and a mesh skinned to two joints.
+ */
+std::filesystem::path writeGltf()
+{
+    GltfBuffer buffer;
+    json meshes = json::array();
+    json nodes = json::array();
+    json sceneNodes = json::array();
+
+    for (uint32_t m = 0; m < kMeshCount; ++m)
+    {
+        const uint32_t width = 2 + m % 7;
+        const uint32_t height = 2 + m % 5;
+        const uint32_t vertexCount = width * height;
+
+        std::vector<float> positions, normals, texCrds, tangents, weights;
+        std::vector<uint16_t> joints;
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                positions.insert(positions.end(), {float(x), float(y), 0.1f * m});
+                normals.insert(normals.end(), {0.f, 0.f, 1.f});
+                texCrds.insert(texCrds.end(), {float(x) / (width - 1), float(y) / (height - 1)});
+                tangents.insert(tangents.end(), {1.f, 0.f, 0.f, (x + y) % 2 ? 1.f : -1.f});
+                float t = float(x + 1) / (width + 1);
+                weights.insert(weights.end(), {t, 1.f - t, 0.f, 0.f});
+                joints.insert(joints.end(), {0, 1, 0, 0});
+            }
+        }
+
+        std::vector<uint32_t> indices;
+        for (uint32_t y = 0; y + 1 < height; ++y)
+        {
+            for (uint32_t x = 0; x + 1 < width; ++x)
+            {
+                uint32_t i = y * width + x;
+                indices.insert(indices.end(), {i, i + 1, i + width, i + 1, i + width + 1, i + width});
+            }
+        }
+
+        json attributes;
+        attributes["POSITION"] = buffer.addAccessor(positions, kFloat, "VEC3", vertexCount);
+        buffer.accessors.back()["min"] = {0.f, 0.f, 0.1f * m};
+        buffer.accessors.back()["max"] = {float(width - 1), float(height - 1), 0.1f * m};
+        attributes["NORMAL"] = buffer.addAccessor(normals, kFloat, "VEC3", vertexCount);
+        attributes["TEXCOORD_0"] = buffer.addAccessor(texCrds, kFloat, "VEC2", vertexCount);
+        if (m % 2 == 1)
+            attributes["TANGENT"] = buffer.addAccessor(tangents, kFloat, "VEC4", vertexCount);
+        if (m == kSkinnedMesh)
+        {
+            attributes["JOINTS_0"] = buffer.addAccessor(joints, kUnsignedShort, "VEC4", vertexCount);
+            attributes["WEIGHTS_0"] = buffer.addAccessor(weights, kFloat, "VEC4", vertexCount);
+        }
+
+        json primitive = {
+            {"attributes", attributes},
+            {"indices", buffer.addAccessor(indices, kUnsignedInt, "SCALAR", (uint32_t)indices.size())},
+            {"material", m % kMaterialCount},
+        };
+        meshes.push_back({{"name", fmt::format("mesh{}", m)}, {"primitives", {primitive}}});
+
+        json node = {{"name", fmt::format("node{}", m)}, {"mesh", m}};
+        if (m == kSkinnedMesh)
+            node["skin"] = 0;
+        nodes.push_back(node);
+        sceneNodes.push_back(m);
+    }
+
+    // Two joints with identity inverse bind matrices.
+    std::vector<float> inverseBindMatrices;
+    for (uint32_t j = 0; j < 2; ++j)
+        inverseBindMatrices.insert(inverseBindMatrices.end(), {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1});
+    nodes.push_back({{"name", "joint0"}, {"children", {kMeshCount + 1}}});
+    nodes.push_back({{"name", "joint1"}, {"translation", {0.f, 1.f, 0.f}}});
+    sceneNodes.push_back(kMeshCount);
+    json skin = {
+        {"joints", {kMeshCount, kMeshCount + 1}},
+        {"inverseBindMatrices", buffer.addAccessor(inverseBindMatrices, kFloat, "MAT4", 2)},
+    };
+
+    json materials = json::array();
+    for (uint32_t i = 0; i < kMaterialCount; ++i)
+    {
+        json pbr = {{"baseColorFactor", {0.1f * i, 0.5f, 0.25f, 1.f}}, {"metallicFactor", 0.125f * i}, {"roughnessFactor", 1.f - 0.125f * i}};
+        if (i == kMaterialCount - 1)
+            pbr["baseColorTexture"] = {{"index", 0}};
+        json material = {{"pbrMetallicRoughness", pbr}, {"emissiveFactor", {0.f, 0.5f * (i % 2), 0.f}}};
+        if (kMaterialNames[i][0] != '\0')
+            material["name"] = kMaterialNames[i];
+        materials.push_back(material);
+    }
+
+    json gltf = {
+        {"asset", {{"version", "2.0"}}},
+        {"scene", 0},
+        {"scenes", {{{"nodes", sceneNodes}}}},
+        {"nodes", nodes},
+        {"meshes", meshes},
+        {"skins", {skin}},
+        {"materials", materials},
+        {"textures", {{{"source", 0}}}},
+        {"images", {{{"uri", "base%20color.png"}}}},
+        {"accessors", buffer.accessors},
+        {"bufferViews", buffer.bufferViews},
+        {"buffers",
+         {{{"byteLength", buffer.data.size()}, {"uri", "data:application/octet-stream;base64," + encodeBase64(buffer.data)}}}},
+    };
+
+    std::filesystem::path path = getTempFilePath();
+    path += ".gltf";
+    std::ofstream(path) << gltf.dump();
+    return path;
+}
+
+NodeID lookupJoint(const std::string& name)
+{
+    return NodeID(kJointNodeID + (name == "joint1" ? 1 : 0));
+}
+
+template<typename T>
+bool equalBytes(const std::vector<T>& a, const std::vector<T>& b)
+{
+    return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+template<typename T>
+bool equalBytes(const std::optional<T>& a, const std::optional<T>& b)
+{
+    return a.has_value() == b.has_value() && (!a || std::memcmp(&*a, &*b, sizeof(T)) == 0);
+}
+
+void checkEqual(CPUUnitTestContext& ctx, const AssimpMeshData& a, const AssimpMeshData& b)
+{
+    EXPECT(equalBytes(a.indices, b.indices));
+    EXPECT(equalBytes(a.texCrds, b.texCrds));
+    EXPECT(equalBytes(a.tangents, b.tangents));
+    EXPECT(equalBytes(a.boneIDs, b.boneIDs));
+    EXPECT(equalBytes(a.boneWeights, b.boneWeights));
+    EXPECT(a.warnings == b.warnings);
+}
+
+void checkEqual(CPUUnitTestContext& ctx, const AssimpMaterialData& a, const AssimpMaterialData& b)
+{
+    EXPECT_EQ(a.name, b.name);
+    EXPECT(a.textures == b.textures);
+    EXPECT(equalBytes(a.opacity, b.opacity));
+    EXPECT(equalBytes(a.shininess, b.shininess));
+    EXPECT(equalBytes(a.ior, b.ior));
+    EXPECT(equalBytes(a.diffuseColor, b.diffuseColor));
+    EXPECT(equalBytes(a.specularColor, b.specularColor));
+    EXPECT(equalBytes(a.emissiveColor, b.emissiveColor));
+    EXPECT(equalBytes(a.doubleSided, b.doubleSided));
+    EXPECT(equalBytes(a.baseColor, b.baseColor));
+    EXPECT(equalBytes(a.metallic, b.metallic));
+    EXPECT(equalBytes(a.roughness, b.roughness));
+    EXPECT(a.warnings == b.warnings);
+}
+} // namespace
+
+CPU_TEST(AssimpConversion_ParallelMatchesSerial)
+{
+    std::filesystem::path path = writeGltf();
+    Assimp::Importer importer;
+    const aiScene* pScene = importer.ReadFile(path.string().c_str(), 0);
+    std::filesystem::remove(path);
+    ASSERT(pScene != nullptr) << importer.GetErrorString();
+    ASSERT_EQ(pScene->mNumMeshes, kMeshCount);
+    ASSERT(pScene->mNumMaterials >= kMaterialCount);
+
+    // Convert in reverse order, skipping a mesh, to check that results are stored by position.
+    std::vector<uint32_t> meshIndices;
+    for (uint32_t i = kMeshCount; i-- > 0;)
+    {
+        if (i != 10)
+            meshIndices.push_back(i);
+    }
+
+    AssimpConversionOptions parallelOptions;
+    parallelOptions.importMode = AssimpImportMode::GLTF2;
+    parallelOptions.loadTangents = true;
+    AssimpConversionOptions serialOptions = parallelOptions;
+    serialOptions.useParallelConversion = false;
+
+    std::vector<AssimpMeshData> parallelMeshes = convertAssimpMeshes(pScene, meshIndices, lookupJoint, parallelOptions);
+    std::vector<AssimpMeshData> serialMeshes = convertAssimpMeshes(pScene, meshIndices, lookupJoint, serialOptions);
+    ASSERT_EQ(parallelMeshes.size(), meshIndices.size());
+    ASSERT_EQ(serialMeshes.size(), meshIndices.size());
+    for (size_t i = 0; i < meshIndices.size(); ++i)
+        checkEqual(ctx, parallelMeshes[i], serialMeshes[i]);
+
+    const std::filesystem::path searchPath = path.parent_path();
+    std::vector<AssimpMaterialData> parallelMaterials = convertAssimpMaterials(pScene, searchPath, parallelOptions);
+    std::vector<AssimpMaterialData> serialMaterials = convertAssimpMaterials(pScene, searchPath, serialOptions);
+    ASSERT_EQ(parallelMaterials.size(), pScene->mNumMaterials);
+    ASSERT_EQ(serialMaterials.size(), pScene->mNumMaterials);
+    for (size_t i = 0; i < parallelMaterials.size(); ++i)
+        checkEqual(ctx, parallelMaterials[i], serialMaterials[i]);
+}
+
+CPU_TEST(AssimpConversion_Gltf)
+{
+    std::filesystem::path path = writeGltf();
+    Assimp::Importer importer;
+    const aiScene* pScene = importer.ReadFile(path.string().c_str(), 0);
+    std::filesystem::remove(path);
+    ASSERT(pScene != nullptr) << importer.GetErrorString();
+    ASSERT_EQ(pScene->mNumMeshes, kMeshCount);
+
+    AssimpConversionOptions options;
+    options.importMode = AssimpImportMode::GLTF2;
+    options.loadTangents = true;
+
+    std::vector<uint32_t> meshIndices(kMeshCount);
+    for (uint32_t i = 0; i < kMeshCount; ++i)
+        meshIndices[i] = i;
+    std::vector<AssimpMeshData> meshes = convertAssimpMeshes(pScene, meshIndices, lookupJoint, options);
+    ASSERT_EQ(meshes.size(), kMeshCount);
+
+    for (uint32_t m = 0; m < kMeshCount; ++m)
+    {
+        const aiMesh* pAiMesh = pScene->mMeshes[m];
+        const AssimpMeshData& mesh = meshes[m];
+        const uint32_t triangleCount = (1 + m % 7) * (1 + m % 5) * 2;
+
+        ASSERT_EQ(mesh.indices.size(), triangleCount * 3) << "mesh " << m;
+        ASSERT_EQ(pAiMesh->mNumFaces, triangleCount) << "mesh " << m;
+        for (uint32_t i = 0; i < triangleCount * 3; ++i)
+            EXPECT_EQ(mesh.indices[i], pAiMesh->mFaces[i / 3].mIndices[i % 3]) << "mesh " << m;
+
+        ASSERT_EQ(mesh.texCrds.size(), pAiMesh->mNumVertices) << "mesh " << m;
+        for (uint32_t i = 0; i < pAiMesh->mNumVertices; ++i)
+        {
+            EXPECT_EQ(mesh.texCrds[i].x, pAiMesh->mTextureCoords[0][i].x) << "mesh " << m;
+            EXPECT_EQ(mesh.texCrds[i].y, pAiMesh->mTextureCoords[0][i].y) << "mesh " << m;
+        }
+
+        // Tangents are only written for odd meshes. The sign alternates between vertices.
+        EXPECT_EQ(mesh.tangents.size(), m % 2 == 1 ? pAiMesh->mNumVertices : 0) << "mesh " << m;
+        for (const float4& tangent : mesh.tangents)
+        {
+            EXPECT_LE(std::abs(tangent.x - 1.f), 1e-6f) << "mesh " << m;
+            EXPECT(tangent.w == 1.f || tangent.w == -1.f) << "mesh " << m;
+        }
+
+        if (m == kSkinnedMesh)
+        {
+            ASSERT_EQ(mesh.boneIDs.size(), pAiMesh->mNumVertices);
+            ASSERT_EQ(mesh.boneWeights.size(), pAiMesh->mNumVertices);
+            for (uint32_t i = 0; i < pAiMesh->mNumVertices; ++i)
+            {
+                const uint4& ids = mesh.boneIDs[i];
+                const float4& weights = mesh.boneWeights[i];
+                EXPECT(ids.x == kJointNodeID || ids.x == kJointNodeID + 1) << "vertex " << i;
+                EXPECT(ids.y == kJointNodeID || ids.y == kJointNodeID + 1) << "vertex " << i;
+                EXPECT_EQ(ids.z, NodeID::kInvalidID) << "vertex " << i;
+                EXPECT_LE(std::abs(weights.x + weights.y - 1.f), 1e-5f) << "vertex " << i;
+            }
+        }
+        else
+        {
+            EXPECT(mesh.boneIDs.empty()) << "mesh " << m;
+        }
+        EXPECT(mesh.warnings.empty()) << "mesh " << m;
+    }
+
+    const std::filesystem::path searchPath = path.parent_path();
+    std::vector<AssimpMaterialData> materials = convertAssimpMaterials(pScene, searchPath, options);
+    ASSERT(materials.size() >= kMaterialCount);
+
+    for (uint32_t i = 0; i < kMaterialCount; ++i)
+    {
+        const AssimpMaterialData& material = materials[i];
+        ASSERT(material.baseColor.has_value()) << "material " << i;
+        EXPECT_LE(std::abs(material.baseColor->x - 0.1f * i), 1e-6f) << "material " << i;
+        ASSERT(material.metallic.has_value()) << "material " << i;
+        EXPECT_EQ(*material.metallic, 0.125f * i) << "material " << i;
+        ASSERT(material.roughness.has_value()) << "material " << i;
+        EXPECT_EQ(*material.roughness, 1.f - 0.125f * i) << "material " << i;
+        ASSERT(material.emissiveColor.has_value()) << "material " << i;
+        EXPECT_EQ(material.emissiveColor->y, 0.5f * (i % 2)) << "material " << i;
+        EXPECT_EQ(material.doubleSided.value_or(false), i == 2) << "material " << i;
+    }
+
+    EXPECT_EQ(materials[0].name, "Plain");
+    EXPECT(materials[0].warnings.empty());
+    EXPECT_EQ(materials[1].name, "unnamed");
+    EXPECT_EQ(materials[1].warnings.size(), 1);
+    EXPECT_EQ(materials[3].warnings.size(), 1);
+    EXPECT(materials[3].warnings[0].find("unknownFlag") != std::string::npos);
+
+    // The texture path is URI decoded and relative to the search path. No texture is loaded.
+    ASSERT_EQ(materials[5].textures.size(), 1);
+    EXPECT(materials[5].textures[0].first == Material::TextureSlot::BaseColor);
+    EXPECT(materials[5].textures[0].second == searchPath / "base color.png");
+    for (uint32_t i = 0; i < kMaterialCount - 1; ++i)
+        EXPECT(materials[i].textures.empty()) << "material " << i;
+}
+} // namespace Falcor
@@ -0,0 +1,510 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/CPUBVH.h"
+#include "Scene/TriangleMesh.h"
+#include "Utils/Timing/CpuTimer.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cstring>
+#include <filesystem>
+#include <random>
+
+namespace Falcor
+{
+namespace
+{
+/// Scene data together with the world-space triangles for brute force reference queries.
+struct TestScene
+{
+    Scene::SceneData sceneData;
+    std::vector<float3> positions; ///< Three world-space vertices per triangle.
+    std::vector<uint32_t> instanceIDs;
+    std::vector<uint32_t> primitiveIndices;
+    std::vector<float4x4> globalMatrices;
+};
+
+NodeID addNode(TestScene& scene, const float4x4& transform, NodeID parent = NodeID::Invalid())
+{
+    scene.sceneData.sceneGraph.emplace_back("Node", parent, transform, float4x4::identity(), float4x4::identity());
+    scene.globalMatrices.push_back(parent.isValid() ? mul(scene.globalMatrices[parent.get()], transform) : transform);
+    return NodeID(scene.sceneData.sceneGraph.size() - 1);
+}
+
+uint32_t addMesh(TestScene& scene, const std::vector<float3>& positions, const std::vector<uint32_t>& indices, bool use16BitIndices)
+{
+    auto& sceneData = scene.sceneData;
+    MeshDesc mesh = {};
+    mesh.vbOffset = (uint32_t)sceneData.meshStaticData.size();
+    mesh.ibOffset = (uint32_t)sceneData.meshIndexData.size();
+    mesh.vertexCount = (uint32_t)positions.size();
+    mesh.indexCount = (uint32_t)indices.size();
+    mesh.flags = use16BitIndices ? (uint32_t)MeshFlags::Use16BitIndices : 0;
+
+    for (const float3& position : positions)
+    {
+        PackedStaticVertexData vertex = {};
+        vertex.position = position;
+        sceneData.meshStaticData.push_back(vertex);
+    }
+
+    if (use16BitIndices)
+    {
+        for (size_t i = 0; i < indices.size(); i += 2)
+        {
+            const uint32_t hi = i + 1 < indices.size() ? indices[i + 1] : 0;
+            sceneData.meshIndexData.push_back(indices[i] | (hi << 16));
+        }
+    }
+    else
+    {
+        sceneData.meshIndexData.insert(sceneData.meshIndexData.end(), indices.begin(), indices.end());
+    }
+
+    sceneData.meshDesc.push_back(mesh);
+    return (uint32_t)sceneData.meshDesc.size() - 1;
+}
+
+void addInstance(TestScene& scene, uint32_t meshID, NodeID nodeID)
+{
+    auto& sceneData = scene.sceneData;
+    const MeshDesc& mesh = sceneData.meshDesc[meshID];
+    const uint32_t instanceID = (uint32_t)sceneData.meshInstanceData.size();
+
+    GeometryInstanceData instance(GeometryType::TriangleMesh);
+    instance.globalMatrixID = nodeID.get();
+    instance.materialID = 0;
+    instance.geometryID = meshID;
+    instance.vbOffset = mesh.vbOffset;
+    instance.ibOffset = mesh.ibOffset;
+    instance.instanceIndex = instanceID;
+    instance.geometryIndex = 0;
+    if (mesh.use16BitIndices())
+        instance.flags |= (uint32_t)GeometryInstanceFlags::Use16BitIndices;
+    sceneData.meshInstanceData.push_back(instance);
+
+    // Record the world-space triangles.
+    const float4x4& transform = scene.globalMatrices[nodeID.get()];
+    const uint32_t* pIndices32 = sceneData.meshIndexData.data() + mesh.ibOffset;
+    const uint16_t* pIndices16 = reinterpret_cast<const uint16_t*>(pIndices32);
+    for (uint32_t primitiveIndex = 0; primitiveIndex < mesh.getTriangleCount(); ++primitiveIndex)
+    {
+        for (uint32_t j = 0; j < 3; ++j)
+        {
+            const uint32_t i = primitiveIndex * 3 + j;
+            const uint32_t index = !mesh.useVertexIndices() ? i : mesh.use16BitIndices() ? pIndices16[i] : pIndices32[i];
+            scene.positions.push_back(transformPoint(transform, sceneData.meshStaticData[mesh.vbOffset + index].position));
+        }
+        scene.instanceIDs.push_back(instanceID);
+        scene.primitiveIndices.push_back(primitiveIndex);
+    }
+}
+
+/// Create a scene with indexed 32-bit, indexed 16-bit and non-indexed meshes, and a small scene graph.
+TestScene createTestScene(uint32_t triangleCount, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u(0.f, 1.f);
+    auto randomFloat3 = [&]() { return float3(u(rng), u(rng), u(rng)); };
+
+    auto createSoup = [&](uint32_t count, std::vector<float3>& positions, std::vector<uint32_t>& indices)
+    {
+        float3 clusterCenter = float3(0.f);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            if (i % 64 == 0)
+                clusterCenter = randomFloat3() * 10.f;
+            const float3 center = clusterCenter + (randomFloat3() - 0.5f);
+            const float size = 0.05f + 0.2f * u(rng);
+            for (uint32_t j = 0; j < 3; ++j)
+            {
+                indices.push_back((uint32_t)positions.size());
+                positions.push_back(center + (randomFloat3() - 0.5f) * size);
+            }
+        }
+    };
+
+    TestScene scene;
+    const NodeID root = addNode(scene, float4x4::identity());
+    const NodeID moved = addNode(scene, math::matrixFromTranslation(float3(5.f, -2.f, 1.f)), root);
+    const NodeID rotated = addNode(scene, mul(math::matrixFromRotationY(0.7f), math::matrixFromScaling(float3(1.5f, 0.5f, 1.f))), moved);
+
+    std::vector<float3> positions;
+    std::vector<uint32_t> indices;
+    createSoup(triangleCount / 2, positions, indices);
+    const uint32_t mesh32 = addMesh(scene, positions, indices, false);
+
+    positions.clear();
+    indices.clear();
+    createSoup(std::min(triangleCount / 4, 20000u), positions, indices);
+    const uint32_t mesh16 = addMesh(scene, positions, indices, true);
+
+    positions.clear();
+    indices.clear();
+    createSoup(64, positions, indices);
+    const uint32_t meshNonIndexed = addMesh(scene, positions, {}, false);
+
+    addInstance(scene, mesh32, root);
+    addInstance(scene, mesh32, rotated);
+    addInstance(scene, mesh16, moved);
+    addInstance(scene, meshNonIndexed, rotated);
+    return scene;
+}
+
+std::vector<Ray> createRays(const TestScene& scene, uint32_t count, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u(0.f, 1.f);
+    const uint32_t triangleCount = (uint32_t)scene.instanceIDs.size();
+
+    AABB bounds;
+    for (const float3& p : scene.positions)
+        bounds.include(p);
+
+    std::vector<Ray> rays(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const float3 origin = bounds.minPoint + float3(u(rng), u(rng), u(rng)) * bounds.extent();
+        float3 dir = normalize(float3(u(rng), u(rng), u(rng)) - 0.5f);
+        // Aim every other ray at a triangle to get a good mix of hits and misses.
+        if (i % 2 == 0)
+        {
+            const uint32_t triangleIndex = std::min((uint32_t)(u(rng) * triangleCount), triangleCount - 1);
+            const float3* p = &scene.positions[3 * triangleIndex];
+            dir = normalize((p[0] + p[1] + p[2]) / 3.f - origin);
+        }
+        const float tMax = i % 3 == 0 ? 2.f * u(rng) : std::numeric_limits<float>::max();
+        rays[i] = Ray(origin, dir, 0.f, tMax);
+    }
+    return rays;
+}
+
+bool intersectReference(const float3* p, const Ray& ray, float& t)
+{
+    const float3 e1 = p[1] - p[0];
+    const float3 e2 = p[2] - p[0];
+    const float3 pv = cross(ray.dir, e2);
+    const float det = dot(e1, pv);
+    if (det == 0.f)
+        return false;
+    const float3 s = ray.origin - p[0];
+    const float u = dot(s, pv) / det;
+    const float3 q = cross(s, e1);
+    const float v = dot(ray.dir, q) / det;
+    t = dot(e2, q) / det;
+    return u >= 0.f && v >= 0.f && u + v <= 1.f && t > ray.tMin && t < ray.tMax;
+}
+
+/// Brute force closest hit distance, or infinity if there is no hit.
+float closestHitReference(const TestScene& scene, const Ray& ray)
+{
+    float tClosest = std::numeric_limits<float>::infinity();
+    for (size_t i = 0; i < scene.instanceIDs.size(); ++i)
+    {
+        float t;
+        if (intersectReference(&scene.positions[3 * i], ray, t))
+            tClosest = std::min(tClosest, t);
+    }
+    return tClosest;
+}
+
+/// Check a hit against the brute force reference, allowing for rounding differences.
+void validateHit(CPUUnitTestContext& ctx, const TestScene& scene, const Ray& ray, const CPUBVH::Hit& hit, size_t rayIndex)
+{
+    const float tReference = closestHitReference(scene, ray);
+    const float tolerance = 1e-4f * (1.f + tReference);
+    if (!hit.isValid())
+    {
+        // Hits that are on the edge of the reference range may be missed due to rounding.
+        EXPECT(std::isinf(tReference) || tReference >= ray.tMax - tolerance) << "rayIndex=" << rayIndex << " tReference=" << tReference;
+        return;
+    }
+
+    EXPECT_LE(std::abs(hit.t - tReference), tolerance) << "rayIndex=" << rayIndex;
+
+    // The plane of the reported triangle must be at the reported distance.
+    size_t triangleIndex = 0;
+    while (triangleIndex < scene.instanceIDs.size() &&
+           (scene.instanceIDs[triangleIndex] != hit.instanceID || scene.primitiveIndices[triangleIndex] != hit.primitiveIndex))
+        triangleIndex++;
+    ASSERT_LT(triangleIndex, scene.instanceIDs.size()) << "rayIndex=" << rayIndex;
+    const float3* p = &scene.positions[3 * triangleIndex];
+    const float3 n = cross(p[1] - p[0], p[2] - p[0]);
+    const float tPlane = dot(p[0] - ray.origin, n) / dot(ray.dir, n);
+    EXPECT_LE(std::abs(hit.t - tPlane), tolerance) << "rayIndex=" << rayIndex;
+    EXPECT(hit.barycentrics.x >= 0.f && hit.barycentrics.y >= 0.f && hit.barycentrics.x + hit.barycentrics.y <= 1.f) << "rayIndex=" << rayIndex;
+}
+} // namespace
+
+CPU_TEST(CPUBVH_ClosestHit)
+{
+    const TestScene scene = createTestScene(4000, 1234);
+    const CPUBVH bvh(scene.sceneData);
+    EXPECT_EQ(bvh.getTriangleCount(), (uint32_t)scene.instanceIDs.size());
+
+    AABB bounds;
+    for (const float3& p : scene.positions)
+        bounds.include(p);
+    EXPECT(bvh.getBounds() == bounds);
+
+    const auto rays = createRays(scene, 2000, 5678);
+    uint32_t hitCount = 0;
+    for (size_t i = 0; i < rays.size(); ++i)
+    {
+        const CPUBVH::Hit hit = bvh.closestHit(rays[i]);
+        hitCount += hit.isValid() ? 1 : 0;
+        validateHit(ctx, scene, rays[i], hit, i);
+    }
+    EXPECT_GT(hitCount, 0u);
+    EXPECT_LT(hitCount, (uint32_t)rays.size());
+}
+
+CPU_TEST(CPUBVH_AnyHit)
+{
+    const TestScene scene = createTestScene(4000, 4321);
+    const CPUBVH bvh(scene.sceneData);
+
+    const auto rays = createRays(scene, 2000, 8765);
+    for (size_t i = 0; i < rays.size(); ++i)
+    {
+        const float tReference = closestHitReference(scene, rays[i]);
+        // Skip rays with hits right at the end of the range, where rounding decides.
+        if (std::abs(tReference - rays[i].tMax) < 1e-4f * (1.f + rays[i].tMax))
+            continue;
+        EXPECT_EQ(bvh.anyHit(rays[i]), !std::isinf(tReference)) << "rayIndex=" << i;
+    }
+}
+
+CPU_TEST(CPUBVH_PacketsMatchSingleRays)
+{
+    const TestScene scene = createTestScene(20000, 2468);
+    const CPUBVH bvh(scene.sceneData);
+
+    const auto rays = createRays(scene, 4000, 1357);
+    for (size_t first = 0; first < rays.size(); first += CPUBVH::kPacketSize)
+    {
+        // Leave some lanes inactive.
+        CPUBVH::RayPacket packet;
+        for (uint32_t lane = 0; lane < CPUBVH::kPacketSize; ++lane)
+        {
+            if ((first / CPUBVH::kPacketSize + lane) % 5 != 4)
+                packet.setRay(lane, rays[first + lane]);
+        }
+
+        CPUBVH::HitPacket hits;
+        bvh.closestHit(packet, hits);
+        const uint32_t occludedMask = bvh.anyHit(packet);
+        for (uint32_t lane = 0; lane < CPUBVH::kPacketSize; ++lane)
+        {
+            const CPUBVH::Hit packetHit = hits.getHit(lane);
+            const bool active = (packet.activeMask >> lane) & 1;
+            const bool occluded = (occludedMask >> lane) & 1;
+            if (!active)
+            {
+                EXPECT(!packetHit.isValid());
+                EXPECT(!occluded);
+                continue;
+            }
+
+            const CPUBVH::Hit hit = bvh.closestHit(rays[first + lane]);
+            EXPECT_EQ(packetHit.isValid(), hit.isValid()) << "rayIndex=" << first + lane;
+            EXPECT_EQ(occluded, bvh.anyHit(rays[first + lane])) << "rayIndex=" << first + lane;
+            if (packetHit.isValid() && hit.isValid())
+            {
+                EXPECT_LE(std::abs(packetHit.t - hit.t), 1e-5f * (1.f + hit.t)) << "rayIndex=" << first + lane;
+                EXPECT_EQ(packetHit.instanceID, hit.instanceID) << "rayIndex=" << first + lane;
+                EXPECT_EQ(packetHit.primitiveIndex, hit.primitiveIndex) << "rayIndex=" << first + lane;
+            }
+        }
+    }
+}
+
+CPU_TEST(CPUBVH_ParallelMatchesSerial)
+{
+    // The triangle count is large enough to exercise the parallel binning at the top of the tree.
+    const TestScene scene = createTestScene(200000, 97531);
+
+    CPUBVH::Options options;
+    options.useParallelBuild = false;
+    const CPUBVH serial(scene.sceneData, options);
+    options.useParallelBuild = true;
+    const CPUBVH parallel(scene.sceneData, options);
+
+    const auto& serialNodes = serial.getNodes();
+    const auto& parallelNodes = parallel.getNodes();
+    ASSERT_GT(serialNodes.size(), 0u);
+    ASSERT_EQ(serialNodes.size(), parallelNodes.size());
+    EXPECT_EQ(std::memcmp(serialNodes.data(), parallelNodes.data(), serialNodes.size() * sizeof(CPUBVH::Node)), 0);
+
+    for (const Ray& ray : createRays(scene, 1000, 8642))
+    {
+        const CPUBVH::Hit serialHit = serial.closestHit(ray);
+        const CPUBVH::Hit parallelHit = parallel.closestHit(ray);
+        EXPECT_EQ(serialHit.t, parallelHit.t);
+        EXPECT_EQ(serialHit.instanceID, parallelHit.instanceID);
+        EXPECT_EQ(serialHit.primitiveIndex, parallelHit.primitiveIndex);
+    }
+}
+
+CPU_TEST(CPUBVH_GlobalMatrices)
+{
+    TestScene scene;
+    const NodeID root = addNode(scene, math::matrixFromTranslation(float3(1.f, 2.f, 3.f)));
+    const NodeID child = addNode(scene, math::matrixFromScaling(float3(2.f)), root);
+    addNode(scene, math::matrixFromTranslation(float3(0.f, 0.f, -1.f)), child);
+
+    const auto globalMatrices = Scene::computeGlobalMatrices(scene.sceneData.sceneGraph);
+    ASSERT_EQ(globalMatrices.size(), scene.globalMatrices.size());
+    for (size_t i = 0; i < globalMatrices.size(); ++i)
+        EXPECT(globalMatrices[i] == scene.globalMatrices[i]) << "node " << i;
+
+    // Nodes must be stored after their parents.
+    scene.sceneData.sceneGraph[0].parent = child;
+    EXPECT_THROW(Scene::computeGlobalMatrices(scene.sceneData.sceneGraph));
+}
+
+CPU_TEST(CPUBVH_Empty)
+{
+    Scene::SceneData sceneData;
+    const CPUBVH bvh(sceneData);
+    EXPECT_EQ(bvh.getTriangleCount(), 0u);
+    EXPECT(!bvh.getBounds().valid());
+
+    const Ray ray(float3(0.f), float3(0.f, 0.f, 1.f));
+    EXPECT(!bvh.closestHit(ray).isValid());
+    EXPECT(!bvh.anyHit(ray));
+
+    CPUBVH::RayPacket packet;
+    for (uint32_t lane = 0; lane < CPUBVH::kPacketSize; ++lane)
+        packet.setRay(lane, ray);
+    CPUBVH::HitPacket hits;
+    bvh.closestHit(packet, hits);
+    for (uint32_t lane = 0; lane < CPUBVH::kPacketSize; ++lane)
+        EXPECT(!hits.getHit(lane).isValid());
+    EXPECT_EQ(bvh.anyHit(packet), 0u);
+}
+
+CPU_TEST(CPUBVH_Benchmark, TAGS("benchmark"))
+{
+    // Load all meshes in my_scenes and instance them on a grid.
+    TestScene scene;
+    const NodeID root = addNode(scene, float4x4::identity());
+    std::vector<uint32_t> meshIDs;
+    AABB meshBounds;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(getProjectDirectory() / "my_scenes"))
+    {
+        if (entry.path().extension() != ".obj")
+            continue;
+        ref<TriangleMesh> pMesh = TriangleMesh::createFromFile(entry.path());
+        if (!pMesh || pMesh->getIndices().empty())
+            continue;
+
+        std::vector<float3> positions;
+        for (const auto& vertex : pMesh->getVertices())
+        {
+            positions.push_back(vertex.position);
+            meshBounds.include(vertex.position);
+        }
+        meshIDs.push_back(addMesh(scene, positions, pMesh->getIndices(), false));
+    }
+    if (meshIDs.empty())
+    {
+        logWarning("CPUBVH: No meshes found in my_scenes, skipping benchmark.");
+        return;
+    }
+
+    const uint32_t kGridSize = 16;
+    const float3 spacing = meshBounds.extent() * 1.25f;
+    for (uint32_t z = 0; z < kGridSize; ++z)
+    {
+        for (uint32_t x = 0; x < kGridSize; ++x)
+        {
+            const NodeID nodeID = addNode(scene, math::matrixFromTranslation(float3(float(x), 0.f, float(z)) * spacing), root);
+            for (uint32_t meshID : meshIDs)
+                addInstance(scene, meshID, nodeID);
+        }
+    }
+
+    for (bool useParallelBuild : {false, true})
+    {
+        CPUBVH::Options options;
+        options.useParallelBuild = useParallelBuild;
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        CPUBVH bvh(scene.sceneData, options);
+        double duration = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+        logInfo(
+            "CPUBVH: {} triangles, {} nodes, {} build: {:.1f} ms", bvh.getTriangleCount(), bvh.getNodes().size(),
+            useParallelBuild ? "parallel" : "serial", duration
+        );
+    }
+
+    const CPUBVH bvh(scene.sceneData);
+    const uint32_t kRayCount = 1 << 20;
+    const auto rays = createRays(scene, kRayCount, 1111);
+
+    std::vector<CPUBVH::RayPacket> packets(kRayCount / CPUBVH::kPacketSize);
+    for (uint32_t i = 0; i < kRayCount; ++i)
+        packets[i / CPUBVH::kPacketSize].setRay(i % CPUBVH::kPacketSize, rays[i]);
+
+    auto measure = [&](const char* name, auto&& func)
+    {
+        uint32_t hitCount = 0;
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        func(hitCount);
+        double duration = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+        logInfo("CPUBVH: {}: {:.2f} Mrays/s ({} hits)", name, kRayCount / (duration * 1e3), hitCount);
+    };
+
+    measure("single closest hit", [&](uint32_t& hitCount)
+    {
+        for (const Ray& ray : rays)
+            hitCount += bvh.closestHit(ray).isValid() ? 1 : 0;
+    });
+    measure("single any hit", [&](uint32_t& hitCount)
+    {
+        for (const Ray& ray : rays)
+            hitCount += bvh.anyHit(ray) ? 1 : 0;
+    });
+    measure("packet closest hit", [&](uint32_t& hitCount)
+    {
+        CPUBVH::HitPacket hits;
+        for (const auto& packet : packets)
+        {
+            bvh.closestHit(packet, hits);
+            for (uint32_t lane = 0; lane < CPUBVH::kPacketSize; ++lane)
+                hitCount += hits.instanceID[lane] != CPUBVH::kInvalidIndex ? 1 : 0;
+        }
+    });
+    measure("packet any hit", [&](uint32_t& hitCount)
+    {
+        for (const auto& packet : packets)
+            hitCount += (uint32_t)std::bitset<CPUBVH::kPacketSize>(bvh.anyHit(packet)).count();
+    });
+}
+} // namespace Falcor
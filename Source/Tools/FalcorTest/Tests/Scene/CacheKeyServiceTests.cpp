@@ -0,0 +1,250 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/CacheKeyService.h"
+#include "Core/Platform/OS.h"
+#include "Utils/CryptoUtils.h"
+#include "Utils/Timing/CpuTimer.h"
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+namespace Falcor
+{
+namespace
+{
+/// Removes the directory when going out of scope.
+struct TempDirectory
+{
+    std::filesystem::path path = getTempFilePath();
+    TempDirectory() { std::filesystem::create_directories(path); }
+    ~TempDirectory() { std::filesystem::remove_all(path); }
+};
+
+/// Write a file and set its modification time to the given number of seconds in the past.
+/// Files modified too recently are not memoized, see CacheKeyService::kRacyIntervalSeconds.
+void writeFileData(const std::filesystem::path& path, const std::string& data, int ageSeconds = 3600)
+{
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(data.data(), data.size());
+    }
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now() - std::chrono::seconds(ageSeconds));
+}
+
+CacheKeyService::Options makeOptions(const std::filesystem::path& memoPath = {}, uint32_t threadCount = 0)
+{
+    CacheKeyService::Options options;
+    options.memoPath = memoPath;
+    options.threadCount = threadCount;
+    return options;
+}
+} // namespace
+
+CPU_TEST(CacheKeyService_HashFile)
+{
+    TempDirectory dir;
+    writeFileData(dir.path / "a.txt", "Hello World!");
+    writeFileData(dir.path / "empty.txt", "");
+
+    CacheKeyService service;
+    std::string str{"Hello World!"};
+    EXPECT(service.hashFile(dir.path / "a.txt") == FastHash128::compute(str.data(), str.size()));
+    EXPECT(service.hashFile(dir.path / "empty.txt") == FastHash128::compute(nullptr, 0));
+    EXPECT_THROW(service.hashFile(dir.path / "missing.txt"));
+    EXPECT_THROW(service.hashFiles({dir.path / "a.txt", dir.path / "missing.txt", dir.path / "empty.txt"}));
+}
+
+CPU_TEST(CacheKeyService_Memo)
+{
+    TempDirectory dir;
+    const auto memoPath = dir.path / "memo.bin";
+    const std::vector<std::filesystem::path> paths = {dir.path / "a.txt", dir.path / "b.txt", dir.path / "c.txt"};
+    writeFileData(paths[0], "aaaa");
+    writeFileData(paths[1], "bbbb");
+    writeFileData(paths[2], "cccc");
+
+    std::vector<CacheKeyService::Digest> digests;
+    {
+        CacheKeyService service(makeOptions(memoPath));
+        digests = service.hashFiles(paths);
+        EXPECT_EQ(service.getStats().hashedFileCount, 3);
+        EXPECT_EQ(service.getMemoSize(), 3);
+
+        // Unchanged files are not read again.
+        EXPECT(service.hashFiles(paths) == digests);
+        EXPECT_EQ(service.getStats().hashedFileCount, 3);
+        EXPECT_EQ(service.getStats().memoHitCount, 3);
+    }
+
+    // The memo is saved on destruction and loaded by the next instance.
+    EXPECT(std::filesystem::exists(memoPath));
+    {
+        CacheKeyService service(makeOptions(memoPath));
+        EXPECT_EQ(service.getMemoSize(), 3);
+        EXPECT(service.hashFiles(paths) == digests);
+        EXPECT_EQ(service.getStats().hashedFileCount, 0);
+
+        // Changing the modification time causes the file to be hashed again, even if the size is the same.
+        writeFileData(paths[1], "BBBB", 1800);
+        auto newDigests = service.hashFiles(paths);
+        EXPECT_EQ(service.getStats().hashedFileCount, 1);
+        EXPECT(newDigests[0] == digests[0]);
+        EXPECT(newDigests[1] != digests[1]);
+        EXPECT(newDigests[2] == digests[2]);
+
+        // Changing the size causes the file to be hashed again.
+        writeFileData(paths[2], "ccccc", 1800);
+        service.hashFile(paths[2]);
+        EXPECT_EQ(service.getStats().hashedFileCount, 2);
+
+        service.clearMemo();
+        EXPECT_EQ(service.getMemoSize(), 0);
+        service.hashFile(paths[0]);
+        EXPECT_EQ(service.getStats().hashedFileCount, 3);
+    }
+
+    // Recently modified files are hashed but not memoized.
+    {
+        CacheKeyService service(makeOptions());
+        writeFileData(paths[0], "recent", 0);
+        service.hashFile(paths[0]);
+        service.hashFile(paths[0]);
+        EXPECT_EQ(service.getStats().hashedFileCount, 2);
+        EXPECT_EQ(service.getMemoSize(), 0);
+    }
+
+    // An invalid memo file is ignored.
+    {
+        writeFileData(memoPath, "not a memo");
+        CacheKeyService service(makeOptions(memoPath));
+        EXPECT_EQ(service.getMemoSize(), 0);
+        service.hashFile(paths[0]);
+    }
+}
+
+CPU_TEST(CacheKeyService_Parallel)
+{
+    TempDirectory dir;
+    std::vector<std::filesystem::path> paths;
+    std::mt19937 rng;
+    for (uint32_t i = 0; i < 200; ++i)
+    {
+        paths.push_back(dir.path / fmt::format("file{}.bin", i));
+        writeFileData(paths.back(), std::string(rng() % 20000, (char)i));
+    }
+
+    CacheKeyService serialService(makeOptions({}, 1));
+    CacheKeyService parallelService(makeOptions({}, 4));
+    EXPECT(serialService.hashFiles(paths) == parallelService.hashFiles(paths));
+    EXPECT_EQ(parallelService.getStats().hashedFileCount, paths.size());
+}
+
+CPU_TEST(CacheKeyService_ComputeKey)
+{
+    TempDirectory dir;
+    const auto pathA = dir.path / "a.txt";
+    const auto pathB = dir.path / "b.txt";
+    writeFileData(pathA, "aaaa");
+    writeFileData(pathB, "bbbb");
+
+    CacheKeyService service;
+    const uint32_t flags = 1;
+    const auto key = service.computeKey({pathA, pathB}, &flags, sizeof(flags));
+    EXPECT(service.computeKey({pathA, pathB}, &flags, sizeof(flags)) == key);
+
+    // The key depends on the file order, the additional data and the file contents.
+    EXPECT(service.computeKey({pathB, pathA}, &flags, sizeof(flags)) != key);
+    EXPECT(service.computeKey({pathA, pathB}) != key);
+    const uint32_t otherFlags = 2;
+    EXPECT(service.computeKey({pathA, pathB}, &otherFlags, sizeof(otherFlags)) != key);
+    writeFileData(pathB, "BBBB", 1800);
+    EXPECT(service.computeKey({pathA, pathB}, &flags, sizeof(flags)) != key);
+}
+
+CPU_TEST(CacheKeyService_Benchmark, TAGS("benchmark"))
+{
+    // Synthetic asset tree with 10k files of 1-32 KB in 100 directories.
+    TempDirectory dir;
+    std::vector<std::filesystem::path> paths;
+    std::mt19937 rng;
+    uint64_t totalSize = 0;
+    for (uint32_t i = 0; i < 10000; ++i)
+    {
+        auto path = dir.path / fmt::format("dir{}", i / 100) / fmt::format("file{}.bin", i);
+        if (i % 100 == 0) std::filesystem::create_directories(path.parent_path());
+        std::string data(1024 + rng() % (31 * 1024), 0);
+        for (auto& c : data)
+            c = (char)rng();
+        writeFileData(path, data);
+        paths.push_back(path);
+        totalSize += data.size();
+    }
+    const auto memoPath = dir.path / "memo.bin";
+
+    // Baseline: serial SHA1 over buffered reads, as previously used for cache keys.
+    auto t0 = CpuTimer::getCurrentTimePoint();
+    for (const auto& path : paths)
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::vector<char> data(std::filesystem::file_size(path));
+        file.read(data.data(), data.size());
+        SHA1::compute(data.data(), data.size());
+    }
+    auto t1 = CpuTimer::getCurrentTimePoint();
+
+    // Serial and parallel memory-mapped hashing without memo.
+    {
+        CacheKeyService service(makeOptions({}, 1));
+        service.hashFiles(paths);
+    }
+    auto t2 = CpuTimer::getCurrentTimePoint();
+    {
+        CacheKeyService service(makeOptions(memoPath));
+        service.hashFiles(paths);
+    }
+    auto t3 = CpuTimer::getCurrentTimePoint();
+
+    // Warm memo loaded from the sidecar file.
+    uint64_t memoHitCount = 0;
+    {
+        CacheKeyService service(makeOptions(memoPath));
+        service.hashFiles(paths);
+        memoHitCount = service.getStats().memoHitCount;
+    }
+    auto t4 = CpuTimer::getCurrentTimePoint();
+    EXPECT_EQ(memoHitCount, paths.size());
+
+    logInfo(
+        "CacheKeyService: {} files, {:.1f} MB. SHA1 serial: {:.1f} ms, FastHash128 serial: {:.1f} ms, parallel: {:.1f} ms (incl. saving memo), "
+        "warm memo: {:.1f} ms",
+        paths.size(), double(totalSize) / (1024 * 1024), CpuTimer::calcDuration(t0, t1), CpuTimer::calcDuration(t1, t2),
+        CpuTimer::calcDuration(t2, t3), CpuTimer::calcDuration(t3, t4));
+}
+} // namespace Falcor
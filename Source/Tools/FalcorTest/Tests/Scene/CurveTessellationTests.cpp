@@ -0,0 +1,412 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/Curves/CurveTessellation.h"
+#include "Utils/Math/CubicSpline.h"
+#include "Utils/Math/MathHelpers.h"
+#include "Utils/Math/Quaternion.h"
+#include "Utils/Timing/CpuTimer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+namespace Falcor
+{
+namespace
+{
+const float kMeshCompensationScale = 1.11f;
+
+struct TestCurves
+{
+    std::vector<uint32_t> vertexCounts;
+    std::vector<float3> controlPoints;
+    std::vector<float> widths;
+    std::vector<float2> UVs;
+
+    uint32_t getStrandCount() const { return (uint32_t)vertexCounts.size(); }
+};
+
+/// Generate random strands with some repeated control points, each strand having at least two unique points.
+TestCurves createCurves(uint32_t strandCount, uint32_t minVertexCount, uint32_t maxVertexCount, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u(-1.f, 1.f);
+
+    TestCurves curves;
+    curves.vertexCounts.resize(strandCount);
+    for (auto& vertexCount : curves.vertexCounts)
+    {
+        vertexCount = minVertexCount + rng() % (maxVertexCount - minVertexCount + 1);
+        float3 p(u(rng), u(rng), u(rng));
+        for (uint32_t j = 0; j < vertexCount; j++)
+        {
+            // Repeat about every fifth point, but never the last one.
+            if (j == 0 || j == vertexCount - 1 || rng() % 5 != 0)
+                p += 0.1f * float3(u(rng), u(rng), 0.5f + u(rng));
+            curves.controlPoints.push_back(p);
+            curves.widths.push_back(0.01f + 0.005f * u(rng));
+            curves.UVs.push_back(float2(u(rng), u(rng)));
+        }
+    }
+    return curves;
+}
+
+// Reference implementation of the tessellation, processing one strand after the other.
+
+struct ReferenceStrand
+{
+    std::vector<float3> points;
+    std::vector<float> widths;
+    std::vector<float2> UVs;
+};
+
+ReferenceStrand removeDuplicatePoints(const TestCurves& curves, uint32_t pointOffset, uint32_t vertexCount, bool useUVs)
+{
+    ReferenceStrand strand;
+    for (uint32_t j = 0; j < vertexCount; j++)
+    {
+        uint32_t p = pointOffset + j;
+        if (j == vertexCount - 1 || any(curves.controlPoints[p] != curves.controlPoints[p + 1]))
+        {
+            strand.points.push_back(curves.controlPoints[p]);
+            strand.widths.push_back(curves.widths[p]);
+            if (useUVs)
+                strand.UVs.push_back(curves.UVs[p]);
+        }
+    }
+    return strand;
+}
+
+/// Sample the spline through the values subdivPerSegment times per segment, keeping one of every keepOneEvery samples and the end point.
+template<typename T>
+std::vector<T> sampleSpline(const std::vector<T>& values, uint32_t subdivPerSegment, uint32_t keepOneEvery)
+{
+    uint32_t count = (uint32_t)values.size();
+    CubicSpline<T> spline(values.data(), count);
+    std::vector<T> samples;
+    uint32_t sampleIndex = 0;
+    for (uint32_t j = 0; j < count - 1; j++)
+    {
+        for (uint32_t k = 0; k < subdivPerSegment; k++)
+        {
+            if (sampleIndex++ % keepOneEvery == 0)
+                samples.push_back(spline.interpolate(j, (float)k / (float)subdivPerSegment));
+        }
+    }
+    samples.push_back(spline.interpolate(count - 2, 1.f));
+    return samples;
+}
+
+float sanitizeWidth(float w)
+{
+    return std::max(w, (float)std::numeric_limits<float16_t>::min());
+}
+
+template<typename Func>
+void forEachKeptStrand(const TestCurves& curves, uint32_t keepOneEveryXStrands, Func func)
+{
+    uint32_t pointOffset = 0;
+    for (uint32_t i = 0; i < curves.getStrandCount(); i++)
+    {
+        if (i % keepOneEveryXStrands == 0)
+            func(pointOffset, curves.vertexCounts[i]);
+        pointOffset += curves.vertexCounts[i];
+    }
+}
+
+CurveTessellation::SweptSphereResult referenceLinearSweptSphere(
+    const TestCurves& curves,
+    bool useUVs,
+    uint32_t subdivPerSegment,
+    uint32_t keepOneEveryXStrands,
+    uint32_t keepOneEveryXVerticesPerStrand,
+    float widthScale,
+    const float4x4& xform
+)
+{
+    CurveTessellation::SweptSphereResult result;
+    result.degree = 1;
+    float scale = std::sqrt(xform[0][0] * xform[0][0] + xform[0][1] * xform[0][1] + xform[0][2] * xform[0][2]);
+
+    forEachKeptStrand(
+        curves,
+        keepOneEveryXStrands,
+        [&](uint32_t pointOffset, uint32_t vertexCount)
+        {
+            ReferenceStrand strand = removeDuplicatePoints(curves, pointOffset, vertexCount, useUVs);
+            auto points = sampleSpline(strand.points, subdivPerSegment, keepOneEveryXVerticesPerStrand);
+            auto widths = sampleSpline(strand.widths, subdivPerSegment, keepOneEveryXVerticesPerStrand);
+            for (size_t j = 0; j < points.size(); j++)
+            {
+                if (j + 1 < points.size())
+                    result.indices.push_back((uint32_t)result.points.size());
+                result.points.push_back(transformPoint(xform, points[j]));
+                result.radius.push_back(sanitizeWidth(widths[j] * 0.5f * widthScale) * scale);
+            }
+            if (useUVs)
+            {
+                for (const auto& uv : sampleSpline(strand.UVs, subdivPerSegment, keepOneEveryXVerticesPerStrand))
+                    result.texCrds.push_back(uv);
+            }
+        }
+    );
+    return result;
+}
+
+CurveTessellation::MeshResult referencePolytube(
+    const TestCurves& curves,
+    bool useUVs,
+    uint32_t subdivPerSegment,
+    uint32_t keepOneEveryXStrands,
+    uint32_t keepOneEveryXVerticesPerStrand,
+    float widthScale,
+    uint32_t pointCountPerCrossSection
+)
+{
+    CurveTessellation::MeshResult result;
+    const uint32_t n = pointCountPerCrossSection;
+
+    forEachKeptStrand(
+        curves,
+        keepOneEveryXStrands,
+        [&](uint32_t pointOffset, uint32_t vertexCount)
+        {
+            ReferenceStrand strand = removeDuplicatePoints(curves, pointOffset, vertexCount, useUVs);
+            auto points = sampleSpline(strand.points, subdivPerSegment, keepOneEveryXVerticesPerStrand);
+            auto widths = sampleSpline(strand.widths, subdivPerSegment, keepOneEveryXVerticesPerStrand);
+            std::vector<float2> UVs;
+            if (useUVs)
+                UVs = sampleSpline(strand.UVs, subdivPerSegment, keepOneEveryXVerticesPerStrand);
+
+            const uint32_t count = (uint32_t)points.size();
+            const uint32_t vertexOffset = (uint32_t)result.vertices.size();
+
+            float3 fwd = normalize(points[1] - points[0]);
+            float3 s, t;
+            buildFrame(fwd, s, t);
+
+            for (uint32_t j = 0; j < count; j++)
+            {
+                // Rotate the frame along the strand.
+                float3 prevFwd = fwd;
+                if (j > 0 && count > 2)
+                {
+                    prevFwd = normalize(points[j] - points[j > 1 ? j - 2 : 0]);
+                    fwd = normalize(points[std::min(j + 1, count - 1)] - points[j - 1]);
+                }
+                s = mul(math::quatFromRotationBetweenVectors(prevFwd, fwd), s);
+                t = normalize(cross(fwd, s));
+                s = normalize(cross(t, fwd));
+
+                float radius = 0.5f * sanitizeWidth(kMeshCompensationScale * widthScale * widths[j]);
+                for (uint32_t k = 0; k < n; k++)
+                {
+                    float phi = (float)k / (float)n * (float)M_PI * 2.f;
+                    float3 normal = std::cos(phi) * s + std::sin(phi) * t;
+                    result.vertices.push_back(points[j] + radius * normal);
+                    result.normals.push_back(normal);
+                    result.tangents.push_back(float4(fwd, 1.f));
+                    result.radii.push_back(radius);
+                    if (useUVs)
+                        result.texCrds.push_back(UVs[j]);
+                }
+
+                if (j + 1 < count)
+                {
+                    uint32_t ring = vertexOffset + j * n;
+                    for (uint32_t k = 0; k < n; k++)
+                    {
+                        uint32_t next = (k + 1) % n;
+                        for (uint32_t index : {ring + k, ring + next, ring + n + next, ring + k, ring + n + next, ring + n + k})
+                            result.faceVertexIndices.push_back(index);
+                        result.faceVertexCounts.push_back(3);
+                        result.faceVertexCounts.push_back(3);
+                    }
+                }
+            }
+        }
+    );
+    return result;
+}
+
+template<typename T>
+bool isBitwiseEqual(const fast_vector<T>& a, const fast_vector<T>& b)
+{
+    return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+struct TessellationConfig
+{
+    bool useUVs;
+    uint32_t subdivPerSegment;
+    uint32_t keepOneEveryXStrands;
+    uint32_t keepOneEveryXVerticesPerStrand;
+};
+
+// Enough strands to run several parallel tasks.
+const uint32_t kStrandCount = 1000;
+
+const TessellationConfig kConfigs[] = {
+    {false, 1, 1, 1},
+    {true, 1, 1, 1},
+    {true, 4, 1, 1},
+    {false, 3, 2, 1},
+    {true, 4, 1, 3},
+    {true, 5, 3, 2},
+};
+} // namespace
+
+CPU_TEST(CurveTessellation_LinearSweptSphere)
+{
+    TestCurves curves = createCurves(kStrandCount, 2, 20, 1);
+    float4x4 xform = mul(math::matrixFromTranslation(float3(1.f, -2.f, 3.f)), math::matrixFromScaling(float3(2.5f)));
+
+    for (const auto& config : kConfigs)
+    {
+        auto result = CurveTessellation::convertToLinearSweptSphere(
+            curves.getStrandCount(),
+            curves.vertexCounts.data(),
+            curves.controlPoints.data(),
+            curves.widths.data(),
+            config.useUVs ? curves.UVs.data() : nullptr,
+            1,
+            config.subdivPerSegment,
+            config.keepOneEveryXStrands,
+            config.keepOneEveryXVerticesPerStrand,
+            0.8f,
+            xform
+        );
+        auto expected = referenceLinearSweptSphere(
+            curves,
+            config.useUVs,
+            config.subdivPerSegment,
+            config.keepOneEveryXStrands,
+            config.keepOneEveryXVerticesPerStrand,
+            0.8f,
+            xform
+        );
+
+        EXPECT_EQ(result.degree, 1u);
+        EXPECT(isBitwiseEqual(result.indices, expected.indices));
+        EXPECT(isBitwiseEqual(result.points, expected.points));
+        EXPECT(isBitwiseEqual(result.radius, expected.radius));
+        EXPECT(isBitwiseEqual(result.texCrds, expected.texCrds));
+    }
+}
+
+CPU_TEST(CurveTessellation_Polytube)
+{
+    TestCurves curves = createCurves(kStrandCount, 2, 20, 2);
+
+    for (const auto& config : kConfigs)
+    {
+        for (uint32_t pointCountPerCrossSection : {3u, 4u, 7u})
+        {
+            auto result = CurveTessellation::convertToPolytube(
+                curves.getStrandCount(),
+                curves.vertexCounts.data(),
+                curves.controlPoints.data(),
+                curves.widths.data(),
+                config.useUVs ? curves.UVs.data() : nullptr,
+                config.subdivPerSegment,
+                config.keepOneEveryXStrands,
+                config.keepOneEveryXVerticesPerStrand,
+                1.2f,
+                pointCountPerCrossSection
+            );
+            auto expected = referencePolytube(
+                curves,
+                config.useUVs,
+                config.subdivPerSegment,
+                config.keepOneEveryXStrands,
+                config.keepOneEveryXVerticesPerStrand,
+                1.2f,
+                pointCountPerCrossSection
+            );
+
+            EXPECT(isBitwiseEqual(result.vertices, expected.vertices));
+            EXPECT(isBitwiseEqual(result.normals, expected.normals));
+            EXPECT(isBitwiseEqual(result.tangents, expected.tangents));
+            EXPECT(isBitwiseEqual(result.texCrds, expected.texCrds));
+            EXPECT(isBitwiseEqual(result.radii, expected.radii));
+            EXPECT(isBitwiseEqual(result.faceVertexCounts, expected.faceVertexCounts));
+            EXPECT(isBitwiseEqual(result.faceVertexIndices, expected.faceVertexIndices));
+        }
+    }
+}
+
+CPU_TEST(CurveTessellation_Benchmark, TAGS("benchmark"))
+{
+    const uint32_t strandCount = 20000;
+    TestCurves curves = createCurves(strandCount, 16, 32, 3);
+    const uint32_t subdivPerSegment = 4;
+
+    auto t0 = CpuTimer::getCurrentTimePoint();
+    auto spheres = CurveTessellation::convertToLinearSweptSphere(
+        strandCount,
+        curves.vertexCounts.data(),
+        curves.controlPoints.data(),
+        curves.widths.data(),
+        curves.UVs.data(),
+        1,
+        subdivPerSegment,
+        1,
+        1,
+        1.f,
+        float4x4::identity()
+    );
+    auto t1 = CpuTimer::getCurrentTimePoint();
+    auto mesh = CurveTessellation::convertToPolytube(
+        strandCount,
+        curves.vertexCounts.data(),
+        curves.controlPoints.data(),
+        curves.widths.data(),
+        curves.UVs.data(),
+        subdivPerSegment,
+        1,
+        1,
+        1.f,
+        4
+    );
+    auto t2 = CpuTimer::getCurrentTimePoint();
+
+    double sphereTime = CpuTimer::calcDuration(t0, t1);
+    double meshTime = CpuTimer::calcDuration(t1, t2);
+    logInfo(
+        "Curve tessellation of {} strands ({} control points): linear swept spheres {:.1f} ms ({:.1f} M points/s), "
+        "polytubes {:.1f} ms ({:.1f} M vertices/s)",
+        strandCount,
+        curves.controlPoints.size(),
+        sphereTime,
+        spheres.points.size() / (sphereTime * 1e3),
+        meshTime,
+        mesh.vertices.size() / (meshTime * 1e3)
+    );
+}
+} // namespace Falcor
@@ -0,0 +1,265 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/DirtyTracking.h"
+#include "Utils/Timing/CpuTimer.h"
+
+#include <algorithm>
+#include <limits>
+#include <random>
+
+namespace Falcor
+{
+namespace
+{
+/// Generate a random forest. Each node is a root with some probability, otherwise its parent is one of the previous nodes.
+std::vector<NodeID> createSceneGraph(uint32_t nodeCount, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<NodeID> parents(nodeCount, NodeID::Invalid());
+    for (uint32_t i = 1; i < nodeCount; i++)
+    {
+        // Prefer recent nodes as parents to get deeper hierarchies.
+        if (rng() % 16 != 0) parents[i] = NodeID{ i - 1 - rng() % std::min(i, 64u) };
+    }
+    return parents;
+}
+
+/// Reference propagation: a node is dirty if it or any of its ancestors is marked.
+std::vector<uint8_t> propagateReference(const std::vector<NodeID>& parents, const std::vector<uint8_t>& marked)
+{
+    std::vector<uint8_t> dirty(marked);
+    for (size_t i = 0; i < parents.size(); i++)
+    {
+        if (parents[i] != NodeID::Invalid() && dirty[parents[i].get()]) dirty[i] = 1;
+    }
+    return dirty;
+}
+
+/// Check that the tracker state matches the expected dirty flags, and that dirty nodes are listed once with parents before their children.
+void checkDirtyNodes(CPUUnitTestContext& ctx, const SceneGraphDirtyTracker& tracker, const std::vector<NodeID>& parents, const std::vector<uint8_t>& expected)
+{
+    const auto& dirtyNodes = tracker.getDirtyNodes();
+    std::vector<uint32_t> positions(parents.size(), std::numeric_limits<uint32_t>::max());
+    for (uint32_t i = 0; i < (uint32_t)dirtyNodes.size(); i++)
+    {
+        ASSERT_LT(dirtyNodes[i], parents.size());
+        EXPECT_EQ(positions[dirtyNodes[i]], std::numeric_limits<uint32_t>::max()) << "node " << dirtyNodes[i] << " listed twice";
+        positions[dirtyNodes[i]] = i;
+    }
+
+    uint32_t mismatchCount = 0;
+    uint32_t orderErrorCount = 0;
+    for (uint32_t i = 0; i < (uint32_t)parents.size(); i++)
+    {
+        bool listed = positions[i] != std::numeric_limits<uint32_t>::max();
+        if (tracker.isDirty(i) != (expected[i] != 0) || listed != (expected[i] != 0)) mismatchCount++;
+        if (listed && parents[i] != NodeID::Invalid() && tracker.isDirty(parents[i].get()) && positions[parents[i].get()] > positions[i]) orderErrorCount++;
+    }
+    EXPECT_EQ(mismatchCount, 0);
+    EXPECT_EQ(orderErrorCount, 0);
+}
+} // namespace
+
+CPU_TEST(UploadRanges_Merge)
+{
+    std::vector<uint32_t> indices;
+    std::vector<UploadRange> ranges = { { 1, 1 } };
+    computeUploadRanges(indices, 4, ranges);
+    EXPECT(ranges.empty());
+
+    // Indices are sorted and deduplicated. Ranges separated by at most maxGap elements are merged.
+    indices = { 9, 3, 4, 4, 20, 0, 6, 14 };
+    computeUploadRanges(indices, 2, ranges);
+    EXPECT(indices == std::vector<uint32_t>({ 0, 3, 4, 6, 9, 14, 20 }));
+    EXPECT(ranges == std::vector<UploadRange>({ { 0, 10 }, { 14, 1 }, { 20, 1 } }));
+
+    // Without gaps only consecutive elements are merged.
+    computeUploadRanges(indices, 0, ranges);
+    EXPECT(ranges == std::vector<UploadRange>({ { 0, 1 }, { 3, 2 }, { 6, 1 }, { 9, 1 }, { 14, 1 }, { 20, 1 } }));
+
+    // Random indices are covered exactly by the ranges, which are separated by more than maxGap elements.
+    std::mt19937 rng(1);
+    for (uint32_t maxGap : { 0u, 1u, 5u, 100u })
+    {
+        std::vector<uint8_t> changed(10000, 0);
+        indices.clear();
+        for (uint32_t i = 0; i < 2000; i++)
+        {
+            uint32_t index = rng() % (uint32_t)changed.size();
+            changed[index] = 1;
+            indices.push_back(index);
+        }
+        computeUploadRanges(indices, maxGap, ranges);
+
+        std::vector<uint8_t> covered(changed.size(), 0);
+        uint32_t gapErrorCount = 0;
+        for (size_t i = 0; i < ranges.size(); i++)
+        {
+            std::fill_n(covered.begin() + ranges[i].offset, ranges[i].count, 1);
+            EXPECT(changed[ranges[i].offset] && changed[ranges[i].offset + ranges[i].count - 1]);
+            if (i > 0 && ranges[i].offset - (ranges[i - 1].offset + ranges[i - 1].count) <= maxGap) gapErrorCount++;
+        }
+        uint32_t missingCount = 0;
+        for (size_t i = 0; i < changed.size(); i++)
+        {
+            if (changed[i] && !covered[i]) missingCount++;
+        }
+        EXPECT_EQ(missingCount, 0) << "maxGap " << maxGap;
+        EXPECT_EQ(gapErrorCount, 0) << "maxGap " << maxGap;
+    }
+}
+
+CPU_TEST(SceneGraphDirtyTracker_Propagate)
+{
+    const uint32_t nodeCount = 5000;
+    auto parents = createSceneGraph(nodeCount, 2);
+    SceneGraphDirtyTracker tracker(parents);
+    EXPECT_EQ(tracker.getNodeCount(), nodeCount);
+
+    std::mt19937 rng(3);
+    for (uint32_t frame = 0; frame < 20; frame++)
+    {
+        // Mark nodes in several batches, propagating after each one as the animation controller does for edited and animated nodes.
+        std::vector<uint8_t> marked(nodeCount, 0);
+        uint32_t batchCount = 1 + frame % 3;
+        for (uint32_t batch = 0; batch < batchCount; batch++)
+        {
+            uint32_t markCount = rng() % (frame < 10 ? 10 : 500);
+            for (uint32_t i = 0; i < markCount; i++)
+            {
+                uint32_t nodeID = rng() % nodeCount;
+                marked[nodeID] = 1;
+                tracker.markDirty(nodeID);
+            }
+            tracker.propagate();
+            checkDirtyNodes(ctx, tracker, parents, propagateReference(parents, marked));
+        }
+
+        tracker.clear();
+        EXPECT(tracker.getDirtyNodes().empty());
+        checkDirtyNodes(ctx, tracker, parents, std::vector<uint8_t>(nodeCount, 0));
+    }
+
+    // Marking all nodes lists them all in order.
+    tracker.markDirty(7);
+    tracker.markAllDirty();
+    tracker.propagate();
+    checkDirtyNodes(ctx, tracker, parents, std::vector<uint8_t>(nodeCount, 1));
+    tracker.clear();
+    checkDirtyNodes(ctx, tracker, parents, std::vector<uint8_t>(nodeCount, 0));
+
+    // Children stored before their parents are rejected.
+    std::vector<NodeID> invalidParents = { NodeID::Invalid(), NodeID{ 2 }, NodeID{ 0 } };
+    EXPECT_THROW(SceneGraphDirtyTracker{ invalidParents });
+}
+
+CPU_TEST(NodeItemMap_AppendItems)
+{
+    NodeItemMap map({ 2, 0, 2, 3, 2 }, 4);
+
+    std::vector<uint32_t> items = { 7 };
+    map.appendItems({ 2, 1, 0 }, items);
+    EXPECT(items == std::vector<uint32_t>({ 7, 0, 2, 4, 1 }));
+
+    items.clear();
+    map.appendItems({ 3 }, items);
+    EXPECT(items == std::vector<uint32_t>({ 3 }));
+
+    std::vector<uint32_t> invalidNodeIDs = { 0, 4 };
+    EXPECT_THROW(NodeItemMap(invalidNodeIDs, 4));
+}
+
+CPU_TEST(TlasRefit_Decision)
+{
+    EXPECT(shouldRefitTlas(true, 1, 100, 0));
+    EXPECT(shouldRefitTlas(true, 25, 100, 0));
+    EXPECT(!shouldRefitTlas(true, 26, 100, 0));
+    EXPECT(!shouldRefitTlas(false, 1, 100, 0));
+
+    // The TLAS is rebuilt periodically to restore its quality.
+    EXPECT(shouldRefitTlas(true, 1, 100, 31));
+    EXPECT(!shouldRefitTlas(true, 1, 100, 32));
+}
+
+CPU_TEST(SceneGraphDirtyTracker_Benchmark, TAGS("benchmark"))
+{
+    const uint32_t nodeCount = 1000000;
+    const uint32_t frameCount = 100;
+    const uint32_t markCount = 100;
+    auto parents = createSceneGraph(nodeCount, 4);
+    SceneGraphDirtyTracker tracker(parents);
+
+    std::mt19937 rng(5);
+    std::vector<std::vector<uint32_t>> markedNodes(frameCount);
+    for (auto& nodes : markedNodes)
+    {
+        for (uint32_t i = 0; i < markCount; i++) nodes.push_back(rng() % nodeCount);
+    }
+
+    // Full pass over all nodes as done before dirty tracking: propagate flags to children, then find changed ranges.
+    std::vector<uint8_t> changed(nodeCount);
+    std::vector<uint32_t> changedNodes;
+    size_t fullCount = 0;
+    auto t0 = CpuTimer::getCurrentTimePoint();
+    for (const auto& nodes : markedNodes)
+    {
+        std::fill(changed.begin(), changed.end(), 0);
+        for (uint32_t nodeID : nodes) changed[nodeID] = 1;
+        changedNodes.clear();
+        for (uint32_t i = 0; i < nodeCount; i++)
+        {
+            if (parents[i] != NodeID::Invalid() && changed[parents[i].get()]) changed[i] = 1;
+            if (changed[i]) changedNodes.push_back(i);
+        }
+        fullCount += changedNodes.size();
+    }
+    auto t1 = CpuTimer::getCurrentTimePoint();
+    size_t trackedCount = 0;
+    for (const auto& nodes : markedNodes)
+    {
+        tracker.clear();
+        for (uint32_t nodeID : nodes) tracker.markDirty(nodeID);
+        tracker.propagate();
+        trackedCount += tracker.getDirtyNodes().size();
+    }
+    auto t2 = CpuTimer::getCurrentTimePoint();
+    EXPECT_EQ(fullCount, trackedCount);
+
+    double fullTime = CpuTimer::calcDuration(t0, t1) / frameCount;
+    double trackedTime = CpuTimer::calcDuration(t1, t2) / frameCount;
+    logInfo(
+        "Change propagation in {} nodes, {} changed per frame: full pass {:.3f} ms/frame, tracked {:.3f} ms/frame ({:.1f}x)",
+        nodeCount,
+        fullCount / frameCount,
+        fullTime,
+        trackedTime,
+        fullTime / trackedTime
+    );
+}
+} // namespace Falcor
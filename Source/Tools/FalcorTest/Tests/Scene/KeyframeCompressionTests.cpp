@@ -0,0 +1,234 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/Animation/KeyframeCompression.h"
+#include "Utils/Timing/CpuTimer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+
+namespace Falcor
+{
+namespace
+{
+/// Generates a grid mesh animated by a travelling wave. Texture coordinates are static, normals and tangents follow the wave.
+std::vector<std::vector<PackedStaticVertexData>> createWaveAnimation(uint32_t gridSize, uint32_t keyframeCount, float scale)
+{
+    std::vector<std::vector<PackedStaticVertexData>> keyframes(keyframeCount);
+    for (uint32_t k = 0; k < keyframeCount; k++)
+    {
+        float phase = 0.2f * k;
+        keyframes[k].resize(gridSize * gridSize);
+        for (uint32_t y = 0; y < gridSize; y++)
+        {
+            for (uint32_t x = 0; x < gridSize; x++)
+            {
+                float u = float(x) / (gridSize - 1);
+                float v = float(y) / (gridSize - 1);
+                float height = 0.05f * std::sin(10.f * u + phase) * std::cos(7.f * v + 0.5f * phase);
+                float dhdu = 0.5f * std::cos(10.f * u + phase) * std::cos(7.f * v + 0.5f * phase);
+
+                StaticVertexData vertex = {};
+                vertex.position = scale * float3(u, height, v);
+                vertex.normal = normalize(float3(-dhdu, 1.f, 0.f));
+                vertex.tangent = float4(normalize(float3(1.f, dhdu, 0.f)), 1.f);
+                vertex.texCrd = float2(u, v);
+                keyframes[k][y * gridSize + x].pack(vertex);
+            }
+        }
+    }
+    return keyframes;
+}
+
+/// Generates curve strands swaying around their roots, with the whole set drifting away from the origin.
+std::vector<std::vector<DynamicCurveVertexData>> createCurveAnimation(uint32_t strandCount, uint32_t pointsPerStrand, uint32_t keyframeCount, float3 offset)
+{
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> dist(0.f, 1.f);
+    std::vector<float3> roots(strandCount);
+    for (auto& root : roots)
+        root = float3(dist(rng), 0.f, dist(rng));
+
+    std::vector<std::vector<DynamicCurveVertexData>> keyframes(keyframeCount);
+    for (uint32_t k = 0; k < keyframeCount; k++)
+    {
+        keyframes[k].resize(strandCount * pointsPerStrand);
+        for (uint32_t s = 0; s < strandCount; s++)
+        {
+            for (uint32_t p = 0; p < pointsPerStrand; p++)
+            {
+                float t = float(p) / pointsPerStrand;
+                float sway = 0.02f * t * t * std::sin(0.3f * k + 5.f * roots[s].x);
+                keyframes[k][s * pointsPerStrand + p].position = offset + roots[s] + float3(sway, 0.1f * t, 0.f) + float3(0.001f * k);
+            }
+        }
+    }
+    return keyframes;
+}
+
+/// Decodes all keyframes and checks positions against the error bound, and all other lanes for exact equality.
+template<typename T>
+float checkDecode(CPUUnitTestContext& ctx, const CompressedKeyframes& compressed, const std::vector<std::vector<T>>& keyframes)
+{
+    float maxError = 0.f;
+    std::vector<T> decoded;
+    for (uint32_t k = 0; k < keyframes.size(); k++)
+    {
+        compressed.decode(k, decoded);
+        ASSERT_EQ(decoded.size(), keyframes[k].size());
+        for (size_t v = 0; v < decoded.size(); v++)
+        {
+            float3 error = abs(decoded[v].position - keyframes[k][v].position);
+            maxError = std::max({maxError, error.x, error.y, error.z});
+            EXPECT(std::memcmp((const uint8_t*)&decoded[v] + sizeof(float3), (const uint8_t*)&keyframes[k][v] + sizeof(float3), sizeof(T) - sizeof(float3)) == 0)
+                << "keyframe " << k << " vertex " << v;
+        }
+    }
+    EXPECT_LE(maxError, compressed.getErrorBound());
+    return maxError;
+}
+
+double getCompressionRatio(const CompressedKeyframes& compressed)
+{
+    return double(compressed.getUncompressedSize()) / compressed.getCompressedSize();
+}
+} // namespace
+
+CPU_TEST(KeyframeCompression_Mesh)
+{
+    // Large enough to be decoded in parallel.
+    auto keyframes = createWaveAnimation(160, 24, 1.f);
+
+    auto t0 = CpuTimer::getCurrentTimePoint();
+    auto compressed = CompressedKeyframes::compress(keyframes, 1e-4f);
+    auto t1 = CpuTimer::getCurrentTimePoint();
+
+    EXPECT_EQ(compressed.getKeyframeCount(), 24u);
+    EXPECT_EQ(compressed.getVertexCount(), 160u * 160u);
+    EXPECT_EQ(compressed.getLaneCount(), 8u);
+    EXPECT_EQ(compressed.getErrorBound(), 1e-4f);
+
+    std::vector<PackedStaticVertexData> decoded;
+    auto t2 = CpuTimer::getCurrentTimePoint();
+    for (uint32_t k = 0; k < compressed.getKeyframeCount(); k++)
+        compressed.decode(k, decoded);
+    auto t3 = CpuTimer::getCurrentTimePoint();
+
+    float maxError = checkDecode(ctx, compressed, keyframes);
+    double ratio = getCompressionRatio(compressed);
+    EXPECT_GT(ratio, 1.5);
+
+    double decodeTime = CpuTimer::calcDuration(t2, t3);
+    logInfo(
+        "Mesh keyframes: {:.2f}x compression, max error {} (bound {}), compress {:.1f} ms, decode {:.1f} ms ({:.0f} MB/s)",
+        ratio,
+        maxError,
+        compressed.getErrorBound(),
+        CpuTimer::calcDuration(t0, t1),
+        decodeTime,
+        compressed.getUncompressedSize() / (decodeTime * 1e3)
+    );
+}
+
+CPU_TEST(KeyframeCompression_Curves)
+{
+    // The offset makes the positions large compared to their extent.
+    auto keyframes = createCurveAnimation(500, 16, 40, float3(1000.f, 0.f, -500.f));
+    auto compressed = CompressedKeyframes::compress(keyframes, 1e-4f);
+    EXPECT_EQ(compressed.getLaneCount(), 3u);
+
+    float maxError = checkDecode(ctx, compressed, keyframes);
+    double ratio = getCompressionRatio(compressed);
+    EXPECT_GT(ratio, 1.5);
+    logInfo("Curve keyframes: {:.2f}x compression, max error {} (bound {})", ratio, maxError, compressed.getErrorBound());
+}
+
+CPU_TEST(KeyframeCompression_ErrorBounds)
+{
+    auto keyframes = createWaveAnimation(32, 16, 1.f);
+    auto scaledKeyframes = createWaveAnimation(32, 16, 10.f);
+
+    // Looser bounds compress better. The bound scales with the extent of the mesh.
+    double prevRatio = 0.0;
+    for (float relativeErrorBound : {1e-6f, 1e-4f, 1e-2f})
+    {
+        auto compressed = CompressedKeyframes::compress(keyframes, relativeErrorBound);
+        checkDecode(ctx, compressed, keyframes);
+        double ratio = getCompressionRatio(compressed);
+        EXPECT_GE(ratio, prevRatio);
+        prevRatio = ratio;
+
+        auto scaled = CompressedKeyframes::compress(scaledKeyframes, relativeErrorBound);
+        checkDecode(ctx, scaled, scaledKeyframes);
+        EXPECT_EQ(scaled.getErrorBound(), 10.f * compressed.getErrorBound());
+
+        logInfo("Relative error bound {}: {:.2f}x compression", relativeErrorBound, ratio);
+    }
+}
+
+CPU_TEST(KeyframeCompression_Static)
+{
+    // Keyframes equal to the reference keyframe only store the reference keyframe and the residual widths.
+    auto keyframes = createWaveAnimation(16, 1, 1.f);
+    keyframes.resize(10, keyframes.front());
+    auto compressed = CompressedKeyframes::compress(keyframes, 1e-4f);
+    EXPECT_EQ(compressed.getCompressedSize(), 16u * 16u * sizeof(PackedStaticVertexData) + 10u * 11u);
+
+    std::vector<PackedStaticVertexData> decoded;
+    for (uint32_t k = 0; k < keyframes.size(); k++)
+    {
+        compressed.decode(k, decoded);
+        EXPECT(std::memcmp(decoded.data(), keyframes[k].data(), decoded.size() * sizeof(PackedStaticVertexData)) == 0);
+    }
+}
+
+CPU_TEST(KeyframeCompression_Invalid)
+{
+    std::vector<std::vector<DynamicCurveVertexData>> keyframes;
+    EXPECT_THROW(CompressedKeyframes::compress(keyframes, 1e-4f));
+
+    keyframes = createCurveAnimation(4, 4, 3, float3(0.f));
+    EXPECT_THROW(CompressedKeyframes::compress(keyframes, 0.f));
+
+    auto compressed = CompressedKeyframes::compress(keyframes, 1e-4f);
+    std::vector<DynamicCurveVertexData> decoded;
+    EXPECT_THROW(compressed.decode(3, decoded));
+    std::vector<PackedStaticVertexData> wrongType;
+    EXPECT_THROW(compressed.decode(0, wrongType));
+
+    keyframes[1].pop_back();
+    EXPECT_THROW(CompressedKeyframes::compress(keyframes, 1e-4f));
+
+    keyframes = createCurveAnimation(4, 4, 3, float3(0.f));
+    keyframes[2][5].position.y = std::numeric_limits<float>::infinity();
+    EXPECT_THROW(CompressedKeyframes::compress(keyframes, 1e-4f));
+}
+} // namespace Falcor
@@ -0,0 +1,270 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/LoopSubdivide.h"
+#include "Utils/Timing/CpuTimer.h"
+#include <BS_thread_pool.hpp>
+#include <cstring>
+
+namespace Falcor
+{
+namespace
+{
+// Expected results were generated with the previous pointer-based implementation ported from pbrt.
+// Larger results are compared by FNV-1a checksums, which are independent of the hash functions in Utils.
+
+const std::vector<float3> kTetrahedronPositions = {
+    float3(1, 1, 1), float3(-1, -1, 1), float3(-1, 1, -1), float3(1, -1, -1),
+};
+const std::vector<uint32_t> kTetrahedronIndices = {0, 1, 2, 0, 3, 1, 0, 2, 3, 1, 3, 2};
+
+const LoopSubdivideResult kTetrahedronLevel1 = {
+    {
+        {0.199999988f, 0.199999988f, 0.199999988f},
+        {-0.199999988f, -0.199999988f, 0.199999988f},
+        {-0.199999988f, 0.199999988f, -0.199999988f},
+        {0.199999988f, -0.199999988f, -0.199999988f},
+        {1.86264515e-09f, 3.7252903e-09f, 0.291666687f},
+        {-0.291666687f, -1.86264515e-09f, 3.7252903e-09f},
+        {-3.7252903e-09f, 0.291666687f, -1.86264515e-09f},
+        {0.291666687f, 1.86264515e-09f, 3.7252903e-09f},
+        {3.7252903e-09f, -0.291666687f, -1.86264515e-09f},
+        {-1.86264515e-09f, 3.7252903e-09f, -0.291666687f},
+    },
+    {
+        {0.0736723095f, 0.0736723095f, 0.073672317f},
+        {-0.0736723095f, -0.0736723095f, 0.073672317f},
+        {-0.0736723095f, 0.073672317f, -0.0736723095f},
+        {0.073672317f, -0.0736723095f, -0.0736723095f},
+        {1.2044465e-08f, -3.57570062e-09f, 0.698834479f},
+        {-0.698834479f, -1.2044465e-08f, -3.57570062e-09f},
+        {3.57570062e-09f, 0.698834479f, -1.2044465e-08f},
+        {0.698834479f, 1.33349438e-08f, -6.74812695e-09f},
+        {1.58621305e-09f, -0.698834479f, 6.45239528e-10f},
+        {-6.45239528e-10f, -1.58621305e-09f, -0.698834479f},
+    },
+    {
+        0, 4, 6, 4, 1, 5, 6, 5, 2, 4, 5, 6,
+        0, 7, 4, 7, 3, 8, 4, 8, 1, 7, 8, 4,
+        0, 6, 7, 6, 2, 9, 7, 9, 3, 6, 9, 7,
+        1, 8, 5, 8, 3, 9, 5, 9, 2, 8, 9, 5,
+    },
+};
+
+// Open fan of three triangles, all vertices are on the boundary.
+const std::vector<float3> kFanPositions = {
+    float3(0, 0, 1), float3(1, 0, 0), float3(0, 1, 0), float3(-1, 0, 0), float3(0, -1, 0),
+};
+const std::vector<uint32_t> kFanIndices = {0, 1, 2, 0, 2, 3, 0, 3, 4};
+
+const LoopSubdivideResult kFanLevel1 = {
+    {
+        {0.175000012f, -0.175000012f, 0.650000036f},
+        {0.650000036f, 0.175000012f, 0.175000012f},
+        {0.f, 0.650000036f, 0.f},
+        {-0.650000036f, 0.f, 0.f},
+        {-0.175000012f, -0.650000036f, 0.175000012f},
+        {0.475000024f, 0.f, 0.475000024f},
+        {0.450000018f, 0.475000024f, 0.0250000004f},
+        {0.0208333358f, 0.322916657f, 0.322916687f},
+        {-0.450000018f, 0.450000018f, 0.f},
+        {-0.322916657f, -0.0208333321f, 0.322916657f},
+        {-0.475000024f, -0.450000018f, 0.0250000004f},
+        {0.f, -0.475000024f, 0.475000024f},
+    },
+    {
+        {0.455208391f, -0.455208391f, -1.35770845f},
+        {-0.127499998f, -0.172499999f, -0.175000012f},
+        {0.0162500031f, -0.29010421f, -0.294895887f},
+        {0.290104181f, -0.0162500031f, -0.294895887f},
+        {0.172499999f, 0.127499998f, -0.175000012f},
+        {-0.380312532f, -0.90843755f, -1.04968762f},
+        {-0.453541666f, -0.9887501f, -0.999166846f},
+        {0.240186989f, -1.48554957f, -1.91847205f},
+        {0.839583457f, -0.839583457f, -1.2295835f},
+        {1.48554969f, -0.240186661f, -1.91847181f},
+        {0.9887501f, 0.453541666f, -0.999166846f},
+        {0.90843761f, 0.380312473f, -1.04968762f},
+    },
+    {
+        0, 5, 7, 5, 1, 6, 7, 6, 2, 5, 6, 7,
+        0, 7, 9, 7, 2, 8, 9, 8, 3, 7, 8, 9,
+        0, 9, 11, 9, 3, 10, 11, 10, 4, 9, 10, 11,
+    },
+};
+
+/// Create a grid of n x n quads with perturbed vertices, split into triangles along alternating diagonals.
+void createGrid(uint32_t n, std::vector<float3>& positions, std::vector<uint32_t>& indices)
+{
+    positions.clear();
+    indices.clear();
+    for (uint32_t y = 0; y <= n; ++y)
+    {
+        for (uint32_t x = 0; x <= n; ++x)
+            positions.push_back(float3(x + 0.1f * ((x * 7 + y * 3) % 5), y + 0.1f * ((x * 5 + y * 11) % 7), 0.05f * ((x + 2 * y) % 3)));
+    }
+    for (uint32_t y = 0; y < n; ++y)
+    {
+        for (uint32_t x = 0; x < n; ++x)
+        {
+            uint32_t a = y * (n + 1) + x, b = a + 1, c = a + n + 1, d = c + 1;
+            if ((x + y) % 3 == 0)
+                indices.insert(indices.end(), {a, b, d, a, d, c});
+            else
+                indices.insert(indices.end(), {a, b, c, b, d, c});
+        }
+    }
+}
+
+/// Compute the 64-bit FNV-1a checksum of the raw bytes of an array.
+template<typename T>
+uint64_t checksum(const std::vector<T>& data)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(data.data());
+    for (size_t i = 0; i < data.size() * sizeof(T); ++i)
+    {
+        hash ^= pBytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+bool isEqual(const LoopSubdivideResult& a, const LoopSubdivideResult& b)
+{
+    return a.positions.size() == b.positions.size() && a.normals.size() == b.normals.size() && a.indices == b.indices &&
+           std::memcmp(a.positions.data(), b.positions.data(), a.positions.size() * sizeof(float3)) == 0 &&
+           std::memcmp(a.normals.data(), b.normals.data(), a.normals.size() * sizeof(float3)) == 0;
+}
+
+void checkResult(CPUUnitTestContext& ctx, const LoopSubdivideResult& result, const LoopSubdivideResult& expected)
+{
+    ASSERT_EQ(result.positions.size(), expected.positions.size());
+    ASSERT_EQ(result.normals.size(), expected.normals.size());
+    EXPECT(result.indices == expected.indices);
+
+    // Positions are bit-exact, normals use std::sin/std::cos and are compared with a tolerance.
+    for (size_t i = 0; i < expected.positions.size(); ++i)
+    {
+        EXPECT(all(result.positions[i] == expected.positions[i])) << "position " << i;
+        EXPECT_LE(length(result.normals[i] - expected.normals[i]), 1e-5f) << "normal " << i;
+    }
+}
+} // namespace
+
+CPU_TEST(LoopSubdivide_Closed)
+{
+    auto result = loopSubdivide(1, kTetrahedronPositions, kTetrahedronIndices);
+    checkResult(ctx, result, kTetrahedronLevel1);
+
+    // Level 0 only pushes the vertices to the limit surface.
+    result = loopSubdivide(0, kTetrahedronPositions, kTetrahedronIndices);
+    EXPECT_EQ(result.positions.size(), 4);
+    EXPECT(result.indices == kTetrahedronIndices);
+}
+
+CPU_TEST(LoopSubdivide_Boundary)
+{
+    auto result = loopSubdivide(1, kFanPositions, kFanIndices);
+    checkResult(ctx, result, kFanLevel1);
+}
+
+CPU_TEST(LoopSubdivide_Levels)
+{
+    std::vector<float3> positions;
+    std::vector<uint32_t> indices;
+    createGrid(16, positions, indices);
+
+    struct Expected
+    {
+        size_t vertexCount;
+        size_t indexCount;
+        uint64_t positionsChecksum;
+        uint64_t indicesChecksum;
+    };
+    const Expected expected[] = {
+        {1089, 6144, 0x64f2c2a70d58f1e6ull, 0x28b1b07d8b75e8e7ull},
+        {4225, 24576, 0x6978d9220d19a9a7ull, 0x8b6f272eea177d6aull},
+        {16641, 98304, 0x6c5592228598b740ull, 0xcbc70bc0561bd22aull},
+    };
+
+    BS::thread_pool threadPool(4);
+    for (uint32_t level = 1; level <= 3; ++level)
+    {
+        auto result = loopSubdivide(level, positions, indices);
+        const auto& e = expected[level - 1];
+        EXPECT_EQ(result.positions.size(), e.vertexCount);
+        EXPECT_EQ(result.indices.size(), e.indexCount);
+        EXPECT_EQ(checksum(result.positions), e.positionsChecksum) << "level " << level;
+        EXPECT_EQ(checksum(result.indices), e.indicesChecksum) << "level " << level;
+
+        // The result must not depend on the threading.
+        EXPECT(isEqual(loopSubdivide(level, positions, indices, &threadPool), result)) << "level " << level;
+    }
+}
+
+CPU_TEST(LoopSubdivide_Invalid)
+{
+    // Index out of range.
+    EXPECT_THROW(loopSubdivide(1, kFanPositions, std::vector<uint32_t>{0, 1, 5}));
+    // Incomplete triangle.
+    EXPECT_THROW(loopSubdivide(1, kFanPositions, std::vector<uint32_t>{0, 1, 2, 0}));
+    // Unreferenced vertex.
+    EXPECT_THROW(loopSubdivide(1, kFanPositions, std::vector<uint32_t>{0, 1, 2}));
+}
+
+CPU_TEST(LoopSubdivide_Benchmark, TAGS("benchmark"))
+{
+    std::vector<float3> positions;
+    std::vector<uint32_t> indices;
+    createGrid(256, positions, indices);
+
+    BS::thread_pool threadPool;
+    for (uint32_t level = 1; level <= 3; ++level)
+    {
+        auto t0 = CpuTimer::getCurrentTimePoint();
+        auto serial = loopSubdivide(level, positions, indices);
+        auto t1 = CpuTimer::getCurrentTimePoint();
+        auto parallel = loopSubdivide(level, positions, indices, &threadPool);
+        auto t2 = CpuTimer::getCurrentTimePoint();
+        EXPECT(isEqual(serial, parallel));
+
+        double serialTime = CpuTimer::calcDuration(t0, t1);
+        double parallelTime = CpuTimer::calcDuration(t1, t2);
+        logInfo(
+            "Loop subdivision level {} ({} triangles): 1 thread {:.1f} ms, {} threads {:.1f} ms, speedup {:.2f}x",
+            level,
+            parallel.indices.size() / 3,
+            serialTime,
+            threadPool.get_thread_count(),
+            parallelTime,
+            serialTime / parallelTime
+        );
+    }
+}
+} // namespace Falcor
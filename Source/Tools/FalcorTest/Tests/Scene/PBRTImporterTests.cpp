@@ -0,0 +1,215 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Core/Plugin.h"
+#include "Core/Platform/OS.h"
+#include "Scene/SceneBuilder.h"
+#include "Utils/Timing/CpuTimer.h"
+
+#include <zlib.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace Falcor
+{
+namespace
+{
+/**
+ * Writes a scene made of a main file and a number of shape files, which are pulled in with either 'Include' or 'Import'.
+ * Each shape file is self-contained, so both variants describe the same scene.
+ * @param[in] dir Directory to write to.
+ * @param[in] fileCount Number of shape files.
+ * @param[in] shapeCount Number of triangle meshes per shape file.
+ * @param[in] instanced If false, the shapes are placed in object definitions that are never instanced.
+ * @return Paths to the main file using 'Include' and the main file using 'Import'.
+ */
+std::pair<std::filesystem::path, std::filesystem::path> writeScene(
+    const std::filesystem::path& dir,
+    uint32_t fileCount,
+    uint32_t shapeCount,
+    bool instanced
+)
+{
+    std::filesystem::create_directories(dir);
+
+    std::string header = "LookAt 0 0 10  0 0 0  0 1 0\nCamera \"perspective\"\nWorldBegin\nMaterial \"diffuse\"\n";
+    std::string includeScene = header;
+    std::string importScene = header;
+
+    for (uint32_t f = 0; f < fileCount; ++f)
+    {
+        std::string filename = fmt::format("shapes{}.pbrt", f);
+        std::ofstream file(dir / filename);
+        file << "AttributeBegin\n";
+        file << fmt::format("Translate {} 0 0\n", f);
+        file << fmt::format("MakeNamedMaterial \"material{}\" \"string type\" \"diffuse\" \"rgb reflectance\" [0.5 {} 0.5]\n", f, 0.1f * (f % 10));
+        file << fmt::format("NamedMaterial \"material{}\"\n", f);
+        if (!instanced)
+            file << fmt::format("ObjectBegin \"object{}\"\n", f);
+        for (uint32_t s = 0; s < shapeCount; ++s)
+        {
+            // Strip of 100 triangles.
+            file << fmt::format("AttributeBegin\nTranslate 0 {} 0\nShape \"trianglemesh\" \"point3 P\" [", s);
+            for (uint32_t v = 0; v < 102; ++v)
+                file << fmt::format(" {} {} {}", 0.1f * (v / 2), 0.1f * (v % 2), 0.01f * s);
+            file << " ] \"integer indices\" [";
+            for (uint32_t t = 0; t < 100; ++t)
+                file << fmt::format(" {} {} {}", t, t + 1, t + 2);
+            file << " ]\nAttributeEnd\n";
+        }
+        if (!instanced)
+            file << "ObjectEnd\n";
+        file << "AttributeEnd\n";
+
+        includeScene += fmt::format("Include \"{}\"\n", filename);
+        importScene += fmt::format("Import \"{}\"\n", filename);
+
+        // Shapes in the main file between the imports.
+        std::string sphere = fmt::format("AttributeBegin\nTranslate 0 0 {}\nShape \"sphere\" \"float radius\" 0.5\nAttributeEnd\n", f);
+        includeScene += sphere;
+        importScene += sphere;
+    }
+
+    auto includePath = dir / "include.pbrt";
+    auto importPath = dir / "import.pbrt";
+    std::ofstream(includePath) << includeScene;
+    std::ofstream(importPath) << importScene;
+    return {includePath, importPath};
+}
+
+/**
+ * Writes a scene and a gzip compressed copy of it.
+ * The scene is larger than the chunks the tokenizer streams compressed files in, and contains a token (a material name)
+ * that is longer than a chunk, so tokens cross chunk boundaries.
+ * @param[in] dir Directory to write to.
+ * @return Paths to the plain and the compressed file.
+ */
+std::pair<std::filesystem::path, std::filesystem::path> writeGzipScene(const std::filesystem::path& dir)
+{
+    std::filesystem::create_directories(dir);
+
+    std::string longName(1500000, 'm');
+    longName[700000] = '\\';
+    longName[700001] = '"';
+
+    std::string scene = "LookAt 0 0 10  0 0 0  0 1 0\nCamera \"perspective\"\nWorldBegin\n";
+    scene += fmt::format("MakeNamedMaterial \"{}\" \"string type\" \"diffuse\"\n# Comment\n", longName);
+    scene += fmt::format("NamedMaterial \"{}\"\n", longName);
+    for (uint32_t s = 0; s < 10000; ++s)
+    {
+        scene += fmt::format("AttributeBegin\nTranslate {} {} {}\n", 0.123456f * s, -0.654321f * s, 1e-3f * s);
+        scene += "Shape \"trianglemesh\" \"point3 P\" [ 0 0 0  1 0 0  0 1 0 ] \"integer indices\" [ 0 1 2 ]\nAttributeEnd\n";
+    }
+
+    auto plainPath = dir / "scene.pbrt";
+    auto gzipPath = dir / "scene.pbrt.gz";
+    std::ofstream(plainPath, std::ios::binary) << scene;
+    gzFile file = gzopen(gzipPath.string().c_str(), "wb");
+    FALCOR_ASSERT(file);
+    gzwrite(file, scene.data(), (unsigned)scene.size());
+    gzclose(file);
+    return {plainPath, gzipPath};
+}
+} // namespace
+
+GPU_TEST(PBRTImporter_Import)
+{
+    PluginManager::instance().loadPluginByName("PBRTImporter");
+
+    auto dir = getTempFilePath();
+    auto [includePath, importPath] = writeScene(dir, 8, 4, true);
+
+    SceneBuilder includeBuilder(ctx.getDevice(), includePath, Settings());
+    SceneBuilder importBuilder(ctx.getDevice(), importPath, Settings());
+    std::filesystem::remove_all(dir);
+
+    // Imported files are parsed in parallel, but the scene must match the one using 'Include' exactly.
+    ASSERT_EQ(importBuilder.getNodeCount(), includeBuilder.getNodeCount());
+    for (uint32_t i = 0; i < includeBuilder.getNodeCount(); ++i)
+    {
+        const auto& expected = includeBuilder.getNode(NodeID(i));
+        const auto& node = importBuilder.getNode(NodeID(i));
+        EXPECT_EQ(node.name, expected.name);
+        EXPECT(node.transform == expected.transform) << "node " << i;
+    }
+
+    ASSERT_EQ(importBuilder.getMaterials().size(), includeBuilder.getMaterials().size());
+    for (size_t i = 0; i < includeBuilder.getMaterials().size(); ++i)
+        EXPECT_EQ(importBuilder.getMaterials()[i]->getName(), includeBuilder.getMaterials()[i]->getName());
+}
+
+GPU_TEST(PBRTImporter_Gzip)
+{
+    PluginManager::instance().loadPluginByName("PBRTImporter");
+
+    auto dir = getTempFilePath();
+    auto [plainPath, gzipPath] = writeGzipScene(dir);
+
+    SceneBuilder plainBuilder(ctx.getDevice(), plainPath, Settings());
+    SceneBuilder gzipBuilder(ctx.getDevice(), gzipPath, Settings());
+    std::filesystem::remove_all(dir);
+
+    // The streamed file must tokenize exactly like the memory-mapped one.
+    ASSERT_EQ(gzipBuilder.getNodeCount(), plainBuilder.getNodeCount());
+    for (uint32_t i = 0; i < plainBuilder.getNodeCount(); ++i)
+    {
+        const auto& expected = plainBuilder.getNode(NodeID(i));
+        const auto& node = gzipBuilder.getNode(NodeID(i));
+        EXPECT_EQ(node.name, expected.name);
+        EXPECT(node.transform == expected.transform) << "node " << i;
+    }
+
+    ASSERT_EQ(gzipBuilder.getMaterials().size(), plainBuilder.getMaterials().size());
+    for (size_t i = 0; i < plainBuilder.getMaterials().size(); ++i)
+        EXPECT(gzipBuilder.getMaterials()[i]->getName() == plainBuilder.getMaterials()[i]->getName()) << "material " << i;
+}
+
+GPU_TEST(PBRTImporter_ImportBenchmark, TAGS("benchmark"))
+{
+    PluginManager::instance().loadPluginByName("PBRTImporter");
+
+    // The shapes are in object definitions that are never instanced and thus not built, so the import is dominated by parsing.
+    auto dir = getTempFilePath();
+    auto [includePath, importPath] = writeScene(dir, 32, 500, false);
+
+    auto measure = [&](const std::filesystem::path& path)
+    {
+        auto t0 = CpuTimer::getCurrentTimePoint();
+        SceneBuilder builder(ctx.getDevice(), path, Settings());
+        return CpuTimer::calcDuration(t0, CpuTimer::getCurrentTimePoint());
+    };
+
+    double includeTime = measure(includePath);
+    double importTime = measure(importPath);
+    std::filesystem::remove_all(dir);
+
+    logInfo("PBRT import of 32 files: Include {:.1f} ms, Import {:.1f} ms, speedup {:.2f}x", includeTime, importTime, includeTime / importTime);
+}
+} // namespace Falcor
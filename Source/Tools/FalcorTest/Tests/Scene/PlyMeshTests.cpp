@@ -0,0 +1,310 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/PlyMesh.h"
+#include "Scene/TriangleMesh.h"
+#include "Core/Platform/OS.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+namespace Falcor
+{
+namespace
+{
+enum class Format
+{
+    Ascii,
+    BinaryLittleEndian,
+    BinaryBigEndian,
+};
+
+struct TestMesh
+{
+    std::vector<float3> positions;
+    std::vector<float3> normals;
+    std::vector<float2> texCoords;
+    std::vector<std::vector<uint32_t>> faces;
+};
+
+/// Mesh with a triangle, a quad and a pentagon.
+TestMesh createTestMesh(bool hasNormals, bool hasTexCoords)
+{
+    TestMesh mesh;
+    mesh.positions = {
+        {0.f, 0.f, 0.f}, {1.f, 0.f, 0.f}, {0.f, 1.f, 0.f}, {1.f, 1.f, 0.5f},
+        {2.f, 0.f, 0.f}, {2.f, 1.f, 0.f}, {3.f, 0.5f, 0.f}, {2.5f, 1.5f, 0.25f},
+    };
+    if (hasNormals)
+    {
+        for (size_t i = 0; i < mesh.positions.size(); ++i)
+            mesh.normals.push_back(normalize(float3(0.1f * i, 0.2f, 1.f)));
+    }
+    if (hasTexCoords)
+    {
+        for (size_t i = 0; i < mesh.positions.size(); ++i)
+            mesh.texCoords.push_back(float2(0.125f * i, 0.25f + 0.0625f * i));
+    }
+    mesh.faces = {{0, 1, 2}, {1, 4, 3, 2}, {4, 6, 7, 5, 3}};
+    return mesh;
+}
+
+template<typename T>
+void writeBinary(std::ostream& stream, T value, bool bigEndian)
+{
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    if (bigEndian)
+        std::reverse(bytes, bytes + sizeof(T));
+    stream.write(bytes, sizeof(T));
+}
+
+/// Writes the mesh, with an extra per-vertex and per-face property and an extra element that the readers should skip.
+std::string writePly(const TestMesh& mesh, Format format)
+{
+    const bool hasNormals = !mesh.normals.empty();
+    const bool hasTexCoords = !mesh.texCoords.empty();
+    const bool bigEndian = format == Format::BinaryBigEndian;
+
+    std::ostringstream stream;
+    stream << "ply\n";
+    stream << "format "
+           << (format == Format::Ascii ? "ascii" : (bigEndian ? "binary_big_endian" : "binary_little_endian")) << " 1.0\n";
+    stream << "comment Falcor test mesh\n";
+    stream << "element vertex " << mesh.positions.size() << "\n";
+    stream << "property float x\nproperty float y\nproperty float z\n";
+    stream << "property uchar confidence\n";
+    if (hasNormals)
+        stream << "property float nx\nproperty float ny\nproperty float nz\n";
+    if (hasTexCoords)
+        stream << "property float u\nproperty float v\n";
+    stream << "element face " << mesh.faces.size() << "\n";
+    stream << "property uchar flags\n";
+    stream << "property list uchar int vertex_indices\n";
+    stream << "element material 1\n";
+    stream << "property list ushort double values\n";
+    stream << "end_header\n";
+
+    if (format == Format::Ascii)
+    {
+        stream << std::setprecision(9);
+        for (size_t i = 0; i < mesh.positions.size(); ++i)
+        {
+            const float3& p = mesh.positions[i];
+            stream << p.x << " " << p.y << " " << p.z << " " << i;
+            if (hasNormals)
+                stream << " " << mesh.normals[i].x << " " << mesh.normals[i].y << " " << mesh.normals[i].z;
+            if (hasTexCoords)
+                stream << " " << mesh.texCoords[i].x << " " << mesh.texCoords[i].y;
+            stream << "\n";
+        }
+        for (const auto& face : mesh.faces)
+        {
+            stream << "7 " << face.size();
+            for (uint32_t index : face)
+                stream << " " << index;
+            stream << "\n";
+        }
+        stream << "2 0.5 -1.5\n";
+    }
+    else
+    {
+        for (size_t i = 0; i < mesh.positions.size(); ++i)
+        {
+            const float3& p = mesh.positions[i];
+            writeBinary(stream, p.x, bigEndian);
+            writeBinary(stream, p.y, bigEndian);
+            writeBinary(stream, p.z, bigEndian);
+            writeBinary(stream, (uint8_t)i, bigEndian);
+            if (hasNormals)
+            {
+                writeBinary(stream, mesh.normals[i].x, bigEndian);
+                writeBinary(stream, mesh.normals[i].y, bigEndian);
+                writeBinary(stream, mesh.normals[i].z, bigEndian);
+            }
+            if (hasTexCoords)
+            {
+                writeBinary(stream, mesh.texCoords[i].x, bigEndian);
+                writeBinary(stream, mesh.texCoords[i].y, bigEndian);
+            }
+        }
+        for (const auto& face : mesh.faces)
+        {
+            writeBinary(stream, (uint8_t)7, bigEndian);
+            writeBinary(stream, (uint8_t)face.size(), bigEndian);
+            for (uint32_t index : face)
+                writeBinary(stream, (int32_t)index, bigEndian);
+        }
+        writeBinary(stream, (uint16_t)2, bigEndian);
+        writeBinary(stream, 0.5, bigEndian);
+        writeBinary(stream, -1.5, bigEndian);
+    }
+
+    return stream.str();
+}
+
+std::filesystem::path writePlyFile(const TestMesh& mesh, Format format)
+{
+    std::filesystem::path path = getTempFilePath();
+    path += ".ply";
+    std::ofstream file(path, std::ios::binary);
+    file << writePly(mesh, format);
+    return path;
+}
+
+void checkMesh(CPUUnitTestContext& ctx, const PlyMesh& plyMesh, const TestMesh& mesh)
+{
+    ASSERT_EQ(plyMesh.getVertexCount(), mesh.positions.size());
+    ASSERT_EQ(plyMesh.normals.size(), mesh.normals.size());
+    ASSERT_EQ(plyMesh.texCoords.size(), mesh.texCoords.size());
+
+    for (size_t i = 0; i < mesh.positions.size(); ++i)
+    {
+        EXPECT(all(plyMesh.positions[i] == mesh.positions[i])) << "vertex " << i;
+        if (!mesh.normals.empty())
+            EXPECT(all(plyMesh.normals[i] == mesh.normals[i])) << "vertex " << i;
+        if (!mesh.texCoords.empty())
+            EXPECT(all(plyMesh.texCoords[i] == mesh.texCoords[i])) << "vertex " << i;
+    }
+
+    // Polygons are triangulated as fans.
+    std::vector<uint32_t> indices;
+    for (const auto& face : mesh.faces)
+    {
+        for (size_t i = 2; i < face.size(); ++i)
+            indices.insert(indices.end(), {face[0], face[i - 1], face[i]});
+    }
+    EXPECT(plyMesh.indices == indices);
+}
+} // namespace
+
+CPU_TEST(PlyMesh_Formats)
+{
+    for (Format format : {Format::Ascii, Format::BinaryLittleEndian, Format::BinaryBigEndian})
+    {
+        for (uint32_t variant = 0; variant < 4; ++variant)
+        {
+            TestMesh mesh = createTestMesh(variant & 1, variant & 2);
+            std::string data = writePly(mesh, format);
+            PlyMesh plyMesh = PlyMesh::createFromMemory(data.data(), data.size());
+            checkMesh(ctx, plyMesh, mesh);
+
+            // Same through the memory mapped file.
+            std::filesystem::path path = writePlyFile(mesh, format);
+            checkMesh(ctx, PlyMesh::createFromFile(path), mesh);
+            std::filesystem::remove(path);
+        }
+    }
+}
+
+CPU_TEST(PlyMesh_FaceNormals)
+{
+    std::string data = writePly(createTestMesh(false, false), Format::Ascii);
+    PlyMesh plyMesh = PlyMesh::createFromMemory(data.data(), data.size());
+    std::vector<float3> faceNormals = plyMesh.computeFaceNormals();
+    ASSERT_EQ(faceNormals.size(), plyMesh.getTriangleCount());
+
+    for (size_t i = 0; i < faceNormals.size(); ++i)
+    {
+        const float3& p0 = plyMesh.positions[plyMesh.indices[i * 3 + 0]];
+        const float3& p1 = plyMesh.positions[plyMesh.indices[i * 3 + 1]];
+        const float3& p2 = plyMesh.positions[plyMesh.indices[i * 3 + 2]];
+        EXPECT_LE(std::abs(length(faceNormals[i]) - 1.f), 1e-6f);
+        EXPECT_LE(std::abs(dot(faceNormals[i], p1 - p0)), 1e-6f);
+        EXPECT_LE(std::abs(dot(faceNormals[i], p2 - p0)), 1e-6f);
+    }
+}
+
+CPU_TEST(PlyMesh_Invalid)
+{
+    auto load = [](const std::string& data) { return PlyMesh::createFromMemory(data.data(), data.size()); };
+
+    const std::string header = "ply\nformat ascii 1.0\nelement vertex 3\nproperty float x\nproperty float y\nproperty float z\n"
+                               "element face 1\nproperty list uchar int vertex_indices\nend_header\n";
+    EXPECT_THROW(load(""));
+    EXPECT_THROW(load("obj\n"));
+    EXPECT_THROW(load(header + "0 0 0 1 0 0 0 1 0\n3 0 1 3\n")); // Index out of range.
+    EXPECT_THROW(load(header + "0 0 0 1 0 0 0 1 0\n3 0 1\n"));   // Truncated.
+    EXPECT_THROW(load("ply\nformat binary_little_endian 1.0\nelement vertex 1\nproperty float x\nproperty float y\nproperty float z\nend_header\n"));
+
+    // Corrupt counts must be reported as errors before allocating storage.
+    EXPECT_THROW_AS(load(header + "0 0 0 1 0 0 0 1 0\n-1 0 1 2\n"), RuntimeError);  // Negative list count.
+    EXPECT_THROW_AS(load(header + "0 0 0 1 0 0 0 1 0\n200 0 1 2\n"), RuntimeError); // List count exceeds data.
+    EXPECT_THROW_AS(
+        load("ply\nformat ascii 1.0\nelement vertex 1000000000000000\nproperty float x\nproperty float y\nproperty float z\nend_header\n0 0 0\n"),
+        RuntimeError
+    );
+
+    std::string binary = "ply\nformat binary_little_endian 1.0\nelement vertex 3\nproperty float x\nproperty float y\nproperty float z\n"
+                         "element face 1\nproperty list int int vertex_indices\nend_header\n";
+    binary.append(9 * sizeof(float), '\0');
+    binary.append(4, '\xff'); // List count of -1.
+    EXPECT_THROW_AS(load(binary), RuntimeError);
+}
+
+CPU_TEST(PlyMesh_MatchesAssimp)
+{
+    for (Format format : {Format::Ascii, Format::BinaryLittleEndian, Format::BinaryBigEndian})
+    {
+        for (uint32_t variant = 0; variant < 4; ++variant)
+        {
+            TestMesh mesh = createTestMesh(variant & 1, variant & 2);
+            std::filesystem::path path = writePlyFile(mesh, format);
+            PlyMesh plyMesh = PlyMesh::createFromFile(path);
+            ref<TriangleMesh> pTriangleMesh = TriangleMesh::createFromFile(path);
+            std::filesystem::remove(path);
+            ASSERT(pTriangleMesh != nullptr);
+
+            // Compare triangle soups, as Assimp does not preserve the vertex order.
+            const auto& vertices = pTriangleMesh->getVertices();
+            const auto& indices = pTriangleMesh->getIndices();
+            ASSERT_EQ(indices.size(), plyMesh.indices.size());
+            std::vector<float3> faceNormals = plyMesh.computeFaceNormals();
+
+            for (size_t i = 0; i < indices.size(); ++i)
+            {
+                const TriangleMesh::Vertex& expected = vertices[indices[i]];
+                uint32_t index = plyMesh.indices[i];
+                EXPECT(all(plyMesh.positions[index] == expected.position)) << "index " << i;
+
+                float3 normal = plyMesh.normals.empty() ? faceNormals[i / 3] : plyMesh.normals[index];
+                EXPECT_LE(length(normal - expected.normal), 1e-5f) << "index " << i;
+
+                // Assimp flips texture coordinates vertically, missing texture coordinates are zero.
+                float2 texCoord = plyMesh.texCoords.empty() ? float2(0.f) : float2(plyMesh.texCoords[index].x, 1.f - plyMesh.texCoords[index].y);
+                EXPECT(all(texCoord == expected.texCoord)) << "index " << i;
+            }
+        }
+    }
+}
+} // namespace Falcor
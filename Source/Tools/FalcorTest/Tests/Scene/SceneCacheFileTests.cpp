@@ -0,0 +1,388 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/SceneCacheFile.h"
+#include "Scene/SceneTypes.slang"
+#include "Core/Platform/OS.h"
+#include "Utils/Timing/CpuTimer.h"
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
+
+namespace Falcor
+{
+namespace
+{
+const uint32_t kTestVersion = 1;
+const size_t kTestChunkSize = 64 * 1024;
+
+/// Removes the file when going out of scope.
+struct TempFile
+{
+    std::filesystem::path path = getTempFilePath();
+    ~TempFile() { std::filesystem::remove(path); }
+};
+
+std::vector<uint32_t> createIndices(size_t count)
+{
+    // Compressible, similar to the index data of a triangle strip.
+    std::vector<uint32_t> indices(count);
+    for (size_t i = 0; i < count; ++i)
+        indices[i] = (uint32_t)(i / 3 + i % 3);
+    return indices;
+}
+
+std::vector<PackedStaticVertexData> createVertices(size_t count, uint32_t seed)
+{
+    // Mostly incompressible.
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> dist(-1.f, 1.f);
+    std::vector<PackedStaticVertexData> vertices(count);
+    for (auto& v : vertices)
+    {
+        v.position = float3(dist(rng), dist(rng), dist(rng));
+        v.packedNormalTangentCurveRadius = float3(dist(rng), dist(rng), dist(rng));
+        v.texCrd = float2(dist(rng), dist(rng));
+    }
+    return vertices;
+}
+
+bool isEqual(const std::vector<PackedStaticVertexData>& a, const std::vector<PackedStaticVertexData>& b)
+{
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(PackedStaticVertexData)) == 0;
+}
+
+SceneCacheFile::Writer::Options getOptions(SceneCacheFile::Codec codec = SceneCacheFile::Codec::LZ4, uint32_t threadCount = 0)
+{
+    SceneCacheFile::Writer::Options options;
+    options.codec = codec;
+    options.chunkSize = kTestChunkSize;
+    options.threadCount = threadCount;
+    return options;
+}
+
+std::vector<char> readFileData(const std::filesystem::path& path)
+{
+    std::ifstream fs(path, std::ios_base::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(fs), std::istreambuf_iterator<char>());
+}
+
+void writeFileData(const std::filesystem::path& path, const std::vector<char>& data)
+{
+    std::ofstream fs(path, std::ios_base::binary | std::ios_base::trunc);
+    fs.write(data.data(), data.size());
+}
+
+// Offsets into the file layout, used for corrupting files.
+const size_t kTableOffsetOffset = 16;   ///< Offset of FileHeader::tableOffset.
+const size_t kSectionCodecOffset = 56;  ///< Offset of SectionEntry::codec.
+} // namespace
+
+CPU_TEST(SceneCacheFile_RoundTrip)
+{
+    TempFile file;
+
+    const std::string text = "Scene data";
+    const auto indices = createIndices(100000);
+    const auto vertices = createVertices(5000, 1);
+    const std::vector<uint32_t> empty;
+
+    {
+        SceneCacheFile::Writer writer(file.path, kTestVersion, getOptions());
+        writer.addSection("Text", text.data(), text.size());
+        writer.addSection("Indices", indices);
+        writer.addSection("Vertices", vertices);
+        writer.addSection("Empty", empty);
+        writer.finalize();
+    }
+
+    SceneCacheFile::Reader reader(file.path);
+    EXPECT_EQ(reader.getVersion(), kTestVersion);
+
+    const auto& sections = reader.getSections();
+    ASSERT_EQ(sections.size(), 4);
+    EXPECT_EQ(sections[0].name, "Text");
+    EXPECT_EQ(sections[1].name, "Indices");
+    EXPECT_EQ(sections[2].name, "Vertices");
+    EXPECT_EQ(sections[3].name, "Empty");
+
+    // Sections are split into chunks and compressible data is compressed.
+    const auto& indexInfo = reader.getSectionInfo("Indices");
+    EXPECT_EQ(indexInfo.size, indices.size() * sizeof(uint32_t));
+    EXPECT_EQ(indexInfo.chunkCount, (indexInfo.size + kTestChunkSize - 1) / kTestChunkSize);
+    EXPECT_LT(indexInfo.storedSize, indexInfo.size);
+    EXPECT_EQ(reader.getSectionInfo("Empty").chunkCount, 0);
+
+    std::string readText(reader.getSectionInfo("Text").size, '\0');
+    reader.readSection("Text", readText.data(), readText.size());
+    EXPECT_EQ(readText, text);
+
+    std::vector<uint32_t> readIndices;
+    reader.readSection("Indices", readIndices);
+    EXPECT(readIndices == indices);
+
+    std::vector<PackedStaticVertexData> readVertices;
+    reader.readSection("Vertices", readVertices);
+    EXPECT(isEqual(readVertices, vertices));
+
+    std::vector<uint32_t> readEmpty = {1, 2, 3};
+    reader.readSection("Empty", readEmpty);
+    EXPECT(readEmpty.empty());
+}
+
+CPU_TEST(SceneCacheFile_OnDemand)
+{
+    TempFile file;
+
+    const auto indices = createIndices(1000);
+    {
+        SceneCacheFile::Writer writer(file.path, kTestVersion, getOptions());
+        writer.addSection("Vertices", createVertices(20000, 2));
+        writer.addSection("Indices", indices);
+        writer.finalize();
+    }
+
+    // Sections can be read in any order and individually.
+    SceneCacheFile::Reader reader(file.path);
+    EXPECT(reader.hasSection("Vertices"));
+    EXPECT(!reader.hasSection("Normals"));
+
+    std::vector<uint32_t> readIndices;
+    reader.readSection("Indices", readIndices);
+    EXPECT(readIndices == indices);
+}
+
+CPU_TEST(SceneCacheFile_Errors)
+{
+    TempFile file;
+
+    {
+        SceneCacheFile::Writer writer(file.path, kTestVersion, getOptions());
+        writer.addSection("Indices", createIndices(100000));
+        writer.addSection("Odd", "abcdef", 6);
+        EXPECT_THROW(writer.addSection("Indices", createIndices(10)));
+        EXPECT_THROW(writer.addSection("ThisSectionNameIsLongerThan31Chars", "a", 1));
+
+        // The file cannot be opened before it is finalized.
+        EXPECT_THROW(SceneCacheFile::Reader reader(file.path));
+        writer.finalize();
+        EXPECT_THROW(writer.addSection("Late", "a", 1));
+    }
+
+    {
+        SceneCacheFile::Reader reader(file.path);
+        std::vector<uint32_t> data;
+        EXPECT_THROW(reader.readSection("Missing", data));
+        EXPECT_THROW(reader.readSection("Odd", data));
+
+        char buffer[4];
+        EXPECT_THROW(reader.readSection("Odd", buffer, sizeof(buffer)));
+    }
+
+    // Truncated file.
+    std::filesystem::resize_file(file.path, std::filesystem::file_size(file.path) / 2);
+    EXPECT_THROW(SceneCacheFile::Reader reader(file.path));
+
+    // Invalid header.
+    {
+        std::ofstream fs(file.path, std::ios_base::binary | std::ios_base::trunc);
+        fs << "Not a scene cache file";
+    }
+    EXPECT_THROW(SceneCacheFile::Reader reader(file.path));
+
+    EXPECT_THROW(SceneCacheFile::Reader reader(file.path.string() + ".missing"));
+}
+
+CPU_TEST(SceneCacheFile_Codecs)
+{
+    const auto indices = createIndices(200000);
+    const auto vertices = createVertices(20000, 4);
+
+    std::vector<char> reference;
+    for (auto codec : {SceneCacheFile::Codec::None, SceneCacheFile::Codec::LZ4, SceneCacheFile::Codec::LZ4HC})
+    {
+        for (uint32_t threadCount : {1u, 4u})
+        {
+            TempFile file;
+            {
+                SceneCacheFile::Writer writer(file.path, kTestVersion, getOptions(codec, threadCount));
+                writer.addSection("Indices", indices);
+                writer.addSection("Vertices", vertices);
+                writer.finalize();
+            }
+
+            // The file contents do not depend on the number of threads.
+            auto data = readFileData(file.path);
+            if (threadCount == 1)
+                reference = data;
+            else
+                EXPECT(data == reference);
+
+            SceneCacheFile::Reader reader(file.path, threadCount);
+            const auto& info = reader.getSectionInfo("Indices");
+            EXPECT(info.codec == codec);
+            if (codec == SceneCacheFile::Codec::None)
+                EXPECT_EQ(info.storedSize, info.size);
+            else
+                EXPECT_LT(info.storedSize, info.size);
+
+            std::vector<uint32_t> readIndices;
+            std::vector<PackedStaticVertexData> readVertices;
+            reader.readSection("Indices", readIndices);
+            reader.readSection("Vertices", readVertices);
+            EXPECT(readIndices == indices);
+            EXPECT(isEqual(readVertices, vertices));
+        }
+    }
+
+    // The high compression codec does not produce larger files.
+    TempFile lz4File;
+    TempFile lz4hcFile;
+    for (auto [path, codec] : {std::make_pair(lz4File.path, SceneCacheFile::Codec::LZ4), std::make_pair(lz4hcFile.path, SceneCacheFile::Codec::LZ4HC)})
+    {
+        SceneCacheFile::Writer writer(path, kTestVersion, getOptions(codec));
+        writer.addSection("Indices", indices);
+        writer.finalize();
+    }
+    EXPECT_LE(SceneCacheFile::Reader(lz4hcFile.path).getSectionInfo("Indices").storedSize, SceneCacheFile::Reader(lz4File.path).getSectionInfo("Indices").storedSize);
+}
+
+CPU_TEST(SceneCacheFile_Corrupt)
+{
+    TempFile file;
+    {
+        SceneCacheFile::Writer writer(file.path, kTestVersion, getOptions(SceneCacheFile::Codec::LZ4));
+        writer.addSection("Indices", createIndices(100000));
+        writer.finalize();
+    }
+    const auto data = readFileData(file.path);
+    uint64_t tableOffset;
+    std::memcpy(&tableOffset, data.data() + kTableOffsetOffset, sizeof(tableOffset));
+
+    // Unknown codec.
+    {
+        auto corrupt = data;
+        uint32_t codec = 100;
+        std::memcpy(corrupt.data() + tableOffset + kSectionCodecOffset, &codec, sizeof(codec));
+        writeFileData(file.path, corrupt);
+        EXPECT_THROW(SceneCacheFile::Reader reader(file.path));
+    }
+
+    // Section codec does not match the chunk codec.
+    {
+        auto corrupt = data;
+        auto codec = SceneCacheFile::Codec::LZ4HC;
+        std::memcpy(corrupt.data() + tableOffset + kSectionCodecOffset, &codec, sizeof(codec));
+        writeFileData(file.path, corrupt);
+        EXPECT_THROW(SceneCacheFile::Reader reader(file.path));
+    }
+
+    // Corrupt chunk data is detected when decoding.
+    {
+        auto corrupt = data;
+        std::memset(corrupt.data() + SceneCacheFile::kAlignment, 0xff, 256);
+        writeFileData(file.path, corrupt);
+        SceneCacheFile::Reader reader(file.path);
+        std::vector<uint32_t> indices;
+        EXPECT_THROW(reader.readSection("Indices", indices));
+    }
+
+    // Truncated chunk data.
+    {
+        auto corrupt = data;
+        corrupt.resize(tableOffset - 1);
+        writeFileData(file.path, corrupt);
+        EXPECT_THROW(SceneCacheFile::Reader reader(file.path));
+    }
+}
+
+CPU_TEST(SceneCacheFile_Benchmark, TAGS("benchmark"))
+{
+    // Geometry similar to a large scene.
+    const size_t vertexCount = 4 * 1024 * 1024;
+    const auto indices = createIndices(3 * vertexCount);
+    const auto vertices = createVertices(vertexCount, 3);
+    const double sizeMB = double(indices.size() * sizeof(uint32_t) + vertices.size() * sizeof(PackedStaticVertexData)) / (1024 * 1024);
+
+    // Powers of two up to the number of hardware threads.
+    std::vector<uint32_t> threadCounts;
+    const uint32_t maxThreadCount = std::max(1u, std::thread::hardware_concurrency());
+    for (uint32_t threadCount = 1; threadCount < maxThreadCount; threadCount *= 2)
+        threadCounts.push_back(threadCount);
+    threadCounts.push_back(maxThreadCount);
+
+    for (auto codec : {SceneCacheFile::Codec::LZ4, SceneCacheFile::Codec::LZ4HC})
+    {
+        for (uint32_t threadCount : threadCounts)
+        {
+            TempFile file;
+
+            SceneCacheFile::Writer::Options options;
+            options.codec = codec;
+            options.threadCount = threadCount;
+
+            auto t0 = CpuTimer::getCurrentTimePoint();
+            {
+                SceneCacheFile::Writer writer(file.path, kTestVersion, options);
+                writer.addSection("Indices", indices);
+                writer.addSection("Vertices", vertices);
+                writer.finalize();
+            }
+            auto t1 = CpuTimer::getCurrentTimePoint();
+
+            std::vector<uint32_t> readIndices;
+            std::vector<PackedStaticVertexData> readVertices;
+            {
+                SceneCacheFile::Reader reader(file.path, threadCount);
+                reader.readSection("Indices", readIndices);
+                reader.readSection("Vertices", readVertices);
+            }
+            auto t2 = CpuTimer::getCurrentTimePoint();
+
+            EXPECT(readIndices == indices);
+            EXPECT(isEqual(readVertices, vertices));
+
+            double writeTime = CpuTimer::calcDuration(t0, t1);
+            double readTime = CpuTimer::calcDuration(t1, t2);
+            logInfo(
+                "SceneCacheFile {} with {} threads: {:.1f} MB, file size {:.1f} MB, write {:.1f} ms ({:.0f} MB/s), load {:.1f} ms ({:.0f} MB/s)",
+                codec == SceneCacheFile::Codec::LZ4 ? "LZ4" : "LZ4HC",
+                threadCount,
+                sizeMB,
+                double(std::filesystem::file_size(file.path)) / (1024 * 1024),
+                writeTime,
+                sizeMB / writeTime * 1000.0,
+                readTime,
+                sizeMB / readTime * 1000.0
+            );
+        }
+    }
+}
+} // namespace Falcor
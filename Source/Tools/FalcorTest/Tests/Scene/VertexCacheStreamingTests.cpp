@@ -0,0 +1,442 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/Animation/VertexCacheStreaming.h"
+#include "Core/Platform/OS.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+namespace Falcor
+{
+namespace
+{
+/// Removes the file when going out of scope.
+struct TempFile
+{
+    std::filesystem::path path = getTempFilePath();
+    ~TempFile() { std::filesystem::remove(path); }
+};
+
+std::vector<uint8_t> createKeyframe(uint32_t track, uint32_t keyframe, size_t size)
+{
+    std::mt19937 rng(track * 1000 + keyframe);
+    std::vector<uint8_t> data(size);
+    for (auto& b : data)
+        b = (uint8_t)(rng() & 0xff);
+    return data;
+}
+
+void writeKeyframeFile(const std::filesystem::path& path, const std::vector<KeyframeFile::TrackDesc>& tracks)
+{
+    std::vector<uint8_t> data;
+    KeyframeFile::write(
+        path,
+        tracks,
+        [&](uint32_t track, uint32_t keyframe) -> const void*
+        {
+            data = createKeyframe(track, keyframe, tracks[track].keyframeSize);
+            return data.data();
+        }
+    );
+}
+
+KeyframeFile::TrackDesc createTrack(uint32_t keyframeCount, uint64_t keyframeSize)
+{
+    KeyframeFile::TrackDesc track;
+    track.keyframeCount = keyframeCount;
+    track.keyframeSize = keyframeSize;
+    return track;
+}
+
+/// Keyframes interpolated at a time in keyframe units, looping over the track.
+uint2 getKeyframeIndices(double time, uint32_t keyframeCount)
+{
+    uint32_t k = (uint32_t)std::floor(time) % keyframeCount;
+    return uint2(k, (k + 1) % keyframeCount);
+}
+
+struct TimelineStats
+{
+    uint32_t requiredLoadCount = 0;
+    uint32_t prefetchCount = 0;
+    uint32_t waitCount = 0;
+    uint32_t discardedCount = 0;
+};
+
+/**
+ * Play a track on a simulated timeline.
+ * Required loads complete immediately, prefetches complete a fixed number of frames after they are issued.
+ * Checks after every frame that the interpolated keyframes are resident and that the window fits its slots.
+ */
+TimelineStats playTimeline(CPUUnitTestContext& ctx, KeyframeWindow& window, const std::vector<double>& times, uint32_t latency)
+{
+    struct InFlight
+    {
+        KeyframeWindow::Load load;
+        size_t readyFrame;
+    };
+
+    TimelineStats stats;
+    std::vector<InFlight> inFlight;
+    auto finish = [&](const InFlight& f)
+    {
+        if (!window.setLoaded(f.load.keyframe, f.load.slot))
+            stats.discardedCount++;
+    };
+
+    for (size_t frame = 0; frame < times.size(); frame++)
+    {
+        for (auto it = inFlight.begin(); it != inFlight.end();)
+        {
+            if (it->readyFrame <= frame)
+            {
+                finish(*it);
+                it = inFlight.erase(it);
+            }
+            else
+                ++it;
+        }
+
+        uint2 keyframeIndices = getKeyframeIndices(times[frame], window.getKeyframeCount());
+        for (const auto& load : window.update(keyframeIndices))
+        {
+            if (load.required)
+            {
+                window.setLoaded(load.keyframe, load.slot);
+                stats.requiredLoadCount++;
+            }
+            else
+            {
+                inFlight.push_back({load, frame + latency});
+                stats.prefetchCount++;
+            }
+        }
+
+        for (uint32_t keyframe : {keyframeIndices.x, keyframeIndices.y})
+        {
+            if (window.isResident(keyframe))
+                continue;
+            auto it = std::find_if(
+                inFlight.begin(),
+                inFlight.end(),
+                [&](const InFlight& f) { return f.load.keyframe == keyframe && f.load.slot == window.getSlot(keyframe); }
+            );
+            ASSERT(it != inFlight.end());
+            finish(*it);
+            inFlight.erase(it);
+            stats.waitCount++;
+        }
+
+        EXPECT(window.isResident(keyframeIndices.x));
+        EXPECT(window.isResident(keyframeIndices.y));
+
+        // Every slot holds at most one keyframe.
+        std::vector<uint32_t> slotUse(window.getSlotCount(), 0);
+        for (uint32_t keyframe = 0; keyframe < window.getKeyframeCount(); keyframe++)
+        {
+            uint32_t slot = window.getSlot(keyframe);
+            if (slot == KeyframeWindow::kInvalidSlot)
+                continue;
+            ASSERT_LT(slot, window.getSlotCount());
+            slotUse[slot]++;
+        }
+        for (uint32_t use : slotUse)
+            EXPECT_LE(use, 1u);
+    }
+
+    return stats;
+}
+
+std::vector<double> createTimeline(double startTime, double speed, size_t frameCount)
+{
+    std::vector<double> times(frameCount);
+    for (size_t i = 0; i < frameCount; i++)
+        times[i] = startTime + speed * i;
+    return times;
+}
+} // namespace
+
+CPU_TEST(KeyframeFile_RoundTrip)
+{
+    TempFile file;
+    std::vector<KeyframeFile::TrackDesc> tracks = {createTrack(5, 1024), createTrack(1, 12), createTrack(17, 100000)};
+    writeKeyframeFile(file.path, tracks);
+
+    KeyframeFile keyframeFile(file.path);
+    ASSERT_EQ(keyframeFile.getTrackCount(), (uint32_t)tracks.size());
+    for (uint32_t track = 0; track < tracks.size(); track++)
+    {
+        EXPECT_EQ(keyframeFile.getTrack(track).keyframeCount, tracks[track].keyframeCount);
+        EXPECT_EQ(keyframeFile.getTrack(track).keyframeSize, tracks[track].keyframeSize);
+
+        std::vector<uint8_t> data(tracks[track].keyframeSize);
+        for (uint32_t keyframe = 0; keyframe < tracks[track].keyframeCount; keyframe++)
+        {
+            keyframeFile.readKeyframe(track, keyframe, data.data());
+            EXPECT(data == createKeyframe(track, keyframe, tracks[track].keyframeSize)) << "track " << track << " keyframe " << keyframe;
+        }
+    }
+
+    std::vector<uint8_t> data(1024);
+    EXPECT_THROW(keyframeFile.readKeyframe(0, 5, data.data()));
+    EXPECT_THROW(keyframeFile.readKeyframe(3, 0, data.data()));
+}
+
+CPU_TEST(KeyframeFile_Embedded)
+{
+    // Keyframes embedded among other sections of a file, as done by the scene cache.
+    TempFile file;
+    std::vector<KeyframeFile::TrackDesc> tracks = {createTrack(3, 4096), createTrack(0, 0), createTrack(2, 48)};
+    std::vector<uint32_t> other(1000, 42);
+    {
+        SceneCacheFile::Writer writer(file.path, 7);
+        writer.addSection("Other", other);
+        std::vector<uint8_t> data;
+        KeyframeFile::addSections(
+            writer,
+            tracks,
+            [&](uint32_t track, uint32_t keyframe) -> const void*
+            {
+                data = createKeyframe(track, keyframe, tracks[track].keyframeSize);
+                return data.data();
+            }
+        );
+        writer.finalize();
+    }
+
+    auto pReader = std::make_shared<SceneCacheFile::Reader>(file.path);
+    KeyframeFile keyframeFile(pReader);
+    ASSERT_EQ(keyframeFile.getTrackCount(), (uint32_t)tracks.size());
+    for (uint32_t track = 0; track < tracks.size(); track++)
+    {
+        ASSERT_EQ(keyframeFile.getTrack(track).keyframeCount, tracks[track].keyframeCount);
+        std::vector<uint8_t> data(tracks[track].keyframeSize);
+        for (uint32_t keyframe = 0; keyframe < tracks[track].keyframeCount; keyframe++)
+        {
+            keyframeFile.readKeyframe(track, keyframe, data.data());
+            EXPECT(data == createKeyframe(track, keyframe, tracks[track].keyframeSize)) << "track " << track << " keyframe " << keyframe;
+        }
+    }
+
+    // The other sections remain readable through the shared reader.
+    std::vector<uint32_t> readOther;
+    pReader->readSection("Other", readOther);
+    EXPECT(readOther == other);
+
+    // A file without keyframes is rejected.
+    TempFile plainFile;
+    {
+        SceneCacheFile::Writer writer(plainFile.path, 7);
+        writer.addSection("Other", other);
+        writer.finalize();
+    }
+    EXPECT_THROW(KeyframeFile(std::make_shared<SceneCacheFile::Reader>(plainFile.path)));
+}
+
+CPU_TEST(KeyframeFile_Invalid)
+{
+    TempFile file;
+    EXPECT_THROW(KeyframeFile(file.path));
+
+    {
+        std::ofstream stream(file.path, std::ios::binary);
+        stream << "not a keyframe file";
+    }
+    EXPECT_THROW(KeyframeFile(file.path));
+}
+
+CPU_TEST(KeyframeWindow_Clamping)
+{
+    KeyframeWindow single(1, 8, 4);
+    EXPECT_EQ(single.getSlotCount(), 1u);
+    EXPECT_EQ(single.getPrefetchCount(), 0u);
+    auto loads = single.update(uint2(0, 0));
+    ASSERT_EQ(loads.size(), 1u);
+    EXPECT(loads[0].required);
+
+    KeyframeWindow small(3, 8, 4);
+    EXPECT_EQ(small.getSlotCount(), 3u);
+    EXPECT_EQ(small.getPrefetchCount(), 1u);
+
+    KeyframeWindow large(100, 8, 10);
+    EXPECT_EQ(large.getSlotCount(), 8u);
+    EXPECT_EQ(large.getPrefetchCount(), 6u);
+
+    EXPECT_THROW(KeyframeWindow(10, 1, 0));
+    EXPECT_THROW(KeyframeWindow(0, 8, 4));
+}
+
+CPU_TEST(KeyframeWindow_Playback)
+{
+    // Play three loops at a speed where prefetches finish ahead of time.
+    // Only the first two keyframes are loaded synchronously, all others are prefetched once per loop.
+    const uint32_t keyframeCount = 50;
+    KeyframeWindow window(keyframeCount, 8, 4);
+    auto stats = playTimeline(ctx, window, createTimeline(0.0, 0.3, 500), 2);
+
+    EXPECT_EQ(stats.requiredLoadCount, 2u);
+    EXPECT_EQ(stats.waitCount, 0u);
+    EXPECT_EQ(stats.discardedCount, 0u);
+    EXPECT_LE(stats.prefetchCount, 3 * keyframeCount + 4);
+}
+
+CPU_TEST(KeyframeWindow_FastPlayback)
+{
+    // Skipping keyframes every frame defeats prefetching, but the interpolated keyframes are always resident.
+    KeyframeWindow window(64, 6, 4);
+    auto stats = playTimeline(ctx, window, createTimeline(0.5, 2.7, 300), 3);
+    EXPECT_GT(stats.requiredLoadCount + stats.waitCount, 2u);
+}
+
+CPU_TEST(KeyframeWindow_Seek)
+{
+    const uint32_t keyframeCount = 50;
+    KeyframeWindow window(keyframeCount, 8, 4);
+    playTimeline(ctx, window, createTimeline(0.0, 0.25, 40), 1);
+
+    std::vector<uint32_t> oldSlots(keyframeCount);
+    for (uint32_t keyframe = 0; keyframe < keyframeCount; keyframe++)
+        oldSlots[keyframe] = window.getSlot(keyframe);
+
+    // Seeking loads the interpolated keyframes first, followed by the prefetches in playback order.
+    auto loads = window.update(uint2(40, 41));
+    ASSERT_EQ(loads.size(), 6u);
+    for (uint32_t i = 0; i < loads.size(); i++)
+    {
+        EXPECT_EQ(loads[i].keyframe, 40 + i);
+        EXPECT_EQ(loads[i].required, i < 2);
+    }
+
+    // Loads of evicted keyframes are rejected.
+    uint32_t evictedCount = 0;
+    for (uint32_t keyframe = 0; keyframe < keyframeCount; keyframe++)
+    {
+        if (oldSlots[keyframe] == KeyframeWindow::kInvalidSlot || window.getSlot(keyframe) != KeyframeWindow::kInvalidSlot)
+            continue;
+        EXPECT(!window.setLoaded(keyframe, oldSlots[keyframe]));
+        evictedCount++;
+    }
+    EXPECT_EQ(evictedCount, 6u);
+    for (const auto& load : loads)
+        EXPECT(window.setLoaded(load.keyframe, load.slot));
+
+    // Playing on from the new position only prefetches.
+    auto stats = playTimeline(ctx, window, createTimeline(40.0, 0.25, 100), 1);
+    EXPECT_EQ(stats.requiredLoadCount, 0u);
+    EXPECT_EQ(stats.waitCount, 0u);
+}
+
+CPU_TEST(KeyframeStreamer_Playback)
+{
+    TempFile file;
+    std::vector<KeyframeFile::TrackDesc> tracks = {createTrack(30, 4096), createTrack(7, 256), createTrack(1, 64)};
+    writeKeyframeFile(file.path, tracks);
+
+    KeyframeStreamer::Options options;
+    options.windowSize = 6;
+    options.prefetchCount = 3;
+    options.threadCount = 2;
+    KeyframeStreamer streamer(std::make_unique<KeyframeFile>(file.path), options);
+    ASSERT_EQ(streamer.getTrackCount(), (uint32_t)tracks.size());
+    EXPECT_EQ(streamer.getSlotCount(0), 6u);
+    EXPECT_EQ(streamer.getSlotCount(1), 6u);
+    EXPECT_EQ(streamer.getSlotCount(2), 1u);
+
+    // Simulated slot storage of each track, e.g. GPU buffers.
+    std::vector<std::vector<std::vector<uint8_t>>> slots(tracks.size());
+    for (uint32_t track = 0; track < tracks.size(); track++)
+        slots[track].resize(streamer.getSlotCount(track));
+    auto upload = [&](uint32_t track, uint32_t slot, const void* pData, size_t size)
+    {
+        EXPECT_EQ(size, tracks[track].keyframeSize);
+        auto& dst = slots[track][slot];
+        dst.assign((const uint8_t*)pData, (const uint8_t*)pData + size);
+    };
+
+    for (double time : createTimeline(0.0, 0.4, 200))
+    {
+        for (uint32_t track = 0; track < tracks.size(); track++)
+        {
+            uint2 keyframeIndices = getKeyframeIndices(time, tracks[track].keyframeCount);
+            uint2 slotIndices = streamer.update(track, keyframeIndices, upload);
+            EXPECT(slots[track][slotIndices.x] == createKeyframe(track, keyframeIndices.x, tracks[track].keyframeSize));
+            EXPECT(slots[track][slotIndices.y] == createKeyframe(track, keyframeIndices.y, tracks[track].keyframeSize));
+        }
+    }
+
+    const auto& stats = streamer.getStats();
+    EXPECT_GE(stats.requiredLoadCount, 2u + 2u + 1u);
+    EXPECT_GT(stats.prefetchCount, 0u);
+}
+
+CPU_TEST(KeyframeStreamer_ReadFunction)
+{
+    // Keyframes are only read when loaded into the window.
+    std::vector<KeyframeFile::TrackDesc> tracks = {createTrack(40, 512), createTrack(3, 32)};
+    std::atomic<uint32_t> readCount = 0;
+    auto read = [&](uint32_t track, uint32_t keyframe, void* pDst)
+    {
+        auto data = createKeyframe(track, keyframe, tracks[track].keyframeSize);
+        std::memcpy(pDst, data.data(), data.size());
+        readCount++;
+    };
+
+    KeyframeStreamer::Options options;
+    options.windowSize = 4;
+    options.prefetchCount = 2;
+    KeyframeStreamer streamer(tracks, read, options);
+
+    std::vector<std::vector<std::vector<uint8_t>>> slots(tracks.size());
+    for (uint32_t track = 0; track < tracks.size(); track++)
+        slots[track].resize(streamer.getSlotCount(track));
+    auto upload = [&](uint32_t track, uint32_t slot, const void* pData, size_t size)
+    { slots[track][slot].assign((const uint8_t*)pData, (const uint8_t*)pData + size); };
+
+    for (double time : createTimeline(0.0, 0.5, 20))
+    {
+        for (uint32_t track = 0; track < tracks.size(); track++)
+        {
+            uint2 keyframeIndices = getKeyframeIndices(time, tracks[track].keyframeCount);
+            uint2 slotIndices = streamer.update(track, keyframeIndices, upload);
+            EXPECT(slots[track][slotIndices.x] == createKeyframe(track, keyframeIndices.x, tracks[track].keyframeSize));
+            EXPECT(slots[track][slotIndices.y] == createKeyframe(track, keyframeIndices.y, tracks[track].keyframeSize));
+        }
+    }
+
+    // Ten frames cover keyframes 0-10 of the first track plus its prefetches, the second track fits its window.
+    const auto& stats = streamer.getStats();
+    EXPECT_LE(readCount.load(), 10u + 1u + 2u + 3u);
+    EXPECT_EQ(stats.requiredLoadCount + stats.prefetchCount, readCount.load());
+}
+} // namespace Falcor
@@ -0,0 +1,129 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/DiskCacheDirectory.h"
+#include "Core/Platform/OS.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace Falcor
+{
+namespace
+{
+/// Removes the directory when going out of scope.
+struct TempDirectory
+{
+    std::filesystem::path path = getTempFilePath();
+    ~TempDirectory() { std::filesystem::remove_all(path); }
+};
+
+void writeFile(DiskCacheDirectory& dir, const std::filesystem::path& path, size_t size)
+{
+    dir.writeFile(path, [&](const std::filesystem::path& tempPath) { std::ofstream(tempPath, std::ios::binary) << std::string(size, 'x'); });
+}
+} // namespace
+
+CPU_TEST(DiskCacheDirectory_WriteFile)
+{
+    TempDirectory temp;
+    DiskCacheDirectory dir(temp.path);
+
+    // The temporary file keeps the extension of the file.
+    std::filesystem::path tempPath;
+    dir.writeFile(dir.getPath() / "ab" / "entry.dds", [&](const std::filesystem::path& p) { tempPath = p; std::ofstream(p) << "data"; });
+    EXPECT(tempPath.extension() == ".dds");
+    EXPECT(!std::filesystem::exists(tempPath));
+    EXPECT(std::filesystem::exists(dir.getPath() / "ab" / "entry.dds"));
+
+    // Failed writes leave no file behind.
+    EXPECT_THROW(dir.writeFile(
+        dir.getPath() / "failed",
+        [&](const std::filesystem::path& p)
+        {
+            std::ofstream(p) << "data";
+            throw std::runtime_error("Failed");
+        }
+    ));
+    auto files = dir.listFiles();
+    ASSERT_EQ(files.size(), 1);
+    EXPECT(files[0].path.filename() == "entry.dds");
+    EXPECT_EQ(files[0].size, 4);
+}
+
+CPU_TEST(DiskCacheDirectory_TempFiles)
+{
+    TempDirectory temp;
+    DiskCacheDirectory dir(temp.path);
+    writeFile(dir, dir.getPath() / "entry", 4);
+
+    // Temporary files are not listed, and only removed once old enough to be leftovers of interrupted writes.
+    const std::filesystem::path leftovers[] = {dir.getPath() / "entry.1.2.tmp", dir.getPath() / "ab" / "entry.1.2.tmp.dds"};
+    for (const auto& path : leftovers)
+    {
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream(path) << "data";
+    }
+    EXPECT_EQ(dir.listFiles().size(), 1);
+    EXPECT_EQ(dir.removeTempFiles(), 0);
+
+    for (const auto& path : leftovers)
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now() - std::chrono::hours(2));
+    EXPECT_EQ(dir.removeTempFiles(), 8);
+    EXPECT_EQ(dir.listFiles().size(), 1);
+}
+
+CPU_TEST(DiskCacheDirectory_Evict)
+{
+    TempDirectory temp;
+    DiskCacheDirectory dir(temp.path);
+    const auto now = std::filesystem::file_time_type::clock::now();
+    for (int i = 0; i < 3; ++i)
+    {
+        auto path = dir.getPath() / std::to_string(i);
+        writeFile(dir, path, 100 * (i + 1));
+        std::filesystem::last_write_time(path, now - std::chrono::minutes(10 - i));
+    }
+
+    auto files = dir.listFiles();
+    DiskCacheDirectory::sortByLastUse(files);
+    ASSERT_EQ(files.size(), 3);
+    EXPECT(files[0].path.filename() == "0");
+
+    // A file removed concurrently frees nothing, but no longer counts against the budget.
+    std::filesystem::remove(files[0].path);
+    EXPECT_EQ(DiskCacheDirectory::evict(files, 350), 200);
+    files = dir.listFiles();
+    ASSERT_EQ(files.size(), 1);
+    EXPECT(files[0].path.filename() == "2");
+
+    // Nothing is evicted when within budget.
+    EXPECT_EQ(DiskCacheDirectory::evict(files, 300), 0);
+}
+} // namespace Falcor
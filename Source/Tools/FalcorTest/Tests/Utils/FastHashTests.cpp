@@ -0,0 +1,143 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/FastHash.h"
+#include "Utils/CryptoUtils.h"
+#include "Utils/Timing/CpuTimer.h"
+#include <random>
+#include <set>
+
+namespace Falcor
+{
+namespace
+{
+std::vector<uint8_t> createData(size_t size)
+{
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; ++i)
+        data[i] = (uint8_t)(i * 31 + 7);
+    return data;
+}
+} // namespace
+
+CPU_TEST(FastHash128)
+{
+    // Digests must not change across platforms and releases, as they are used as persistent cache keys.
+    // The expected values are the canonical XXH3_128bits digests of the reference implementation.
+    {
+        FastHash128::MD md{0x99, 0xaa, 0x06, 0xd3, 0x01, 0x47, 0x98, 0xd8, 0x60, 0x01, 0xc3, 0x24, 0x46, 0x8d, 0x49, 0x7f};
+        EXPECT(FastHash128::compute(nullptr, 0) == md);
+    }
+
+    {
+        std::string str{"Hello World!"};
+        FastHash128::MD md{0xbb, 0xce, 0x22, 0x57, 0xf0, 0xce, 0xc8, 0x95, 0xf5, 0x6f, 0x7a, 0x34, 0x8b, 0xed, 0x58, 0x98};
+        EXPECT(FastHash128::compute(str.data(), str.size()) == md);
+        EXPECT_EQ(FastHash128::toString(md), "bbce2257f0cec895f56f7a348bed5898");
+    }
+
+    {
+        auto data = createData(5000);
+        FastHash128::MD md{0x3b, 0xf6, 0x0a, 0xa8, 0x9c, 0x7f, 0xee, 0xaa, 0x55, 0x9f, 0xff, 0x92, 0xc2, 0xb7, 0xf8, 0xee};
+        EXPECT(FastHash128::compute(data.data(), data.size()) == md);
+    }
+}
+
+CPU_TEST(FastHash128_Streaming)
+{
+    // The digest must not depend on how the data is split into update() calls.
+    auto data = createData(20000);
+    for (size_t size : {0, 1, 63, 64, 65, 1023, 1024, 1025, 4096, 20000})
+    {
+        auto md = FastHash128::compute(data.data(), size);
+        for (size_t chunkSize : {1, 7, 64, 1000, 4096})
+        {
+            FastHash128 hash;
+            for (size_t offset = 0; offset < size; offset += chunkSize)
+                hash.update(data.data() + offset, std::min(chunkSize, size - offset));
+            EXPECT(hash.finalize() == md) << "size=" << size << " chunkSize=" << chunkSize;
+        }
+    }
+
+    // finalize() does not modify the state.
+    FastHash128 hash;
+    hash.update(data.data(), 100);
+    hash.finalize();
+    hash.update(data.data() + 100, 100);
+    EXPECT(hash.finalize() == FastHash128::compute(data.data(), 200));
+
+    // Copies continue independently.
+    FastHash128 copy = hash;
+    hash.update(data.data() + 200, 5000);
+    copy.update(data.data() + 200, 100);
+    EXPECT(hash.finalize() == FastHash128::compute(data.data(), 5200));
+    EXPECT(copy.finalize() == FastHash128::compute(data.data(), 300));
+}
+
+CPU_TEST(FastHash128_Collisions)
+{
+    std::set<FastHash128::MD> digests;
+    size_t count = 0;
+
+    // Zero-filled inputs of different lengths, which only differ in padding.
+    std::vector<uint8_t> zeros(2100, 0);
+    for (size_t size = 0; size < zeros.size(); ++size, ++count)
+        digests.insert(FastHash128::compute(zeros.data(), size));
+
+    // Single bit flips at all positions of an input spanning two XXH3 blocks.
+    std::vector<uint8_t> data(2 * 1024 + 10, 0);
+    for (size_t bit = 0; bit < data.size() * 8; ++bit, ++count)
+    {
+        data[bit / 8] ^= 1 << (bit % 8);
+        digests.insert(FastHash128::compute(data.data(), data.size()));
+        data[bit / 8] ^= 1 << (bit % 8);
+    }
+
+    EXPECT_EQ(digests.size(), count);
+}
+
+CPU_TEST(FastHash128_Benchmark, TAGS("benchmark"))
+{
+    std::vector<uint8_t> data(256 * 1024 * 1024);
+    std::mt19937_64 rng;
+    for (auto& value : data)
+        value = (uint8_t)rng();
+    const double sizeMB = double(data.size()) / (1024 * 1024);
+
+    auto t0 = CpuTimer::getCurrentTimePoint();
+    auto md = FastHash128::compute(data.data(), data.size());
+    auto t1 = CpuTimer::getCurrentTimePoint();
+    SHA1::compute(data.data(), data.size());
+    auto t2 = CpuTimer::getCurrentTimePoint();
+
+    double fastTime = CpuTimer::calcDuration(t0, t1);
+    double sha1Time = CpuTimer::calcDuration(t1, t2);
+    logInfo("FastHash128: {:.1f} ms ({:.0f} MB/s), SHA1: {:.1f} ms ({:.0f} MB/s), digest {}", fastTime, sizeMB / fastTime * 1000.0, sha1Time,
+        sizeMB / sha1Time * 1000.0, FastHash128::toString(md));
+}
+} // namespace Falcor
@@ -0,0 +1,202 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/GzipStream.h"
+#include "Core/Platform/OS.h"
+#include <zlib.h>
+#include <fstream>
+#include <string>
+
+namespace Falcor
+{
+namespace
+{
+/// Create text that looks like the contents of a scene file.
+std::string createText(size_t size)
+{
+    std::string text;
+    text.reserve(size + 32);
+    for (uint32_t i = 0; text.size() < size; ++i)
+        text += fmt::format("{} {:.4f} \"token{}\"\n", i, i * 0.37f, i % 97);
+    text.resize(size);
+    return text;
+}
+
+void writeGzip(const std::filesystem::path& path, const std::string& data)
+{
+    gzFile file = gzopen(path.string().c_str(), "wb");
+    FALCOR_ASSERT(file);
+    gzwrite(file, data.data(), (unsigned)data.size());
+    gzclose(file);
+}
+
+std::string readAll(GzipStream& stream, std::vector<size_t>& chunkSizes)
+{
+    std::string data;
+    std::string chunk;
+    while (stream.read(chunk))
+    {
+        data += chunk;
+        chunkSizes.push_back(chunk.size());
+    }
+    return data;
+}
+} // namespace
+
+CPU_TEST(GzipStream_Chunks)
+{
+    const std::string text = createText(300000);
+    auto path = getTempFilePath();
+    writeGzip(path, text);
+
+    // The data must not depend on the chunking. All chunks except the last one must be full.
+    for (size_t chunkSize : {1, 7, 4096, 65536, 1 << 20})
+    {
+        GzipStream::Options options;
+        options.chunkSize = chunkSize;
+        options.maxQueuedChunks = 2;
+        GzipStream stream(path, options);
+
+        std::vector<size_t> chunkSizes;
+        std::string data = readAll(stream, chunkSizes);
+        EXPECT(data == text) << "chunkSize " << chunkSize;
+
+        ASSERT(!chunkSizes.empty());
+        for (size_t i = 0; i + 1 < chunkSizes.size(); ++i)
+            EXPECT_EQ(chunkSizes[i], chunkSize);
+        EXPECT(chunkSizes.back() > 0 && chunkSizes.back() <= chunkSize);
+
+        // Reading past the end keeps returning false.
+        std::string chunk;
+        EXPECT(!stream.read(chunk));
+        EXPECT(chunk.empty());
+
+        auto stats = stream.getStats();
+        EXPECT_EQ(stats.decompressedBytes, text.size());
+        EXPECT_EQ(stats.compressedBytes, std::filesystem::file_size(path));
+    }
+
+    // Destroying a stream that has not been fully read stops the decompression thread.
+    {
+        GzipStream::Options options;
+        options.chunkSize = 1024;
+        options.maxQueuedChunks = 1;
+        GzipStream stream(path, options);
+        std::string chunk;
+        EXPECT(stream.read(chunk));
+        EXPECT(chunk == text.substr(0, 1024));
+    }
+
+    std::filesystem::remove(path);
+}
+
+CPU_TEST(GzipStream_Errors)
+{
+    auto path = getTempFilePath();
+
+    // Missing file.
+    EXPECT_THROW(GzipStream stream(path));
+
+    // Not compressed.
+    std::ofstream(path, std::ios::binary) << createText(1000);
+    {
+        GzipStream stream(path);
+        std::string chunk;
+        EXPECT_THROW(stream.read(chunk));
+    }
+
+    // Truncated. The data before the truncation is returned before the error is raised.
+    const std::string text = createText(200000);
+    writeGzip(path, text);
+    std::string compressed = readFile(path);
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << compressed.substr(0, compressed.size() / 2);
+    {
+        GzipStream::Options options;
+        options.chunkSize = 1000;
+        GzipStream stream(path, options);
+        std::string data;
+        std::string chunk;
+        bool failed = false;
+        try
+        {
+            while (stream.read(chunk))
+                data += chunk;
+        }
+        catch (const std::exception&)
+        {
+            failed = true;
+        }
+        EXPECT(failed);
+        EXPECT(!data.empty() && data.size() < text.size());
+        EXPECT(data == text.substr(0, data.size()));
+    }
+
+    // Empty file.
+    std::ofstream(path, std::ios::binary | std::ios::trunc);
+    {
+        GzipStream stream(path);
+        std::string chunk;
+        EXPECT_THROW(stream.read(chunk));
+    }
+
+    std::filesystem::remove(path);
+}
+
+CPU_TEST(GzipStream_BoundedMemory)
+{
+    // Stream a file that is much larger than the buffered chunks. The memory held by the stream must be bounded
+    // by the queue size instead of growing with the file size, as it does when decompressing the whole file.
+    const size_t size = 64 * 1024 * 1024;
+    const std::string text = createText(size);
+    auto path = getTempFilePath();
+    writeGzip(path, text);
+
+    GzipStream::Options options;
+    options.chunkSize = 64 * 1024;
+    options.maxQueuedChunks = 4;
+    GzipStream stream(path, options);
+
+    size_t offset = 0;
+    bool equal = true;
+    std::string chunk;
+    while (stream.read(chunk))
+    {
+        equal = equal && text.compare(offset, chunk.size(), chunk) == 0;
+        offset += chunk.size();
+    }
+    EXPECT(equal);
+    EXPECT_EQ(offset, size);
+
+    auto stats = stream.getStats();
+    EXPECT_EQ(stats.decompressedBytes, size);
+    EXPECT_LE(stats.maxBufferedBytes, options.maxQueuedChunks * options.chunkSize);
+    EXPECT_LE(stats.maxBufferedBytes * 64, size);
+
+    std::filesystem::remove(path);
+}
+} // namespace Falcor
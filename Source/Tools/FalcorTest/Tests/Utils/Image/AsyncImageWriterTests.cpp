@@ -0,0 +1,237 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Image/AsyncImageWriter.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+/// Blocks threads until opened.
+class Gate
+{
+public:
+    Gate(bool open) : mOpen(open) {}
+
+    void open()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mOpen = true;
+        mCondition.notify_all();
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [&]() { return mOpen; });
+    }
+
+private:
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mOpen;
+};
+
+/// Create a synthetic RGBA8 frame filled with a value derived from the frame index.
+AsyncImageWriter::Image createFrame(uint32_t frame, uint32_t width, uint32_t height)
+{
+    AsyncImageWriter::Image image;
+    image.path = "frame" + std::to_string(frame) + ".png";
+    image.width = width;
+    image.height = height;
+    image.resourceFormat = ResourceFormat::RGBA8Unorm;
+    image.data.resize(size_t(width) * height * 4, uint8_t(frame));
+    return image;
+}
+} // namespace
+
+CPU_TEST(AsyncImageWriter_Order)
+{
+    // Encoders finish out of order, completions are reported in submission order.
+    const uint32_t frameCount = 64;
+    std::vector<std::atomic<uint32_t>> encodeCounts(frameCount);
+    std::vector<uint64_t> reported;
+
+    auto encoder = [&](AsyncImageWriter::Image& image)
+    {
+        const uint32_t frame = image.data[0];
+        std::this_thread::sleep_for(std::chrono::microseconds((frame * 7919) % 13 * 100));
+        encodeCounts[frame]++;
+    };
+    auto callback = [&](const AsyncImageWriter::Result& result)
+    {
+        EXPECT(result.success);
+        EXPECT_EQ(result.sizeInBytes, 16 * 8 * 4);
+        reported.push_back(result.id);
+    };
+
+    AsyncImageWriter::Options options;
+    options.threadCount = 4;
+    AsyncImageWriter writer(options, encoder, callback);
+    for (uint32_t i = 0; i < frameCount; ++i)
+    {
+        const uint64_t id = writer.write(createFrame(i, 16, 8));
+        EXPECT_EQ(id, i);
+    }
+    writer.flush();
+
+    ASSERT_EQ(reported.size(), frameCount);
+    for (uint32_t i = 0; i < frameCount; ++i)
+    {
+        EXPECT_EQ(reported[i], i);
+        EXPECT_EQ(encodeCounts[i].load(), 1);
+    }
+
+    auto stats = writer.getStats();
+    EXPECT_EQ(stats.submittedCount, frameCount);
+    EXPECT_EQ(stats.completedCount, frameCount);
+    EXPECT_EQ(stats.failedCount, 0);
+    EXPECT_EQ(stats.bytesWritten, frameCount * 16 * 8 * 4);
+    EXPECT_EQ(stats.bytesInFlight, 0);
+    EXPECT_GT(stats.getThroughput(), 0.0);
+}
+
+CPU_TEST(AsyncImageWriter_BackPressure)
+{
+    // Frames of 512 bytes with a budget of 1024 bytes: the third write blocks until an encoder finishes.
+    Gate gate(false);
+    std::atomic<uint32_t> encodeCount = 0;
+    auto encoder = [&](AsyncImageWriter::Image& image)
+    {
+        gate.wait();
+        encodeCount++;
+    };
+
+    AsyncImageWriter::Options options;
+    options.threadCount = 2;
+    options.maxBytesInFlight = 1024;
+    AsyncImageWriter writer(options, encoder);
+
+    writer.write(createFrame(0, 16, 8));
+    writer.write(createFrame(1, 16, 8));
+    EXPECT_EQ(writer.getStats().bytesInFlight, 1024);
+
+    std::atomic<bool> written = false;
+    std::thread producer(
+        [&]()
+        {
+            writer.write(createFrame(2, 16, 8));
+            written = true;
+        }
+    );
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT(!written);
+
+    gate.open();
+    producer.join();
+    writer.flush();
+
+    EXPECT(written);
+    EXPECT_EQ(encodeCount.load(), 3);
+    auto stats = writer.getStats();
+    EXPECT_EQ(stats.stallCount, 1);
+    EXPECT_GT(stats.stallTime, 0.0);
+    EXPECT_EQ(stats.maxBytesInFlight, 1024);
+    EXPECT_EQ(stats.bytesInFlight, 0);
+
+    // An image larger than the budget is accepted when nothing else is in flight.
+    writer.write(createFrame(3, 32, 32));
+    writer.flush();
+    EXPECT_EQ(writer.getStats().stallCount, 1);
+}
+
+CPU_TEST(AsyncImageWriter_Failure)
+{
+    // Failures are reported with the error message and do not stop the pipeline.
+    auto encoder = [&](AsyncImageWriter::Image& image)
+    {
+        if (image.data[0] % 2 == 1)
+            FALCOR_THROW("Disk full");
+    };
+    std::vector<AsyncImageWriter::Result> results;
+    auto callback = [&](const AsyncImageWriter::Result& result) { results.push_back(result); };
+
+    AsyncImageWriter writer(AsyncImageWriter::Options(), encoder, callback);
+    for (uint32_t i = 0; i < 8; ++i)
+        writer.write(createFrame(i, 4, 4));
+    writer.flush();
+
+    ASSERT_EQ(results.size(), 8);
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        EXPECT_EQ(results[i].id, i);
+        EXPECT_EQ(results[i].success, i % 2 == 0);
+        EXPECT_EQ(results[i].error.empty(), i % 2 == 0);
+    }
+
+    auto stats = writer.getStats();
+    EXPECT_EQ(stats.completedCount, 8);
+    EXPECT_EQ(stats.failedCount, 4);
+    EXPECT_EQ(stats.bytesWritten, 4 * 4 * 4 * 4);
+
+    writer.resetStats();
+    EXPECT_EQ(writer.getStats().completedCount, 0);
+}
+
+CPU_TEST(AsyncImageWriter_SaveImage)
+{
+    // The default encoder writes images with Bitmap::saveImage().
+    const uint32_t width = 37;
+    const uint32_t height = 19;
+    std::vector<std::filesystem::path> paths;
+    {
+        AsyncImageWriter writer;
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            auto image = createFrame(i * 50, width, height);
+            image.path = getRuntimeDirectory() / image.path;
+            paths.push_back(image.path);
+            writer.write(std::move(image));
+        }
+        // The destructor waits for all images to be written.
+    }
+
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        auto pBitmap = Bitmap::createFromFile(paths[i], true);
+        ASSERT(pBitmap != nullptr);
+        EXPECT_EQ(pBitmap->getWidth(), width);
+        EXPECT_EQ(pBitmap->getHeight(), height);
+        EXPECT_EQ(pBitmap->getData()[0], i * 50);
+        std::filesystem::remove(paths[i]);
+    }
+}
+} // namespace Falcor
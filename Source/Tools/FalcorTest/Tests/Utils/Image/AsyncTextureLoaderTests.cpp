@@ -0,0 +1,290 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Image/AsyncTextureLoader.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace Falcor
+{
+namespace
+{
+using Loader = AsyncTextureLoader;
+
+/// Blocks threads until opened.
+class Gate
+{
+public:
+    Gate(bool open) : mOpen(open) {}
+
+    void open()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mOpen = true;
+        mCondition.notify_all();
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [&]() { return mOpen; });
+    }
+
+private:
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mOpen;
+};
+
+/// Backend recording the order of decodes and uploads instead of loading textures. Uploads return nullptr.
+class FakeBackend : public Loader::Backend
+{
+public:
+    /**
+     * @param[in] decodeOpen Let decodes finish, otherwise they block until decodeGate is opened.
+     * @param[in] uploadOpen Let uploads finish, otherwise they block until uploadGate is opened.
+     * @param[in] decodedSize Size of the decoded data of each request.
+     */
+    FakeBackend(bool decodeOpen, bool uploadOpen, uint64_t decodedSize)
+        : decodeGate(decodeOpen), uploadGate(uploadOpen), mDecodedSize(decodedSize)
+    {}
+
+    Gate decodeGate;
+    Gate uploadGate;
+
+    std::unique_ptr<Loader::DecodedTexture> decode(const Loader::LoadDesc& desc) override
+    {
+        record(mDecoded, desc);
+        decodeGate.wait();
+        auto pData = std::make_unique<Loader::DecodedTexture>();
+        pData->sizeInBytes = mDecodedSize;
+        return pData;
+    }
+
+    ref<Texture> upload(const Loader::LoadDesc& desc, Loader::DecodedTexture& data) override
+    {
+        record(mUploaded, desc);
+        uploadGate.wait();
+        return nullptr;
+    }
+
+    std::vector<std::string> getDecoded() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mDecoded;
+    }
+
+    std::vector<std::string> getUploaded() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mUploaded;
+    }
+
+    void waitForDecodes(size_t count)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [&]() { return mDecoded.size() >= count; });
+    }
+
+    void waitForUploads(size_t count)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [&]() { return mUploaded.size() >= count; });
+    }
+
+private:
+    void record(std::vector<std::string>& list, const Loader::LoadDesc& desc)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        list.push_back(desc.paths[0].string());
+        mCondition.notify_all();
+    }
+
+    uint64_t mDecodedSize;
+    mutable std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::vector<std::string> mDecoded;
+    std::vector<std::string> mUploaded;
+};
+
+Loader::Options makeOptions(size_t threadCount, uint64_t maxBytesInFlight = 1ull << 30)
+{
+    Loader::Options options;
+    options.threadCount = threadCount;
+    options.maxBytesInFlight = maxBytesInFlight;
+    return options;
+}
+
+std::future<ref<Texture>> load(Loader& loader, const std::string& name, const Loader::LoadOptions& loadOptions = Loader::LoadOptions())
+{
+    return loader.load(Loader::LoadDesc{{name}}, {}, loadOptions);
+}
+
+Loader::LoadOptions makeLoadOptions(int32_t priority, Loader::Clock::time_point deadline = Loader::Clock::time_point::max())
+{
+    Loader::LoadOptions loadOptions;
+    loadOptions.priority = priority;
+    loadOptions.deadline = deadline;
+    return loadOptions;
+}
+} // namespace
+
+CPU_TEST(AsyncTextureLoader_Priority)
+{
+    auto pBackend = std::make_unique<FakeBackend>(false, true, 0);
+    FakeBackend& backend = *pBackend;
+    Loader loader(std::move(pBackend), makeOptions(1));
+
+    // Occupy the worker so that the following requests are queued.
+    std::vector<std::future<ref<Texture>>> futures;
+    futures.push_back(load(loader, "blocker"));
+    backend.waitForDecodes(1);
+
+    const auto now = Loader::Clock::now();
+    futures.push_back(load(loader, "a"));
+    futures.push_back(load(loader, "b", makeLoadOptions(2)));
+    futures.push_back(load(loader, "c", makeLoadOptions(1, now + std::chrono::seconds(20))));
+    futures.push_back(load(loader, "d", makeLoadOptions(1, now + std::chrono::seconds(10))));
+    futures.push_back(load(loader, "e"));
+    futures.push_back(load(loader, "f", makeLoadOptions(-1)));
+    EXPECT_EQ(loader.getStats().queueDepth, 6);
+
+    backend.decodeGate.open();
+    for (auto& future : futures)
+        future.wait();
+
+    // Highest priority first, then earliest deadline, then submission order.
+    const std::vector<std::string> expected = {"blocker", "b", "d", "c", "a", "e", "f"};
+    EXPECT(backend.getDecoded() == expected);
+    EXPECT(backend.getUploaded() == expected);
+}
+
+CPU_TEST(AsyncTextureLoader_Cancel)
+{
+    auto pBackend = std::make_unique<FakeBackend>(false, true, 0);
+    FakeBackend& backend = *pBackend;
+    Loader loader(std::move(pBackend), makeOptions(1));
+
+    // Cancel a request while it is decoding. It is not uploaded.
+    Loader::LoadOptions blockerOptions;
+    auto blocker = load(loader, "blocker", blockerOptions);
+    backend.waitForDecodes(1);
+
+    // Cancel queued requests. They are not decoded, but still complete.
+    Loader::LoadOptions cancelledOptions;
+    size_t callbackCount = 0;
+    auto a = loader.load(Loader::LoadDesc{{"a"}}, [&](ref<Texture> pTexture) { callbackCount++; }, cancelledOptions);
+    auto b = load(loader, "b");
+    auto c = load(loader, "c", cancelledOptions);
+
+    blockerOptions.cancellationToken.cancel();
+    cancelledOptions.cancellationToken.cancel();
+    backend.decodeGate.open();
+
+    EXPECT(a.get() == nullptr);
+    EXPECT(c.get() == nullptr);
+    b.wait();
+    blocker.wait();
+    EXPECT_EQ(callbackCount, 1);
+
+    EXPECT(backend.getDecoded() == std::vector<std::string>({"blocker", "b"}));
+    EXPECT(backend.getUploaded() == std::vector<std::string>({"b"}));
+
+    auto stats = loader.getStats();
+    EXPECT_EQ(stats.cancelledCount, 3);
+    EXPECT_EQ(stats.completedCount, 1);
+    EXPECT_EQ(stats.queueDepth, 0);
+}
+
+CPU_TEST(AsyncTextureLoader_BackPressure)
+{
+    auto pBackend = std::make_unique<FakeBackend>(true, false, 60);
+    FakeBackend& backend = *pBackend;
+    Loader loader(std::move(pBackend), makeOptions(4, 100));
+
+    // The first two requests are decoded, as each starts with less than the budget in flight.
+    std::vector<std::future<ref<Texture>>> futures;
+    futures.push_back(load(loader, "0"));
+    backend.waitForUploads(1);
+    futures.push_back(load(loader, "1"));
+    backend.waitForUploads(2);
+    EXPECT_EQ(loader.getStats().bytesInFlight, 120);
+
+    // Further requests wait until decoded data is uploaded, even though workers are idle.
+    for (int i = 2; i < 6; ++i)
+        futures.push_back(load(loader, std::to_string(i)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(backend.getDecoded().size(), 2);
+    EXPECT_EQ(loader.getStats().queueDepth, 4);
+
+    backend.uploadGate.open();
+    for (auto& future : futures)
+        future.wait();
+
+    auto stats = loader.getStats();
+    EXPECT_EQ(backend.getUploaded().size(), 6);
+    EXPECT_EQ(stats.bytesInFlight, 0);
+    EXPECT_LE(stats.maxBytesInFlight, 100 + 3 * 60);
+    EXPECT_EQ(stats.completedCount, 6);
+}
+
+CPU_TEST(AsyncTextureLoader_Stats)
+{
+    auto pBackend = std::make_unique<FakeBackend>(false, true, 10);
+    FakeBackend& backend = *pBackend;
+    Loader loader(std::move(pBackend), makeOptions(1));
+
+    std::vector<std::future<ref<Texture>>> futures;
+    futures.push_back(load(loader, "blocker"));
+    backend.waitForDecodes(1);
+    futures.push_back(load(loader, "late", makeLoadOptions(0, Loader::Clock::now())));
+    futures.push_back(load(loader, "a"));
+    futures.push_back(load(loader, "b"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    auto stats = loader.getStats();
+    EXPECT_EQ(stats.queueDepth, 3);
+    EXPECT_EQ(stats.maxQueueDepth, 3);
+    EXPECT_EQ(stats.completedCount, 0);
+
+    backend.decodeGate.open();
+    for (auto& future : futures)
+        future.wait();
+
+    stats = loader.getStats();
+    EXPECT_EQ(stats.queueDepth, 0);
+    EXPECT_EQ(stats.completedCount, 4);
+    EXPECT_EQ(stats.missedDeadlineCount, 1);
+    EXPECT_EQ(stats.maxBytesInFlight, 10);
+    EXPECT_GE(stats.averageLatency, 0.01);
+    EXPECT_GE(stats.maxLatency, stats.averageLatency);
+}
+} // namespace Falcor
@@ -0,0 +1,235 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Image/Bitmap.h"
+#include "Utils/Image/HDRImageDecoder.h"
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace Falcor
+{
+namespace
+{
+/// Generate RGBE pixels with runs of equal values, so run-length encoding is exercised.
+std::vector<uint8_t> generateRgbe(uint32_t width, uint32_t height, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> rgbe(size_t(width) * height * 4);
+    for (size_t i = 0; i < rgbe.size(); i += 4)
+    {
+        if (i > 0 && rng() % 3 == 0)
+        {
+            std::copy(rgbe.begin() + i - 4, rgbe.begin() + i, rgbe.begin() + i);
+            continue;
+        }
+        for (uint32_t c = 0; c < 3; ++c)
+            rgbe[i + c] = uint8_t(rng());
+        rgbe[i + 3] = rng() % 8 == 0 ? 0 : uint8_t(100 + rng() % 60);
+    }
+    return rgbe;
+}
+
+/// Write a Radiance HDR file, with run-length encoded scanlines if rle is set and the width allows it.
+void writeHdr(const std::filesystem::path& path, uint32_t width, uint32_t height, const std::vector<uint8_t>& rgbe, bool rle)
+{
+    std::ofstream file(path, std::ios::binary);
+    file << "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\nEXPOSURE=1.0\n\n-Y " << height << " +X " << width << "\n";
+
+    std::vector<uint8_t> data;
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        const uint8_t* pRow = rgbe.data() + size_t(y) * width * 4;
+        if (!rle || width < 8 || width > 0x7fff)
+        {
+            data.insert(data.end(), pRow, pRow + size_t(width) * 4);
+            continue;
+        }
+
+        data.insert(data.end(), {2, 2, uint8_t(width >> 8), uint8_t(width & 0xff)});
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            uint32_t x = 0;
+            while (x < width)
+            {
+                uint32_t run = 1;
+                while (x + run < width && run < 127 && pRow[(x + run) * 4 + c] == pRow[x * 4 + c])
+                    ++run;
+                if (run >= 3)
+                {
+                    data.insert(data.end(), {uint8_t(128 + run), pRow[x * 4 + c]});
+                    x += run;
+                    continue;
+                }
+                uint32_t count = 0;
+                while (x + count < width && count < 128)
+                    ++count;
+                count = std::min(count, 2u + (uint32_t)(x % 5)); // Vary the literal lengths.
+                data.push_back(uint8_t(count));
+                for (uint32_t i = 0; i < count; ++i)
+                    data.push_back(pRow[(x + i) * 4 + c]);
+                x += count;
+            }
+        }
+    }
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+void expectEqualBitmaps(CPUUnitTestContext& ctx, const Bitmap* pResult, const Bitmap* pReference)
+{
+    ASSERT(pResult != nullptr);
+    ASSERT(pReference != nullptr);
+    EXPECT_EQ(pResult->getWidth(), pReference->getWidth());
+    EXPECT_EQ(pResult->getHeight(), pReference->getHeight());
+    EXPECT_EQ((uint32_t)pResult->getFormat(), (uint32_t)pReference->getFormat());
+    ASSERT_EQ(pResult->getSize(), pReference->getSize());
+    EXPECT(std::memcmp(pResult->getData(), pReference->getData(), pResult->getSize()) == 0);
+}
+
+/// Check the decoder matches the FreeImage path for all orientations and import flags.
+void testMatchesFreeImage(CPUUnitTestContext& ctx, const HDRImageDecoder& decoder, const std::filesystem::path& path)
+{
+    for (bool isTopDown : {true, false})
+    {
+        for (auto importFlags : {Bitmap::ImportFlags::None, Bitmap::ImportFlags::ConvertToFloat16})
+        {
+            auto pResult = decoder.decode(path, isTopDown, importFlags);
+            auto pReference = Bitmap::createFromFile(path, isTopDown, importFlags | Bitmap::ImportFlags::ForceFreeImage);
+            expectEqualBitmaps(ctx, pResult.get(), pReference.get());
+        }
+    }
+}
+} // namespace
+
+CPU_TEST(HDRImageDecoder_Hdr)
+{
+    const auto path = getRuntimeDirectory() / "test_hdr_image_decoder.hdr";
+
+    HDRImageDecoder::Options options;
+    options.threadCount = 4;
+    HDRImageDecoder decoder(options);
+
+    // Flat scanlines (width too small for run-length encoding), run-length encoded and flat scanlines at RLE widths.
+    struct Case
+    {
+        uint32_t width;
+        uint32_t height;
+        bool rle;
+    };
+    for (const Case& c : {Case{5, 7, true}, Case{97, 61, true}, Case{300, 1, true}, Case{40, 33, false}})
+    {
+        writeHdr(path, c.width, c.height, generateRgbe(c.width, c.height, c.width), c.rle);
+        testMatchesFreeImage(ctx, decoder, path);
+    }
+
+    // The import path uses the decoder passed in.
+    auto pBitmap = Bitmap::createFromFile(path, true, Bitmap::ImportFlags::None, &decoder);
+    auto pReference = decoder.decode(path, true, Bitmap::ImportFlags::None);
+    expectEqualBitmaps(ctx, pBitmap.get(), pReference.get());
+
+    std::filesystem::remove(path);
+}
+
+CPU_TEST(HDRImageDecoder_HdrUnsupported)
+{
+    const auto path = getRuntimeDirectory() / "test_hdr_image_decoder_unsupported.hdr";
+    HDRImageDecoder decoder;
+
+    // XYZE images are left to FreeImage.
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "#?RADIANCE\nFORMAT=32-bit_rle_xyze\n\n-Y 1 +X 1\n";
+        file.write("\x80\x80\x80\x80", 4);
+    }
+    EXPECT(decoder.decode(path, true, Bitmap::ImportFlags::None) == nullptr);
+
+    // Truncated images are rejected.
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y 2 +X 2\n";
+        file.write("\x80\x80\x80\x80", 4);
+    }
+    EXPECT(decoder.decode(path, true, Bitmap::ImportFlags::None) == nullptr);
+
+    // Other orientations are left to FreeImage.
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n+Y 1 +X 1\n";
+        file.write("\x80\x80\x80\x80", 4);
+    }
+    EXPECT(decoder.decode(path, true, Bitmap::ImportFlags::None) == nullptr);
+
+    std::filesystem::remove(path);
+}
+
+CPU_TEST(HDRImageDecoder_Exr)
+{
+    const auto path = getRuntimeDirectory() / "test_hdr_image_decoder.exr";
+
+    HDRImageDecoder::Options options;
+    options.threadCount = 4;
+    HDRImageDecoder decoder(options);
+
+    // Sizes not divisible by the chunk sizes, so partial blocks are decoded.
+    const uint32_t width = 67;
+    const uint32_t height = 101;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> dist(0.f, 100.f);
+    std::vector<float> data(width * height * 4);
+    for (float& v : data)
+        v = dist(rng);
+
+    // Half with PIZ compression (default), float without compression and half with lossy compression, with and without alpha.
+    for (auto exportFlags : {Bitmap::ExportFlags::None, Bitmap::ExportFlags::Uncompressed, Bitmap::ExportFlags::Lossy})
+    {
+        for (auto alphaFlags : {Bitmap::ExportFlags::None, Bitmap::ExportFlags::ExportAlpha})
+        {
+            Bitmap::saveImage(
+                path, width, height, Bitmap::FileFormat::ExrFile, exportFlags | alphaFlags, ResourceFormat::RGBA32Float, true, data.data()
+            );
+            testMatchesFreeImage(ctx, decoder, path);
+        }
+    }
+
+    // The import path uses the decoder passed in.
+    auto pBitmap = Bitmap::createFromFile(path, false, Bitmap::ImportFlags::None, &decoder);
+    auto pReference = decoder.decode(path, false, Bitmap::ImportFlags::None);
+    expectEqualBitmaps(ctx, pBitmap.get(), pReference.get());
+
+    std::filesystem::remove(path);
+}
+
+GPU_TEST(HDRImageDecoder_Device)
+{
+    ref<Device> pDevice = ctx.getDevice();
+    const HDRImageDecoder* pDecoder = pDevice->getHDRImageDecoder();
+    ASSERT(pDecoder != nullptr);
+    EXPECT_EQ(pDecoder->getOptions().threadCount, pDevice->getDesc().hdrImageDecoderThreadCount);
+}
+} // namespace Falcor
@@ -0,0 +1,438 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Image/MipGenerator.h"
+#include "Utils/Math/ScalarMath.h"
+#include "Utils/Timing/CpuTimer.h"
+#include <cmath>
+#include <random>
+
+namespace Falcor
+{
+namespace
+{
+/// Scalar reference implementation. Filters each level in double precision with non-separable 2D weights.
+struct ReferenceLevel
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<double> data;
+};
+
+double sinc(double x)
+{
+    if (std::abs(x) < 1e-9)
+        return 1.0;
+    return std::sin(M_PI * x) / (M_PI * x);
+}
+
+double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 64; ++k)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+/// Weight of source texel j for destination texel i along one axis, before normalization.
+double referenceWeight(MipGenerator::Filter filter, int j, uint32_t i, double scale)
+{
+    if (filter == MipGenerator::Filter::Box)
+        return std::max(0.0, std::min(j + 1.0, (i + 1) * scale) - std::max(double(j), i * scale));
+
+    double x = (j + 0.5 - (i + 0.5) * scale) / scale;
+    if (std::abs(x) >= 3.0)
+        return 0.0;
+    if (filter == MipGenerator::Filter::Kaiser)
+        return sinc(x) * besselI0(4.0 * std::sqrt(1.0 - x * x / 9.0)) / besselI0(4.0);
+    return sinc(x) * sinc(x / 3.0);
+}
+
+ReferenceLevel referenceDownsample(const ReferenceLevel& src, uint32_t channelCount, MipGenerator::Filter filter)
+{
+    ReferenceLevel dst;
+    dst.width = std::max(1u, src.width / 2);
+    dst.height = std::max(1u, src.height / 2);
+    dst.data.resize(dst.width * dst.height * channelCount);
+
+    const double scaleX = double(src.width) / dst.width;
+    const double scaleY = double(src.height) / dst.height;
+    const int margin = 8; // Covers the filter support, taps outside the image are clamped to the edge.
+
+    for (uint32_t y = 0; y < dst.height; ++y)
+    {
+        for (uint32_t x = 0; x < dst.width; ++x)
+        {
+            std::vector<double> sum(channelCount, 0.0);
+            double weightSum = 0.0;
+            for (int sy = -margin; sy < (int)src.height + margin; ++sy)
+            {
+                for (int sx = -margin; sx < (int)src.width + margin; ++sx)
+                {
+                    double w = referenceWeight(filter, sx, x, scaleX) * referenceWeight(filter, sy, y, scaleY);
+                    if (w == 0.0)
+                        continue;
+                    uint32_t cx = (uint32_t)std::clamp(sx, 0, (int)src.width - 1);
+                    uint32_t cy = (uint32_t)std::clamp(sy, 0, (int)src.height - 1);
+                    for (uint32_t c = 0; c < channelCount; ++c)
+                        sum[c] += w * src.data[(cy * src.width + cx) * channelCount + c];
+                    weightSum += w;
+                }
+            }
+            for (uint32_t c = 0; c < channelCount; ++c)
+                dst.data[(y * dst.width + x) * channelCount + c] = sum[c] / weightSum;
+        }
+    }
+    return dst;
+}
+
+double srgbToLinear(double v)
+{
+    return v <= 0.04045 ? v / 12.92 : std::pow((v + 0.055) / 1.055, 2.4);
+}
+
+double linearToSrgb(double v)
+{
+    return v <= 0.0031308 ? v * 12.92 : 1.055 * std::pow(v, 1.0 / 2.4) - 0.055;
+}
+
+std::vector<uint8_t> createRandomData(uint32_t width, uint32_t height, ResourceFormat format, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> dist(0.f, 1.f);
+    const uint32_t valueCount = width * height * getFormatChannelCount(format);
+    std::vector<uint8_t> data(getFormatRowPitch(format, width) * height);
+    for (uint32_t i = 0; i < valueCount; ++i)
+    {
+        float v = dist(rng);
+        switch (format)
+        {
+        case ResourceFormat::RGBA32Float:
+        case ResourceFormat::RGB32Float:
+            reinterpret_cast<float*>(data.data())[i] = 4.f * v;
+            break;
+        case ResourceFormat::RGBA16Float:
+            reinterpret_cast<uint16_t*>(data.data())[i] = (uint16_t)math::f32tof16(4.f * v);
+            break;
+        case ResourceFormat::R16Unorm:
+            reinterpret_cast<uint16_t*>(data.data())[i] = (uint16_t)(v * 65535.f);
+            break;
+        default:
+            data[i] = (uint8_t)(v * 255.f);
+            break;
+        }
+    }
+    return data;
+}
+
+/// Decode a bitmap to doubles, without sRGB decoding.
+std::vector<double> decode(const Bitmap& bitmap)
+{
+    const uint32_t valueCount = bitmap.getWidth() * bitmap.getHeight() * getFormatChannelCount(bitmap.getFormat());
+    std::vector<double> values(valueCount);
+    for (uint32_t i = 0; i < valueCount; ++i)
+    {
+        switch (bitmap.getFormat())
+        {
+        case ResourceFormat::RGBA32Float:
+        case ResourceFormat::RGB32Float:
+            values[i] = reinterpret_cast<const float*>(bitmap.getData())[i];
+            break;
+        case ResourceFormat::RGBA16Float:
+            values[i] = math::f16tof32(reinterpret_cast<const uint16_t*>(bitmap.getData())[i]);
+            break;
+        case ResourceFormat::R16Unorm:
+            values[i] = reinterpret_cast<const uint16_t*>(bitmap.getData())[i] / 65535.0;
+            break;
+        default:
+            values[i] = bitmap.getData()[i] / 255.0;
+            break;
+        }
+    }
+    return values;
+}
+
+/// Generate the reference mip chain of a bitmap and compare it to the mips generated by MipGenerator.
+void testFormat(CPUUnitTestContext& ctx, ResourceFormat format, MipGenerator::Filter filter, bool srgb, uint32_t width, uint32_t height)
+{
+    const uint32_t channelCount = getFormatChannelCount(format);
+    const bool isUnorm8 = getNumChannelBits(format, 0) == 8;
+    const bool decodeSrgb = isUnorm8 && channelCount >= 3 && (srgb || isSrgbFormat(format));
+    const double tolerance = isUnorm8 ? 1.01 / 255.0 : format == ResourceFormat::R16Unorm ? 2.0 / 65535.0 : 4e-3;
+
+    auto data = createRandomData(width, height, format, width * 7 + height);
+    auto pBitmap = Bitmap::create(width, height, format, data.data());
+
+    MipGenerator::Options options;
+    options.filter = filter;
+    MipGenerator generator(options);
+    auto mips = generator.generate(*pBitmap, srgb);
+    EXPECT_EQ(mips.size() + 1, MipGenerator::getMipCount(width, height));
+
+    auto isColor = [&](uint32_t i) { return decodeSrgb && i % channelCount < 3; };
+
+    ReferenceLevel level;
+    level.width = width;
+    level.height = height;
+    level.data = decode(*pBitmap);
+    for (size_t i = 0; i < level.data.size(); ++i)
+        level.data[i] = isColor((uint32_t)i) ? srgbToLinear(level.data[i]) : level.data[i];
+
+    for (size_t m = 0; m < mips.size(); ++m)
+    {
+        level = referenceDownsample(level, channelCount, filter);
+        const Bitmap& mip = *mips[m];
+        EXPECT(mip.getFormat() == format);
+        EXPECT_EQ(mip.getWidth(), level.width);
+        EXPECT_EQ(mip.getHeight(), level.height);
+        if (mip.getWidth() != level.width || mip.getHeight() != level.height)
+            return;
+
+        auto values = decode(mip);
+        double maxError = 0.0;
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            double expected = level.data[i];
+            if (getFormatType(format) != FormatType::Float)
+                expected = std::clamp(expected, 0.0, 1.0);
+            if (isColor((uint32_t)i))
+                expected = linearToSrgb(expected);
+            double error = std::abs(values[i] - expected);
+            if (getFormatType(format) == FormatType::Float)
+                error /= std::max(1.0, std::abs(expected));
+            maxError = std::max(maxError, error);
+        }
+        EXPECT_LE(maxError, tolerance) << "format " << to_string(format) << ", filter " << (uint32_t)filter << ", mip " << (m + 1);
+    }
+}
+
+float computeCoverage(const Bitmap& bitmap, float alphaReference)
+{
+    uint32_t count = 0;
+    const uint32_t texelCount = bitmap.getWidth() * bitmap.getHeight();
+    for (uint32_t i = 0; i < texelCount; ++i)
+        count += bitmap.getData()[i * 4 + 3] / 255.f > alphaReference ? 1 : 0;
+    return float(count) / texelCount;
+}
+} // namespace
+
+CPU_TEST(MipGenerator_Formats)
+{
+    EXPECT(MipGenerator::isFormatSupported(ResourceFormat::R8Unorm));
+    EXPECT(MipGenerator::isFormatSupported(ResourceFormat::RG8Unorm));
+    EXPECT(MipGenerator::isFormatSupported(ResourceFormat::RGBA8UnormSrgb));
+    EXPECT(MipGenerator::isFormatSupported(ResourceFormat::BGRX8Unorm));
+    EXPECT(MipGenerator::isFormatSupported(ResourceFormat::R16Unorm));
+    EXPECT(MipGenerator::isFormatSupported(ResourceFormat::RGBA16Float));
+    EXPECT(MipGenerator::isFormatSupported(ResourceFormat::RGB32Float));
+    EXPECT(!MipGenerator::isFormatSupported(ResourceFormat::BC1Unorm));
+    EXPECT(!MipGenerator::isFormatSupported(ResourceFormat::RGB10A2Unorm));
+    EXPECT(!MipGenerator::isFormatSupported(ResourceFormat::RGBA8Uint));
+
+    EXPECT_EQ(MipGenerator::getMipCount(1, 1), 1);
+    EXPECT_EQ(MipGenerator::getMipCount(256, 256), 9);
+    EXPECT_EQ(MipGenerator::getMipCount(640, 3), 10);
+
+    MipGenerator generator;
+    std::vector<uint8_t> data(16);
+    auto pBitmap = Bitmap::create(2, 2, ResourceFormat::RGBA8Uint, data.data());
+    EXPECT_THROW(generator.generate(*pBitmap));
+}
+
+CPU_TEST(MipGenerator_Reference)
+{
+    const ResourceFormat formats[] = {
+        ResourceFormat::R8Unorm,
+        ResourceFormat::RG8Unorm,
+        ResourceFormat::BGRA8Unorm,
+        ResourceFormat::RGBA8UnormSrgb,
+        ResourceFormat::R16Unorm,
+        ResourceFormat::RGBA16Float,
+        ResourceFormat::RGB32Float,
+        ResourceFormat::RGBA32Float,
+    };
+    const MipGenerator::Filter filters[] = {MipGenerator::Filter::Box, MipGenerator::Filter::Kaiser, MipGenerator::Filter::Lanczos};
+
+    for (auto format : formats)
+    {
+        for (auto filter : filters)
+        {
+            // Power-of-two, non-power-of-two and odd dimensions.
+            testFormat(ctx, format, filter, false, 16, 8);
+            testFormat(ctx, format, filter, false, 13, 7);
+        }
+    }
+
+    // sRGB decoding requested for a linear format.
+    testFormat(ctx, ResourceFormat::RGBA8Unorm, MipGenerator::Filter::Box, true, 12, 10);
+    testFormat(ctx, ResourceFormat::BGRX8Unorm, MipGenerator::Filter::Lanczos, true, 9, 9);
+}
+
+CPU_TEST(MipGenerator_Srgb)
+{
+    // Checkerboard of black and white texels averages to 0.5 in linear space, which is 188 in sRGB.
+    std::vector<uint8_t> data(4 * 4 * 4);
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        uint8_t v = ((i % 4) + (i / 4)) % 2 ? 255 : 0;
+        data[i * 4 + 0] = data[i * 4 + 1] = data[i * 4 + 2] = v;
+        data[i * 4 + 3] = v;
+    }
+
+    MipGenerator generator;
+    auto pLinear = Bitmap::create(4, 4, ResourceFormat::RGBA8Unorm, data.data());
+    auto pSrgb = Bitmap::create(4, 4, ResourceFormat::RGBA8UnormSrgb, data.data());
+
+    auto linearMips = generator.generate(*pLinear);
+    auto srgbMips = generator.generate(*pSrgb);
+    auto decodedMips = generator.generate(*pLinear, true);
+    EXPECT_EQ(linearMips[0]->getData()[0], 128);
+    EXPECT_EQ(srgbMips[0]->getData()[0], 188);
+    EXPECT_EQ(decodedMips[0]->getData()[0], 188);
+
+    // Alpha is never sRGB encoded.
+    EXPECT_EQ(srgbMips[0]->getData()[3], 128);
+
+    // Single channel formats have no sRGB variant and are always filtered as-is.
+    auto pR8 = Bitmap::create(4, 4, ResourceFormat::R8Unorm, data.data());
+    EXPECT_EQ(generator.generate(*pR8, true)[0]->getData()[0], 128);
+}
+
+CPU_TEST(MipGenerator_NonPowerOfTwo)
+{
+    // The box filter weights all source texels equally, also for odd dimensions.
+    const uint32_t width = 7;
+    const uint32_t height = 5;
+    std::vector<float> data(width * height);
+    double sum = 0.0;
+    for (uint32_t i = 0; i < width * height; ++i)
+    {
+        data[i] = float(i % 11);
+        sum += data[i];
+    }
+
+    MipGenerator generator;
+    auto pBitmap = Bitmap::create(width, height, ResourceFormat::R32Float, reinterpret_cast<const uint8_t*>(data.data()));
+    auto mips = generator.generate(*pBitmap);
+    EXPECT_EQ(mips.size(), 2);
+    EXPECT_EQ(mips[0]->getWidth(), 3);
+    EXPECT_EQ(mips[0]->getHeight(), 2);
+    EXPECT_EQ(mips[1]->getWidth(), 1);
+    EXPECT_EQ(mips[1]->getHeight(), 1);
+
+    float mean = *reinterpret_cast<const float*>(mips[1]->getData());
+    EXPECT(std::abs(mean - sum / (width * height)) < 1e-4) << mean;
+}
+
+CPU_TEST(MipGenerator_AlphaCoverage)
+{
+    // Noisy alpha around the reference, as in alpha-tested foliage.
+    const uint32_t size = 64;
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> dist(0, 255);
+    std::vector<uint8_t> data(size * size * 4);
+    for (uint32_t i = 0; i < size * size; ++i)
+    {
+        data[i * 4 + 0] = data[i * 4 + 1] = data[i * 4 + 2] = 255;
+        data[i * 4 + 3] = dist(rng) < 80 ? 255 : 0;
+    }
+    auto pBitmap = Bitmap::create(size, size, ResourceFormat::RGBA8Unorm, data.data());
+    const float baseCoverage = computeCoverage(*pBitmap, 0.5f);
+
+    MipGenerator::Options options;
+    options.filter = MipGenerator::Filter::Kaiser;
+    MipGenerator plain(options);
+    options.preserveAlphaCoverage = true;
+    MipGenerator preserving(options);
+
+    auto plainMips = plain.generate(*pBitmap);
+    auto preservedMips = preserving.generate(*pBitmap);
+    for (size_t m = 0; m < 3; ++m)
+    {
+        float plainCoverage = computeCoverage(*plainMips[m], 0.5f);
+        float preservedCoverage = computeCoverage(*preservedMips[m], 0.5f);
+        EXPECT(std::abs(preservedCoverage - baseCoverage) < 0.05f) << "mip " << (m + 1) << ": " << preservedCoverage;
+        EXPECT(std::abs(plainCoverage - baseCoverage) > std::abs(preservedCoverage - baseCoverage)) << "mip " << (m + 1);
+
+        // Color is not affected.
+        EXPECT_EQ(plainMips[m]->getData()[0], preservedMips[m]->getData()[0]);
+    }
+}
+
+CPU_TEST(MipGenerator_Threads)
+{
+    // Results do not depend on the thread count.
+    auto data = createRandomData(97, 61, ResourceFormat::RGBA8UnormSrgb, 3);
+    auto pBitmap = Bitmap::create(97, 61, ResourceFormat::RGBA8UnormSrgb, data.data());
+
+    MipGenerator::Options options;
+    options.filter = MipGenerator::Filter::Lanczos;
+    options.preserveAlphaCoverage = true;
+    options.threadCount = 1;
+    MipGenerator serial(options);
+    options.threadCount = 4;
+    MipGenerator parallel(options);
+
+    auto serialMips = serial.generate(*pBitmap);
+    auto parallelMips = parallel.generate(*pBitmap);
+    EXPECT_EQ(serialMips.size(), parallelMips.size());
+    for (size_t m = 0; m < std::min(serialMips.size(), parallelMips.size()); ++m)
+        EXPECT(std::memcmp(serialMips[m]->getData(), parallelMips[m]->getData(), serialMips[m]->getSize()) == 0) << "mip " << (m + 1);
+}
+
+CPU_TEST(MipGenerator_Benchmark, TAGS("benchmark"))
+{
+    const uint32_t size = 2048;
+    auto data = createRandomData(size, size, ResourceFormat::RGBA8UnormSrgb, 5);
+    auto pBitmap = Bitmap::create(size, size, ResourceFormat::RGBA8UnormSrgb, data.data());
+
+    for (auto filter : {MipGenerator::Filter::Box, MipGenerator::Filter::Kaiser})
+    {
+        for (uint32_t threadCount : {1u, 0u})
+        {
+            MipGenerator::Options options;
+            options.filter = filter;
+            options.threadCount = threadCount;
+            MipGenerator generator(options);
+
+            auto startTime = CpuTimer::getCurrentTimePoint();
+            auto mips = generator.generate(*pBitmap);
+            double duration = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+            EXPECT_EQ(mips.size(), 11);
+            logInfo(
+                "Generated mips of {0}x{0} RGBA8 sRGB image with filter {1} and {2} threads in {3:.1f} ms.", size, (uint32_t)filter,
+                threadCount, duration
+            );
+        }
+    }
+}
+} // namespace Falcor
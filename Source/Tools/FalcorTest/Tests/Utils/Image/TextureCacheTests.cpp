@@ -0,0 +1,245 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Image/TextureCache.h"
+#include "Core/Platform/OS.h"
+#include <filesystem>
+
+namespace Falcor
+{
+namespace
+{
+/// Removes the directory when going out of scope.
+struct TempDirectory
+{
+    std::filesystem::path path = getTempFilePath();
+    TempDirectory() { std::filesystem::create_directories(path); }
+    ~TempDirectory() { std::filesystem::remove_all(path); }
+};
+
+const uint32_t kSize = 64;
+
+std::vector<uint8_t> createImageData(uint32_t seed)
+{
+    std::vector<uint8_t> data(kSize * kSize * 4);
+    for (uint32_t y = 0; y < kSize; ++y)
+    {
+        for (uint32_t x = 0; x < kSize; ++x)
+        {
+            uint8_t* pTexel = &data[(y * kSize + x) * 4];
+            pTexel[0] = (uint8_t)(x * 4);
+            pTexel[1] = (uint8_t)(y * 4);
+            pTexel[2] = (uint8_t)(x * y + seed);
+            pTexel[3] = 255;
+        }
+    }
+    return data;
+}
+
+void writeSourceImage(const std::filesystem::path& path, uint32_t seed)
+{
+    auto data = createImageData(seed);
+    Bitmap::saveImage(
+        path, kSize, kSize, Bitmap::FileFormat::PngFile, Bitmap::ExportFlags::ExportAlpha, ResourceFormat::RGBA8Unorm, true /* top-down */,
+        data.data()
+    );
+}
+
+/// Get the RGBA value of a texel of an 8-bit RGBA, BGRA or BGRX bitmap.
+uint4 getTexel(const Bitmap& bitmap, uint32_t x, uint32_t y)
+{
+    const uint8_t* pTexel = bitmap.getData() + (y * bitmap.getWidth() + x) * 4;
+    switch (bitmap.getFormat())
+    {
+    case ResourceFormat::RGBA8Unorm:
+        return uint4(pTexel[0], pTexel[1], pTexel[2], pTexel[3]);
+    case ResourceFormat::BGRA8Unorm:
+        return uint4(pTexel[2], pTexel[1], pTexel[0], pTexel[3]);
+    case ResourceFormat::BGRX8Unorm:
+        return uint4(pTexel[2], pTexel[1], pTexel[0], 255);
+    default:
+        FALCOR_THROW("Unexpected format {}.", to_string(bitmap.getFormat()));
+    }
+}
+
+TextureCache::Options makeOptions(const std::filesystem::path& directory, bool compress = false)
+{
+    TextureCache::Options options;
+    options.directory = directory;
+    options.compress = compress;
+    return options;
+}
+} // namespace
+
+CPU_TEST(TextureCache_RoundTrip)
+{
+    TempDirectory dir;
+    const auto sourcePath = dir.path / "source.png";
+    writeSourceImage(sourcePath, 0);
+
+    TextureCache cache(makeOptions(dir.path / "cache"));
+    auto entryPath = cache.getEntry(sourcePath, false, false, Bitmap::ImportFlags::None);
+    EXPECT(!entryPath.empty());
+    EXPECT_EQ(cache.getStats().missCount, 1);
+
+    // The second request is served from the cache.
+    EXPECT(cache.getEntry(sourcePath, false, false, Bitmap::ImportFlags::None) == entryPath);
+    EXPECT_EQ(cache.getStats().hitCount, 1);
+
+    // The cached texture matches the source image.
+    auto pSource = Bitmap::createFromFile(sourcePath, true /* top-down */);
+    auto pCached = ImageIO::loadBitmapFromDDS(entryPath);
+    EXPECT(pSource && pCached);
+    if (pSource && pCached)
+    {
+        EXPECT_EQ(pCached->getWidth(), kSize);
+        EXPECT_EQ(pCached->getHeight(), kSize);
+        for (uint32_t y = 0; y < kSize; ++y)
+        {
+            for (uint32_t x = 0; x < kSize; ++x)
+                EXPECT(all(getTexel(*pCached, x, y) == getTexel(*pSource, x, y))) << "x=" << x << " y=" << y;
+        }
+    }
+
+    // Generating mips creates a separate, larger entry holding the full mip chain.
+    auto mipEntryPath = cache.getEntry(sourcePath, true, false, Bitmap::ImportFlags::None);
+    EXPECT(!mipEntryPath.empty() && mipEntryPath != entryPath);
+    EXPECT_GT(std::filesystem::file_size(mipEntryPath), std::filesystem::file_size(entryPath) + kSize * kSize);
+    EXPECT_EQ(cache.getStats().missCount, 2);
+
+    // Missing sources are reported and not cached.
+    EXPECT(cache.getEntry(dir.path / "missing.png", false, false, Bitmap::ImportFlags::None).empty());
+    EXPECT_EQ(cache.getStats().errorCount, 1);
+}
+
+CPU_TEST(TextureCache_Keys)
+{
+    TempDirectory dir;
+    writeSourceImage(dir.path / "a.png", 0);
+    writeSourceImage(dir.path / "b.png", 0);
+    writeSourceImage(dir.path / "c.png", 1);
+
+    TextureCache cache(makeOptions(dir.path / "cache"));
+    auto key = cache.computeKey(dir.path / "a.png", true, false, Bitmap::ImportFlags::None);
+
+    // Keys depend on the contents of the source file, not its path.
+    EXPECT(cache.computeKey(dir.path / "b.png", true, false, Bitmap::ImportFlags::None) == key);
+    EXPECT(cache.computeKey(dir.path / "c.png", true, false, Bitmap::ImportFlags::None) != key);
+
+    // Keys depend on the flags that affect processing.
+    EXPECT(cache.computeKey(dir.path / "a.png", false, false, Bitmap::ImportFlags::None) != key);
+    EXPECT(cache.computeKey(dir.path / "a.png", true, false, Bitmap::ImportFlags::ConvertToFloat16) != key);
+    TextureCache compressedCache(makeOptions(dir.path / "cache", true));
+    EXPECT(compressedCache.computeKey(dir.path / "a.png", true, false, Bitmap::ImportFlags::None) != key);
+
+    // The sRGB flag and mip options only matter when generating mips.
+    EXPECT(cache.computeKey(dir.path / "a.png", true, true, Bitmap::ImportFlags::None) != key);
+    EXPECT(
+        cache.computeKey(dir.path / "a.png", false, true, Bitmap::ImportFlags::None) ==
+        cache.computeKey(dir.path / "a.png", false, false, Bitmap::ImportFlags::None)
+    );
+    auto kaiserOptions = makeOptions(dir.path / "cache");
+    kaiserOptions.mipOptions.filter = MipGenerator::Filter::Kaiser;
+    TextureCache kaiserCache(kaiserOptions);
+    EXPECT(kaiserCache.computeKey(dir.path / "a.png", true, false, Bitmap::ImportFlags::None) != key);
+
+    // Editing the source file changes the key.
+    writeSourceImage(dir.path / "a.png", 2);
+    EXPECT(cache.computeKey(dir.path / "a.png", true, false, Bitmap::ImportFlags::None) != key);
+}
+
+CPU_TEST(TextureCache_Compression)
+{
+    EXPECT(TextureCache::selectCompressionMode(ResourceFormat::R8Unorm) == ImageIO::CompressionMode::BC4);
+    EXPECT(TextureCache::selectCompressionMode(ResourceFormat::RG8Unorm) == ImageIO::CompressionMode::BC5);
+    EXPECT(TextureCache::selectCompressionMode(ResourceFormat::RGBA8Unorm) == ImageIO::CompressionMode::BC7);
+    EXPECT(TextureCache::selectCompressionMode(ResourceFormat::BGRX8Unorm) == ImageIO::CompressionMode::BC7);
+    EXPECT(TextureCache::selectCompressionMode(ResourceFormat::RGB32Float) == ImageIO::CompressionMode::BC6);
+    EXPECT(TextureCache::selectCompressionMode(ResourceFormat::RGBA32Float) == ImageIO::CompressionMode::None);
+    EXPECT(TextureCache::selectCompressionMode(ResourceFormat::BC1Unorm) == ImageIO::CompressionMode::None);
+
+    TempDirectory dir;
+    const auto sourcePath = dir.path / "source.png";
+    writeSourceImage(sourcePath, 0);
+
+    TextureCache cache(makeOptions(dir.path / "cache", true));
+    auto entryPath = cache.getEntry(sourcePath, true, false, Bitmap::ImportFlags::None);
+    EXPECT(!entryPath.empty());
+
+    auto pCached = ImageIO::loadBitmapFromDDS(entryPath);
+    EXPECT(pCached != nullptr);
+    if (pCached)
+    {
+        EXPECT(isCompressedFormat(pCached->getFormat()));
+        EXPECT_EQ(pCached->getWidth(), kSize);
+        EXPECT_EQ(pCached->getHeight(), kSize);
+    }
+}
+
+CPU_TEST(TextureCache_SizeBudget)
+{
+    TempDirectory dir;
+    auto data = createImageData(0);
+    auto pBitmap = Bitmap::create(kSize, kSize, ResourceFormat::RGBA8Unorm, data.data());
+
+    auto makeKey = [](uint8_t value)
+    {
+        TextureCache::Key key = {};
+        key[0] = value;
+        return key;
+    };
+
+    // Write four entries with increasing last use times.
+    TextureCache::Options options = makeOptions(dir.path / "cache");
+    uint64_t entrySize = 0;
+    {
+        TextureCache cache(options);
+        const auto now = std::filesystem::file_time_type::clock::now();
+        for (uint8_t i = 0; i < 4; ++i)
+        {
+            auto path = cache.writeEntry(makeKey(i), *pBitmap, false);
+            std::filesystem::last_write_time(path, now - std::chrono::minutes(10 - i));
+            entrySize = std::filesystem::file_size(path);
+        }
+        EXPECT_EQ(cache.getTotalSize(), 4 * entrySize);
+
+        // Using an entry makes it the most recently used one.
+        EXPECT(!cache.findEntry(makeKey(0)).empty());
+    }
+
+    // Keep two and a half entries worth of data.
+    options.sizeBudget = 5 * entrySize / 2;
+    TextureCache cache(options);
+    EXPECT_EQ(cache.enforceSizeBudget(), 2 * entrySize);
+    EXPECT(!cache.findEntry(makeKey(0)).empty());
+    EXPECT(cache.findEntry(makeKey(1)).empty());
+    EXPECT(cache.findEntry(makeKey(2)).empty());
+    EXPECT(!cache.findEntry(makeKey(3)).empty());
+    EXPECT_EQ(cache.enforceSizeBudget(), 0);
+}
+} // namespace Falcor
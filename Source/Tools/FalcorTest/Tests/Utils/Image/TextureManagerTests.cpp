@@ -27,9 +27,33 @@
  **************************************************************************/
 #include "Testing/UnitTest.h"
 #include "Utils/Image/TextureManager.h"
+#include "Core/Platform/OS.h"
+#include <filesystem>
 
 namespace Falcor
 {
+namespace
+{
+/// Removes the directory when going out of scope.
+struct TempDirectory
+{
+    std::filesystem::path path = getTempFilePath();
+    TempDirectory() { std::filesystem::create_directories(path); }
+    ~TempDirectory() { std::filesystem::remove_all(path); }
+};
+
+void writeImage(const std::filesystem::path& path, uint32_t size)
+{
+    std::vector<uint8_t> data(size * size * 4);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = (uint8_t)(i * 7);
+    Bitmap::saveImage(
+        path, size, size, Bitmap::FileFormat::PngFile, Bitmap::ExportFlags::ExportAlpha, ResourceFormat::RGBA8Unorm, true /* top-down */,
+        data.data()
+    );
+}
+} // namespace
+
 GPU_TEST(TextureManager_LoadMips)
 {
     ref<Device> pDevice = ctx.getDevice();
@@ -51,4 +75,47 @@ GPU_TEST(TextureManager_LoadMips)
     EXPECT_EQ(tex->getMipCount(), 3);
     EXPECT_EQ(tex->getArraySize(), 1);
 }
+
+GPU_TEST(TextureManager_Streaming)
+{
+    ref<Device> pDevice = ctx.getDevice();
+    TempDirectory dir;
+    const auto path = dir.path / "streamed.png";
+    writeImage(path, 256);
+
+    TextureManager textureManager(pDevice, 10);
+    TextureStreamingPolicy::Options options;
+    options.tailSize = 64;
+    textureManager.enableStreaming(options);
+
+    // Only the mip tail is resident at first.
+    auto handle = textureManager.loadTexture(path, true, false, ResourceBindFlags::ShaderResource, false);
+    ASSERT(handle.isValid());
+    auto pTail = textureManager.getTexture(handle);
+    ASSERT(pTail != nullptr);
+    EXPECT_EQ(pTail->getWidth(), 64);
+    EXPECT_EQ(pTail->getMipCount(), 7);
+
+    // Mips are promoted one level per update up to the reported usage.
+    textureManager.reportTextureUsage(handle, 1);
+    EXPECT(textureManager.updateStreaming());
+    auto pTexture = textureManager.getTexture(handle);
+    EXPECT_EQ(pTexture->getWidth(), 128);
+    EXPECT_EQ(pTexture->getMipCount(), 8);
+    EXPECT(!textureManager.updateStreaming());
+
+    // The handle of the tail texture, which is referenced by materials, still reports usage.
+    EXPECT(textureManager.addTexture(pTail) == handle);
+    textureManager.reportTextureUsage(handle, 0);
+    EXPECT(textureManager.updateStreaming());
+    EXPECT_EQ(textureManager.getTexture(handle)->getWidth(), 256);
+    EXPECT_EQ(textureManager.getTexture(handle)->getMipCount(), 9);
+
+    // Evicting down to the tail restores the tail texture.
+    options.memoryBudget = 0;
+    textureManager.enableStreaming(options);
+    EXPECT(textureManager.updateStreaming());
+    EXPECT(textureManager.getTexture(handle) == pTail);
+    EXPECT(!textureManager.updateStreaming());
+}
 } // namespace Falcor
@@ -0,0 +1,264 @@
+/***************************************************************************
+ # Copyright (c) 2015-23, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Image/TextureStreamingPolicy.h"
+#include <random>
+
+namespace Falcor
+{
+namespace
+{
+const ResourceFormat kFormat = ResourceFormat::RGBA8Unorm;
+const uint32_t kSize = 256;
+const uint32_t kMipCount = 9;
+
+// Sizes of the 256x256 RGBA8 test textures. The mip tail of 64x64 and smaller starts at mip 2.
+const uint64_t kMip0Size = 256 * 256 * 4;
+const uint64_t kMip1Size = 128 * 128 * 4;
+const uint64_t kTailSize = (64 * 64 + 32 * 32 + 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2 + 1) * 4;
+
+TextureStreamingPolicy::Options makeOptions(uint64_t memoryBudget, uint64_t updateBudget = 1ull << 40)
+{
+    TextureStreamingPolicy::Options options;
+    options.memoryBudget = memoryBudget;
+    options.updateBudget = updateBudget;
+    options.tailSize = 64;
+    return options;
+}
+
+uint64_t computeResidentBytes(const TextureStreamingPolicy& policy, uint32_t textureCount)
+{
+    uint64_t bytes = 0;
+    for (uint32_t id = 0; id < textureCount; ++id)
+    {
+        for (uint32_t mip = policy.getResidentMip(id); mip < kMipCount; ++mip)
+            bytes += TextureStreamingPolicy::getMipSize(kSize, kSize, kFormat, mip);
+    }
+    return bytes;
+}
+} // namespace
+
+CPU_TEST(TextureStreamingPolicy_MipSize)
+{
+    EXPECT_EQ(TextureStreamingPolicy::getMipSize(256, 256, ResourceFormat::RGBA8Unorm, 0), 256 * 256 * 4);
+    EXPECT_EQ(TextureStreamingPolicy::getMipSize(256, 128, ResourceFormat::R8Unorm, 1), 128 * 64);
+    EXPECT_EQ(TextureStreamingPolicy::getMipSize(256, 256, ResourceFormat::BC1Unorm, 0), 64 * 64 * 8);
+    EXPECT_EQ(TextureStreamingPolicy::getMipSize(256, 256, ResourceFormat::BC1Unorm, 7), 8);
+    EXPECT_EQ(TextureStreamingPolicy::getMipSize(256, 256, ResourceFormat::BC7Unorm, 8), 16);
+    EXPECT_EQ(TextureStreamingPolicy::getMipSize(5, 3, ResourceFormat::RGBA32Float, 1), 2 * 1 * 16);
+
+    TextureStreamingPolicy policy(makeOptions(1ull << 30));
+    policy.addTexture(0, 1024, 512, 11, kFormat);
+    policy.addTexture(1, 32, 32, 6, kFormat);
+    policy.addTexture(2, 256, 256, 1, kFormat);
+    EXPECT_EQ(policy.getTailMip(0), 4);
+    EXPECT_EQ(policy.getResidentMip(0), 4);
+    EXPECT_EQ(policy.getTailMip(1), 0);
+    EXPECT_EQ(policy.getTailMip(2), 0); // Textures without mips are fully resident.
+    EXPECT_EQ(TextureStreamingPolicy::computeTailMip(1024, 512, 11, 64), 4);
+    EXPECT_EQ(TextureStreamingPolicy::computeTailMip(1024, 512, 3, 64), 2);
+
+    EXPECT_THROW(policy.addTexture(0, 16, 16, 1, kFormat));
+    EXPECT_THROW(policy.getResidentMip(3));
+}
+
+CPU_TEST(TextureStreamingPolicy_CoarseFirst)
+{
+    // With one promotion per update, all textures are refined one level before any is refined further.
+    TextureStreamingPolicy policy(makeOptions(1ull << 30, 1));
+    policy.addTexture(0, kSize, kSize, kMipCount, kFormat);
+    policy.addTexture(1, kSize, kSize, kMipCount, kFormat);
+    EXPECT_EQ(policy.getStats().residentBytes, 2 * kTailSize);
+
+    const std::vector<std::pair<uint32_t, uint32_t>> expected = {{0, 1}, {1, 1}, {0, 0}, {1, 0}};
+    for (const auto& [id, mip] : expected)
+    {
+        auto changed = policy.update();
+        EXPECT_EQ(changed.size(), 1);
+        if (changed.size() == 1)
+            EXPECT_EQ(changed[0], id);
+        EXPECT_EQ(policy.getResidentMip(id), mip);
+    }
+
+    EXPECT(policy.update().empty());
+    auto stats = policy.getStats();
+    EXPECT_EQ(stats.residentBytes, 2 * (kMip0Size + kMip1Size + kTailSize));
+    EXPECT_EQ(stats.promotedMipCount, 4);
+    EXPECT_EQ(stats.evictedMipCount, 0);
+}
+
+CPU_TEST(TextureStreamingPolicy_LRU)
+{
+    // Room for the tails and one full texture.
+    const uint64_t budget = 3 * kTailSize + kMip0Size + kMip1Size;
+    TextureStreamingPolicy policy(makeOptions(budget));
+    for (uint32_t id = 0; id < 3; ++id)
+        policy.addTexture(id, kSize, kSize, kMipCount, kFormat);
+
+    // Texture 0 is used and gets the whole budget.
+    policy.reportUsage(0, 0);
+    policy.reportUsage(1, 5);
+    policy.reportUsage(2, 5);
+    policy.update();
+    EXPECT_EQ(policy.getResidentMip(0), 0);
+    EXPECT_EQ(policy.getResidentMip(1), 2);
+    EXPECT_EQ(policy.getResidentMip(2), 2);
+
+    // Texture 1 is used more recently and evicts texture 0.
+    policy.reportUsage(1, 0);
+    auto changed = policy.update();
+    EXPECT(changed == std::vector<uint32_t>({0, 1}));
+    EXPECT_EQ(policy.getResidentMip(0), 2);
+    EXPECT_EQ(policy.getResidentMip(1), 0);
+    EXPECT_LE(policy.getStats().residentBytes, budget);
+
+    // Texture 0 is used again, but only needs mip 1, so texture 1 keeps mip 1.
+    policy.reportUsage(0, 1);
+    policy.update();
+    EXPECT_EQ(policy.getResidentMip(0), 1);
+    EXPECT_EQ(policy.getResidentMip(1), 1);
+    EXPECT_EQ(policy.getStats().residentBytes, computeResidentBytes(policy, 3));
+}
+
+CPU_TEST(TextureStreamingPolicy_NoThrashing)
+{
+    // Two textures used in the same frame never evict each other.
+    const uint64_t budget = 2 * kTailSize + kMip0Size + kMip1Size;
+    TextureStreamingPolicy policy(makeOptions(budget));
+    policy.addTexture(0, kSize, kSize, kMipCount, kFormat);
+    policy.addTexture(1, kSize, kSize, kMipCount, kFormat);
+
+    // Coarse first: both get mip 1, then texture 0 does not fit mip 0.
+    policy.reportUsage(0, 0);
+    policy.reportUsage(1, 0);
+    policy.update();
+    EXPECT_EQ(policy.getResidentMip(0), 1);
+    EXPECT_EQ(policy.getResidentMip(1), 1);
+
+    for (uint32_t frame = 0; frame < 10; ++frame)
+    {
+        policy.reportUsage(0, 0);
+        policy.reportUsage(1, 0);
+        EXPECT(policy.update().empty());
+    }
+    EXPECT_EQ(policy.getStats().evictedMipCount, 0);
+    EXPECT_EQ(policy.getStats().requestedBytes, 2 * (kMip0Size + kMip1Size + kTailSize));
+}
+
+CPU_TEST(TextureStreamingPolicy_OverResident)
+{
+    // Mips that are no longer used are kept until the memory is needed.
+    const uint64_t budget = 2 * kTailSize + kMip0Size + kMip1Size;
+    TextureStreamingPolicy policy(makeOptions(budget));
+    policy.addTexture(0, kSize, kSize, kMipCount, kFormat);
+    policy.addTexture(1, kSize, kSize, kMipCount, kFormat);
+
+    policy.reportUsage(0, 0);
+    policy.reportUsage(1, 8);
+    policy.update();
+    EXPECT_EQ(policy.getResidentMip(0), 0);
+
+    policy.reportUsage(0, 2);
+    policy.reportUsage(1, 8);
+    EXPECT(policy.update().empty());
+    EXPECT_EQ(policy.getResidentMip(0), 0);
+    EXPECT_EQ(policy.getDesiredMip(0), 2);
+
+    // Texture 1 is used in the same frame, but texture 0 has more mips than it uses.
+    policy.reportUsage(0, 2);
+    policy.reportUsage(1, 0);
+    policy.update();
+    EXPECT_EQ(policy.getResidentMip(0), 2);
+    EXPECT_EQ(policy.getResidentMip(1), 0);
+}
+
+CPU_TEST(TextureStreamingPolicy_Budget)
+{
+    TextureStreamingPolicy policy(makeOptions(1ull << 30));
+    for (uint32_t id = 0; id < 4; ++id)
+        policy.addTexture(id, kSize, kSize, kMipCount, kFormat);
+    policy.update();
+    EXPECT_EQ(policy.getStats().residentBytes, 4 * (kMip0Size + kMip1Size + kTailSize));
+
+    // Reducing the budget evicts least recently used textures first.
+    policy.reportUsage(2, 0);
+    policy.update();
+    policy.setOptions(makeOptions(4 * kTailSize + kMip0Size + kMip1Size));
+    policy.update();
+    EXPECT_EQ(policy.getResidentMip(2), 0);
+    for (uint32_t id : {0, 1, 3})
+        EXPECT_EQ(policy.getResidentMip(id), 2);
+    EXPECT_EQ(policy.getStats().residentBytes, 4 * kTailSize + kMip0Size + kMip1Size);
+
+    // Tails are always resident, even if over budget.
+    policy.setOptions(makeOptions(1));
+    policy.update();
+    EXPECT_EQ(policy.getStats().residentBytes, 4 * kTailSize);
+    EXPECT_EQ(policy.getStats().tailBytes, 4 * kTailSize);
+
+    policy.removeTexture(1);
+    policy.removeTexture(7);
+    EXPECT_EQ(policy.getStats().textureCount, 3);
+    EXPECT_EQ(policy.getStats().residentBytes, 3 * kTailSize);
+}
+
+CPU_TEST(TextureStreamingPolicy_Deterministic)
+{
+    // Random usage, the same sequence of calls gives the same result and the budget is respected.
+    const uint32_t textureCount = 32;
+    const uint64_t budget = textureCount * kTailSize + 6 * kMip0Size;
+
+    auto run = [&](std::vector<uint32_t>& residentMips)
+    {
+        TextureStreamingPolicy policy(makeOptions(budget, 2 * kMip0Size));
+        for (uint32_t id = 0; id < textureCount; ++id)
+            policy.addTexture(id, kSize, kSize, kMipCount, kFormat);
+
+        std::mt19937 rng(7);
+        for (uint32_t frame = 0; frame < 200; ++frame)
+        {
+            for (uint32_t i = 0; i < 8; ++i)
+                policy.reportUsage(rng() % textureCount, rng() % kMipCount);
+            policy.update();
+            EXPECT_LE(policy.getStats().residentBytes, budget);
+            EXPECT_EQ(policy.getStats().residentBytes, computeResidentBytes(policy, textureCount));
+            for (uint32_t id = 0; id < textureCount; ++id)
+                residentMips.push_back(policy.getResidentMip(id));
+        }
+        return policy.getStats();
+    };
+
+    std::vector<uint32_t> residentMipsA, residentMipsB;
+    auto statsA = run(residentMipsA);
+    auto statsB = run(residentMipsB);
+    EXPECT(residentMipsA == residentMipsB);
+    EXPECT_EQ(statsA.promotedMipCount, statsB.promotedMipCount);
+    EXPECT_EQ(statsA.evictedMipCount, statsB.evictedMipCount);
+    EXPECT_GT(statsA.evictedMipCount, 0);
+}
+} // namespace Falcor
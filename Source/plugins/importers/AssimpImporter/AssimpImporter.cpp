@@ -34,6 +34,7 @@
 #include "Utils/Timing/TimeReport.h"
 #include "Utils/Math/Common.h"
 #include "Utils/Math/FalcorMath.h"
+#include "Scene/AssimpConversion.h"
 #include "Scene/Importer.h"
 #include "Scene/SceneBuilder.h"
 #include "Scene/Material/Material.h"
@@ -42,7 +43,6 @@
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
-#include <assimp/GltfMaterial.h>
 
 #include <pybind11/pybind11.h>
 
@@ -62,22 +62,7 @@ const bool kCameraEnableWarping = true;
 using BoneMeshMap = std::map<std::string, std::vector<uint32_t>>;
 using MeshInstanceList = std::vector<std::vector<const aiNode*>>;
 
-/**
- * Converts specular power to roughness. Note there is no "the conversion".
- * Reference: http://simonstechblog.blogspot.com/2011/12/microfacet-brdf.html
- * @param specPower specular power of an obsolete Phong BSDF
- */
-float convertSpecPowerToRoughness(float specPower)
-{
-    return std::clamp(std::sqrt(2.0f / (specPower + 2.0f)), 0.f, 1.f);
-}
-
-enum class ImportMode
-{
-    Default,
-    OBJ,
-    GLTF2,
-};
+using ImportMode = AssimpImportMode;
 
 float4x4 aiCast(const aiMatrix4x4& ai)
 {
@@ -101,45 +86,6 @@ quatf aiCast(const aiQuaternion& q)
     return quatf(q.x, q.y, q.z, q.w);
 }
 
-/**
- * Mapping from ASSIMP to Falcor texture type.
- */
-struct TextureMapping
-{
-    aiTextureType aiType;
-    unsigned int aiIndex;
-    Material::TextureSlot targetType;
-};
-
-/**
- * Mapping tables for different import modes.
- */
-static const std::vector<TextureMapping> kTextureMappings[3] = {
-    // Default mappings
-    {
-        {aiTextureType_DIFFUSE, 0, Material::TextureSlot::BaseColor},
-        {aiTextureType_SPECULAR, 0, Material::TextureSlot::Specular},
-        {aiTextureType_EMISSIVE, 0, Material::TextureSlot::Emissive},
-        {aiTextureType_NORMALS, 0, Material::TextureSlot::Normal},
-    },
-    // OBJ mappings
-    {
-        {aiTextureType_DIFFUSE, 0, Material::TextureSlot::BaseColor},
-        {aiTextureType_SPECULAR, 0, Material::TextureSlot::Specular},
-        {aiTextureType_EMISSIVE, 0, Material::TextureSlot::Emissive},
-        // OBJ does not offer a normal map, thus we use the bump map instead.
-        {aiTextureType_HEIGHT, 0, Material::TextureSlot::Normal},
-        {aiTextureType_DISPLACEMENT, 0, Material::TextureSlot::Normal},
-    },
-    // GLTF2 mappings
-    {
-        {aiTextureType_DIFFUSE, 0, Material::TextureSlot::BaseColor},
-        {aiTextureType_EMISSIVE, 0, Material::TextureSlot::Emissive},
-        {aiTextureType_NORMALS, 0, Material::TextureSlot::Normal},
-        // GLTF2 exposes metallic roughness texture.
-        {AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_METALLICROUGHNESS_TEXTURE, Material::TextureSlot::Specular},
-    }};
-
 class ImporterData
 {
 public:
@@ -450,124 +396,11 @@ void createAnimations(ImporterData& data, ImportMode importMode)
         createAnimation(data, data.pScene->mAnimations[i], importMode);
 }
 
-void createTexCrdList(const aiVector3D* pAiTexCrd, uint32_t count, std::vector<float2>& texCrds)
-{
-    texCrds.resize(count);
-    for (uint32_t i = 0; i < count; i++)
-    {
-        FALCOR_ASSERT(pAiTexCrd[i].z == 0);
-        texCrds[i] = float2(pAiTexCrd[i].x, pAiTexCrd[i].y);
-    }
-}
-
-void createTangentList(
-    const aiVector3D* pAiTangent,
-    const aiVector3D* pAiBitangent,
-    const aiVector3D* pAiNormal,
-    uint32_t count,
-    std::vector<float4>& tangents
-)
-{
-    tangents.resize(count);
-    for (uint32_t i = 0; i < count; i++)
-    {
-        // We compute the bitangent at runtime as defined by MikkTSpace: cross(N, tangent.xyz) * tangent.w.
-        // Compute the orientation of the loaded bitangent here to set the sign (w) correctly.
-        float3 T = float3(pAiTangent[i].x, pAiTangent[i].y, pAiTangent[i].z);
-        float3 B = float3(pAiBitangent[i].x, pAiBitangent[i].y, pAiBitangent[i].z);
-        float3 N = float3(pAiNormal[i].x, pAiNormal[i].y, pAiNormal[i].z);
-        float sign = dot(cross(N, T), B) >= 0.f ? 1.f : -1.f;
-        tangents[i] = float4(normalize(T), sign);
-    }
-}
-
-void createIndexList(const aiMesh* pAiMesh, std::vector<uint32_t>& indices)
-{
-    const uint32_t perFaceIndexCount = pAiMesh->mFaces[0].mNumIndices;
-    const uint32_t indexCount = pAiMesh->mNumFaces * perFaceIndexCount;
-
-    indices.resize(indexCount);
-    for (uint32_t i = 0; i < pAiMesh->mNumFaces; i++)
-    {
-        FALCOR_ASSERT(pAiMesh->mFaces[i].mNumIndices == perFaceIndexCount); // Mesh contains mixed primitive types, can be solved using
-                                                                            // aiProcess_SortByPType
-        for (uint32_t j = 0; j < perFaceIndexCount; j++)
-            indices[i * perFaceIndexCount + j] = (uint32_t)(pAiMesh->mFaces[i].mIndices[j]);
-    }
-}
-
-void loadBones(const aiMesh* pAiMesh, const ImporterData& data, std::vector<float4>& weights, std::vector<uint4>& ids)
-{
-    const uint32_t vertexCount = pAiMesh->mNumVertices;
-
-    weights.resize(vertexCount);
-    ids.resize(vertexCount);
-
-    std::fill(weights.begin(), weights.end(), float4(0.f));
-    std::fill(ids.begin(), ids.end(), uint4(NodeID::kInvalidID));
-    static_assert(sizeof(uint4) == 4 * sizeof(NodeID::IntType));
-
-    for (uint32_t bone = 0; bone < pAiMesh->mNumBones; bone++)
-    {
-        const aiBone* pAiBone = pAiMesh->mBones[bone];
-        FALCOR_ASSERT(data.getNodeInstanceCount(pAiBone->mName.C_Str()) == 1);
-        NodeID aiBoneID = data.getFalcorNodeID(pAiBone->mName.C_Str(), 0);
-
-        // The way Assimp works, the weights holds the IDs of the vertices it affects.
-        // We loop over all the weights, initializing the vertices data along the way
-        for (uint32_t weightID = 0; weightID < pAiBone->mNumWeights; weightID++)
-        {
-            // Get the vertex the current weight affects
-            const aiVertexWeight& aiWeight = pAiBone->mWeights[weightID];
-
-            // Skip zero weights
-            if (aiWeight.mWeight == 0.f)
-                continue;
-
-            // Get the address of the Bone ID and weight for the current vertex
-            uint4& vertexIds = ids[aiWeight.mVertexId];
-            float4& vertexWeights = weights[aiWeight.mVertexId];
-
-            // Find the next unused slot in the bone array of the vertex, and initialize it with the current value
-            bool emptySlotFound = false;
-            for (uint32_t j = 0; j < Scene::kMaxBonesPerVertex; j++)
-            {
-                if (vertexIds[j] == NodeID::kInvalidID)
-                {
-                    vertexIds[j] = aiBoneID.getSlang();
-                    vertexWeights[j] = aiWeight.mWeight;
-                    emptySlotFound = true;
-                    break;
-                }
-            }
-
-            if (!emptySlotFound)
-            {
-                logWarning(
-                    "AssimpImporter: One of the vertices has too many bones attached to it. This bone will be ignored and the animation "
-                    "might not look correct."
-                );
-            }
-        }
-    }
-
-    // Now we need to normalize the weights for each vertex, since in some models the sum is larger than 1
-    for (uint32_t i = 0; i < vertexCount; i++)
-    {
-        float4& w = weights[i];
-        float f = 0;
-        for (uint32_t j = 0; j < Scene::kMaxBonesPerVertex; j++)
-            f += w[j];
-        w /= f;
-    }
-}
-
 void createMeshes(ImporterData& data)
 {
     const aiScene* pScene = data.pScene;
-    const bool loadTangents = is_set(data.builder.getFlags(), SceneBuilder::Flags::UseOriginalTangentSpace);
 
-    std::vector<const aiMesh*> meshes;
+    std::vector<uint32_t> meshIndices;
     for (uint32_t i = 0; i < pScene->mNumMeshes; ++i)
     {
         const aiMesh* pMesh = pScene->mMeshes[i];
@@ -581,37 +414,44 @@ void createMeshes(ImporterData& data)
             logWarning("AssimpImporter: Mesh '{}' is not a triangle mesh, ignoring.", pMesh->mName.C_Str());
             continue;
         }
-        meshes.push_back(pMesh);
+        meshIndices.push_back(i);
+    }
+
+    // Convert index, texture coordinate, tangent and bone data in parallel.
+    AssimpConversionOptions options;
+    options.loadTangents = is_set(data.builder.getFlags(), SceneBuilder::Flags::UseOriginalTangentSpace);
+    auto boneLookup = [&data](const std::string& boneName)
+    {
+        FALCOR_ASSERT(data.getNodeInstanceCount(boneName) == 1);
+        return data.getFalcorNodeID(boneName, 0);
+    };
+    std::vector<AssimpMeshData> meshData = convertAssimpMeshes(pScene, meshIndices, boneLookup, options);
+
+    for (const auto& converted : meshData)
+    {
+        for (const auto& warning : converted.warnings)
+            logWarning(warning);
     }
 
     // Pre-process meshes.
-    std::vector<SceneBuilder::ProcessedMesh> processedMeshes(meshes.size());
-    auto range = NumericRange<size_t>(0, meshes.size());
+    std::vector<SceneBuilder::ProcessedMesh> processedMeshes(meshIndices.size());
+    auto range = NumericRange<size_t>(0, meshIndices.size());
     std::for_each(
         std::execution::par,
         range.begin(),
         range.end(),
         [&](size_t i)
         {
-            const aiMesh* pAiMesh = meshes[i];
-            const uint32_t perFaceIndexCount = pAiMesh->mFaces[0].mNumIndices;
+            const aiMesh* pAiMesh = pScene->mMeshes[meshIndices[i]];
+            AssimpMeshData& converted = meshData[i];
 
             SceneBuilder::Mesh mesh;
             mesh.name = pAiMesh->mName.C_Str();
             mesh.faceCount = pAiMesh->mNumFaces;
 
-            // Temporary memory for the vertex and index data.
-            std::vector<uint32_t> indexList;
-            std::vector<float2> texCrds;
-            std::vector<float4> tangents;
-            std::vector<uint4> boneIds;
-            std::vector<float4> boneWeights;
-
             // Indices
-            createIndexList(pAiMesh, indexList);
-            FALCOR_ASSERT(indexList.size() <= std::numeric_limits<uint32_t>::max());
-            mesh.indexCount = (uint32_t)indexList.size();
-            mesh.pIndices = indexList.data();
+            mesh.indexCount = (uint32_t)converted.indices.size();
+            mesh.pIndices = converted.indices.data();
             mesh.topology = Vao::Topology::TriangleList;
 
             // Vertices
@@ -624,45 +464,42 @@ void createMeshes(ImporterData& data)
             mesh.normals.pData = reinterpret_cast<float3*>(pAiMesh->mNormals);
             mesh.normals.frequency = SceneBuilder::Mesh::AttributeFrequency::Vertex;
 
-            if (pAiMesh->HasTextureCoords(0))
+            if (!converted.texCrds.empty())
             {
-                createTexCrdList(pAiMesh->mTextureCoords[0], pAiMesh->mNumVertices, texCrds);
-                FALCOR_ASSERT(!texCrds.empty());
-                mesh.texCrds.pData = texCrds.data();
+                mesh.texCrds.pData = converted.texCrds.data();
                 mesh.texCrds.frequency = SceneBuilder::Mesh::AttributeFrequency::Vertex;
             }
 
-            if (loadTangents && pAiMesh->HasTangentsAndBitangents())
+            if (!converted.tangents.empty())
             {
-                createTangentList(pAiMesh->mTangents, pAiMesh->mBitangents, pAiMesh->mNormals, pAiMesh->mNumVertices, tangents);
-                FALCOR_ASSERT(!tangents.empty());
-                mesh.tangents.pData = tangents.data();
+                mesh.tangents.pData = converted.tangents.data();
                 mesh.tangents.frequency = SceneBuilder::Mesh::AttributeFrequency::Vertex;
             }
 
-            if (pAiMesh->HasBones())
+            if (!converted.boneIDs.empty())
             {
-                loadBones(pAiMesh, data, boneWeights, boneIds);
-                mesh.boneIDs.pData = boneIds.data();
+                mesh.boneIDs.pData = converted.boneIDs.data();
                 mesh.boneIDs.frequency = SceneBuilder::Mesh::AttributeFrequency::Vertex;
-                mesh.boneWeights.pData = boneWeights.data();
+                mesh.boneWeights.pData = converted.boneWeights.data();
                 mesh.boneWeights.frequency = SceneBuilder::Mesh::AttributeFrequency::Vertex;
             }
 
             mesh.pMaterial = data.materialMap.at(pAiMesh->mMaterialIndex);
 
             processedMeshes[i] = data.builder.processMesh(mesh);
+
+            // The processed mesh holds a copy of the data.
+            converted = {};
         }
     );
 
     // Add meshes to the scene.
     // We retain a deterministic order of the meshes in the global scene buffer by adding
     // them sequentially after being processed in parallel.
-    uint32_t i = 0;
-    for (const auto& mesh : processedMeshes)
+    for (size_t i = 0; i < processedMeshes.size(); i++)
     {
-        MeshID meshID = data.builder.addProcessedMesh(mesh);
-        data.meshMap[i++] = meshID;
+        MeshID meshID = data.builder.addProcessedMesh(processedMeshes[i]);
+        data.meshMap[meshIndices[i]] = meshID;
     }
 }
 
@@ -769,8 +606,10 @@ void addMeshInstances(ImporterData& data, aiNode* pNode)
     NodeID nodeID = data.getFalcorNodeID(pNode);
     for (uint32_t mesh = 0; mesh < pNode->mNumMeshes; mesh++)
     {
-        MeshID meshID = data.meshMap.at(pNode->mMeshes[mesh]);
-        data.builder.addMeshInstance(nodeID, meshID);
+        // Skip meshes that were ignored by createMeshes().
+        auto it = data.meshMap.find(pNode->mMeshes[mesh]);
+        if (it != data.meshMap.end())
+            data.builder.addMeshInstance(nodeID, it->second);
     }
 
     // Visit the children
@@ -778,61 +617,8 @@ void addMeshInstances(ImporterData& data, aiNode* pNode)
         addMeshInstances(data, pNode->mChildren[i]);
 }
 
-void loadTextures(
-    ImporterData& data,
-    const aiMaterial* pAiMaterial,
-    const std::filesystem::path& searchPath,
-    const ref<Material>& pMaterial,
-    ImportMode importMode
-)
-{
-    const auto& textureMappings = kTextureMappings[int(importMode)];
-
-    for (const auto& source : textureMappings)
-    {
-        // Skip if texture of requested type is not available
-        if (pAiMaterial->GetTextureCount(source.aiType) < source.aiIndex + 1)
-            continue;
-
-        // Get the texture name
-        aiString aiPath;
-        pAiMaterial->GetTexture(source.aiType, source.aiIndex, &aiPath);
-        std::string path(aiPath.data);
-        // In GLTF2, the path is encoded as a URI
-        if (importMode == ImportMode::GLTF2)
-            path = decodeURI(path);
-        // Assets may contain windows native paths, replace '\' with '/' to make compatible on Linux.
-        std::replace(path.begin(), path.end(), '\\', '/');
-        if (path.empty())
-        {
-            logWarning("AssimpImporter: Texture has empty file name, ignoring.");
-            continue;
-        }
-
-        // Load the texture
-        auto fullPath = searchPath / path;
-        data.builder.loadMaterialTexture(pMaterial, source.targetType, fullPath);
-    }
-}
-
-ref<Material> createMaterial(
-    ImporterData& data,
-    const aiMaterial* pAiMaterial,
-    const std::filesystem::path& searchPath,
-    ImportMode importMode
-)
+ref<Material> createMaterial(ImporterData& data, const AssimpMaterialData& materialData, ImportMode importMode)
 {
-    aiString name;
-    pAiMaterial->Get(AI_MATKEY_NAME, name);
-
-    // Parse the name
-    std::string nameStr = std::string(name.C_Str());
-    if (nameStr.empty())
-    {
-        logWarning("AssimpImporter: Material with no name found -> renaming to 'unnamed'.");
-        nameStr = "unnamed";
-    }
-
     // Determine shading model.
     // MetalRough is the default for everything except OBJ. Check that both flags aren't set simultaneously.
     ShadingModel shadingModel = ShadingModel::MetalRough;
@@ -848,112 +634,63 @@ ref<Material> createMaterial(
     }
 
     // Create an instance of the standard material. All materials are assumed to be of this type.
-    ref<StandardMaterial> pMaterial = StandardMaterial::create(data.builder.getDevice(), nameStr, shadingModel);
+    ref<StandardMaterial> pMaterial = StandardMaterial::create(data.builder.getDevice(), materialData.name, shadingModel);
 
     // Load textures. Note that loading is affected by the current shading model.
-    loadTextures(data, pAiMaterial, searchPath, pMaterial, importMode);
+    for (const auto& [slot, path] : materialData.textures)
+        data.builder.loadMaterialTexture(pMaterial, slot, path);
 
     // Opacity
-    float opacity = 1.f;
-    if (pAiMaterial->Get(AI_MATKEY_OPACITY, opacity) == AI_SUCCESS)
+    float opacity = materialData.opacity.value_or(1.f);
+    if (materialData.opacity)
     {
         float4 diffuse = pMaterial->getBaseColor();
         diffuse.a = opacity;
         pMaterial->setBaseColor(diffuse);
     }
 
-    // Bump scaling
-    float bumpScaling;
-    if (pAiMaterial->Get(AI_MATKEY_BUMPSCALING, bumpScaling) == AI_SUCCESS)
-    {
-        // TODO this should probably be a multiplier to the normal map
-    }
-
     // Shininess
-    float shininess;
-    if (pAiMaterial->Get(AI_MATKEY_SHININESS, shininess) == AI_SUCCESS)
+    if (materialData.shininess)
     {
-        // Convert OBJ/MTL Phong exponent to glossiness.
-        if (importMode == ImportMode::OBJ)
-        {
-            float roughness = convertSpecPowerToRoughness(shininess);
-            shininess = 1.f - roughness;
-        }
         float4 spec = pMaterial->getSpecularParams();
-        spec.a = shininess;
+        spec.a = *materialData.shininess;
         pMaterial->setSpecularParams(spec);
     }
 
     // Refraction
-    float refraction;
-    if (pAiMaterial->Get(AI_MATKEY_REFRACTI, refraction) == AI_SUCCESS)
-        pMaterial->setIndexOfRefraction(refraction);
+    if (materialData.ior)
+        pMaterial->setIndexOfRefraction(*materialData.ior);
 
     // Diffuse color
-    aiColor3D color;
-    if (pAiMaterial->Get(AI_MATKEY_COLOR_DIFFUSE, color) == AI_SUCCESS)
-    {
-        float4 diffuse = float4(color.r, color.g, color.b, pMaterial->getBaseColor().a);
-        pMaterial->setBaseColor(diffuse);
-    }
+    if (materialData.diffuseColor)
+        pMaterial->setBaseColor(float4(*materialData.diffuseColor, pMaterial->getBaseColor().a));
 
     // Specular color
-    if (pAiMaterial->Get(AI_MATKEY_COLOR_SPECULAR, color) == AI_SUCCESS)
-    {
-        float4 specular = float4(color.r, color.g, color.b, pMaterial->getSpecularParams().a);
-        pMaterial->setSpecularParams(specular);
-    }
+    if (materialData.specularColor)
+        pMaterial->setSpecularParams(float4(*materialData.specularColor, pMaterial->getSpecularParams().a));
 
     // Emissive color
-    if (pAiMaterial->Get(AI_MATKEY_COLOR_EMISSIVE, color) == AI_SUCCESS)
-    {
-        float3 emissive = float3(color.r, color.g, color.b);
-        pMaterial->setEmissiveColor(emissive);
-    }
+    if (materialData.emissiveColor)
+        pMaterial->setEmissiveColor(*materialData.emissiveColor);
 
     // Double-Sided
-    int isDoubleSided;
-    if (pAiMaterial->Get(AI_MATKEY_TWOSIDED, isDoubleSided) == AI_SUCCESS)
-        pMaterial->setDoubleSided((isDoubleSided != 0));
+    if (materialData.doubleSided)
+        pMaterial->setDoubleSided(*materialData.doubleSided);
 
     // Handle GLTF2 PBR materials
-    if (importMode == ImportMode::GLTF2)
-    {
-        if (pAiMaterial->Get(AI_MATKEY_BASE_COLOR, color) == AI_SUCCESS)
-        {
-            float4 baseColor = float4(color.r, color.g, color.b, pMaterial->getBaseColor().a);
-            pMaterial->setBaseColor(baseColor);
-        }
+    if (materialData.baseColor)
+        pMaterial->setBaseColor(float4(*materialData.baseColor, pMaterial->getBaseColor().a));
 
+    if (materialData.metallic || materialData.roughness)
+    {
         float4 specularParams = pMaterial->getSpecularParams();
-
-        float metallic;
-        if (pAiMaterial->Get(AI_MATKEY_METALLIC_FACTOR, metallic) == AI_SUCCESS)
-            specularParams.b = metallic;
-
-        float roughness;
-        if (pAiMaterial->Get(AI_MATKEY_ROUGHNESS_FACTOR, roughness) == AI_SUCCESS)
-            specularParams.g = roughness;
-
+        if (materialData.metallic)
+            specularParams.b = *materialData.metallic;
+        if (materialData.roughness)
+            specularParams.g = *materialData.roughness;
         pMaterial->setSpecularParams(specularParams);
     }
 
-    // Parse the information contained in the name
-    // Tokens following a '.' are interpreted as special flags
-    auto nameVec = splitString(nameStr, ".");
-    if (nameVec.size() > 1)
-    {
-        for (size_t i = 1; i < nameVec.size(); i++)
-        {
-            std::string str = nameVec[i];
-            std::transform(str.begin(), str.end(), str.begin(), ::tolower);
-            if (str == "doublesided")
-                pMaterial->setDoubleSided(true);
-            else
-                logWarning("AssimpImporter: Material '{}' has an unknown material property: '{}'.", nameStr, nameVec[i]);
-        }
-    }
-
     // Use scalar opacity value for controlling specular transmission
     // TODO: Remove this workaround when we have a better way to define materials.
     if (opacity < 1.f)
@@ -964,10 +701,17 @@ ref<Material> createMaterial(
 
 void createAllMaterials(ImporterData& data, const std::filesystem::path& searchPath, ImportMode importMode)
 {
-    for (uint32_t i = 0; i < data.pScene->mNumMaterials; i++)
+    // Query the material parameters in parallel. The materials are then created in order,
+    // so that texture loading and the material IDs do not depend on the thread count.
+    AssimpConversionOptions options;
+    options.importMode = importMode;
+    std::vector<AssimpMaterialData> materialData = convertAssimpMaterials(data.pScene, searchPath, options);
+
+    for (uint32_t i = 0; i < (uint32_t)materialData.size(); i++)
     {
-        const aiMaterial* pAiMaterial = data.pScene->mMaterials[i];
-        data.materialMap[i] = createMaterial(data, pAiMaterial, searchPath, importMode);
+        for (const auto& warning : materialData[i].warnings)
+            logWarning(warning);
+        data.materialMap[i] = createMaterial(data, materialData[i], importMode);
     }
 }
 
@@ -282,6 +282,12 @@ void BasicSceneBuilder::onAttributeEnd(FileLoc loc)
         return;
     }
 
+    if (mStack.back().type == StackEntry::Type::Import)
+    {
+        logWarning(loc, "Unmatched AttributeEnd encountered in imported file. Ignoring it.");
+        return;
+    }
+
     if (mStack.back().type == StackEntry::Type::Object)
     {
         throwError(loc, "Mismatched nesting: open ObjectBegin from {} at AttributeEnd.", mStack.back().loc.toString());
@@ -436,6 +442,10 @@ void BasicSceneBuilder::onObjectEnd(FileLoc loc)
     {
         throwError(loc, "Mismatched nesting: open AttributeBegin from {} at ObjectEnd.", mStack.back().loc.toString());
     }
+    else if (mStack.back().type == StackEntry::Type::Import)
+    {
+        throwError(loc, "Mismatched nesting: ObjectEnd in imported file for ObjectBegin from {}.", mpActiveInstanceDefinition->entity.loc.toString());
+    }
     else
     {
         FALCOR_ASSERT(mStack.back().type == StackEntry::Type::Object);
@@ -462,6 +472,27 @@ void BasicSceneBuilder::onObjectInstance(const std::string& name, FileLoc loc)
     mInstances.push_back(std::move(instance));
 }
 
+void BasicSceneBuilder::onImportBegin(FileLoc loc)
+{
+    VERIFY_WORLD("Import");
+
+    mStack.push_back({StackEntry::Type::Import, loc, mGraphicsState});
+}
+
+void BasicSceneBuilder::onImportEnd(FileLoc loc)
+{
+    FALCOR_ASSERT(!mStack.empty());
+
+    if (mStack.back().type != StackEntry::Type::Import)
+    {
+        throwError(loc, "Missing end to {} in imported file.", mStack.back().type == StackEntry::Type::Object ? "ObjectBegin" : "AttributeBegin");
+    }
+
+    // Restore the graphics state of the importing file.
+    mGraphicsState = std::move(mStack.back().graphicsState);
+    mStack.pop_back();
+}
+
 void BasicSceneBuilder::onEndOfFiles()
 {
     if (mCurrentBlock != BlockState::WorldBlock)
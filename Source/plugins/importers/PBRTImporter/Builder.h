@@ -384,6 +384,8 @@ public:
     void onObjectBegin(const std::string& name, FileLoc loc) override;
     void onObjectEnd(FileLoc loc) override;
     void onObjectInstance(const std::string& name, FileLoc loc) override;
+    void onImportBegin(FileLoc loc) override;
+    void onImportEnd(FileLoc loc) override;
 
     void onEndOfFiles() override;
 
@@ -443,7 +445,8 @@ private:
         enum class Type
         {
             Attribute,
-            Object
+            Object,
+            Import
         };
         Type type;
         FileLoc loc;
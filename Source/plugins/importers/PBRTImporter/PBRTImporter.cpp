@@ -62,7 +62,6 @@
 #include "Parser.h"
 #include "Builder.h"
 #include "Helpers.h"
-#include "LoopSubdivide.h"
 #include "EnvMapConverter.h"
 #include "Core/Error.h"
 #include "Core/API/Device.h"
@@ -72,6 +71,8 @@
 #include "Utils/Math/FalcorMath.h"
 #include "Utils/Math/FNVHash.h"
 #include "Scene/Importer.h"
+#include "Scene/LoopSubdivide.h"
+#include "Scene/PlyMesh.h"
 #include "Scene/Material/Material.h"
 #include "Scene/Material/StandardMaterial.h"
 #include "Scene/Material/RGLMaterial.h"
@@ -85,7 +86,9 @@
 #include "Scene/Curves/CurveTessellation.h"
 
 #include <pybind11/pybind11.h>
+#include <BS_thread_pool.hpp>
 
+#include <memory>
 #include <unordered_map>
 
 namespace Falcor
@@ -174,8 +177,22 @@ struct Medium
 struct Shape
 {
     Falcor::ref<Falcor::TriangleMesh> pTriangleMesh;
+    std::shared_ptr<const Falcor::PlyMesh> pPlyMesh; ///< Mesh loaded from a PLY file, added to the scene without converting to a triangle mesh.
+    std::string plyMeshName;
+    bool plyMeshFrontFaceCW = false;
     float4x4 transform = float4x4::identity();
     Falcor::ref<Falcor::Material> pMaterial;
+
+    bool hasMesh() const { return pTriangleMesh || pPlyMesh; }
+};
+
+/**
+ * Result of loading a PLY file.
+ */
+struct PlyMeshEntry
+{
+    std::shared_ptr<const Falcor::PlyMesh> pMesh; ///< Loaded mesh or nullptr if loading failed.
+    std::string error;
 };
 
 /**
@@ -226,6 +243,10 @@ struct BuilderContext
 
     std::map<std::string, InstanceDefinition> instanceDefinitions;
 
+    /// PLY meshes loaded ahead of createShape() by prefetchPlyMeshes(), indexed by resolved path.
+    std::unordered_map<std::string, PlyMeshEntry> plyMeshes;
+    std::unique_ptr<BS::thread_pool> pThreadPool;
+
     size_t curveCount = 0;
 
     bool usePBRTMaterials = false;
@@ -259,7 +280,12 @@ struct BuilderContext
         return pMaterial;
     }
 
-    Resolver resolver = [this](const std::filesystem::path& path) { return scene.resolvePath(path); };
+    Resolver resolver = [this](const std::filesystem::path& path)
+    {
+        auto resolvedPath = scene.resolvePath(path);
+        builder.addDependency(resolvedPath);
+        return resolvedPath;
+    };
 };
 
 inline void warnUnsupportedType(const FileLoc& loc, const std::string_view category, const std::string_view name)
@@ -1415,6 +1441,91 @@ void createAreaLight(BuilderContext& ctx, const SceneEntity& entity, const Falco
     }
 }
 
+/**
+ * Load a PLY file.
+ * Texture coordinates are flipped vertically to match meshes loaded with TriangleMesh::createFromFile().
+ * This function is thread-safe.
+ */
+PlyMeshEntry loadPlyMesh(const std::filesystem::path& path)
+{
+    PlyMeshEntry entry;
+    try
+    {
+        auto pMesh = std::make_shared<Falcor::PlyMesh>(Falcor::PlyMesh::createFromFile(path));
+        for (auto& texCoord : pMesh->texCoords)
+            texCoord.y = 1.f - texCoord.y;
+        if (pMesh->getTriangleCount() == 0)
+            entry.error = fmt::format("PLY file '{}' does not contain any triangles.", path);
+        else
+            entry.pMesh = std::move(pMesh);
+    }
+    catch (const RuntimeError& e)
+    {
+        entry.error = e.what();
+    }
+    return entry;
+}
+
+/**
+ * Load the PLY files referenced by a range of shapes in parallel.
+ * The meshes are stored in BuilderContext::plyMeshes, where createShape() picks them up.
+ */
+void prefetchPlyMeshes(BuilderContext& ctx, fstd::span<const ShapeSceneEntity> entities)
+{
+    std::vector<std::filesystem::path> paths;
+    for (const auto& entity : entities)
+    {
+        if (entity.name != "plymesh")
+            continue;
+        auto path = ctx.resolver(entity.params.getString("filename", ""));
+        if (ctx.plyMeshes.emplace(path.string(), PlyMeshEntry{}).second)
+            paths.push_back(path);
+    }
+
+    if (paths.empty())
+        return;
+
+    std::vector<PlyMeshEntry> entries(paths.size());
+    auto load = [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+            entries[i] = loadPlyMesh(paths[i]);
+    };
+
+    if (paths.size() == 1)
+    {
+        load(0, 1);
+    }
+    else
+    {
+        if (!ctx.pThreadPool)
+            ctx.pThreadPool = std::make_unique<BS::thread_pool>();
+        ctx.pThreadPool->parallelize_loop(size_t(0), paths.size(), load, paths.size()).wait();
+    }
+
+    for (size_t i = 0; i < paths.size(); ++i)
+        ctx.plyMeshes[paths[i].string()] = std::move(entries[i]);
+}
+
+/**
+ * Call a function on each shape entity.
+ * The PLY files are loaded in parallel in batches of shapes, which bounds the memory held by meshes not yet added to the scene.
+ */
+template<typename Func>
+void forEachShape(BuilderContext& ctx, const std::vector<ShapeSceneEntity>& entities, const Func& func)
+{
+    const size_t kBatchSize = 64;
+
+    for (size_t begin = 0; begin < entities.size(); begin += kBatchSize)
+    {
+        fstd::span<const ShapeSceneEntity> batch(entities.data() + begin, std::min(kBatchSize, entities.size() - begin));
+        prefetchPlyMeshes(ctx, batch);
+        for (const auto& entity : batch)
+            func(entity);
+        ctx.plyMeshes.clear();
+    }
+}
+
 Shape createShape(BuilderContext& ctx, const ShapeSceneEntity& entity)
 {
     auto warnUnsupported = [&]() { warnUnsupportedType(entity.loc, "Shape", entity.name); };
@@ -1593,9 +1704,17 @@ Shape createShape(BuilderContext& ctx, const ShapeSceneEntity& entity)
         auto filename = params.getString("filename", "");
         auto path = ctx.resolver(filename);
 
-        shape.pTriangleMesh = Falcor::TriangleMesh::createFromFile(path.string());
-        if (shape.pTriangleMesh)
-            shape.pTriangleMesh->setName(filename);
+        auto it = ctx.plyMeshes.find(path.string());
+        PlyMeshEntry entry = it != ctx.plyMeshes.end() ? it->second : loadPlyMesh(path);
+        if (entry.pMesh)
+        {
+            shape.pPlyMesh = std::move(entry.pMesh);
+            shape.plyMeshName = filename;
+        }
+        else
+        {
+            logWarning(entity.loc, "{}", entry.error);
+        }
         shape.transform = entity.transform;
     }
     else if (type == "loopsubdiv")
@@ -1614,8 +1733,11 @@ Shape createShape(BuilderContext& ctx, const ShapeSceneEntity& entity)
         if (P.empty())
             throwError(entity.loc, "Missing vertex positions in 'P'.");
 
-        auto result =
-            loopSubdivide(levels, P, fstd::span<const uint32_t>(reinterpret_cast<const uint32_t*>(indices.data()), indices.size()));
+        if (!ctx.pThreadPool)
+            ctx.pThreadPool = std::make_unique<BS::thread_pool>();
+        auto result = loopSubdivide(
+            levels, P, fstd::span<const uint32_t>(reinterpret_cast<const uint32_t*>(indices.data()), indices.size()), ctx.pThreadPool.get()
+        );
 
         Falcor::TriangleMesh::VertexList vertexList(result.positions.size());
         for (size_t i = 0; i < result.positions.size(); ++i)
@@ -1638,6 +1760,8 @@ Shape createShape(BuilderContext& ctx, const ShapeSceneEntity& entity)
     // Reverse orientation.
     if (entity.reverseOrientation && shape.pTriangleMesh)
         shape.pTriangleMesh->setFrontFaceCW(!shape.pTriangleMesh->getFrontFaceCW());
+    if (entity.reverseOrientation && shape.pPlyMesh)
+        shape.plyMeshFrontFaceCW = !shape.plyMeshFrontFaceCW;
 
     // Get the material.
     shape.pMaterial = ctx.getMaterial(entity.materialRef);
@@ -1667,6 +1791,47 @@ Shape createShape(BuilderContext& ctx, const ShapeSceneEntity& entity)
     return shape;
 }
 
+/**
+ * Add the mesh of a shape to the scene builder.
+ * PLY meshes are passed to the scene builder directly from the loaded vertex and index arrays.
+ */
+Falcor::MeshID addShapeMesh(BuilderContext& ctx, const Shape& shape)
+{
+    FALCOR_ASSERT(shape.hasMesh());
+
+    if (shape.pTriangleMesh)
+        return ctx.builder.addTriangleMesh(shape.pTriangleMesh, shape.pMaterial);
+
+    const auto& plyMesh = *shape.pPlyMesh;
+
+    // Use flat normals if the file has none, matching the normals generated by Assimp.
+    std::vector<float3> faceNormals;
+    if (plyMesh.normals.empty())
+        faceNormals = plyMesh.computeFaceNormals();
+    const float2 defaultTexCoord(0.f);
+
+    Falcor::SceneBuilder::Mesh mesh;
+    mesh.name = shape.plyMeshName;
+    mesh.faceCount = plyMesh.getTriangleCount();
+    mesh.vertexCount = plyMesh.getVertexCount();
+    mesh.indexCount = (uint32_t)plyMesh.indices.size();
+    mesh.pIndices = plyMesh.indices.data();
+    mesh.topology = Vao::Topology::TriangleList;
+    mesh.isFrontFaceCW = shape.plyMeshFrontFaceCW;
+    mesh.pMaterial = shape.pMaterial;
+    mesh.positions = {plyMesh.positions.data(), Falcor::SceneBuilder::Mesh::AttributeFrequency::Vertex};
+    if (plyMesh.normals.empty())
+        mesh.normals = {faceNormals.data(), Falcor::SceneBuilder::Mesh::AttributeFrequency::Uniform};
+    else
+        mesh.normals = {plyMesh.normals.data(), Falcor::SceneBuilder::Mesh::AttributeFrequency::Vertex};
+    if (plyMesh.texCoords.empty())
+        mesh.texCrds = {&defaultTexCoord, Falcor::SceneBuilder::Mesh::AttributeFrequency::Constant};
+    else
+        mesh.texCrds = {plyMesh.texCoords.data(), Falcor::SceneBuilder::Mesh::AttributeFrequency::Vertex};
+
+    return ctx.builder.addMesh(mesh);
+}
+
 /**
  * Create curve geometry from a curve aggregate.
  * This can either result in mesh or curve geometry depending on the tesselation mode.
@@ -1758,13 +1923,13 @@ InstanceDefinition createInstanceDefinition(BuilderContext& ctx, const InstanceD
 {
     InstanceDefinition instanceDefinition;
 
-    for (const auto& shapeEntity : entity.shapes)
+    auto processShape = [&](const ShapeSceneEntity& shapeEntity)
     {
         // Process shapes and create meshes.
         auto shape = createShape(ctx, shapeEntity);
-        if (shape.pTriangleMesh)
+        if (shape.hasMesh())
         {
-            auto meshID = ctx.builder.addTriangleMesh(shape.pTriangleMesh, shape.pMaterial);
+            auto meshID = addShapeMesh(ctx, shape);
             instanceDefinition.meshes.emplace_back(meshID, shape.transform);
         }
 
@@ -1786,7 +1951,8 @@ InstanceDefinition createInstanceDefinition(BuilderContext& ctx, const InstanceD
             }
         }
         ctx.curveAggregates.clear();
-    }
+    };
+    forEachShape(ctx, entity.shapes, processShape);
 
     return instanceDefinition;
 }
@@ -1843,16 +2009,17 @@ void buildScene(BuilderContext& ctx)
     }
 
     // Process shapes and create meshes.
-    for (const auto& entity : ctx.scene.getShapes())
+    auto processShape = [&](const ShapeSceneEntity& entity)
     {
         auto shape = createShape(ctx, entity);
-        if (shape.pTriangleMesh)
+        if (shape.hasMesh())
         {
             auto nodeID = ctx.builder.addNode({entity.name, shape.transform});
-            auto meshID = ctx.builder.addTriangleMesh(shape.pTriangleMesh, shape.pMaterial);
+            auto meshID = addShapeMesh(ctx, shape);
             ctx.builder.addMeshInstance(nodeID, meshID);
         }
-    }
+    };
+    forEachShape(ctx, ctx.scene.getShapes(), processShape);
 
     // Create curves from curve aggregates assembled during the processing step above.
     for (const auto& [_, curveAggregate] : ctx.curveAggregates)
@@ -1925,7 +2092,7 @@ void PBRTImporter::importScene(
         TimeReport timeReport;
         pbrt::BasicScene pbrtScene(path.parent_path());
         pbrt::BasicSceneBuilder pbrtBuilder(pbrtScene);
-        pbrt::parseFile(pbrtBuilder, path);
+        pbrt::parseFile(pbrtBuilder, path, [&builder](const std::filesystem::path& file) { builder.addDependency(file); });
         timeReport.measure("Parsing pbrt scene");
 
         pbrt::BuilderContext ctx{pbrtScene, builder};
@@ -38,10 +38,14 @@
 #include "Utils/Logger.h"
 
 #include <fast_float/fast_float.h>
+#include <BS_thread_pool.hpp>
 
+#include <array>
 #include <atomic>
+#include <future>
 #include <utility>
 #include <charconv>
+#include <cstring>
 
 namespace Falcor::pbrt
 {
@@ -90,13 +94,16 @@ std::unique_ptr<Tokenizer> Tokenizer::createFromFile(const std::filesystem::path
 {
     if (hasExtension(path, "gz"))
     {
-        std::string str = decompressFile(path);
-        return std::make_unique<Tokenizer>(std::move(str), path);
+        auto pStream = std::make_unique<GzipStream>(path);
+        return std::make_unique<Tokenizer>(std::move(pStream), path);
     }
     else
     {
-        std::string str = readFile(path);
-        return std::make_unique<Tokenizer>(std::move(str), path);
+        auto pMappedFile = std::make_unique<MemoryMappedFile>(path, MemoryMappedFile::kWholeFile, MemoryMappedFile::AccessHint::SequentialScan);
+        // Mapping fails for empty files, fall back to reading the file (which throws if it cannot be read).
+        if (!pMappedFile->isOpen())
+            return std::make_unique<Tokenizer>(readFile(path), path);
+        return std::make_unique<Tokenizer>(std::move(pMappedFile), path);
     }
 }
 
@@ -105,18 +112,70 @@ std::unique_ptr<Tokenizer> Tokenizer::createFromString(std::string str)
     return std::make_unique<Tokenizer>(std::move(str), "<string>");
 }
 
-Tokenizer::Tokenizer(std::string str, const std::filesystem::path& path) : mPath(path), mContents(std::move(str))
+Tokenizer::Tokenizer(const std::filesystem::path& path) : mPath(path)
 {
     auto pFilename = std::make_unique<std::string>(path.string());
     mLoc = FileLoc(*pFilename);
-    getFilenames().push_back(std::move(pFilename));
+    {
+        std::lock_guard<std::mutex> lock(getFilenamesMutex());
+        getFilenames().push_back(std::move(pFilename));
+    }
+}
 
+Tokenizer::Tokenizer(std::string str, const std::filesystem::path& path) : Tokenizer(path)
+{
+    mContents = std::move(str);
     mPos = mContents.data();
     mEnd = mPos + mContents.size();
-    if (isUTF16(mContents.data(), mContents.size()))
+    checkEncoding();
+}
+
+Tokenizer::Tokenizer(std::unique_ptr<MemoryMappedFile> pMappedFile, const std::filesystem::path& path) : Tokenizer(path)
+{
+    mpMappedFile = std::move(pMappedFile);
+    mPos = static_cast<const char*>(mpMappedFile->getData());
+    mEnd = mPos + mpMappedFile->getMappedSize();
+    checkEncoding();
+}
+
+Tokenizer::Tokenizer(std::unique_ptr<GzipStream> pStream, const std::filesystem::path& path) : Tokenizer(path)
+{
+    mpStream = std::move(pStream);
+    mPos = mEnd = mTokenStart = mContents.data();
+    refill();
+    checkEncoding();
+}
+
+void Tokenizer::checkEncoding()
+{
+    if (isUTF16(mPos, mEnd - mPos))
         throwError("File is encoded with UTF-16, which is not currently supported.");
 }
 
+bool Tokenizer::refill()
+{
+    if (!mpStream)
+        return false;
+
+    if (!mpStream->read(mChunk))
+    {
+        mpStream.reset();
+        return false;
+    }
+
+    // Keep the part of the current token scanned so far, everything before it has been consumed.
+    FALCOR_ASSERT(mPos == mEnd && mTokenStart <= mPos);
+    size_t keep = mEnd - mTokenStart;
+    std::memmove(mContents.data(), mTokenStart, keep);
+    mContents.resize(keep);
+    mContents.append(mChunk);
+
+    mTokenStart = mContents.data();
+    mPos = mTokenStart + keep;
+    mEnd = mContents.data() + mContents.size();
+    return true;
+}
+
 bool Tokenizer::isUTF16(const void* ptr, size_t len) const
 {
     auto c = reinterpret_cast<const unsigned char*>(ptr);
@@ -128,7 +187,7 @@ std::optional<Token> Tokenizer::next()
 {
     while (true)
     {
-        const char* tokenStart = mPos;
+        mTokenStart = mPos;
         FileLoc startLoc = mLoc;
 
         int ch = getChar();
@@ -167,12 +226,12 @@ std::optional<Token> Tokenizer::next()
 
             if (!haveEscaped)
             {
-                return Token({tokenStart, size_t(mPos - tokenStart)}, startLoc);
+                return Token({mTokenStart, size_t(mPos - mTokenStart)}, startLoc);
             }
             else
             {
                 mEscaped.clear();
-                for (const char* p = tokenStart; p < mPos; ++p)
+                for (const char* p = mTokenStart; p < mPos; ++p)
                 {
                     if (*p != '\\')
                     {
@@ -190,7 +249,7 @@ std::optional<Token> Tokenizer::next()
         }
         else if (ch == '[' || ch == ']')
         {
-            return Token({tokenStart, size_t(1)}, startLoc);
+            return Token({mTokenStart, size_t(1)}, startLoc);
         }
         else if (ch == '#')
         {
@@ -204,7 +263,7 @@ std::optional<Token> Tokenizer::next()
                 }
             }
 
-            return Token({tokenStart, size_t(mPos - tokenStart)}, startLoc);
+            return Token({mTokenStart, size_t(mPos - mTokenStart)}, startLoc);
         }
         else
         {
@@ -217,7 +276,7 @@ std::optional<Token> Tokenizer::next()
                     break;
                 }
             }
-            return Token({tokenStart, size_t(mPos - tokenStart)}, startLoc);
+            return Token({mTokenStart, size_t(mPos - mTokenStart)}, startLoc);
         }
     }
 }
@@ -448,13 +507,282 @@ static ParsedParameterVector parseParameters(Next nextToken, Unget ungetToken)
     return parameterVector;
 }
 
-void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
+/**
+ * Parser target that records all directives, so that they can be issued to another target later.
+ * This is used to parse imported files in parallel and issue their directives in file order.
+ */
+class RecordingParserTarget : public ParserTarget
+{
+public:
+    using ImportFuture = std::shared_future<std::shared_ptr<RecordingParserTarget>>;
+
+    void onScale(Float sx, Float sy, Float sz, FileLoc loc) override
+    {
+        record([=](ParserTarget& t) { t.onScale(sx, sy, sz, loc); });
+    }
+    void onShape(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        record([=, params = std::move(params)](ParserTarget& t) mutable { t.onShape(name, std::move(params), loc); });
+    }
+    void onOption(const std::string& name, const std::string& value, FileLoc loc) override
+    {
+        record([=](ParserTarget& t) { t.onOption(name, value, loc); });
+    }
+    void onIdentity(FileLoc loc) override
+    {
+        record([=](ParserTarget& t) { t.onIdentity(loc); });
+    }
+    void onTranslate(Float dx, Float dy, Float dz, FileLoc loc) override
+    {
+        record([=](ParserTarget& t) { t.onTranslate(dx, dy, dz, loc); });
+    }
+    void onRotate(Float angle, Float ax, Float ay, Float az, FileLoc loc) override
+    {
+        record([=](ParserTarget& t) { t.onRotate(angle, ax, ay, az, loc); });
+    }
+    void onLookAt(Float ex, Float ey, Float ez, Float lx, Float ly, Float lz, Float ux, Float uy, Float uz, FileLoc loc) override
+    {
+        record([=](ParserTarget& t) { t.onLookAt(ex, ey, ez, lx, ly, lz, ux, uy, uz, loc); });
+    }
+    void onConcatTransform(Float transform[16], FileLoc loc) override
+    {
+        std::array<Float, 16> m;
+        std::copy(transform, transform + 16, m.begin());
+        record([=](ParserTarget& t) mutable { t.onConcatTransform(m.data(), loc); });
+    }
+    void onTransform(Float transform[16], FileLoc loc) override
+    {
+        std::array<Float, 16> m;
+        std::copy(transform, transform + 16, m.begin());
+        record([=](ParserTarget& t) mutable { t.onTransform(m.data(), loc); });
+    }
+    void onCoordinateSystem(const std::string& name, FileLoc loc) override
+    {
+        record([=](ParserTarget& t) { t.onCoordinateSystem(name, loc); });
+    }
+    void onCoordSysTransform(const std::string& name, FileLoc loc) override
+    {
+        record([=](ParserTarget& t) { t.onCoordSysTransform(name, loc); });
+    }
+    void onActiveTransformAll(FileLoc loc) override
+    {
+        record([=](ParserTarget& t) { t.onActiveTransformAll(loc); });
+    }
+    void onActiveTransformEndTime(FileLoc loc) override
+    {
+        record([=](ParserTarget& t) { t.onActiveTransformEndTime(loc); });
+    }
+    void onActiveTransformStartTime(FileLoc loc) override
+    {
+        record([=](ParserTarget& t) { t.onActiveTransformStartTime(loc); });
+    }
+    void onTransformTimes(Float start, Float end, FileLoc loc) override
+    {
+        record([=](ParserTarget& t) { t.onTransformTimes(start, end, loc); });
+    }
+    void onColorSpace(const std::string& name, FileLoc loc) override
+    {
+        record([=](ParserTarget& t) { t.onColorSpace(name, loc); });
+    }
+    void onPixelFilter(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        recordParamList(&ParserTarget::onPixelFilter, name, std::move(params), loc);
+    }
+    void onFilm(const std::string& type, ParsedParameterVector params, FileLoc loc) override
+    {
+        recordParamList(&ParserTarget::onFilm, type, std::move(params), loc);
+    }
+    void onAccelerator(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        recordParamList(&ParserTarget::onAccelerator, name, std::move(params), loc);
+    }
+    void onIntegrator(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        recordParamList(&ParserTarget::onIntegrator, name, std::move(params), loc);
+    }
+    void onCamera(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        recordParamList(&ParserTarget::onCamera, name, std::move(params), loc);
+    }
+    void onMakeNamedMedium(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        recordParamList(&ParserTarget::onMakeNamedMedium, name, std::move(params), loc);
+    }
+    void onMediumInterface(const std::string& insideName, const std::string& outsideName, FileLoc loc) override
+    {
+        record([=](ParserTarget& t) { t.onMediumInterface(insideName, outsideName, loc); });
+    }
+    void onSampler(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        recordParamList(&ParserTarget::onSampler, name, std::move(params), loc);
+    }
+    void onWorldBegin(FileLoc loc) override
+    {
+        record([=](ParserTarget& t) { t.onWorldBegin(loc); });
+    }
+    void onAttributeBegin(FileLoc loc) override
+    {
+        record([=](ParserTarget& t) { t.onAttributeBegin(loc); });
+    }
+    void onAttributeEnd(FileLoc loc) override
+    {
+        record([=](ParserTarget& t) { t.onAttributeEnd(loc); });
+    }
+    void onAttribute(const std::string& target, ParsedParameterVector params, FileLoc loc) override
+    {
+        recordParamList(&ParserTarget::onAttribute, target, std::move(params), loc);
+    }
+    void onTexture(const std::string& name, const std::string& type, const std::string& texname, ParsedParameterVector params, FileLoc loc)
+        override
+    {
+        record([=, params = std::move(params)](ParserTarget& t) mutable { t.onTexture(name, type, texname, std::move(params), loc); });
+    }
+    void onMaterial(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        recordParamList(&ParserTarget::onMaterial, name, std::move(params), loc);
+    }
+    void onMakeNamedMaterial(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        recordParamList(&ParserTarget::onMakeNamedMaterial, name, std::move(params), loc);
+    }
+    void onNamedMaterial(const std::string& name, FileLoc loc) override
+    {
+        record([=](ParserTarget& t) { t.onNamedMaterial(name, loc); });
+    }
+    void onLightSource(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        recordParamList(&ParserTarget::onLightSource, name, std::move(params), loc);
+    }
+    void onAreaLightSource(const std::string& name, ParsedParameterVector params, FileLoc loc) override
+    {
+        recordParamList(&ParserTarget::onAreaLightSource, name, std::move(params), loc);
+    }
+    void onReverseOrientation(FileLoc loc) override
+    {
+        record([=](ParserTarget& t) { t.onReverseOrientation(loc); });
+    }
+    void onObjectBegin(const std::string& name, FileLoc loc) override
+    {
+        record([=](ParserTarget& t) { t.onObjectBegin(name, loc); });
+    }
+    void onObjectEnd(FileLoc loc) override
+    {
+        record([=](ParserTarget& t) { t.onObjectEnd(loc); });
+    }
+    void onObjectInstance(const std::string& name, FileLoc loc) override
+    {
+        record([=](ParserTarget& t) { t.onObjectInstance(name, loc); });
+    }
+    void onImportBegin(FileLoc loc) override
+    {
+        record([=](ParserTarget& t) { t.onImportBegin(loc); });
+    }
+    void onImportEnd(FileLoc loc) override
+    {
+        record([=](ParserTarget& t) { t.onImportEnd(loc); });
+    }
+    void onEndOfFiles() override { FALCOR_UNREACHABLE(); }
+
+    /**
+     * Record the directives of an imported file that is being parsed asynchronously.
+     * The recording is waited for when replaying.
+     */
+    void recordImport(ImportFuture future, FileLoc loc)
+    {
+        record(
+            [=](ParserTarget& t)
+            {
+                auto pImported = future.get();
+                t.onImportBegin(loc);
+                pImported->replay(t);
+                t.onImportEnd(loc);
+            }
+        );
+    }
+
+    /**
+     * Issue all recorded directives to a target, in the order they were recorded.
+     * The recording is cleared.
+     */
+    void replay(ParserTarget& target)
+    {
+        for (auto& directive : mDirectives)
+            directive(target);
+        mDirectives.clear();
+    }
+
+private:
+    using Directive = std::function<void(ParserTarget&)>;
+
+    template<typename F>
+    void record(F&& func)
+    {
+        mDirectives.emplace_back(std::forward<F>(func));
+    }
+
+    void recordParamList(
+        void (ParserTarget::*apiFunc)(const std::string&, ParsedParameterVector, FileLoc),
+        const std::string& name,
+        ParsedParameterVector params,
+        FileLoc loc
+    )
+    {
+        record([=, params = std::move(params)](ParserTarget& t) mutable { (t.*apiFunc)(name, std::move(params), loc); });
+    }
+
+    std::vector<Directive> mDirectives;
+};
+
+/**
+ * State shared by the parsing of a scene file and all the files it imports.
+ */
+struct ParseContext
+{
+    std::filesystem::path searchPath; ///< Directory that 'Include' and 'Import' file names are relative to.
+    FileCallback onFile;              ///< Called with the path of each included or imported file.
+
+    std::mutex mutex;
+    std::unique_ptr<BS::thread_pool> pThreadPool; ///< Thread pool parsing imported files, created on the first 'Import'.
+
+    ParseContext(const std::filesystem::path& searchPath, FileCallback onFile = {}) : searchPath(searchPath), onFile(std::move(onFile)) {}
+
+    /**
+     * Start parsing a file on the thread pool.
+     * Errors are reported when getting the result of the returned future.
+     */
+    RecordingParserTarget::ImportFuture parseAsync(const std::filesystem::path& path);
+};
+
+static void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer, ParseContext& ctx);
+
+RecordingParserTarget::ImportFuture ParseContext::parseAsync(const std::filesystem::path& path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!pThreadPool)
+        pThreadPool = std::make_unique<BS::thread_pool>();
+
+    auto task = [this, path]()
+    {
+        auto pRecording = std::make_shared<RecordingParserTarget>();
+        parse(*pRecording, Tokenizer::createFromFile(path), *this);
+        return pRecording;
+    };
+    return pThreadPool->submit(task).share();
+}
+
+static void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer, ParseContext& ctx)
 {
     static std::atomic<bool> warnedTransformBeginEndDeprecated{false};
 
     logInfo("PBRTImporter: Started parsing '{}'.", tokenizer->getPath().string());
 
-    auto searchPath = tokenizer->getPath().parent_path();
+    /**
+     * Directives are issued to the target directly until the first 'Import'. From there on, they are recorded and
+     * issued after parsing, so that the imported files can be parsed in parallel and still be issued in file order.
+     */
+    ParserTarget* pTarget = &target;
+    RecordingParserTarget* pRecording = dynamic_cast<RecordingParserTarget*>(&target);
+    std::unique_ptr<RecordingParserTarget> pDeferred;
 
     std::vector<std::unique_ptr<Tokenizer>> fileStack;
     fileStack.push_back(std::move(tokenizer));
@@ -515,7 +843,7 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
         std::string_view dequoted = dequoteString(t);
         std::string n = toString(dequoted);
         ParsedParameterVector parameterVector = parseParameters(nextToken, unget);
-        (target.*apiFunc)(n, std::move(parameterVector), loc);
+        (pTarget->*apiFunc)(n, std::move(parameterVector), loc);
     };
 
     auto syntaxError = [&](const Token& t)
@@ -526,6 +854,15 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
             throwError(t.loc, "Unknown directive: {}", t.token);
     };
 
+    // Note: Tokens are only valid until the next token is fetched, so errors after fetching
+    // the arguments of a directive must not refer to the directive token anymore.
+    auto expectToken = [&](std::string_view expected)
+    {
+        Token t = *nextToken(TokenRequired);
+        if (t.token != expected)
+            throwError(t.loc, "Expected '{}', found '{}'.", expected, t.token);
+    };
+
     std::optional<Token> tok;
 
     while (true)
@@ -539,11 +876,11 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
         case 'A':
             if (tok->token == "AttributeBegin")
             {
-                target.onAttributeBegin(tok->loc);
+                pTarget->onAttributeBegin(tok->loc);
             }
             else if (tok->token == "AttributeEnd")
             {
-                target.onAttributeEnd(tok->loc);
+                pTarget->onAttributeEnd(tok->loc);
             }
             else if (tok->token == "Attribute")
             {
@@ -553,13 +890,13 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
             {
                 Token a = *nextToken(TokenRequired);
                 if (a.token == "All")
-                    target.onActiveTransformAll(tok->loc);
+                    pTarget->onActiveTransformAll(tok->loc);
                 else if (a.token == "EndTime")
-                    target.onActiveTransformEndTime(tok->loc);
+                    pTarget->onActiveTransformEndTime(tok->loc);
                 else if (a.token == "StartTime")
-                    target.onActiveTransformStartTime(tok->loc);
+                    pTarget->onActiveTransformStartTime(tok->loc);
                 else
-                    syntaxError(*tok);
+                    throwError(a.loc, "Unknown ActiveTransform type: {}", a.token);
             }
             else if (tok->token == "AreaLightSource")
             {
@@ -578,29 +915,27 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
         case 'C':
             if (tok->token == "ConcatTransform")
             {
-                if (nextToken(TokenRequired)->token != "[")
-                    syntaxError(*tok);
+                expectToken("[");
                 Float m[16];
                 for (int i = 0; i < 16; ++i)
                     m[i] = parseFloat(*nextToken(TokenRequired));
-                if (nextToken(TokenRequired)->token != "]")
-                    syntaxError(*tok);
-                target.onConcatTransform(m, tok->loc);
+                expectToken("]");
+                pTarget->onConcatTransform(m, tok->loc);
             }
             else if (tok->token == "CoordinateSystem")
             {
                 std::string_view n = dequoteString(*nextToken(TokenRequired));
-                target.onCoordinateSystem(toString(n), tok->loc);
+                pTarget->onCoordinateSystem(toString(n), tok->loc);
             }
             else if (tok->token == "CoordSysTransform")
             {
                 std::string_view n = dequoteString(*nextToken(TokenRequired));
-                target.onCoordSysTransform(toString(n), tok->loc);
+                pTarget->onCoordSysTransform(toString(n), tok->loc);
             }
             else if (tok->token == "ColorSpace")
             {
                 std::string_view n = dequoteString(*nextToken(TokenRequired));
-                target.onColorSpace(toString(n), tok->loc);
+                pTarget->onColorSpace(toString(n), tok->loc);
             }
             else if (tok->token == "Camera")
             {
@@ -632,18 +967,31 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
             {
                 Token filenameToken = *nextToken(TokenRequired);
                 std::string filename = toString(dequoteString(filenameToken));
-                auto path = searchPath / filename;
+                auto path = ctx.searchPath / filename;
+                if (ctx.onFile)
+                    ctx.onFile(path);
                 std::unique_ptr<Tokenizer> includeTokenizer = Tokenizer::createFromFile(path);
                 logInfo("PBRTImporter: Started parsing '{}'.", includeTokenizer->getPath().string());
                 fileStack.push_back(std::move(includeTokenizer));
             }
             else if (tok->token == "Import")
             {
-                throwError(tok->loc, "'Import' directive not supported yet.");
+                Token filenameToken = *nextToken(TokenRequired);
+                std::string filename = toString(dequoteString(filenameToken));
+                auto path = ctx.searchPath / filename;
+                if (ctx.onFile)
+                    ctx.onFile(path);
+                if (!pRecording)
+                {
+                    pDeferred = std::make_unique<RecordingParserTarget>();
+                    pRecording = pDeferred.get();
+                    pTarget = pRecording;
+                }
+                pRecording->recordImport(ctx.parseAsync(path), tok->loc);
             }
             else if (tok->token == "Identity")
             {
-                target.onIdentity(tok->loc);
+                pTarget->onIdentity(tok->loc);
             }
             else
             {
@@ -661,7 +1009,7 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
                 Float v[9];
                 for (int i = 0; i < 9; ++i)
                     v[i] = parseFloat(*nextToken(TokenRequired));
-                target.onLookAt(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7], v[8], tok->loc);
+                pTarget->onLookAt(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7], v[8], tok->loc);
             }
             else
             {
@@ -703,7 +1051,7 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
                 else
                     names[1] = names[0];
 
-                target.onMediumInterface(names[0], names[1], tok->loc);
+                pTarget->onMediumInterface(names[0], names[1], tok->loc);
             }
             else
             {
@@ -715,7 +1063,7 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
             if (tok->token == "NamedMaterial")
             {
                 std::string_view n = dequoteString(*nextToken(TokenRequired));
-                target.onNamedMaterial(toString(n), tok->loc);
+                pTarget->onNamedMaterial(toString(n), tok->loc);
             }
             else
             {
@@ -727,22 +1075,22 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
             if (tok->token == "ObjectBegin")
             {
                 std::string_view n = dequoteString(*nextToken(TokenRequired));
-                target.onObjectBegin(toString(n), tok->loc);
+                pTarget->onObjectBegin(toString(n), tok->loc);
             }
             else if (tok->token == "ObjectEnd")
             {
-                target.onObjectEnd(tok->loc);
+                pTarget->onObjectEnd(tok->loc);
             }
             else if (tok->token == "ObjectInstance")
             {
                 std::string_view n = dequoteString(*nextToken(TokenRequired));
-                target.onObjectInstance(toString(n), tok->loc);
+                pTarget->onObjectInstance(toString(n), tok->loc);
             }
             else if (tok->token == "Option")
             {
                 std::string name = toString(dequoteString(*nextToken(TokenRequired)));
                 std::string value = toString(nextToken(TokenRequired)->token);
-                target.onOption(name, value, tok->loc);
+                pTarget->onOption(name, value, tok->loc);
             }
             else
             {
@@ -764,14 +1112,14 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
         case 'R':
             if (tok->token == "ReverseOrientation")
             {
-                target.onReverseOrientation(tok->loc);
+                pTarget->onReverseOrientation(tok->loc);
             }
             else if (tok->token == "Rotate")
             {
                 Float v[4];
                 for (int i = 0; i < 4; ++i)
                     v[i] = parseFloat(*nextToken(TokenRequired));
-                target.onRotate(v[0], v[1], v[2], v[3], tok->loc);
+                pTarget->onRotate(v[0], v[1], v[2], v[3], tok->loc);
             }
             else
             {
@@ -793,7 +1141,7 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
                 Float v[3];
                 for (int i = 0; i < 3; ++i)
                     v[i] = parseFloat(*nextToken(TokenRequired));
-                target.onScale(v[0], v[1], v[2], tok->loc);
+                pTarget->onScale(v[0], v[1], v[2], tok->loc);
             }
             else
             {
@@ -809,36 +1157,34 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
                     logWarning(tok->loc, "TransformBegin/End are deprecated and should be replaced with AttributeBegin/End.");
                     warnedTransformBeginEndDeprecated = true;
                 }
-                target.onAttributeBegin(tok->loc);
+                pTarget->onAttributeBegin(tok->loc);
             }
             else if (tok->token == "TransformEnd")
             {
-                target.onAttributeEnd(tok->loc);
+                pTarget->onAttributeEnd(tok->loc);
             }
             else if (tok->token == "Transform")
             {
-                if (nextToken(TokenRequired)->token != "[")
-                    syntaxError(*tok);
+                expectToken("[");
                 Float m[16];
                 for (int i = 0; i < 16; ++i)
                     m[i] = parseFloat(*nextToken(TokenRequired));
-                if (nextToken(TokenRequired)->token != "]")
-                    syntaxError(*tok);
-                target.onTransform(m, tok->loc);
+                expectToken("]");
+                pTarget->onTransform(m, tok->loc);
             }
             else if (tok->token == "Translate")
             {
                 Float v[3];
                 for (int i = 0; i < 3; ++i)
                     v[i] = parseFloat(*nextToken(TokenRequired));
-                target.onTranslate(v[0], v[1], v[2], tok->loc);
+                pTarget->onTranslate(v[0], v[1], v[2], tok->loc);
             }
             else if (tok->token == "TransformTimes")
             {
                 Float v[2];
                 for (int i = 0; i < 2; ++i)
                     v[i] = parseFloat(*nextToken(TokenRequired));
-                target.onTransformTimes(v[0], v[1], tok->loc);
+                pTarget->onTransformTimes(v[0], v[1], tok->loc);
             }
             else if (tok->token == "Texture")
             {
@@ -851,7 +1197,7 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
                 std::string_view dequoted = dequoteString(t);
                 std::string texName = toString(dequoted);
                 ParsedParameterVector params = parseParameters(nextToken, unget);
-                target.onTexture(name, type, texName, std::move(params), tok->loc);
+                pTarget->onTexture(name, type, texName, std::move(params), tok->loc);
             }
             else
             {
@@ -862,7 +1208,7 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
         case 'W':
             if (tok->token == "WorldBegin")
             {
-                target.onWorldBegin(tok->loc);
+                pTarget->onWorldBegin(tok->loc);
             }
             else
             {
@@ -874,19 +1220,24 @@ void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
             syntaxError(*tok);
         }
     }
+
+    if (pDeferred)
+        pDeferred->replay(target);
 }
 
-void parseFile(ParserTarget& target, const std::filesystem::path& path)
+void parseFile(ParserTarget& target, const std::filesystem::path& path, const FileCallback& onFile)
 {
     auto tokenizer = Tokenizer::createFromFile(path);
-    parse(target, std::move(tokenizer));
+    ParseContext ctx(tokenizer->getPath().parent_path(), onFile);
+    parse(target, std::move(tokenizer), ctx);
     target.onEndOfFiles();
 }
 
 void parseString(ParserTarget& target, std::string str)
 {
     auto tokenizer = Tokenizer::createFromString(std::move(str));
-    parse(target, std::move(tokenizer));
+    ParseContext ctx(tokenizer->getPath().parent_path());
+    parse(target, std::move(tokenizer), ctx);
     target.onEndOfFiles();
 }
 
@@ -35,9 +35,12 @@
 
 #include "Types.h"
 #include "Parameters.h"
+#include "Core/Platform/MemoryMappedFile.h"
+#include "Utils/GzipStream.h"
 #include <functional>
 #include <filesystem>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <string_view>
 
@@ -98,10 +101,21 @@ public:
     virtual void onObjectEnd(FileLoc loc) = 0;
     virtual void onObjectInstance(const std::string& name, FileLoc loc) = 0;
 
+    /**
+     * Called before and after the directives of a file loaded with 'Import'.
+     * Imported files are parsed in parallel and their directives are issued in file order once parsing has finished.
+     * Changes to the graphics state made by an imported file do not affect the importing file.
+     */
+    virtual void onImportBegin(FileLoc loc) = 0;
+    virtual void onImportEnd(FileLoc loc) = 0;
+
     virtual void onEndOfFiles() = 0;
 };
 
-void parseFile(ParserTarget& target, const std::filesystem::path& path);
+/// Callback called with the path of each file loaded with 'Include' or 'Import'. May be called concurrently from multiple threads.
+using FileCallback = std::function<void(const std::filesystem::path&)>;
+
+void parseFile(ParserTarget& target, const std::filesystem::path& path, const FileCallback& onFile = {});
 void parseString(ParserTarget& target, std::string str);
 
 struct Token
@@ -113,10 +127,21 @@ struct Token
     FileLoc loc;
 };
 
+/**
+ * Splits the contents of a file into tokens.
+ *
+ * Plain files are memory-mapped, so tokens point directly into the mapping and the file is paged in as it is parsed.
+ * Compressed (.gz) files are decompressed in chunks on a background thread (see GzipStream). The tokenizer keeps a
+ * sliding window over the decompressed data: when a token reaches the end of the current chunk, the part of the token
+ * scanned so far is moved to the start of the window and the next chunk is appended, so tokens spanning chunk
+ * boundaries stay contiguous. Only a few chunks are ever held in memory, regardless of the file size.
+ */
 class Tokenizer
 {
 public:
     Tokenizer(std::string str, const std::filesystem::path& path);
+    Tokenizer(std::unique_ptr<MemoryMappedFile> pMappedFile, const std::filesystem::path& path);
+    Tokenizer(std::unique_ptr<GzipStream> pStream, const std::filesystem::path& path);
 
     static std::unique_ptr<Tokenizer> createFromFile(const std::filesystem::path& path);
     static std::unique_ptr<Tokenizer> createFromString(std::string str);
@@ -130,6 +155,8 @@ public:
     const std::filesystem::path& getPath() const { return mPath; }
 
 private:
+    Tokenizer(const std::filesystem::path& path);
+
     /**
      * Static list of filenames to allow file locations (FileLoc::filename) to be valid
      * even after the tokenizer is destroyed.
@@ -140,11 +167,26 @@ private:
         return filenames;
     }
 
+    /// Mutex protecting getFilenames(), as imported files are tokenized in parallel.
+    static std::mutex& getFilenamesMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    void checkEncoding();
     bool isUTF16(const void* ptr, size_t len) const;
 
+    /**
+     * Slide the window to the next chunk of a compressed file, keeping the token being scanned.
+     * Must only be called when the window is exhausted (mPos == mEnd).
+     * @return False if there is no more data.
+     */
+    bool refill();
+
     int getChar()
     {
-        if (mPos == mEnd)
+        if (mPos == mEnd && !refill())
             return EOF;
         int ch = *mPos++;
         if (ch == '\n')
@@ -170,12 +212,16 @@ private:
         }
     }
 
-    std::filesystem::path mPath; ///< File path we're reading from.
-    FileLoc mLoc;                ///< File location.
-    std::string mContents;       ///< File contents we're parsing.
+    std::filesystem::path mPath;                   ///< File path we're reading from.
+    FileLoc mLoc;                                  ///< File location.
+    std::string mContents;                         ///< File contents we're parsing, or the sliding window when streaming.
+    std::unique_ptr<MemoryMappedFile> mpMappedFile; ///< Memory-mapped file contents we're parsing.
+    std::unique_ptr<GzipStream> mpStream;          ///< Stream of decompressed chunks, nullptr if not streaming.
+    std::string mChunk;                            ///< Last chunk read from the stream.
 
-    const char* mPos; ///< Current position in the file.
-    const char* mEnd; ///< End of the file (one past).
+    const char* mPos = nullptr;        ///< Current position in the file.
+    const char* mEnd = nullptr;        ///< End of the file (one past), or of the window when streaming.
+    const char* mTokenStart = nullptr; ///< Start of the token being scanned.
 
     std::string mEscaped; ///< Temporary storage for escaped tokens.
 };
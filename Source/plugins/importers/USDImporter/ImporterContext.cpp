@@ -1415,6 +1415,7 @@ namespace Falcor
         float intensity = getAuthoredAttribute(domeLight.GetIntensityAttr(), lightPrim.GetAttribute(TfToken("intensity")), 1.f);
         GfVec3f color = getAuthoredAttribute(domeLight.GetColorAttr(), lightPrim.GetAttribute(TfToken("color")), GfVec3f(1.f, 1.f, 1.f));
 
+        builder.addDependency(envMapPath);
         ref<EnvMap> pEnvMap = EnvMap::createFromFile(builder.getDevice(), envMapPath);
 
         if (pEnvMap == nullptr)
@@ -40,6 +40,8 @@ BEGIN_DISABLE_USD_WARNINGS
 #include <pxr/usd/usd/primRange.h>
 #include <pxr/usd/ar/resolver.h>
 #include <pxr/usd/ar/resolverContextBinder.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/usdShade/shader.h>
 #include <pxr/usd/usdGeom/bboxCache.h>
 #include <pxr/usd/usdGeom/camera.h>
 #include <pxr/usd/usdGeom/mesh.h>
@@ -65,6 +67,32 @@ namespace Falcor
         return true;
     }
 
+    // Add the layers of the stage and the files referenced by shader inputs (e.g. textures) as dependencies of the scene.
+    void addStageDependencies(const UsdStageRefPtr& pStage, SceneBuilder& builder)
+    {
+        for (const auto& pLayer : pStage->GetUsedLayers())
+        {
+            if (!pLayer->GetRealPath().empty()) builder.addDependency(pLayer->GetRealPath());
+        }
+
+        // Shaders of instanced prims are only visited once in their prototype.
+        auto addShaderDependencies = [&](const UsdPrimRange& range)
+        {
+            for (const UsdPrim& prim : range)
+            {
+                if (!prim.IsA<UsdShadeShader>()) continue;
+                for (const auto& input : UsdShadeShader(prim).GetInputs())
+                {
+                    SdfAssetPath path;
+                    if (input.GetTypeName() == SdfValueTypeNames->Asset && input.Get(&path, UsdTimeCode::EarliestTime()) && !path.GetResolvedPath().empty())
+                        builder.addDependency(path.GetResolvedPath());
+                }
+            }
+        };
+        addShaderDependencies(pStage->Traverse());
+        for (const UsdPrim& prototype : pStage->GetPrototypes()) addShaderDependencies(UsdPrimRange(prototype));
+    }
+
     // Traverse scene graph, converting supported prims from USD to Falcor equivalents
     void traversePrims(const UsdPrim& rootPrim, ImporterContext& ctx)
     {
@@ -333,6 +361,8 @@ namespace Falcor
 
         timeReport.measure("Open stage");
 
+        addStageDependencies(pStage, builder);
+
         // Add base directory to search paths.
         builder.pushAssetResolver();
         builder.getAssetResolver().addSearchPath(path.parent_path(), SearchPathPriority::First);